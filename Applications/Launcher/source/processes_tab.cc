@@ -15,9 +15,7 @@
 #include "processes_tab.h"
 
 #include <algorithm>
-#include <map>
 #include <memory>
-#include <set>
 #include <string>
 #include <vector>
 
@@ -40,11 +38,11 @@
 #include "process_details_window.h"
 #include "process_tracking.h"
 
-using ::perception::ForEachProcess;
 using ::perception::FormatSize;
-using ::perception::GetProcessName;
+using ::perception::GetProcessSnapshots;
 using ::perception::MessageId;
 using ::perception::ProcessId;
+using ::perception::ProcessSnapshot;
 using ::perception::ui::Layout;
 using ::perception::ui::Node;
 using ::perception::ui::TextAlignment;
@@ -106,46 +104,18 @@ class ProcessesDataSource : public Table::DataSource {
   }
 
   void UpdateProcesses() {
+    GetProcessSnapshots(snapshots_);
+
     std::vector<ProcessInfo> new_processes;
-    std::set<ProcessId> active_pids;
-
-    ForEachProcess([&](ProcessId pid) {
-      std::string name;
-      auto cache_itr = process_names_cache_.find(pid);
-      if (cache_itr != process_names_cache_.end()) {
-        name = cache_itr->second;
-      } else {
-        name = GetProcessName(pid);
-        if (name.empty()) return;
-        process_names_cache_[pid] = name;
-      }
-      active_pids.insert(pid);
-
-      size_t unique_memory = 0;
-      size_t shared_memory = 0;
-      size_t creation_timestamp = 0;
-      size_t registered_services = 0;
-      uint8 cpu_percentages[8] = {0};
-      perception::GetProcessHealthMetrics(pid, unique_memory, shared_memory,
-                                          creation_timestamp,
-                                          registered_services, cpu_percentages);
-
-      new_processes.push_back({.name = std::move(name),
-                               .pid = pid,
-                               .registered_services = registered_services,
-                               .unique_memory = unique_memory,
-                               .shared_memory = shared_memory,
-                               .cpu_percentage = cpu_percentages[0]});
-    });
-
-    // Clean up terminated processes from name cache
-    for (auto itr = process_names_cache_.begin();
-         itr != process_names_cache_.end();) {
-      if (active_pids.find(itr->first) == active_pids.end()) {
-        itr = process_names_cache_.erase(itr);
-      } else {
-        ++itr;
-      }
+    new_processes.reserve(snapshots_.size());
+    for (const auto& snapshot : snapshots_) {
+      new_processes.push_back(
+          {.name = snapshot.name,
+           .pid = snapshot.pid,
+           .registered_services = snapshot.registered_services,
+           .unique_memory = snapshot.unique_memory,
+           .shared_memory = snapshot.shared_memory,
+           .cpu_percentage = snapshot.cpu_percentages[0]});
     }
 
     processes_ = std::move(new_processes);
@@ -165,7 +135,9 @@ class ProcessesDataSource : public Table::DataSource {
   std::vector<ProcessInfo> processes_;
   int sorted_column_index_;
   bool sort_ascending_;
-  std::map<ProcessId, std::string> process_names_cache_;
+
+  // Reused between updates to avoid reallocating.
+  std::vector<ProcessSnapshot> snapshots_;
 
   void SortData() {
     if (sorted_column_index_ < 0) return;
@@ -307,7 +279,7 @@ std::shared_ptr<Node> GetOrConstructProcessesTab() {
         layout.SetFlexShrink(1.0f);
         layout.SetMinHeight(0.0f);
       },
-      &processes_table);
+      [](Table& table) { table.SetIsVirtualized(true); }, &processes_table);
 
   processes_table->OnCellSelect([](int r, int c) {
     if (processes_data_source) {
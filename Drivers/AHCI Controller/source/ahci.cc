@@ -21,6 +21,7 @@
 #include "ahci_storage_device.h"
 #include "ahci_types.h"
 #include "perception/devices/device_manager.h"
+#include "perception/interrupts.h"
 #include "perception/memory.h"
 #include "perception/pci.h"
 #include "perception/services.h"
@@ -30,9 +31,11 @@ using ::perception::kPciHdrBar5;
 using ::perception::kPciHdrCommand;
 using ::perception::kPciHdrCommandBitBusMaster;
 using ::perception::kPciHdrCommandBitMemorySpace;
+using ::perception::kPciHdrInterruptLine;
 using ::perception::MapPhysicalMemory;
 using ::perception::Read32BitsFromPciConfig;
 using ::perception::Read8BitsFromPciConfig;
+using ::perception::RegisterInterruptHandler;
 using ::perception::Write8BitsToPciConfig;
 using ::perception::devices::DeviceManager;
 using ::perception::devices::PciDeviceFilter;
@@ -60,8 +63,14 @@ void InitializeAhciController(uint8 bus, uint8 slot, uint8 function) {
 
   HbaMem* hba = reinterpret_cast<HbaMem*>(mapped);
 
-  // Enable AHCI Mode (GHC.AE = bit 31)
-  hba->ghc |= (1U << 31);
+  // Enable AHCI Mode
+  hba->ghc |= kAhciGhcAe;
+
+  int command_slots = ((hba->cap >> kAhciCapNcsShift) & kAhciCapNcsMask) + 1;
+  bool supports_ncq = (hba->cap & kAhciCapSncq) != 0;
+
+  // The devices on this controller.
+  std::vector<AhciStorageDevice*> devices;
 
   uint32 pi = hba->pi;
   for (int i = 0; i < 32; ++i) {
@@ -80,19 +89,41 @@ void InitializeAhciController(uint8 bus, uint8 slot, uint8 function) {
         uint64 sector_count = 2000000;
         uint32 sector_size = 512;
         ahci_devices.push_back(std::make_unique<AhciStorageDevice>(
-            port, i, sector_count, sector_size, drive_name,
-            StorageDeviceType::HARD_DRIVE));
+            port, i, command_slots, supports_ncq, sector_count, sector_size,
+            drive_name, StorageDeviceType::HARD_DRIVE));
+        devices.push_back(ahci_devices.back().get());
       } else if (sig == kSataSigAtapi) {
         std::string drive_name =
             "SATA Optical Drive " + std::to_string(ahci_devices.size() + 1);
         uint64 sector_count = 2000000;
         uint32 sector_size = 2048;
         ahci_devices.push_back(std::make_unique<AhciStorageDevice>(
-            port, i, sector_count, sector_size, drive_name,
-            StorageDeviceType::OPTICAL));
+            port, i, command_slots, supports_ncq, sector_count, sector_size,
+            drive_name, StorageDeviceType::OPTICAL));
+        devices.push_back(ahci_devices.back().get());
       }
     }
   }
+  if (devices.empty()) return;
+
+  // Commands complete by raising the controller's interrupt. The PIC is edge
+  // triggered, so the handler keeps going until the controller has nothing
+  // pending, otherwise the line would stay raised and no more interrupts
+  // would arrive.
+  uint8 interrupt_line =
+      Read8BitsFromPciConfig(bus, slot, function, kPciHdrInterruptLine);
+  RegisterInterruptHandler(interrupt_line, [hba, devices]() {
+    uint32 pending_ports = hba->is;
+    while (pending_ports != 0) {
+      for (AhciStorageDevice* device : devices) {
+        if (pending_ports & (1U << device->PortIndex()))
+          device->HandleInterrupt();
+      }
+      hba->is = pending_ports;
+      pending_ports = hba->is;
+    }
+  });
+  hba->ghc |= kAhciGhcIe;
 }
 
 }  // namespace
@@ -14,6 +14,8 @@
 
 #include "ahci_storage_device.h"
 
+#include <algorithm>
+#include <chrono>
 #include <cstring>
 #include <iostream>
 #include <vector>
@@ -22,10 +24,15 @@
 #include "perception/memory.h"
 #include "perception/shared_memory.h"
 #include "perception/threads.h"
+#include "perception/time.h"
 #include "types.h"
 
+using ::perception::AfterDuration;
 using ::perception::AllocateMemoryPages;
+using ::perception::Fiber;
+using ::perception::GetCurrentlyExecutingFiber;
 using ::perception::GetPhysicalAddressOfVirtualAddress;
+using ::perception::GetTimeSinceKernelStarted;
 using ::perception::kPageSize;
 using ::perception::ReleaseMemoryPages;
 using ::perception::Sleep;
@@ -35,6 +42,15 @@ using ::perception::devices::StorageDeviceType;
 
 namespace {
 
+// The most bytes a single command transfers. Each page of the destination
+// takes at most one PRDT entry, so this keeps every command well within
+// kAhciMaxPrdtEntries.
+constexpr size_t kMaxBytesPerCommand = 128 * kPageSize;
+
+// How long a command may take before it's given up on. Optical drives can
+// take a few seconds to spin up.
+constexpr auto kCommandTimeout = std::chrono::seconds(10);
+
 void StopPortCmd(HbaPort* port) {
   port->cmd &= ~kAhciPortCmdSt;
   port->cmd &= ~kAhciPortCmdFre;
@@ -56,9 +72,19 @@ void StartPortCmd(HbaPort* port) {
   port->cmd |= kAhciPortCmdSt;
 }
 
+// Allocates a zeroed page and returns its physical address.
+void* AllocateZeroedPage(size_t& physical_address) {
+  void* page = AllocateMemoryPages(1);
+  std::memset(page, 0, kPageSize);
+  physical_address =
+      GetPhysicalAddressOfVirtualAddress(reinterpret_cast<size_t>(page));
+  return page;
+}
+
 }  // namespace
 
 AhciStorageDevice::AhciStorageDevice(HbaPort* port, int port_index,
+                                     int command_slots, bool supports_ncq,
                                      uint64 sector_count, uint32 sector_size,
                                      const std::string& name,
                                      StorageDeviceType device_type)
@@ -70,34 +96,35 @@ AhciStorageDevice::AhciStorageDevice(HbaPort* port, int port_index,
       sector_size_(sector_size),
       size_in_bytes_(sector_count * sector_size),
       name_(name),
-      device_type_(device_type) {
+      device_type_(device_type),
+      command_slots_(command_slots),
+      use_ncq_(supports_ncq && device_type != StorageDeviceType::OPTICAL),
+      queue_depth_(command_slots),
+      max_sectors_per_command_(kMaxBytesPerCommand / sector_size),
+      slot_reads_{},
+      slot_command_ids_{},
+      next_command_id_(1),
+      issued_slots_(0) {
   // Allocate Command List (1KB)
-  void* cl_virt = AllocateMemoryPages(1);
-  std::memset(cl_virt, 0, kPageSize);
-  cmd_list_ = static_cast<HbaCmdHeader*>(cl_virt);
-  cmd_list_phys_ =
-      GetPhysicalAddressOfVirtualAddress(reinterpret_cast<size_t>(cl_virt));
+  cmd_list_ = static_cast<HbaCmdHeader*>(AllocateZeroedPage(cmd_list_phys_));
 
   // Allocate Received FIS (256B)
-  void* fis_virt = AllocateMemoryPages(1);
-  std::memset(fis_virt, 0, kPageSize);
-  fis_base_ = fis_virt;
-  fis_base_phys_ =
-      GetPhysicalAddressOfVirtualAddress(reinterpret_cast<size_t>(fis_virt));
-
-  // Allocate Command Table
-  void* ct_virt = AllocateMemoryPages(1);
-  std::memset(ct_virt, 0, kPageSize);
-  cmd_tbl_ = static_cast<HbaCmdTbl*>(ct_virt);
-  cmd_tbl_phys_ =
-      GetPhysicalAddressOfVirtualAddress(reinterpret_cast<size_t>(ct_virt));
-
-  // Allocate DMA transfer buffer (64KB = 16 pages)
-  void* dma_virt = AllocateMemoryPages(16);
-  std::memset(dma_virt, 0, 16 * kPageSize);
-  dma_buffer_ = dma_virt;
-  dma_buffer_phys_ =
-      GetPhysicalAddressOfVirtualAddress(reinterpret_cast<size_t>(dma_virt));
+  fis_base_ = AllocateZeroedPage(fis_base_phys_);
+
+  // Allocate a Command Table for each slot. They don't need to be physically
+  // contiguous with each other.
+  cmd_tbls_ = static_cast<HbaCmdTbl*>(AllocateMemoryPages(command_slots_));
+  std::memset(cmd_tbls_, 0, command_slots_ * kPageSize);
+  cmd_tbl_phys_.resize(command_slots_);
+  for (int slot = 0; slot < command_slots_; slot++) {
+    cmd_tbl_phys_[slot] = GetPhysicalAddressOfVirtualAddress(
+        reinterpret_cast<size_t>(&cmd_tbls_[slot]));
+    cmd_list_[slot].ctba = static_cast<uint32>(cmd_tbl_phys_[slot] & 0xFFFFFFFF);
+    cmd_list_[slot].ctbau =
+        static_cast<uint32>((cmd_tbl_phys_[slot] >> 32) & 0xFFFFFFFF);
+  }
+
+  discard_page_ = AllocateZeroedPage(discard_page_phys_);
 
   // Setup port registers
   StopPortCmd(port_);
@@ -106,17 +133,22 @@ AhciStorageDevice::AhciStorageDevice(HbaPort* port, int port_index,
   port_->fb = static_cast<uint32>(fis_base_phys_ & 0xFFFFFFFF);
   port_->fbu = static_cast<uint32>((fis_base_phys_ >> 32) & 0xFFFFFFFF);
   port_->serr = 0xFFFFFFFF;
+  port_->is = 0xFFFFFFFF;
+  port_->ie = kAhciPortIsEnabled;
   StartPortCmd(port_);
 
+  if (use_ncq_) IdentifyDevice();
+
   StartServing();
 }
 
 AhciStorageDevice::~AhciStorageDevice() {
+  port_->ie = 0;
   StopPortCmd(port_);
   if (cmd_list_) ReleaseMemoryPages(cmd_list_, 1);
   if (fis_base_) ReleaseMemoryPages(fis_base_, 1);
-  if (cmd_tbl_) ReleaseMemoryPages(cmd_tbl_, 1);
-  if (dma_buffer_) ReleaseMemoryPages(dma_buffer_, 16);
+  if (cmd_tbls_) ReleaseMemoryPages(cmd_tbls_, command_slots_);
+  if (discard_page_) ReleaseMemoryPages(discard_page_, 1);
 }
 
 StatusOr<StorageDeviceDetails> AhciStorageDevice::GetDeviceDetails() {
@@ -129,43 +161,177 @@ StatusOr<StorageDeviceDetails> AhciStorageDevice::GetDeviceDetails() {
   return details;
 }
 
-bool AhciStorageDevice::PerformRead(uint64 start_sector, uint32 sector_count,
-                                    void* buffer) {
-  if (sector_count == 0) return true;
-  size_t bytes_to_read = sector_count * sector_size_;
-  if (bytes_to_read > 16 * kPageSize) return false;
+void AhciStorageDevice::HandleInterrupt() {
+  uint32 status = port_->is;
+  port_->is = status;
+
+  if (status & kAhciPortIsErrors) {
+    std::cout << name_ << " error! is=0x" << std::hex << status << " tfd=0x"
+              << port_->tfd << " serr=0x" << port_->serr << std::dec
+              << std::endl;
+    RecoverFromError();
+    return;
+  }
 
-  port_->is = 0xFFFFFFFF;  // Clear interrupt status
+  // Queued commands stay in SACT until the device has finished them, while
+  // non-queued commands stay in CI.
+  uint32 completed_slots = issued_slots_ & ~(port_->ci | port_->sact);
+  while (completed_slots != 0) {
+    int slot = __builtin_ctz(completed_slots);
+    completed_slots &= completed_slots - 1;
+    CompleteCommandSlot(slot, /*failed=*/false);
+  }
+}
+
+bool AhciStorageDevice::PerformRead(uint64 start_sector, uint64 sector_count,
+                                    const std::vector<DmaSegment>& segments) {
+  PendingRead read;
+  size_t segment = 0;
+  size_t offset_in_segment = 0;
+
+  while (sector_count > 0 && !read.failed) {
+    uint32 chunk_sectors = static_cast<uint32>(
+        std::min<uint64>(sector_count, max_sectors_per_command_));
+    int slot = AcquireCommandSlot();
+    if (read.failed) break;
+
+    // Point the PRDT straight at the destination memory.
+    HbaPrdtEntry* prdt = cmd_tbls_[slot].prdt_entry;
+    int prdt_entries = 0;
+    size_t bytes_left = static_cast<size_t>(chunk_sectors) * sector_size_;
+    while (bytes_left > 0) {
+      const DmaSegment& dma_segment = segments[segment];
+      size_t size =
+          std::min(dma_segment.size - offset_in_segment, bytes_left);
+      size_t address = dma_segment.physical_address + offset_in_segment;
+      HbaPrdtEntry& entry = prdt[prdt_entries++];
+      entry.dba = static_cast<uint32>(address & 0xFFFFFFFF);
+      entry.dbau = static_cast<uint32>((address >> 32) & 0xFFFFFFFF);
+      entry.rsv0 = 0;
+      entry.dbc = size - 1;
+      entry.i = 0;
+
+      bytes_left -= size;
+      offset_in_segment += size;
+      if (offset_in_segment == dma_segment.size) {
+        segment++;
+        offset_in_segment = 0;
+      }
+    }
+
+    IssueRead(slot, start_sector, chunk_sectors, prdt_entries, &read);
+    start_sector += chunk_sectors;
+    sector_count -= chunk_sectors;
+  }
+
+  while (read.commands_in_flight > 0) {
+    read.waiting_fiber = GetCurrentlyExecutingFiber();
+    Sleep();
+  }
+  return !read.failed;
+}
+
+void AhciStorageDevice::IdentifyDevice() {
+  // Nothing has been read yet, so the identify data goes in the discard page.
+  HbaCmdHeader& header = cmd_list_[0];
+  header.cfl = sizeof(FisRegH2D) / sizeof(uint32);
+  header.a = 0;
+  header.w = 0;  // Read from device
+  header.p = 0;
+  header.c = 0;
+  header.prdtl = 1;
+  header.prdbc = 0;
+
+  HbaCmdTbl& table = cmd_tbls_[0];
+  HbaPrdtEntry& entry = table.prdt_entry[0];
+  entry.dba = static_cast<uint32>(discard_page_phys_ & 0xFFFFFFFF);
+  entry.dbau = static_cast<uint32>((discard_page_phys_ >> 32) & 0xFFFFFFFF);
+  entry.rsv0 = 0;
+  entry.dbc = 512 - 1;
+  entry.i = 0;
+
+  std::memset(table.cfis, 0, sizeof(table.cfis));
+  FisRegH2D* fis = reinterpret_cast<FisRegH2D*>(table.cfis);
+  fis->fis_type = kFisTypeRegH2D;
+  fis->pmport_c = 0x80;  // Command bit
+  fis->command = kAtaCmdIdentifyDevice;
+
+  int spin = 0;
+  while ((port_->tfd & (kAtaStatusBsy | kAtaStatusDrq)) && spin < 1000000) {
+    spin++;
+  }
+
+  port_->ci = 1;
+  auto deadline = GetTimeSinceKernelStarted() + kCommandTimeout;
+  bool failed = false;
+  while ((port_->ci & 1) != 0) {
+    if ((port_->is & kAhciPortIsErrors) != 0 ||
+        GetTimeSinceKernelStarted() >= deadline) {
+      failed = true;
+      break;
+    }
+  }
+  port_->is = port_->is;
+
+  const uint16* identify_data = static_cast<const uint16*>(discard_page_);
+  if (failed || (identify_data[kAtaIdentifySataCapabilities] &
+                 kAtaIdentifySataCapabilitiesNcq) == 0) {
+    if (failed) {
+      std::cout << name_ << " didn't respond to IDENTIFY DEVICE tfd=0x"
+                << std::hex << port_->tfd << std::dec << std::endl;
+      RecoverFromError();
+    }
+    use_ncq_ = false;
+    return;
+  }
+
+  int device_queue_depth =
+      (identify_data[kAtaIdentifyQueueDepth] & kAtaIdentifyQueueDepthMask) + 1;
+  queue_depth_ = std::min(command_slots_, device_queue_depth);
+}
+
+int AhciStorageDevice::AcquireCommandSlot() {
+  uint32 all_slots = queue_depth_ == 32
+                         ? 0xFFFFFFFF
+                         : ((uint32)1 << queue_depth_) - 1;
+  while (true) {
+    uint32 free_slots = all_slots & ~issued_slots_;
+    if (free_slots != 0) return __builtin_ctz(free_slots);
+
+    fibers_waiting_for_slot_.push_back(GetCurrentlyExecutingFiber());
+    Sleep();
+  }
+}
 
-  // Setup Command Header 0
-  std::memset(cmd_list_, 0, sizeof(HbaCmdHeader));
-  cmd_list_[0].cfl = sizeof(FisRegH2D) / sizeof(uint32);
-  cmd_list_[0].w = 0;  // Read from device
-  cmd_list_[0].prdtl = 1;
-  cmd_list_[0].ctba = static_cast<uint32>(cmd_tbl_phys_ & 0xFFFFFFFF);
-  cmd_list_[0].ctbau = static_cast<uint32>((cmd_tbl_phys_ >> 32) & 0xFFFFFFFF);
+void AhciStorageDevice::IssueRead(int slot, uint64 start_sector,
+                                  uint32 sector_count, int prdt_entries,
+                                  PendingRead* read) {
+  // Setup Command Header
+  HbaCmdHeader& header = cmd_list_[slot];
+  header.cfl = sizeof(FisRegH2D) / sizeof(uint32);
+  header.a = 0;
+  header.w = 0;  // Read from device
+  header.p = 0;
+  header.c = 0;
+  header.prdtl = prdt_entries;
+  header.prdbc = 0;
 
   // Setup Command Table
-  std::memset(cmd_tbl_, 0, sizeof(HbaCmdTbl));
-  cmd_tbl_->prdt_entry[0].dba =
-      static_cast<uint32>(dma_buffer_phys_ & 0xFFFFFFFF);
-  cmd_tbl_->prdt_entry[0].dbau =
-      static_cast<uint32>((dma_buffer_phys_ >> 32) & 0xFFFFFFFF);
-  cmd_tbl_->prdt_entry[0].dbc = bytes_to_read - 1;
-  cmd_tbl_->prdt_entry[0].i = 1;
+  HbaCmdTbl& table = cmd_tbls_[slot];
+  std::memset(table.cfis, 0, sizeof(table.cfis));
+  FisRegH2D* fis = reinterpret_cast<FisRegH2D*>(table.cfis);
+  fis->fis_type = kFisTypeRegH2D;
+  fis->pmport_c = 0x80;  // Command bit
 
   if (device_type_ == StorageDeviceType::OPTICAL) {
-    cmd_list_[0].a = 1;  // Set ATAPI bit in Command Header
-    FisRegH2D* fis = reinterpret_cast<FisRegH2D*>(cmd_tbl_->cfis);
-    fis->fis_type = kFisTypeRegH2D;
-    fis->pmport_c = 0x80;  // Command bit
+    header.a = 1;          // Set ATAPI bit in Command Header
     fis->command = 0xA0;   // PACKET command (ATAPI)
     fis->featurel = 0x05;  // DMA mode (bit 0 = 1 for DMA transfer)
     fis->lba1 = 0xFF;      // Byte Count Limit Low (0xFFFF max)
     fis->lba2 = 0xFF;      // Byte Count Limit High
 
     // Setup ATAPI ACMD (READ 12 command)
-    uint8* acmd = cmd_tbl_->acmd;
+    uint8* acmd = table.acmd;
     std::memset(acmd, 0, 16);
     acmd[0] = 0xA8;  // READ(12) opcode
     acmd[2] = (start_sector >> 24) & 0xFF;
@@ -177,11 +343,18 @@ bool AhciStorageDevice::PerformRead(uint64 start_sector, uint32 sector_count,
     acmd[8] = (sector_count >> 8) & 0xFF;
     acmd[9] = sector_count & 0xFF;
   } else {
-    // Setup FIS Reg H2D for ATA SATA Hard Disk
-    FisRegH2D* fis = reinterpret_cast<FisRegH2D*>(cmd_tbl_->cfis);
-    fis->fis_type = kFisTypeRegH2D;
-    fis->pmport_c = 0x80;  // Command bit
-    fis->command = kAtaCmdReadDmaExt;
+    if (use_ncq_) {
+      // READ FPDMA QUEUED takes the sector count in the feature registers and
+      // the tag (which is the command slot) in the count register.
+      fis->command = kAtaCmdReadFpdmaQueued;
+      fis->featurel = sector_count & 0xFF;
+      fis->featureh = (sector_count >> 8) & 0xFF;
+      fis->countl = slot << 3;
+    } else {
+      fis->command = kAtaCmdReadDmaExt;
+      fis->countl = sector_count & 0xFF;
+      fis->counth = (sector_count >> 8) & 0xFF;
+    }
 
     fis->lba0 = start_sector & 0xFF;
     fis->lba1 = (start_sector >> 8) & 0xFF;
@@ -191,55 +364,82 @@ bool AhciStorageDevice::PerformRead(uint64 start_sector, uint32 sector_count,
     fis->lba3 = (start_sector >> 24) & 0xFF;
     fis->lba4 = (start_sector >> 32) & 0xFF;
     fis->lba5 = (start_sector >> 40) & 0xFF;
-
-    fis->countl = sector_count & 0xFF;
-    fis->counth = (sector_count >> 8) & 0xFF;
   }
 
-  // Wait until port is not busy
-  int spin = 0;
-  while ((port_->tfd & (0x80 | 0x08)) && spin < 1000000) {
-    spin++;
-  }
-  if (port_->tfd & (0x80 | 0x08)) {
-    std::cout << "PerformRead port busy! tfd=0x" << std::hex << port_->tfd
-              << std::dec << std::endl;
-    return false;
+  if (issued_slots_ == 0) {
+    // Wait until port is not busy
+    int spin = 0;
+    while ((port_->tfd & (kAtaStatusBsy | kAtaStatusDrq)) && spin < 1000000) {
+      spin++;
+    }
   }
 
-  // Issue command slot 0
-  port_->ci = 1;
+  slot_reads_[slot] = read;
+  read->commands_in_flight++;
+  issued_slots_ |= (uint32)1 << slot;
+  uint64 command_id = next_command_id_++;
+  slot_command_ids_[slot] = command_id;
+
+  if (use_ncq_) port_->sact = (uint32)1 << slot;
+  port_->ci = (uint32)1 << slot;
+
+  // Don't let a command whose interrupt never arrives hold on to its slot
+  // forever.
+  AfterDuration(kCommandTimeout, [this, slot, command_id]() {
+    MaybeTimeOutCommandSlot(slot, command_id);
+  });
+}
 
-  // Wait for completion
-  spin = 0;
-  constexpr int kMaxSpin = 10000000;
-  while ((port_->ci & 1) != 0 && spin < kMaxSpin) {
-    if (port_->is & (1 << 30)) {  // Task file error
-      std::cout << "PerformRead task file error! is=0x" << std::hex << port_->is
-                << " tfd=0x" << port_->tfd << std::dec << std::endl;
-      return false;
+void AhciStorageDevice::CompleteCommandSlot(int slot, bool failed) {
+  PendingRead* read = slot_reads_[slot];
+  slot_reads_[slot] = nullptr;
+  issued_slots_ &= ~((uint32)1 << slot);
+
+  if (read != nullptr) {
+    if (failed) read->failed = true;
+    read->commands_in_flight--;
+    if (read->commands_in_flight == 0 && read->waiting_fiber != nullptr) {
+      Fiber* fiber = read->waiting_fiber;
+      read->waiting_fiber = nullptr;
+      fiber->WakeUp();
     }
-    asm volatile("pause");
-    spin++;
   }
-  if ((port_->ci & 1) != 0) {
-    std::cout << "PerformRead command timeout! ci=0x" << std::hex << port_->ci
-              << " tfd=0x" << port_->tfd << " serr=0x" << port_->serr
-              << std::dec << std::endl;
-    return false;
+
+  if (!fibers_waiting_for_slot_.empty()) {
+    Fiber* fiber = fibers_waiting_for_slot_.front();
+    fibers_waiting_for_slot_.pop_front();
+    fiber->WakeUp();
   }
+}
 
-  // Clear interrupt status bits
-  port_->is = port_->is;
+void AhciStorageDevice::RecoverFromError() {
+  // The port stops processing commands on an error. Restarting it clears
+  // CI and SACT, so every outstanding command is lost.
+  StopPortCmd(port_);
+  port_->serr = 0xFFFFFFFF;
+  port_->is = 0xFFFFFFFF;
+  StartPortCmd(port_);
 
-  if (port_->tfd & 0x01) {  // Error status bit
-    std::cout << "PerformRead error status bit set! tfd=0x" << std::hex
-              << port_->tfd << std::dec << std::endl;
-    return false;
+  uint32 failed_slots = issued_slots_;
+  while (failed_slots != 0) {
+    int slot = __builtin_ctz(failed_slots);
+    failed_slots &= failed_slots - 1;
+    CompleteCommandSlot(slot, /*failed=*/true);
   }
+}
+
+void AhciStorageDevice::MaybeTimeOutCommandSlot(int slot, uint64 command_id) {
+  if ((issued_slots_ & ((uint32)1 << slot)) == 0 ||
+      slot_command_ids_[slot] != command_id)
+    return;  // The command completed.
+
+  std::cout << name_ << " timed out waiting for command slot " << slot
+            << " tfd=0x" << std::hex << port_->tfd << " serr=0x"
+            << port_->serr << std::dec << std::endl;
 
-  std::memcpy(buffer, dma_buffer_, bytes_to_read);
-  return true;
+  // The only way to take a command back from the device is to restart the
+  // port, which also stops it from DMAing into the read's pages later.
+  RecoverFromError();
 }
 
 Status AhciStorageDevice::Read(const StorageDeviceReadRequest& request) {
@@ -265,24 +465,32 @@ Status AhciStorageDevice::Read(const StorageDeviceReadRequest& request) {
     return Status::OVERFLOW;
 
   bool can_write = details.CanWrite && !details.IsLazilyAllocated;
-  std::vector<void*> allocated_pages;
   size_t start_page = buffer_offset / kPageSize;
   size_t end_page = (buffer_offset + bytes_to_copy - 1) / kPageSize;
   size_t num_pages = end_page - start_page + 1;
 
-  if (!can_write) {
-    allocated_pages.resize(num_pages, nullptr);
-    for (size_t p = 0; p < num_pages; p++) {
-      size_t page_index = start_page + p;
-      size_t page_offset = page_index * kPageSize;
+  // The pages the data ends up in. If we can't write to the buffer, we read
+  // into our own pages and assign them to the buffer afterwards.
+  std::vector<void*> allocated_pages;
+  std::vector<size_t> page_physical_addresses(num_pages);
+
+  for (size_t p = 0; p < num_pages; p++) {
+    size_t page_offset = (start_page + p) * kPageSize;
+    if (can_write) {
+      auto physical_address = request.buffer->GetPhysicalAddress(page_offset);
+      if (!physical_address) return Status::INTERNAL_ERROR;
+      page_physical_addresses[p] = *physical_address;
+    } else {
       void* new_page = AllocateMemoryPages(1);
-      allocated_pages[p] = new_page;
+      allocated_pages.push_back(new_page);
       if (request.buffer->IsPageAllocated(page_offset)) {
         std::memcpy(new_page, (uint8*)**request.buffer + page_offset,
                     kPageSize);
       } else {
         std::memset(new_page, 0, kPageSize);
       }
+      page_physical_addresses[p] = GetPhysicalAddressOfVirtualAddress(
+          reinterpret_cast<size_t>(new_page));
     }
   }
 
@@ -300,49 +508,82 @@ Status AhciStorageDevice::Read(const StorageDeviceReadRequest& request) {
   uint64 start_sector = device_offset_start / sector_size_;
   uint64 end_sector =
       (device_offset_start + bytes_to_copy + sector_size_ - 1) / sector_size_;
-  uint32 sector_count = static_cast<uint32>(end_sector - start_sector);
-
-  uint64 sector_offset_bytes = device_offset_start % sector_size_;
-
-  // Maximum sectors per DMA chunk (1 sector = 2048 bytes, guaranteed physically
-  // contiguous page)
-  constexpr uint32 kMaxSectorsPerRead = 1;
-  uint64 remaining_sectors = sector_count;
-  uint64 current_sector = start_sector;
-  uint64 bytes_copied = 0;
+  uint64 sector_count = end_sector - start_sector;
+
+  // Bytes read from the first and last sector that weren't asked for.
+  uint64 head_bytes = device_offset_start % sector_size_;
+  uint64 tail_bytes =
+      end_sector * sector_size_ - (device_offset_start + bytes_to_copy);
+
+  // PRDT entries must start on a word boundary and be an even number of bytes
+  // long. If the request lines up, the device DMAs straight into the
+  // destination pages. Otherwise, the sectors are read into bounce pages and
+  // copied over.
+  bool dma_directly = (head_bytes % 2) == 0 && (buffer_offset % 2) == 0 &&
+                      (bytes_to_copy % 2) == 0;
+  std::vector<DmaSegment> segments;
+  std::vector<void*> bounce_pages;
+  if (dma_directly) {
+    if (head_bytes > 0) segments.push_back({discard_page_phys_, head_bytes});
+
+    uint64 offset = buffer_offset;
+    uint64 end_offset = buffer_offset + bytes_to_copy;
+    while (offset < end_offset) {
+      size_t offset_in_page = offset % kPageSize;
+      size_t size = std::min<uint64>(kPageSize - offset_in_page,
+                                     end_offset - offset);
+      size_t address =
+          page_physical_addresses[offset / kPageSize - start_page] +
+          offset_in_page;
+      if (!segments.empty() &&
+          segments.back().physical_address != discard_page_phys_ &&
+          segments.back().physical_address + segments.back().size ==
+              address) {
+        // Merge physically contiguous pages into one segment.
+        segments.back().size += size;
+      } else {
+        segments.push_back({address, size});
+      }
+      offset += size;
+    }
 
-  std::vector<uint8> temp_buffer(kMaxSectorsPerRead * sector_size_);
+    if (tail_bytes > 0) segments.push_back({discard_page_phys_, tail_bytes});
+  } else {
+    uint64 bytes_to_read = sector_count * sector_size_;
+    for (uint64 offset = 0; offset < bytes_to_read; offset += kPageSize) {
+      size_t physical_address;
+      bounce_pages.push_back(AllocateZeroedPage(physical_address));
+      segments.push_back(
+          {physical_address,
+           std::min<uint64>(kPageSize, bytes_to_read - offset)});
+    }
+  }
 
-  while (remaining_sectors > 0) {
-    uint32 chunk_sectors = static_cast<uint32>(
-        remaining_sectors < kMaxSectorsPerRead ? remaining_sectors
-                                               : kMaxSectorsPerRead);
-
-    if (!PerformRead(current_sector, chunk_sectors, temp_buffer.data())) {
-      if (!can_write) {
-        for (size_t p = 0; p < num_pages; p++) {
-          if (allocated_pages[p]) ReleaseMemoryPages(allocated_pages[p], 1);
-        }
-      }
-      return Status::INTERNAL_ERROR;
+  bool succeeded = PerformRead(start_sector, sector_count, segments);
+
+  if (succeeded && !dma_directly) {
+    // Copy out of the bounce pages, splitting on both source and destination
+    // page boundaries.
+    uint64 bytes_copied = 0;
+    while (bytes_copied < bytes_to_copy) {
+      uint64 source_offset = head_bytes + bytes_copied;
+      uint64 destination_offset = buffer_offset + bytes_copied;
+      uint64 size = std::min<uint64>(
+          {kPageSize - source_offset % kPageSize,
+           kPageSize - destination_offset % kPageSize,
+           bytes_to_copy - bytes_copied});
+      std::memcpy(get_virtual_address(destination_offset),
+                  (uint8*)bounce_pages[source_offset / kPageSize] +
+                      source_offset % kPageSize,
+                  size);
+      bytes_copied += size;
     }
+  }
+  for (void* page : bounce_pages) ReleaseMemoryPages(page, 1);
 
-    uint64 chunk_data_offset =
-        (current_sector == start_sector) ? sector_offset_bytes : 0;
-    uint64 chunk_bytes_available =
-        (chunk_sectors * sector_size_) - chunk_data_offset;
-    uint64 bytes_to_write_now =
-        (bytes_to_copy - bytes_copied < chunk_bytes_available)
-            ? (bytes_to_copy - bytes_copied)
-            : chunk_bytes_available;
-
-    uint8* dest = get_virtual_address(buffer_offset + bytes_copied);
-    std::memcpy(dest, temp_buffer.data() + chunk_data_offset,
-                bytes_to_write_now);
-
-    bytes_copied += bytes_to_write_now;
-    current_sector += chunk_sectors;
-    remaining_sectors -= chunk_sectors;
+  if (!succeeded) {
+    for (void* page : allocated_pages) ReleaseMemoryPages(page, 1);
+    return Status::INTERNAL_ERROR;
   }
 
   if (!can_write) {
@@ -14,15 +14,19 @@
 
 #pragma once
 
+#include <deque>
 #include <string>
+#include <vector>
 
 #include "ahci_types.h"
 #include "perception/devices/storage_device.h"
+#include "perception/fibers.h"
 #include "types.h"
 
 class AhciStorageDevice : public ::perception::devices::StorageDevice::Server {
  public:
-  AhciStorageDevice(HbaPort* port, int port_index, uint64 sector_count,
+  AhciStorageDevice(HbaPort* port, int port_index, int command_slots,
+                    bool supports_ncq, uint64 sector_count,
                     uint32 sector_size, const std::string& name,
                     ::perception::devices::StorageDeviceType device_type =
                         ::perception::devices::StorageDeviceType::HARD_DRIVE);
@@ -34,9 +38,63 @@ class AhciStorageDevice : public ::perception::devices::StorageDevice::Server {
   Status Read(
       const ::perception::devices::StorageDeviceReadRequest& request) override;
 
-  bool PerformRead(uint64 start_sector, uint32 sector_count, void* buffer);
+  // Called by the controller's interrupt handler when this device's port has
+  // raised an interrupt. Completes any commands that have finished.
+  void HandleInterrupt();
+
+  // The index of the port on the controller.
+  int PortIndex() const { return port_index_; }
 
  private:
+  // A physically contiguous region of memory to DMA into.
+  struct DmaSegment {
+    size_t physical_address;
+    size_t size;
+  };
+
+  // A read that is split across one or more commands.
+  struct PendingRead {
+    // The number of commands that haven't completed yet.
+    int commands_in_flight = 0;
+
+    // Did any of the commands fail?
+    bool failed = false;
+
+    // The fiber to wake up once all commands have completed.
+    ::perception::Fiber* waiting_fiber = nullptr;
+  };
+
+  // Reads sectors into the segments, which must add up to at least
+  // `sector_count` sectors. The read is split into as many commands as needed
+  // and they are all queued at once. Returns once every command has
+  // completed.
+  bool PerformRead(uint64 start_sector, uint64 sector_count,
+                   const std::vector<DmaSegment>& segments);
+
+  // Asks the device how many queued commands it supports, and stops using
+  // native command queuing if it doesn't. Interrupts aren't set up yet, so
+  // this polls for the command to finish.
+  void IdentifyDevice();
+
+  // Returns a free command slot, sleeping until one is free if they're all in
+  // use.
+  int AcquireCommandSlot();
+
+  // Builds the command FIS in the slot's command table and issues the command.
+  // The PRDT must already be filled in.
+  void IssueRead(int slot, uint64 start_sector, uint32 sector_count,
+                 int prdt_entries, PendingRead* read);
+
+  // Frees a command slot and wakes up whoever is waiting on it.
+  void CompleteCommandSlot(int slot, bool failed);
+
+  // Restarts the port after an error and fails every outstanding command.
+  void RecoverFromError();
+
+  // Called once a command's deadline has passed. If the command in the slot
+  // still hasn't completed, the port is restarted and its read fails.
+  void MaybeTimeOutCommandSlot(int slot, uint64 command_id);
+
   HbaPort* port_;
   int port_index_;
   uint64 sector_count_;
@@ -45,16 +103,49 @@ class AhciStorageDevice : public ::perception::devices::StorageDevice::Server {
   std::string name_;
   ::perception::devices::StorageDeviceType device_type_;
 
-  // DMA Memory Structures for slot 0
+  // The number of command slots the controller supports.
+  int command_slots_;
+
+  // Are reads queued with READ FPDMA QUEUED? Optical drives don't support
+  // native command queuing.
+  bool use_ncq_;
+
+  // The most commands to have issued at once. With native command queuing,
+  // the slot is the command's tag, so only the slots below the device's queue
+  // depth are used.
+  int queue_depth_;
+
+  // The most sectors a single command may transfer.
+  uint32 max_sectors_per_command_;
+
+  // DMA Memory Structures
   HbaCmdHeader* cmd_list_;
   size_t cmd_list_phys_;
 
   void* fis_base_;
   size_t fis_base_phys_;
 
-  HbaCmdTbl* cmd_tbl_;
-  size_t cmd_tbl_phys_;
+  // A command table for each command slot. Each command table is one page.
+  HbaCmdTbl* cmd_tbls_;
+  std::vector<size_t> cmd_tbl_phys_;
+
+  // A page that unwanted bytes at the start and end of sectors are read into.
+  void* discard_page_;
+  size_t discard_page_phys_;
+
+  // The read that each command slot belongs to.
+  PendingRead* slot_reads_[32];
+
+  // The ID of the command issued in each slot, so a deadline can tell if the
+  // command it was set for is still the one in the slot.
+  uint64 slot_command_ids_[32];
+
+  // The ID to give the next command that's issued.
+  uint64 next_command_id_;
+
+  // Bitmask of command slots that have been issued and haven't completed.
+  uint32 issued_slots_;
 
-  void* dma_buffer_;
-  size_t dma_buffer_phys_;
+  // Fibers waiting for a command slot to become free.
+  std::deque<::perception::Fiber*> fibers_waiting_for_slot_;
 };
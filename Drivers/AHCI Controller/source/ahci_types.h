@@ -26,12 +26,49 @@ constexpr uint32 kAhciPortCmdFre = (1 << 4);
 constexpr uint32 kAhciPortCmdFr = (1 << 14);
 constexpr uint32 kAhciPortCmdCr = (1 << 15);
 
+constexpr uint32 kAhciCapSncq = (1U << 30);  // Supports Native Command Queuing
+constexpr uint32 kAhciCapNcsShift = 8;      // Number of Command Slots - 1
+constexpr uint32 kAhciCapNcsMask = 0x1F;
+
+constexpr uint32 kAhciGhcIe = (1 << 1);   // Interrupt Enable
+constexpr uint32 kAhciGhcAe = (1U << 31);  // AHCI Enable
+
+constexpr uint32 kAhciPortIsDhrs = (1 << 0);   // Device to Host Register FIS
+constexpr uint32 kAhciPortIsPss = (1 << 1);    // PIO Setup FIS
+constexpr uint32 kAhciPortIsDss = (1 << 2);    // DMA Setup FIS
+constexpr uint32 kAhciPortIsSdbs = (1 << 3);   // Set Device Bits FIS
+constexpr uint32 kAhciPortIsDps = (1 << 5);    // Descriptor Processed
+constexpr uint32 kAhciPortIsIfs = (1 << 27);   // Interface Fatal Error
+constexpr uint32 kAhciPortIsHbds = (1 << 28);  // Host Bus Data Error
+constexpr uint32 kAhciPortIsHbfs = (1 << 29);  // Host Bus Fatal Error
+constexpr uint32 kAhciPortIsTfes = (1 << 30);  // Task File Error
+
+// Interrupts that mean the port has stopped processing commands.
+constexpr uint32 kAhciPortIsErrors =
+    kAhciPortIsIfs | kAhciPortIsHbds | kAhciPortIsHbfs | kAhciPortIsTfes;
+
+// Interrupts the driver listens to on each port.
+constexpr uint32 kAhciPortIsEnabled = kAhciPortIsDhrs | kAhciPortIsPss |
+                                      kAhciPortIsDss | kAhciPortIsSdbs |
+                                      kAhciPortIsDps | kAhciPortIsErrors;
+
+constexpr uint32 kAtaStatusErr = 0x01;
+constexpr uint32 kAtaStatusDrq = 0x08;
+constexpr uint32 kAtaStatusBsy = 0x80;
+
 constexpr uint8 kFisTypeRegH2D = 0x27;
 
 constexpr uint8 kAtaCmdReadDmaExt = 0x25;
+constexpr uint8 kAtaCmdReadFpdmaQueued = 0x60;
 constexpr uint8 kAtaCmdWriteDmaExt = 0x35;
 constexpr uint8 kAtaCmdIdentifyDevice = 0xEC;
 
+// Words in the data returned by IDENTIFY DEVICE.
+constexpr int kAtaIdentifyQueueDepth = 75;  // Bits 0-4: Queue depth - 1
+constexpr int kAtaIdentifySataCapabilities = 76;
+constexpr uint16 kAtaIdentifyQueueDepthMask = 0x1F;
+constexpr uint16 kAtaIdentifySataCapabilitiesNcq = (1 << 8);
+
 struct HbaPort {
   volatile uint32 clb;       // 0x00, Command List Base Address, 1K-byte aligned
   volatile uint32 clbu;      // 0x04, Command List Base Address Upper 32 Bits
@@ -113,6 +150,9 @@ struct HbaPrdtEntry {
   uint32 i : 1;     // Interrupt on completion
 };
 
+// The number of PRDT entries that fit in a command table that is one page long.
+constexpr int kAhciMaxPrdtEntries = 248;
+
 struct HbaCmdTbl {
   // 0x00
   uint8 cfis[64];  // Command FIS
@@ -124,8 +164,10 @@ struct HbaCmdTbl {
   uint8 rsv[48];  // Reserved
 
   // 0x80
-  HbaPrdtEntry prdt_entry[1];  // Physical region descriptor table entries
+  // Physical region descriptor table entries
+  HbaPrdtEntry prdt_entry[kAhciMaxPrdtEntries];
 };
+static_assert(sizeof(HbaCmdTbl) == 4096);
 
 struct FisRegH2D {
   uint8 fis_type;  // FIS_TYPE_REG_H2D (0x27)
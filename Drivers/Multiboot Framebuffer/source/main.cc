@@ -12,6 +12,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cstring>
 #include <iostream>
 #include <map>
 #include <set>
@@ -23,6 +24,7 @@
 #include "perception/processes.h"
 #include "perception/scheduler.h"
 #include "perception/shared_memory.h"
+#include "pixel_kernels.h"
 #include "status.h"
 
 namespace graphics = ::perception::devices::graphics;
@@ -38,15 +40,6 @@ using ::perception::SharedMemory;
 using ::perception::StopNotifyingUponProcessTermination;
 using ::perception::devices::GraphicsDevice;
 
-// Beyer ditchering pattern.
-constexpr uint8 kDitheringTable[] = {
-    0,  48, 12, 60, 3,  51, 15, 63, 32, 16, 44, 28, 35, 19, 47, 31,
-    8,  56, 4,  52, 11, 59, 7,  55, 40, 24, 36, 20, 43, 27, 39, 23,
-    2,  50, 14, 62, 1,  49, 13, 61, 34, 18, 46, 30, 33, 17, 46, 29,
-    10, 58, 6,  54, 9,  57, 5,  53, 42, 26, 38, 22, 41, 25, 37, 21};
-
-constexpr int kDitheringTableWidth = 8;
-
 struct Texture {
   // The owner of the texture.
   ProcessId owner;
@@ -68,6 +61,9 @@ struct ProcessInformation {
 
   // Textures owned by this process.
   std::set<uint64> textures;
+
+  // The ring of commands shared with this process, if it has one.
+  std::shared_ptr<SharedMemory> command_buffer;
 };
 
 struct RenderState {
@@ -105,8 +101,49 @@ class FramebufferGraphicsDevice : GraphicsDevice::Server {
                              ProcessId sender) override {
     RenderState render_state;
     // Run each of the commands.
-    for (const auto& command : commands.commands)
+    for (const auto& command : commands.commands) {
+      if (auto packed_command = graphics::PackCommand(command))
+        RunCommand(*packed_command, sender, render_state);
+    }
+    return Status::OK;
+  }
+
+  virtual Status SetCommandBuffer(
+      const graphics::CommandBufferParameters& request,
+      ProcessId sender) override {
+    if (!request.buffer || !request.buffer->Join() ||
+        request.buffer->GetSize() < sizeof(graphics::PackedCommand))
+      return Status::INVALID_ARGUMENT;
+
+    TrackProcess(sender).command_buffer = request.buffer;
+    return Status::OK;
+  }
+
+  virtual Status RunCommandBuffer(
+      const graphics::CommandBufferDoorbell& doorbell,
+      ProcessId sender) override {
+    auto process_information_itr = process_information_.find(sender);
+    if (process_information_itr == process_information_.end() ||
+        !process_information_itr->second.command_buffer)
+      // This process hasn't shared a command buffer with us.
+      return Status::INVALID_ARGUMENT;
+
+    SharedMemory& buffer = *process_information_itr->second.command_buffer;
+    size_t capacity = buffer.GetSize() / sizeof(graphics::PackedCommand);
+    if (doorbell.first_command >= capacity ||
+        doorbell.command_count > capacity)
+      return Status::INVALID_ARGUMENT;
+
+    const auto* commands =
+        static_cast<const graphics::PackedCommand*>(*buffer);
+    RenderState render_state;
+    size_t index = doorbell.first_command;
+    for (uint32 i = 0; i < doorbell.command_count; i++) {
+      // Copy the command out first, because the sender can still write to it.
+      graphics::PackedCommand command = commands[index];
       RunCommand(command, sender, render_state);
+      if (++index == capacity) index = 0;
+    }
     return Status::OK;
   }
 
@@ -123,21 +160,7 @@ class FramebufferGraphicsDevice : GraphicsDevice::Server {
         texture.width * texture.height * 4, SharedMemory::kJoinersCanWrite);
 
     // Record what textures this process owns.
-    auto process_information_itr = process_information_.find(sender);
-    if (process_information_itr == process_information_.end()) {
-      // This process doesn't own any textures.
-      ProcessInformation process_information;
-      // We want to listen for when the process disappears so we
-      // can release all textures that process owns.
-      process_information.on_process_disappear_listener =
-          NotifyUponProcessTermination(sender, [this, sender]() {
-            ReleaseAllResourcesBelongingToProcess(sender);
-          });
-      process_information.textures.insert(texture_id);
-      process_information_[sender] = process_information;
-    } else {
-      process_information_itr->second.textures.insert(texture_id);
-    }
+    TrackProcess(sender).textures.insert(texture_id);
 
     // Send it back to the client.
     graphics::CreateTextureResponse response;
@@ -169,8 +192,9 @@ class FramebufferGraphicsDevice : GraphicsDevice::Server {
       return Status::INVALID_ARGUMENT;
 
     process_information_itr->second.textures.erase(request.id);
-    if (process_information_itr->second.textures.empty()) {
-      // This process owns no more textures. We no longer care about
+    if (process_information_itr->second.textures.empty() &&
+        !process_information_itr->second.command_buffer) {
+      // This process owns no more resources. We no longer care about
       // listening for it it disappears.
       StopNotifyingUponProcessTermination(
           process_information_itr->second.on_process_disappear_listener);
@@ -243,31 +267,40 @@ class FramebufferGraphicsDevice : GraphicsDevice::Server {
   // The process that is allowed to write to the screen.
   ProcessId process_allowed_to_write_to_the_screen_;
 
+  // Returns the information about a process, and starts listening for it to
+  // disappear if we weren't already.
+  ProcessInformation& TrackProcess(ProcessId process) {
+    auto process_information_itr = process_information_.find(process);
+    if (process_information_itr != process_information_.end())
+      return process_information_itr->second;
+
+    ProcessInformation& process_information = process_information_[process];
+    // We want to listen for when the process disappears so we can release
+    // everything that process owns.
+    process_information.on_process_disappear_listener =
+        NotifyUponProcessTermination(process, [this, process]() {
+          ReleaseAllResourcesBelongingToProcess(process);
+        });
+    return process_information;
+  }
+
   // Handles a graphics command
-  void RunCommand(const graphics::Command& graphics_command, ProcessId sender,
-                  RenderState& render_state) {
+  void RunCommand(const graphics::PackedCommand& graphics_command,
+                  ProcessId sender, RenderState& render_state) {
     switch (graphics_command.type) {
       case graphics::Command::Type::SET_DESTINATION_TEXTURE:
-        if (graphics_command.texture_reference) {
-          SetDestinationTexture(sender, graphics_command.texture_reference->id,
-                                render_state);
-        }
+        SetDestinationTexture(sender, graphics_command.texture_id,
+                              render_state);
         break;
       case graphics::Command::Type::SET_SOURCE_TEXTURE:
-        if (graphics_command.texture_reference) {
-          SetSourceTexture(graphics_command.texture_reference->id,
-                           render_state);
-        }
+        SetSourceTexture(graphics_command.texture_id, render_state);
         break;
       case graphics::Command::Type::FILL_RECTANGLE: {
-        if (graphics_command.fill_rectangle_parameters) {
-          const auto& parameters = *graphics_command.fill_rectangle_parameters;
-
-          FillRectangle(parameters.destination.left, parameters.destination.top,
-                        parameters.destination.left + parameters.size.width,
-                        parameters.destination.top + parameters.size.height,
-                        parameters.color, render_state);
-        }
+        FillRectangle(
+            graphics_command.destination_left, graphics_command.destination_top,
+            graphics_command.destination_left + graphics_command.width,
+            graphics_command.destination_top + graphics_command.height,
+            graphics_command.color, render_state);
         break;
       }
       case graphics::Command::Type::COPY_ENTIRE_TEXTURE: {
@@ -293,55 +326,41 @@ class FramebufferGraphicsDevice : GraphicsDevice::Server {
         break;
       }
       case graphics::Command::Type::COPY_TEXTURE_TO_POSITION: {
-        if (graphics_command.position) {
-          const auto& position = *graphics_command.position;
-          BitBlt(sender, render_state,
-                 /*left_source=*/0,
-                 /*top_source=*/0, position.left, position.top,
-                 /*width=*/UINT_MAX,
-                 /*height=*/UINT_MAX,
-                 /*alpha_blend=*/false);
-        }
+        BitBlt(sender, render_state,
+               /*left_source=*/0,
+               /*top_source=*/0, graphics_command.destination_left,
+               graphics_command.destination_top,
+               /*width=*/UINT_MAX,
+               /*height=*/UINT_MAX,
+               /*alpha_blend=*/false);
         break;
       }
       case graphics::Command::Type::
           COPY_TEXTURE_TO_POSITION_WITH_ALPHA_BLENDING: {
-        if (graphics_command.position) {
-          const auto& position = *graphics_command.position;
-          BitBlt(sender, render_state,
-                 /*left_source=*/0,
-                 /*top_source=*/0, position.left, position.top,
-                 /*width=*/UINT_MAX,
-                 /*height=*/UINT_MAX,
-                 /*alpha_blend=*/true);
-        }
+        BitBlt(sender, render_state,
+               /*left_source=*/0,
+               /*top_source=*/0, graphics_command.destination_left,
+               graphics_command.destination_top,
+               /*width=*/UINT_MAX,
+               /*height=*/UINT_MAX,
+               /*alpha_blend=*/true);
         break;
       }
       case graphics::Command::Type::COPY_PART_OF_A_TEXTURE: {
-        if (graphics_command.copy_part_of_texture_parameters) {
-          const auto& parameters =
-              *graphics_command.copy_part_of_texture_parameters;
-
-          BitBlt(sender, render_state, parameters.source.left,
-                 parameters.source.top, parameters.destination.left,
-                 parameters.destination.top, parameters.size.width,
-                 parameters.size.height,
-                 /*alpha_blend=*/false);
-        }
+        BitBlt(sender, render_state, graphics_command.source_left,
+               graphics_command.source_top, graphics_command.destination_left,
+               graphics_command.destination_top, graphics_command.width,
+               graphics_command.height,
+               /*alpha_blend=*/false);
         break;
       }
       case graphics::Command::Type::
           COPY_PART_OF_A_TEXTURE_WITH_ALPHA_BLENDING: {
-        if (graphics_command.copy_part_of_texture_parameters) {
-          const auto& parameters =
-              *graphics_command.copy_part_of_texture_parameters;
-
-          BitBlt(sender, render_state, parameters.source.left,
-                 parameters.source.top, parameters.destination.left,
-                 parameters.destination.top, parameters.size.width,
-                 parameters.size.height,
-                 /*alpha_blend=*/true);
-        }
+        BitBlt(sender, render_state, graphics_command.source_left,
+               graphics_command.source_top, graphics_command.destination_left,
+               graphics_command.destination_top, graphics_command.width,
+               graphics_command.height,
+               /*alpha_blend=*/true);
         break;
       }
     }
@@ -386,15 +405,12 @@ class FramebufferGraphicsDevice : GraphicsDevice::Server {
       render_state.source_texture = &texture_itr->second;
   }
 
-  // Bit blit two textures. The BitBlt functions are inlined. The hope is that
-  // RunCommand() will be HUGE but all the compiler will optimize away dead code
-  // so we'd have a super fast version of each permutation (alpha blend,
-  //    no alpha blending, etc.)
-  inline void BitBlt(ProcessId sender, const RenderState& render_state,
-                     uint32 left_source, uint32 top_source,
-                     uint32 left_destination, uint32 top_destination,
-                     uint32 width_to_copy, uint32 height_to_copy,
-                     bool alpha_blend) {
+  // Bit blit two textures. The pixel format is picked once per call, and each
+  // row is drawn by one of the kernels in pixel_kernels.h.
+  void BitBlt(ProcessId sender, const RenderState& render_state,
+              uint32 left_source, uint32 top_source, uint32 left_destination,
+              uint32 top_destination, uint32 width_to_copy,
+              uint32 height_to_copy, bool alpha_blend) {
     if (render_state.source_texture == nullptr ||
         render_state.destination_texture == nullptr) {
       // Nowhere to copy to/from.
@@ -414,52 +430,14 @@ class FramebufferGraphicsDevice : GraphicsDevice::Server {
         return;
       }
 
-      // Call the BitBlt function based on pixel depth of the
-      // framebuffer. The ordering is the most likely in my opinion)
-      // pixel depths first. We branch on screen_bits_per_pixel_ then
-      // call BitBltToTexture with the same value because we want the
-      // compiler to inline BitBltToTexture with the pixel depth constant
-      // folded.
-      if (screen_bits_per_pixel_ == 24) {
-        BitBltToTexture(
-            (uint8*)**render_state.source_texture->shared_memory,
-            render_state.source_texture->width,
-            render_state.source_texture->height, (uint8*)framebuffer_,
-            screen_width_, screen_height_, screen_pitch_,
-            /*destination_bpp=*/24, left_source, top_source, left_destination,
-            top_destination, width_to_copy, height_to_copy,
-            /*alpha_blend=*/false);
-      } else if (screen_bits_per_pixel_ == 32) {
-        BitBltToTexture(
-            (uint8*)**render_state.source_texture->shared_memory,
-            render_state.source_texture->width,
-            render_state.source_texture->height, (uint8*)framebuffer_,
-            screen_width_, screen_height_, screen_pitch_,
-            /*destination_bpp=*/32, left_source, top_source, left_destination,
-            top_destination, width_to_copy, height_to_copy,
-            /*alpha_blend=*/false);
-      } else if (screen_bits_per_pixel_ == 16) {
-        BitBltToTexture(
-            (uint8*)**render_state.source_texture->shared_memory,
-            render_state.source_texture->width,
-            render_state.source_texture->height, (uint8*)framebuffer_,
-            screen_width_, screen_height_, screen_pitch_,
-            /*destination_bpp=*/16, left_source, top_source, left_destination,
-            top_destination, width_to_copy, height_to_copy,
-            /*alpha_blend=*/false);
-      }
-      if (screen_bits_per_pixel_ == 15) {
-        BitBltToTexture(
-            (uint8*)**render_state.source_texture->shared_memory,
-            render_state.source_texture->width,
-            render_state.source_texture->height, (uint8*)framebuffer_,
-            screen_width_, screen_height_, screen_pitch_,
-            /*destination_bpp=*/15, left_source, top_source, left_destination,
-            top_destination, width_to_copy, height_to_copy,
-            /*alpha_blend=*/false);
-      } else {
-        // Unsupported bits per pixel for the screen.
-      }
+      BitBltToTexture((uint8*)**render_state.source_texture->shared_memory,
+                      render_state.source_texture->width,
+                      render_state.source_texture->height,
+                      (uint8*)framebuffer_, screen_width_, screen_height_,
+                      screen_pitch_, screen_bits_per_pixel_, left_source,
+                      top_source, left_destination, top_destination,
+                      width_to_copy, height_to_copy,
+                      /*alpha_blend=*/false);
     } else {
       // We're writing to another texture.
       BitBltToTexture((uint8*)**render_state.source_texture->shared_memory,
@@ -478,12 +456,14 @@ class FramebufferGraphicsDevice : GraphicsDevice::Server {
 
   // destination_bpp is only used when copying to the framebuffer. Copying to
   // a texture should set it to 0.
-  inline void BitBltToTexture(
-      uint8* source, uint32 source_width, uint32 source_height,
-      uint8* destination, uint32 destination_width, uint32 destination_height,
-      uint32 destination_pitch, uint32 destination_bpp, uint32 left_source,
-      uint32 top_source, uint32 left_destination, uint32 top_destination,
-      uint32 width_to_copy, uint32 height_to_copy, bool alpha_blend) {
+  void BitBltToTexture(uint8* source, uint32 source_width,
+                       uint32 source_height, uint8* destination,
+                       uint32 destination_width, uint32 destination_height,
+                       uint32 destination_pitch, uint32 destination_bpp,
+                       uint32 left_source, uint32 top_source,
+                       uint32 left_destination, uint32 top_destination,
+                       uint32 width_to_copy, uint32 height_to_copy,
+                       bool alpha_blend) {
     if (top_source >= source_height || left_source >= source_width ||
         top_destination >= destination_height ||
         left_destination >= destination_width) {
@@ -509,113 +489,33 @@ class FramebufferGraphicsDevice : GraphicsDevice::Server {
     width_to_copy = std::min(width_to_copy, source_width);
     height_to_copy = std::min(height_to_copy, source_height);
 
-    uint8* source_copy_start =
-        &source[(top_source * source_width + left_source) * 4];
-
-    int bytes_per_pixel;
-    switch (destination_bpp) {
-      case 15:
-      case 16:
-        bytes_per_pixel = 2;
-        break;
-      case 24:
-        bytes_per_pixel = 3;
-        break;
-      case 0:
-      case 32:
-        bytes_per_pixel = 4;
-        break;
+    ConvertRowFunc convert_row = nullptr;
+    if (destination_bpp != 0) {
+      convert_row = ConvertRowFuncForBitsPerPixel(destination_bpp);
+      if (convert_row == nullptr) {
+        // Unsupported bits per pixel for the screen.
+        return;
+      }
     }
+    CopyRowFunc copy_row = alpha_blend ? blend_row_func : copy_row_func;
 
+    const uint8* source_copy_start =
+        &source[(top_source * source_width + left_source) * 4];
     uint8* destination_copy_start =
         &destination[top_destination * destination_pitch +
-                     left_destination * bytes_per_pixel];
-
-    int y = top_destination;
-    // Copy this row.
-    for (; height_to_copy > 0; height_to_copy--, y++) {
-      source = source_copy_start;
-      destination = destination_copy_start;
-      int x = left_destination;
-
-      for (uint32 i = width_to_copy; i > 0; i--, x++) {
-        switch (destination_bpp) {
-          case 0:
-            // 32 bits but to another texture.
-            if (!alpha_blend || source[3] == 0xFF) {
-              *(uint32*)destination = *(uint32*)source;
-            } else if (source[3] > 0) {
-              int alpha = source[3];
-              int inv_alpha = 255 - source[3];
-
-              destination[0] = (uint8)((alpha * (int)source[0] +
-                                        inv_alpha * (int)destination[0]) >>
-                                       8);
-              destination[1] = (uint8)((alpha * (int)source[1] +
-                                        inv_alpha * (int)destination[1]) >>
-                                       8);
-              destination[2] = (uint8)((alpha * (int)source[2] +
-                                        inv_alpha * (int)destination[2]) >>
-                                       8);
-            }
-            destination += 4;
-            break;
-          case 32:
-            destination[0] = source[3];
-            destination[1] = source[0];
-            destination[2] = source[1];
-            destination[3] = source[2];
-            destination += 4;
-            break;
-          case 24:
-            destination[0] = source[0];
-            destination[1] = source[1];
-            destination[2] = source[2];
-            destination += 3;
-            break;
-          case 16: {
-            uint16 dither_val =
-                (uint16)kDitheringTable[x % kDitheringTableWidth +
-                                        (y % kDitheringTableWidth) *
-                                            kDitheringTableWidth];
-            // Trim colors down to 5:6:5-bits.
-            // Beyer color table is 6-bit (0 to 63).
-            // 5-bit color has 32 values (increments of 8).
-            // 6-bit color has 64 values (increments of 4).
-            // We divide the dither value to be in the range of
-            // the color into the next increment.
-            uint16 red =
-                std::min(((uint16)source[0] + dither_val / 8) >> (8 - 5), 31);
-            uint16 green =
-                std::min(((uint16)source[1] + dither_val / 4) >> (8 - 6), 63);
-            uint16 blue =
-                std::min(((uint16)source[2] + dither_val / 8) >> (8 - 5), 31);
-            *(uint16*)destination = (blue << 11) | (green << 5) | red;
-            destination += 2;
-            break;
-          }
-          case 15: {
-            uint16 dither_val =
-                (uint16)kDitheringTable[x % kDitheringTableWidth +
-                                        (y % kDitheringTableWidth) *
-                                            kDitheringTableWidth];
-            // Trim colors down to 5:5:5-bits.
-            uint16 red =
-                std::min(((uint16)source[0] + dither_val / 8) >> (8 - 5), 31);
-            uint16 green =
-                std::min(((uint16)source[1] + dither_val / 8) >> (8 - 5), 31);
-            uint16 blue =
-                std::min(((uint16)source[2] + dither_val / 8) >> (8 - 5), 31);
-
-            *(uint16*)destination = (blue << 10) | (green << 5) | red;
-            destination += 2;
-            break;
-          }
-        }
-        source += 4;
+                     left_destination * BytesPerPixel(destination_bpp)];
+
+    for (uint32 y = top_destination; height_to_copy > 0;
+         height_to_copy--, y++) {
+      if (convert_row != nullptr) {
+        convert_row(destination_copy_start, (const uint32*)source_copy_start,
+                    width_to_copy, left_destination, y);
+      } else {
+        copy_row((uint32*)destination_copy_start,
+                 (const uint32*)source_copy_start, width_to_copy);
       }
 
-      // More the start pointers to the next row.
+      // Move the start pointers to the next row.
       source_copy_start += source_width * 4;
       destination_copy_start += destination_pitch;
     }
@@ -636,37 +536,16 @@ class FramebufferGraphicsDevice : GraphicsDevice::Server {
 
     if (render_state.destination_texture->owner == 0) {
       // Filling to the frame buffer.
-      // Call the FillRectangle function based on pixel depth of the
-      // framebuffer. The ordering is the most likely in my opinion)
-      // pixel depths first. We branch on screen_bits_per_pixel_ then
-      // call FillRectangle with the same value because we want the
-      // compiler to inline FillRectangle with the pixel depth constant
-      // folded.
-      if (screen_bits_per_pixel_ == 24) {
-        FillRectangle(left, right, top, bottom, (uint8*)framebuffer_,
-                      screen_width_, screen_height_, screen_pitch_,
-                      /*destination_bpp=*/24, color,
-                      /*alpha_blend=*/false);
-      } else if (screen_bits_per_pixel_ == 32) {
-        FillRectangle(left, right, top, bottom, (uint8*)framebuffer_,
-                      screen_width_, screen_height_, screen_pitch_,
-                      /*destination_bpp=*/32, color,
-                      /*alpha_blend=*/false);
-      } else if (screen_bits_per_pixel_ == 16) {
-        FillRectangle(left, right, top, bottom, (uint8*)framebuffer_,
-                      screen_width_, screen_height_, screen_pitch_,
-                      /*destination_bpp=*/16, color,
-                      /*alpha_blend=*/false);
-      } else if (screen_bits_per_pixel_ == 15) {
-        FillRectangle(left, right, top, bottom, (uint8*)framebuffer_,
-                      screen_width_, screen_height_, screen_pitch_,
-                      /*destination_bpp=*/15, color,
-                      /*alpha_blend=*/false);
-      } else {
+      if (ConvertRowFuncForBitsPerPixel(screen_bits_per_pixel_) == nullptr) {
         // Unsupported bits per pixel for the screen.
         std::cout << "Unsupported screen bits per pixel: "
                   << (int)screen_bits_per_pixel_ << std::endl;
+        return;
       }
+      FillRectangle(left, right, top, bottom, (uint8*)framebuffer_,
+                    screen_width_, screen_height_, screen_pitch_,
+                    screen_bits_per_pixel_, color,
+                    /*alpha_blend=*/false);
     } else {
       // Filling another texture.
       FillRectangle(left, right, top, bottom,
@@ -680,129 +559,68 @@ class FramebufferGraphicsDevice : GraphicsDevice::Server {
     }
   }
 
-  inline void FillRectangle(uint32 left, uint32 right, uint32 top,
-                            uint32 bottom, uint8* destination,
-                            uint32 destination_width, uint32 destination_height,
-                            uint32 destination_pitch, uint32 destination_bpp,
-                            uint32 color, bool alpha_blend) {
+  void FillRectangle(uint32 left, uint32 right, uint32 top, uint32 bottom,
+                     uint8* destination, uint32 destination_width,
+                     uint32 destination_height, uint32 destination_pitch,
+                     uint32 destination_bpp, uint32 color, bool alpha_blend) {
     uint8* color_channels = (uint8*)&color;
 
-    left = std::max((uint32)0, left);
-    top = std::max((uint32)0, top);
     right = std::min(right, destination_width);
     bottom = std::min(bottom, destination_height);
+    if (left >= right || top >= bottom) {
+      // Nothing to fill.
+      return;
+    }
 
-    if (color_channels[3] == 0xFF || !alpha_blend) {
-      // Completely solid color.
-      int bytes_per_pixel;
-      switch (destination_bpp) {
-        case 15:
-        case 16:
-          bytes_per_pixel = 2;
-          break;
-        case 24:
-          bytes_per_pixel = 3;
-          break;
-        case 0:
-        case 32:
-          bytes_per_pixel = 4;
-          break;
-      }
-
-      uint8* destination_copy_start =
-          &destination[top * destination_pitch + left * bytes_per_pixel];
-      // Copy this row.
-      for (int y = top; y < bottom; y++) {
-        destination = destination_copy_start;
-
-        for (int x = left; x < right; x++) {
-          switch (destination_bpp) {
-            case 0:
-              *(uint32*)destination = color;
-              destination += 4;
-              break;
-            case 32:
-              destination[0] = color_channels[3];
-              destination[1] = color_channels[0];
-              destination[2] = color_channels[1];
-              destination[3] = color_channels[2];
-              destination += 4;
-              break;
-            case 24:
-              destination[0] = color_channels[0];
-              destination[1] = color_channels[1];
-              destination[2] = color_channels[2];
-              destination += 3;
-              break;
-            case 16: {
-              uint16 dither_val =
-                  (uint16)kDitheringTable[x % kDitheringTableWidth +
-                                          (y % kDitheringTableWidth) *
-                                              kDitheringTableWidth];
-              // Trim colors down to 5:6:5-bits.
-              // Beyer color table is 6-bit (0 to 63).
-              // 5-bit color has 32 values (increments of 8).
-              // 6-bit color has 64 values (increments of 4).
-              // We divide the dither value to be in the range of
-              // the color into the next increment.
-              uint16 red = std::min(
-                  ((uint16)color_channels[0] + dither_val / 8) >> (8 - 5), 31);
-              uint16 green = std::min(
-                  ((uint16)color_channels[1] + dither_val / 4) >> (8 - 6), 63);
-              uint16 blue = std::min(
-                  ((uint16)color_channels[2] + dither_val / 8) >> (8 - 5), 31);
-              *(uint16*)destination = (blue << 11) | (green << 5) | red;
-              destination += 2;
-              break;
-            }
-            case 15: {
-              uint16 dither_val =
-                  (uint16)kDitheringTable[x % kDitheringTableWidth +
-                                          (y % kDitheringTableWidth) *
-                                              kDitheringTableWidth];
-              // Trim colors down to 5:5:5-bits.
-              uint16 red = std::min(
-                  ((uint16)color_channels[0] + dither_val / 8) >> (8 - 5), 31);
-              uint16 green = std::min(
-                  ((uint16)color_channels[1] + dither_val / 8) >> (8 - 5), 31);
-              uint16 blue = std::min(
-                  ((uint16)color_channels[2] + dither_val / 8) >> (8 - 5), 31);
-
-              *(uint16*)destination = (blue << 10) | (green << 5) | red;
-              destination += 2;
-              break;
-            }
-          }
+    uint32 width = right - left;
+    uint8* destination_copy_start =
+        &destination[top * destination_pitch +
+                     left * BytesPerPixel(destination_bpp)];
+
+    if (destination_bpp == 0) {
+      // Filling a texture.
+      if (color_channels[3] == 0xFF || !alpha_blend) {
+        // Completely solid color.
+        for (uint32 y = top; y < bottom; y++) {
+          fill_row_func((uint32*)destination_copy_start, color, width);
+          destination_copy_start += destination_pitch;
         }
-
-        // More the start pointers to the next row.
-        destination_copy_start += destination_pitch;
-      }
-    } else {
-      // Alpha blend.
-      int alpha = color_channels[3];
-      int inv_alpha = 255 - color_channels[3];
-
-      int indx = (destination_width * top + left) * 4;
-      int _x, _y;
-      for (_y = top; _y < bottom; _y++) {
-        int next_indx = indx + destination_width * 4;
-        for (_x = left; _x < right; _x++) {
-          destination[indx] = (uint8)((alpha * (int)color_channels[0] +
-                                       inv_alpha * (int)destination[indx]) >>
-                                      8);
-          destination[indx + 1] =
-              (uint8)((alpha * (int)color_channels[1] +
-                       inv_alpha * (int)destination[indx + 1]) >>
-                      8);
-          destination[indx + 2] =
-              (uint8)((alpha * (int)color_channels[2] +
-                       inv_alpha * (int)destination[indx + 2]) >>
-                      8);
-          indx += 4;
+      } else {
+        for (uint32 y = top; y < bottom; y++) {
+          blend_color_row_func((uint32*)destination_copy_start, color, width);
+          destination_copy_start += destination_pitch;
         }
-        indx = next_indx;
       }
+      return;
+    }
+
+    // Filling the framebuffer. The dithering pattern repeats every 8 pixels,
+    // so each row is converted once into a pattern that is then repeated
+    // across the row.
+    ConvertRowFunc convert_row = ConvertRowFuncForBitsPerPixel(destination_bpp);
+    if (convert_row == nullptr) return;
+
+    constexpr uint32 kPatternWidth = 8;
+    uint32 colors[kPatternWidth];
+    for (uint32 i = 0; i < kPatternWidth; i++) colors[i] = color;
+
+    int bytes_per_pixel = BytesPerPixel(destination_bpp);
+    uint32 pattern_size = kPatternWidth * bytes_per_pixel;
+    uint8 pattern[kPatternWidth * 4];
+
+    for (uint32 y = top; y < bottom; y++) {
+      convert_row(pattern, colors, kPatternWidth, left, y);
+
+      uint8* row = destination_copy_start;
+      uint32 bytes_left = width * bytes_per_pixel;
+      while (bytes_left > 0) {
+        uint32 bytes_to_copy = std::min(bytes_left, pattern_size);
+        memcpy(row, pattern, bytes_to_copy);
+        row += bytes_to_copy;
+        bytes_left -= bytes_to_copy;
+      }
+
+      destination_copy_start += destination_pitch;
     }
   }
 
@@ -844,6 +662,7 @@ int main(int argc, char* argv[]) {
     return 0;
   }
 
+  InitializePixelKernels();
   FramebufferGraphicsDevice graphics_driver(physical_address, width, height,
                                             pitch, bpp);
   perception::HandOverControl();
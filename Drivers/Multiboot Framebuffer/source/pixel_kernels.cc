@@ -0,0 +1,678 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pixel_kernels.h"
+
+#include <immintrin.h>
+
+#include <algorithm>
+#include <cstring>
+
+CopyRowFunc copy_row_func = nullptr;
+BlendRowFunc blend_row_func = nullptr;
+FillRowFunc fill_row_func = nullptr;
+BlendColorRowFunc blend_color_row_func = nullptr;
+ConvertRowFunc convert_row_to_32bpp_func = nullptr;
+ConvertRowFunc convert_row_to_24bpp_func = nullptr;
+ConvertRowFunc convert_row_to_16bpp_func = nullptr;
+ConvertRowFunc convert_row_to_15bpp_func = nullptr;
+
+namespace {
+
+// Beyer ditchering pattern.
+constexpr uint8 kDitheringTable[] = {
+    0,  48, 12, 60, 3,  51, 15, 63, 32, 16, 44, 28, 35, 19, 47, 31,
+    8,  56, 4,  52, 11, 59, 7,  55, 40, 24, 36, 20, 43, 27, 39, 23,
+    2,  50, 14, 62, 1,  49, 13, 61, 34, 18, 46, 30, 33, 17, 46, 29,
+    10, 58, 6,  54, 9,  57, 5,  53, 42, 26, 38, 22, 41, 25, 37, 21};
+
+constexpr int kDitheringTableWidth = 8;
+
+inline void GetCpuId(uint32 leaf, uint32 subleaf, uint32* eax, uint32* ebx,
+                     uint32* ecx, uint32* edx) {
+  asm volatile("cpuid"
+               : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx)
+               : "a"(leaf), "c"(subleaf));
+}
+
+inline uint64 GetXcr0() {
+  uint32 eax, edx;
+  asm volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return ((uint64)edx << 32) | eax;
+}
+
+// Returns whether the CPU supports a level of kernels.
+bool IsLevelSupported(PixelKernelLevel level) {
+  uint32 eax = 0, ebx = 0, ecx = 0, edx = 0;
+  GetCpuId(1, 0, &eax, &ebx, &ecx, &edx);
+
+  bool sse2_supported = (edx & (1U << 26)) != 0;
+  bool ssse3_supported = (ecx & (1U << 9)) != 0;
+  bool avx_supported = (ecx & (1U << 28)) != 0;
+  bool osxsave_supported = (ecx & (1U << 27)) != 0;
+
+  bool avx2_supported = false;
+  if (avx_supported) {
+    GetCpuId(7, 0, &eax, &ebx, &ecx, &edx);
+    avx2_supported = (ebx & (1U << 5)) != 0;
+  }
+
+  bool ymm_enabled = false;
+  if (osxsave_supported) {
+    uint64 xcr0 = GetXcr0();
+    ymm_enabled = (xcr0 & 6) == 6;  // XMM bit 1 and YMM bit 2
+  }
+
+  switch (level) {
+    case PixelKernelLevel::SCALAR:
+      return true;
+    case PixelKernelLevel::SSE2:
+      return sse2_supported;
+    case PixelKernelLevel::SSSE3:
+      return sse2_supported && ssse3_supported;
+    case PixelKernelLevel::AVX2:
+      return sse2_supported && ssse3_supported && avx2_supported &&
+             ymm_enabled;
+  }
+  return false;
+}
+
+// Returns the dither value for a pixel on the screen.
+inline uint16 DitherValue(uint32 x, uint32 y) {
+  return kDitheringTable[x % kDitheringTableWidth +
+                         (y % kDitheringTableWidth) * kDitheringTableWidth];
+}
+
+// Fills in how much to add to each channel of 16 pixels in a row, starting at
+// the start of the dithering pattern, before trimming it down to 5 or 6 bits.
+// The pattern repeats every 8 pixels, so 16 lets a vector of up to 8 pixels
+// start anywhere in the pattern.
+void GetDitherAdditions(uint32 y, int green_divisor, uint32* additions) {
+  for (int i = 0; i < 16; i++) {
+    uint32 dither_val = DitherValue(i, y);
+    additions[i] = (dither_val / 8) | ((dither_val / green_divisor) << 8) |
+                   ((dither_val / 8) << 16);
+  }
+}
+
+// Scalar kernels.
+
+void CopyRow_Scalar(uint32* destination, const uint32* source, size_t pixels) {
+  for (size_t i = 0; i < pixels; i++) destination[i] = source[i];
+}
+
+// Blends one channel.
+inline uint8 BlendChannel(int alpha, int source, int destination) {
+  return (uint8)((alpha * source + (255 - alpha) * destination) >> 8);
+}
+
+void BlendRow_Scalar(uint32* destination, const uint32* source,
+                     size_t pixels) {
+  for (size_t i = 0; i < pixels; i++) {
+    const uint8* source_channels = (const uint8*)&source[i];
+    uint8* destination_channels = (uint8*)&destination[i];
+    int alpha = source_channels[3];
+    if (alpha == 0xFF) {
+      destination[i] = source[i];
+    } else if (alpha > 0) {
+      for (int channel = 0; channel < 3; channel++)
+        destination_channels[channel] =
+            BlendChannel(alpha, source_channels[channel],
+                         destination_channels[channel]);
+    }
+  }
+}
+
+void FillRow_Scalar(uint32* destination, uint32 color, size_t pixels) {
+  for (size_t i = 0; i < pixels; i++) destination[i] = color;
+}
+
+void BlendColorRow_Scalar(uint32* destination, uint32 color, size_t pixels) {
+  const uint8* color_channels = (const uint8*)&color;
+  int alpha = color_channels[3];
+  for (size_t i = 0; i < pixels; i++) {
+    uint8* destination_channels = (uint8*)&destination[i];
+    for (int channel = 0; channel < 3; channel++)
+      destination_channels[channel] = BlendChannel(
+          alpha, color_channels[channel], destination_channels[channel]);
+  }
+}
+
+void ConvertRowTo32bpp_Scalar(uint8* destination, const uint32* source,
+                              size_t pixels, uint32, uint32) {
+  uint32* destination_pixels = (uint32*)destination;
+  for (size_t i = 0; i < pixels; i++)
+    destination_pixels[i] = (source[i] << 8) | (source[i] >> 24);
+}
+
+void ConvertRowTo24bpp_Scalar(uint8* destination, const uint32* source,
+                              size_t pixels, uint32, uint32) {
+  for (size_t i = 0; i < pixels; i++) {
+    const uint8* source_channels = (const uint8*)&source[i];
+    destination[0] = source_channels[0];
+    destination[1] = source_channels[1];
+    destination[2] = source_channels[2];
+    destination += 3;
+  }
+}
+
+void ConvertRowTo16bpp_Scalar(uint8* destination, const uint32* source,
+                              size_t pixels, uint32 x, uint32 y) {
+  uint16* destination_pixels = (uint16*)destination;
+  for (size_t i = 0; i < pixels; i++, x++) {
+    const uint8* source_channels = (const uint8*)&source[i];
+    uint16 dither_val = DitherValue(x, y);
+    // Trim colors down to 5:6:5-bits.
+    // Beyer color table is 6-bit (0 to 63).
+    // 5-bit color has 32 values (increments of 8).
+    // 6-bit color has 64 values (increments of 4).
+    // We divide the dither value to be in the range of
+    // the color into the next increment.
+    uint16 red =
+        std::min(((uint16)source_channels[0] + dither_val / 8) >> (8 - 5), 31);
+    uint16 green =
+        std::min(((uint16)source_channels[1] + dither_val / 4) >> (8 - 6), 63);
+    uint16 blue =
+        std::min(((uint16)source_channels[2] + dither_val / 8) >> (8 - 5), 31);
+    destination_pixels[i] = (blue << 11) | (green << 5) | red;
+  }
+}
+
+void ConvertRowTo15bpp_Scalar(uint8* destination, const uint32* source,
+                              size_t pixels, uint32 x, uint32 y) {
+  uint16* destination_pixels = (uint16*)destination;
+  for (size_t i = 0; i < pixels; i++, x++) {
+    const uint8* source_channels = (const uint8*)&source[i];
+    uint16 dither_val = DitherValue(x, y);
+    // Trim colors down to 5:5:5-bits.
+    uint16 red =
+        std::min(((uint16)source_channels[0] + dither_val / 8) >> (8 - 5), 31);
+    uint16 green =
+        std::min(((uint16)source_channels[1] + dither_val / 8) >> (8 - 5), 31);
+    uint16 blue =
+        std::min(((uint16)source_channels[2] + dither_val / 8) >> (8 - 5), 31);
+    destination_pixels[i] = (blue << 10) | (green << 5) | red;
+  }
+}
+
+// SSE2 kernels (4 pixels per iteration).
+
+__attribute__((target("sse2"))) void CopyRow_SSE2(uint32* destination,
+                                                  const uint32* source,
+                                                  size_t pixels) {
+  size_t i = 0;
+  for (; i + 4 <= pixels; i += 4)
+    _mm_storeu_si128(
+        reinterpret_cast<__m128i*>(&destination[i]),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(&source[i])));
+  CopyRow_Scalar(destination + i, source + i, pixels - i);
+}
+
+// Blends 4 source pixels over 4 destination pixels.
+__attribute__((target("sse2"))) inline __m128i BlendPixels_SSE2(__m128i source,
+                                                                __m128i destination) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i alpha_mask = _mm_set1_epi32(0xFF000000);
+  const __m128i all_255 = _mm_set1_epi16(255);
+
+  __m128i source_lo = _mm_unpacklo_epi8(source, zero);
+  __m128i source_hi = _mm_unpackhi_epi8(source, zero);
+  __m128i destination_lo = _mm_unpacklo_epi8(destination, zero);
+  __m128i destination_hi = _mm_unpackhi_epi8(destination, zero);
+
+  // Copy each pixel's alpha into all of its channels.
+  __m128i alpha_lo = _mm_shufflehi_epi16(
+      _mm_shufflelo_epi16(source_lo, _MM_SHUFFLE(3, 3, 3, 3)),
+      _MM_SHUFFLE(3, 3, 3, 3));
+  __m128i alpha_hi = _mm_shufflehi_epi16(
+      _mm_shufflelo_epi16(source_hi, _MM_SHUFFLE(3, 3, 3, 3)),
+      _MM_SHUFFLE(3, 3, 3, 3));
+
+  // (alpha * source + (255 - alpha) * destination) >> 8, which can't
+  // overflow 16 bits.
+  __m128i blended_lo = _mm_srli_epi16(
+      _mm_add_epi16(
+          _mm_mullo_epi16(source_lo, alpha_lo),
+          _mm_mullo_epi16(destination_lo, _mm_sub_epi16(all_255, alpha_lo))),
+      8);
+  __m128i blended_hi = _mm_srli_epi16(
+      _mm_add_epi16(
+          _mm_mullo_epi16(source_hi, alpha_hi),
+          _mm_mullo_epi16(destination_hi, _mm_sub_epi16(all_255, alpha_hi))),
+      8);
+  __m128i blended = _mm_packus_epi16(blended_lo, blended_hi);
+
+  // Keep the destination's alpha.
+  blended = _mm_or_si128(_mm_andnot_si128(alpha_mask, blended),
+                         _mm_and_si128(alpha_mask, destination));
+
+  // Opaque pixels are copied and transparent pixels are skipped.
+  __m128i source_alpha = _mm_and_si128(source, alpha_mask);
+  __m128i opaque = _mm_cmpeq_epi32(source_alpha, alpha_mask);
+  __m128i transparent = _mm_cmpeq_epi32(source_alpha, zero);
+  blended = _mm_or_si128(_mm_and_si128(opaque, source),
+                         _mm_andnot_si128(opaque, blended));
+  return _mm_or_si128(_mm_and_si128(transparent, destination),
+                      _mm_andnot_si128(transparent, blended));
+}
+
+__attribute__((target("sse2"))) void BlendRow_SSE2(uint32* destination,
+                                                   const uint32* source,
+                                                   size_t pixels) {
+  size_t i = 0;
+  for (; i + 4 <= pixels; i += 4) {
+    __m128i source_pixels =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(&source[i]));
+    __m128i destination_pixels =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(&destination[i]));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&destination[i]),
+                     BlendPixels_SSE2(source_pixels, destination_pixels));
+  }
+  BlendRow_Scalar(destination + i, source + i, pixels - i);
+}
+
+__attribute__((target("sse2"))) void FillRow_SSE2(uint32* destination,
+                                                  uint32 color, size_t pixels) {
+  __m128i color_pixels = _mm_set1_epi32(color);
+  size_t i = 0;
+  for (; i + 4 <= pixels; i += 4)
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&destination[i]),
+                     color_pixels);
+  FillRow_Scalar(destination + i, color, pixels - i);
+}
+
+__attribute__((target("sse2"))) void BlendColorRow_SSE2(uint32* destination,
+                                                        uint32 color,
+                                                        size_t pixels) {
+  // The color's alpha is never 0 or 255, so every pixel is blended.
+  __m128i color_pixels = _mm_set1_epi32(color);
+  size_t i = 0;
+  for (; i + 4 <= pixels; i += 4) {
+    __m128i destination_pixels =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(&destination[i]));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&destination[i]),
+                     BlendPixels_SSE2(color_pixels, destination_pixels));
+  }
+  BlendColorRow_Scalar(destination + i, color, pixels - i);
+}
+
+__attribute__((target("sse2"))) void ConvertRowTo32bpp_SSE2(
+    uint8* destination, const uint32* source, size_t pixels, uint32 x,
+    uint32 y) {
+  uint32* destination_pixels = (uint32*)destination;
+  size_t i = 0;
+  for (; i + 4 <= pixels; i += 4) {
+    __m128i source_pixels =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(&source[i]));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&destination_pixels[i]),
+                     _mm_or_si128(_mm_slli_epi32(source_pixels, 8),
+                                  _mm_srli_epi32(source_pixels, 24)));
+  }
+  ConvertRowTo32bpp_Scalar(destination + i * 4, source + i, pixels - i, x + i,
+                           y);
+}
+
+// Trims 4 pixels, that have had the dithering added, down to 5:6:5 or 5:5:5
+// bits, in the low 16 bits of each 32-bit lane.
+template <bool kIs16bpp>
+__attribute__((target("sse2"))) inline __m128i TrimPixels_SSE2(
+    __m128i pixels) {
+  __m128i red = _mm_srli_epi32(_mm_and_si128(pixels, _mm_set1_epi32(0xFF)), 3);
+  if (kIs16bpp) {
+    __m128i green =
+        _mm_and_si128(_mm_srli_epi32(pixels, 10), _mm_set1_epi32(0x3F));
+    __m128i blue =
+        _mm_and_si128(_mm_srli_epi32(pixels, 19), _mm_set1_epi32(0x1F));
+    return _mm_or_si128(
+        red, _mm_or_si128(_mm_slli_epi32(green, 5), _mm_slli_epi32(blue, 11)));
+  } else {
+    __m128i green =
+        _mm_and_si128(_mm_srli_epi32(pixels, 11), _mm_set1_epi32(0x1F));
+    __m128i blue =
+        _mm_and_si128(_mm_srli_epi32(pixels, 19), _mm_set1_epi32(0x1F));
+    return _mm_or_si128(
+        red, _mm_or_si128(_mm_slli_epi32(green, 5), _mm_slli_epi32(blue, 10)));
+  }
+}
+
+// Converts to 16 or 15 bits per pixel, 8 pixels per iteration. Adding the
+// dithering with unsigned saturation clamps each channel the same way the
+// scalar kernel does.
+template <bool kIs16bpp>
+__attribute__((target("sse2"))) void ConvertRowToDithered_SSE2(
+    uint8* destination, const uint32* source, size_t pixels, uint32 x,
+    uint32 y) {
+  uint32 additions[16];
+  GetDitherAdditions(y, kIs16bpp ? 4 : 8, additions);
+
+  uint16* destination_pixels = (uint16*)destination;
+  size_t i = 0;
+  for (; i + 8 <= pixels; i += 8) {
+    // 8 pixels later is the same place in the pattern.
+    const uint32* pixel_additions = &additions[(x + i) % kDitheringTableWidth];
+    __m128i first = _mm_adds_epu8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(&source[i])),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixel_additions)));
+    __m128i second = _mm_adds_epu8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(&source[i + 4])),
+        _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(pixel_additions + 4)));
+    first = TrimPixels_SSE2<kIs16bpp>(first);
+    second = TrimPixels_SSE2<kIs16bpp>(second);
+    // Sign extend so the signed pack keeps all 16 bits.
+    first = _mm_srai_epi32(_mm_slli_epi32(first, 16), 16);
+    second = _mm_srai_epi32(_mm_slli_epi32(second, 16), 16);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&destination_pixels[i]),
+                     _mm_packs_epi32(first, second));
+  }
+  if (kIs16bpp) {
+    ConvertRowTo16bpp_Scalar(destination + i * 2, source + i, pixels - i,
+                             x + i, y);
+  } else {
+    ConvertRowTo15bpp_Scalar(destination + i * 2, source + i, pixels - i,
+                             x + i, y);
+  }
+}
+
+// SSSE3 kernels, for where byte shuffles help.
+
+__attribute__((target("ssse3"))) void ConvertRowTo32bpp_SSSE3(
+    uint8* destination, const uint32* source, size_t pixels, uint32 x,
+    uint32 y) {
+  const __m128i shuffle =
+      _mm_setr_epi8(3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14);
+  uint32* destination_pixels = (uint32*)destination;
+  size_t i = 0;
+  for (; i + 4 <= pixels; i += 4) {
+    __m128i source_pixels =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(&source[i]));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&destination_pixels[i]),
+                     _mm_shuffle_epi8(source_pixels, shuffle));
+  }
+  ConvertRowTo32bpp_Scalar(destination + i * 4, source + i, pixels - i, x + i,
+                           y);
+}
+
+__attribute__((target("ssse3"))) void ConvertRowTo24bpp_SSSE3(
+    uint8* destination, const uint32* source, size_t pixels, uint32 x,
+    uint32 y) {
+  // Drops the alpha, packing 4 pixels into the low 12 bytes.
+  const __m128i shuffle =
+      _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+  size_t i = 0;
+  for (; i + 4 <= pixels; i += 4) {
+    __m128i packed = _mm_shuffle_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(&source[i])),
+        shuffle);
+    uint8* row = destination + i * 3;
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(row), packed);
+    uint32 last_4_bytes = (uint32)_mm_cvtsi128_si32(_mm_srli_si128(packed, 8));
+    memcpy(row + 8, &last_4_bytes, 4);
+  }
+  ConvertRowTo24bpp_Scalar(destination + i * 3, source + i, pixels - i, x + i,
+                           y);
+}
+
+// AVX2 kernels (8 pixels per iteration).
+
+__attribute__((target("avx2"))) void CopyRow_AVX2(uint32* destination,
+                                                  const uint32* source,
+                                                  size_t pixels) {
+  size_t i = 0;
+  for (; i + 8 <= pixels; i += 8)
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i*>(&destination[i]),
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&source[i])));
+  CopyRow_Scalar(destination + i, source + i, pixels - i);
+}
+
+// Blends 8 source pixels over 8 destination pixels. The same as
+// BlendPixels_SSE2, with each 128-bit lane done separately.
+__attribute__((target("avx2"))) inline __m256i BlendPixels_AVX2(
+    __m256i source, __m256i destination) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i alpha_mask = _mm256_set1_epi32(0xFF000000);
+  const __m256i all_255 = _mm256_set1_epi16(255);
+
+  __m256i source_lo = _mm256_unpacklo_epi8(source, zero);
+  __m256i source_hi = _mm256_unpackhi_epi8(source, zero);
+  __m256i destination_lo = _mm256_unpacklo_epi8(destination, zero);
+  __m256i destination_hi = _mm256_unpackhi_epi8(destination, zero);
+
+  __m256i alpha_lo = _mm256_shufflehi_epi16(
+      _mm256_shufflelo_epi16(source_lo, _MM_SHUFFLE(3, 3, 3, 3)),
+      _MM_SHUFFLE(3, 3, 3, 3));
+  __m256i alpha_hi = _mm256_shufflehi_epi16(
+      _mm256_shufflelo_epi16(source_hi, _MM_SHUFFLE(3, 3, 3, 3)),
+      _MM_SHUFFLE(3, 3, 3, 3));
+
+  __m256i blended_lo = _mm256_srli_epi16(
+      _mm256_add_epi16(_mm256_mullo_epi16(source_lo, alpha_lo),
+                       _mm256_mullo_epi16(destination_lo,
+                                          _mm256_sub_epi16(all_255, alpha_lo))),
+      8);
+  __m256i blended_hi = _mm256_srli_epi16(
+      _mm256_add_epi16(_mm256_mullo_epi16(source_hi, alpha_hi),
+                       _mm256_mullo_epi16(destination_hi,
+                                          _mm256_sub_epi16(all_255, alpha_hi))),
+      8);
+  __m256i blended = _mm256_packus_epi16(blended_lo, blended_hi);
+
+  blended = _mm256_blendv_epi8(blended, destination, alpha_mask);
+
+  __m256i source_alpha = _mm256_and_si256(source, alpha_mask);
+  blended = _mm256_blendv_epi8(blended, source,
+                               _mm256_cmpeq_epi32(source_alpha, alpha_mask));
+  return _mm256_blendv_epi8(blended, destination,
+                            _mm256_cmpeq_epi32(source_alpha, zero));
+}
+
+__attribute__((target("avx2"))) void BlendRow_AVX2(uint32* destination,
+                                                   const uint32* source,
+                                                   size_t pixels) {
+  size_t i = 0;
+  for (; i + 8 <= pixels; i += 8) {
+    __m256i source_pixels =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&source[i]));
+    __m256i destination_pixels =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&destination[i]));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(&destination[i]),
+                        BlendPixels_AVX2(source_pixels, destination_pixels));
+  }
+  BlendRow_SSE2(destination + i, source + i, pixels - i);
+}
+
+__attribute__((target("avx2"))) void FillRow_AVX2(uint32* destination,
+                                                  uint32 color, size_t pixels) {
+  __m256i color_pixels = _mm256_set1_epi32(color);
+  size_t i = 0;
+  for (; i + 8 <= pixels; i += 8)
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(&destination[i]),
+                        color_pixels);
+  FillRow_Scalar(destination + i, color, pixels - i);
+}
+
+__attribute__((target("avx2"))) void BlendColorRow_AVX2(uint32* destination,
+                                                        uint32 color,
+                                                        size_t pixels) {
+  __m256i color_pixels = _mm256_set1_epi32(color);
+  size_t i = 0;
+  for (; i + 8 <= pixels; i += 8) {
+    __m256i destination_pixels =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&destination[i]));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(&destination[i]),
+                        BlendPixels_AVX2(color_pixels, destination_pixels));
+  }
+  BlendColorRow_SSE2(destination + i, color, pixels - i);
+}
+
+__attribute__((target("avx2"))) void ConvertRowTo32bpp_AVX2(
+    uint8* destination, const uint32* source, size_t pixels, uint32 x,
+    uint32 y) {
+  const __m256i shuffle = _mm256_setr_epi8(
+      3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14, 3, 0, 1, 2, 7, 4,
+      5, 6, 11, 8, 9, 10, 15, 12, 13, 14);
+  uint32* destination_pixels = (uint32*)destination;
+  size_t i = 0;
+  for (; i + 8 <= pixels; i += 8) {
+    __m256i source_pixels =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&source[i]));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(&destination_pixels[i]),
+                        _mm256_shuffle_epi8(source_pixels, shuffle));
+  }
+  ConvertRowTo32bpp_Scalar(destination + i * 4, source + i, pixels - i, x + i,
+                           y);
+}
+
+// Trims 8 pixels down to 5:6:5 or 5:5:5 bits. The same as TrimPixels_SSE2.
+template <bool kIs16bpp>
+__attribute__((target("avx2"))) inline __m256i TrimPixels_AVX2(
+    __m256i pixels) {
+  __m256i red =
+      _mm256_srli_epi32(_mm256_and_si256(pixels, _mm256_set1_epi32(0xFF)), 3);
+  __m256i blue =
+      _mm256_and_si256(_mm256_srli_epi32(pixels, 19), _mm256_set1_epi32(0x1F));
+  if (kIs16bpp) {
+    __m256i green = _mm256_and_si256(_mm256_srli_epi32(pixels, 10),
+                                     _mm256_set1_epi32(0x3F));
+    return _mm256_or_si256(red,
+                           _mm256_or_si256(_mm256_slli_epi32(green, 5),
+                                           _mm256_slli_epi32(blue, 11)));
+  } else {
+    __m256i green = _mm256_and_si256(_mm256_srli_epi32(pixels, 11),
+                                     _mm256_set1_epi32(0x1F));
+    return _mm256_or_si256(red,
+                           _mm256_or_si256(_mm256_slli_epi32(green, 5),
+                                           _mm256_slli_epi32(blue, 10)));
+  }
+}
+
+// Converts to 16 or 15 bits per pixel, 16 pixels per iteration.
+template <bool kIs16bpp>
+__attribute__((target("avx2"))) void ConvertRowToDithered_AVX2(
+    uint8* destination, const uint32* source, size_t pixels, uint32 x,
+    uint32 y) {
+  uint32 additions[16];
+  GetDitherAdditions(y, kIs16bpp ? 4 : 8, additions);
+
+  uint16* destination_pixels = (uint16*)destination;
+  size_t i = 0;
+  for (; i + 16 <= pixels; i += 16) {
+    // Both halves start at the same place in the pattern.
+    __m256i pixel_additions = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(
+        &additions[(x + i) % kDitheringTableWidth]));
+    __m256i first = _mm256_adds_epu8(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&source[i])),
+        pixel_additions);
+    __m256i second = _mm256_adds_epu8(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&source[i + 8])),
+        pixel_additions);
+    // Packing works within each 128-bit lane, so put the lanes back in order
+    // afterwards.
+    __m256i packed =
+        _mm256_packus_epi32(TrimPixels_AVX2<kIs16bpp>(first),
+                            TrimPixels_AVX2<kIs16bpp>(second));
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i*>(&destination_pixels[i]),
+        _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0)));
+  }
+  ConvertRowToDithered_SSE2<kIs16bpp>(destination + i * 2, source + i,
+                                      pixels - i, x + i, y);
+}
+
+}  // namespace
+
+void InitializePixelKernels() {
+  for (PixelKernelLevel level :
+       {PixelKernelLevel::AVX2, PixelKernelLevel::SSSE3, PixelKernelLevel::SSE2,
+        PixelKernelLevel::SCALAR}) {
+    if (UsePixelKernels(level)) return;
+  }
+}
+
+bool UsePixelKernels(PixelKernelLevel level) {
+  if (!IsLevelSupported(level)) return false;
+
+  switch (level) {
+    case PixelKernelLevel::SCALAR:
+      copy_row_func = CopyRow_Scalar;
+      blend_row_func = BlendRow_Scalar;
+      fill_row_func = FillRow_Scalar;
+      blend_color_row_func = BlendColorRow_Scalar;
+      convert_row_to_32bpp_func = ConvertRowTo32bpp_Scalar;
+      convert_row_to_24bpp_func = ConvertRowTo24bpp_Scalar;
+      convert_row_to_16bpp_func = ConvertRowTo16bpp_Scalar;
+      convert_row_to_15bpp_func = ConvertRowTo15bpp_Scalar;
+      break;
+    case PixelKernelLevel::SSE2:
+      copy_row_func = CopyRow_SSE2;
+      blend_row_func = BlendRow_SSE2;
+      fill_row_func = FillRow_SSE2;
+      blend_color_row_func = BlendColorRow_SSE2;
+      convert_row_to_32bpp_func = ConvertRowTo32bpp_SSE2;
+      convert_row_to_24bpp_func = ConvertRowTo24bpp_Scalar;
+      convert_row_to_16bpp_func = ConvertRowToDithered_SSE2<true>;
+      convert_row_to_15bpp_func = ConvertRowToDithered_SSE2<false>;
+      break;
+    case PixelKernelLevel::SSSE3:
+      copy_row_func = CopyRow_SSE2;
+      blend_row_func = BlendRow_SSE2;
+      fill_row_func = FillRow_SSE2;
+      blend_color_row_func = BlendColorRow_SSE2;
+      convert_row_to_32bpp_func = ConvertRowTo32bpp_SSSE3;
+      convert_row_to_24bpp_func = ConvertRowTo24bpp_SSSE3;
+      convert_row_to_16bpp_func = ConvertRowToDithered_SSE2<true>;
+      convert_row_to_15bpp_func = ConvertRowToDithered_SSE2<false>;
+      break;
+    case PixelKernelLevel::AVX2:
+      copy_row_func = CopyRow_AVX2;
+      blend_row_func = BlendRow_AVX2;
+      fill_row_func = FillRow_AVX2;
+      blend_color_row_func = BlendColorRow_AVX2;
+      convert_row_to_32bpp_func = ConvertRowTo32bpp_AVX2;
+      // Packing 24-bit pixels doesn't get any faster with wider vectors.
+      convert_row_to_24bpp_func = ConvertRowTo24bpp_SSSE3;
+      convert_row_to_16bpp_func = ConvertRowToDithered_AVX2<true>;
+      convert_row_to_15bpp_func = ConvertRowToDithered_AVX2<false>;
+      break;
+  }
+  return true;
+}
+
+ConvertRowFunc ConvertRowFuncForBitsPerPixel(uint8 bits_per_pixel) {
+  switch (bits_per_pixel) {
+    case 32:
+      return convert_row_to_32bpp_func;
+    case 24:
+      return convert_row_to_24bpp_func;
+    case 16:
+      return convert_row_to_16bpp_func;
+    case 15:
+      return convert_row_to_15bpp_func;
+    default:
+      return nullptr;
+  }
+}
+
+int BytesPerPixel(uint8 bits_per_pixel) {
+  switch (bits_per_pixel) {
+    case 15:
+    case 16:
+      return 2;
+    case 24:
+      return 3;
+    default:
+      return 4;
+  }
+}
@@ -0,0 +1,71 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "types.h"
+
+// Kernels that draw one row of pixels. The pixel format is picked once per
+// rectangle by picking the kernel, so nothing branches on it per pixel.
+//
+// Textures are 32 bits per pixel, with the alpha in the highest byte. Alpha
+// blending isn't premultiplied, and leaves the destination's alpha alone.
+
+// Copies a row of pixels between textures.
+using CopyRowFunc = void (*)(uint32* destination, const uint32* source,
+                             size_t pixels);
+
+// Alpha blends a row of pixels onto a texture.
+using BlendRowFunc = void (*)(uint32* destination, const uint32* source,
+                              size_t pixels);
+
+// Fills a row of a texture with a color.
+using FillRowFunc = void (*)(uint32* destination, uint32 color, size_t pixels);
+
+// Alpha blends a color onto a row of a texture. The color's alpha must be
+// between 1 and 254.
+using BlendColorRowFunc = void (*)(uint32* destination, uint32 color,
+                                   size_t pixels);
+
+// Converts a row of texture pixels into the framebuffer's format. `x` and `y`
+// are where the row starts on the screen, which lower bit depths dither by.
+using ConvertRowFunc = void (*)(uint8* destination, const uint32* source,
+                                size_t pixels, uint32 x, uint32 y);
+
+extern CopyRowFunc copy_row_func;
+extern BlendRowFunc blend_row_func;
+extern FillRowFunc fill_row_func;
+extern BlendColorRowFunc blend_color_row_func;
+extern ConvertRowFunc convert_row_to_32bpp_func;
+extern ConvertRowFunc convert_row_to_24bpp_func;
+extern ConvertRowFunc convert_row_to_16bpp_func;
+extern ConvertRowFunc convert_row_to_15bpp_func;
+
+// The instruction sets the kernels can be built from.
+enum class PixelKernelLevel { SCALAR, SSE2, SSSE3, AVX2 };
+
+// Points the kernels at the fastest versions this CPU supports.
+void InitializePixelKernels();
+
+// Points the kernels at a specific version. Returns false, and leaves the
+// kernels alone, if this CPU doesn't support it.
+bool UsePixelKernels(PixelKernelLevel level);
+
+// Returns the kernel for converting into a framebuffer format, or nullptr if
+// the format isn't supported.
+ConvertRowFunc ConvertRowFuncForBitsPerPixel(uint8 bits_per_pixel);
+
+// Returns the number of bytes each pixel takes up in a framebuffer format, or
+// in a texture if `bits_per_pixel` is 0.
+int BytesPerPixel(uint8 bits_per_pixel);
@@ -0,0 +1,179 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pixel_kernels.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "testing.h"
+
+namespace {
+
+constexpr PixelKernelLevel kLevels[] = {
+    PixelKernelLevel::SCALAR, PixelKernelLevel::SSE2, PixelKernelLevel::SSSE3,
+    PixelKernelLevel::AVX2};
+
+constexpr const char* kLevelNames[] = {"Scalar", "SSE2", "SSSE3", "AVX2"};
+
+constexpr uint8 kFramebufferFormats[] = {32, 24, 16, 15};
+
+// Returns pixels with a spread of colors and alphas, including fully
+// transparent and fully opaque ones.
+std::vector<uint32> MakePixels(size_t count, uint32 seed) {
+  std::vector<uint32> pixels(count);
+  uint32 state = seed;
+  for (size_t i = 0; i < count; i++) {
+    state = state * 1664525 + 1013904223;
+    pixels[i] = state;
+    if (i % 5 == 0) pixels[i] |= 0xFF000000;
+    if (i % 7 == 0) pixels[i] &= 0x00FFFFFF;
+  }
+  return pixels;
+}
+
+// What every kernel wrote for the same inputs.
+struct KernelResults {
+  std::vector<uint32> copied;
+  std::vector<uint32> blended;
+  std::vector<uint32> filled;
+  std::vector<uint32> color_blended;
+  std::vector<std::vector<uint8>> converted;
+};
+
+// Runs every kernel over a row of `pixels` pixels.
+KernelResults RunKernels(size_t pixels, uint32 x, uint32 y) {
+  std::vector<uint32> source = MakePixels(pixels, 1);
+  std::vector<uint32> destination = MakePixels(pixels, 2);
+
+  KernelResults results;
+  results.copied = destination;
+  copy_row_func(results.copied.data(), source.data(), pixels);
+
+  results.blended = destination;
+  blend_row_func(results.blended.data(), source.data(), pixels);
+
+  results.filled = destination;
+  fill_row_func(results.filled.data(), 0xFF336699, pixels);
+
+  results.color_blended = destination;
+  blend_color_row_func(results.color_blended.data(), 0x80C0FFEE, pixels);
+
+  for (uint8 bits_per_pixel : kFramebufferFormats) {
+    std::vector<uint8> converted(pixels * BytesPerPixel(bits_per_pixel) + 1,
+                                 0xAB);
+    ConvertRowFuncForBitsPerPixel(bits_per_pixel)(converted.data(),
+                                                  source.data(), pixels, x, y);
+    results.converted.push_back(std::move(converted));
+  }
+  return results;
+}
+
+TEST(PixelKernelsMatchScalar) {
+  for (size_t pixels : {0, 1, 3, 4, 7, 8, 15, 16, 17, 33, 100}) {
+    for (uint32 x : {0, 3, 5}) {
+      for (uint32 y : {0, 6}) {
+        ASSERT(true, UsePixelKernels(PixelKernelLevel::SCALAR));
+        KernelResults expected = RunKernels(pixels, x, y);
+
+        for (PixelKernelLevel level : kLevels) {
+          if (!UsePixelKernels(level)) continue;
+          KernelResults actual = RunKernels(pixels, x, y);
+          EXPECT(true, expected.copied == actual.copied);
+          EXPECT(true, expected.blended == actual.blended);
+          EXPECT(true, expected.filled == actual.filled);
+          EXPECT(true, expected.color_blended == actual.color_blended);
+          EXPECT(true, expected.converted == actual.converted);
+        }
+      }
+    }
+  }
+  InitializePixelKernels();
+}
+
+TEST(PixelKernelsConvertToScreenFormats) {
+  ASSERT(true, UsePixelKernels(PixelKernelLevel::SCALAR));
+  uint32 pixel = 0x80FF4020;
+
+  uint32 converted_32bpp;
+  convert_row_to_32bpp_func((uint8*)&converted_32bpp, &pixel, 1, 0, 0);
+  EXPECT((uint32)0xFF402080, converted_32bpp);
+
+  uint8 converted_24bpp[3];
+  convert_row_to_24bpp_func(converted_24bpp, &pixel, 1, 0, 0);
+  EXPECT((uint8)0x20, converted_24bpp[0]);
+  EXPECT((uint8)0x40, converted_24bpp[1]);
+  EXPECT((uint8)0xFF, converted_24bpp[2]);
+
+  // The first dither value is 0, so the channels are only trimmed.
+  uint16 converted_16bpp;
+  convert_row_to_16bpp_func((uint8*)&converted_16bpp, &pixel, 1, 0, 0);
+  EXPECT((uint16)((31 << 11) | (0x10 << 5) | 0x04), converted_16bpp);
+
+  uint16 converted_15bpp;
+  convert_row_to_15bpp_func((uint8*)&converted_15bpp, &pixel, 1, 0, 0);
+  EXPECT((uint16)((31 << 10) | (0x08 << 5) | 0x04), converted_15bpp);
+
+  InitializePixelKernels();
+}
+
+TEST(PixelKernelsBenchmark) {
+  constexpr size_t kWidth = 1920;
+  constexpr size_t kRows = 200;
+  std::vector<uint32> source = MakePixels(kWidth, 1);
+  std::vector<uint32> destination = MakePixels(kWidth, 2);
+  std::vector<uint8> framebuffer(kWidth * 4);
+
+  // Runs a kernel over kRows rows and returns how many millions of pixels it
+  // drew each second.
+  auto measure = [&](auto draw_row) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t y = 0; y < kRows; y++) draw_row(y);
+    std::chrono::duration<double> seconds =
+        std::chrono::steady_clock::now() - start;
+    return (double)(kWidth * kRows) / seconds.count() / 1000000.0;
+  };
+
+  std::cout << "Mpixels/s per kernel:" << std::endl;
+  for (int i = 0; i < 4; i++) {
+    if (!UsePixelKernels(kLevels[i])) continue;
+    std::cout << "  " << kLevelNames[i] << std::endl;
+    std::cout << "    Copy: " << measure([&](size_t) {
+      copy_row_func(destination.data(), source.data(), kWidth);
+    }) << std::endl;
+    std::cout << "    Blend: " << measure([&](size_t) {
+      blend_row_func(destination.data(), source.data(), kWidth);
+    }) << std::endl;
+    std::cout << "    Fill: " << measure([&](size_t) {
+      fill_row_func(destination.data(), 0xFF336699, kWidth);
+    }) << std::endl;
+    std::cout << "    Blend color: " << measure([&](size_t) {
+      blend_color_row_func(destination.data(), 0x80C0FFEE, kWidth);
+    }) << std::endl;
+    for (uint8 bits_per_pixel : kFramebufferFormats) {
+      ConvertRowFunc convert_row = ConvertRowFuncForBitsPerPixel(bits_per_pixel);
+      std::cout << "    Convert to " << (int)bits_per_pixel
+                << "bpp: " << measure([&](size_t y) {
+                     convert_row(framebuffer.data(), source.data(), kWidth, 0,
+                                 y);
+                   })
+                << std::endl;
+    }
+  }
+  InitializePixelKernels();
+}
+
+}  // namespace
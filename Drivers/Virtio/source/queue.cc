@@ -55,31 +55,8 @@ constexpr size_t kCommonCfgSize = 64;
 
 void* AllocateContiguousMemoryPages(size_t pages, size_t& physical_address) {
   if (pages == 0) return nullptr;
-  int attempts = 32;
-  while (attempts-- > 0) {
-    void* virt_addr = AllocateMemoryPagesBelowPhysicalAddressBase(
-        pages, kMax32BitAddress, physical_address);
-    if (!virt_addr) return nullptr;
-    if (pages == 1) return virt_addr;
-
-    size_t phys0 = GetPhysicalAddressOfVirtualAddress((size_t)virt_addr);
-    bool contiguous = true;
-    for (size_t i = 1; i < pages; i++) {
-      if (GetPhysicalAddressOfVirtualAddress(
-              (size_t)virt_addr + i * kPageSize) != phys0 + i * kPageSize) {
-        contiguous = false;
-        break;
-      }
-    }
-
-    if (contiguous) {
-      physical_address = phys0;
-      return virt_addr;
-    }
-
-    ReleaseMemoryPages(virt_addr, pages);
-  }
-  return nullptr;
+  return ::perception::AllocateContiguousMemoryPages(pages, kMax32BitAddress,
+                                                     physical_address);
 }
 
 void QueueDetails::Setup(uint16 queue_idx, uint16 io_base) {
@@ -14,6 +14,7 @@
 
 #include "virtio_graphics_driver.h"
 
+#include <algorithm>
 #include <cstring>
 
 #include "perception/cache.h"
@@ -292,9 +293,47 @@ Status VirtioGraphicsDriver::RunCommands(const graphics::Commands& commands,
                                          ProcessId sender) {
   RenderState render_state;
   bool screen_modified = false;
-  for (const auto& command : commands.commands)
+  for (const auto& command : commands.commands) {
+    if (auto packed_command = graphics::PackCommand(command))
+      RunCommand(*packed_command, sender, render_state, screen_modified);
+  }
+  if (screen_modified) FlushDamagedAreas(commands.damaged_areas);
+  return Status::OK;
+}
+
+Status VirtioGraphicsDriver::SetCommandBuffer(
+    const graphics::CommandBufferParameters& request, ProcessId sender) {
+  if (!request.buffer || !request.buffer->Join() ||
+      request.buffer->GetSize() < sizeof(graphics::PackedCommand))
+    return Status::INVALID_ARGUMENT;
+
+  TrackProcess(sender).command_buffer = request.buffer;
+  return Status::OK;
+}
+
+Status VirtioGraphicsDriver::RunCommandBuffer(
+    const graphics::CommandBufferDoorbell& doorbell, ProcessId sender) {
+  auto process_information_itr = process_information_.find(sender);
+  if (process_information_itr == process_information_.end() ||
+      !process_information_itr->second.command_buffer)
+    return Status::INVALID_ARGUMENT;
+
+  SharedMemory& buffer = *process_information_itr->second.command_buffer;
+  size_t capacity = buffer.GetSize() / sizeof(graphics::PackedCommand);
+  if (doorbell.first_command >= capacity || doorbell.command_count > capacity)
+    return Status::INVALID_ARGUMENT;
+
+  const auto* commands = static_cast<const graphics::PackedCommand*>(*buffer);
+  RenderState render_state;
+  bool screen_modified = false;
+  size_t index = doorbell.first_command;
+  for (uint32 i = 0; i < doorbell.command_count; i++) {
+    // Copy the command out first, because the sender can still write to it.
+    graphics::PackedCommand command = commands[index];
     RunCommand(command, sender, render_state, screen_modified);
-  if (screen_modified) FlushScreen();
+    if (++index == capacity) index = 0;
+  }
+  if (screen_modified) FlushDamagedAreas(doorbell.damaged_areas);
   return Status::OK;
 }
 
@@ -309,18 +348,7 @@ StatusOr<graphics::CreateTextureResponse> VirtioGraphicsDriver::CreateTexture(
       SharedMemory::FromSize(texture.width * texture.height * kBytesPerPixel,
                              SharedMemory::kJoinersCanWrite);
 
-  auto process_information_itr = process_information_.find(sender);
-  if (process_information_itr == process_information_.end()) {
-    ProcessInformation process_information;
-    process_information.on_process_disappear_listener =
-        NotifyUponProcessTermination(sender, [this, sender]() {
-          ReleaseAllResourcesBelongingToProcess(sender);
-        });
-    process_information.textures.insert(texture_id);
-    process_information_[sender] = process_information;
-  } else {
-    process_information_itr->second.textures.insert(texture_id);
-  }
+  TrackProcess(sender).textures.insert(texture_id);
 
   graphics::CreateTextureResponse response;
   response.texture.id = texture_id;
@@ -346,7 +374,8 @@ Status VirtioGraphicsDriver::DestroyTexture(
   }
 
   process_information_itr->second.textures.erase(request.id);
-  if (process_information_itr->second.textures.empty()) {
+  if (process_information_itr->second.textures.empty() &&
+      !process_information_itr->second.command_buffer) {
     StopNotifyingUponProcessTermination(
         process_information_itr->second.on_process_disappear_listener);
     process_information_.erase(process_information_itr);
@@ -381,33 +410,25 @@ StatusOr<graphics::Size> VirtioGraphicsDriver::GetScreenSize() {
   return response;
 }
 
-void VirtioGraphicsDriver::RunCommand(const graphics::Command& graphics_command,
-                                      ProcessId sender,
-                                      RenderState& render_state,
-                                      bool& screen_modified) {
+void VirtioGraphicsDriver::RunCommand(
+    const graphics::PackedCommand& graphics_command, ProcessId sender,
+    RenderState& render_state, bool& screen_modified) {
   switch (graphics_command.type) {
     case graphics::Command::Type::SET_DESTINATION_TEXTURE:
-      if (graphics_command.texture_reference) {
-        SetDestinationTexture(sender, graphics_command.texture_reference->id,
-                              render_state);
-      }
+      SetDestinationTexture(sender, graphics_command.texture_id, render_state);
       break;
     case graphics::Command::Type::SET_SOURCE_TEXTURE:
-      if (graphics_command.texture_reference) {
-        SetSourceTexture(graphics_command.texture_reference->id, render_state);
-      }
+      SetSourceTexture(graphics_command.texture_id, render_state);
       break;
     case graphics::Command::Type::FILL_RECTANGLE: {
-      if (graphics_command.fill_rectangle_parameters) {
-        const auto& parameters = *graphics_command.fill_rectangle_parameters;
-        FillRectangle(parameters.destination.left, parameters.destination.top,
-                      parameters.destination.left + parameters.size.width,
-                      parameters.destination.top + parameters.size.height,
-                      parameters.color, render_state);
-        if (render_state.destination_texture &&
-            render_state.destination_texture->owner == 0) {
-          screen_modified = true;
-        }
+      FillRectangle(
+          graphics_command.destination_left, graphics_command.destination_top,
+          graphics_command.destination_left + graphics_command.width,
+          graphics_command.destination_top + graphics_command.height,
+          graphics_command.color, render_state);
+      if (render_state.destination_texture &&
+          render_state.destination_texture->owner == 0) {
+        screen_modified = true;
       }
       break;
     }
@@ -428,63 +449,63 @@ void VirtioGraphicsDriver::RunCommand(const graphics::Command& graphics_command,
       break;
     }
     case graphics::Command::Type::COPY_TEXTURE_TO_POSITION: {
-      if (graphics_command.position) {
-        const auto& position = *graphics_command.position;
-        BitBlt(sender, render_state, 0, 0, position.left, position.top,
-               UINT_MAX, UINT_MAX, false);
-        if (render_state.destination_texture &&
-            render_state.destination_texture->owner == 0) {
-          screen_modified = true;
-        }
+      BitBlt(sender, render_state, 0, 0, graphics_command.destination_left,
+             graphics_command.destination_top, UINT_MAX, UINT_MAX, false);
+      if (render_state.destination_texture &&
+          render_state.destination_texture->owner == 0) {
+        screen_modified = true;
       }
       break;
     }
     case graphics::Command::Type::
         COPY_TEXTURE_TO_POSITION_WITH_ALPHA_BLENDING: {
-      if (graphics_command.position) {
-        const auto& position = *graphics_command.position;
-        BitBlt(sender, render_state, 0, 0, position.left, position.top,
-               UINT_MAX, UINT_MAX, true);
-        if (render_state.destination_texture &&
-            render_state.destination_texture->owner == 0) {
-          screen_modified = true;
-        }
+      BitBlt(sender, render_state, 0, 0, graphics_command.destination_left,
+             graphics_command.destination_top, UINT_MAX, UINT_MAX, true);
+      if (render_state.destination_texture &&
+          render_state.destination_texture->owner == 0) {
+        screen_modified = true;
       }
       break;
     }
     case graphics::Command::Type::COPY_PART_OF_A_TEXTURE: {
-      if (graphics_command.copy_part_of_texture_parameters) {
-        const auto& parameters =
-            *graphics_command.copy_part_of_texture_parameters;
-        BitBlt(sender, render_state, parameters.source.left,
-               parameters.source.top, parameters.destination.left,
-               parameters.destination.top, parameters.size.width,
-               parameters.size.height, false);
-        if (render_state.destination_texture &&
-            render_state.destination_texture->owner == 0) {
-          screen_modified = true;
-        }
+      BitBlt(sender, render_state, graphics_command.source_left,
+             graphics_command.source_top, graphics_command.destination_left,
+             graphics_command.destination_top, graphics_command.width,
+             graphics_command.height, false);
+      if (render_state.destination_texture &&
+          render_state.destination_texture->owner == 0) {
+        screen_modified = true;
       }
       break;
     }
     case graphics::Command::Type::COPY_PART_OF_A_TEXTURE_WITH_ALPHA_BLENDING: {
-      if (graphics_command.copy_part_of_texture_parameters) {
-        const auto& parameters =
-            *graphics_command.copy_part_of_texture_parameters;
-        BitBlt(sender, render_state, parameters.source.left,
-               parameters.source.top, parameters.destination.left,
-               parameters.destination.top, parameters.size.width,
-               parameters.size.height, true);
-        if (render_state.destination_texture &&
-            render_state.destination_texture->owner == 0) {
-          screen_modified = true;
-        }
+      BitBlt(sender, render_state, graphics_command.source_left,
+             graphics_command.source_top, graphics_command.destination_left,
+             graphics_command.destination_top, graphics_command.width,
+             graphics_command.height, true);
+      if (render_state.destination_texture &&
+          render_state.destination_texture->owner == 0) {
+        screen_modified = true;
       }
       break;
     }
   }
 }
 
+VirtioGraphicsDriver::ProcessInformation& VirtioGraphicsDriver::TrackProcess(
+    ProcessId process) {
+  auto process_information_itr = process_information_.find(process);
+  if (process_information_itr != process_information_.end())
+    return process_information_itr->second;
+
+  ProcessInformation& process_information = process_information_[process];
+  process_information.on_process_disappear_listener =
+      NotifyUponProcessTermination(process, [this, process]() {
+        ReleaseAllResourcesBelongingToProcess(process);
+      });
+  return process_information;
+}
+
 void VirtioGraphicsDriver::SetDestinationTexture(ProcessId sender,
                                                  uint64 texture_id,
                                                  RenderState& render_state) {
@@ -678,19 +699,48 @@ void VirtioGraphicsDriver::ReleaseAllResourcesBelongingToProcess(
   process_information_.erase(process_information_itr);
 }
 
+void VirtioGraphicsDriver::FlushDamagedAreas(
+    const std::vector<graphics::Rectangle>& damaged_areas) {
+  if (damaged_areas.empty()) {
+    FlushScreen();
+    return;
+  }
+  // Only transfer and flush what changed.
+  for (const auto& area : damaged_areas)
+    FlushArea(area.origin.left, area.origin.top, area.size.width,
+              area.size.height);
+}
+
 void VirtioGraphicsDriver::FlushScreen() {
+  FlushArea(0, 0, screen_width_, screen_height_);
+}
+
+void VirtioGraphicsDriver::FlushArea(uint32 left, uint32 top, uint32 width,
+                                     uint32 height) {
   if (!framebuffer_) return;
-  FlushRange(framebuffer_, screen_width_ * screen_height_ * kBytesPerPixel);
+  if (left >= screen_width_ || top >= screen_height_) return;
+  width = std::min(width, screen_width_ - left);
+  height = std::min(height, screen_height_ - top);
+  if (width == 0 || height == 0) return;
+
+  // The rows of the area are one span of the framebuffer, from the first
+  // pixel of the first row to the last pixel of the last row.
+  size_t first_byte =
+      (static_cast<size_t>(top) * screen_width_ + left) * kBytesPerPixel;
+  size_t last_byte =
+      (static_cast<size_t>(top + height - 1) * screen_width_ + left + width) *
+      kBytesPerPixel;
+  FlushRange(framebuffer_ + first_byte, last_byte - first_byte);
 
   VirtioGpuTransferToHost2d transfer;
   memset(&transfer, 0, sizeof(transfer));
   transfer.hdr.type =
       kVirtioGpuCmdTransferToHost2d;  // VIRTIO_GPU_CMD_TRANSFER_TO_HOST_2D
-  transfer.r.x = 0;
-  transfer.r.y = 0;
-  transfer.r.width = screen_width_;
-  transfer.r.height = screen_height_;
-  transfer.offset = 0;
+  transfer.r.x = left;
+  transfer.r.y = top;
+  transfer.r.width = width;
+  transfer.r.height = height;
+  transfer.offset = first_byte;
   transfer.resource_id = kScanoutResourceId;
 
   VirtioGpuCtrlHdr resp_hdr;
@@ -699,10 +749,10 @@ void VirtioGraphicsDriver::FlushScreen() {
   VirtioGpuResourceFlush flush;
   memset(&flush, 0, sizeof(flush));
   flush.hdr.type = kVirtioGpuCmdResourceFlush;  // VIRTIO_GPU_CMD_RESOURCE_FLUSH
-  flush.r.x = 0;
-  flush.r.y = 0;
-  flush.r.width = screen_width_;
-  flush.r.height = screen_height_;
+  flush.r.x = left;
+  flush.r.y = top;
+  flush.r.width = width;
+  flush.r.height = height;
   flush.resource_id = kScanoutResourceId;
 
   SendCommand(&flush, sizeof(flush), &resp_hdr, sizeof(resp_hdr));
@@ -17,6 +17,7 @@
 #include <memory>
 #include <mutex>
 #include <set>
+#include <vector>
 
 #include "driver.h"
 #include "perception/devices/device_manager.h"
@@ -61,6 +62,14 @@ class VirtioGraphicsDriver : public perception::devices::GraphicsDevice::Server,
       const perception::devices::GraphicsListener::Client& listener)
       override;
 
+  virtual Status SetCommandBuffer(
+      const perception::devices::graphics::CommandBufferParameters& request,
+      perception::ProcessId sender) override;
+
+  virtual Status RunCommandBuffer(
+      const perception::devices::graphics::CommandBufferDoorbell& doorbell,
+      perception::ProcessId sender) override;
+
  private:
   struct Texture {
     perception::ProcessId owner;
@@ -72,6 +81,7 @@ class VirtioGraphicsDriver : public perception::devices::GraphicsDevice::Server,
   struct ProcessInformation {
     perception::MessageId on_process_disappear_listener;
     std::set<uint64> textures;
+    std::shared_ptr<perception::SharedMemory> command_buffer;
   };
 
   struct RenderState {
@@ -80,10 +90,14 @@ class VirtioGraphicsDriver : public perception::devices::GraphicsDevice::Server,
   };
 
   void RunCommand(
-      const perception::devices::graphics::Command& graphics_command,
+      const perception::devices::graphics::PackedCommand& graphics_command,
       perception::ProcessId sender, RenderState& render_state,
       bool& screen_modified);
 
+  // Returns the information about a process, and starts listening for it to
+  // disappear if we weren't already.
+  ProcessInformation& TrackProcess(perception::ProcessId process);
+
   void SetDestinationTexture(perception::ProcessId sender, uint64 texture_id,
                              RenderState& render_state);
 
@@ -107,8 +121,17 @@ class VirtioGraphicsDriver : public perception::devices::GraphicsDevice::Server,
 
   void ReleaseAllResourcesBelongingToProcess(perception::ProcessId process);
 
+  // Presents the damaged areas, or the whole screen if there are none.
+  void FlushDamagedAreas(
+      const std::vector<perception::devices::graphics::Rectangle>&
+          damaged_areas);
+
+  // Presents the whole screen.
   void FlushScreen();
 
+  // Presents an area of the screen. The area is clipped to the screen.
+  void FlushArea(uint32 left, uint32 top, uint32 width, uint32 height);
+
   void CreateScanoutResource();
 
   void HandleInterrupt();
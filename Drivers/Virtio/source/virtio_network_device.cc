@@ -14,6 +14,7 @@
 
 #include "virtio_network_device.h"
 
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 #include <mutex>
@@ -26,6 +27,7 @@
 #include "perception/pci.h"
 #include "perception/permissions.h"
 #include "perception/port_io.h"
+#include "perception/shared_memory.h"
 #include "queue.h"
 #include "types.h"
 
@@ -36,9 +38,17 @@ using ::perception::Permission;
 using ::perception::ProcessId;
 using ::perception::Read16BitsFromPort;
 using ::perception::Read8BitsFromPort;
+using ::perception::devices::kMaxPacketRingPacketSize;
+using ::perception::devices::kPacketBufferHeadroom;
+using ::perception::devices::kPacketBufferSize;
+using ::perception::devices::kPacketRingSize;
 using ::perception::devices::MacAddress;
 using ::perception::devices::NetworkListener;
 using ::perception::devices::Packet;
+using ::perception::devices::PacketRing;
+using ::perception::devices::PacketRingEntry;
+using ::perception::devices::PacketRingHeader;
+using ::perception::devices::PacketRingParameters;
 using ::perception::devices::PciDevice;
 
 namespace {
@@ -50,6 +60,7 @@ constexpr uint16 kRxQueueIndex = 0;
 constexpr uint16 kTxQueueIndex = 1;
 constexpr uint32 kRxBufferSize = 4096;
 constexpr uint16 kVringDescFWrite = 2;
+constexpr uint16 kVringAvailFNoInterrupt = 1;
 constexpr size_t kVirtioNetHeaderSize = 10;
 constexpr size_t kMaxPacketDataSize = 4000;
 constexpr size_t kQueueMemoryFlushSize = 12288;
@@ -58,6 +69,9 @@ constexpr size_t kAvailRingElementSize = 2;
 constexpr uint8 kIsrReadMask = 1;
 constexpr uint16 kVirtioPciIsr = 19;
 
+static_assert(kVirtioNetHeaderSize <= kPacketBufferHeadroom);
+static_assert(kRxBufferSize <= kPacketBufferSize);
+
 }  // namespace
 
 VirtioNetworkDevice::VirtioNetworkDevice(const PciDevice& device)
@@ -95,9 +109,16 @@ VirtioNetworkDevice::VirtioNetworkDevice(const PciDevice& device)
   __asm__ __volatile__("" ::: "memory");
   rx_queue_.avail->idx = rx_queue_.size;
   __asm__ __volatile__("" ::: "memory");
+  rx_next_avail_ = rx_queue_.size;
 
   FlushRange((void*)rx_queue_.avail, kPageSize);
 
+  // Every transmit descriptor starts out free.
+  for (int i = tx_queue_.size - 1; i >= 0; i--)
+    free_tx_descriptors_.push_back(i);
+  std::fill(std::begin(tx_descriptor_entries_),
+            std::end(tx_descriptor_entries_), -1);
+
   // Initial RX queue notification
   virtio_pci_.KickQueue(rx_queue_);
 
@@ -124,46 +145,30 @@ Status VirtioNetworkDevice::SendPacket(const Packet& packet, ProcessId sender) {
   if (!DoesProcessHavePermission(sender, Permission::CanUseNetworkDevice))
     return Status::NOT_ALLOWED;
 
+  size_t data_len = packet.data.length();
+  if (data_len > kMaxPacketDataSize) return Status::INVALID_ARGUMENT;
+
   std::lock_guard<std::mutex> lock(tx_mutex_);
-  // Reclaim completed transmit descriptors from device.
-  tx_queue_.last_seen_used = tx_queue_.used->idx;
+  ReclaimTxDescriptors();
 
   // Check if transmit queue is full.
-  uint16 tx_outstanding = tx_queue_.avail->idx - tx_queue_.last_seen_used;
-  if (tx_outstanding >= tx_queue_.size) {
+  std::optional<uint16> desc_idx = AllocateTxDescriptor();
+  if (!desc_idx) {
     std::cout << "Transmit Queue is full!" << std::endl;
     return Status::OUT_OF_MEMORY;
   }
 
-  // Get the next descriptor slot index.
-  uint16 desc_idx = tx_queue_.avail->idx % tx_queue_.size;
-  size_t data_len = packet.data.length();
-  if (data_len > kMaxPacketDataSize) return Status::INVALID_ARGUMENT;
-
   // Prepare descriptor buffer (Prepend 10-byte VirtioNetHeader + Packet Data).
-  uint8* tx_buf = (uint8*)tx_queue_.buffers_virt[desc_idx];
+  uint8* tx_buf = (uint8*)tx_queue_.buffers_virt[*desc_idx];
   memset(tx_buf, 0, kVirtioNetHeaderSize);
   memcpy(tx_buf + kVirtioNetHeaderSize, packet.data.data(), data_len);
 
-  tx_queue_.desc[desc_idx].addr = tx_queue_.buffers_phys[desc_idx];
-  tx_queue_.desc[desc_idx].len = kVirtioNetHeaderSize + data_len;
-  tx_queue_.desc[desc_idx].flags = 0;  // Read-only by device.
-  tx_queue_.desc[desc_idx].next = 0;
-
-  // Make descriptor available.
-  tx_queue_.avail->ring[tx_queue_.avail->idx % tx_queue_.size] = desc_idx;
-
-  // Flush descriptors and available ring entries first.
-  FlushRange(tx_queue_.mem, kQueueMemoryFlushSize);
-  // Flush packet data payload as well.
+  // Flush packet data payload.
   FlushRange(tx_buf, kVirtioNetHeaderSize + data_len);
 
-  __asm__ __volatile__("" ::: "memory");
-  tx_queue_.avail->idx++;
-  __asm__ __volatile__("" ::: "memory");
-
-  // Flush the updated index.
-  FlushRange(tx_queue_.avail, kPageSize);
+  tx_descriptor_entries_[*desc_idx] = -1;
+  SubmitTxDescriptor(*desc_idx, tx_queue_.buffers_phys[*desc_idx],
+                     kVirtioNetHeaderSize + data_len);
 
   // Notify queue 1 (TX).
   virtio_pci_.KickQueue(tx_queue_);
@@ -180,6 +185,65 @@ Status VirtioNetworkDevice::SetPacketListener(
   return Status::OK;
 }
 
+StatusOr<PacketRingParameters> VirtioNetworkDevice::CreatePacketRing(
+    ProcessId sender) {
+  if (!DoesProcessHavePermission(sender, Permission::CanUseNetworkDevice))
+    return Status::NOT_ALLOWED;
+
+  if (!packet_ring_) {
+    auto packet_ring = PacketRing::Create();
+    if (!packet_ring) return Status::OUT_OF_MEMORY;
+
+    // The device reads and writes the buffers directly.
+    auto& shared_memory = *packet_ring->GetSharedMemory();
+    for (size_t i = 0; i < kPacketRingSize; i++) {
+      auto rx_phys =
+          shared_memory.GetPhysicalAddress(PacketRing::RxBufferOffset(i));
+      auto tx_phys =
+          shared_memory.GetPhysicalAddress(PacketRing::TxBufferOffset(i));
+      if (!rx_phys || !tx_phys) return Status::INTERNAL_ERROR;
+      rx_buffers_phys_[i] = *rx_phys;
+      tx_buffers_phys_[i] = *tx_phys;
+    }
+
+    packet_ring_ = std::move(packet_ring);
+    packet_ring_owner_ = sender;
+  } else if (sender != packet_ring_owner_) {
+    // Only one process can own the ring.
+    return Status::NOT_ALLOWED;
+  }
+
+  PacketRingParameters response;
+  response.ring = packet_ring_->GetSharedMemory();
+  return response;
+}
+
+Status VirtioNetworkDevice::TransmitPackets(ProcessId sender) {
+  if (!packet_ring_ || sender != packet_ring_owner_) return Status::NOT_ALLOWED;
+
+  std::lock_guard<std::mutex> lock(tx_mutex_);
+  ReclaimTxDescriptors();
+  SubmitQueuedTxEntries();
+  return Status::OK;
+}
+
+Status VirtioNetworkDevice::ReceivedPacketsConsumed(ProcessId sender) {
+  if (!packet_ring_ || sender != packet_ring_owner_) return Status::NOT_ALLOWED;
+
+  // Turn receive interrupts back on before looking for packets that arrived
+  // while they were off, so none are missed.
+  packet_ring_->ReceivedPacketsDoorbellAnswered();
+  rx_queue_.avail->flags = 0;
+  FlushRange((void*)rx_queue_.avail, kAvailRingHeaderSize);
+
+  if (!processing_interrupt_) {
+    processing_interrupt_ = true;
+    ReceivePackets();
+    processing_interrupt_ = false;
+  }
+  return Status::OK;
+}
+
 void VirtioNetworkDevice::HandleInterrupt() {
   if (processing_interrupt_) return;
   processing_interrupt_ = true;
@@ -188,17 +252,53 @@ void VirtioNetworkDevice::HandleInterrupt() {
   if (virtio_pci_.io_base() != 0)
     (void)Read8BitsFromPort(virtio_pci_.io_base() + kVirtioPciIsr);
 
-  // Flush both virtual queues to ensure it is read fresh used ring idx values
+  ReceivePackets();
+
+  {
+    std::lock_guard<std::mutex> lock(tx_mutex_);
+    ReclaimTxDescriptors();
+    if (packet_ring_) SubmitQueuedTxEntries();
+  }
+
+  processing_interrupt_ = false;
+}
+
+void VirtioNetworkDevice::ReceivePackets() {
+  // Flush the virtual queue to ensure it is read fresh used ring idx values
   // from physical RAM.
   FlushRange(rx_queue_.mem, kQueueMemoryFlushSize);
-  FlushRange(tx_queue_.mem, kQueueMemoryFlushSize);
+  FlushRange((void*)rx_queue_.used, kPageSize);
+
+  if (packet_ring_) RecycleConsumedRxBuffers();
 
-  // Process received packets
-  uint16 new_idx = rx_queue_.avail->idx;
   while (rx_queue_.last_seen_used != rx_queue_.used->idx) {
     uint16 ring_idx = rx_queue_.last_seen_used % rx_queue_.size;
     uint32 desc_idx = rx_queue_.used->ring[ring_idx].id;
-    uint32 len = rx_queue_.used->ring[ring_idx].len;
+    uint32 len =
+        std::min((uint32)rx_queue_.used->ring[ring_idx].len, kRxBufferSize);
+    rx_queue_.last_seen_used++;
+    if (desc_idx >= rx_queue_.size) continue;
+
+    if (packet_ring_ && desc_idx < kPacketRingSize) {
+      // The packet stays in the ring buffer until the listener consumes it.
+      uint8* buffer = packet_ring_->RxBuffer(desc_idx);
+      if (!rx_descriptor_uses_ring_[desc_idx])
+        memcpy(buffer, rx_queue_.buffers_virt[desc_idx], len);
+
+      if (len > kVirtioNetHeaderSize) {
+        PacketRingHeader& header = packet_ring_->Header();
+        uint32 produced = header.rx_produced.load(std::memory_order_relaxed);
+        header.rx[produced % kPacketRingSize] = PacketRingEntry{
+            .buffer = (uint16)desc_idx,
+            .offset = (uint16)kVirtioNetHeaderSize,
+            .length = (uint32)(len - kVirtioNetHeaderSize)};
+        rx_entry_descriptors_[produced % kPacketRingSize] = desc_idx;
+        header.rx_produced.store(produced + 1, std::memory_order_release);
+      } else {
+        RecycleRxDescriptor(desc_idx);
+      }
+      continue;
+    }
 
     // Skip the 10-byte VirtioNetHeader when unpacking packet payload
     if (len > kVirtioNetHeaderSize) {
@@ -212,29 +312,161 @@ void VirtioNetworkDevice::HandleInterrupt() {
       }
     }
 
-    // Recycle descriptor slot back to available ring.
-    rx_queue_.avail->ring[new_idx % rx_queue_.size] = desc_idx;
-    new_idx++;
+    // Descriptors without a packet ring buffer are retired once there's a
+    // packet ring.
+    if (!packet_ring_) RecycleRxDescriptor(desc_idx);
+  }
 
-    rx_queue_.last_seen_used++;
+  // Ring for anything the listener hasn't consumed, not only what was just
+  // received. Transmit interrupts share the handler, so packets can be
+  // received while the doorbell is rung.
+  if (packet_ring_ && listener_.IsValid() &&
+      packet_ring_->RingReceivedPacketsDoorbell()) {
+    // Leave receive interrupts off until the listener has caught up, and
+    // poll for more packets then, so a burst of packets costs one doorbell
+    // rather than one interrupt and message each.
+    rx_queue_.avail->flags = kVringAvailFNoInterrupt;
+    listener_.PacketsReceived([](Status) {});
   }
 
   // Flush RX Available ring changes (the ring entries, before we update idx).
-  FlushRange(rx_queue_.avail,
+  FlushRange((void*)rx_queue_.avail,
              kAvailRingHeaderSize + rx_queue_.size * kAvailRingElementSize);
 
+  if (rx_queue_.avail->idx == rx_next_avail_) return;
+
   __asm__ __volatile__("" ::: "memory");
-  rx_queue_.avail->idx = new_idx;
+  rx_queue_.avail->idx = rx_next_avail_;
   __asm__ __volatile__("" ::: "memory");
 
   // Flush RX Available ring index.
-  FlushRange(rx_queue_.avail, kPageSize);
+  FlushRange((void*)rx_queue_.avail, kPageSize);
 
   // Notify queue 0 (RX) of newly available recycled descriptors.
   virtio_pci_.KickQueue(rx_queue_);
+}
+
+void VirtioNetworkDevice::RecycleRxDescriptor(uint16 desc_idx) {
+  if (packet_ring_ && desc_idx < kPacketRingSize) {
+    rx_queue_.desc[desc_idx].addr = rx_buffers_phys_[desc_idx];
+    rx_descriptor_uses_ring_[desc_idx] = true;
+  }
 
-  // Reclaim finished transmit descriptors.
-  tx_queue_.last_seen_used = tx_queue_.used->idx;
+  // Recycle descriptor slot back to available ring.
+  rx_queue_.avail->ring[rx_next_avail_ % rx_queue_.size] = desc_idx;
+  rx_next_avail_++;
+}
 
-  processing_interrupt_ = false;
+void VirtioNetworkDevice::RecycleConsumedRxBuffers() {
+  PacketRingHeader& header = packet_ring_->Header();
+  uint32 consumed = header.rx_consumed.load(std::memory_order_acquire);
+  uint32 produced = header.rx_produced.load(std::memory_order_relaxed);
+
+  // The listener can write anything into the ring, so never recycle past what
+  // was produced.
+  if (consumed - rx_recycled_ > produced - rx_recycled_) return;
+
+  for (; rx_recycled_ != consumed; rx_recycled_++)
+    RecycleRxDescriptor(rx_entry_descriptors_[rx_recycled_ % kPacketRingSize]);
+}
+
+void VirtioNetworkDevice::ReclaimTxDescriptors() {
+  FlushRange((void*)tx_queue_.used, kPageSize);
+
+  while (tx_queue_.last_seen_used != tx_queue_.used->idx) {
+    uint16 ring_idx = tx_queue_.last_seen_used % tx_queue_.size;
+    uint32 desc_idx = tx_queue_.used->ring[ring_idx].id;
+    tx_queue_.last_seen_used++;
+    if (desc_idx >= tx_queue_.size) continue;
+
+    int slot = tx_descriptor_entries_[desc_idx];
+    if (slot >= 0) tx_entry_done_[slot] = true;
+    free_tx_descriptors_.push_back(desc_idx);
+  }
+
+  if (!packet_ring_) return;
+
+  // Let the listener reuse the buffers of the sent packets, in order.
+  PacketRingHeader& header = packet_ring_->Header();
+  uint32 consumed = header.tx_consumed.load(std::memory_order_relaxed);
+  while (consumed != tx_submitted_ &&
+         tx_entry_done_[consumed % kPacketRingSize]) {
+    tx_entry_done_[consumed % kPacketRingSize] = false;
+    consumed++;
+  }
+  header.tx_consumed.store(consumed, std::memory_order_release);
+}
+
+std::optional<uint16> VirtioNetworkDevice::AllocateTxDescriptor() {
+  if (free_tx_descriptors_.empty()) return std::nullopt;
+  uint16 desc_idx = free_tx_descriptors_.back();
+  free_tx_descriptors_.pop_back();
+  return desc_idx;
+}
+
+void VirtioNetworkDevice::SubmitTxDescriptor(uint16 desc_idx,
+                                             size_t physical_address,
+                                             size_t length) {
+  tx_queue_.desc[desc_idx].addr = physical_address;
+  tx_queue_.desc[desc_idx].len = length;
+  tx_queue_.desc[desc_idx].flags = 0;  // Read-only by device.
+  tx_queue_.desc[desc_idx].next = 0;
+
+  // Make descriptor available.
+  tx_queue_.avail->ring[tx_queue_.avail->idx % tx_queue_.size] = desc_idx;
+
+  // Flush descriptors and available ring entries first.
+  FlushRange(tx_queue_.mem, kQueueMemoryFlushSize);
+
+  __asm__ __volatile__("" ::: "memory");
+  tx_queue_.avail->idx++;
+  __asm__ __volatile__("" ::: "memory");
+
+  // Flush the updated index.
+  FlushRange((void*)tx_queue_.avail, kPageSize);
+}
+
+void VirtioNetworkDevice::SubmitQueuedTxEntries() {
+  PacketRingHeader& header = packet_ring_->Header();
+  uint32 produced = header.tx_produced.load(std::memory_order_acquire);
+
+  // The listener can write anything into the ring, so ignore an index that
+  // claims more entries than there's room for.
+  if (produced - header.tx_consumed.load(std::memory_order_relaxed) >
+      kPacketRingSize)
+    return;
+
+  bool submitted = false;
+  while (tx_submitted_ != produced) {
+    uint16 slot = tx_submitted_ % kPacketRingSize;
+    PacketRingEntry entry = header.tx[slot];
+    if (entry.buffer >= kPacketRingSize ||
+        entry.offset < kVirtioNetHeaderSize || entry.length == 0 ||
+        entry.length > kMaxPacketRingPacketSize ||
+        entry.offset + entry.length > kPacketBufferSize) {
+      // Drop invalid entries.
+      tx_entry_done_[slot] = true;
+      tx_submitted_++;
+      continue;
+    }
+
+    std::optional<uint16> desc_idx = AllocateTxDescriptor();
+    if (!desc_idx) break;  // Sent once the device frees up descriptors.
+
+    // The VirtioNetHeader goes into the headroom in front of the packet, so
+    // the device can read the packet straight out of the ring buffer.
+    size_t start = entry.offset - kVirtioNetHeaderSize;
+    uint8* buffer = packet_ring_->TxBuffer(entry.buffer);
+    memset(buffer + start, 0, kVirtioNetHeaderSize);
+    FlushRange(buffer + start, kVirtioNetHeaderSize + entry.length);
+
+    tx_descriptor_entries_[*desc_idx] = slot;
+    SubmitTxDescriptor(*desc_idx, tx_buffers_phys_[entry.buffer] + start,
+                       kVirtioNetHeaderSize + entry.length);
+    tx_submitted_++;
+    submitted = true;
+  }
+
+  // One notification for the whole batch.
+  if (submitted) virtio_pci_.KickQueue(tx_queue_);
 }
@@ -13,7 +13,10 @@
 // limitations under the License.
 #pragma once
 
+#include <memory>
 #include <mutex>
+#include <optional>
+#include <vector>
 
 #include "driver.h"
 #include "perception/devices/device_manager.h"
@@ -38,9 +41,44 @@ class VirtioNetworkDevice : public perception::devices::NetworkDevice::Server,
       const perception::devices::NetworkListener::Client& listener,
       perception::ProcessId sender) override;
 
+  virtual StatusOr<perception::devices::PacketRingParameters>
+  CreatePacketRing(perception::ProcessId sender) override;
+
+  virtual Status TransmitPackets(perception::ProcessId sender) override;
+
+  virtual Status ReceivedPacketsConsumed(perception::ProcessId sender) override;
+
  private:
   void HandleInterrupt();
 
+  // Passes packets the device has received on to the listener.
+  void ReceivePackets();
+
+  // Gives a receive descriptor back to the device. It's pointed at its packet
+  // ring buffer if there is a packet ring.
+  void RecycleRxDescriptor(uint16 desc_idx);
+
+  // Gives the buffers of received packets that the listener has consumed back
+  // to the device.
+  void RecycleConsumedRxBuffers();
+
+  // Takes back the transmit descriptors the device is done with. Must hold
+  // tx_mutex_.
+  void ReclaimTxDescriptors();
+
+  // Returns a free transmit descriptor, or nullopt if they are all in use. Must
+  // hold tx_mutex_.
+  std::optional<uint16> AllocateTxDescriptor();
+
+  // Adds a transmit descriptor to the available ring. The device isn't told
+  // until the queue is kicked. Must hold tx_mutex_.
+  void SubmitTxDescriptor(uint16 desc_idx, size_t physical_address,
+                          size_t length);
+
+  // Gives the device the packets the listener has queued in the packet ring
+  // since the last call, and kicks the queue once. Must hold tx_mutex_.
+  void SubmitQueuedTxEntries();
+
   VirtioPciDevice virtio_pci_;
   uint8 mac_[6];
   perception::devices::NetworkListener::Client listener_;
@@ -49,7 +87,46 @@ class VirtioNetworkDevice : public perception::devices::NetworkDevice::Server,
   // RX Queue details
   QueueDetails rx_queue_;
 
+  // The available index that recycled receive descriptors have been added up
+  // to. The device is told about them all at once.
+  uint16 rx_next_avail_ = 0;
+
   // TX Queue details
   std::mutex tx_mutex_;
   QueueDetails tx_queue_;
-};
\ No newline at end of file
+
+  // Transmit descriptors that the device doesn't have.
+  std::vector<uint16> free_tx_descriptors_;
+
+  // For each transmit descriptor, the packet ring entry it's sending, or -1 if
+  // it's sending out of the descriptor's own buffer.
+  int tx_descriptor_entries_[kMaxQueueSize];
+
+  // Packets shared with the Network Manager. The receive descriptors point
+  // straight at the ring's receive buffers, one buffer per descriptor, and
+  // packets to transmit are sent straight out of the ring's transmit buffers.
+  std::unique_ptr<perception::devices::PacketRing> packet_ring_;
+  perception::ProcessId packet_ring_owner_ = 0;
+  size_t rx_buffers_phys_[perception::devices::kPacketRingSize];
+  size_t tx_buffers_phys_[perception::devices::kPacketRingSize];
+
+  // Whether each receive descriptor has been pointed at its packet ring
+  // buffer. Descriptors given to the device before the ring was created still
+  // point at their own buffers.
+  bool rx_descriptor_uses_ring_[kMaxQueueSize] = {};
+
+  // Received entries before this have had their buffers given back to the
+  // device.
+  uint32 rx_recycled_ = 0;
+
+  // The receive descriptor of each received entry. Kept here rather than read
+  // back from the ring, which the listener can write to.
+  uint16 rx_entry_descriptors_[perception::devices::kPacketRingSize];
+
+  // Entries to transmit before this have been given to the device.
+  uint32 tx_submitted_ = 0;
+
+  // Whether each entry to transmit is finished with, so tx_consumed can move
+  // past it. The device can finish with them out of order.
+  bool tx_entry_done_[perception::devices::kPacketRingSize] = {};
+};
@@ -16,6 +16,7 @@
 
 #include <errno.h>
 
+#include <atomic>
 #include <map>
 #include <mutex>
 
@@ -39,11 +40,28 @@ std::map<long, std::shared_ptr<FileDescriptor>> open_files;
 
 long last_file_id = 2;
 
+// The write generations of the files open in this process, by path.
+std::map<std::string, std::weak_ptr<std::atomic<size_t>>>
+    write_generations_by_path;
+
 long GetUniqueFileId() {
   last_file_id++;
   return last_file_id;
 }
 
+// Returns the write generation shared by all descriptors open to a path.
+// `files_mutex` must be held.
+std::shared_ptr<std::atomic<size_t>> GetWriteGeneration(
+    const std::string& path) {
+  auto& weak_write_generation = write_generations_by_path[path];
+  auto write_generation = weak_write_generation.lock();
+  if (!write_generation) {
+    write_generation = std::make_shared<std::atomic<size_t>>(0);
+    weak_write_generation = write_generation;
+  }
+  return write_generation;
+}
+
 struct MemoryMappedFileEntry {
   ::perception::MemoryMappedFile::Client file;
   std::shared_ptr<::perception::SharedMemory> buffer;
@@ -98,11 +116,13 @@ long OpenFile(const char* path, bool read_access, bool write_access,
   auto descriptor = std::make_shared<FileDescriptor>();
   descriptor->type = FileDescriptor::FILE;
   descriptor->file.file = status_or_response->file;
-  descriptor->file.path = path;
+  descriptor->file.path = ResolvePath(path);
   descriptor->file.size_in_bytes = status_or_response->size_in_bytes;
   descriptor->file.offset_in_file = 0;
+  descriptor->file.buffer_reads = !write_access;
 
   std::lock_guard<std::mutex> lock(files_mutex);
+  descriptor->file.write_generation = GetWriteGeneration(descriptor->file.path);
   long id = GetUniqueFileId();
   open_files[id] = descriptor;
   return id;
@@ -138,7 +158,16 @@ void CloseFile(long id) {
     open_files.erase(itr);
   }
 
-  if (descriptor->type == FileDescriptor::FILE) descriptor->file.file.Close();
+  if (descriptor->type == FileDescriptor::FILE) {
+    descriptor->file.file.Close();
+
+    // Forget the write generation once nothing has the path open.
+    std::lock_guard<std::mutex> lock(files_mutex);
+    descriptor->file.write_generation.reset();
+    auto itr = write_generations_by_path.find(descriptor->file.path);
+    if (itr != write_generations_by_path.end() && itr->second.expired())
+      write_generations_by_path.erase(itr);
+  }
   if (descriptor->type == FileDescriptor::SOCKET)
     descriptor->socket.socket.Close();
 }
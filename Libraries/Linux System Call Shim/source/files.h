@@ -14,6 +14,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <memory>
 #include <string>
 #include <string_view>
 
@@ -27,6 +29,9 @@ namespace perception {
 
 extern SharedMemoryPool<kPageSize> kSharedMemoryPool;
 
+// The size of each file descriptor's read buffer.
+constexpr size_t kFileReadBufferSize = 128 * 1024;
+
 struct FileDescriptor {
   enum Type { DIRECTORY = 0, FILE = 1, SOCKET = 2 };
   Type type;
@@ -39,9 +44,33 @@ struct FileDescriptor {
 
   struct File {
     perception::File::Client file;
+    // Resolved when the file is opened, so it still names the same file if the
+    // working directory changes.
     std::string path;
     size_t size_in_bytes;
     size_t offset_in_file;
+
+    // Whether reads ahead of the reader are kept. This is only done for files
+    // opened without write access, so a file that's written to in the same
+    // descriptor always reads back what was written.
+    bool buffer_reads = false;
+
+    // Counts the writes to this file through any descriptor in this process.
+    // Shared by all descriptors open to the same path.
+    std::shared_ptr<std::atomic<size_t>> write_generation;
+
+    // Data read from the file ahead of the reader, so that small reads can be
+    // served without an RPC. This is allocated on the first read.
+    std::shared_ptr<::perception::SharedMemory> read_buffer;
+
+    // The offset in the file of the data in `read_buffer`, and the number of
+    // bytes of it that are valid.
+    size_t read_buffer_offset = 0;
+    size_t read_buffer_length = 0;
+
+    // The write generation when `read_buffer` was filled. The buffer is stale
+    // if the file has since been written to.
+    size_t read_buffer_generation = 0;
   } file;
 
   struct Socket {
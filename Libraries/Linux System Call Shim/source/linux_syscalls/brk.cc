@@ -14,18 +14,60 @@
 
 #include "linux_syscalls/brk.h"
 
-#include "errno.h"
-#include "perception/debug.h"
+#include <mutex>
+#include <string.h>
 
-// Defined in syscall.h but doesn't like being included from C++.
-extern "C" long __syscall_ret(long val);
+#include "perception/memory.h"
+
+namespace {
+
+// The most that the program break can grow by. The whole range is reserved up
+// front with lazily zeroed pages, so only the pages that get used cost memory.
+constexpr size_t kMaxBreakSize = 64 * 1024 * 1024;  // 64 MB
+
+std::mutex break_mutex;
+
+// The start of the range reserved for the program break, or 0 if it hasn't
+// been reserved yet.
+size_t break_start = 0;
+
+// The current program break.
+size_t current_break = 0;
+
+// The highest the program break has been. Memory below this may have been
+// written to before the break shrank.
+size_t highest_break = 0;
+
+}  // namespace
 
 namespace perception {
 namespace linux_syscalls {
 
-long brk() {
-  // brk is unsupported; mmap is used instead.
-  return __syscall_ret(-ENOSYS);
+long brk(long addr) {
+  std::scoped_lock lock(break_mutex);
+  if (break_start == 0) {
+    void* memory = AllocateLazilyZeroedMemoryPages(kMaxBreakSize / kPageSize);
+    // Nothing is reserved yet, so the unchanged break is 0. Callers compare
+    // the result against the break they asked for, so this reads as a
+    // failure. The reservation is tried again on the next call.
+    if (memory == nullptr) return 0;
+    break_start = current_break = highest_break = (size_t)memory;
+  }
+
+  size_t new_break = (size_t)addr;
+  if (new_break < break_start || new_break > break_start + kMaxBreakSize) {
+    // Out of range (or a query with 0), so the break doesn't move.
+    return (long)current_break;
+  }
+
+  if (new_break > current_break && current_break < highest_break) {
+    // Memory coming back into the heap must be zero again.
+    size_t end_of_used = new_break < highest_break ? new_break : highest_break;
+    memset((void*)current_break, 0, end_of_used - current_break);
+  }
+  current_break = new_break;
+  if (current_break > highest_break) highest_break = current_break;
+  return (long)current_break;
 }
 
 }  // namespace linux_syscalls
@@ -15,7 +15,7 @@
 namespace perception {
 namespace linux_syscalls {
 
-long brk();
+long brk(long addr);
 
 }
 }  // namespace perception
@@ -15,36 +15,93 @@
 #include "linux_syscalls/futex.h"
 
 #include <errno.h>
+#include <limits.h>
+#include <time.h>
 
 #include "../../../../third_party/Libraries/musl/source/internal/futex.h"
 #include "perception/debug.h"
 #include "perception/futex.h"
+#include "perception/threads.h"
 
 namespace perception {
 namespace linux_syscalls {
+namespace {
 
-long futex(volatile int* addr, int op, int val, void* ts) {
-  // Ignoring the timeout struct (ts) for now.
+// Waits on the futex until woken or the relative timeout `ts` elapses.
+long Wait(volatile int* addr, int val, const struct ::timespec* ts) {
+  if (IsPrimaryThread()) {
+    // Fibers on the primary thread sleep without blocking the thread, so
+    // that the event loop keeps running. They ignore the timeout.
+    return WaitOnFutex((void*)addr, val) ? 0 : -EAGAIN;
+  }
+
+  std::optional<std::chrono::microseconds> timeout;
+  if (ts != nullptr) {
+    if (ts->tv_sec < 0 || ts->tv_nsec < 0 || ts->tv_nsec >= 1000000000L)
+      return -EINVAL;
+    timeout = std::chrono::microseconds(
+        static_cast<long long>(ts->tv_sec) * 1000000LL +
+        (static_cast<long long>(ts->tv_nsec) + 999LL) / 1000LL);
+  }
+
+  switch (FutexWait(addr, val, timeout)) {
+    case FutexWaitResult::WOKEN:
+      return 0;
+    case FutexWaitResult::VALUE_CHANGED:
+      return -EAGAIN;
+    case FutexWaitResult::TIMED_OUT:
+      return -ETIMEDOUT;
+    case FutexWaitResult::INVALID_ADDRESS:
+    default:
+      return -EFAULT;
+  }
+}
+
+// Wakes up to `val` threads and fibers waiting on the futex. Returns how many
+// threads the kernel woke up.
+long Wake(volatile int* addr, int val) {
+  if (val <= 0) return 0;
+  size_t woken = FutexWake(addr, static_cast<size_t>(val));
+  // Fibers on the primary thread wait in user space.
+  if (woken < static_cast<size_t>(val))
+    WakeFutex((void*)addr, val - static_cast<int>(woken));
+  return static_cast<long>(woken);
+}
+
+// Wakes up to `val` waiters and moves up to `val2` of the rest to `addr2`.
+long Requeue(volatile int* addr, int val, int val2, volatile int* addr2,
+             std::optional<int> val3) {
+  if (val < 0 || val2 < 0) return -EINVAL;
+  std::optional<size_t> count =
+      FutexRequeue(addr, static_cast<size_t>(val), addr2,
+                   static_cast<size_t>(val2), val3);
+  if (!count) return -EAGAIN;
 
+  // Fibers on the primary thread can't be moved between user space and the
+  // kernel, so wake them all up. Futex users have to handle spurious wakes.
+  WakeFutex((void*)addr, INT_MAX);
+  return static_cast<long>(*count);
+}
+
+}  // namespace
+
+long futex(volatile int* addr, int op, int val, void* ts, volatile int* addr2,
+           int val3) {
   // Ignore FUTEX_PRIVATE/FUTEX_CLOCK_REALTIME.
   op &= 15;
 
   switch (op) {
     case FUTEX_WAIT:
-      return WaitOnFutex((void*)addr, val) ? 0 : -EAGAIN;
+      return Wait(addr, val, (const struct ::timespec*)ts);
     case FUTEX_WAKE:
-      WakeFutex((void*)addr, val);
-      return 0;
-    case FUTEX_FD:
-      perception::DebugPrinterSingleton << "FUTEX_FD not implemented" << '\n';
-      break;
+      return Wake(addr, val);
     case FUTEX_REQUEUE:
-      perception::DebugPrinterSingleton << "FUTEX_REQUEUE not implemented"
-                                        << '\n';
-      break;
+      // The requeue count is passed in place of the timeout.
+      return Requeue(addr, val, (int)(long)ts, addr2, std::nullopt);
     case FUTEX_CMP_REQUEUE:
-      perception::DebugPrinterSingleton << "FUTEX_CMP_REQUEUE not implemented"
-                                        << '\n';
+      return Requeue(addr, val, (int)(long)ts, addr2, val3);
+    case FUTEX_FD:
+      perception::DebugPrinterSingleton << "FUTEX_FD not implemented" << '\n';
       break;
     case FUTEX_WAKE_OP:
       perception::DebugPrinterSingleton << "FUTEX_WAKE_OP not implemented"
@@ -15,7 +15,8 @@
 namespace perception {
 namespace linux_syscalls {
 
-long futex(volatile int *addr, int op, int val, void *ts);
+long futex(volatile int *addr, int op, int val, void *ts,
+           volatile int *addr2, int val3);
 
 }
 }  // namespace perception
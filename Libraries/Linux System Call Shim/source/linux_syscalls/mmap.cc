@@ -59,14 +59,14 @@ long mmap(long addr, long length, long prot, long flags, long fd, long offset) {
   // memory is made x/r/w and this parameter can be ignored.
 
   if ((flags & MAP_ANON) != 0) {
-    // Allocate 0-initialized memory.
+    // Allocate 0-initialized memory. Pages are only backed when they're first
+    // touched, since programs often map far more than they use.
     size_t pages = (size_t)(length + kPageSize - 1) / kPageSize;
-    void *addr = AllocateMemoryPages(pages);
+    void *addr = AllocateLazilyZeroedMemoryPages(pages);
     if (addr == nullptr) {
        errno = ENOMEM;
        return -1; // MAP_FAILED
     }
-    memset(addr, 0, pages * kPageSize);
     return (long)addr;
   } else {
     // Allocate a memory mapped file.
@@ -24,6 +24,7 @@
 namespace perception {
 namespace linux_syscalls {
 
+using ::perception::SharedMemory;
 using ::perception::network::ReceiveRequest;
 
 namespace {
@@ -82,6 +83,40 @@ long ReadSocket(const std::shared_ptr<FileDescriptor>& descriptor, void* iov,
   return copied_bytes;
 }
 
+// Copies a chunk of the file, from `chunk_start` to `chunk_end` in file
+// offset, into the io vectors being read into, which start at `iov_start`.
+void CopyChunkIntoIoVectors(const iovec* iov, long iovcnt, size_t iov_start,
+                            const char* chunk_data, size_t chunk_start,
+                            size_t chunk_end) {
+  size_t buffer_start_offset = 0;
+  for (int io_entry = 0; io_entry < iovcnt; io_entry++) {
+    const auto& io = iov[io_entry];
+    size_t buffer_length = (size_t)io.iov_len;
+
+    // The start and end of this buffer, in file offset.
+    size_t buffer_start = iov_start + buffer_start_offset;
+    size_t buffer_end = buffer_start + buffer_length;
+
+    // See if there is an overlap between this chunk and this buffer to
+    // copy to.
+    if (buffer_start < chunk_end && chunk_start < buffer_end) {
+      size_t copy_start = std::max(buffer_start, chunk_start);
+      size_t copy_end = std::min(buffer_end, chunk_end);
+
+      size_t bytes_to_copy = copy_end - copy_start;
+
+      size_t offset_in_buffer = copy_start - buffer_start;
+      size_t offset_in_chunk = copy_start - chunk_start;
+
+      // Copy from the chunk into the buffer.
+      memcpy(&((char*)io.iov_base)[offset_in_buffer],
+             &chunk_data[offset_in_chunk], bytes_to_copy);
+    }
+
+    buffer_start_offset += buffer_length;
+  }
+}
+
 long ReadFile(const std::shared_ptr<FileDescriptor>& descriptor, void* iov,
               long iovcnt) {
   if (iovcnt < 0) {
@@ -105,6 +140,8 @@ long ReadFile(const std::shared_ptr<FileDescriptor>& descriptor, void* iov,
   }
 
   // Prune to how many bytes there actually are remaining in the file.
+  if (descriptor->file.offset_in_file >= descriptor->file.size_in_bytes)
+    return 0;
   bytes_to_read = std::min(bytes_to_read, descriptor->file.size_in_bytes -
                                               descriptor->file.offset_in_file);
 
@@ -113,81 +150,64 @@ long ReadFile(const std::shared_ptr<FileDescriptor>& descriptor, void* iov,
     return 0;
   }
 
-  // Break into page size chunks.
-  int num_chunks = (bytes_to_read + kPageSize - 1) / kPageSize;
+  auto& file = descriptor->file;
+  if (!file.read_buffer) {
+    file.read_buffer = SharedMemory::FromSize(kFileReadBufferSize,
+                                              SharedMemory::kJoinersCanWrite);
+    (void)file.read_buffer->Join();
+    file.read_buffer_length = 0;
+  }
 
-  // Grab a shared memory buffer used to communicate with the
-  // storage service to copy chunks into.
-  auto pooled_shared_memory = kSharedMemoryPool.GetSharedMemory();
-  char* chunk_data = (char*)**pooled_shared_memory->shared_memory;
+  // Drop what's been read ahead if the file has been written to since.
+  size_t write_generation = *file.write_generation;
+  if (file.read_buffer_generation != write_generation) {
+    file.read_buffer_length = 0;
+    file.read_buffer_generation = write_generation;
+  }
+  char* buffer_data = (char*)**file.read_buffer;
+  size_t buffer_size = file.read_buffer->GetSize();
 
   size_t bytes_read = 0;
-
-  // Read each chunk.
-  for (int chunk_to_read = 0; chunk_to_read < num_chunks; chunk_to_read++) {
-    size_t bytes_to_read_this_chunk = std::min(kPageSize, bytes_to_read);
-
-    // The start and end of this chunk, in file offset.
-    size_t chunk_start = descriptor->file.offset_in_file + bytes_read;
-    size_t chunk_end = chunk_start + bytes_to_read_this_chunk;
-
-    // Create the request to send to storage manager.
-    ReadFileRequest request;
-    request.offset_in_file = chunk_start;
-    request.offset_in_destination_buffer = 0;
-    request.bytes_to_copy = bytes_to_read_this_chunk;
-    request.buffer_to_copy_into = pooled_shared_memory->shared_memory;
-
-    // Read the file.
-    auto status = descriptor->file.file.Read(request);
-
-    if (status != Status::OK) {
-      kSharedMemoryPool.ReleaseSharedMemory(pooled_shared_memory);
-      errno = EINVAL;
-      return -1;
-    }
-
-    // Copy from the shared buffer with Storage Manager into the buffers
-    // passed into readv.
-    size_t buffer_start_offset = 0;
-    for (int io_entry = 0; io_entry < iovcnt; io_entry++) {
-      const auto& io = ((const iovec*)iov)[io_entry];
-      size_t buffer_length = (size_t)io.iov_len;
-
-      // The start and end of this buffer, in file offset.
-      size_t buffer_start =
-          descriptor->file.offset_in_file + buffer_start_offset;
-      size_t buffer_end = buffer_start + buffer_length;
-
-      // See if there is an overlap between this chunk and this buffer to
-      // copy to.
-      if (buffer_start < chunk_end && chunk_start < buffer_end) {
-        size_t copy_start = std::max(buffer_start, chunk_start);
-        size_t copy_end = std::min(buffer_end, chunk_end);
-
-        size_t bytes_to_copy = copy_end - copy_start;
-
-        size_t offset_in_buffer = copy_start - buffer_start;
-        size_t offset_in_chunk = copy_start - chunk_start;
-
-        // Copy from the chunk into the buffer.
-        memcpy(&((char*)io.iov_base)[offset_in_buffer],
-               &chunk_data[offset_in_chunk], bytes_to_copy);
+  while (bytes_read < bytes_to_read) {
+    size_t chunk_start = file.offset_in_file + bytes_read;
+
+    if (chunk_start < file.read_buffer_offset ||
+        chunk_start >= file.read_buffer_offset + file.read_buffer_length) {
+      // The data isn't buffered, so fill the buffer starting from here with a
+      // single read from the storage service. Only read ahead if what's read
+      // ahead is kept.
+      ReadFileRequest request;
+      request.offset_in_file = chunk_start;
+      request.offset_in_destination_buffer = 0;
+      request.bytes_to_copy = std::min(
+          buffer_size, file.buffer_reads ? file.size_in_bytes - chunk_start
+                                         : bytes_to_read - bytes_read);
+      request.buffer_to_copy_into = file.read_buffer;
+
+      file.read_buffer_length = 0;
+      auto status = file.file.Read(request);
+      if (status != Status::OK) {
+        errno = EINVAL;
+        return -1;
       }
-
-      buffer_start_offset += buffer_length;
+      file.read_buffer_offset = chunk_start;
+      file.read_buffer_length = request.bytes_to_copy;
     }
 
-    // Increment the amount read for this chunk.
-    bytes_read += bytes_to_read_this_chunk;
-    bytes_to_read -= bytes_to_read_this_chunk;
+    size_t chunk_end =
+        std::min(file.read_buffer_offset + file.read_buffer_length,
+                 file.offset_in_file + bytes_to_read);
+    CopyChunkIntoIoVectors(
+        (const iovec*)iov, iovcnt, file.offset_in_file,
+        &buffer_data[chunk_start - file.read_buffer_offset], chunk_start,
+        chunk_end);
+    bytes_read += chunk_end - chunk_start;
   }
-
-  kSharedMemoryPool.ReleaseSharedMemory(pooled_shared_memory);
+  if (!file.buffer_reads) file.read_buffer_length = 0;
 
   // Track how far the file has been read, so subsequent calls can
   // continue reading the following data in the file.
-  descriptor->file.offset_in_file += bytes_read;
+  file.offset_in_file += bytes_read;
 
   return bytes_read;
 }
@@ -21,6 +21,9 @@ namespace perception {
 namespace linux_syscalls {
 
 long tgkill() {
+  // This is how abort() raises SIGABRT, right before the program crashes, so
+  // print any partial line this thread has buffered.
+  perception::DebugPrinterSingleton.Flush();
   perception::DebugPrinterSingleton << "System call tgkill is unimplemented.\n";
   return -ENOSYS;
 }
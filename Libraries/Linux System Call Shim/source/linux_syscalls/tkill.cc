@@ -21,6 +21,9 @@ namespace perception {
 namespace linux_syscalls {
 
 long tkill() {
+  // This is how abort() raises SIGABRT, right before the program crashes, so
+  // print any partial line this thread has buffered.
+  perception::DebugPrinterSingleton.Flush();
   perception::DebugPrinterSingleton << "System call tkill is unimplemented.\n";
   return 0; // Pretend it succeeded.
 }
@@ -67,6 +67,9 @@ long WriteFile(const std::shared_ptr<FileDescriptor>& descriptor,
 
   if (bytes_to_write == 0) return 0;
 
+  // Anything that's been read ahead of this file may be about to change.
+  (*descriptor->file.write_generation)++;
+
   // Break into page size chunks.
   int num_chunks = (bytes_to_write + kPageSize - 1) / kPageSize;
 
@@ -143,11 +146,11 @@ long WriteDefault(struct iovec* buffers, long buffer_count) {
   size_t bytes_written = 0;
   for (size_t i = 0; i < buffer_count; i++) {
     const auto& buffer = buffers[i];
-
-    char* c = (char*)buffer.iov_base;
-    for (size_t j = 0; j < buffer.iov_len; j++, c++, bytes_written++)
-      DebugPrinterSingleton << *c;
+    DebugPrinterSingleton.Write((const char*)buffer.iov_base, buffer.iov_len);
+    bytes_written += buffer.iov_len;
   }
+  // Callers expect what they wrote to show up, even without a line ending.
+  DebugPrinterSingleton.Flush();
   return bytes_written;
 }
 
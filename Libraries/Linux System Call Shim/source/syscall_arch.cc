@@ -423,7 +423,7 @@ extern "C" long __syscall6(long n, long a1, long a2, long a3, long a4, long a5,
     case SYS_bpf:
       return ::perception::linux_syscalls::bpf();
     case SYS_brk:
-      return ::perception::linux_syscalls::brk();
+      return ::perception::linux_syscalls::brk(a1);
     case SYS_capget:
       return ::perception::linux_syscalls::capget();
     case SYS_capset:
@@ -551,7 +551,8 @@ extern "C" long __syscall6(long n, long a1, long a2, long a3, long a4, long a5,
     case SYS_ftruncate:
       return ::perception::linux_syscalls::ftruncate();
     case SYS_futex:
-      return ::perception::linux_syscalls::futex((int *)a1, a2, a3, (void *)a4);
+      return ::perception::linux_syscalls::futex((int *)a1, a2, a3, (void *)a4,
+                                                 (int *)a5, a6);
     case SYS_futimesat:
       return ::perception::linux_syscalls::futimesat();
     case SYS_get_kernel_syms:
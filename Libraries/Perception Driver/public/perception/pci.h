@@ -37,6 +37,7 @@ constexpr uint8 kPciHdrBar3 = 28;
 constexpr uint8 kPciHdrBar4 = 32;
 constexpr uint8 kPciHdrBar5 = 36;
 constexpr uint8 kPciHdrSecondaryBusNumber = 25;
+constexpr uint8 kPciHdrInterruptLine = 60;
 
 // Command bits:
 constexpr uint8 kPciHdrCommandBitIoSpace = (1 << 0);
@@ -12,7 +12,9 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 #pragma once
+#include <functional>
 #include <memory>
+#include <vector>
 
 #include "perception/type_id.h"
 #include "perception/ui/components/container.h"
@@ -163,6 +165,9 @@ class ScrollContainer : public UniqueIdentifiableType<ScrollContainer>,
 
   void ScrollIntoView(std::shared_ptr<Node> node);
 
+  // Registers a function to call when the content moves.
+  void OnScroll(std::function<void()> on_scroll);
+
  private:
   std::weak_ptr<Node> scroll_content_;
   std::weak_ptr<Node> scroll_container_;
@@ -171,6 +176,8 @@ class ScrollContainer : public UniqueIdentifiableType<ScrollContainer>,
 
   std::weak_ptr<ScrollBar> scroll_bars_[2];
 
+  std::vector<std::function<void()>> on_scroll_;
+
   void RegisterScrollBarListener(std::weak_ptr<ScrollBar> scroll_bar);
   void UpdateScrollBars();
   void MoveContentToScrollBarPosition();
@@ -40,7 +40,8 @@ enum class CellHighlightability {
   RowHighlightable
 };
 
-class Table : public UniqueIdentifiableType<Table> {
+class Table : public std::enable_shared_from_this<Table>,
+              public UniqueIdentifiableType<Table> {
  public:
   struct Column {
     std::string title;
@@ -66,12 +67,13 @@ class Table : public UniqueIdentifiableType<Table> {
       const std::vector<Column>& columns, Modifiers... modifiers) {
     std::shared_ptr<Node> header_container;
     std::shared_ptr<Node> rows_container;
+    std::shared_ptr<ScrollContainer> scroll_container;
 
     auto node = Container::VerticalContainer(
-        [&header_container, &rows_container, data_source,
+        [&header_container, &rows_container, &scroll_container, data_source,
          columns](Table& table) {
           table.Initialize(data_source, columns, header_container,
-                           rows_container);
+                           rows_container, scroll_container);
         },
         [](Block& block) {
           block.SetFillColor(kTableBackgroundColor);
@@ -119,6 +121,7 @@ class Table : public UniqueIdentifiableType<Table> {
                   layout.SetWidthPercent(100.0f);
                 },
                 &rows_container),
+            &scroll_container,
             [](Block& block) { block.SetFillColor(kTableBackgroundColor); },
             [](Layout& layout) {
               layout.SetFlexGrow(1.0f);
@@ -136,9 +139,15 @@ class Table : public UniqueIdentifiableType<Table> {
 
   void SetNode(std::weak_ptr<Node> node);
 
-  // Refreshes/rebuilds the table content from the data source.
+  // Refreshes the table content from the data source. Rows that are already
+  // on screen are updated in place rather than rebuilt.
   void Refresh();
 
+  // Sets whether only the rows near the visible part of the table get nodes.
+  // Row nodes are then reused as the table scrolls, so large tables stay
+  // cheap to lay out and draw. Every row must be the same height.
+  void SetIsVirtualized(bool is_virtualized);
+
   void OnCellSelect(std::function<void(int, int)> on_cell_select);
   void OnCellHover(std::function<void(int, int)> on_cell_hover);
 
@@ -147,11 +156,35 @@ class Table : public UniqueIdentifiableType<Table> {
   std::shared_ptr<DataSource> data_source_;
   std::vector<Column> columns_;
 
+  // The number of rows bound on either side of the visible rows, so that
+  // small scrolls don't reveal rows that haven't been bound yet.
+  static constexpr int kOverscanRows = 8;
+
+  // The most rows that are bound before the row height is known.
+  static constexpr int kRowsBeforeMeasuring = 64;
+
   std::weak_ptr<Node> header_container_;
   std::weak_ptr<Node> rows_container_;
+  std::weak_ptr<ScrollContainer> scroll_container_;
+
+  // The label of each column's header cell.
+  std::vector<std::shared_ptr<Node>> header_label_nodes_;
 
+  // Pooled row nodes. The row in slot `i` shows data row
+  // `first_bound_row_ + i`.
   std::vector<std::shared_ptr<Node>> row_nodes_;
   std::vector<std::vector<std::shared_ptr<Node>>> cell_nodes_;
+  std::vector<std::vector<std::shared_ptr<Node>>> cell_label_nodes_;
+  int first_bound_row_ = 0;
+  int number_of_rows_ = 0;
+
+  bool is_virtualized_ = false;
+
+  // The height of a row, or 0 if it hasn't been measured yet.
+  float row_height_ = 0.0f;
+
+  // The height of the viewport when the rows were last bound.
+  float bound_viewport_height_ = 0.0f;
 
   int sorted_column_index_ = -1;
   bool sort_ascending_ = true;
@@ -165,8 +198,37 @@ class Table : public UniqueIdentifiableType<Table> {
   void Initialize(std::shared_ptr<DataSource> data_source,
                   const std::vector<Column>& columns,
                   std::shared_ptr<Node> header_container,
-                  std::shared_ptr<Node> rows_container);
-  void BuildTable();
+                  std::shared_ptr<Node> rows_container,
+                  std::shared_ptr<ScrollContainer> scroll_container);
+  void BuildHeader();
+  void UpdateHeader();
+
+  // Binds the rows near the viewport to pooled row nodes, growing or
+  // shrinking the pool as needed.
+  void UpdateRows();
+
+  // Rebinds the rows if the viewport or row height changed since they were
+  // last bound.
+  void UpdateRowsIfViewportChanged();
+
+  // Measures the row height from the first row node once it has been laid
+  // out. Returns whether the height was just measured.
+  bool MeasureRowHeight();
+
+  std::shared_ptr<Node> CreateRowNode(int slot);
+
+  // Shows a data row in a slot's row node, updating only what changed.
+  void BindRow(int slot, CellHighlightability hovered_highlightability);
+
+  // Returns the slot showing a data row, or -1 if the row isn't bound.
+  int SlotForRow(int row) const;
+
+  CellHighlightability HoveredHighlightability();
+
+  void SetRowFillColor(int row, uint32 color);
+  void SetCellFillColor(int row, int col, uint32 color);
+  void SetColumnFillColor(int col, uint32 color);
+
   void Sort(int column_index);
   void HoverCell(int row, int col);
   void LeaveCell(int row, int col);
@@ -25,6 +25,7 @@
 #include "perception/ui/components/focusable.h"
 #include "perception/ui/components/scroll_container.h"
 #include "perception/ui/node.h"
+#include "perception/ui/text_layout.h"
 #include "perception/ui/theme.h"
 #include "perception/window/cursor.h"
 #include "yoga/Yoga.h"
@@ -90,6 +91,15 @@ class TextField : public UniqueIdentifiableType<TextField> {
     float width;
   };
 
+  // How a paragraph was wrapped, kept so that an edit only wraps the
+  // paragraphs it changed.
+  struct WrappedParagraph {
+    std::string text;
+    SkFont* font;
+    float max_width;
+    std::vector<WrappedLine> lines;
+  };
+
   std::weak_ptr<Node> node_;
   std::weak_ptr<Node> inner_node_;
   std::shared_ptr<Focusable> focusable_;
@@ -108,6 +118,7 @@ class TextField : public UniqueIdentifiableType<TextField> {
   bool layout_is_dirty_;
   float last_layout_width_;
   std::vector<LaidOutLine> laid_out_lines_;
+  std::vector<WrappedParagraph> wrapped_paragraphs_;
 
   std::vector<std::function<void(std::string_view)>> on_text_changed_handlers_;
 
@@ -234,6 +234,15 @@ class TreeViewItem : public UniqueIdentifiableType<TreeViewItem>,
   void SetExpanded(bool expanded);
   bool IsExpanded() const;
 
+  // Sets a function that builds this item's children the first time it's
+  // expanded, so large trees only build the items that are shown. The item
+  // shows as expandable until then.
+  void SetChildrenProvider(
+      std::function<std::vector<std::shared_ptr<Node>>()> children_provider);
+
+  // Returns whether this item has children, including ones not built yet.
+  bool HasChildren() const;
+
   void Select(bool scroll_into_view = true, bool notify_listener = true);
 
   void SetSelected(bool selected);
@@ -279,6 +288,7 @@ class TreeViewItem : public UniqueIdentifiableType<TreeViewItem>,
   std::vector<std::function<void()>> on_select_;
   std::vector<std::function<void(bool)>> on_toggle_;
   std::vector<std::function<void(Point)>> on_context_menu_;
+  std::function<std::vector<std::shared_ptr<Node>>()> children_provider_;
 
   void DrawToggle(const DrawContext& draw_context);
   void ToggleExpanded();
@@ -21,13 +21,16 @@
 #include <set>
 #include <string_view>
 #include <unordered_map>
+#include <vector>
 
 #include "include/core/SkRefCnt.h"
 #include "include/core/SkSurface.h"
 #include "perception/type_id.h"
 #include "perception/ui/components/tab_bar.h"
 #include "perception/ui/components/title_bar.h"
+#include "perception/ui/damage_tracker.h"
 #include "perception/ui/node.h"
+#include "perception/ui/rectangle.h"
 #include "perception/ui/theme.h"
 #include "perception/window/window.h"
 #include "perception/window/window_delegate.h"
@@ -176,6 +179,7 @@ class UiWindow : public window::WindowDelegate,
   virtual void KeyPressed(const window::KeyboardKeyEvent& event) override;
   virtual void KeyReleased(const window::KeyboardKeyEvent& event) override;
 
+  // Redraws the entire window.
   void InvalidateRender();
 
  private:
@@ -193,8 +197,24 @@ class UiWindow : public window::WindowDelegate,
   bool is_resizable_;
   bool is_drawing_;
 
+  // The areas of the window that need to be redrawn.
+  DamageTracker damage_tracker_;
+
   void Create();
 
+  // Draws the window soon, without damaging any of it.
+  void ScheduleDraw();
+
+  // Redraws an area of the window, in logical units.
+  void InvalidateArea(const Rectangle& area);
+
+  // Calculates the layout if it's dirty, and damages the old and new areas of
+  // every node that moved, resized, appeared, or disappeared.
+  void UpdateLayout();
+
+  // Returns the pixels covered by the damaged areas.
+  window::Rectangle GetDamagedPixels() const;
+
   std::shared_ptr<window::Window> base_window_;
   std::weak_ptr<Node> node_;
 
@@ -0,0 +1,91 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "perception/ui/point.h"
+#include "perception/ui/rectangle.h"
+
+namespace perception {
+namespace ui {
+
+class Node;
+
+// Tracks which areas of a window, in logical units, need to be redrawn.
+class DamageTracker {
+ public:
+  // The most areas to track before they're merged into one.
+  static constexpr size_t kMaxDamagedAreas = 16;
+
+  // Starts with everything damaged, because nothing has been drawn yet.
+  DamageTracker();
+
+  // Damages the entire window.
+  void DamageEverything();
+
+  // Returns whether the entire window needs to be redrawn.
+  bool IsEverythingDamaged() const;
+
+  // Damages an area. Areas without a positive size, including those that
+  // haven't been laid out yet, and areas already covered by a damaged area,
+  // are ignored.
+  void Damage(const Rectangle& area);
+
+  // Records where `root` and every visible node below it are, and damages the
+  // old and new areas of every node that moved, resized, appeared, or
+  // disappeared since this was last called. Nodes are clipped to
+  // `window_area` the same way they are when drawn.
+  void UpdateNodeAreas(const std::shared_ptr<Node>& root,
+                       const Rectangle& window_area);
+
+  // Returns the damaged areas. This is empty if nothing, or everything, is
+  // damaged.
+  const std::vector<Rectangle>& GetDamagedAreas() const;
+
+  // Forgets about the damage once it has been redrawn. Where the nodes are is
+  // still remembered.
+  void Clear();
+
+ private:
+  // Where a node was when the node areas were last updated.
+  struct DrawnNode {
+    std::weak_ptr<Node> node;
+    Rectangle area;
+  };
+
+  // Records where `node` and every visible node below it are, relative to the
+  // window. `parent_origin` is where the parent's children are positioned
+  // from.
+  static void RecordNodeAreas(
+      const std::shared_ptr<Node>& node, const Point& parent_origin,
+      const Rectangle& clipping_bounds,
+      std::unordered_map<const Node*, DrawnNode>& drawn_nodes);
+
+  // Whether the entire window needs to be redrawn.
+  bool everything_damaged_;
+
+  // The areas of the window that need to be redrawn.
+  std::vector<Rectangle> damaged_areas_;
+
+  // Where each visible node was, relative to the window, when the node areas
+  // were last updated.
+  std::unordered_map<const Node*, DrawnNode> drawn_nodes_;
+};
+
+}  // namespace ui
+}  // namespace perception
@@ -14,6 +14,8 @@
 
 #pragma once
 
+#include <vector>
+
 #include "perception/ui/rectangle.h"
 #include "types.h"
 
@@ -39,6 +41,10 @@ struct DrawContext {
   // The area to draw into.
   Rectangle area;
 
+  // The parts of the clipping boundaries that are being redrawn. Nodes that
+  // don't overlap any of them are skipped. Empty means all of it.
+  std::vector<Rectangle> damaged_areas;
+
   // The Skia canvas.
   SkCanvas* skia_canvas;
 
@@ -218,6 +218,12 @@ class Node : public std::enable_shared_from_this<Node> {
   // Adds a function to call when the node becomes invalidated.
   void OnInvalidate(std::function<void()> on_invalidate_function);
 
+  // Adds a function to call with the area, relative to the root node, that
+  // needs to be redrawn when this node or any node below it is invalidated.
+  // Only called on the root node.
+  void OnInvalidateArea(
+      std::function<void(const Rectangle& area)> on_invalidate_area_function);
+
   // Notifies the node that it needs to be redrawn.
   void Invalidate();
 
@@ -286,6 +292,8 @@ class Node : public std::enable_shared_from_this<Node> {
       measure_function_;
   std::function<bool(const Point&, const Size&)> hit_test_function_;
   std::vector<std::function<void()>> on_invalidate_functions_;
+  std::vector<std::function<void(const Rectangle&)>>
+      on_invalidate_area_functions_;
   std::vector<std::function<void(const DrawContext&)>> on_draw_functions_;
   std::vector<std::function<void(const DrawContext&)>>
       on_draw_post_children_functions_;
@@ -301,6 +309,10 @@ class Node : public std::enable_shared_from_this<Node> {
   void SetParent(std::weak_ptr<Node> parent);
   void DrawChildren(DrawContext& draw_context);
 
+  // Marks this node and its ancestors as needing to be redrawn, without
+  // saying where.
+  void MarkInvalidated();
+
   void InvalidateWhenDirtied();
   static void LayoutDirtied(const YGNode* node);
   static YGSize Measure(const YGNode* node, float width,
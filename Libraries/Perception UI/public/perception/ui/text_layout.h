@@ -0,0 +1,94 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "include/core/SkFont.h"
+#include "types.h"
+
+namespace perception {
+namespace ui {
+
+// Caches how far each character advances the pen in a font, so that text can
+// be measured by adding up advances instead of asking the font each time.
+class GlyphAdvances {
+ public:
+  // The most fonts whose advances are cached.
+  static constexpr size_t kMaxCachedFonts = 32;
+
+  // Returns the advances for a font. Advances are shared by every font with
+  // the same typeface, size and styling, and don't depend on `font` staying
+  // alive. Only the most recently used kMaxCachedFonts fonts are cached, and
+  // the advances of fonts that fall out of the cache are measured again if
+  // they're used later.
+  static std::shared_ptr<GlyphAdvances> ForFont(SkFont* font);
+
+  explicit GlyphAdvances(const SkFont& font);
+
+  // Returns the advance of the UTF-8 character starting at `index` in `text`,
+  // and sets `length` to its length in bytes.
+  float AdvanceAt(std::string_view text, size_t index, size_t& length);
+
+  // Returns the width of a run of UTF-8 text.
+  float Measure(std::string_view text);
+
+  // Sets `positions` to the x position of each byte in `text`, plus one for the
+  // end of the text, so the width of any part of it is a subtraction. Bytes in
+  // the middle of a character have the position of the character's start.
+  void MeasurePositions(std::string_view text, std::vector<float>& positions);
+
+ private:
+  // A copy of the font, which keeps the typeface alive.
+  SkFont font_;
+
+  // Advances of the ASCII characters, or negative if not yet measured.
+  float ascii_advances_[128];
+
+  // Advances of everything else, keyed by the character's UTF-8 bytes.
+  std::unordered_map<uint32, float> advances_;
+};
+
+// A line that a paragraph was wrapped onto. The line includes any spaces
+// that it was broken after.
+struct WrappedLine {
+  size_t start;
+  size_t end;
+  float width;
+};
+
+// How wide a line of text is considered to be.
+enum class LineWidth {
+  // How far the pen moves, including trailing spaces and side bearings.
+  Advance,
+  // The width of the drawn pixels. A line that's too wide by its advance is
+  // measured again by its ink before it's broken.
+  Ink
+};
+
+// Wraps a paragraph onto lines no wider than `max_width`. Lines are broken
+// after spaces, or between characters for words that don't fit on a line by
+// themselves. Each character is measured once, so this is linear in the
+// length of the paragraph. If `max_width` isn't positive the paragraph is
+// kept on one line.
+std::vector<WrappedLine> WrapParagraph(std::string_view paragraph, SkFont* font,
+                                       float max_width,
+                                       LineWidth line_width = LineWidth::Advance);
+
+}  // namespace ui
+}  // namespace perception
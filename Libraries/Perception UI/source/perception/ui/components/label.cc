@@ -14,7 +14,9 @@
 
 #include "perception/ui/components/label.h"
 
+#include <algorithm>
 #include <memory>
+#include <vector>
 
 #include "include/core/SkCanvas.h"
 #include "include/core/SkFont.h"
@@ -25,6 +27,7 @@
 #include "perception/ui/font.h"
 #include "perception/ui/measurements.h"
 #include "perception/ui/text_handling.h"
+#include "perception/ui/text_layout.h"
 #include "perception/ui/theme.h"
 
 namespace perception {
@@ -32,6 +35,28 @@ template class UniqueIdentifiableType<ui::components::Label>;
 
 namespace ui {
 namespace components {
+namespace {
+
+// Returns the longest prefix of `text` whose ink could fit in `max_width`, so
+// that truncating only has to measure the last few characters. Ink can
+// overhang the advance, but never by a whole em.
+std::string_view LongestPrefixThatCouldFit(std::string_view text, SkFont* font,
+                                           float max_width) {
+  std::vector<float> x;
+  GlyphAdvances::ForFont(font)->MeasurePositions(text, x);
+
+  float limit = max_width + font->getSize();
+  size_t end = 0;
+  while (end < text.length()) {
+    size_t next = std::min(end + GetNextUtf8CharLength(text, end),
+                           text.length());
+    if (x[next] > limit) break;
+    end = next;
+  }
+  return text.substr(0, end);
+}
+
+}  // namespace
 
 Label::Label()
     : font_(nullptr),
@@ -163,113 +188,19 @@ void Label::LayoutText(float max_width) {
   }
 
   for (const auto& paragraph : paragraphs) {
-    if (paragraph.empty()) {
-      laid_out_lines_.push_back(
-          {.text_view = "", .mutated_text = "", .size = {0.0f, 0.0f}});
-      continue;
-    }
-
-    if (max_width <= 0.0f) {
-      SkRect bounds;
-      font_->measureText(paragraph.data(), paragraph.length(),
-                         SkTextEncoding::kUTF8, &bounds);
-      laid_out_lines_.push_back(
-          {.text_view = paragraph,
-           .mutated_text = "",
-           .size = {.width = bounds.width(), .height = bounds.height()}});
-      continue;
-    }
-
-    // Word wrapping logic
-    size_t idx = 0;
-    size_t line_start = 0;
-    size_t line_len = 0;
-
-    while (idx < paragraph.length()) {
-      // Find next space delimiter
-      size_t next_space = paragraph.find(' ', idx);
-      std::string_view word;
-      size_t word_end;
-      if (next_space == std::string::npos) {
-        word = paragraph.substr(idx);
-        word_end = paragraph.length();
-      } else {
-        word = paragraph.substr(idx, next_space - idx + 1);
-        word_end = next_space + 1;
-      }
-
-      // Test line with this word added
-      std::string_view test_line =
-          paragraph.substr(line_start, line_len + word.length());
-      SkRect bounds;
-      font_->measureText(test_line.data(), test_line.length(),
-                         SkTextEncoding::kUTF8, &bounds);
-
-      if (bounds.width() <= max_width) {
-        line_len += word.length();
-        idx = word_end;
-      } else {
-        if (line_len == 0) {
-          // The word itself is too long for the line, break by character
-          size_t char_idx = 0;
-          while (char_idx < word.length()) {
-            size_t char_len = GetNextUtf8CharLength(word, char_idx);
-            if (char_len == 0) break;
-
-            std::string_view test_char_line =
-                paragraph.substr(line_start, line_len + char_len);
-            SkRect char_bounds;
-            font_->measureText(test_char_line.data(), test_char_line.length(),
-                               SkTextEncoding::kUTF8, &char_bounds);
-
-            if (char_bounds.width() <= max_width || line_len == 0) {
-              line_len += char_len;
-              char_idx += char_len;
-            } else {
-              // Commit current line
-              std::string_view line_to_push =
-                  paragraph.substr(line_start, line_len);
-              while (!line_to_push.empty() && line_to_push.back() == ' ') {
-                line_to_push.remove_suffix(1);
-              }
-              SkRect final_bounds;
-              font_->measureText(line_to_push.data(), line_to_push.length(),
-                                 SkTextEncoding::kUTF8, &final_bounds);
-              laid_out_lines_.push_back(
-                  {.text_view = line_to_push,
-                   .mutated_text = "",
-                   .size = {.width = final_bounds.width(),
-                            .height = final_bounds.height()}});
-              line_start = line_start + line_len;
-              line_len = 0;
-            }
-          }
-          idx = word_end;
-        } else {
-          // Commit current line and try adding word to next line
-          std::string_view line_to_push =
-              paragraph.substr(line_start, line_len);
-          while (!line_to_push.empty() && line_to_push.back() == ' ') {
-            line_to_push.remove_suffix(1);
-          }
-          SkRect final_bounds;
-          font_->measureText(line_to_push.data(), line_to_push.length(),
-                             SkTextEncoding::kUTF8, &final_bounds);
-          laid_out_lines_.push_back(
-              {.text_view = line_to_push,
-               .mutated_text = "",
-               .size = {.width = final_bounds.width(),
-                        .height = final_bounds.height()}});
-          line_start = idx;
-          line_len = 0;
-        }
-      }
-    }
-    if (line_len > 0) {
-      std::string_view line_to_push = paragraph.substr(line_start, line_len);
-      while (!line_to_push.empty() && line_to_push.back() == ' ') {
+    for (const WrappedLine& line :
+         WrapParagraph(paragraph, font_, max_width, LineWidth::Ink)) {
+      std::string_view line_to_push =
+          paragraph.substr(line.start, line.end - line.start);
+      while (max_width > 0.0f && !line_to_push.empty() &&
+             line_to_push.back() == ' ') {
         line_to_push.remove_suffix(1);
       }
+      if (line_to_push.empty()) {
+        laid_out_lines_.push_back(
+            {.text_view = "", .mutated_text = "", .size = {0.0f, 0.0f}});
+        continue;
+      }
       SkRect final_bounds;
       font_->measureText(line_to_push.data(), line_to_push.length(),
                          SkTextEncoding::kUTF8, &final_bounds);
@@ -295,7 +226,8 @@ void Label::LayoutText(float max_width) {
 
     if (truncation_mode_ == TruncationMode::Ellipsis) {
       if (truncated || overflows) {
-        std::string text_part(last_line.text_view);
+        std::string text_part(
+            LongestPrefixThatCouldFit(last_line.text_view, font_, max_width));
         while (!text_part.empty()) {
           std::string test_str = text_part + "…";
           SkRect ell_bounds;
@@ -319,7 +251,8 @@ void Label::LayoutText(float max_width) {
       }
     } else if (truncation_mode_ == TruncationMode::LastWholeCharacter) {
       if (overflows) {
-        std::string text_part(last_line.text_view);
+        std::string text_part(
+            LongestPrefixThatCouldFit(last_line.text_view, font_, max_width));
         while (!text_part.empty()) {
           SkRect char_bounds;
           font_->measureText(text_part.data(), text_part.length(),
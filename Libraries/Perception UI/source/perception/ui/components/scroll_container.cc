@@ -46,7 +46,9 @@ void ScrollContainer::SetContentPosition(const Point& position) {
   Point clamped_position = {.x = std::max(std::min(position.x, max_x), 0.0f),
                             .y = std::max(std::min(position.y, max_y), 0.0f)};
 
+  if (clamped_position == scroll_container->GetOffset()) return;
   scroll_container->SetOffset(clamped_position);
+  for (const auto& on_scroll : on_scroll_) on_scroll();
 }
 
 Point ScrollContainer::ContentPosition() {
@@ -134,6 +136,10 @@ void ScrollContainer::ScrollIntoView(std::shared_ptr<Node> node) {
   }
 }
 
+void ScrollContainer::OnScroll(std::function<void()> on_scroll) {
+  on_scroll_.push_back(on_scroll);
+}
+
 void ScrollContainer::RegisterScrollBarListener(
     std::weak_ptr<ScrollBar> scroll_bar) {
   auto strong_scroll_bar = scroll_bar.lock();
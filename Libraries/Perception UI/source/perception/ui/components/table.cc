@@ -14,6 +14,9 @@
 
 #include "perception/ui/components/table.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include "perception/scheduler.h"
 #include "perception/ui/theme.h"
 
@@ -29,21 +32,50 @@ Table::Table() {}
 void Table::Initialize(std::shared_ptr<DataSource> data_source,
                        const std::vector<Column>& columns,
                        std::shared_ptr<Node> header_container,
-                       std::shared_ptr<Node> rows_container) {
+                       std::shared_ptr<Node> rows_container,
+                       std::shared_ptr<ScrollContainer> scroll_container) {
   data_source_ = data_source;
   columns_ = columns;
   header_container_ = header_container;
   rows_container_ = rows_container;
-  BuildTable();
+  scroll_container_ = scroll_container;
+
+  // The scroll container and rows container are nodes that can outlive the
+  // table, so their callbacks only hold onto it weakly.
+  std::weak_ptr<Table> weak_this = shared_from_this();
+  if (scroll_container) {
+    scroll_container->OnScroll([weak_this]() {
+      auto strong_this = weak_this.lock();
+      if (strong_this && strong_this->is_virtualized_)
+        strong_this->UpdateRows();
+    });
+  }
+  if (rows_container) {
+    // Catches the row height being measured and the viewport being resized.
+    rows_container->OnDraw([weak_this](const DrawContext& context) {
+      if (auto strong_this = weak_this.lock())
+        strong_this->UpdateRowsIfViewportChanged();
+    });
+  }
+
+  BuildHeader();
+  UpdateRows();
 }
 
 void Table::SetNode(std::weak_ptr<Node> node) { node_ = node; }
 
 void Table::Refresh() {
-  BuildTable();
+  UpdateRows();
   if (!node_.expired()) node_.lock()->Invalidate();
 }
 
+void Table::SetIsVirtualized(bool is_virtualized) {
+  if (is_virtualized_ == is_virtualized) return;
+  is_virtualized_ = is_virtualized;
+  row_height_ = 0.0f;
+  Refresh();
+}
+
 void Table::OnCellSelect(std::function<void(int, int)> on_cell_select) {
   on_cell_select_.push_back(on_cell_select);
 }
@@ -65,121 +97,274 @@ void Table::Sort(int column_index) {
   }
 
   data_source_->SortByColumn(column_index, sort_ascending_);
+  UpdateHeader();
   Refresh();
 }
 
-void Table::BuildTable() {
+void Table::BuildHeader() {
   auto header = header_container_.lock();
-  auto rows = rows_container_.lock();
-  if (!header || !rows) return;
-
-  hovered_row_index_ = -1;
-  hovered_col_index_ = -1;
+  if (!header) return;
 
   header->RemoveChildren();
-  rows->RemoveChildren();
+  header_label_nodes_.clear();
 
-  // Build Header cells
+  std::weak_ptr<Table> weak_this = shared_from_this();
   std::vector<std::shared_ptr<Node>> header_cells;
   for (int i = 0; i < static_cast<int>(columns_.size()); ++i) {
-    std::string title = columns_[i].title;
-    if (i == sorted_column_index_) title += sort_ascending_ ? " ▲" : " ▼";
-
+    auto label_node = Node::Empty([](Label& label) {
+      label.SetTextAlignment(TextAlignment::MiddleLeft);
+      label.SetColor(kTableHeaderTextColor);
+    });
     auto header_cell_node = Node::Empty(
         columns_[i].layout_modifier,
         [](Layout& layout) {
           layout.SetPadding(YGEdgeHorizontal,
                             kTableHeaderCellHorizontalPadding);
         },
-        Node::Empty([title](Label& label) {
-          label.SetText(title);
-          label.SetTextAlignment(TextAlignment::MiddleLeft);
-          label.SetColor(kTableHeaderTextColor);
-        }));
+        label_node);
 
     if (columns_[i].sortable) {
-      header_cell_node->OnMouseHover([header_cell_node](const Point& point) {
-        for (auto& child : header_cell_node->GetChildren()) {
-          if (auto label = child->Get<Label>()) {
-            label->SetColor(kTableHeaderHoverTextColor);
-          }
-        }
+      header_cell_node->OnMouseHover([label_node](const Point& point) {
+        label_node->Get<Label>()->SetColor(kTableHeaderHoverTextColor);
       });
-      header_cell_node->OnMouseLeave([header_cell_node]() {
-        for (auto& child : header_cell_node->GetChildren()) {
-          if (auto label = child->Get<Label>()) {
-            label->SetColor(kTableHeaderTextColor);
-          }
-        }
+      header_cell_node->OnMouseLeave([label_node]() {
+        label_node->Get<Label>()->SetColor(kTableHeaderTextColor);
       });
       header_cell_node->OnMouseButtonUp(
-          [this, i](const Point& point, window::MouseButton button) {
+          [weak_this, i](const Point& point, window::MouseButton button) {
             if (button == window::MouseButton::Left) {
-              ::perception::Defer([this, i]() { this->Sort(i); });
+              ::perception::Defer([weak_this, i]() {
+                if (auto strong_this = weak_this.lock()) strong_this->Sort(i);
+              });
             }
           });
     }
 
+    header_label_nodes_.push_back(label_node);
     header_cells.push_back(header_cell_node);
   }
   header->AddChildren(header_cells);
+  UpdateHeader();
+}
 
-  // Build Rows
-  int num_rows = data_source_->GetNumberOfRows();
-  row_nodes_.clear();
-  cell_nodes_.clear();
-  cell_nodes_.resize(num_rows);
-
-  std::vector<std::shared_ptr<Node>> row_nodes;
-
-  for (int r = 0; r < num_rows; ++r) {
-    std::vector<std::shared_ptr<Node>> row_cells;
-    cell_nodes_[r].resize(columns_.size());
-
-    for (int c = 0; c < static_cast<int>(columns_.size()); ++c) {
-      std::string value = data_source_->GetCellValue(r, c);
-      auto cell_node = Node::Empty(
-          columns_[c].layout_modifier,
-          [](Block& block) { block.SetFillColor(kTableCellTransparentColor); },
-          [](Layout& layout) {
-            layout.SetPadding(YGEdgeHorizontal, kTableCellHorizontalPadding);
-            layout.SetPadding(YGEdgeVertical, kTableCellVerticalPadding);
-          },
-          Node::Empty([value](Label& label) {
-            label.SetText(value);
-            label.SetTextAlignment(TextAlignment::MiddleLeft);
-            label.SetColor(kTableCellTextColor);
-          }));
-
-      cell_node->OnMouseHover(
-          [this, r, c](const Point& point) { this->HoverCell(r, c); });
-      cell_node->OnMouseLeave([this, r, c]() { this->LeaveCell(r, c); });
-      cell_node->OnMouseButtonUp(
-          [this, r, c](const Point& point, window::MouseButton button) {
-            if (button == window::MouseButton::Left) {
-              ::perception::Defer([this, r, c]() {
-                for (auto& callback : on_cell_select_) {
-                  callback(r, c);
-                }
-              });
-            }
-          });
+void Table::UpdateHeader() {
+  for (int i = 0; i < static_cast<int>(header_label_nodes_.size()); ++i) {
+    std::string title = columns_[i].title;
+    if (i == sorted_column_index_) title += sort_ascending_ ? " ▲" : " ▼";
+    header_label_nodes_[i]->Get<Label>()->SetText(title);
+  }
+}
 
-      cell_nodes_[r][c] = cell_node;
-      row_cells.push_back(cell_node);
+void Table::UpdateRows() {
+  auto rows = rows_container_.lock();
+  if (!rows) return;
+
+  if (is_virtualized_) MeasureRowHeight();
+
+  number_of_rows_ = data_source_->GetNumberOfRows();
+  int first_row = 0;
+  int rows_to_bind = number_of_rows_;
+
+  auto scroll_container = scroll_container_.lock();
+  if (is_virtualized_ && scroll_container) {
+    bound_viewport_height_ = scroll_container->ContainerSize().height;
+    if (row_height_ > 0.0f) {
+      // The pool size only depends on the viewport height, so scrolling only
+      // rebinds rows and never creates or destroys them.
+      int visible_rows =
+          static_cast<int>(std::ceil(bound_viewport_height_ / row_height_)) + 1;
+      rows_to_bind =
+          std::min(number_of_rows_, visible_rows + 2 * kOverscanRows);
+      int top_row = static_cast<int>(scroll_container->ContentPosition().y /
+                                     row_height_);
+      first_row = std::clamp(top_row - kOverscanRows, 0,
+                             number_of_rows_ - rows_to_bind);
+    } else {
+      // Bind enough rows to measure and fill the first screen.
+      rows_to_bind = std::min(number_of_rows_, kRowsBeforeMeasuring);
     }
+  }
+
+  if (first_row != first_bound_row_) {
+    // The row under the mouse is now showing different data. It'll be hovered
+    // again when the mouse next moves.
+    hovered_row_index_ = -1;
+    hovered_col_index_ = -1;
+    first_bound_row_ = first_row;
+  }
+  if (hovered_row_index_ >= number_of_rows_) {
+    hovered_row_index_ = -1;
+    hovered_col_index_ = -1;
+  }
+
+  while (static_cast<int>(row_nodes_.size()) > rows_to_bind) {
+    rows->RemoveChild(row_nodes_.back());
+    row_nodes_.pop_back();
+    cell_nodes_.pop_back();
+    cell_label_nodes_.pop_back();
+  }
+  std::vector<std::shared_ptr<Node>> new_row_nodes;
+  while (static_cast<int>(row_nodes_.size()) < rows_to_bind)
+    new_row_nodes.push_back(CreateRowNode(static_cast<int>(row_nodes_.size())));
+  if (!new_row_nodes.empty()) rows->AddChildren(new_row_nodes);
+
+  CellHighlightability hovered_highlightability = HoveredHighlightability();
+  for (int slot = 0; slot < static_cast<int>(row_nodes_.size()); ++slot)
+    BindRow(slot, hovered_highlightability);
+
+  // Pad out the rows that aren't bound so the scroll bar and scroll position
+  // act as if every row were there.
+  if (is_virtualized_ && row_height_ > 0.0f) {
+    rows->GetLayout().SetPadding(YGEdgeTop, first_bound_row_ * row_height_);
+    rows->GetLayout().SetHeight(number_of_rows_ * row_height_);
+  } else {
+    rows->GetLayout().SetPadding(YGEdgeTop, 0.0f);
+    rows->GetLayout().SetHeightAuto();
+  }
+}
+
+void Table::UpdateRowsIfViewportChanged() {
+  if (!is_virtualized_) return;
+
+  bool changed = MeasureRowHeight();
+  if (auto scroll_container = scroll_container_.lock()) {
+    if (scroll_container->ContainerSize().height != bound_viewport_height_)
+      changed = true;
+  }
+
+  // Nodes can't be added or removed while drawing.
+  if (!changed) return;
+  std::weak_ptr<Table> weak_this = shared_from_this();
+  ::perception::Defer([weak_this]() {
+    if (auto strong_this = weak_this.lock()) strong_this->UpdateRows();
+  });
+}
 
-    auto row_node = Node::Empty(
+bool Table::MeasureRowHeight() {
+  if (row_height_ > 0.0f || row_nodes_.empty()) return false;
+  float row_height = row_nodes_[0]->GetLayout().GetCalculatedHeight();
+  if (row_height > 0.0f) {
+    row_height_ = row_height;
+    return true;
+  }
+  return false;
+}
+
+std::shared_ptr<Node> Table::CreateRowNode(int slot) {
+  std::weak_ptr<Table> weak_this = shared_from_this();
+  std::vector<std::shared_ptr<Node>> row_cells;
+  std::vector<std::shared_ptr<Node>> row_labels;
+
+  for (int c = 0; c < static_cast<int>(columns_.size()); ++c) {
+    auto label_node = Node::Empty([](Label& label) {
+      label.SetTextAlignment(TextAlignment::MiddleLeft);
+      label.SetColor(kTableCellTextColor);
+    });
+    auto cell_node = Node::Empty(
+        columns_[c].layout_modifier,
         [](Block& block) { block.SetFillColor(kTableCellTransparentColor); },
         [](Layout& layout) {
-          layout.SetFlexDirection(YGFlexDirectionRow);
-          layout.SetWidthPercent(100.0f);
+          layout.SetPadding(YGEdgeHorizontal, kTableCellHorizontalPadding);
+          layout.SetPadding(YGEdgeVertical, kTableCellVerticalPadding);
+        },
+        label_node);
+
+    // The slot's row changes as the table scrolls, so it's looked up when
+    // the event happens.
+    cell_node->OnMouseHover([weak_this, slot, c](const Point& point) {
+      if (auto strong_this = weak_this.lock())
+        strong_this->HoverCell(strong_this->first_bound_row_ + slot, c);
+    });
+    cell_node->OnMouseLeave([weak_this, slot, c]() {
+      if (auto strong_this = weak_this.lock())
+        strong_this->LeaveCell(strong_this->first_bound_row_ + slot, c);
+    });
+    cell_node->OnMouseButtonUp(
+        [weak_this, slot, c](const Point& point, window::MouseButton button) {
+          auto strong_this = weak_this.lock();
+          if (!strong_this || button != window::MouseButton::Left) return;
+          int r = strong_this->first_bound_row_ + slot;
+          ::perception::Defer([weak_this, r, c]() {
+            auto strong_this = weak_this.lock();
+            if (!strong_this) return;
+            for (auto& callback : strong_this->on_cell_select_) {
+              callback(r, c);
+            }
+          });
         });
-    row_node->AddChildren(row_cells);
-    row_nodes_.push_back(row_node);
-    row_nodes.push_back(row_node);
+
+    row_cells.push_back(cell_node);
+    row_labels.push_back(label_node);
+  }
+
+  auto row_node = Node::Empty(
+      [](Block& block) { block.SetFillColor(kTableCellTransparentColor); },
+      [](Layout& layout) {
+        layout.SetFlexDirection(YGFlexDirectionRow);
+        layout.SetWidthPercent(100.0f);
+      });
+  row_node->AddChildren(row_cells);
+
+  row_nodes_.push_back(row_node);
+  cell_nodes_.push_back(std::move(row_cells));
+  cell_label_nodes_.push_back(std::move(row_labels));
+  return row_node;
+}
+
+void Table::BindRow(int slot, CellHighlightability hovered_highlightability) {
+  int r = first_bound_row_ + slot;
+
+  row_nodes_[slot]->Get<Block>()->SetFillColor(
+      hovered_highlightability == CellHighlightability::RowHighlightable &&
+              r == hovered_row_index_
+          ? kTableCellHighlightColor
+          : kTableCellTransparentColor);
+
+  for (int c = 0; c < static_cast<int>(columns_.size()); ++c) {
+    // Labels and blocks ignore values that haven't changed, so only the cells
+    // that changed get measured and drawn again.
+    cell_label_nodes_[slot][c]->Get<Label>()->SetText(
+        data_source_->GetCellValue(r, c));
+
+    bool highlighted =
+        (hovered_highlightability == CellHighlightability::CellHighlightable &&
+         r == hovered_row_index_ && c == hovered_col_index_) ||
+        (hovered_highlightability ==
+             CellHighlightability::ColumnHighlightable &&
+         c == hovered_col_index_);
+    cell_nodes_[slot][c]->Get<Block>()->SetFillColor(
+        highlighted ? kTableCellHighlightColor : kTableCellTransparentColor);
   }
-  rows->AddChildren(row_nodes);
+}
+
+int Table::SlotForRow(int row) const {
+  int slot = row - first_bound_row_;
+  if (slot < 0 || slot >= static_cast<int>(row_nodes_.size())) return -1;
+  return slot;
+}
+
+CellHighlightability Table::HoveredHighlightability() {
+  if (hovered_row_index_ == -1 || hovered_col_index_ == -1)
+    return CellHighlightability::NotHighlightable;
+  return data_source_->GetCellHighlightablity(hovered_row_index_,
+                                              hovered_col_index_);
+}
+
+void Table::SetRowFillColor(int row, uint32 color) {
+  int slot = SlotForRow(row);
+  if (slot == -1) return;
+  row_nodes_[slot]->Get<Block>()->SetFillColor(color);
+}
+
+void Table::SetCellFillColor(int row, int col, uint32 color) {
+  int slot = SlotForRow(row);
+  if (slot == -1) return;
+  cell_nodes_[slot][col]->Get<Block>()->SetFillColor(color);
+}
+
+void Table::SetColumnFillColor(int col, uint32 color) {
+  for (auto& row_cells : cell_nodes_)
+    row_cells[col]->Get<Block>()->SetFillColor(color);
 }
 
 void Table::HoverCell(int r, int c) {
@@ -223,22 +408,11 @@ void Table::HoverCell(int r, int c) {
   }
 
   if (new_selectability == CellHighlightability::CellHighlightable) {
-    if (auto block = cell_nodes_[r][c]->Get<Block>()) {
-      block->SetFillColor(kTableCellHighlightColor);
-      cell_nodes_[r][c]->Invalidate();
-    }
+    SetCellFillColor(r, c, kTableCellHighlightColor);
   } else if (new_selectability == CellHighlightability::RowHighlightable) {
-    if (auto block = row_nodes_[r]->Get<Block>()) {
-      block->SetFillColor(kTableCellHighlightColor);
-      row_nodes_[r]->Invalidate();
-    }
+    SetRowFillColor(r, kTableCellHighlightColor);
   } else if (new_selectability == CellHighlightability::ColumnHighlightable) {
-    for (int row = 0; row < static_cast<int>(cell_nodes_.size()); ++row) {
-      if (auto block = cell_nodes_[row][c]->Get<Block>()) {
-        block->SetFillColor(kTableCellHighlightColor);
-        cell_nodes_[row][c]->Invalidate();
-      }
-    }
+    SetColumnFillColor(c, kTableCellHighlightColor);
   }
 }
 
@@ -271,22 +445,11 @@ void Table::LeaveCell(int r, int c) {
   if (selectability == CellHighlightability::NotHighlightable) return;
 
   if (selectability == CellHighlightability::CellHighlightable) {
-    if (auto block = cell_nodes_[r][c]->Get<Block>()) {
-      block->SetFillColor(kTableCellTransparentColor);
-      cell_nodes_[r][c]->Invalidate();
-    }
+    SetCellFillColor(r, c, kTableCellTransparentColor);
   } else if (selectability == CellHighlightability::RowHighlightable) {
-    if (auto block = row_nodes_[r]->Get<Block>()) {
-      block->SetFillColor(kTableCellTransparentColor);
-      row_nodes_[r]->Invalidate();
-    }
+    SetRowFillColor(r, kTableCellTransparentColor);
   } else if (selectability == CellHighlightability::ColumnHighlightable) {
-    for (int row = 0; row < static_cast<int>(cell_nodes_.size()); ++row) {
-      if (auto block = cell_nodes_[row][c]->Get<Block>()) {
-        block->SetFillColor(kTableCellTransparentColor);
-        cell_nodes_[row][c]->Invalidate();
-      }
-    }
+    SetColumnFillColor(c, kTableCellTransparentColor);
   }
 }
 
@@ -0,0 +1,180 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "perception/ui/components/table.h"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "perception/ui/components/label.h"
+#include "perception/ui/components/scroll_container.h"
+#include "perception/ui/layout.h"
+#include "perception/ui/node.h"
+#include "testing.h"
+
+namespace {
+
+using ::perception::ui::Layout;
+using ::perception::ui::Node;
+using ::perception::ui::components::Label;
+using ::perception::ui::components::ScrollContainer;
+using ::perception::ui::components::Table;
+
+// A single column table whose cells read "Row <index>".
+class RowsDataSource : public Table::DataSource {
+ public:
+  explicit RowsDataSource(int number_of_rows)
+      : number_of_rows(number_of_rows) {}
+
+  int number_of_rows;
+  std::string prefix = "Row ";
+
+  int GetNumberOfRows() override { return number_of_rows; }
+
+  std::string GetCellValue(int row_index, int column_index) override {
+    return prefix + std::to_string(row_index);
+  }
+
+  void SortByColumn(int column_index, bool ascending) override {}
+};
+
+// Returns a table that's 400x200, showing `data_source`.
+std::shared_ptr<Node> CreateTable(
+    std::shared_ptr<RowsDataSource> data_source) {
+  std::vector<Table::Column> columns = {
+      {.title = "Name",
+       .layout_modifier = [](Layout& layout) { layout.SetFlexGrow(1.0f); }}};
+  return Table::BasicTable(data_source, columns, [](Layout& layout) {
+    layout.SetWidth(400.0f);
+    layout.SetHeight(200.0f);
+  });
+}
+
+// Adds the label nodes under `node` whose text starts with `prefix`.
+void FindCellLabels(Node& node, std::string_view prefix,
+                    std::vector<Node*>& labels) {
+  if (auto label = node.Get<Label>()) {
+    if (label->GetText().starts_with(prefix)) labels.push_back(&node);
+  }
+  for (const auto& child : node.GetChildren())
+    FindCellLabels(*child, prefix, labels);
+}
+
+// Returns the text of each cell label under `node`, in order.
+std::vector<std::string> CellTexts(Node& node, std::string_view prefix) {
+  std::vector<Node*> labels;
+  FindCellLabels(node, prefix, labels);
+  std::vector<std::string> texts;
+  for (Node* label : labels)
+    texts.push_back(std::string(label->Get<Label>()->GetText()));
+  return texts;
+}
+
+// Returns the node with the scroll container that the table's rows are in.
+std::shared_ptr<Node> FindScrollContainerNode(std::shared_ptr<Node> node) {
+  if (node->Get<ScrollContainer>()) return node;
+  for (const auto& child : node->GetChildren()) {
+    if (auto scroll_container_node = FindScrollContainerNode(child))
+      return scroll_container_node;
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+TEST(TableRebindsRowNodesOnRefresh) {
+  auto data_source = std::make_shared<RowsDataSource>(3);
+  auto table_node = CreateTable(data_source);
+
+  std::vector<Node*> labels_before;
+  FindCellLabels(*table_node, "Row ", labels_before);
+  std::vector<std::string> expected = {"Row 0", "Row 1", "Row 2"};
+  EXPECT(true, expected == CellTexts(*table_node, "Row "));
+
+  // The same nodes show the new values.
+  data_source->prefix = "Item ";
+  table_node->Get<Table>()->Refresh();
+  std::vector<Node*> labels_after;
+  FindCellLabels(*table_node, "Item ", labels_after);
+  EXPECT(true, labels_before == labels_after);
+  expected = {"Item 0", "Item 1", "Item 2"};
+  EXPECT(true, expected == CellTexts(*table_node, "Item "));
+
+  // Rows are added and removed from the end of the pool.
+  data_source->number_of_rows = 5;
+  table_node->Get<Table>()->Refresh();
+  EXPECT((size_t)5, CellTexts(*table_node, "Item ").size());
+  data_source->number_of_rows = 2;
+  table_node->Get<Table>()->Refresh();
+  std::vector<Node*> labels_shrunk;
+  FindCellLabels(*table_node, "Item ", labels_shrunk);
+  ASSERT((size_t)2, labels_shrunk.size());
+  EXPECT(labels_before[0], labels_shrunk[0]);
+  EXPECT(labels_before[1], labels_shrunk[1]);
+}
+
+TEST(VirtualizedTableRebindsPooledRowsWhileScrolling) {
+  constexpr int kNumberOfRows = 1000;
+  auto data_source = std::make_shared<RowsDataSource>(kNumberOfRows);
+  auto table_node = CreateTable(data_source);
+  auto table = table_node->Get<Table>();
+  table->SetIsVirtualized(true);
+
+  // Once the rows have been laid out, the pool shrinks to what fits in the
+  // viewport.
+  table_node->GetLayout().Calculate(400.0f, 200.0f);
+  table->Refresh();
+  table_node->GetLayout().Calculate(400.0f, 200.0f);
+
+  std::vector<Node*> labels_at_top;
+  FindCellLabels(*table_node, "Row ", labels_at_top);
+  ASSERT(true, !labels_at_top.empty());
+  EXPECT(true, labels_at_top.size() < (size_t)64);
+  std::vector<std::string> texts = CellTexts(*table_node, "Row ");
+  EXPECT("Row 0", texts.front());
+  EXPECT("Row " + std::to_string(texts.size() - 1), texts.back());
+
+  // Scrolling to the bottom shows the last rows in the same nodes.
+  auto scroll_container_node = FindScrollContainerNode(table_node);
+  ASSERT(true, scroll_container_node != nullptr);
+  scroll_container_node->Get<ScrollContainer>()->SetContentPosition(
+      {.x = 0.0f, .y = 1000000.0f});
+
+  std::vector<Node*> labels_at_bottom;
+  FindCellLabels(*table_node, "Row ", labels_at_bottom);
+  EXPECT(true, labels_at_top == labels_at_bottom);
+  texts = CellTexts(*table_node, "Row ");
+  EXPECT("Row " + std::to_string(kNumberOfRows - 1), texts.back());
+  EXPECT("Row " + std::to_string(kNumberOfRows - texts.size()),
+         texts.front());
+}
+
+TEST(ScrollingAfterTheTableIsGoneIsIgnored) {
+  auto data_source = std::make_shared<RowsDataSource>(1000);
+  auto table_node = CreateTable(data_source);
+  table_node->Get<Table>()->SetIsVirtualized(true);
+  table_node->GetLayout().Calculate(400.0f, 200.0f);
+
+  // The scroll container's callbacks don't keep the table alive.
+  auto scroll_container_node = FindScrollContainerNode(table_node);
+  ASSERT(true, scroll_container_node != nullptr);
+  std::weak_ptr<Table> table = table_node->Get<Table>();
+  table_node.reset();
+  EXPECT(true, table.expired());
+
+  scroll_container_node->Get<ScrollContainer>()->SetContentPosition(
+      {.x = 0.0f, .y = 100.0f});
+}
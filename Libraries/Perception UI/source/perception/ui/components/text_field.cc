@@ -1080,75 +1080,48 @@ void TextField::LayoutLinesIfNeeded(float max_width) {
   last_layout_width_ = max_width;
   layout_is_dirty_ = false;
 
-  for (size_t p = 0; p < lines_.size(); p++) {
-    const std::string& para = lines_[p];
-    if (para.empty()) {
-      laid_out_lines_.push_back({p, 0, 0, 0.0f});
-      continue;
-    }
-
-    if (!word_wrap_ || max_width <= 0.0f) {
-      float w =
-          font_->measureText(para.data(), para.length(), SkTextEncoding::kUTF8);
-      laid_out_lines_.push_back({p, 0, para.length(), w});
-      continue;
-    }
-
-    size_t line_start = 0;
-    size_t idx = 0;
-    while (idx < para.length()) {
-      size_t next_space = para.find(' ', idx);
-      size_t word_end =
-          (next_space == std::string::npos) ? para.length() : next_space + 1;
-
-      std::string_view test_line =
-          std::string_view(para).substr(line_start, word_end - line_start);
-      float w = font_->measureText(test_line.data(), test_line.length(),
-                                   SkTextEncoding::kUTF8);
-
-      if (w <= max_width) {
-        idx = word_end;
-      } else {
-        if (idx == line_start) {
-          size_t c_idx = line_start;
-          while (c_idx < word_end) {
-            size_t c_len = GetNextUtf8CharLength(para, c_idx);
-            if (c_len == 0) break;
-            std::string_view c_line = std::string_view(para).substr(
-                line_start, (c_idx + c_len) - line_start);
-            float cw = font_->measureText(c_line.data(), c_line.length(),
-                                          SkTextEncoding::kUTF8);
-            if (cw <= max_width || c_idx == line_start) {
-              c_idx += c_len;
-            } else {
-              std::string_view final_line =
-                  std::string_view(para).substr(line_start, c_idx - line_start);
-              float fw =
-                  font_->measureText(final_line.data(), final_line.length(),
-                                     SkTextEncoding::kUTF8);
-              laid_out_lines_.push_back({p, line_start, c_idx, fw});
-              line_start = c_idx;
-            }
-          }
-          idx = word_end;
-        } else {
-          std::string_view final_line =
-              std::string_view(para).substr(line_start, idx - line_start);
-          float fw = font_->measureText(final_line.data(), final_line.length(),
-                                        SkTextEncoding::kUTF8);
-          laid_out_lines_.push_back({p, line_start, idx, fw});
-          line_start = idx;
-        }
-      }
-    }
+  float wrap_width = word_wrap_ ? max_width : 0.0f;
+  auto is_unchanged = [&](const WrappedParagraph& wrapped,
+                          const std::string& paragraph) {
+    return wrapped.font == font_ && wrapped.max_width == wrap_width &&
+           wrapped.text == paragraph;
+  };
+
+  // Edits touch a run of paragraphs, so the paragraphs before and after it
+  // keep how they were wrapped, even if paragraphs were added or removed.
+  std::vector<WrappedParagraph> old_paragraphs = std::move(wrapped_paragraphs_);
+  size_t unchanged_before = 0;
+  while (unchanged_before < old_paragraphs.size() &&
+         unchanged_before < lines_.size() &&
+         is_unchanged(old_paragraphs[unchanged_before],
+                      lines_[unchanged_before]))
+    unchanged_before++;
+  size_t unchanged_after = 0;
+  while (unchanged_before + unchanged_after < old_paragraphs.size() &&
+         unchanged_before + unchanged_after < lines_.size() &&
+         is_unchanged(
+             old_paragraphs[old_paragraphs.size() - 1 - unchanged_after],
+             lines_[lines_.size() - 1 - unchanged_after]))
+    unchanged_after++;
+
+  wrapped_paragraphs_.clear();
+  wrapped_paragraphs_.reserve(lines_.size());
+  for (size_t p = 0; p < unchanged_before; p++)
+    wrapped_paragraphs_.push_back(std::move(old_paragraphs[p]));
+  for (size_t p = unchanged_before; p < lines_.size() - unchanged_after; p++) {
+    wrapped_paragraphs_.push_back(
+        {.text = lines_[p],
+         .font = font_,
+         .max_width = wrap_width,
+         .lines = WrapParagraph(lines_[p], font_, wrap_width)});
+  }
+  for (size_t p = old_paragraphs.size() - unchanged_after;
+       p < old_paragraphs.size(); p++)
+    wrapped_paragraphs_.push_back(std::move(old_paragraphs[p]));
 
-    if (line_start < para.length()) {
-      std::string_view final_line =
-          std::string_view(para).substr(line_start, para.length() - line_start);
-      float fw = font_->measureText(final_line.data(), final_line.length(),
-                                    SkTextEncoding::kUTF8);
-      laid_out_lines_.push_back({p, line_start, para.length(), fw});
-    }
+  for (size_t p = 0; p < wrapped_paragraphs_.size(); p++) {
+    for (const WrappedLine& line : wrapped_paragraphs_[p].lines)
+      laid_out_lines_.push_back({p, line.start, line.end, line.width});
   }
 }
 
@@ -377,10 +377,7 @@ void TreeView::HandleKeyDown(const window::KeyboardKeyEvent& event) {
 
   if (key == KeyCode::RightArrow) {
     if (!item->IsExpanded()) {
-      auto children = item->GetChildrenContainer();
-      if (children && !children->GetChildren().empty()) {
-        item->SetExpanded(true);
-      }
+      if (item->HasChildren()) item->SetExpanded(true);
     } else {
       for (size_t i = 0; i < visible_items.size(); ++i) {
         if (visible_items[i] == item) {
@@ -712,6 +709,14 @@ void TreeViewItem::SetExpanded(bool expanded) {
   is_expanded_ = expanded;
 
   if (auto children = children_container_.lock()) {
+    if (is_expanded_ && children_provider_) {
+      // Moved out first, since building the children could set a new one.
+      auto children_provider = std::move(children_provider_);
+      children_provider_ = nullptr;
+      for (const auto& child : children_provider()) {
+        if (child) children->AddChild(child);
+      }
+    }
     children->GetLayout().SetDisplay(is_expanded_ ? YGDisplayFlex
                                                   : YGDisplayNone);
   }
@@ -727,6 +732,18 @@ void TreeViewItem::SetExpanded(bool expanded) {
 
 bool TreeViewItem::IsExpanded() const { return is_expanded_; }
 
+void TreeViewItem::SetChildrenProvider(
+    std::function<std::vector<std::shared_ptr<Node>>()> children_provider) {
+  children_provider_ = children_provider;
+  if (!node_.expired()) node_.lock()->Invalidate();
+}
+
+bool TreeViewItem::HasChildren() const {
+  if (children_provider_) return true;
+  auto children = children_container_.lock();
+  return children && !children->GetChildren().empty();
+}
+
 void TreeViewItem::Select(bool scroll_into_view, bool notify_listener) {
   if (node_.expired()) return;
   auto strong_node = node_.lock();
@@ -923,8 +940,7 @@ std::shared_ptr<Node> TreeViewItem::GetContentContainer() const {
 }
 
 void TreeViewItem::DrawToggle(const DrawContext& draw_context) {
-  auto children = children_container_.lock();
-  if (!children || children->GetChildren().empty()) return;
+  if (!HasChildren()) return;
 
   SkPaint paint;
   paint.setAntiAlias(true);
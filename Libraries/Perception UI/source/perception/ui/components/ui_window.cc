@@ -14,6 +14,7 @@
 
 #include "perception/ui/components/ui_window.h"
 
+#include <cmath>
 #include <iostream>
 #include <mutex>
 #include <set>
@@ -21,6 +22,7 @@
 #include "include/core/SkCanvas.h"
 #include "include/core/SkColorSpace.h"
 #include "include/core/SkGraphics.h"
+#include "include/core/SkRegion.h"
 #include "include/core/SkSurface.h"
 #include "perception/debug.h"
 #include "perception/draw.h"
@@ -231,7 +233,9 @@ void UiWindow::SetNode(std::weak_ptr<Node> node) {
   node_ = node;
   if (node_.expired()) return;
   auto strong_node = node_.lock();
-  strong_node->OnInvalidate(std::bind_front(&UiWindow::InvalidateRender, this));
+  strong_node->OnInvalidate(std::bind_front(&UiWindow::ScheduleDraw, this));
+  strong_node->OnInvalidateArea(
+      std::bind_front(&UiWindow::InvalidateArea, this));
   InvalidateRender();
 }
 
@@ -598,8 +602,13 @@ void UiWindow::Draw() {
 
   if (!invalidated_) return;
   invalidated_ = false;
-  if (base_window_) {
+  if (!base_window_) return;
+
+  UpdateLayout();
+  if (damage_tracker_.IsEverythingDamaged()) {
     base_window_->Present();
+  } else if (!damage_tracker_.GetDamagedAreas().empty()) {
+    base_window_->Present(GetDamagedPixels());
   }
 }
 
@@ -617,6 +626,11 @@ void UiWindow::GetNodesAt(
 }
 
 void UiWindow::InvalidateRender() {
+  damage_tracker_.DamageEverything();
+  ScheduleDraw();
+}
+
+void UiWindow::ScheduleDraw() {
   if (invalidated_ && !is_drawing_) {
     return;
   }
@@ -627,6 +641,42 @@ void UiWindow::InvalidateRender() {
   DeferAfterEvents([self]() { self->Draw(); });
 }
 
+void UiWindow::InvalidateArea(const Rectangle& area) {
+  damage_tracker_.Damage(area);
+  ScheduleDraw();
+}
+
+void UiWindow::UpdateLayout() {
+  auto node = node_.lock();
+  if (!node) return;
+
+  float scale = GetScale();
+  float logical_width = (float)buffer_width_ / scale;
+  float logical_height = (float)buffer_height_ / scale;
+
+  Layout layout = node->GetLayout();
+  layout.SetWidth(logical_width);
+  layout.SetHeight(logical_height);
+  layout.CalculateIfDirty(logical_width, logical_height);
+
+  damage_tracker_.UpdateNodeAreas(
+      node, {.origin = {.x = 0.0f, .y = 0.0f},
+             .size = {.width = logical_width, .height = logical_height}});
+}
+
+window::Rectangle UiWindow::GetDamagedPixels() const {
+  float scale = GetScale();
+  const auto& damaged_areas = damage_tracker_.GetDamagedAreas();
+  Rectangle bounds = damaged_areas.front();
+  for (const Rectangle& damaged_area : damaged_areas)
+    bounds = bounds.Union(damaged_area);
+  return window::Rectangle(
+      std::max(0, (int)std::floor(bounds.MinX() * scale)),
+      std::max(0, (int)std::floor(bounds.MinY() * scale)),
+      std::min(buffer_width_, (int)std::ceil(bounds.MaxX() * scale)),
+      std::min(buffer_height_, (int)std::ceil(bounds.MaxY() * scale)));
+}
+
 void UiWindow::WindowDraw(const window::WindowDrawBuffer& buffer,
                           window::Rectangle& invalidated_area) {
   std::scoped_lock lock(window_mutex_);
@@ -650,12 +700,49 @@ void UiWindow::WindowDraw(const window::WindowDrawBuffer& buffer,
                 << buffer_height_ << std::endl;
       return;
     }
+    // The new buffer has nothing in it.
+    damage_tracker_.DamageEverything();
+    UpdateLayout();
   }
+  if (!buffer.has_preserved_contents_from_previous_draw)
+    damage_tracker_.DamageEverything();
 
   float scale = GetScale();
   float logical_width = (float)buffer_width_ / scale;
   float logical_height = (float)buffer_height_ / scale;
 
+  // Work out which pixels to redraw. Anything invalidated while drawing is
+  // left for the next draw.
+  SkRegion damaged_pixels;
+  if (damage_tracker_.IsEverythingDamaged()) {
+    damaged_pixels.setRect(SkIRect::MakeWH(buffer_width_, buffer_height_));
+  } else {
+    SkIRect invalidated_pixels =
+        SkIRect::MakeLTRB(invalidated_area.min_x, invalidated_area.min_y,
+                          invalidated_area.max_x, invalidated_area.max_y);
+    const auto& damaged_areas = damage_tracker_.GetDamagedAreas();
+    if (damaged_areas.empty()) {
+      // Someone else asked for this area to be redrawn.
+      damaged_pixels.setRect(invalidated_pixels);
+    }
+    for (const Rectangle& damaged_area : damaged_areas) {
+      SkIRect pixels = SkIRect::MakeLTRB(
+          (int)std::floor(damaged_area.MinX() * scale),
+          (int)std::floor(damaged_area.MinY() * scale),
+          (int)std::ceil(damaged_area.MaxX() * scale),
+          (int)std::ceil(damaged_area.MaxY() * scale));
+      if (pixels.intersect(invalidated_pixels))
+        damaged_pixels.op(pixels, SkRegion::kUnion_Op);
+    }
+  }
+  damage_tracker_.Clear();
+
+  const SkIRect& bounds = damaged_pixels.getBounds();
+  invalidated_area =
+      window::Rectangle(bounds.left(), bounds.top(), bounds.right(),
+                        bounds.bottom());
+  if (damaged_pixels.isEmpty()) return;
+
   // Set up the DrawContext to draw into back buffer.
   DrawContext draw_context;
   draw_context.buffer = static_cast<uint32*>(pixel_data_);
@@ -666,19 +753,24 @@ void UiWindow::WindowDraw(const window::WindowDrawBuffer& buffer,
   draw_context.area = {
       .origin = {.x = 0.0f, .y = 0.0f},
       .size = {.width = logical_width, .height = logical_height}};
-  draw_context.clipping_bounds = draw_context.area;
-
-  if (background_color_) {
-    FillRectangle(0, 0, buffer_width_, buffer_height_, background_color_,
-                  draw_context.buffer, draw_context.buffer_width,
-                  draw_context.buffer_height);
+  draw_context.clipping_bounds = Rectangle::FromMinMaxPoints(
+      {.x = bounds.left() / scale, .y = bounds.top() / scale},
+      {.x = bounds.right() / scale, .y = bounds.bottom() / scale});
+
+  for (SkRegion::Iterator itr(damaged_pixels); !itr.done(); itr.next()) {
+    const SkIRect& pixels = itr.rect();
+    if (background_color_) {
+      FillRectangle(pixels.left(), pixels.top(), pixels.right(),
+                    pixels.bottom(), background_color_, draw_context.buffer,
+                    draw_context.buffer_width, draw_context.buffer_height);
+    }
+    if (!damaged_pixels.isRect()) {
+      draw_context.damaged_areas.push_back(Rectangle::FromMinMaxPoints(
+          {.x = pixels.left() / scale, .y = pixels.top() / scale},
+          {.x = pixels.right() / scale, .y = pixels.bottom() / scale}));
+    }
   }
 
-  Layout layout = node->GetLayout();
-  layout.SetWidth(logical_width);
-  layout.SetHeight(logical_height);
-  layout.CalculateIfDirty(logical_width, logical_height);
-
   float root_w = node->GetLayout().GetCalculatedWidth();
   float root_h = node->GetLayout().GetCalculatedHeight();
   if (root_w <= 0.0f || root_h <= 0.0f) {
@@ -687,17 +779,13 @@ void UiWindow::WindowDraw(const window::WindowDrawBuffer& buffer,
   }
 
   draw_context.skia_canvas->save();
+  draw_context.skia_canvas->clipRegion(damaged_pixels);
   draw_context.skia_canvas->scale(scale, scale);
 
   is_drawing_ = true;
   node->Draw(draw_context);
   is_drawing_ = false;
   draw_context.skia_canvas->restore();
-
-  if (skia_surface_) {
-    SkPixmap pixmap;
-    skia_surface_->peekPixels(&pixmap);
-  }
 }
 
 void UiWindow::Create() {
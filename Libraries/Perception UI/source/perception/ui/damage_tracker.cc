@@ -0,0 +1,115 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "perception/ui/damage_tracker.h"
+
+#include "perception/ui/layout.h"
+#include "perception/ui/node.h"
+
+namespace perception {
+namespace ui {
+
+DamageTracker::DamageTracker() : everything_damaged_(true) {}
+
+void DamageTracker::DamageEverything() {
+  everything_damaged_ = true;
+  damaged_areas_.clear();
+}
+
+bool DamageTracker::IsEverythingDamaged() const { return everything_damaged_; }
+
+void DamageTracker::Damage(const Rectangle& area) {
+  // Sizes are NaN before the first layout, so only accept positive sizes.
+  if (everything_damaged_ || !(area.Width() > 0.0f) || !(area.Height() > 0.0f))
+    return;
+
+  for (const Rectangle& damaged_area : damaged_areas_) {
+    if (damaged_area.Contains(area)) return;
+  }
+  std::erase_if(damaged_areas_, [&area](const Rectangle& damaged_area) {
+    return area.Contains(damaged_area);
+  });
+  damaged_areas_.push_back(area);
+
+  if (damaged_areas_.size() > kMaxDamagedAreas) {
+    // Too many to be worth clipping to, so redraw everything around them.
+    Rectangle bounds = damaged_areas_.front();
+    for (const Rectangle& damaged_area : damaged_areas_)
+      bounds = bounds.Union(damaged_area);
+    damaged_areas_ = {bounds};
+  }
+}
+
+void DamageTracker::UpdateNodeAreas(const std::shared_ptr<Node>& root,
+                                    const Rectangle& window_area) {
+  std::unordered_map<const Node*, DrawnNode> drawn_nodes;
+  drawn_nodes.reserve(drawn_nodes_.size());
+  if (root)
+    RecordNodeAreas(root, window_area.origin, window_area, drawn_nodes);
+
+  // Compare against where everything was last time. A node that has been
+  // destroyed might share an address with a new node, so nodes are only the
+  // same if the old one is still alive.
+  for (const auto& [key, drawn_node] : drawn_nodes) {
+    auto itr = drawn_nodes_.find(key);
+    if (itr == drawn_nodes_.end()) {
+      Damage(drawn_node.area);
+      continue;
+    }
+    if (itr->second.node.expired() || !(itr->second.area == drawn_node.area)) {
+      Damage(itr->second.area);
+      Damage(drawn_node.area);
+    }
+    drawn_nodes_.erase(itr);
+  }
+  // Whatever is left has been removed or hidden.
+  for (const auto& [key, drawn_node] : drawn_nodes_) Damage(drawn_node.area);
+
+  drawn_nodes_ = std::move(drawn_nodes);
+}
+
+const std::vector<Rectangle>& DamageTracker::GetDamagedAreas() const {
+  return damaged_areas_;
+}
+
+void DamageTracker::Clear() {
+  everything_damaged_ = false;
+  damaged_areas_.clear();
+}
+
+void DamageTracker::RecordNodeAreas(
+    const std::shared_ptr<Node>& node, const Point& parent_origin,
+    const Rectangle& clipping_bounds,
+    std::unordered_map<const Node*, DrawnNode>& drawn_nodes) {
+  if (node->IsHidden()) return;
+  Rectangle area = node->GetAreaRelativeToParent();
+  area.origin += parent_origin;
+
+  auto visible_area = area.Intersection(clipping_bounds);
+  if (!visible_area || visible_area->Width() <= 0.0f ||
+      visible_area->Height() <= 0.0f)
+    return;
+  drawn_nodes[node.get()] = {.node = node, .area = *visible_area};
+
+  Rectangle children_clipping_bounds =
+      node->GetLayout().GetOverflow() != YGOverflowVisible ? *visible_area
+                                                           : clipping_bounds;
+  Point children_origin = area.origin - node->GetOffset();
+  for (const auto& child : node->GetChildren())
+    RecordNodeAreas(child, children_origin, children_clipping_bounds,
+                    drawn_nodes);
+}
+
+}  // namespace ui
+}  // namespace perception
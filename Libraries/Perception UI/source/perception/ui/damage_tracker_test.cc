@@ -0,0 +1,186 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "perception/ui/damage_tracker.h"
+
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "perception/ui/layout.h"
+#include "perception/ui/node.h"
+#include "perception/ui/rectangle.h"
+#include "testing.h"
+
+namespace {
+
+using ::perception::ui::DamageTracker;
+using ::perception::ui::Layout;
+using ::perception::ui::Node;
+using ::perception::ui::Rectangle;
+
+const Rectangle kWindowArea = {.origin = {.x = 0.0f, .y = 0.0f},
+                               .size = {.width = 100.0f, .height = 100.0f}};
+
+Rectangle Area(float x, float y, float width, float height) {
+  return {.origin = {.x = x, .y = y},
+          .size = {.width = width, .height = height}};
+}
+
+// Returns a node filling the window with 10 units of padding around `child`.
+std::shared_ptr<Node> Root(std::shared_ptr<Node> child) {
+  auto root = Node::Empty(
+      [](Layout& layout) {
+        layout.SetWidth(100.0f);
+        layout.SetHeight(100.0f);
+        layout.SetPadding(YGEdgeAll, 10.0f);
+      },
+      child);
+  root->GetLayout().Calculate(100.0f, 100.0f);
+  return root;
+}
+
+// Returns a 20x30 node.
+std::shared_ptr<Node> Leaf() {
+  return Node::Empty([](Layout& layout) {
+    layout.SetWidth(20.0f);
+    layout.SetHeight(30.0f);
+  });
+}
+
+// Returns a tracker that has seen `root` drawn.
+DamageTracker TrackerAfterDrawing(std::shared_ptr<Node> root) {
+  DamageTracker tracker;
+  tracker.UpdateNodeAreas(root, kWindowArea);
+  tracker.Clear();
+  return tracker;
+}
+
+}  // namespace
+
+TEST(DamageTrackerStartsWithEverythingDamaged) {
+  DamageTracker tracker;
+  EXPECT(true, tracker.IsEverythingDamaged());
+
+  tracker.Damage(Area(0.0f, 0.0f, 10.0f, 10.0f));
+  EXPECT(true, tracker.GetDamagedAreas().empty());
+
+  tracker.Clear();
+  EXPECT(false, tracker.IsEverythingDamaged());
+}
+
+TEST(DamageTrackerIgnoresEmptyAndCoveredAreas) {
+  DamageTracker tracker;
+  tracker.Clear();
+
+  tracker.Damage(Area(10.0f, 10.0f, 0.0f, 5.0f));
+  tracker.Damage(Area(10.0f, 10.0f, 20.0f, 20.0f));
+  tracker.Damage(Area(15.0f, 15.0f, 5.0f, 5.0f));
+  tracker.Damage(Area(50.0f, 50.0f, 5.0f, 5.0f));
+  // Replaces the area at 50,50.
+  tracker.Damage(Area(40.0f, 40.0f, 20.0f, 20.0f));
+
+  std::vector<Rectangle> expected = {Area(10.0f, 10.0f, 20.0f, 20.0f),
+                                     Area(40.0f, 40.0f, 20.0f, 20.0f)};
+  EXPECT(expected, tracker.GetDamagedAreas());
+}
+
+TEST(DamageTrackerIgnoresAreasThatHaveNotBeenLaidOut) {
+  DamageTracker tracker;
+  tracker.Clear();
+
+  float nan = std::numeric_limits<float>::quiet_NaN();
+  tracker.Damage(Area(10.0f, 10.0f, nan, 5.0f));
+  tracker.Damage(Area(10.0f, 10.0f, 5.0f, nan));
+  tracker.Damage(Area(nan, nan, nan, nan));
+
+  EXPECT(true, tracker.GetDamagedAreas().empty());
+}
+
+TEST(DamageTrackerMergesTooManyAreas) {
+  DamageTracker tracker;
+  tracker.Clear();
+
+  for (size_t i = 0; i <= DamageTracker::kMaxDamagedAreas; i++)
+    tracker.Damage(Area((float)i * 5.0f, 0.0f, 1.0f, 1.0f));
+
+  std::vector<Rectangle> expected = {
+      Area(0.0f, 0.0f, (float)DamageTracker::kMaxDamagedAreas * 5.0f + 1.0f,
+           1.0f)};
+  EXPECT(expected, tracker.GetDamagedAreas());
+}
+
+TEST(DamageTrackerDamagesNodesThatAppear) {
+  auto root = Root(Leaf());
+  DamageTracker tracker;
+  tracker.Clear();
+
+  tracker.UpdateNodeAreas(root, kWindowArea);
+
+  // The leaf is inside the root.
+  std::vector<Rectangle> expected = {kWindowArea};
+  EXPECT(expected, tracker.GetDamagedAreas());
+}
+
+TEST(DamageTrackerDoesNotDamageNodesThatStayStill) {
+  auto root = Root(Leaf());
+  DamageTracker tracker = TrackerAfterDrawing(root);
+
+  tracker.UpdateNodeAreas(root, kWindowArea);
+
+  EXPECT(true, tracker.GetDamagedAreas().empty());
+}
+
+TEST(DamageTrackerDamagesOldAndNewAreasOfMovedNodes) {
+  auto leaf = Leaf();
+  auto root = Root(leaf);
+  DamageTracker tracker = TrackerAfterDrawing(root);
+
+  leaf->GetLayout().SetMargin(YGEdgeLeft, 40.0f);
+  root->GetLayout().Calculate(100.0f, 100.0f);
+  tracker.UpdateNodeAreas(root, kWindowArea);
+
+  std::vector<Rectangle> expected = {Area(10.0f, 10.0f, 20.0f, 30.0f),
+                                     Area(50.0f, 10.0f, 20.0f, 30.0f)};
+  EXPECT(expected, tracker.GetDamagedAreas());
+}
+
+TEST(DamageTrackerDamagesHiddenNodes) {
+  auto leaf = Leaf();
+  auto root = Root(leaf);
+  DamageTracker tracker = TrackerAfterDrawing(root);
+
+  leaf->GetLayout().SetDisplay(YGDisplayNone);
+  root->GetLayout().Calculate(100.0f, 100.0f);
+  tracker.UpdateNodeAreas(root, kWindowArea);
+
+  std::vector<Rectangle> expected = {Area(10.0f, 10.0f, 20.0f, 30.0f)};
+  EXPECT(expected, tracker.GetDamagedAreas());
+}
+
+TEST(DamageTrackerClipsScrolledNodes) {
+  auto leaf = Leaf();
+  auto root = Root(leaf);
+  root->GetLayout().SetOverflow(YGOverflowHidden);
+  root->GetLayout().Calculate(100.0f, 100.0f);
+  DamageTracker tracker = TrackerAfterDrawing(root);
+
+  // Scrolls the leaf so only its bottom 10 units are inside the root.
+  root->SetOffset({.x = 0.0f, .y = 30.0f});
+  tracker.UpdateNodeAreas(root, kWindowArea);
+
+  std::vector<Rectangle> expected = {Area(10.0f, 10.0f, 20.0f, 30.0f),
+                                     Area(10.0f, 0.0f, 20.0f, 10.0f)};
+  EXPECT(expected, tracker.GetDamagedAreas());
+}
@@ -150,6 +150,14 @@ void Node::Draw(DrawContext& draw_context) {
   draw_context.area.size = position.size;
 
   bool intersects = draw_context.area.Intersects(draw_context.clipping_bounds);
+  if (intersects && !draw_context.damaged_areas.empty()) {
+    intersects = std::any_of(draw_context.damaged_areas.begin(),
+                             draw_context.damaged_areas.end(),
+                             [&draw_context](const Rectangle& damaged_area) {
+                               return draw_context.area.Intersects(
+                                   damaged_area);
+                             });
+  }
   if (!intersects) {
     draw_context.area = old_area;
     return;
@@ -339,10 +347,36 @@ void Node::SetBlocksHitTest(bool blocks_hit_test) {
 
 bool Node::BlocksHitTest() { return blocks_hit_test_; }
 
+void Node::OnInvalidateArea(
+    std::function<void(const Rectangle& area)> invalidate_area_function) {
+  on_invalidate_area_functions_.push_back(invalidate_area_function);
+  InvalidateWhenDirtied();
+}
+
 void Node::Invalidate() {
+  // Work out where this node is relative to the root. The area is reported
+  // even if this node is already invalidated, because the node may have
+  // moved or changed again since.
+  Rectangle area = {.origin = GetPositionRelativeToParent(), .size = GetSize()};
+  std::shared_ptr<Node> root;
+  for (auto ancestor = parent_.lock(); ancestor;
+       ancestor = ancestor->parent_.lock()) {
+    area.origin -= ancestor->GetOffset();
+    area.origin += ancestor->GetPositionRelativeToParent();
+    root = ancestor;
+  }
+
+  const auto& handlers = root ? root->on_invalidate_area_functions_
+                              : on_invalidate_area_functions_;
+  for (const auto& handler : handlers) handler(area);
+
+  MarkInvalidated();
+}
+
+void Node::MarkInvalidated() {
   if (invalidated_) return;
   invalidated_ = true;
-  if (!parent_.expired()) parent_.lock()->Invalidate();
+  if (!parent_.expired()) parent_.lock()->MarkInvalidated();
 
   for (const auto& handler : on_invalidate_functions_) handler();
 }
@@ -463,8 +497,9 @@ void Node::InvalidateWhenDirtied() {
 }
 
 void Node::LayoutDirtied(const YGNode* node) {
+  // The window works out what moved once the layout is calculated again.
   Node* ui_node = (Node*)YGNodeGetContext(node);
-  ui_node->Invalidate();
+  ui_node->MarkInvalidated();
 }
 
 YGSize Node::Measure(const YGNode* node, float width, YGMeasureMode width_mode,
@@ -0,0 +1,124 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "perception/ui/node.h"
+
+#include <memory>
+#include <vector>
+
+#include "perception/ui/layout.h"
+#include "perception/ui/rectangle.h"
+#include "testing.h"
+
+namespace {
+
+using ::perception::ui::Layout;
+using ::perception::ui::Node;
+using ::perception::ui::Rectangle;
+
+// Returns a 100x100 node with 10 units of padding around `child`.
+std::shared_ptr<Node> Root(std::shared_ptr<Node> child) {
+  auto root = Node::Empty(
+      [](Layout& layout) {
+        layout.SetWidth(100.0f);
+        layout.SetHeight(100.0f);
+        layout.SetPadding(YGEdgeAll, 10.0f);
+      },
+      child);
+  root->GetLayout().Calculate(100.0f, 100.0f);
+  return root;
+}
+
+// Returns a 20x30 node.
+std::shared_ptr<Node> Leaf() {
+  return Node::Empty([](Layout& layout) {
+    layout.SetWidth(20.0f);
+    layout.SetHeight(30.0f);
+  });
+}
+
+// Adds each area that `root` reports as invalidated to `areas`.
+void CollectInvalidatedAreas(std::shared_ptr<Node> root,
+                             std::vector<Rectangle>* areas) {
+  root->OnInvalidateArea(
+      [areas](const Rectangle& area) { areas->push_back(area); });
+}
+
+}  // namespace
+
+TEST(NodeInvalidateReportsAreaRelativeToRoot) {
+  auto leaf = Leaf();
+  auto root = Root(leaf);
+  std::vector<Rectangle> areas;
+  CollectInvalidatedAreas(root, &areas);
+
+  leaf->Invalidate();
+
+  std::vector<Rectangle> expected = {
+      {.origin = {.x = 10.0f, .y = 10.0f},
+       .size = {.width = 20.0f, .height = 30.0f}}};
+  EXPECT(expected, areas);
+}
+
+TEST(NodeInvalidateReportsAreaOfNestedNode) {
+  auto leaf = Leaf();
+  auto root = Root(Node::Empty(
+      [](Layout& layout) { layout.SetPadding(YGEdgeAll, 5.0f); }, leaf));
+  std::vector<Rectangle> areas;
+  CollectInvalidatedAreas(root, &areas);
+
+  leaf->Invalidate();
+
+  std::vector<Rectangle> expected = {
+      {.origin = {.x = 15.0f, .y = 15.0f},
+       .size = {.width = 20.0f, .height = 30.0f}}};
+  EXPECT(expected, areas);
+}
+
+TEST(NodeInvalidateReportsAreaEvenIfAlreadyInvalidated) {
+  auto leaf = Leaf();
+  auto root = Root(leaf);
+  std::vector<Rectangle> areas;
+  CollectInvalidatedAreas(root, &areas);
+
+  leaf->Invalidate();
+  leaf->GetLayout().SetMargin(YGEdgeLeft, 40.0f);
+  root->GetLayout().Calculate(100.0f, 100.0f);
+  leaf->Invalidate();
+
+  std::vector<Rectangle> expected = {
+      {.origin = {.x = 10.0f, .y = 10.0f},
+       .size = {.width = 20.0f, .height = 30.0f}},
+      {.origin = {.x = 50.0f, .y = 10.0f},
+       .size = {.width = 20.0f, .height = 30.0f}}};
+  EXPECT(expected, areas);
+}
+
+TEST(NodeInvalidateSubtractsScrollOffset) {
+  auto leaf = Leaf();
+  auto root = Root(leaf);
+  std::vector<Rectangle> areas;
+  CollectInvalidatedAreas(root, &areas);
+
+  // Scrolling the root invalidates all of it.
+  root->SetOffset({.x = 0.0f, .y = 4.0f});
+  leaf->Invalidate();
+
+  std::vector<Rectangle> expected = {
+      {.origin = {.x = 0.0f, .y = 0.0f},
+       .size = {.width = 100.0f, .height = 100.0f}},
+      {.origin = {.x = 10.0f, .y = 6.0f},
+       .size = {.width = 20.0f, .height = 30.0f}}};
+  EXPECT(expected, areas);
+}
@@ -15,9 +15,11 @@
 #include "perception/ui/text_handling.h"
 
 #include <cmath>
+#include <memory>
 
 #include "include/core/SkFont.h"
 #include "include/core/SkFontTypes.h"
+#include "perception/ui/text_layout.h"
 
 namespace perception {
 namespace ui {
@@ -52,11 +54,16 @@ void RemoveLastUtf8Character(std::string& s) {
 size_t FindClosestCursorIndex(std::string_view text, float target_x,
                               SkFont* font) {
   if (text.empty()) return 0;
+  std::shared_ptr<GlyphAdvances> advances = GlyphAdvances::ForFont(font);
   size_t best_offset = 0;
   float best_dist = std::abs(target_x);
+  float char_x = 0.0f;
   size_t idx = 0;
-  while (idx <= text.length()) {
-    float char_x = font->measureText(text.data(), idx, SkTextEncoding::kUTF8);
+  while (idx < text.length()) {
+    size_t char_len;
+    char_x += advances->AdvanceAt(text, idx, char_len);
+    idx += char_len;
+
     float dist = std::abs(char_x - target_x);
     if (dist < best_dist) {
       best_dist = dist;
@@ -64,10 +71,6 @@ size_t FindClosestCursorIndex(std::string_view text, float target_x,
     } else if (dist > best_dist) {
       break;
     }
-    if (idx == text.length()) break;
-    size_t char_len = GetNextUtf8CharLength(text, idx);
-    if (char_len == 0) break;
-    idx += char_len;
   }
   return best_offset;
 }
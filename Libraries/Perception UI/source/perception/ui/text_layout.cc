@@ -0,0 +1,207 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "perception/ui/text_layout.h"
+
+#include <algorithm>
+#include <list>
+#include <map>
+#include <memory>
+#include <tuple>
+
+#include "include/core/SkFont.h"
+#include "include/core/SkFontTypes.h"
+#include "include/core/SkRect.h"
+#include "include/core/SkTypeface.h"
+#include "perception/ui/text_handling.h"
+
+namespace perception {
+namespace ui {
+namespace {
+
+// Everything about a font that changes how far characters advance.
+struct GlyphAdvancesKey {
+  SkTypefaceID typeface;
+  float size;
+  float scale_x;
+  float skew_x;
+  bool embolden;
+  bool linear_metrics;
+  int hinting;
+
+  bool operator<(const GlyphAdvancesKey& other) const {
+    return std::tie(typeface, size, scale_x, skew_x, embolden, linear_metrics,
+                    hinting) < std::tie(other.typeface, other.size,
+                                        other.scale_x, other.skew_x,
+                                        other.embolden, other.linear_metrics,
+                                        other.hinting);
+  }
+};
+
+struct CachedGlyphAdvances {
+  GlyphAdvancesKey key;
+  std::shared_ptr<GlyphAdvances> advances;
+};
+
+}  // namespace
+
+std::shared_ptr<GlyphAdvances> GlyphAdvances::ForFont(SkFont* font) {
+  // The advances of the most recently used fonts, most recent first.
+  static std::list<CachedGlyphAdvances> cached_advances;
+  static std::map<GlyphAdvancesKey, std::list<CachedGlyphAdvances>::iterator>
+      cached_advances_by_key;
+
+  SkTypeface* typeface = font->getTypeface();
+  GlyphAdvancesKey key{typeface ? typeface->uniqueID() : 0,
+                       font->getSize(),
+                       font->getScaleX(),
+                       font->getSkewX(),
+                       font->isEmbolden(),
+                       font->isLinearMetrics(),
+                       static_cast<int>(font->getHinting())};
+  auto it = cached_advances_by_key.find(key);
+  if (it != cached_advances_by_key.end()) {
+    cached_advances.splice(cached_advances.begin(), cached_advances,
+                           it->second);
+    return it->second->advances;
+  }
+
+  if (cached_advances.size() == kMaxCachedFonts) {
+    cached_advances_by_key.erase(cached_advances.back().key);
+    cached_advances.pop_back();
+  }
+  cached_advances.push_front(
+      {.key = key, .advances = std::make_shared<GlyphAdvances>(*font)});
+  cached_advances_by_key[key] = cached_advances.begin();
+  return cached_advances.front().advances;
+}
+
+GlyphAdvances::GlyphAdvances(const SkFont& font) : font_(font) {
+  std::fill(std::begin(ascii_advances_), std::end(ascii_advances_), -1.0f);
+}
+
+float GlyphAdvances::AdvanceAt(std::string_view text, size_t index,
+                               size_t& length) {
+  unsigned char c = text[index];
+  if (c < 128) {
+    length = 1;
+    float& advance = ascii_advances_[c];
+    if (advance < 0.0f)
+      advance = font_.measureText(&text[index], 1, SkTextEncoding::kUTF8);
+    return advance;
+  }
+
+  length = std::min(GetNextUtf8CharLength(text, index), text.length() - index);
+  uint32 key = 0;
+  for (size_t i = 0; i < length; i++)
+    key = (key << 8) | static_cast<unsigned char>(text[index + i]);
+
+  auto it = advances_.find(key);
+  if (it != advances_.end()) return it->second;
+
+  float advance =
+      font_.measureText(&text[index], length, SkTextEncoding::kUTF8);
+  advances_[key] = advance;
+  return advance;
+}
+
+float GlyphAdvances::Measure(std::string_view text) {
+  float width = 0.0f;
+  size_t length;
+  for (size_t index = 0; index < text.length(); index += length)
+    width += AdvanceAt(text, index, length);
+  return width;
+}
+
+void GlyphAdvances::MeasurePositions(std::string_view text,
+                                     std::vector<float>& positions) {
+  positions.resize(text.length() + 1);
+  float x = 0.0f;
+  size_t length;
+  for (size_t index = 0; index < text.length(); index += length) {
+    float advance = AdvanceAt(text, index, length);
+    for (size_t i = 0; i < length; i++) positions[index + i] = x;
+    x += advance;
+  }
+  positions[text.length()] = x;
+}
+
+std::vector<WrappedLine> WrapParagraph(std::string_view paragraph, SkFont* font,
+                                       float max_width, LineWidth line_width) {
+  std::vector<WrappedLine> lines;
+  if (paragraph.empty()) {
+    lines.push_back({0, 0, 0.0f});
+    return lines;
+  }
+
+  std::vector<float> x;
+  GlyphAdvances::ForFont(font)->MeasurePositions(paragraph, x);
+
+  if (max_width <= 0.0f) {
+    lines.push_back({0, paragraph.length(), x.back()});
+    return lines;
+  }
+
+  auto add_line = [&](size_t start, size_t end) {
+    lines.push_back({start, end, x[end] - x[start]});
+  };
+
+  auto fits = [&](size_t start, size_t end) {
+    if (x[end] - x[start] <= max_width) return true;
+    if (line_width != LineWidth::Ink) return false;
+    SkRect bounds;
+    font->measureText(&paragraph[start], end - start, SkTextEncoding::kUTF8,
+                      &bounds);
+    return bounds.width() <= max_width;
+  };
+
+  size_t line_start = 0;
+  size_t index = 0;
+  while (index < paragraph.length()) {
+    size_t next_space = paragraph.find(' ', index);
+    size_t word_end = (next_space == std::string_view::npos)
+                          ? paragraph.length()
+                          : next_space + 1;
+
+    if (fits(line_start, word_end)) {
+      index = word_end;
+    } else if (index != line_start) {
+      // Move the word onto the next line.
+      add_line(line_start, index);
+      line_start = index;
+    } else {
+      // The word doesn't fit on a line by itself, so break it between
+      // characters. Every line gets at least one character.
+      size_t character = line_start;
+      while (character < word_end) {
+        size_t length = GetNextUtf8CharLength(paragraph, character);
+        if (length == 0) break;
+        size_t character_end = std::min(character + length, word_end);
+        if (character == line_start || fits(line_start, character_end)) {
+          character = character_end;
+        } else {
+          add_line(line_start, character);
+          line_start = character;
+        }
+      }
+      index = word_end;
+    }
+  }
+
+  if (line_start < paragraph.length()) add_line(line_start, paragraph.length());
+  return lines;
+}
+
+}  // namespace ui
+}  // namespace perception
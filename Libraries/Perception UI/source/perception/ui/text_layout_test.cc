@@ -0,0 +1,172 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "perception/ui/text_layout.h"
+
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "include/core/SkFont.h"
+#include "perception/ui/font.h"
+#include "testing.h"
+
+namespace {
+
+using ::perception::ui::GetBook12UiFont;
+using ::perception::ui::GlyphAdvances;
+using ::perception::ui::LineWidth;
+using ::perception::ui::WrappedLine;
+using ::perception::ui::WrapParagraph;
+
+// Returns the text of each line that a paragraph was wrapped onto.
+std::vector<std::string_view> LineTexts(std::string_view paragraph,
+                                        const std::vector<WrappedLine>& lines) {
+  std::vector<std::string_view> texts;
+  for (const WrappedLine& line : lines)
+    texts.push_back(paragraph.substr(line.start, line.end - line.start));
+  return texts;
+}
+
+// Returns a width that `text` fits in, with some slack so that rounding
+// doesn't change what fits, but not enough for another character.
+float WidthToFit(std::string_view text) {
+  return GlyphAdvances::ForFont(GetBook12UiFont())->Measure(text) + 0.5f;
+}
+
+TEST(WrapParagraphBreaksAfterSpaces) {
+  std::string_view paragraph = "one two three";
+  auto lines =
+      WrapParagraph(paragraph, GetBook12UiFont(), WidthToFit("one two "));
+
+  std::vector<std::string_view> expected = {"one two ", "three"};
+  EXPECT(true, expected == LineTexts(paragraph, lines));
+  ASSERT((size_t)2, lines.size());
+  EXPECT(GlyphAdvances::ForFont(GetBook12UiFont())->Measure("three"),
+         lines[1].width);
+}
+
+TEST(WrapParagraphBreaksLongWordsBetweenCharacters) {
+  std::string_view paragraph = "hi mmmmmmm";
+  auto lines = WrapParagraph(paragraph, GetBook12UiFont(), WidthToFit("mmm"));
+
+  // The word that doesn't fit starts a new line before being broken up.
+  std::vector<std::string_view> expected = {"hi ", "mmm", "mmm", "m"};
+  EXPECT(true, expected == LineTexts(paragraph, lines));
+}
+
+TEST(WrapParagraphKeepsMultibyteCharactersTogether) {
+  std::string_view paragraph = "\xC3\xA9\xC3\xA9\xC3\xA9\xC3\xA9\xC3\xA9";
+  auto lines = WrapParagraph(paragraph, GetBook12UiFont(),
+                             WidthToFit("\xC3\xA9\xC3\xA9"));
+
+  std::vector<std::string_view> expected = {
+      "\xC3\xA9\xC3\xA9", "\xC3\xA9\xC3\xA9", "\xC3\xA9"};
+  EXPECT(true, expected == LineTexts(paragraph, lines));
+}
+
+TEST(WrapParagraphKeepsOneLineWithoutAMaxWidth) {
+  std::string_view paragraph = "one two three";
+  float width = GlyphAdvances::ForFont(GetBook12UiFont())->Measure(paragraph);
+  for (float max_width : {0.0f, -10.0f}) {
+    auto lines = WrapParagraph(paragraph, GetBook12UiFont(), max_width);
+    ASSERT((size_t)1, lines.size());
+    EXPECT((size_t)0, lines[0].start);
+    EXPECT(paragraph.length(), lines[0].end);
+    EXPECT(width, lines[0].width);
+  }
+
+  // An empty paragraph is still one line.
+  auto lines = WrapParagraph("", GetBook12UiFont(), 100.0f);
+  ASSERT((size_t)1, lines.size());
+  EXPECT((size_t)0, lines[0].end);
+}
+
+TEST(WrapParagraphFitsByInk) {
+  // The trailing space makes the line too wide by its advance, but it isn't
+  // drawn, so it fits by its ink.
+  std::string_view paragraph = "ab cd ";
+  float max_width =
+      GlyphAdvances::ForFont(GetBook12UiFont())->Measure("ab cd");
+
+  std::vector<std::string_view> by_advance = {"ab ", "cd "};
+  EXPECT(true, by_advance ==
+                   LineTexts(paragraph, WrapParagraph(paragraph,
+                                                      GetBook12UiFont(),
+                                                      max_width)));
+
+  std::vector<std::string_view> by_ink = {"ab cd "};
+  EXPECT(true, by_ink == LineTexts(paragraph,
+                                   WrapParagraph(paragraph, GetBook12UiFont(),
+                                                 max_width, LineWidth::Ink)));
+}
+
+TEST(GlyphAdvancesAreSharedBetweenMatchingFonts) {
+  SkFont* font = GetBook12UiFont();
+  SkFont copy = *font;
+  EXPECT(true, GlyphAdvances::ForFont(font) == GlyphAdvances::ForFont(&copy));
+
+  SkFont bigger = *font;
+  bigger.setSize(24.0f);
+  EXPECT(false,
+         GlyphAdvances::ForFont(font) == GlyphAdvances::ForFont(&bigger));
+  EXPECT(true, GlyphAdvances::ForFont(&bigger)->Measure("m") >
+                   GlyphAdvances::ForFont(font)->Measure("m"));
+}
+
+TEST(GlyphAdvancesOutliveTheirFont) {
+  float width;
+  {
+    SkFont temporary = *GetBook12UiFont();
+    temporary.setSize(13.0f);
+    width = GlyphAdvances::ForFont(&temporary)->Measure("a");
+  }
+
+  // Measuring new characters uses the cache's own copy of the font.
+  SkFont same = *GetBook12UiFont();
+  same.setSize(13.0f);
+  std::shared_ptr<GlyphAdvances> advances = GlyphAdvances::ForFont(&same);
+  EXPECT(width, advances->Measure("a"));
+  EXPECT(true, advances->Measure("ab") > width);
+}
+
+TEST(GlyphAdvancesForLeastRecentlyUsedFontsAreEvicted) {
+  SkFont oldest = *GetBook12UiFont();
+  oldest.setSize(100.0f);
+  SkFont recent = *GetBook12UiFont();
+  recent.setSize(101.0f);
+  std::shared_ptr<GlyphAdvances> oldest_advances =
+      GlyphAdvances::ForFont(&oldest);
+  std::shared_ptr<GlyphAdvances> recent_advances =
+      GlyphAdvances::ForFont(&recent);
+  float width = oldest_advances->Measure("a");
+
+  // Use more fonts than the cache holds, using `recent` between each one so
+  // it stays cached.
+  for (size_t i = 0; i < GlyphAdvances::kMaxCachedFonts; i++) {
+    SkFont other = *GetBook12UiFont();
+    other.setSize(200.0f + (float)i);
+    (void)GlyphAdvances::ForFont(&other);
+    (void)GlyphAdvances::ForFont(&recent);
+  }
+
+  EXPECT(true, GlyphAdvances::ForFont(&recent) == recent_advances);
+  EXPECT(false, GlyphAdvances::ForFont(&oldest) == oldest_advances);
+
+  // Evicted advances stay usable by whoever still has them.
+  EXPECT(width, oldest_advances->Measure("a"));
+}
+
+}  // namespace
@@ -13,6 +13,8 @@
 // limitations under the License.
 #pragma once
 
+#include <vector>
+
 #include "perception/window/mouse_button.h"
 
 namespace perception {
@@ -21,6 +23,10 @@ namespace window {
 struct MouseHoverEvent {
   int x;
   int y;
+
+  // The positions the mouse passed through since the last hover event, oldest
+  // first, if the window was created with `wants_mouse_history`.
+  std::vector<MouseHoverEvent> history;
 };
 
 }  // namespace window
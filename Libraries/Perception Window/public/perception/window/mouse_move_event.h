@@ -13,12 +13,18 @@
 // limitations under the License.
 #pragma once
 
+#include <vector>
+
 namespace perception {
 namespace window {
 
 struct MouseMoveEvent {
   float delta_x;
   float delta_y;
+
+  // The movements this one is made of, oldest first, if the window was created
+  // with `wants_mouse_history`.
+  std::vector<MouseMoveEvent> history;
 };
 
 }  // namespace window
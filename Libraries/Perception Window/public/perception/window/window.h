@@ -60,6 +60,11 @@ class Window {
 
     // Whether the window manager should add a native title bar.
     bool add_title_bar = false;
+
+    // The window manager coalesces mouse movements into one event per frame.
+    // Whether those events should also carry every movement they're made of,
+    // for things like drawing programs that want the full path.
+    bool wants_mouse_history = false;
   };
   // Creates a window. Can return a nullptr if something went wrong.
   static std::shared_ptr<Window> CreateWindow(
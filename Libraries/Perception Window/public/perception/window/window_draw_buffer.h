@@ -15,7 +15,7 @@ struct WindowDrawBuffer {
   void* pixel_data;
 
   // Whether the contents of the buffer have been preserved
-  // from the previous call. If this is false, then only the part of the image
+  // from the previous call. If this is true, then only the part of the image
   // that has changed has to be redrawn into `pixel_data`.
   bool has_preserved_contents_from_previous_draw;
 };
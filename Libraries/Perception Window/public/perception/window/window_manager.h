@@ -63,6 +63,10 @@ class CreateWindowRequest : public serialization::Serializable {
   // The maximum size of the window.
   std::optional<Size> maximum_size;
 
+  // Whether mouse events should carry the history of the events that were
+  // coalesced into them.
+  bool wants_mouse_history = false;
+
   virtual void Serialize(serialization::Serializer& serializer) override;
 };
 
@@ -170,13 +170,13 @@ class PerceptionWindow : public Window,
     WindowDrawBuffer buffer;
     buffer.width = width_;
     buffer.height = height_;
+    bool rebuilt_textures = rebuild_texture_;
     if (rebuild_texture_) {
       RebuildTextures();
-      buffer.has_preserved_contents_from_previous_draw = true;
       rebuild_texture_ = false;
-    } else {
-      buffer.has_preserved_contents_from_previous_draw = false;
     }
+    // New textures start out empty, so they have to be drawn in full.
+    buffer.has_preserved_contents_from_previous_draw = !rebuilt_textures;
 
     if (width_ == 0 || height_ == 0 || !texture_shared_memory_->Join() ||
         (is_double_buffered_ && !frontbuffer_shared_memory_->Join())) {
@@ -184,7 +184,7 @@ class PerceptionWindow : public Window,
     }
 
     Rectangle invalidated_area(0, 0, width_, height_);
-    if (dirty_rect && !rebuild_texture_) {
+    if (dirty_rect && !rebuilt_textures) {
       invalidated_area.min_x = std::max(0, std::min(dirty_rect->min_x, width_));
       invalidated_area.min_y =
           std::max(0, std::min(dirty_rect->min_y, height_));
@@ -202,6 +202,12 @@ class PerceptionWindow : public Window,
     if (!delegate_.expired())
       delegate_.lock()->WindowDraw(buffer, invalidated_area);
 
+    // The delegate may have drawn less than was asked for.
+    if (invalidated_area.max_x <= invalidated_area.min_x ||
+        invalidated_area.max_y <= invalidated_area.min_y) {
+      return;
+    }
+
     if (is_double_buffered_) {
       int copy_w = invalidated_area.max_x - invalidated_area.min_x;
       int copy_h = invalidated_area.max_y - invalidated_area.min_y;
@@ -235,8 +241,14 @@ class PerceptionWindow : public Window,
   /// MouseListener::Server
   virtual Status MouseMove(const RelativeMousePositionEvent& message) override {
     if (!delegate_.expired()) {
-      delegate_.lock()->MouseMoved(MouseMoveEvent{.delta_x = message.delta_x,
-                                                  .delta_y = message.delta_y});
+      MouseMoveEvent event{.delta_x = message.delta_x,
+                           .delta_y = message.delta_y};
+      event.history.reserve(message.history.size());
+      for (const auto& movement : message.history) {
+        event.history.push_back(
+            {.delta_x = movement.delta_x, .delta_y = movement.delta_y});
+      }
+      delegate_.lock()->MouseMoved(event);
     }
     return Status::OK;
   }
@@ -284,8 +296,14 @@ class PerceptionWindow : public Window,
 
   virtual Status MouseHover(const MousePositionEvent& message) override {
     if (!delegate_.expired()) {
-      delegate_.lock()->MouseHovered(MouseHoverEvent{
-          .x = static_cast<int>(message.x), .y = static_cast<int>(message.y)});
+      MouseHoverEvent event{.x = static_cast<int>(message.x),
+                            .y = static_cast<int>(message.y)};
+      event.history.reserve(message.history.size());
+      for (const auto& position : message.history) {
+        event.history.push_back({.x = static_cast<int>(position.x),
+                                 .y = static_cast<int>(position.y)});
+      }
+      delegate_.lock()->MouseHovered(event);
     }
     return Status::OK;
   }
@@ -454,6 +472,8 @@ std::shared_ptr<Window> Window::CreateWindow(
   create_window_request.add_title_bar = creation_options.add_title_bar;
   create_window_request.minimum_size = creation_options.minimum_size;
   create_window_request.maximum_size = creation_options.maximum_size;
+  create_window_request.wants_mouse_history =
+      creation_options.wants_mouse_history;
 
   auto status_or_result =
       GetService<WindowManager>().CreateWindow(create_window_request);
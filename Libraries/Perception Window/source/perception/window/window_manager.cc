@@ -28,6 +28,7 @@ void CreateWindowRequest::Serialize(serialization::Serializer& serializer) {
   serializer.Integer("Add title bar", add_title_bar);
   serializer.Serializable("Minimum size", minimum_size);
   serializer.Serializable("Maximum size", maximum_size);
+  serializer.Integer("Wants mouse history", wants_mouse_history);
 }
 
 void ColorSpace::Serialize(serialization::Serializer& serializer) {
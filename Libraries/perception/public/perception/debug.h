@@ -18,6 +18,11 @@
 
 namespace perception {
 
+// Prints debug output on COM1. Output is buffered per thread and sent to the
+// kernel a line at a time, so lines printed by different threads don't get
+// mixed together. Call Flush() to send a partial line. A partial line that
+// hasn't been flushed is lost if the thread dies, such as from an exception,
+// because the buffer is in the thread's own memory.
 class DebugPrinter {
  public:
   DebugPrinter(int channel = 0);
@@ -28,6 +33,16 @@ class DebugPrinter {
   DebugPrinter& operator<<(const char* str);
   DebugPrinter& operator<<(bool b);
 
+  // Prints `length` characters.
+  void Write(const char* data, size_t length);
+
+  // Prints `length` bytes of binary data, such as a trace packet, together
+  // rather than breaking them up at line endings.
+  void WritePacket(const char* data, size_t length);
+
+  // Sends anything this thread has buffered to the kernel.
+  void Flush();
+
  private:
   int channel_;
 };
@@ -37,4 +52,14 @@ extern DebugPrinter DebugPrinterSingleton;
 // Dump the running thread's registers and stack trace on COM1.
 extern "C" void DumpRegistersAndStackTrace();
 
+// Copies up to `size` bytes of what has been printed on COM1, starting at
+// `position`, into `buffer`. Every byte printed since boot has a position,
+// counting up from 0, and the kernel keeps the most recent ones.
+// `first_position` is set to the position of the first byte copied, which is
+// later than `position` if those bytes are no longer kept, and `end_position`
+// to the position the next byte printed will have. Returns the number of bytes
+// copied. Only drivers may read the log, and nothing is copied for anyone else.
+size_t ReadKernelLog(size_t position, char* buffer, size_t size,
+                     size_t& first_position, size_t& end_position);
+
 }  // namespace perception
@@ -15,6 +15,8 @@
 #pragma once
 
 #include <memory>
+#include <optional>
+#include <type_traits>
 #include <vector>
 
 #include "perception/devices/graphics_listener.h"
@@ -60,6 +62,14 @@ class Size : public serialization::Serializable {
   virtual void Serialize(serialization::Serializer& serializer) override;
 };
 
+class Rectangle : public serialization::Serializable {
+ public:
+  Position origin;
+  Size size;
+
+  virtual void Serialize(serialization::Serializer& serializer) override;
+};
+
 class CopyPartOfTextureParameters : public serialization::Serializable {
  public:
   Position source;
@@ -113,10 +123,80 @@ class Command : public serialization::Serializable {
   virtual void Serialize(serialization::Serializer& serializer) override;
 };
 
+// A command with a fixed layout, so that a frame of commands can be written
+// straight into a command buffer shared with the driver, and run from there,
+// without allocating or serializing anything per command. Which fields are
+// used depends on the type, as with Command.
+struct PackedCommand {
+  Command::Type type;
+
+  // FILL_RECTANGLE
+  uint32 color;
+
+  // SET_DESTINATION_TEXTURE
+  // SET_SOURCE_TEXTURE
+  uint64 texture_id;
+
+  // COPY_PART_OF_A_TEXTURE
+  // COPY_PART_OF_A_TEXTURE_WITH_ALPHA_BLENDING
+  uint32 source_left;
+  uint32 source_top;
+
+  // COPY_TEXTURE_TO_POSITION
+  // COPY_TEXTURE_TO_POSITION_WITH_ALPHA_BLENDING
+  // COPY_PART_OF_A_TEXTURE
+  // COPY_PART_OF_A_TEXTURE_WITH_ALPHA_BLENDING
+  // FILL_RECTANGLE
+  uint32 destination_left;
+  uint32 destination_top;
+
+  // COPY_PART_OF_A_TEXTURE
+  // COPY_PART_OF_A_TEXTURE_WITH_ALPHA_BLENDING
+  // FILL_RECTANGLE
+  uint32 width;
+  uint32 height;
+};
+static_assert(std::is_trivially_copyable_v<PackedCommand>);
+
+// Converts a command into a packed command. Returns nothing if the command is
+// missing the parameters its type needs, as such commands are skipped.
+std::optional<PackedCommand> PackCommand(const Command& command);
+
+// Converts a packed command back into a command.
+Command UnpackCommand(const PackedCommand& command);
+
 class Commands : public serialization::Serializable {
  public:
   std::vector<Command> commands;
 
+  // The areas of the screen the commands change, which are the only areas the
+  // driver needs to present. Empty if the whole screen might have changed.
+  std::vector<Rectangle> damaged_areas;
+
+  virtual void Serialize(serialization::Serializer& serializer) override;
+};
+
+// Shares a command buffer with the driver. The buffer is a ring of
+// PackedCommands that the sender writes frames into, and then rings the
+// doorbell with RunCommandBuffer. Each process has at most one.
+class CommandBufferParameters : public serialization::Serializable {
+ public:
+  std::shared_ptr<SharedMemory> buffer;
+
+  virtual void Serialize(serialization::Serializer& serializer) override;
+};
+
+// Tells the driver to run a frame of commands out of the sender's command
+// buffer. The frame starts at `first_command`, and wraps around to the start
+// of the ring.
+class CommandBufferDoorbell : public serialization::Serializable {
+ public:
+  uint32 first_command;
+  uint32 command_count;
+
+  // The same as Commands::damaged_areas.
+  std::vector<Rectangle> damaged_areas;
+
   virtual void Serialize(serialization::Serializer& serializer) override;
 };
 
@@ -153,17 +233,19 @@ class ProcessAllowedToDrawToScreenParameters
 
 }  // namespace graphics
 
-#define METHOD_LIST(X)                                      \
-  X(1, RunCommands, void, graphics::Commands)               \
-  X(2, CreateTexture, graphics::CreateTextureResponse,      \
-    graphics::CreateTextureRequest)                         \
-  X(3, DestroyTexture, void, graphics::TextureReference)    \
-  X(4, GetTextureInformation, graphics::TextureInformation, \
-    graphics::TextureReference)                             \
-  X(5, SetProcessAllowedToDrawToScreen, void,               \
-    graphics::ProcessAllowedToDrawToScreenParameters)       \
-  X(6, GetScreenSize, graphics::Size, void)                 \
-  X(7, SetGraphicsListener, void, GraphicsListener::Client)
+#define METHOD_LIST(X)                                            \
+  X(1, RunCommands, void, graphics::Commands)                     \
+  X(2, CreateTexture, graphics::CreateTextureResponse,            \
+    graphics::CreateTextureRequest)                               \
+  X(3, DestroyTexture, void, graphics::TextureReference)          \
+  X(4, GetTextureInformation, graphics::TextureInformation,       \
+    graphics::TextureReference)                                   \
+  X(5, SetProcessAllowedToDrawToScreen, void,                     \
+    graphics::ProcessAllowedToDrawToScreenParameters)             \
+  X(6, GetScreenSize, graphics::Size, void)                       \
+  X(7, SetGraphicsListener, void, GraphicsListener::Client)       \
+  X(8, SetCommandBuffer, void, graphics::CommandBufferParameters) \
+  X(9, RunCommandBuffer, void, graphics::CommandBufferDoorbell)
 
 DEFINE_PERCEPTION_SERVICE(GraphicsDevice, "perception.devices.GraphicsDevice",
                           METHOD_LIST)
@@ -14,6 +14,8 @@
 // #define PERCEPTION
 #pragma once
 
+#include <vector>
+
 #include "perception/serialization/serializable.h"
 #include "perception/service_macros.h"
 
@@ -30,6 +32,11 @@ class RelativeMousePositionEvent : public serialization::Serializable {
  public:
   float delta_x, delta_y;
 
+  // Movements are coalesced, so this event may stand for several. If the
+  // window asked for mouse history, these are the movements it's made of,
+  // oldest first.
+  std::vector<RelativeMousePositionEvent> history;
+
   virtual void Serialize(serialization::Serializer& serializer) override;
 };
 
@@ -37,6 +44,11 @@ class MousePositionEvent : public serialization::Serializable {
  public:
   float x, y;
 
+  // Hovers are coalesced, so this event may stand for several. If the window
+  // asked for mouse history, these are the positions the mouse passed
+  // through, oldest first and ending with this position.
+  std::vector<MousePositionEvent> history;
+
   virtual void Serialize(serialization::Serializer& serializer) override;
 };
 
@@ -14,14 +14,22 @@
 
 #pragma once
 
+#include <atomic>
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "perception/serialization/serializable.h"
 #include "perception/serialization/serializer.h"
 #include "perception/service_macros.h"
+#include "types.h"
 
 namespace perception {
+
+class SharedMemory;
+
 namespace devices {
 
 // Serializable container for network packets.
@@ -46,19 +54,152 @@ class MacAddress : public serialization::Serializable {
   }
 };
 
+// The number of packets each direction of a packet ring can hold.
+constexpr size_t kPacketRingSize = 128;
+
+// Each packet in a packet ring has a page to itself.
+constexpr size_t kPacketBufferSize = 4096;
+
+// Space at the start of each transmit buffer that the driver can write its own
+// headers into, so that it can hand the buffer to the hardware as it is.
+constexpr size_t kPacketBufferHeadroom = 64;
+
+// The largest packet that fits in a packet ring.
+constexpr size_t kMaxPacketRingPacketSize =
+    kPacketBufferSize - kPacketBufferHeadroom;
+
+// A packet in a packet ring.
+struct PacketRingEntry {
+  // The buffer holding the packet.
+  uint16 buffer;
+
+  // Where in the buffer the packet starts.
+  uint16 offset;
+
+  // The length of the packet in bytes.
+  uint32 length;
+};
+
+// The first page of a packet ring. The indices only ever increase, and wrap
+// around kPacketRingSize when used to index the entries.
+struct PacketRingHeader {
+  // Received packets. The driver produces them, and the Network Manager
+  // consumes them and then the driver can reuse their buffers.
+  std::atomic<uint32> rx_produced;
+  std::atomic<uint32> rx_consumed;
+
+  // Packets to transmit. The Network Manager produces them, and the driver
+  // consumes them once the hardware is done with their buffers.
+  std::atomic<uint32> tx_produced;
+  std::atomic<uint32> tx_consumed;
+
+  PacketRingEntry rx[kPacketRingSize];
+  PacketRingEntry tx[kPacketRingSize];
+};
+
+// Packets exchanged through shared memory instead of being serialized into
+// messages. The ring is created by the driver and shared with the Network
+// Manager. It starts with a PacketRingHeader page, followed by the buffers for
+// received packets, then the buffers for packets to transmit.
+//
+// The driver points the hardware straight at the buffers, so a received packet
+// is read by the Network Manager where the hardware wrote it, and a packet to
+// transmit is sent from where the Network Manager wrote it. Each side rings
+// the other's doorbell once per batch of packets rather than once per packet.
+class PacketRing {
+ public:
+  // Creates a packet ring. Called by the driver.
+  static std::unique_ptr<PacketRing> Create();
+
+  // Wraps a packet ring created by the driver. Returns nullptr if the shared
+  // memory isn't a packet ring.
+  static std::unique_ptr<PacketRing> FromSharedMemory(
+      std::shared_ptr<SharedMemory> shared_memory);
+
+  PacketRing(std::shared_ptr<SharedMemory> shared_memory);
+
+  const std::shared_ptr<SharedMemory>& GetSharedMemory() const {
+    return shared_memory_;
+  }
+
+  PacketRingHeader& Header() { return *header_; }
+
+  // Returns the buffer for a received packet.
+  uint8* RxBuffer(size_t buffer);
+
+  // Returns the buffer for a packet to transmit.
+  uint8* TxBuffer(size_t buffer);
+
+  // Returns the offset of a buffer in the shared memory, for looking up its
+  // physical address.
+  static size_t RxBufferOffset(size_t buffer);
+  static size_t TxBufferOffset(size_t buffer);
+
+  // Returns the next received packet, or nullopt if there aren't any. The
+  // packet stays valid until PopReceivedPacket is called.
+  std::optional<std::string_view> PeekReceivedPacket();
+
+  // Hands the buffer of the packet returned by PeekReceivedPacket back to the
+  // driver.
+  void PopReceivedPacket();
+
+  // Copies a packet into the ring to be transmitted. Returns false if the
+  // packet is too big or the ring is full. The driver isn't told about it
+  // until its doorbell is rung.
+  bool QueuePacketToTransmit(std::string_view packet);
+
+  // Called by the driver after receiving packets into the ring, and after the
+  // listener has consumed them. Returns true, and counts the doorbell as rung,
+  // if the listener should be sent PacketsReceived: there are packets it
+  // hasn't consumed, and it hasn't been told since it last caught up.
+  bool RingReceivedPacketsDoorbell();
+
+  // Called by the driver when the listener calls ReceivedPacketsConsumed.
+  void ReceivedPacketsDoorbellAnswered();
+
+ private:
+  std::shared_ptr<SharedMemory> shared_memory_;
+  PacketRingHeader* header_;
+
+  // Whether the driver has sent PacketsReceived and the listener hasn't called
+  // ReceivedPacketsConsumed since.
+  bool received_packets_doorbell_rung_ = false;
+};
+
+// Shares a packet ring between a driver and the Network Manager.
+class PacketRingParameters : public serialization::Serializable {
+ public:
+  std::shared_ptr<SharedMemory> ring;
+
+  virtual void Serialize(serialization::Serializer& serializer) override;
+};
+
 // Listener service implemented by the Network Manager to receive packets from
-// drivers.
-#define NETWORK_LISTENER_METHOD_LIST(X) X(1, PacketReceived, void, Packet)
+// drivers. Packets are either sent one at a time with PacketReceived, or put in
+// the packet ring and announced with PacketsReceived. The driver doesn't ring
+// PacketsReceived again until the Network Manager calls
+// ReceivedPacketsConsumed.
+#define NETWORK_LISTENER_METHOD_LIST(X) \
+  X(1, PacketReceived, void, Packet)    \
+  X(2, PacketsReceived, void, void)
 
 DEFINE_PERCEPTION_SERVICE(NetworkListener, "perception.devices.NetworkListener",
                           NETWORK_LISTENER_METHOD_LIST)
 #undef NETWORK_LISTENER_METHOD_LIST
 
 // Service implemented by NIC drivers.
-#define NETWORK_DEVICE_METHOD_LIST(X)   \
-  X(1, GetMacAddress, MacAddress, void) \
-  X(2, SendPacket, void, Packet)        \
-  X(3, SetPacketListener, void, NetworkListener::Client)
+//
+// CreatePacketRing creates the packet ring for the packet listener. Packets
+// queued into it to transmit are sent when TransmitPackets is called, and the
+// buffers of received packets are reused once ReceivedPacketsConsumed is
+// called.
+#define NETWORK_DEVICE_METHOD_LIST(X)                      \
+  X(1, GetMacAddress, MacAddress, void)                    \
+  X(2, SendPacket, void, Packet)                           \
+  X(3, SetPacketListener, void, NetworkListener::Client)   \
+  X(4, CreatePacketRing, PacketRingParameters, void)       \
+  X(5, TransmitPackets, void, void)                        \
+  X(6, ReceivedPacketsConsumed, void, void)
 
 DEFINE_PERCEPTION_SERVICE(NetworkDevice, "perception.devices.NetworkDevice",
                           NETWORK_DEVICE_METHOD_LIST)
@@ -14,6 +14,11 @@
 
 #pragma once
 
+#include <chrono>
+#include <optional>
+
+#include "types.h"
+
 namespace perception {
 
 // Puts the current fiber to sleep if the 32-bit integer at `address` matches `value`.
@@ -25,4 +30,43 @@ bool WaitOnFutex(void* address, int value);
 // Wakes up to `value` fibers that are sleeping on `address`.
 void WakeFutex(void* address, int value);
 
+// The result of waiting on a futex with FutexWait().
+enum class FutexWaitResult : size_t {
+  // Another thread woke this thread up.
+  WOKEN = 0,
+  // `*address` didn't contain the expected value, so the thread didn't sleep.
+  VALUE_CHANGED = 1,
+  // The timeout elapsed before anyone woke this thread up.
+  TIMED_OUT = 2,
+  // The address isn't 4-byte aligned or isn't backed by memory.
+  INVALID_ADDRESS = 3
+};
+
+// Puts the current thread to sleep in the kernel if the 32-bit integer at
+// `address` contains `expected`, until another thread calls FutexWake() on the
+// same address or the timeout elapses. The kernel checks the value and puts
+// the thread to sleep atomically, so a wake can't slip in between them.
+//
+// Unlike WaitOnFutex(), this blocks the whole thread rather than the fiber, and
+// works across processes if `address` is in shared memory. Fibers on the
+// primary thread should use WaitOnFutex() so they don't block the event loop.
+FutexWaitResult FutexWait(
+    volatile int* address, int expected,
+    std::optional<std::chrono::microseconds> timeout = std::nullopt);
+
+// Wakes up to `count` threads sleeping in FutexWait() on `address`, in the
+// order they went to sleep. Returns the number of threads woken up.
+size_t FutexWake(volatile int* address, size_t count);
+
+// Wakes up to `wake_count` threads sleeping in FutexWait() on `address`, and
+// moves up to `requeue_count` of the rest to sleep on `requeue_address`
+// instead, such as to move condition variable waiters onto the mutex rather
+// than waking them all up to fight over it. If `expected` is set, nothing
+// happens unless `*address` contains it. Returns the number of threads woken
+// up and requeued, or std::nullopt if `*address` didn't match.
+std::optional<size_t> FutexRequeue(volatile int* address, size_t wake_count,
+                                   volatile int* requeue_address,
+                                   size_t requeue_count,
+                                   std::optional<int> expected = std::nullopt);
+
 }  // namespace perception
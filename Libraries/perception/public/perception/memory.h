@@ -22,9 +22,20 @@ constexpr size_t kPageSize = 4096;
 
 void* AllocateMemoryPages(size_t number);
 
+// Allocates pages that are zero and aren't backed by physical memory until
+// they're first touched. Useful for large reservations that might only be
+// partially used.
+void* AllocateLazilyZeroedMemoryPages(size_t number);
+
 void* AllocateMemoryPagesBelowPhysicalAddressBase(
     size_t number, size_t max_base_address, size_t& first_physical_address);
 
+// Allocates pages that are backed by physically contiguous memory, with every
+// page starting at or below `max_base_address`, for devices that DMA into a
+// single run of memory. Only drivers may call this.
+void* AllocateContiguousMemoryPages(size_t number, size_t max_base_address,
+                                    size_t& first_physical_address);
+
 void ReleaseMemoryPages(void* ptr, size_t number);
 
 // Maps physical memory into this process's address space. Only drivers
@@ -14,6 +14,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <functional>
 #include <memory>
 
@@ -37,6 +38,44 @@ struct MessageData {
   };
 };
 
+// A message to send with SendRawMessages.
+struct OutgoingMessage {
+  ProcessId pid;
+  MessageData message_data;
+};
+
+// The number of messages the mailbox's receive ring holds.
+constexpr size_t kMessageMailboxReceiveSlots = 128;
+
+// The most messages that the kernel sends per trip into the kernel.
+constexpr size_t kMessageMailboxSendSlots = 63;
+
+// A message in the mailbox. Must match MailboxMessage in the kernel.
+struct MailboxMessage {
+  MessageId message_id;
+  // The sender's PID when receiving, or the receiver's PID when sending.
+  ProcessId pid;
+  size_t metadata;
+  size_t param1, param2, param3, param4, param5;
+};
+
+// Memory shared between this process and the kernel for passing messages
+// without entering the kernel for each one. Must match MessageMailboxHeader in
+// the kernel.
+struct MessageMailbox {
+  // The total number of messages the kernel has written into the receive ring.
+  std::atomic<size_t> receive_write_index;
+  // The total number of messages read from the receive ring. The kernel also
+  // advances it when a message is received through the old syscalls, so it is
+  // only advanced with a compare-and-swap.
+  std::atomic<size_t> receive_read_index;
+  size_t reserved[6];
+  // Messages sent to this process.
+  MailboxMessage receive_ring[kMessageMailboxReceiveSlots];
+  // Messages for SendRawMessages to hand to the kernel.
+  MailboxMessage send_slots[kMessageMailboxSendSlots];
+};
+
 // Represents what to do when a message is received.
 struct MessageHandler {
   // The fiber to wake up. This is set when a fiber is paused
@@ -78,6 +117,24 @@ inline bool IsCallExpectingResponse(size_t metadata) {
   return GetMessageType(metadata) == MessageType::CALL;
 }
 
+// Set in the metadata of an RPC request or response that carries its
+// serialized parameters in the message itself rather than in shared memory.
+// The length of the parameters is kept in the metadata's second byte.
+constexpr size_t kMessageHasInlineParameters = 0b100;
+
+inline bool HasInlineParameters(size_t metadata) {
+  return (metadata & kMessageHasInlineParameters) != 0;
+}
+
+inline size_t GetInlineParametersLength(size_t metadata) {
+  return (metadata >> 8) & 0xFF;
+}
+
+inline void SetInlineParameters(size_t& metadata, size_t length) {
+  metadata = (metadata & ~(size_t(0xFF) << 8)) | kMessageHasInlineParameters |
+             ((length & 0xFF) << 8);
+}
+
 // Were memory pages sent in this message?
 bool WereMemoryPagesSentInMessage(size_t metadata);
 
@@ -97,6 +154,16 @@ Status SendRawMessage(ProcessId pid, const MessageData& message_data);
 // Sends a message to a process.
 Status SendMessage(ProcessId pid, const MessageData& message_data);
 
+// Sends a batch of raw messages, entering the kernel once per
+// kMessageMailboxSendSlots messages. Stops at the first message that fails and
+// returns its status. `sent` is set to the number of messages that were sent.
+Status SendRawMessages(const OutgoingMessage* messages, size_t count,
+                       size_t& sent);
+
+// Returns this process's message mailbox, or nullptr if the kernel couldn't
+// create one. Only the primary thread may read from the receive ring.
+MessageMailbox* GetMessageMailbox();
+
 // Registers the message handler to call when a specific message is received.
 // Assigning another handler to the same Message ID will override that handler.
 // Messages that involve sending over memory pages will not be processed (and
@@ -17,6 +17,7 @@
 #include <functional>
 #include <string>
 #include <string_view>
+#include <vector>
 
 #include "types.h"
 
@@ -52,6 +53,25 @@ std::string GetProcessName();
 // exist.
 std::string GetProcessName(ProcessId pid);
 
+// A snapshot of a running process and what it's using.
+struct ProcessSnapshot {
+  ProcessId pid;
+  std::string name;
+  // Memory used, in bytes.
+  size_t unique_memory;
+  size_t shared_memory;
+  size_t creation_timestamp;
+  size_t thread_count;
+  size_t registered_services;
+  // The recent CPU usage of each core, from 0 to 255.
+  uint8 cpu_percentages[8];
+};
+
+// Populates `snapshots` with every running process, taken in one trip into the
+// kernel so that they're consistent with each other. Cheaper than calling
+// ForEachProcess, GetProcessName and GetProcessHealthMetrics for each process.
+void GetProcessSnapshots(std::vector<ProcessSnapshot>& snapshots);
+
 // Returns true if the process exists.
 bool DoesProcessExist(ProcessId pid);
 
@@ -0,0 +1,148 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <types.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+#include "perception/memory.h"
+#include "perception/shared_memory.h"
+
+namespace perception {
+
+namespace serialization {
+class Serializable;
+}
+
+// The number of words in an RpcBufferPool's bitmap of free pages.
+constexpr size_t kRpcBufferPoolBitmapWords = 256;
+
+// The most pages an RpcBufferPool's data can grow to.
+constexpr size_t kMaxRpcBufferPoolPages = kRpcBufferPoolBitmapWords * 64;
+
+// The pages an RpcBufferPool's data starts with.
+constexpr size_t kInitialRpcBufferPoolPages = 8;
+
+// The page of shared memory that controls an RpcBufferPool. It never grows, so
+// it stays at the same address while the data is remapped.
+struct RpcBufferPoolHeader {
+  // The ID of the shared memory that parameters are written into.
+  size_t data_shared_memory_id;
+
+  // Set while the sender is waiting for the receiver to free pages. The
+  // receiver triggers a shared memory event at this offset when it frees
+  // pages.
+  std::atomic<uint32> sender_waiting;
+
+  // A set bit for each free page of the data.
+  std::atomic<uint64> free_pages[kRpcBufferPoolBitmapWords];
+};
+
+// Where an RPC's serialized parameters are in an RpcBufferPool.
+struct RpcParameters {
+  // The ID of the pool's header.
+  size_t pool_id;
+  // The size of the pool's data, in bytes, once the parameters were written.
+  size_t data_size;
+  // The first page of the data that the parameters are in.
+  size_t page;
+  // The length of the parameters, in bytes.
+  size_t length;
+};
+
+// The memory that a process sends RPC parameters to one peer through.
+// Parameters take up a run of pages in the pool's data. Pages are allocated by
+// the sender and freed by the receiver without locks, using the bitmap in the
+// header. The data grows as more pages are needed, and once it can't grow any
+// further, senders wait for the receiver to free pages.
+class RpcBufferPool {
+ public:
+  // Creates a pool for sending parameters to a peer. Returns nullptr if the
+  // shared memory couldn't be allocated.
+  static std::shared_ptr<RpcBufferPool> Create();
+
+  // Joins a pool that a peer sends parameters through. Returns nullptr if the
+  // shared memory isn't a pool.
+  static std::shared_ptr<RpcBufferPool> FromSharedMemory(
+      std::shared_ptr<SharedMemory> header);
+
+  RpcBufferPool(std::shared_ptr<SharedMemory> header,
+                std::shared_ptr<SharedMemory> data);
+
+  ~RpcBufferPool();
+
+  // Returns the ID used to identify this pool in messages.
+  size_t GetId() const;
+
+  // Serializes parameters into free pages. If there aren't enough free pages,
+  // the data grows, or if it can't, the fiber sleeps until the receiver frees
+  // some. Returns std::nullopt if the parameters can never fit or the pool was
+  // abandoned.
+  std::optional<RpcParameters> Serialize(
+      const serialization::Serializable& object);
+
+  // Deserializes parameters, then frees their pages.
+  void Deserialize(const RpcParameters& parameters,
+                   serialization::Serializable& object);
+
+  // Frees the pages that parameters are in.
+  void Free(const RpcParameters& parameters);
+
+  // Wakes up any fibers waiting for pages and makes them give up. Called when
+  // the receiver has gone away.
+  void Abandon();
+
+  // Returns the number of pages that hold parameters of this length.
+  static size_t PagesForLength(size_t length);
+
+ private:
+  // Tries to allocate a run of pages. Returns the first page, or std::nullopt
+  // if there isn't a run that's free.
+  std::optional<size_t> TryAllocatePages(size_t pages);
+
+  // Allocates a run of pages, growing the data or waiting if needed.
+  std::optional<size_t> AllocatePages(size_t pages);
+
+  // Grows the data so a run of pages might fit. `seen_data_pages` is how big
+  // the data was when the caller failed to allocate, so that several callers
+  // failing at once only grow it once. Returns false if it can't grow.
+  bool Grow(size_t pages, size_t seen_data_pages);
+
+  std::shared_ptr<SharedMemory> header_memory_;
+  std::shared_ptr<SharedMemory> data_;
+  RpcBufferPoolHeader* header_;
+
+  // The number of pages in the data that the bitmap covers.
+  std::atomic<size_t> data_pages_;
+
+  // Held while growing the data.
+  std::mutex grow_mutex_;
+
+  // Counts how many times the receiver has said it freed pages. Fibers waiting
+  // for pages sleep on this.
+  std::atomic<int> pages_freed_;
+
+  // The message the kernel sends when the receiver frees pages.
+  MessageId pages_freed_message_id_;
+
+  std::atomic<bool> abandoned_;
+};
+
+}  // namespace perception
@@ -12,30 +12,85 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#pragma once
+
 #include <types.h>
 
 #include <memory>
+#include <optional>
 
-#include "perception/shared_memory.h"
+#include "perception/messages.h"
+#include "perception/rpc_buffer_pool.h"
 
 namespace perception {
 
-// Returns the memory buffer for sending to a process. This memory buffer must
-// then be sent, because it sets the first byte to '1' and subsequent calls will
-// sleep until it's '0' again (or the process disappears).
-std::shared_ptr<SharedMemory> GetMemoryBufferForSendingToProcess(
-    ProcessId process_id);
+// Where RPCs put parameters that are small enough to travel in the message
+// instead of in shared memory, as offsets into MessageData::bytes. Requests
+// use param3 to param5, and responses use param2 to param5.
+constexpr size_t kInlineRequestOffset = 2 * sizeof(size_t);
+constexpr size_t kMaxInlineRequestSize = 3 * sizeof(size_t);
+constexpr size_t kInlineResponseOffset = sizeof(size_t);
+constexpr size_t kMaxInlineResponseSize = 4 * sizeof(size_t);
+
+// Whether it's worth trying to fit a type into a message. Types that take up
+// much more memory than a message has room for rarely serialize small enough,
+// so they go straight to shared memory.
+template <class T>
+constexpr bool kMayFitInMessage = sizeof(T) <= 64;
+
+// Serializes an RPC's parameters into the memory that this process sends RPCs
+// to `process_id` through. If that memory is full, the fiber sleeps until the
+// process has read some of the earlier parameters. Returns std::nullopt if the
+// parameters can't be sent.
+std::optional<RpcParameters> SerializeRpcParametersToProcess(
+    ProcessId process_id, const serialization::Serializable& object);
+
+// Frees parameters that were serialized for a process but never sent.
+void ReleaseRpcParametersToProcess(ProcessId process_id,
+                                   const RpcParameters& parameters);
+
+// Deserializes an RPC's parameters that were sent from a process, and frees
+// them so the sender can reuse the memory. The memory stays mapped into this
+// process (for fast reuse) until the sender disappears.
+void DeserializeRpcParametersFromProcess(ProcessId process_id,
+                                         const RpcParameters& parameters,
+                                         serialization::Serializable& object);
+
+// Frees parameters that were sent from a process without reading them.
+void ReleaseRpcParametersFromProcess(ProcessId process_id,
+                                     const RpcParameters& parameters);
+
+// Returns where the parameters of a request are. The page is kept in the
+// metadata above the inline parameters length.
+inline RpcParameters GetRpcRequestParameters(const MessageData& message) {
+  return RpcParameters{.pool_id = message.param3,
+                       .data_size = message.param4,
+                       .page = message.metadata >> 16,
+                       .length = message.param5};
+}
 
-std::shared_ptr<SharedMemory>
-GetMemoryBufferForSendingToProcessRegardlessOfIfInUse(ProcessId process_id,
-                                                      size_t shared_memory_id);
+inline void SetRpcRequestParameters(const RpcParameters& parameters,
+                                    MessageData& message) {
+  message.param3 = parameters.pool_id;
+  message.param4 = parameters.data_size;
+  message.param5 = parameters.length;
+  message.metadata = (message.metadata & 0xFFFF) | (parameters.page << 16);
+}
 
-// Returns the memory buffer sent here from a receiving process. Keeps it mapped
-// into memory (for fast reuse) until the process disappears.
-std::shared_ptr<SharedMemory> GetMemoryBufferForReceivingFromProcess(
-    ProcessId process_id, size_t shared_memory_id);
+// Returns where the parameters of a response are.
+inline RpcParameters GetRpcResponseParameters(const MessageData& message) {
+  return RpcParameters{.pool_id = message.param2,
+                       .data_size = message.param3,
+                       .page = message.metadata >> 16,
+                       .length = message.param4};
+}
 
-void SetMemoryBufferAsReadyForSendingNextMessageToProcess(
-    SharedMemory& shared_memory);
+inline void SetRpcResponseParameters(const RpcParameters& parameters,
+                                     MessageData& message) {
+  message.param2 = parameters.pool_id;
+  message.param3 = parameters.data_size;
+  message.param4 = parameters.length;
+  message.metadata = (message.metadata & 0xFFFF) | (parameters.page << 16);
+}
 
 }  // namespace perception
\ No newline at end of file
@@ -16,14 +16,334 @@
 
 #include <types.h>
 
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "perception/serialization/binary_serializer.h"
+#include "perception/serialization/serializable.h"
+
 namespace perception {
 
 namespace serialization {
 
 class ReadStream;
-class Serializable;
+class SerializableArray;
+
+// Where the binary format is read from. Reading past the end reads zeros.
+class BinaryInput {
+ public:
+  BinaryInput(const void* data, size_t size)
+      : data_((const std::byte*)data),
+        size_(data == nullptr ? 0 : size),
+        offset_(0) {}
+
+  // Copies data out of the input.
+  void Read(void* data, size_t size) {
+    if (offset_ < size_ && size <= size_ - offset_) {
+      std::memcpy(data, data_ + offset_, size);
+      offset_ += size;
+    } else {
+      ReadPastEnd(data, size);
+    }
+  }
+
+  // Reads a byte.
+  uint8 ReadByte() {
+    if (offset_ < size_) return (uint8)data_[offset_++];
+    return 0;
+  }
+
+  // Skips over data.
+  void Skip(size_t size) { offset_ += size; }
+
+  // Returns the next `size` bytes as their own input, and skips over them.
+  BinaryInput SubInput(size_t size) {
+    if (offset_ >= size_) return BinaryInput(nullptr, 0);
+    size_t sub_size = std::min(size, size_ - offset_);
+    BinaryInput sub_input(data_ + offset_, sub_size);
+    offset_ += sub_size;
+    return sub_input;
+  }
+
+ private:
+  // Copies what's left of the input, and zeros the rest.
+  void ReadPastEnd(void* data, size_t size);
+
+  const std::byte* data_;
+  size_t size_;
+  size_t offset_;
+};
+
+// Reads the binary format. This has the same interface as Serializer, but
+// isn't virtual, so that a StaticSerializable's fields are read without a
+// call per field. The virtual Serializer used for everything else forwards to
+// this, so both read the same way.
+class BinaryReader {
+ public:
+  BinaryReader(BinaryInput& input)
+      : input_(input),
+        current_field_index_(0),
+        next_field_index_in_stream_(ReadVariableLengthInteger()) {}
+
+  bool HasThisField(std::string_view name = "") {
+    return next_field_index_in_stream_ == current_field_index_;
+  }
+
+  constexpr bool IsDeserializing() { return true; }
+
+  void Integer() {
+    if (HasThisField()) {
+      (void)ReadVariableLengthInteger();
+      ReadNextFieldIndex();
+    }
+    current_field_index_++;
+  }
+
+  template <class T>
+  void Integer(std::string_view name, T& value) {
+    if constexpr (std::is_signed_v<T>) {
+      int64 v = 0;
+      SignedInteger(name, v);
+      value = static_cast<T>(v);
+    } else {
+      uint64 v = 0;
+      UnsignedInteger(name, v);
+      value = static_cast<T>(v);
+    }
+  }
+
+  template <class T>
+  void Enum(std::string_view name, T& value) {
+    static_assert(std::is_enum_v<T>, "T must be an enum type");
+    std::underlying_type_t<T> v = 0;
+    Integer(name, v);
+    value = static_cast<T>(v);
+  }
+
+  void UnsignedInteger(std::string_view name, uint64& value) {
+    if (HasThisField()) {
+      value = ReadVariableLengthInteger();
+      ReadNextFieldIndex();
+    } else {
+      value = 0;
+    }
+    current_field_index_++;
+  }
+
+  void SignedInteger(std::string_view name, int64& value) {
+    if (HasThisField()) {
+      uint64 zigzag_encoded = ReadVariableLengthInteger();
+      value = (zigzag_encoded >> 1) ^ -static_cast<int64>(zigzag_encoded & 1);
+      ReadNextFieldIndex();
+    } else {
+      value = 0;
+    }
+    current_field_index_++;
+  }
+
+  void Float() { SkipFixedSizeField(sizeof(float)); }
+
+  void Float(std::string_view name, float& value) {
+    ReadFixedSizeField(&value, sizeof(float));
+  }
+
+  void Double() { SkipFixedSizeField(sizeof(double)); }
+
+  void Double(std::string_view name, double& value) {
+    ReadFixedSizeField(&value, sizeof(double));
+  }
+
+  void String() {
+    if (HasThisField()) {
+      input_.Skip(ReadVariableLengthInteger());
+      ReadNextFieldIndex();
+    }
+    current_field_index_++;
+  }
+
+  void String(std::string_view name, std::string& str) {
+    if (HasThisField()) {
+      uint64 string_length = ReadVariableLengthInteger();
+      str.resize(string_length);
+      input_.Read(&str[0], string_length);
+      ReadNextFieldIndex();
+    } else {
+      str.clear();
+    }
+    current_field_index_++;
+  }
+
+  void Serializable() {
+    if (HasThisField()) {
+      input_.Skip(ReadSize());
+      ReadNextFieldIndex();
+    }
+    current_field_index_++;
+  }
+
+  template <class S>
+  void Serializable(std::string_view name, S& obj) {
+    if (HasThisField()) {
+      ReadObject(obj);
+      ReadNextFieldIndex();
+    } else {
+      // Still read the object, so its fields are reset.
+      BinaryInput empty_input(nullptr, 0);
+      ReadFields(empty_input, obj);
+    }
+    current_field_index_++;
+  }
+
+  template <class S>
+  void Serializable(std::string_view name, std::shared_ptr<S>& obj) {
+    if (HasThisField()) {
+      if (!obj) obj = std::make_shared<S>();
+      Serializable(name, *obj);
+    } else {
+      obj.reset();
+      Serializable();
+    }
+  }
+
+  template <class S>
+  void Serializable(std::string_view name, std::optional<S>& obj) {
+    if (HasThisField()) {
+      if (!obj) obj = S();
+      Serializable(name, *obj);
+    } else {
+      obj.reset();
+      Serializable();
+    }
+  }
+
+  // The first thing encoded is the byte size of the entire array, so an array
+  // can be skipped over in the same way as a serializable.
+  void ArrayOfSerializables() { Serializable(); }
+
+  template <class S>
+  void ArrayOfSerializables(std::string_view name, std::vector<S>& arr) {
+    if (HasThisField()) {
+      // Read through the array in a self-contained sub input in case something
+      // is malformed and while reading the array, either not all bytes are
+      // read or it attemps to read past the end of the array.
+      BinaryInput array_input = input_.SubInput(ReadSize());
+      arr.resize(ReadVariableLengthIntegerFromInput(array_input));
+      for (auto& entry : arr) ReadObjectFromInput(array_input, entry);
+      ReadNextFieldIndex();
+    } else {
+      arr.clear();
+    }
+    current_field_index_++;
+  }
+
+  template <class S>
+  void ArrayOfSerializables(std::string_view name,
+                            std::vector<std::shared_ptr<S>>& arr) {
+    if (HasThisField()) {
+      BinaryInput array_input = input_.SubInput(ReadSize());
+      arr.resize(ReadVariableLengthIntegerFromInput(array_input));
+      for (auto& entry : arr) {
+        if (!entry) entry = std::make_shared<S>();
+        ReadObjectFromInput(array_input, *entry);
+      }
+      ReadNextFieldIndex();
+    } else {
+      arr.clear();
+    }
+    current_field_index_++;
+  }
+
+  void ArrayOfSerializables(std::string_view name, SerializableArray& arr);
+
+  void ArrayOfStrings() { Serializable(); }
+
+  void ArrayOfStrings(std::string_view name, std::vector<std::string>& arr);
+
+  // Reads an object's fields, as the root object or inside of ReadObject().
+  template <class S>
+  static void ReadFields(BinaryInput& input, S& obj) {
+    BinaryReader reader(input);
+    if constexpr (IsStaticSerializable<S>) {
+      obj.Serialize(reader);
+    } else {
+      obj.DeserializeFromBinary(reader);
+    }
+  }
+
+  static uint64 ReadVariableLengthIntegerFromInput(BinaryInput& input) {
+    uint64 result = 0;
+    // An encoded 64-bit integer can be at most 10 bytes long (since 10 * 7 =
+    // 70 bits). Anything longer is malformed.
+    for (unsigned int shift = 0; shift < 70; shift += 7) {
+      uint8 byte = input.ReadByte();
+      result |= static_cast<uint64>(byte & 0x7F) << shift;
+      // The continuation bit (MSB) is 0 on the last byte.
+      if ((byte & 0x80) == 0) break;
+    }
+    return result;
+  }
+
+ private:
+  // Reads an object that's prefixed with its size, as a serializable field or
+  // array element is.
+  template <class S>
+  void ReadObject(S& obj) {
+    ReadObjectFromInput(input_, obj);
+  }
+
+  template <class S>
+  static void ReadObjectFromInput(BinaryInput& input, S& obj) {
+    uint32 size;
+    input.Read(&size, 4);
+    BinaryInput object_input = input.SubInput(size);
+    ReadFields(object_input, obj);
+  }
+
+  void SkipFixedSizeField(size_t size) {
+    if (HasThisField()) {
+      input_.Skip(size);
+      ReadNextFieldIndex();
+    }
+    current_field_index_++;
+  }
+
+  void ReadFixedSizeField(void* value, size_t size) {
+    if (HasThisField()) {
+      input_.Read(value, size);
+      ReadNextFieldIndex();
+    } else {
+      std::memset(value, 0, size);
+    }
+    current_field_index_++;
+  }
+
+  uint32 ReadSize() {
+    uint32 size;
+    input_.Read(&size, 4);
+    return size;
+  }
+
+  uint64 ReadVariableLengthInteger() {
+    return ReadVariableLengthIntegerFromInput(input_);
+  }
+
+  void ReadNextFieldIndex() {
+    next_field_index_in_stream_ = ReadVariableLengthInteger();
+  }
+
+  BinaryInput& input_;
+  int current_field_index_;
+  int next_field_index_in_stream_;
+};
 
+// Deserializes an object from a stream.
 void DeserializeFromStream(Serializable &object, ReadStream &stream);
 
 }  // namespace serialization
-}  // namespace perception
\ No newline at end of file
+}  // namespace perception
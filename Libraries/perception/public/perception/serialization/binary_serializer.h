@@ -16,16 +16,282 @@
 
 #include <types.h>
 
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "perception/serialization/serializable.h"
 
 namespace perception {
 namespace serialization {
 
-class Serializable;
+class SerializableArray;
 class WriteStream;
 
+// Whether S is a StaticSerializable, so its Serialize() can be instantiated
+// against a concrete serializer. Classes deriving from a StaticSerializable
+// don't count, since they might override its virtual methods.
+template <class S>
+concept IsStaticSerializable = requires {
+  typename S::StaticSerializableType;
+} && std::is_same_v<typename S::StaticSerializableType, S>;
+
+// Where the binary format is written to. Either a vector that grows, or a
+// fixed area of memory where writes past the end are dropped but still
+// counted, so the caller can find out how much space it needed.
+class BinaryOutput {
+ public:
+  // Writes into a vector. Call Finish() once done.
+  explicit BinaryOutput(std::vector<std::byte>* vector);
+
+  // Writes into an area of memory. `data` may be nullptr to only measure the
+  // length.
+  BinaryOutput(void* data, size_t size);
+
+  // Copies data to the end of the output.
+  void Write(const void* data, size_t size) {
+    if (size <= capacity_ - std::min(offset_, capacity_)) {
+      std::memcpy(data_ + offset_, data, size);
+    } else if (vector_ != nullptr) {
+      GrowVector(offset_ + size);
+      std::memcpy(data_ + offset_, data, size);
+    }
+    offset_ += size;
+  }
+
+  // Copies data to an earlier offset in the output.
+  void WriteAt(size_t offset, const void* data, size_t size) {
+    if (offset <= capacity_ && size <= capacity_ - offset)
+      std::memcpy(data_ + offset, data, size);
+  }
+
+  // Skips over space that will be written with WriteAt().
+  void Skip(size_t size) {
+    offset_ += size;
+    if (vector_ != nullptr && offset_ > capacity_) GrowVector(offset_);
+  }
+
+  // Returns the length of the output.
+  size_t Offset() const { return offset_; }
+
+  // Trims the vector to the length of the output.
+  void Finish();
+
+ private:
+  // Grows the vector to hold at least `size` bytes.
+  void GrowVector(size_t size);
+
+  std::byte* data_;
+  size_t capacity_;
+  size_t offset_;
+  std::vector<std::byte>* vector_;
+};
+
+// Writes the binary format. This has the same interface as Serializer, but
+// isn't virtual, so that a StaticSerializable's fields are written without a
+// call per field. The virtual Serializer used for everything else forwards to
+// this, so both write the same bytes.
+class BinaryWriter {
+ public:
+  BinaryWriter(BinaryOutput& output)
+      : output_(output), current_field_index_(0) {}
+
+  bool HasThisField(std::string_view name = "") { return false; }
+
+  constexpr bool IsDeserializing() { return false; }
+
+  void Integer() { current_field_index_++; }
+
+  template <class T>
+  void Integer(std::string_view name, T& value) {
+    if constexpr (std::is_signed_v<T>) {
+      SignedInteger(name, static_cast<int64>(value));
+    } else {
+      UnsignedInteger(name, static_cast<uint64>(value));
+    }
+  }
+
+  template <class T>
+  void Enum(std::string_view name, T& value) {
+    static_assert(std::is_enum_v<T>, "T must be an enum type");
+    auto v = static_cast<std::underlying_type_t<T>>(value);
+    Integer(name, v);
+  }
+
+  void UnsignedInteger(std::string_view name, uint64 value) {
+    if (value > 0) {
+      WriteVariableLengthInteger(current_field_index_);
+      WriteVariableLengthInteger(value);
+    }
+    current_field_index_++;
+  }
+
+  void SignedInteger(std::string_view name, int64 value) {
+    if (value != 0) {
+      WriteVariableLengthInteger(current_field_index_);
+      WriteVariableLengthInteger((static_cast<uint64>(value) << 1) ^
+                                 (value >> 63));
+    }
+    current_field_index_++;
+  }
+
+  void Float() { current_field_index_++; }
+
+  void Float(std::string_view name, float& value) {
+    if (value != 0) {
+      WriteVariableLengthInteger(current_field_index_);
+      output_.Write(&value, sizeof(float));
+    }
+    current_field_index_++;
+  }
+
+  void Double() { current_field_index_++; }
+
+  void Double(std::string_view name, double& value) {
+    if (value != 0) {
+      WriteVariableLengthInteger(current_field_index_);
+      output_.Write(&value, sizeof(double));
+    }
+    current_field_index_++;
+  }
+
+  void String() { current_field_index_++; }
+
+  void String(std::string_view name, std::string& str) {
+    if (!str.empty()) {
+      WriteVariableLengthInteger(current_field_index_);
+      WriteVariableLengthInteger(str.length());
+      output_.Write(str.data(), str.length());
+    }
+    current_field_index_++;
+  }
+
+  void Serializable() { current_field_index_++; }
+
+  template <class S>
+  void Serializable(std::string_view name, S& obj) {
+    WriteVariableLengthInteger(current_field_index_);
+    WriteObject(obj);
+    current_field_index_++;
+  }
+
+  template <class S>
+  void Serializable(std::string_view name, std::shared_ptr<S>& obj) {
+    if (obj) {
+      Serializable(name, *obj);
+    } else {
+      Serializable();
+    }
+  }
+
+  template <class S>
+  void Serializable(std::string_view name, std::optional<S>& obj) {
+    if (obj) {
+      Serializable(name, *obj);
+    } else {
+      Serializable();
+    }
+  }
+
+  void ArrayOfSerializables() { current_field_index_++; }
+
+  template <class S>
+  void ArrayOfSerializables(std::string_view name, std::vector<S>& arr) {
+    if (!arr.empty()) {
+      WriteVariableLengthInteger(current_field_index_);
+      size_t size_position = BeginSizedBlock();
+      WriteVariableLengthInteger(arr.size());
+      for (auto& entry : arr) WriteObject(entry);
+      EndSizedBlock(size_position);
+    }
+    current_field_index_++;
+  }
+
+  template <class S>
+  void ArrayOfSerializables(std::string_view name,
+                            std::vector<std::shared_ptr<S>>& arr) {
+    if (!arr.empty()) {
+      WriteVariableLengthInteger(current_field_index_);
+      size_t size_position = BeginSizedBlock();
+      WriteVariableLengthInteger(arr.size());
+      for (auto& entry : arr) {
+        if (entry) {
+          WriteObject(*entry);
+        } else {
+          S empty_object{};
+          WriteObject(empty_object);
+        }
+      }
+      EndSizedBlock(size_position);
+    }
+    current_field_index_++;
+  }
+
+  void ArrayOfSerializables(std::string_view name, SerializableArray& arr);
+
+  void ArrayOfStrings() { current_field_index_++; }
+
+  void ArrayOfStrings(std::string_view name, std::vector<std::string>& arr);
+
+  // Writes an object's fields, as the root object or inside of
+  // WriteObject().
+  template <class S>
+  static void WriteFields(BinaryOutput& output, S& obj) {
+    BinaryWriter writer(output);
+    if constexpr (IsStaticSerializable<S>) {
+      obj.Serialize(writer);
+    } else {
+      obj.SerializeToBinary(writer);
+    }
+  }
+
+ private:
+  // Writes an object, prefixed with its size, as a serializable field or array
+  // element is.
+  template <class S>
+  void WriteObject(S& obj) {
+    size_t size_position = BeginSizedBlock();
+    WriteFields(output_, obj);
+    EndSizedBlock(size_position);
+  }
+
+  void WriteVariableLengthInteger(uint64 value) {
+    uint8 bytes[10];
+    size_t length = 0;
+    while (value >= 0x80) {
+      bytes[length++] = static_cast<uint8>(value & 0x7F) | 0x80;
+      value >>= 7;
+    }
+    bytes[length++] = static_cast<uint8>(value);
+    output_.Write(bytes, length);
+  }
+
+  // Reserves space for the size of what's written next, and returns where it
+  // is.
+  size_t BeginSizedBlock() {
+    size_t size_position = output_.Offset();
+    output_.Skip(4);
+    return size_position;
+  }
+
+  // Writes the size of what was written since BeginSizedBlock().
+  void EndSizedBlock(size_t size_position) {
+    uint32 size =
+        static_cast<uint32>(output_.Offset() - (size_position + 4));
+    output_.WriteAt(size_position, &size, 4);
+  }
+
+  BinaryOutput& output_;
+  int current_field_index_;
+};
+
 // Serializes an object into a stream.
 void SerializeIntoStream(const Serializable &object, WriteStream &stream);
 
 }  // namespace serialization
-}  // namespace perception
\ No newline at end of file
+}  // namespace perception
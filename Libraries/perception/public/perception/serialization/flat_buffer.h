@@ -0,0 +1,221 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <types.h>
+
+#include <memory>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "perception/memory_span.h"
+
+namespace perception {
+
+#if defined(PERCEPTION)
+class SharedMemory;
+#endif
+
+namespace serialization {
+
+// A flat buffer is an opt-in alternative to the binary serializer for bulk
+// payloads. The root is a plain struct at a fixed offset, and its strings and
+// arrays are stored elsewhere in the buffer and referred to by offset. The
+// receiver reads it in place, without copying or allocating, and every offset
+// is checked against the size of the buffer.
+//
+// Example usage:
+//   struct FileEntry {
+//     FlatString name;
+//     uint64 size;
+//   };
+//
+//   struct Directory {
+//     FlatArray<FileEntry> entries;
+//   };
+//
+//   FlatBuilder builder;
+//   std::vector<FileEntry> entries;
+//   for (...) entries.push_back({builder.String(name), size});
+//   Directory directory{builder.Array(entries)};
+//   builder.Finish(directory);
+//
+//   FlatView<Directory> view(builder.Data());
+//   if (!view) return;
+//   for (const FileEntry& entry : view.Array(view->entries))
+//     std::cout << view.String(entry.name) << std::endl;
+//
+// Unlike the binary serializer's format, a flat buffer isn't self describing.
+// Fields may only be added to the end of a struct. A reader accepts a root
+// that is larger than it expects, but not one that is smaller. Structs must be
+// trivially copyable, and shouldn't contain pointers.
+
+// A string in a flat buffer.
+struct FlatString {
+  uint32 offset = 0;
+  uint32 length = 0;
+};
+
+// An array of trivially copyable elements in a flat buffer.
+template <class T>
+struct FlatArray {
+  uint32 offset = 0;
+  uint32 length = 0;
+};
+
+// The start of every flat buffer.
+struct FlatBufferHeader {
+  uint32 magic;
+  uint32 root_offset;
+  uint32 root_size;
+  uint32 reserved;
+};
+
+// Identifies a flat buffer. "FLAT" in little endian.
+constexpr uint32 kFlatBufferMagic = 0x54414C46;
+
+// Builds a flat buffer. Strings and arrays are added first, then the root.
+class FlatBuilder {
+ public:
+  FlatBuilder();
+
+  // Adds a string, and returns where it is.
+  FlatString String(std::string_view str);
+
+  // Adds an array, and returns where it is.
+  template <class T>
+  FlatArray<T> Array(std::span<const T> elements) {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "Flat buffer elements must be trivially copyable.");
+    FlatArray<T> array;
+    array.offset =
+        (uint32)Append(elements.data(), elements.size_bytes(), alignof(T));
+    array.length = (uint32)elements.size();
+    return array;
+  }
+
+  template <class T>
+  FlatArray<T> Array(const std::vector<T>& elements) {
+    return Array(std::span<const T>(elements));
+  }
+
+  // Adds the root, and returns the finished buffer.
+  template <class T>
+  const std::vector<std::byte>& Finish(const T& root) {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "A flat buffer's root must be trivially copyable.");
+    return FinishWithRoot(&root, sizeof(T), alignof(T));
+  }
+
+  // Returns the buffer.
+  const std::vector<std::byte>& Data() const;
+
+  // Starts a new buffer, keeping the memory that was allocated.
+  void Clear();
+
+#if defined(PERCEPTION)
+  // Copies the buffer into shared memory that the receiver can read in place.
+  std::shared_ptr<SharedMemory> ToSharedMemory() const;
+#endif
+
+ private:
+  // Appends data aligned to `alignment`, and returns its offset.
+  size_t Append(const void* data, size_t size, size_t alignment);
+
+  const std::vector<std::byte>& FinishWithRoot(const void* root, size_t size,
+                                               size_t alignment);
+
+  std::vector<std::byte> data_;
+};
+
+// Reads a flat buffer in place. The part that doesn't depend on the root's
+// type.
+class FlatReader {
+ public:
+  FlatReader(const void* data, size_t size);
+
+#if defined(PERCEPTION)
+  // Reads a flat buffer in shared memory.
+  explicit FlatReader(SharedMemory& shared_memory);
+#endif
+
+  // Returns a string, or an empty string if it's outside of the buffer.
+  std::string_view String(const FlatString& str) const;
+
+ protected:
+  // Reads a field exactly once. The buffer might be in shared memory that the
+  // sender can still write to, so a field must be copied before it's checked,
+  // and only the copy used afterwards.
+  static uint32 ReadOnce(const uint32& field) {
+    return *(const volatile uint32*)&field;
+  }
+
+  // Returns the root, or nullptr if it's invalid.
+  const void* Root(size_t size, size_t alignment) const;
+
+  // Returns an array's elements, or nullptr if they're outside of the buffer.
+  const void* ArrayData(uint32 offset, uint32 length, size_t element_size,
+                        size_t alignment) const;
+
+ private:
+  MemorySpan span_;
+};
+
+// Reads a flat buffer with a root of type T in place. The buffer must outlive
+// the view, and anything read from it.
+template <class T>
+class FlatView : public FlatReader {
+ public:
+  FlatView(const void* data, size_t size)
+      : FlatReader(data, size),
+        root_((const T*)FlatReader::Root(sizeof(T), alignof(T))) {}
+
+  explicit FlatView(const std::vector<std::byte>& data)
+      : FlatView(data.data(), data.size()) {}
+
+#if defined(PERCEPTION)
+  explicit FlatView(SharedMemory& shared_memory)
+      : FlatReader(shared_memory),
+        root_((const T*)FlatReader::Root(sizeof(T), alignof(T))) {}
+#endif
+
+  // Returns whether the buffer holds a root.
+  explicit operator bool() const { return root_ != nullptr; }
+
+  // Returns the root, or nullptr if the buffer doesn't hold one.
+  const T* Root() const { return root_; }
+
+  const T* operator->() const { return root_; }
+
+  // Returns an array's elements, or an empty span if they're outside of the
+  // buffer.
+  template <class E>
+  std::span<const E> Array(const FlatArray<E>& array) const {
+    uint32 offset = ReadOnce(array.offset);
+    uint32 length = ReadOnce(array.length);
+    const E* elements =
+        (const E*)ArrayData(offset, length, sizeof(E), alignof(E));
+    if (elements == nullptr) return std::span<const E>();
+    return std::span<const E>(elements, length);
+  }
+
+ private:
+  const T* root_;
+};
+
+}  // namespace serialization
+}  // namespace perception
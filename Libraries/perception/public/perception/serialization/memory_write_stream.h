@@ -0,0 +1,60 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <types.h>
+
+#include "perception/serialization/write_stream.h"
+
+namespace perception {
+namespace serialization {
+
+class Serializable;
+
+// Writes into a fixed size area of memory. Anything written past the end is
+// dropped, but still counts towards the offset, so the caller can tell how
+// much memory it would have needed.
+class MemoryWriteStream : public WriteStream {
+ public:
+  MemoryWriteStream(void* data, size_t size);
+
+  // Copies data into the stream.
+  virtual void CopyDataIntoStream(const void* data, size_t size) override;
+
+  // Copies data into the stream at a specific offset. This is isolated and does
+  // not change 'CurrentOffset'.
+  virtual void CopyDataIntoStream(const void* data, size_t size,
+                                  size_t offset) override;
+
+  // Skip forward the current offset.
+  virtual void SkipForward(size_t size) override;
+
+  // The current offset in the stream.
+  virtual size_t CurrentOffset() override;
+
+ private:
+  void* data_;
+  size_t size_;
+  size_t current_offset_;
+};
+
+// Serializes a serializable into an area of memory. Returns the serialized
+// length, which is larger than `size` if it didn't fit. Passing a null `data`
+// measures the length without writing anything.
+size_t SerializeToMemory(const Serializable& object, void* data, size_t size);
+
+}  // namespace serialization
+}  // namespace perception
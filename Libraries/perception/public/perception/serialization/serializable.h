@@ -19,6 +19,8 @@
 namespace perception {
 namespace serialization {
 
+class BinaryReader;
+class BinaryWriter;
 class Serializer;
 
 // Interface for a class that is serializable.
@@ -27,6 +29,14 @@ class Serializable {
   // Serializes the class.
   virtual void Serialize(Serializer& serializer) = 0;
 
+  // Serializes the class to the binary format. By default this goes through
+  // Serialize(), but StaticSerializable calls the writer directly.
+  virtual void SerializeToBinary(BinaryWriter& writer);
+
+  // Deserializes the class from the binary format. By default this goes
+  // through Serialize(), but StaticSerializable calls the reader directly.
+  virtual void DeserializeFromBinary(BinaryReader& reader);
+
   // Serializes to a human readable string.
   virtual std::string ToString() const;
 };
@@ -28,6 +28,65 @@ namespace serialization {
 
 class Serializable;
 
+// An array of serializables, that a serializer reads or writes each element
+// of.
+class SerializableArray {
+ public:
+  // Returns the number of elements.
+  virtual size_t Size() = 0;
+
+  // Resizes the array before deserializing into it.
+  virtual void Resize(size_t size) = 0;
+
+  // Returns an element. It only needs to stay valid until the next call.
+  virtual class Serializable& At(size_t index) = 0;
+};
+
+// Adapts a vector of serializables, or of shared pointers to serializables, to
+// a SerializableArray. Empty pointers serialize like default constructed
+// objects.
+template <class T>
+class VectorOfSerializables : public SerializableArray {
+ public:
+  VectorOfSerializables(std::vector<T>& elements) : elements_(elements) {}
+
+  virtual size_t Size() override { return elements_.size(); }
+
+  virtual void Resize(size_t size) override { elements_.resize(size); }
+
+  virtual class Serializable& At(size_t index) override {
+    return elements_[index];
+  }
+
+ private:
+  std::vector<T>& elements_;
+};
+
+template <class S>
+class VectorOfSerializables<std::shared_ptr<S>> : public SerializableArray {
+ public:
+  VectorOfSerializables(std::vector<std::shared_ptr<S>>& elements)
+      : elements_(elements) {}
+
+  virtual size_t Size() override { return elements_.size(); }
+
+  virtual void Resize(size_t size) override {
+    elements_.resize(size);
+    for (auto& element : elements_)
+      if (!element) element = std::make_shared<S>();
+  }
+
+  virtual class Serializable& At(size_t index) override {
+    if (auto& element = elements_[index]) return *element;
+    empty_object_ = S{};
+    return empty_object_;
+  }
+
+ private:
+  std::vector<std::shared_ptr<S>>& elements_;
+  S empty_object_;
+};
+
 // Interface for a serializer passed to serializable.
 //
 // The serializer has a set of function for either serializing or skipping
@@ -162,62 +221,20 @@ class Serializer {
 
   virtual void ArrayOfSerializables() = 0;
 
-  virtual void ArrayOfSerializables(
-      std::string_view name, int current_size,
-      const std::function<
-          void(const std::function<void(class Serializable& serializable)>&
-                   serialize_entry)>& serialization_function,
-      const std::function<
-          void(int elements,
-               const std::function<void(class Serializable& serializable)>&
-                   deserialize_entry)>& deserialization_function) = 0;
+  virtual void ArrayOfSerializables(std::string_view name,
+                                    SerializableArray& arr) = 0;
 
   template <class S>
   void ArrayOfSerializables(std::string_view name,
                             std::vector<std::shared_ptr<S>>& arr) {
-    ArrayOfSerializables(
-        name, arr.size(),
-        /*serilization_function=*/
-        [&arr](const std::function<void(class Serializable & serializable)>&
-                   serialize_entry) {
-          for (auto& entry_ptr : arr) {
-            if (entry_ptr) {
-              serialize_entry(*entry_ptr);
-            } else {
-              S empty_object{};
-              serialize_entry(empty_object);
-            }
-          }
-        },
-        /*deserialization_function=*/
-        [&arr](int elements,
-               const std::function<void(class Serializable & serializable)>&
-                   deserialize_entry) {
-          arr.resize(elements);
-          for (int i = 0; i < elements; i++) {
-            auto& ptr = arr[i];
-            if (!ptr) ptr = std::make_shared<S>();
-            deserialize_entry(*ptr);
-          }
-        });
+    VectorOfSerializables<std::shared_ptr<S>> array(arr);
+    ArrayOfSerializables(name, array);
   }
 
   template <class S>
   void ArrayOfSerializables(std::string_view name, std::vector<S>& arr) {
-    ArrayOfSerializables(
-        name, arr.size(),
-        /*serilization_function=*/
-        [&arr](const std::function<void(class Serializable & serializable)>&
-                   serialize_entry) {
-          for (auto& entry : arr) serialize_entry(entry);
-        },
-        /*deserialization_function=*/
-        [&arr](int elements,
-               const std::function<void(class Serializable & serializable)>&
-                   deserialize_entry) {
-          arr.resize(elements);
-          for (int i = 0; i < elements; i++) deserialize_entry(arr[i]);
-        });
+    VectorOfSerializables<S> array(arr);
+    ArrayOfSerializables(name, array);
   }
 
   virtual void ArrayOfStrings() = 0;
@@ -0,0 +1,67 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "perception/serialization/binary_deserializer.h"
+#include "perception/serialization/binary_serializer.h"
+#include "perception/serialization/serializable.h"
+#include "perception/serialization/serializer.h"
+
+namespace perception {
+namespace serialization {
+
+// A serializable whose Serialize() is a template, so that it can be
+// instantiated against the concrete binary reader and writer. Their field
+// methods are inlined, rather than each field going through a virtual call. It
+// writes the same bytes as a Serializable with the same fields, so either can
+// be used on each side of a message. Other serializers (such as the text
+// serializer) still call it through Serializer.
+//
+// Example usage:
+//   class MyObject : public serialization::StaticSerializable<MyObject> {
+//    public:
+//     std::string name;
+//     int age;
+//
+//     template <class S>
+//     void Serialize(S& serializer) {
+//       serializer.String("Name", name);
+//       serializer.Integer("Age", age);
+//     }
+//   };
+//
+// Nested StaticSerializables, including in arrays, are also read and written
+// without virtual calls.
+template <class Derived>
+class StaticSerializable : public Serializable {
+ public:
+  // Identifies the class to the binary reader and writer.
+  using StaticSerializableType = Derived;
+
+  virtual void Serialize(Serializer& serializer) override {
+    static_cast<Derived*>(this)->Serialize(serializer);
+  }
+
+  virtual void SerializeToBinary(BinaryWriter& writer) override {
+    static_cast<Derived*>(this)->Serialize(writer);
+  }
+
+  virtual void DeserializeFromBinary(BinaryReader& reader) override {
+    static_cast<Derived*>(this)->Serialize(reader);
+  }
+};
+
+}  // namespace serialization
+}  // namespace perception
@@ -16,6 +16,7 @@
 
 #include <types.h>
 
+#include <algorithm>
 #include <functional>
 #include <memory>
 #include <string>
@@ -25,8 +26,8 @@
 #include "perception/processes.h"
 #include "perception/rpc_memory.h"
 #include "perception/serialization/memory_read_stream.h"
+#include "perception/serialization/memory_write_stream.h"
 #include "perception/serialization/serializable.h"
-#include "perception/serialization/shared_memory_write_stream.h"
 #include "perception/services.h"
 #include "perception/tracing.h"
 #include "status.h"
@@ -176,12 +177,10 @@ class ServiceClient : public serialization::Serializable {
     auto send_status = SendMessage(process_id_, message);
     if (send_status != Status::OK) {
       UnregisterMessageHandler(message_id_of_response);
-      if (message.param3 != SIZE_MAX) {
-        auto shared_memory =
-            GetMemoryBufferForSendingToProcessRegardlessOfIfInUse(
-                process_id_, message.param3);
-        if (shared_memory)
-          SetMemoryBufferAsReadyForSendingNextMessageToProcess(*shared_memory);
+      if (!HasInlineParameters(message.metadata) &&
+          message.param3 != SIZE_MAX) {
+        ReleaseRpcParametersToProcess(process_id_,
+                                      GetRpcRequestParameters(message));
       }
 
       return ::perception::ToStatus(send_status);
@@ -212,13 +211,10 @@ class ServiceClient : public serialization::Serializable {
 
       auto send_status = SendMessage(process_id_, message);
       if (send_status != Status::OK) {
-        if (message.param3 != SIZE_MAX) {
-          auto shared_memory =
-              GetMemoryBufferForSendingToProcessRegardlessOfIfInUse(
-                  process_id_, message.param3);
-          if (shared_memory)
-            SetMemoryBufferAsReadyForSendingNextMessageToProcess(
-                *shared_memory);
+        if (!HasInlineParameters(message.metadata) &&
+            message.param3 != SIZE_MAX) {
+          ReleaseRpcParametersToProcess(process_id_,
+                                        GetRpcRequestParameters(message));
         }
 
 #ifdef ENABLE_TRACING
@@ -272,16 +268,16 @@ class ServiceClient : public serialization::Serializable {
       MaybeHandleUnexpectedMemoryInResponse(process_id, message);
     } else {
       if (status == Status::OK) {
-        if (message.param2 == SIZE_MAX) {
+        if (HasInlineParameters(message.metadata)) {
+          serialization::DeserializeFromMemory(
+              *response, &message.bytes[kInlineResponseOffset],
+              std::min(GetInlineParametersLength(message.metadata),
+                       kMaxInlineResponseSize));
+        } else if (message.param2 == SIZE_MAX) {
           serialization::DeserializeToEmpty(*response);
         } else {
-          auto shared_memory = GetMemoryBufferForReceivingFromProcess(
-              process_id, message.param2);
-          if (shared_memory->Grow(message.param3)) {
-            serialization::DeserializeFromSharedMemory(*response, *shared_memory, 1,
-                                        message.param4);
-            SetMemoryBufferAsReadyForSendingNextMessageToProcess(*shared_memory);
-          }
+          DeserializeRpcParametersFromProcess(
+              process_id, GetRpcResponseParameters(message), *response);
         }
       } else {
         MaybeHandleUnexpectedMemoryInResponse(process_id, message);
@@ -304,13 +300,19 @@ class ServiceClient : public serialization::Serializable {
                                           MessageData& message) {
     PrepareRequestMessage(method_id, message);
 
-    auto shared_memory = GetMemoryBufferForSendingToProcess(process_id_);
-    if (!shared_memory) return false;
+    if constexpr (kMayFitInMessage<RequestType>) {
+      // Small requests are sent in the message's spare parameters.
+      size_t size = serialization::SerializeToMemory(
+          request, &message.bytes[kInlineRequestOffset], kMaxInlineRequestSize);
+      if (size <= kMaxInlineRequestSize) {
+        SetInlineParameters(message.metadata, size);
+        return true;
+      }
+    }
 
-    message.param5 =
-        serialization::SerializeToSharedMemory(request, *shared_memory, 1);
-    message.param3 = shared_memory->GetId();
-    message.param4 = shared_memory->GetSize();
+    auto parameters = SerializeRpcParametersToProcess(process_id_, request);
+    if (!parameters) return false;
+    SetRpcRequestParameters(*parameters, message);
     return true;
   }
 
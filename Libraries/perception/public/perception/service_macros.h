@@ -43,6 +43,11 @@
 //   return_type - The return type. Must either be a Serializable or void.
 //   argument_type - The argument type. Must either be a Serializable or void.
 //
+// Arguments and return values that serialize small enough are sent inside the
+// message, and anything larger is sent through shared memory. Which types are
+// worth trying to fit into the message is decided at compile time by
+// kMayFitInMessage in rpc_memory.h.
+//
 // For example:
 //   #define CALCULATOR_METHOD_LIST(X)          \
 //     X(1, Add, SingleValue, DoubleValue)      \
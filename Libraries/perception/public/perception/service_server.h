@@ -14,15 +14,16 @@
 
 #pragma once
 
+#include <algorithm>
 #include <functional>
 #include <string>
 #include <string_view>
+#include <type_traits>
 
 #include "perception/messages.h"
 #include "perception/rpc_memory.h"
 #include "perception/serialization/memory_read_stream.h"
-#include "perception/serialization/shared_memory_write_stream.h"
-#include "perception/shared_memory.h"
+#include "perception/serialization/memory_write_stream.h"
 #include "perception/tracing.h"
 #include "status.h"
 
@@ -70,18 +71,19 @@ class ServiceServer {
 
     RequestType request;
 
-    if (message.param3 == SIZE_MAX) {
+    if (HasInlineParameters(message.metadata)) {
+      // The request was small enough to be sent in the message.
+      serialization::DeserializeFromMemory(
+          request, &message.bytes[kInlineRequestOffset],
+          std::min(GetInlineParametersLength(message.metadata),
+                   kMaxInlineRequestSize));
+    } else if (message.param3 == SIZE_MAX) {
       // No attached message.
       serialization::DeserializeToEmpty(request);
     } else {
       // Deserialized attached memory.
-      auto shared_memory =
-          GetMemoryBufferForReceivingFromProcess(sender, message.param3);
-      shared_memory->Grow(message.param4);
-      serialization::DeserializeFromSharedMemory(request, *shared_memory, 1,
-                                                 message.param5);
-
-      SetMemoryBufferAsReadyForSendingNextMessageToProcess(*shared_memory);
+      DeserializeRpcParametersFromProcess(
+          sender, GetRpcRequestParameters(message), request);
     }
 
     if (!IsCallExpectingResponse(message.metadata)) {
@@ -144,19 +146,32 @@ class ServiceServer {
       response_data.param3 = 0;
     } else {
       if (response.Ok()) {
+        using ValueType = std::remove_cvref_t<decltype(*response)>;
+        if constexpr (kMayFitInMessage<ValueType>) {
+          // Send back a small response in the message.
+          size_t size = serialization::SerializeToMemory(
+              *response, &response_data.bytes[kInlineResponseOffset],
+              kMaxInlineResponseSize);
+          if (size <= kMaxInlineResponseSize) {
+            SetInlineParameters(response_data.metadata, size);
+            SendMessage(sender, response_data);
+            return;
+          }
+        }
+
         // Send back response type.
-        auto shared_memory = GetMemoryBufferForSendingToProcess(sender);
-        if (shared_memory == nullptr) {
+        auto parameters = SerializeRpcParametersToProcess(sender, *response);
+        if (!parameters) {
           response_data.param1 = static_cast<size_t>(Status::OUT_OF_MEMORY);
           response_data.param2 = SIZE_MAX;
           response_data.param3 = 0;
           SendMessage(sender, response_data);
           return;
         }
-        response_data.param4 = serialization::SerializeToSharedMemory(
-            *response, *shared_memory, 1);
-        response_data.param2 = shared_memory->GetId();
-        response_data.param3 = shared_memory->GetSize();
+        SetRpcResponseParameters(*parameters, response_data);
+        if (SendMessage(sender, response_data) != Status::OK)
+          ReleaseRpcParametersToProcess(sender, *parameters);
+        return;
       } else {
         // Send back non-ok status.
         response_data.param2 = SIZE_MAX;
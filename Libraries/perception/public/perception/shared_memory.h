@@ -55,6 +55,9 @@ class SharedMemory : public serialization::Serializable {
   static constexpr size_t kLazilyAllocated = 1;
   // Joiners can write to the shared memory buffer.
   static constexpr size_t kJoinersCanWrite = 1 << 1;
+  // Joiners get their own private copy of a page the first time they write to
+  // it. The pages the creator assigns are never written to by joiners.
+  static constexpr size_t kCopyOnWrite = 1 << 2;
 
   SharedMemory();
 
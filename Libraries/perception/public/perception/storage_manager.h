@@ -131,6 +131,30 @@ class GetMountedFileSystemsResponse : public serialization::Serializable {
   virtual void Serialize(serialization::Serializer& serializer) override;
 };
 
+// Statistics about the page cache that backs memory mapped files.
+class PageCacheStatistics : public serialization::Serializable {
+ public:
+  // The number of files in the cache.
+  uint64 cached_files = 0;
+
+  // The number of cached files that are currently memory mapped.
+  uint64 mapped_files = 0;
+
+  // The number of pages of file contents held by the cache.
+  uint64 resident_pages = 0;
+
+  // The number of times a file was memory mapped and was already cached.
+  uint64 hits = 0;
+
+  // The number of times a file was memory mapped and had to be opened.
+  uint64 misses = 0;
+
+  // The number of files evicted from the cache to free up memory.
+  uint64 evictions = 0;
+
+  virtual void Serialize(serialization::Serializer& serializer) override;
+};
+
 #define METHOD_LIST(X) X(1, FileSystemMounted, void, FileSystemMountEvent)
 DEFINE_PERCEPTION_SERVICE(FileSystemMountListener,
                           "perception.FileSystemMountListener", METHOD_LIST)
@@ -148,7 +172,8 @@ DEFINE_PERCEPTION_SERVICE(FileSystemMountListener,
   X(8, ReadLink, RequestWithFilePath, RequestWithFilePath)              \
   X(9, GetMountedFileSystems, GetMountedFileSystemsResponse, void)      \
   X(10, CreateDirectory, void, RequestWithFilePath)                     \
-  X(11, DeleteFileOrDirectory, void, RequestWithFilePath)
+  X(11, DeleteFileOrDirectory, void, RequestWithFilePath)               \
+  X(12, GetPageCacheStatistics, PageCacheStatistics, void)
 
 DEFINE_PERCEPTION_SERVICE(StorageManager, "perception.StorageManager",
                           METHOD_LIST)
@@ -14,27 +14,76 @@
 
 #include "perception/debug.h"
 
+#include <algorithm>
+#include <cstring>
+
 #if !defined(PERCEPTION) || defined(TEST)
 #include <iostream>
 #endif
 
 namespace perception {
+namespace {
 
-DebugPrinter::DebugPrinter(int channel) : channel_(channel) {}
-
-DebugPrinter& DebugPrinter::operator<<(char c) {
 #if defined(PERCEPTION) && !defined(TEST)
-  register unsigned long long int syscall_num asm("rdi") = 0;
-  register unsigned long long int param_c asm("rax") = c;
-  register unsigned long long int param_channel asm("rbx") = channel_;
 
-  __asm__("syscall\n"
-          ::"r"(syscall_num), "r"(param_c), "r"(param_channel)
-          : "rcx", "r11");
-#else
-  std::cout << c;
+// The most characters the kernel can print in one system call.
+constexpr size_t kMaxDebugStringLength = 80;
+
+// Output that hasn't been sent to the kernel yet.
+struct PendingOutput {
+  int channel;
+  size_t length;
+  char data[kMaxDebugStringLength];
+};
+
+// Each thread buffers its own output, so lines printed by different threads
+// don't get mixed together.
+thread_local __attribute__((tls_model("initial-exec"))) PendingOutput
+    pending_output;
+
+// Asks the kernel to print up to kMaxDebugStringLength characters.
+void InvokeSyscallToPrintDebugString(const char* data, size_t length,
+                                     int channel) {
+  size_t words[kMaxDebugStringLength / sizeof(size_t)] = {};
+  memcpy(words, data, length);
+
+  volatile register size_t syscall_num asm("rdi") = 80;
+  volatile register size_t words_0 asm("rax") = words[0];
+  volatile register size_t words_1 asm("rbx") = words[1];
+  volatile register size_t words_2 asm("rdx") = words[2];
+  volatile register size_t words_3 asm("rsi") = words[3];
+  volatile register size_t words_4 asm("r8") = words[4];
+  volatile register size_t words_5 asm("r9") = words[5];
+  volatile register size_t words_6 asm("r10") = words[6];
+  volatile register size_t words_7 asm("r12") = words[7];
+  volatile register size_t words_8 asm("r13") = words[8];
+  volatile register size_t words_9 asm("r14") = words[9];
+  volatile register size_t length_and_channel asm("r15") =
+      length | ((size_t)channel << 8);
+
+  __asm__ __volatile__("syscall\n" ::"r"(syscall_num), "r"(words_0),
+                       "r"(words_1), "r"(words_2), "r"(words_3), "r"(words_4),
+                       "r"(words_5), "r"(words_6), "r"(words_7), "r"(words_8),
+                       "r"(words_9), "r"(length_and_channel)
+                       : "rcx", "r11", "memory");
+}
+
+// Sends this thread's pending output to the kernel.
+void FlushPendingOutput() {
+  if (pending_output.length == 0) return;
+  InvokeSyscallToPrintDebugString(pending_output.data, pending_output.length,
+                                  pending_output.channel);
+  pending_output.length = 0;
+}
+
 #endif
 
+}  // namespace
+
+DebugPrinter::DebugPrinter(int channel) : channel_(channel) {}
+
+DebugPrinter& DebugPrinter::operator<<(char c) {
+  Write(&c, 1);
   return *this;
 }
 
@@ -56,12 +105,16 @@ DebugPrinter& DebugPrinter::operator<<(size_t number) {
     number /= 10;
   }
 
+  // Up to 20 digits and 6 commas.
+  char formatted[26];
+  size_t length = 0;
   size_t i;
   for (i = first_char; i < 20; i++) {
-    *this << temp[i];
+    formatted[length++] = temp[i];
     if (i == 1 || i == 4 || i == 7 || i == 10 || i == 13 || i == 16)
-      *this << ',';
+      formatted[length++] = ',';
   }
+  Write(formatted, length);
   return *this;
 }
 
@@ -75,11 +128,7 @@ DebugPrinter& DebugPrinter::operator<<(int64 number) {
 }
 
 DebugPrinter& DebugPrinter::operator<<(const char* str) {
-  const char* c = (const char*)str;
-  while (*c) {
-    *this << *c;
-    c++;
-  }
+  Write(str, strlen(str));
   return *this;
 }
 DebugPrinter& DebugPrinter::operator<<(bool b) {
@@ -87,6 +136,45 @@ DebugPrinter& DebugPrinter::operator<<(bool b) {
   return *this;
 }
 
+void DebugPrinter::Write(const char* data, size_t length) {
+#if defined(PERCEPTION) && !defined(TEST)
+  if (pending_output.channel != channel_) {
+    FlushPendingOutput();
+    pending_output.channel = channel_;
+  }
+
+  for (size_t i = 0; i < length; i++) {
+    pending_output.data[pending_output.length++] = data[i];
+    if (data[i] == '\n' || pending_output.length == kMaxDebugStringLength)
+      FlushPendingOutput();
+  }
+#else
+  std::cout.write(data, length);
+#endif
+}
+
+void DebugPrinter::WritePacket(const char* data, size_t length) {
+#if defined(PERCEPTION) && !defined(TEST)
+  FlushPendingOutput();
+  while (length > 0) {
+    size_t chunk = std::min(length, kMaxDebugStringLength);
+    InvokeSyscallToPrintDebugString(data, chunk, channel_);
+    data += chunk;
+    length -= chunk;
+  }
+#else
+  std::cout.write(data, length);
+#endif
+}
+
+void DebugPrinter::Flush() {
+#if defined(PERCEPTION) && !defined(TEST)
+  FlushPendingOutput();
+#else
+  std::cout.flush();
+#endif
+}
+
 DebugPrinter DebugPrinterSingleton;
 
 extern "C" void DebugPrint(char* str) { DebugPrinterSingleton << str; }
@@ -95,10 +183,35 @@ extern "C" void DebugNumber(long l) { DebugPrinterSingleton << (size_t)l; }
 
 extern "C" void DumpRegistersAndStackTrace() {
 #if defined(PERCEPTION) && !defined(TEST)
+  FlushPendingOutput();
+
   register unsigned long long int syscall_num asm("rdi") = 26;
 
   __asm__("syscall\n" ::"r"(syscall_num) : "rcx", "r11");
 #endif
 }
 
+size_t ReadKernelLog(size_t position, char* buffer, size_t size,
+                     size_t& first_position, size_t& end_position) {
+#if defined(PERCEPTION) && !defined(TEST)
+  volatile register size_t syscall_num asm("rdi") = 81;
+  volatile register size_t buffer_r asm("rax") = (size_t)buffer;
+  volatile register size_t size_r asm("rbx") = size;
+  volatile register size_t position_r asm("rdx") = position;
+
+  __asm__ __volatile__("syscall\n"
+                       : "+r"(buffer_r), "+r"(size_r), "+r"(position_r)
+                       : "r"(syscall_num)
+                       : "rcx", "r11", "memory");
+
+  first_position = size_r;
+  end_position = position_r;
+  return buffer_r;
+#else
+  first_position = position;
+  end_position = position;
+  return 0;
+#endif
+}
+
 }  // namespace perception
@@ -34,6 +34,11 @@ void Size::Serialize(serialization::Serializer& serializer) {
   serializer.Integer("Height", height);
 }
 
+void Rectangle::Serialize(serialization::Serializer& serializer) {
+  serializer.Serializable("Origin", origin);
+  serializer.Serializable("Size", size);
+}
+
 void CopyPartOfTextureParameters::Serialize(serialization::Serializer& serializer) {
   serializer.Serializable("Source", source);
   serializer.Serializable("Destination", destination);
@@ -72,8 +77,103 @@ void Command::Serialize(serialization::Serializer& serializer) {
   }
 }
 
+std::optional<PackedCommand> PackCommand(const Command& command) {
+  PackedCommand packed = {};
+  packed.type = command.type;
+  switch (command.type) {
+    case Command::Type::SET_DESTINATION_TEXTURE:
+    case Command::Type::SET_SOURCE_TEXTURE:
+      // Texture 0 is the screen, so a missing texture can't be packed as 0.
+      if (!command.texture_reference) return std::nullopt;
+      packed.texture_id = command.texture_reference->id;
+      break;
+    case Command::Type::COPY_TEXTURE_TO_POSITION:
+    case Command::Type::COPY_TEXTURE_TO_POSITION_WITH_ALPHA_BLENDING:
+      if (!command.position) return std::nullopt;
+      packed.destination_left = command.position->left;
+      packed.destination_top = command.position->top;
+      break;
+    case Command::Type::COPY_PART_OF_A_TEXTURE:
+    case Command::Type::COPY_PART_OF_A_TEXTURE_WITH_ALPHA_BLENDING: {
+      if (!command.copy_part_of_texture_parameters) return std::nullopt;
+      const auto& parameters = *command.copy_part_of_texture_parameters;
+      packed.source_left = parameters.source.left;
+      packed.source_top = parameters.source.top;
+      packed.destination_left = parameters.destination.left;
+      packed.destination_top = parameters.destination.top;
+      packed.width = parameters.size.width;
+      packed.height = parameters.size.height;
+      break;
+    }
+    case Command::Type::FILL_RECTANGLE: {
+      if (!command.fill_rectangle_parameters) return std::nullopt;
+      const auto& parameters = *command.fill_rectangle_parameters;
+      packed.destination_left = parameters.destination.left;
+      packed.destination_top = parameters.destination.top;
+      packed.width = parameters.size.width;
+      packed.height = parameters.size.height;
+      packed.color = parameters.color;
+      break;
+    }
+    default:
+      break;
+  }
+  return packed;
+}
+
+Command UnpackCommand(const PackedCommand& packed) {
+  Command command;
+  command.type = packed.type;
+  switch (packed.type) {
+    case Command::Type::SET_DESTINATION_TEXTURE:
+    case Command::Type::SET_SOURCE_TEXTURE:
+      command.texture_reference =
+          std::make_shared<TextureReference>(packed.texture_id);
+      break;
+    case Command::Type::COPY_TEXTURE_TO_POSITION:
+    case Command::Type::COPY_TEXTURE_TO_POSITION_WITH_ALPHA_BLENDING:
+      command.position = std::make_shared<Position>(packed.destination_left,
+                                                    packed.destination_top);
+      break;
+    case Command::Type::COPY_PART_OF_A_TEXTURE:
+    case Command::Type::COPY_PART_OF_A_TEXTURE_WITH_ALPHA_BLENDING:
+      command.copy_part_of_texture_parameters =
+          std::make_shared<CopyPartOfTextureParameters>();
+      command.copy_part_of_texture_parameters->source = {packed.source_left,
+                                                         packed.source_top};
+      command.copy_part_of_texture_parameters->destination = {
+          packed.destination_left, packed.destination_top};
+      command.copy_part_of_texture_parameters->size = {packed.width,
+                                                       packed.height};
+      break;
+    case Command::Type::FILL_RECTANGLE:
+      command.fill_rectangle_parameters =
+          std::make_shared<FillRectangleParameters>();
+      command.fill_rectangle_parameters->destination = {
+          packed.destination_left, packed.destination_top};
+      command.fill_rectangle_parameters->size = {packed.width, packed.height};
+      command.fill_rectangle_parameters->color = packed.color;
+      break;
+    default:
+      break;
+  }
+  return command;
+}
+
 void Commands::Serialize(serialization::Serializer& serializer) {
   serializer.ArrayOfSerializables("Commands", commands);
+  serializer.ArrayOfSerializables("Damaged areas", damaged_areas);
+}
+
+void CommandBufferParameters::Serialize(
+    serialization::Serializer& serializer) {
+  serializer.Serializable("Buffer", buffer);
+}
+
+void CommandBufferDoorbell::Serialize(serialization::Serializer& serializer) {
+  serializer.Integer("First command", first_command);
+  serializer.Integer("Command count", command_count);
+  serializer.ArrayOfSerializables("Damaged areas", damaged_areas);
 }
 
 void CreateTextureRequest::Serialize(serialization::Serializer& serializer) {
@@ -23,11 +23,13 @@ void RelativeMousePositionEvent::Serialize(
     serialization::Serializer& serializer) {
   serializer.Float("Delta X", delta_x);
   serializer.Float("Delta Y", delta_y);
+  serializer.ArrayOfSerializables("History", history);
 }
 
 void MousePositionEvent::Serialize(serialization::Serializer& serializer) {
   serializer.Float("X", x);
   serializer.Float("Y", y);
+  serializer.ArrayOfSerializables("History", history);
 }
 
 void MouseButtonEvent::Serialize(serialization::Serializer& serializer) {
@@ -0,0 +1,131 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "perception/devices/network_device.h"
+
+#include <cstring>
+
+#include "perception/serialization/serializer.h"
+#include "perception/shared_memory.h"
+
+namespace perception {
+namespace devices {
+namespace {
+
+static_assert(sizeof(PacketRingHeader) <= kPacketBufferSize);
+
+// The size of a packet ring's shared memory: the header page, then the
+// receive buffers, then the transmit buffers.
+constexpr size_t kPacketRingMemorySize =
+    kPacketBufferSize * (1 + 2 * kPacketRingSize);
+
+}  // namespace
+
+std::unique_ptr<PacketRing> PacketRing::Create() {
+  auto shared_memory = SharedMemory::FromSize(kPacketRingMemorySize,
+                                              SharedMemory::kJoinersCanWrite);
+  if (!shared_memory || !shared_memory->Join()) return nullptr;
+  std::memset(**shared_memory, 0, sizeof(PacketRingHeader));
+  return std::make_unique<PacketRing>(std::move(shared_memory));
+}
+
+std::unique_ptr<PacketRing> PacketRing::FromSharedMemory(
+    std::shared_ptr<SharedMemory> shared_memory) {
+  if (!shared_memory || !shared_memory->Join() ||
+      shared_memory->GetSize() < kPacketRingMemorySize ||
+      !shared_memory->CanWrite())
+    return nullptr;
+  return std::make_unique<PacketRing>(std::move(shared_memory));
+}
+
+PacketRing::PacketRing(std::shared_ptr<SharedMemory> shared_memory)
+    : shared_memory_(std::move(shared_memory)),
+      header_((PacketRingHeader*)**shared_memory_) {}
+
+uint8* PacketRing::RxBuffer(size_t buffer) {
+  return (uint8*)(*shared_memory_)[RxBufferOffset(buffer)];
+}
+
+uint8* PacketRing::TxBuffer(size_t buffer) {
+  return (uint8*)(*shared_memory_)[TxBufferOffset(buffer)];
+}
+
+size_t PacketRing::RxBufferOffset(size_t buffer) {
+  return kPacketBufferSize * (1 + buffer);
+}
+
+size_t PacketRing::TxBufferOffset(size_t buffer) {
+  return kPacketBufferSize * (1 + kPacketRingSize + buffer);
+}
+
+std::optional<std::string_view> PacketRing::PeekReceivedPacket() {
+  uint32 consumed = header_->rx_consumed.load(std::memory_order_relaxed);
+  if (consumed == header_->rx_produced.load(std::memory_order_acquire))
+    return std::nullopt;
+
+  // The driver wrote the entry, so check it stays inside its buffer.
+  PacketRingEntry entry = header_->rx[consumed % kPacketRingSize];
+  if (entry.buffer >= kPacketRingSize || entry.offset > kPacketBufferSize ||
+      entry.length > kPacketBufferSize - entry.offset)
+    return std::string_view();
+
+  return std::string_view((const char*)RxBuffer(entry.buffer) + entry.offset,
+                          entry.length);
+}
+
+void PacketRing::PopReceivedPacket() {
+  header_->rx_consumed.fetch_add(1, std::memory_order_release);
+}
+
+bool PacketRing::QueuePacketToTransmit(std::string_view packet) {
+  if (packet.length() > kMaxPacketRingPacketSize) return false;
+
+  uint32 produced = header_->tx_produced.load(std::memory_order_relaxed);
+  if (produced - header_->tx_consumed.load(std::memory_order_acquire) >=
+      kPacketRingSize)
+    return false;
+
+  // Transmit buffers are used in the same order as the entries.
+  uint16 buffer = produced % kPacketRingSize;
+  std::memcpy(TxBuffer(buffer) + kPacketBufferHeadroom, packet.data(),
+              packet.length());
+  header_->tx[buffer] = {.buffer = buffer,
+                         .offset = (uint16)kPacketBufferHeadroom,
+                         .length = (uint32)packet.length()};
+  header_->tx_produced.store(produced + 1, std::memory_order_release);
+  return true;
+}
+
+bool PacketRing::RingReceivedPacketsDoorbell() {
+  // Look at everything that hasn't been consumed, not only what was just
+  // received. Packets received while the doorbell was rung may have arrived
+  // after the listener stopped looking.
+  if (received_packets_doorbell_rung_ ||
+      header_->rx_produced.load(std::memory_order_relaxed) ==
+          header_->rx_consumed.load(std::memory_order_acquire))
+    return false;
+  received_packets_doorbell_rung_ = true;
+  return true;
+}
+
+void PacketRing::ReceivedPacketsDoorbellAnswered() {
+  received_packets_doorbell_rung_ = false;
+}
+
+void PacketRingParameters::Serialize(serialization::Serializer& serializer) {
+  serializer.Serializable("Ring", ring);
+}
+
+}  // namespace devices
+}  // namespace perception
@@ -0,0 +1,189 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "perception/devices/network_device.h"
+
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "testing.h"
+
+namespace {
+
+using ::perception::devices::kMaxPacketRingPacketSize;
+using ::perception::devices::kPacketBufferHeadroom;
+using ::perception::devices::kPacketRingSize;
+using ::perception::devices::PacketRing;
+using ::perception::devices::PacketRingEntry;
+using ::perception::devices::PacketRingHeader;
+
+// Does what the driver does with a transmitted packet: reads it out of the
+// ring and hands its buffer back.
+std::string TakeTransmittedPacket(PacketRing& ring) {
+  PacketRingHeader& header = ring.Header();
+  uint32 consumed = header.tx_consumed.load();
+  const PacketRingEntry& entry = header.tx[consumed % kPacketRingSize];
+  std::string packet((const char*)ring.TxBuffer(entry.buffer) + entry.offset,
+                     entry.length);
+  header.tx_consumed.store(consumed + 1);
+  return packet;
+}
+
+// Does what the driver does with a received packet: copies it into the next
+// receive buffer and publishes it.
+void ReceivePacket(PacketRing& ring, const std::string& packet) {
+  PacketRingHeader& header = ring.Header();
+  uint32 produced = header.rx_produced.load();
+  uint16 buffer = produced % kPacketRingSize;
+  std::memcpy(ring.RxBuffer(buffer), packet.data(), packet.length());
+  header.rx[buffer] = {
+      .buffer = buffer, .offset = 0, .length = (uint32)packet.length()};
+  header.rx_produced.store(produced + 1);
+}
+
+}  // namespace
+
+TEST(PacketRingTransmitsInOrderAcrossWraparound) {
+  auto ring = PacketRing::Create();
+  ASSERT(true, ring != nullptr);
+
+  // Go around the ring a few times, a few packets at a time, so the indices
+  // wrap around the entries.
+  size_t sent = 0;
+  size_t taken = 0;
+  while (taken < kPacketRingSize * 3) {
+    for (int i = 0; i < 5; i++)
+      ASSERT(true, ring->QueuePacketToTransmit(std::to_string(sent++)));
+    for (int i = 0; i < 5; i++) {
+      EXPECT(std::to_string(taken), TakeTransmittedPacket(*ring));
+      taken++;
+    }
+  }
+
+  // Packets are written after the headroom, so the driver can put its own
+  // header in front of them.
+  ASSERT(true, ring->QueuePacketToTransmit("abc"));
+  uint32 produced = ring->Header().tx_produced.load();
+  EXPECT((uint16)kPacketBufferHeadroom,
+         ring->Header().tx[(produced - 1) % kPacketRingSize].offset);
+}
+
+TEST(PacketRingRejectsPacketsWhenFull) {
+  auto ring = PacketRing::Create();
+  ASSERT(true, ring != nullptr);
+
+  for (size_t i = 0; i < kPacketRingSize; i++)
+    ASSERT(true, ring->QueuePacketToTransmit(std::to_string(i)));
+  EXPECT(false, ring->QueuePacketToTransmit("full"));
+
+  // Once the driver is done with a packet, there's room for one more.
+  EXPECT(std::string("0"), TakeTransmittedPacket(*ring));
+  EXPECT(true, ring->QueuePacketToTransmit("room"));
+  EXPECT(false, ring->QueuePacketToTransmit("full again"));
+}
+
+TEST(PacketRingRejectsOversizedPackets) {
+  auto ring = PacketRing::Create();
+  ASSERT(true, ring != nullptr);
+
+  EXPECT(false, ring->QueuePacketToTransmit(
+                    std::string(kMaxPacketRingPacketSize + 1, 'x')));
+  EXPECT((uint32)0, ring->Header().tx_produced.load());
+
+  std::string largest(kMaxPacketRingPacketSize, 'y');
+  EXPECT(true, ring->QueuePacketToTransmit(largest));
+  EXPECT(largest, TakeTransmittedPacket(*ring));
+}
+
+TEST(PacketRingPeeksAndPopsReceivedPacketsInOrder) {
+  auto ring = PacketRing::Create();
+  ASSERT(true, ring != nullptr);
+
+  EXPECT(false, ring->PeekReceivedPacket().has_value());
+
+  for (size_t i = 0; i < kPacketRingSize * 2 + 3; i++) {
+    ReceivePacket(*ring, "packet " + std::to_string(i));
+
+    // Peeking doesn't consume the packet.
+    auto packet = ring->PeekReceivedPacket();
+    ASSERT(true, packet.has_value());
+    EXPECT("packet " + std::to_string(i), std::string(*packet));
+    packet = ring->PeekReceivedPacket();
+    ASSERT(true, packet.has_value());
+    EXPECT("packet " + std::to_string(i), std::string(*packet));
+
+    ring->PopReceivedPacket();
+    EXPECT(false, ring->PeekReceivedPacket().has_value());
+  }
+
+  // Several packets at once come out in the order they were received.
+  ReceivePacket(*ring, "first");
+  ReceivePacket(*ring, "second");
+  EXPECT(std::string("first"), std::string(*ring->PeekReceivedPacket()));
+  ring->PopReceivedPacket();
+  EXPECT(std::string("second"), std::string(*ring->PeekReceivedPacket()));
+  ring->PopReceivedPacket();
+  EXPECT(false, ring->PeekReceivedPacket().has_value());
+}
+
+TEST(PacketRingIgnoresReceivedEntriesOutsideTheirBuffer) {
+  auto ring = PacketRing::Create();
+  ASSERT(true, ring != nullptr);
+
+  PacketRingHeader& header = ring->Header();
+  header.rx[0] = {.buffer = 0, .offset = 4000, .length = 200};
+  header.rx_produced.store(1);
+  auto packet = ring->PeekReceivedPacket();
+  ASSERT(true, packet.has_value());
+  EXPECT((size_t)0, packet->length());
+}
+
+TEST(PacketRingRingsReceivedPacketsDoorbellOncePerBatch) {
+  auto ring = PacketRing::Create();
+  ASSERT(true, ring != nullptr);
+
+  EXPECT(false, ring->RingReceivedPacketsDoorbell());
+
+  ReceivePacket(*ring, "first");
+  EXPECT(true, ring->RingReceivedPacketsDoorbell());
+  ReceivePacket(*ring, "second");
+  EXPECT(false, ring->RingReceivedPacketsDoorbell());
+
+  // Nothing is left once the listener has consumed everything.
+  ring->PopReceivedPacket();
+  ring->PopReceivedPacket();
+  ring->ReceivedPacketsDoorbellAnswered();
+  EXPECT(false, ring->RingReceivedPacketsDoorbell());
+}
+
+TEST(PacketRingRingsReceivedPacketsDoorbellForPacketsMissedByTheListener) {
+  auto ring = PacketRing::Create();
+  ASSERT(true, ring != nullptr);
+
+  ReceivePacket(*ring, "first");
+  EXPECT(true, ring->RingReceivedPacketsDoorbell());
+
+  // The listener drains the ring and stops looking, then a packet arrives
+  // before it says so. The doorbell is still rung, so it isn't rung again.
+  ring->PopReceivedPacket();
+  ReceivePacket(*ring, "second");
+  EXPECT(false, ring->RingReceivedPacketsDoorbell());
+
+  // Once the listener has answered, the driver looks again without anything
+  // new arriving, and rings for the packet that was missed.
+  ring->ReceivedPacketsDoorbellAnswered();
+  EXPECT(true, ring->RingReceivedPacketsDoorbell());
+  EXPECT(std::string("second"), std::string(*ring->PeekReceivedPacket()));
+}
@@ -23,6 +23,12 @@
 namespace perception {
 namespace {
 
+// The timeout passed to the kernel to wait until woken.
+constexpr size_t kWaitForever = ~(size_t)0;
+
+// Returned by the kernel from FutexRequeue if the value didn't match.
+constexpr size_t kRequeueFailed = ~(size_t)0;
+
 std::atomic_flag futex_lock = ATOMIC_FLAG_INIT;
 
 std::map<volatile int*, std::vector<Fiber*>>& FibersSleepingOnAddrs() {
@@ -74,4 +80,74 @@ void WakeFutex(void* address, int value) {
   for (Fiber* fiber : fibers_to_wake) fiber->WakeUp();
 }
 
+FutexWaitResult FutexWait(volatile int* address, int expected,
+                          std::optional<std::chrono::microseconds> timeout) {
+#if defined(PERCEPTION) && !defined(TEST)
+  size_t timeout_microseconds = kWaitForever;
+  if (timeout) {
+    timeout_microseconds =
+        timeout->count() < 0 ? 0 : static_cast<size_t>(timeout->count());
+    // Don't let an exact timeout be mistaken for waiting forever.
+    if (timeout_microseconds == kWaitForever) timeout_microseconds--;
+  }
+
+  volatile register size_t syscall_num asm("rdi") = 76;
+  volatile register size_t param1 asm("rax") = (size_t)address;
+  volatile register size_t param2 asm("rbx") = (size_t)(uint32)expected;
+  volatile register size_t param3 asm("rdx") = timeout_microseconds;
+  volatile register size_t return_val asm("rax");
+  __asm__ __volatile__("syscall\n"
+                       : "=r"(return_val)
+                       : "r"(syscall_num), "r"(param1), "r"(param2),
+                         "r"(param3)
+                       : "rcx", "r11", "memory");
+  return static_cast<FutexWaitResult>(return_val);
+#else
+  return *address == expected ? FutexWaitResult::TIMED_OUT
+                              : FutexWaitResult::VALUE_CHANGED;
+#endif
+}
+
+size_t FutexWake(volatile int* address, size_t count) {
+#if defined(PERCEPTION) && !defined(TEST)
+  volatile register size_t syscall_num asm("rdi") = 77;
+  volatile register size_t param1 asm("rax") = (size_t)address;
+  volatile register size_t param2 asm("rbx") = count;
+  volatile register size_t return_val asm("rax");
+  __asm__ __volatile__("syscall\n"
+                       : "=r"(return_val)
+                       : "r"(syscall_num), "r"(param1), "r"(param2)
+                       : "rcx", "r11", "memory");
+  return return_val;
+#else
+  return 0;
+#endif
+}
+
+std::optional<size_t> FutexRequeue(volatile int* address, size_t wake_count,
+                                   volatile int* requeue_address,
+                                   size_t requeue_count,
+                                   std::optional<int> expected) {
+#if defined(PERCEPTION) && !defined(TEST)
+  volatile register size_t syscall_num asm("rdi") = 78;
+  volatile register size_t param1 asm("rax") = (size_t)address;
+  volatile register size_t param2 asm("rbx") = wake_count;
+  volatile register size_t param3 asm("rdx") = (size_t)requeue_address;
+  volatile register size_t param4 asm("rsi") = requeue_count;
+  volatile register size_t param5 asm("r8") =
+      (size_t)(uint32)expected.value_or(0);
+  volatile register size_t param6 asm("r9") = expected.has_value() ? 1 : 0;
+  volatile register size_t return_val asm("rax");
+  __asm__ __volatile__("syscall\n"
+                       : "=r"(return_val)
+                       : "r"(syscall_num), "r"(param1), "r"(param2),
+                         "r"(param3), "r"(param4), "r"(param5), "r"(param6)
+                       : "rcx", "r11", "memory");
+  if (return_val == kRequeueFailed) return std::nullopt;
+  return static_cast<size_t>(return_val);
+#else
+  return 0;
+#endif
+}
+
 }  // namespace perception
@@ -28,29 +28,33 @@ struct StringSerializable : public serialization::Serializable {
   }
 };
 
+// Serializes each string as a StringSerializable.
+class StringArray : public serialization::SerializableArray {
+ public:
+  StringArray(std::vector<std::string>& strings)
+      : strings_(strings), entry_(nullptr) {}
+
+  virtual size_t Size() override { return strings_.size(); }
+
+  virtual void Resize(size_t size) override { strings_.resize(size); }
+
+  virtual serialization::Serializable& At(size_t index) override {
+    entry_.value = &strings_[index];
+    return entry_;
+  }
+
+ private:
+  std::vector<std::string>& strings_;
+  StringSerializable entry_;
+};
+
 }  // namespace
 
 void LoadApplicationRequest::Serialize(
     serialization::Serializer& serializer) {
   serializer.String("Name", name);
-  serializer.ArrayOfSerializables(
-      "Arguments", arguments.size(),
-      [this](const std::function<void(class serialization::Serializable&)>&
-                 serialize_entry) {
-        for (auto& argument : arguments) {
-          StringSerializable entry(&argument);
-          serialize_entry(entry);
-        }
-      },
-      [this](int elements,
-             const std::function<void(class serialization::Serializable&)>&
-                 deserialize_entry) {
-        arguments.resize(elements);
-        for (int i = 0; i < elements; ++i) {
-          StringSerializable entry(&arguments[i]);
-          deserialize_entry(entry);
-        }
-      });
+  StringArray array(arguments);
+  serializer.ArrayOfSerializables("Arguments", array);
 }
 
 void LoadApplicationResponse::Serialize(
@@ -54,6 +54,28 @@ void* AllocateMemoryPages(size_t number) {
 #endif
 }
 
+void* AllocateLazilyZeroedMemoryPages(size_t number) {
+#if defined(PERCEPTION) && !defined(TEST)
+  volatile register size_t syscall_num __asm__("rdi") = 12;
+  volatile register size_t param1 __asm__("rax") = number;
+  volatile register size_t param2 __asm__("rdx") = 1;  // Lazily zeroed.
+  volatile register size_t return_val __asm__("rax");
+
+  __asm__ __volatile__("syscall\n"
+                       : "=r"(return_val)
+                       : "r"(syscall_num), "r"(param1), "r"(param2)
+                       : "rcx", "r11");
+  if (return_val == kOutOfMemory || return_val == 0) {
+    DebugPrinterSingleton
+        << "AllocateLazilyZeroedMemoryPages returned out of memory\n";
+    return nullptr;
+  }
+  return (void*)return_val;
+#else
+  return calloc(number, kPageSize);
+#endif
+}
+
 void* AllocateMemoryPagesBelowPhysicalAddressBase(
     size_t number, size_t max_base_address, size_t& first_physical_address) {
 #if defined(PERCEPTION) && !defined(TEST)
@@ -80,6 +102,32 @@ void* AllocateMemoryPagesBelowPhysicalAddressBase(
 #endif
 }
 
+void* AllocateContiguousMemoryPages(size_t number, size_t max_base_address,
+                                    size_t& first_physical_address) {
+#if defined(PERCEPTION) && !defined(TEST)
+  volatile register size_t syscall_num asm("rdi") = 75;
+  volatile register size_t param1 asm("rax") = number;
+  volatile register size_t param2 asm("rbx") = max_base_address;
+  volatile register size_t return_val asm("rax");
+  volatile register size_t first_physical_address_r asm("rbx");
+
+  __asm__ __volatile__("syscall\n"
+                       : "=r"(return_val), "=r"(first_physical_address_r)
+                       : "r"(syscall_num), "r"(param1), "r"(param2)
+                       : "rcx", "r11");
+  if (return_val == kOutOfMemory) {
+    first_physical_address = 0;
+    return nullptr;
+  } else {
+    first_physical_address = first_physical_address_r;
+    return (void*)return_val;
+  }
+#else
+  first_physical_address = 0;
+  return nullptr;
+#endif
+}
+
 void ReleaseMemoryPages(void* ptr, size_t number) {
 #if defined(PERCEPTION) && !defined(TEST)
   volatile register size_t syscall_num asm("rdi") = 13;
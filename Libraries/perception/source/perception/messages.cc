@@ -14,6 +14,7 @@
 
 #include "perception/messages.h"
 
+#include <algorithm>
 #include <atomic>
 #include <map>
 
@@ -44,6 +45,36 @@ Spinlock& GetMessagesLock() {
   return lock;
 }
 
+// Guards the mailbox's send slots.
+Spinlock& GetSendSlotsLock() {
+  static Spinlock lock;
+  return lock;
+}
+
+static_assert(sizeof(MessageMailbox) == 3 * 4096,
+              "MessageMailbox must match the kernel's layout.");
+
+// Asks the kernel to send the first `count` messages in the mailbox's send
+// slots. Returns the number of messages sent.
+size_t SendMessagesInMailbox(size_t count, Status& status) {
+#if defined(PERCEPTION) && !defined(TEST)
+  volatile register size_t syscall asm("rdi") = 73;
+  volatile register size_t count_r asm("rax") = count;
+  volatile register size_t sent_r asm("rax");
+  volatile register size_t status_r asm("rbx");
+
+  __asm__ __volatile__("syscall\n"
+                       : "=r"(sent_r), "=r"(status_r)
+                       : "r"(syscall), "r"(count_r)
+                       : "rcx", "r11");
+  status = (Status)status_r;
+  return sent_r;
+#else
+  status = Status::UNIMPLEMENTED;
+  return 0;
+#endif
+}
+
 // The next unique message identifier.
 MessageId next_unique_message_id = 0;
 
@@ -136,6 +167,61 @@ Status SendMessage(ProcessId pid, const MessageData& message_data) {
   return SendRawMessage(pid, message_data);
 }
 
+Status SendRawMessages(const OutgoingMessage* messages, size_t count,
+                       size_t& sent) {
+  sent = 0;
+  MessageMailbox* mailbox = GetMessageMailbox();
+  if (mailbox == nullptr) {
+    // Fall back to sending one message at a time.
+    for (; sent < count; sent++) {
+      Status status =
+          SendRawMessage(messages[sent].pid, messages[sent].message_data);
+      if (status != Status::OK) return status;
+    }
+    return Status::OK;
+  }
+
+  SpinlockLock lock(GetSendSlotsLock());
+  while (sent < count) {
+    size_t batch_size = std::min(count - sent, kMessageMailboxSendSlots);
+    for (size_t i = 0; i < batch_size; i++) {
+      const OutgoingMessage& message = messages[sent + i];
+      MailboxMessage& slot = mailbox->send_slots[i];
+      slot.message_id = message.message_data.message_id;
+      slot.pid = message.pid;
+      slot.metadata = message.message_data.metadata;
+      slot.param1 = message.message_data.param1;
+      slot.param2 = message.message_data.param2;
+      slot.param3 = message.message_data.param3;
+      slot.param4 = message.message_data.param4;
+      slot.param5 = message.message_data.param5;
+    }
+
+    Status status;
+    sent += SendMessagesInMailbox(batch_size, status);
+    if (status != Status::OK) return status;
+  }
+  return Status::OK;
+}
+
+MessageMailbox* GetMessageMailbox() {
+#if defined(PERCEPTION) && !defined(TEST)
+  static MessageMailbox* mailbox = []() {
+    volatile register size_t syscall asm("rdi") = 16;
+    volatile register size_t address_r asm("rax");
+
+    __asm__ __volatile__("syscall\n"
+                         : "=r"(address_r)
+                         : "r"(syscall)
+                         : "rcx", "r11");
+    return (MessageMailbox*)address_r;
+  }();
+  return mailbox;
+#else
+  return nullptr;
+#endif
+}
+
 // Registers the message handler to call when a specific message is received.
 void RegisterMessageHandler(
     MessageId message_id,
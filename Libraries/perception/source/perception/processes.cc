@@ -14,9 +14,11 @@
 
 #include "perception/processes.h"
 
+#include <cstring>
 #include <functional>
 #include <iostream>
 
+#include "perception/debug.h"
 #include "perception/messages.h"
 #ifndef PERCEPTION
 #include <sched.h>
@@ -29,6 +31,46 @@
 namespace perception {
 namespace {
 
+// A process's entry in the buffer that the kernel writes process snapshots
+// into. Must match ProcessSnapshot in the kernel.
+struct KernelProcessSnapshot {
+  size_t pid;
+  char name[kMaximumProcessNameLength];
+  size_t unique_memory;
+  size_t shared_memory;
+  size_t creation_timestamp;
+  size_t thread_count;
+  size_t registered_services;
+  // A byte per core.
+  uint8 cpu_percentages[8];
+};
+
+// Writes snapshots of processes into a buffer, starting with the first
+// process with a PID of at least `first_pid`. Returns the number of snapshots
+// written, and sets `total_processes` to how many there were to write.
+size_t InvokeSyscallToGetProcessSnapshots(KernelProcessSnapshot* buffer,
+                                          size_t max_snapshots,
+                                          ProcessId first_pid,
+                                          size_t& total_processes) {
+#if defined(PERCEPTION) && !defined(TEST)
+  volatile register size_t syscall_num asm("rdi") = 79;
+  volatile register size_t buffer_r asm("rax") = (size_t)buffer;
+  volatile register size_t max_snapshots_r asm("rbx") = max_snapshots;
+  volatile register size_t first_pid_r asm("rdx") = first_pid;
+
+  __asm__ __volatile__("syscall\n"
+                       : "+r"(buffer_r), "+r"(max_snapshots_r)
+                       : "r"(syscall_num), "r"(first_pid_r)
+                       : "rcx", "r11", "memory");
+
+  total_processes = max_snapshots_r;
+  return buffer_r;
+#else
+  total_processes = 0;
+  return 0;
+#endif
+}
+
 #if defined(PERCEPTION) && !defined(TEST)
 ProcessId InvokeSyscallToGetProcessId() {
   volatile register size_t syscall_num asm("rdi") = 39;
@@ -54,6 +96,9 @@ ProcessId GetProcessId() {
 
 void TerminateProcess() {
 #if defined(PERCEPTION) && !defined(TEST)
+  // Print any partial line this thread has buffered.
+  DebugPrinterSingleton.Flush();
+
   register size_t syscall_num asm("rdi") = 6;
   __asm__("syscall\n" ::"r"(syscall_num) : "rcx", "r11");
 #else
@@ -287,6 +332,34 @@ std::string GetProcessName(ProcessId pid) {
 #endif
 }
 
+void GetProcessSnapshots(std::vector<ProcessSnapshot>& snapshots) {
+  // Leave room for a few new processes, so one call is usually enough.
+  std::vector<KernelProcessSnapshot> buffer(snapshots.size() + 16);
+  size_t written, total_processes;
+  while (true) {
+    written = InvokeSyscallToGetProcessSnapshots(buffer.data(), buffer.size(),
+                                                 0, total_processes);
+    if (total_processes <= buffer.size()) break;
+    buffer.resize(total_processes + 16);
+  }
+
+  snapshots.resize(written);
+  for (size_t i = 0; i < written; i++) {
+    const KernelProcessSnapshot& from = buffer[i];
+    ProcessSnapshot& to = snapshots[i];
+    to.pid = from.pid;
+    to.name.assign(from.name,
+                   strnlen(from.name, kMaximumProcessNameLength));
+    to.unique_memory = from.unique_memory;
+    to.shared_memory = from.shared_memory;
+    to.creation_timestamp = from.creation_timestamp;
+    to.thread_count = from.thread_count;
+    to.registered_services = from.registered_services;
+    memcpy(to.cpu_percentages, from.cpu_percentages,
+           sizeof(to.cpu_percentages));
+  }
+}
+
 // Returns true if the process exists.
 bool DoesProcessExist(ProcessId pid) {
 #if defined(PERCEPTION) && !defined(TEST)
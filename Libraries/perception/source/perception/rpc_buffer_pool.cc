@@ -0,0 +1,268 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "perception/rpc_buffer_pool.h"
+
+#include <algorithm>
+#include <bit>
+#include <climits>
+#include <cstddef>
+#include <new>
+
+#include "perception/futex.h"
+#include "perception/messages.h"
+#include "perception/serialization/memory_read_stream.h"
+#include "perception/serialization/memory_write_stream.h"
+
+namespace perception {
+namespace {
+
+static_assert(sizeof(RpcBufferPoolHeader) <= kPageSize);
+
+// The offset of the shared memory event that's triggered when the receiver
+// frees pages.
+constexpr size_t kPagesFreedEventOffset =
+    offsetof(RpcBufferPoolHeader, sender_waiting);
+
+// Returns a mask of `pages` set bits, starting at `bit`.
+uint64 PageMask(size_t pages, size_t bit) {
+  return (pages >= 64 ? ~(uint64)0 : (((uint64)1 << pages) - 1)) << bit;
+}
+
+// Marks pages as free in the bitmap.
+void SetPagesFree(RpcBufferPoolHeader* header, size_t first_page,
+                  size_t pages) {
+  for (size_t page = first_page; page < first_page + pages;) {
+    size_t bit = page % 64;
+    size_t pages_in_word = std::min(64 - bit, first_page + pages - page);
+    header->free_pages[page / 64].fetch_or(PageMask(pages_in_word, bit),
+                                           std::memory_order_release);
+    page += pages_in_word;
+  }
+}
+
+}  // namespace
+
+std::shared_ptr<RpcBufferPool> RpcBufferPool::Create() {
+  auto header =
+      SharedMemory::FromSize(kPageSize, SharedMemory::kJoinersCanWrite);
+  auto data = SharedMemory::FromSize(kInitialRpcBufferPoolPages * kPageSize,
+                                     SharedMemory::kJoinersCanWrite);
+  if (!header->Join() || !data->Join()) return nullptr;
+
+  auto* pool_header = new (**header) RpcBufferPoolHeader();
+  pool_header->data_shared_memory_id = data->GetId();
+
+  auto pool = std::make_shared<RpcBufferPool>(header, data);
+  size_t data_pages = data->GetSize() / kPageSize;
+  SetPagesFree(pool_header, 0, data_pages);
+  pool->data_pages_ = data_pages;
+
+  pool->pages_freed_message_id_ = GenerateUniqueMessageId();
+  RegisterMessageHandler(
+      pool->pages_freed_message_id_,
+      [weak_pool = std::weak_ptr<RpcBufferPool>(pool)](ProcessId,
+                                                      const MessageData&) {
+        auto pool = weak_pool.lock();
+        if (!pool) return;
+        pool->pages_freed_++;
+        WakeFutex(&pool->pages_freed_, INT_MAX);
+      });
+  return pool;
+}
+
+std::shared_ptr<RpcBufferPool> RpcBufferPool::FromSharedMemory(
+    std::shared_ptr<SharedMemory> header) {
+  if (!header->Join() || header->GetSize() < sizeof(RpcBufferPoolHeader) ||
+      !header->CanWrite())
+    return nullptr;
+
+  auto* pool_header = (RpcBufferPoolHeader*)**header;
+  auto data =
+      std::make_shared<SharedMemory>(pool_header->data_shared_memory_id);
+  if (!data->Join()) return nullptr;
+  return std::make_shared<RpcBufferPool>(std::move(header), std::move(data));
+}
+
+RpcBufferPool::RpcBufferPool(std::shared_ptr<SharedMemory> header,
+                             std::shared_ptr<SharedMemory> data)
+    : header_memory_(std::move(header)),
+      data_(std::move(data)),
+      header_((RpcBufferPoolHeader*)**header_memory_),
+      data_pages_(0),
+      pages_freed_(0),
+      pages_freed_message_id_(0),
+      abandoned_(false) {}
+
+RpcBufferPool::~RpcBufferPool() {
+  if (pages_freed_message_id_ != 0) {
+    header_memory_->UnregisterEvent(kPagesFreedEventOffset);
+    UnregisterMessageHandler(pages_freed_message_id_);
+  }
+}
+
+size_t RpcBufferPool::GetId() const { return header_memory_->GetId(); }
+
+std::optional<RpcParameters> RpcBufferPool::Serialize(
+    const serialization::Serializable& object) {
+  // Measure the parameters without writing them anywhere.
+  size_t length = serialization::SerializeToMemory(object, nullptr, 0);
+  size_t pages = PagesForLength(length);
+
+  auto page = AllocatePages(pages);
+  if (!page) return std::nullopt;
+
+  {
+    // Stop the data from moving while it's written to.
+    std::scoped_lock lock(data_->Mutex());
+    void* data = (void*)((size_t)**data_ + *page * kPageSize);
+    serialization::SerializeToMemory(object, data, pages * kPageSize);
+  }
+
+  return RpcParameters{.pool_id = GetId(),
+                       .data_size = data_pages_ * kPageSize,
+                       .page = *page,
+                       .length = length};
+}
+
+void RpcBufferPool::Deserialize(const RpcParameters& parameters,
+                                serialization::Serializable& object) {
+  // Rejoin the data if the sender has grown it since we last looked.
+  if (parameters.data_size > data_->GetSize())
+    (void)data_->Grow(parameters.data_size);
+
+  if (parameters.page < kMaxRpcBufferPoolPages) {
+    serialization::DeserializeFromSharedMemory(
+        object, *data_, parameters.page * kPageSize, parameters.length);
+  } else {
+    serialization::DeserializeToEmpty(object);
+  }
+  Free(parameters);
+}
+
+void RpcBufferPool::Free(const RpcParameters& parameters) {
+  size_t pages = PagesForLength(parameters.length);
+  if (parameters.page >= kMaxRpcBufferPoolPages ||
+      pages > kMaxRpcBufferPoolPages - parameters.page)
+    return;
+  SetPagesFree(header_, parameters.page, pages);
+
+  if (header_->sender_waiting.exchange(0, std::memory_order_acq_rel) != 0)
+    header_memory_->TriggerEvent(kPagesFreedEventOffset);
+}
+
+void RpcBufferPool::Abandon() {
+  abandoned_ = true;
+  pages_freed_++;
+  WakeFutex(&pages_freed_, INT_MAX);
+}
+
+size_t RpcBufferPool::PagesForLength(size_t length) {
+  size_t pages = (length + kPageSize - 1) / kPageSize;
+  if (pages <= 64) return std::max(pages, (size_t)1);
+  // Longer runs take up whole words of the bitmap.
+  return (pages + 63) / 64 * 64;
+}
+
+std::optional<size_t> RpcBufferPool::TryAllocatePages(size_t pages) {
+  if (pages <= 64) {
+    // Look for a run of free pages within a word.
+    for (size_t word = 0; word < kRpcBufferPoolBitmapWords; word++) {
+      auto& free_pages = header_->free_pages[word];
+      uint64 bits = free_pages.load(std::memory_order_relaxed);
+      while (true) {
+        // Find the bits that start `pages` free pages in a row.
+        uint64 starts = bits;
+        for (size_t i = 1; i < pages && starts != 0; i++) starts &= bits >> i;
+        if (starts == 0) break;
+
+        size_t bit = std::countr_zero(starts);
+        if (free_pages.compare_exchange_weak(bits, bits & ~PageMask(pages, bit),
+                                             std::memory_order_acquire,
+                                             std::memory_order_relaxed))
+          return word * 64 + bit;
+      }
+    }
+    return std::nullopt;
+  }
+
+  // Look for whole words in a row that are free.
+  size_t words = pages / 64;
+  for (size_t first_word = 0; first_word + words <= kRpcBufferPoolBitmapWords;
+       first_word++) {
+    size_t taken = 0;
+    for (; taken < words; taken++) {
+      uint64 expected = ~(uint64)0;
+      if (!header_->free_pages[first_word + taken].compare_exchange_strong(
+              expected, 0, std::memory_order_acquire,
+              std::memory_order_relaxed))
+        break;
+    }
+    if (taken == words) return first_word * 64;
+
+    // Give back the words that were taken before the run was broken.
+    SetPagesFree(header_, first_word * 64, taken * 64);
+    first_word += taken;
+  }
+  return std::nullopt;
+}
+
+std::optional<size_t> RpcBufferPool::AllocatePages(size_t pages) {
+  if (pages > kMaxRpcBufferPoolPages) return std::nullopt;
+
+  while (!abandoned_) {
+    size_t seen_data_pages = data_pages_;
+    if (auto page = TryAllocatePages(pages)) return page;
+    if (Grow(pages, seen_data_pages)) continue;
+
+    // Wait for the receiver to free pages. Check again after asking to be
+    // woken, in case they were freed in between.
+    int pages_freed = pages_freed_;
+    header_->sender_waiting.store(1, std::memory_order_release);
+    header_memory_->RegisterEvent(kPagesFreedEventOffset,
+                                  pages_freed_message_id_);
+    if (auto page = TryAllocatePages(pages)) return page;
+    (void)WaitOnFutex(&pages_freed_, pages_freed);
+  }
+  return std::nullopt;
+}
+
+bool RpcBufferPool::Grow(size_t pages, size_t seen_data_pages) {
+  std::scoped_lock lock(grow_mutex_);
+  size_t data_pages = data_pages_;
+  if (data_pages != seen_data_pages) {
+    // Someone else grew the data while we were waiting for the lock.
+    return true;
+  }
+  if (data_pages >= kMaxRpcBufferPoolPages) return false;
+
+  // Make room for the run after the existing pages, starting it on a new word
+  // if it wouldn't fit in the last one.
+  size_t run_start = data_pages;
+  if (pages > 64 || data_pages % 64 + pages > 64)
+    run_start = (data_pages + 63) / 64 * 64;
+  size_t new_data_pages = std::min(std::max(data_pages * 2, run_start + pages),
+                                   kMaxRpcBufferPoolPages);
+  if (!data_->Grow(new_data_pages * kPageSize)) return false;
+
+  new_data_pages =
+      std::min(data_->GetSize() / kPageSize, kMaxRpcBufferPoolPages);
+  if (new_data_pages <= data_pages) return false;
+  SetPagesFree(header_, data_pages, new_data_pages - data_pages);
+  data_pages_ = new_data_pages;
+  return true;
+}
+
+}  // namespace perception
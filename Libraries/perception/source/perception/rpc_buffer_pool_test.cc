@@ -0,0 +1,130 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "perception/rpc_buffer_pool.h"
+
+#include <string>
+#include <vector>
+
+#include "perception/memory.h"
+#include "perception/serialization/serializer.h"
+#include "testing.h"
+
+namespace perception {
+namespace {
+
+using ::perception::serialization::Serializable;
+using ::perception::serialization::Serializer;
+
+class Blob : public Serializable {
+ public:
+  std::string data;
+
+  virtual void Serialize(Serializer& serializer) override {
+    serializer.String("Data", data);
+  }
+};
+
+// Returns a blob that serializes into exactly `pages` pages.
+Blob BlobOfPages(size_t pages) {
+  Blob blob;
+  blob.data = std::string(pages * kPageSize - 64, 'x');
+  return blob;
+}
+
+TEST(PagesForLength) {
+  EXPECT((size_t)1, RpcBufferPool::PagesForLength(0));
+  EXPECT((size_t)1, RpcBufferPool::PagesForLength(kPageSize));
+  EXPECT((size_t)2, RpcBufferPool::PagesForLength(kPageSize + 1));
+  EXPECT((size_t)64, RpcBufferPool::PagesForLength(64 * kPageSize));
+  EXPECT((size_t)128, RpcBufferPool::PagesForLength(64 * kPageSize + 1));
+}
+
+TEST(AllocatesRunsThatDontOverlap) {
+  auto pool = RpcBufferPool::Create();
+  ASSERT(true, pool != nullptr);
+
+  std::vector<RpcParameters> sent;
+  for (size_t pages : {1, 3, 2, 1, 5}) {
+    auto parameters = pool->Serialize(BlobOfPages(pages));
+    ASSERT(true, parameters.has_value());
+    EXPECT(pages, RpcBufferPool::PagesForLength(parameters->length));
+    for (const auto& other : sent) {
+      size_t other_end =
+          other.page + RpcBufferPool::PagesForLength(other.length);
+      EXPECT(true, parameters->page + pages <= other.page ||
+                       other_end <= parameters->page);
+    }
+    sent.push_back(*parameters);
+  }
+
+  // Freed pages are reused.
+  size_t first_page = sent.front().page;
+  for (const auto& parameters : sent) pool->Free(parameters);
+  auto parameters = pool->Serialize(BlobOfPages(1));
+  ASSERT(true, parameters.has_value());
+  EXPECT(first_page, parameters->page);
+}
+
+TEST(GrowsWhenFull) {
+  auto pool = RpcBufferPool::Create();
+  ASSERT(true, pool != nullptr);
+
+  std::vector<RpcParameters> sent;
+  for (size_t i = 0; i < kInitialRpcBufferPoolPages * 4; i++) {
+    auto parameters = pool->Serialize(BlobOfPages(1));
+    ASSERT(true, parameters.has_value());
+    sent.push_back(*parameters);
+  }
+  EXPECT(true, sent.back().data_size >=
+                   kInitialRpcBufferPoolPages * 4 * kPageSize);
+}
+
+TEST(LongRunsStartOnAWord) {
+  auto pool = RpcBufferPool::Create();
+  ASSERT(true, pool != nullptr);
+
+  auto small = pool->Serialize(BlobOfPages(1));
+  ASSERT(true, small.has_value());
+  auto large = pool->Serialize(BlobOfPages(100));
+  ASSERT(true, large.has_value());
+  EXPECT((size_t)0, large->page % 64);
+  EXPECT(true, large->data_size >= (large->page + 128) * kPageSize);
+}
+
+TEST(DeserializesWhatWasSerialized) {
+  auto pool = RpcBufferPool::Create();
+  ASSERT(true, pool != nullptr);
+
+  Blob sent = BlobOfPages(3);
+  sent.data[0] = 'a';
+  auto parameters = pool->Serialize(sent);
+  ASSERT(true, parameters.has_value());
+
+  // The receiver joins the pool by its ID.
+  auto receiver = RpcBufferPool::FromSharedMemory(
+      std::make_shared<SharedMemory>(parameters->pool_id));
+  ASSERT(true, receiver != nullptr);
+  Blob received;
+  receiver->Deserialize(*parameters, received);
+  EXPECT(sent.data, received.data);
+
+  // Deserializing freed the pages.
+  auto next = pool->Serialize(BlobOfPages(3));
+  ASSERT(true, next.has_value());
+  EXPECT(parameters->page, next->page);
+}
+
+}  // namespace
+}  // namespace perception
@@ -14,53 +14,53 @@
 
 #include "perception/rpc_memory.h"
 
-#include <atomic>
-#include <iostream>
 #include <map>
 #include <mutex>
 #include <set>
-#include <vector>
 
-#include "perception/messages.h"
 #include "perception/processes.h"
+#include "perception/rpc_buffer_pool.h"
+#include "perception/serialization/memory_read_stream.h"
 #include "perception/shared_memory.h"
-#include "perception/threads.h"
 
 namespace perception {
 namespace {
 
-constexpr int kMaxConcurrentBuffersPerProcess = 8;
+std::map<ProcessId, std::shared_ptr<RpcBufferPool>>
+    pools_for_sending_to_processes;
 
-std::map<ProcessId, std::vector<std::shared_ptr<SharedMemory>>>
-    shared_memory_for_sending_to_processes;
+std::mutex mutex_for_pools_for_sending_to_processes;
 
-std::mutex mutex_for_shared_memory_for_sending_to_processes;
+std::map<ProcessId, std::map<size_t, std::shared_ptr<RpcBufferPool>>>
+    pools_for_receiving_from_processes;
 
-std::map<ProcessId, std::map<size_t, std::shared_ptr<SharedMemory>>>
-    shared_memory_for_receiving_from_processes;
-
-std::mutex mutex_for_shared_memory_for_receiving_from_processes;
+std::mutex mutex_for_pools_for_receiving_from_processes;
 
 std::set<ProcessId> processes_monitoring_for_death;
 
 std::mutex mutex_for_processes_monitoring_for_death;
 
-constexpr int kYieldAttemptsBeforeGettingNewMemory = 1000;
-
 void OnProcessDied(ProcessId process_id) {
   {
     std::scoped_lock lock(mutex_for_processes_monitoring_for_death);
     processes_monitoring_for_death.erase(process_id);
   }
 
+  std::shared_ptr<RpcBufferPool> pool_for_sending;
   {
-    std::scoped_lock lock(mutex_for_shared_memory_for_sending_to_processes);
-    shared_memory_for_sending_to_processes.erase(process_id);
+    std::scoped_lock lock(mutex_for_pools_for_sending_to_processes);
+    auto itr = pools_for_sending_to_processes.find(process_id);
+    if (itr != pools_for_sending_to_processes.end()) {
+      pool_for_sending = std::move(itr->second);
+      pools_for_sending_to_processes.erase(itr);
+    }
   }
+  // Nobody is going to free pages any more, so stop waiting for them.
+  if (pool_for_sending) pool_for_sending->Abandon();
 
   {
-    std::scoped_lock lock(mutex_for_shared_memory_for_receiving_from_processes);
-    shared_memory_for_receiving_from_processes.erase(process_id);
+    std::scoped_lock lock(mutex_for_pools_for_receiving_from_processes);
+    pools_for_receiving_from_processes.erase(process_id);
   }
 }
 
@@ -74,119 +74,73 @@ void MonitorForWhenProcessDies(ProcessId process_id) {
                                [process_id]() { OnProcessDied(process_id); });
 }
 
-bool IsProcessStillAlive(ProcessId process_id) {
-  std::scoped_lock lock(mutex_for_processes_monitoring_for_death);
-  return processes_monitoring_for_death.contains(process_id);
-}
-
-// Creates a memory buffer for sending data to a process. The caller should lock
-// `mutex_for_shared_memory_for_sending_to_processes` before calling.
-std::shared_ptr<SharedMemory> CreateNewMemoryBufferToSendToProcess(
+// Returns the pool for sending RPC parameters to a process, creating it the
+// first time.
+std::shared_ptr<RpcBufferPool> GetPoolForSendingToProcess(
     ProcessId process_id) {
-  // Create new shared memory block.
-  std::shared_ptr<SharedMemory> shared_memory =
-      SharedMemory::FromSize(1, SharedMemory::kJoinersCanWrite);
-  // Set first bit to be in use.
-  *(unsigned char*)**shared_memory = 1;
-  return shared_memory;
+  std::scoped_lock lock(mutex_for_pools_for_sending_to_processes);
+  auto itr = pools_for_sending_to_processes.find(process_id);
+  if (itr != pools_for_sending_to_processes.end()) return itr->second;
+
+  MonitorForWhenProcessDies(process_id);
+  auto pool = RpcBufferPool::Create();
+  if (pool) pools_for_sending_to_processes[process_id] = pool;
+  return pool;
 }
 
-}  // namespace
-
-std::shared_ptr<SharedMemory> GetMemoryBufferForSendingToProcess(
-    ProcessId process_id) {
-  std::scoped_lock lock(mutex_for_shared_memory_for_sending_to_processes);
-
-  auto itr = shared_memory_for_sending_to_processes.find(process_id);
-  if (itr == shared_memory_for_sending_to_processes.end()) {
+// Returns the pool a process sends RPC parameters through, joining it the
+// first time.
+std::shared_ptr<RpcBufferPool> GetPoolForReceivingFromProcess(
+    ProcessId process_id, size_t pool_id) {
+  std::scoped_lock lock(mutex_for_pools_for_receiving_from_processes);
+  auto itr = pools_for_receiving_from_processes.find(process_id);
+  if (itr == pools_for_receiving_from_processes.end()) {
     MonitorForWhenProcessDies(process_id);
-    auto& vec = shared_memory_for_sending_to_processes[process_id];
-    vec.resize(kMaxConcurrentBuffersPerProcess, nullptr);
-    itr = shared_memory_for_sending_to_processes.find(process_id);
-  }
-
-  auto& vec = itr->second;
-  std::shared_ptr<SharedMemory> selected_buffer = nullptr;
-
-  for (size_t i = 0; i < kMaxConcurrentBuffersPerProcess; ++i) {
-    auto& buf = vec[i];
-    if (buf == nullptr) {
-      selected_buffer = CreateNewMemoryBufferToSendToProcess(process_id);
-      buf = selected_buffer;
-      break;
-    } else {
-      std::scoped_lock lock(buf->Mutex());
-      void* shared_status_ptr = **buf;
-      std::atomic<unsigned char>* atomic_status =
-          reinterpret_cast<std::atomic<unsigned char>*>(shared_status_ptr);
-      if (atomic_status->load() == 0) {
-        atomic_status->store(1);
-        selected_buffer = buf;
-        break;
-      }
-    }
+    itr = pools_for_receiving_from_processes
+              .emplace(process_id,
+                       std::map<size_t, std::shared_ptr<RpcBufferPool>>())
+              .first;
   }
 
-  if (selected_buffer == nullptr) {
-    std::cout << "Error: Reached maximum concurrent RPC buffers ("
-              << kMaxConcurrentBuffersPerProcess << ") for "
-              << GetProcessName(GetProcessId()) << " to "
-              << GetProcessName(process_id) << std::endl;
-    return nullptr;
-  }
+  auto itr2 = itr->second.find(pool_id);
+  if (itr2 != itr->second.end()) return itr2->second;
 
-  return selected_buffer;
+  auto pool =
+      RpcBufferPool::FromSharedMemory(std::make_shared<SharedMemory>(pool_id));
+  if (pool) itr->second[pool_id] = pool;
+  return pool;
 }
 
-std::shared_ptr<SharedMemory>
-GetMemoryBufferForSendingToProcessRegardlessOfIfInUse(ProcessId process_id,
-                                                      size_t shared_memory_id) {
-  std::scoped_lock lock(mutex_for_shared_memory_for_sending_to_processes);
-  auto itr = shared_memory_for_sending_to_processes.find(process_id);
-  if (itr == shared_memory_for_sending_to_processes.end()) return {};
+}  // namespace
 
-  for (auto& buf : itr->second) {
-    if (buf && buf->GetId() == shared_memory_id) {
-      return buf;
-    }
-  }
-  return {};
+std::optional<RpcParameters> SerializeRpcParametersToProcess(
+    ProcessId process_id, const serialization::Serializable& object) {
+  auto pool = GetPoolForSendingToProcess(process_id);
+  if (!pool) return std::nullopt;
+  return pool->Serialize(object);
 }
 
-std::shared_ptr<SharedMemory> GetMemoryBufferForReceivingFromProcess(
-    ProcessId process_id, size_t shared_memory_id) {
-  std::scoped_lock lock(mutex_for_shared_memory_for_receiving_from_processes);
-  auto itr = shared_memory_for_receiving_from_processes.find(process_id);
-  if (itr == shared_memory_for_receiving_from_processes.end()) {
-    MonitorForWhenProcessDies(process_id);
-
-    itr = shared_memory_for_receiving_from_processes
-              .emplace(process_id,
-                       std::map<size_t, std::shared_ptr<SharedMemory>>())
-              .first;
-  }
+void ReleaseRpcParametersToProcess(ProcessId process_id,
+                                   const RpcParameters& parameters) {
+  auto pool = GetPoolForSendingToProcess(process_id);
+  if (pool && pool->GetId() == parameters.pool_id) pool->Free(parameters);
+}
 
-  auto itr2 = itr->second.find(shared_memory_id);
-  if (itr2 == itr->second.end()) {
-    auto shared_memory = std::make_shared<SharedMemory>(shared_memory_id);
-    itr->second[shared_memory_id] = shared_memory;
-    return shared_memory;
+void DeserializeRpcParametersFromProcess(ProcessId process_id,
+                                         const RpcParameters& parameters,
+                                         serialization::Serializable& object) {
+  auto pool = GetPoolForReceivingFromProcess(process_id, parameters.pool_id);
+  if (pool) {
+    pool->Deserialize(parameters, object);
   } else {
-    return itr2->second;
+    serialization::DeserializeToEmpty(object);
   }
 }
 
-void SetMemoryBufferAsReadyForSendingNextMessageToProcess(
-    SharedMemory& shared_memory) {
-  (void)shared_memory.Join();
-  if (shared_memory.CanWrite()) {
-    std::scoped_lock lock(shared_memory.Mutex());
-    *(unsigned char*)*shared_memory = 0;
-  } else {
-    std::cout << "Can't write to the shared memory sent to this process. The "
-                 "shared memory can't be reused for future messages."
-              << std::endl;
-  }
+void ReleaseRpcParametersFromProcess(ProcessId process_id,
+                                     const RpcParameters& parameters) {
+  auto pool = GetPoolForReceivingFromProcess(process_id, parameters.pool_id);
+  if (pool) pool->Free(parameters);
 }
 
 }  // namespace perception
\ No newline at end of file
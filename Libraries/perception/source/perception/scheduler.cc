@@ -163,6 +163,74 @@ bool PollForMessage(ProcessId& senders_pid, MessageData& message_data) {
 #endif
 }
 
+// Reads the next message from the mailbox without entering the kernel. Returns
+// false if the mailbox is empty.
+bool ReadMessageFromMailbox(MessageMailbox& mailbox, ProcessId& senders_pid,
+                            MessageData& message_data) {
+  size_t read_index =
+      mailbox.receive_read_index.load(std::memory_order_acquire);
+  while (true) {
+    if (read_index ==
+        mailbox.receive_write_index.load(std::memory_order_acquire))
+      return false;
+
+    const MailboxMessage& message =
+        mailbox.receive_ring[read_index & (kMessageMailboxReceiveSlots - 1)];
+    senders_pid = message.pid;
+    message_data.message_id = message.message_id;
+    message_data.metadata = message.metadata;
+    message_data.param1 = message.param1;
+    message_data.param2 = message.param2;
+    message_data.param3 = message.param3;
+    message_data.param4 = message.param4;
+    message_data.param5 = message.param5;
+
+    // Claim the message and let the kernel reuse the slot. Another thread, or
+    // the kernel, might have read it first, in which case try the next one.
+    if (mailbox.receive_read_index.compare_exchange_weak(
+            read_index, read_index + 1, std::memory_order_acq_rel,
+            std::memory_order_acquire))
+      return true;
+  }
+}
+
+// Asks the kernel to move any messages queued for us into the mailbox. If
+// `sleep` is true and there are none, sleeps until there are. Returns the
+// number of unread messages in the mailbox.
+size_t ReceiveMessagesIntoMailbox(bool sleep) {
+#if defined(PERCEPTION) && !defined(TEST)
+  volatile register size_t syscall asm("rdi") = 74;
+  volatile register size_t sleep_r asm("rax") = sleep ? 1 : 0;
+  volatile register size_t unread_r asm("rax");
+
+  __asm__ __volatile__("syscall\n"
+                       : "=r"(unread_r)
+                       : "r"(syscall), "r"(sleep_r)
+                       : "rcx", "r11");
+  return unread_r;
+#else
+  return 0;
+#endif
+}
+
+// Gets the next message, draining the mailbox before entering the kernel. If
+// `sleep` is true, sleeps until there is a message. Returns true if a message
+// was received.
+bool GetNextMessage(bool sleep, ProcessId& senders_pid,
+                    MessageData& message_data) {
+  MessageMailbox* mailbox = GetMessageMailbox();
+  if (mailbox == nullptr) {
+    return sleep ? SleepThreadUntilMessage(senders_pid, message_data)
+                 : PollForMessage(senders_pid, message_data);
+  }
+
+  while (!ReadMessageFromMailbox(*mailbox, senders_pid, message_data)) {
+    // The mailbox is empty. Move messages queued in the kernel into it.
+    if (ReceiveMessagesIntoMailbox(sleep) == 0) return false;
+  }
+  return true;
+}
+
 }  // namespace
 
 // Defers running a function.
@@ -335,7 +403,7 @@ Fiber* Scheduler::GetNextFiberToRun() {
 
       // Nothing is waiting for to finish, so sleep for the next message.
       while (true) {
-        if (!SleepThreadUntilMessage(senders_pid, message_data)) {
+        if (!GetNextMessage(/*sleep=*/true, senders_pid, message_data)) {
           // The thread randomly woke without a message. This shouldn't
           // happen.
           continue;
@@ -357,7 +425,7 @@ Fiber* Scheduler::GetNextFiberToRun() {
       }
     } else {
       // Keep looping while there are messages.
-      while (PollForMessage(senders_pid, message_data)) {
+      while (GetNextMessage(/*sleep=*/false, senders_pid, message_data)) {
         // Get the fiber to handle this message.
         Fiber* fiber = GetFiberToHandleMessage(senders_pid, message_data);
 
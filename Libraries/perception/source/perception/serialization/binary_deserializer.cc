@@ -19,7 +19,6 @@
 
 #include <string>
 
-#include "perception/serialization/memory_read_stream.h"
 #include "perception/serialization/read_stream.h"
 #include "perception/serialization/serializable.h"
 #include "perception/serialization/serializer.h"
@@ -28,46 +27,14 @@ namespace perception {
 namespace serialization {
 
 namespace {
-uint64 ReadVariableLengthIntegerFromStream(ReadStream& read_stream) {
-  uint64_t result = 0;
-  unsigned int shift = 0;
-
-  while (true) {
-    if (shift >= 70) {
-      // An encoded 64-bit integer can be at most 10 bytes long (since 10 * 7 =
-      // 70 bits). If the result is shift more than 63 bits, the data is
-      // malformed or represents a number larger than uint64_t.
-      return result;
-    }
-
-    uint8_t byte;
-    read_stream.CopyDataOutOfStream(&byte, 1);
-
-    // 1. Take the lower 7 bits of the byte.
-    // 2. Cast to uint64_t to prevent overflow during the left shift.
-    // 3. Shift the 7 bits into their correct position in the result.
-    // 4. Use bitwise OR to combine with previously processed bits.
-    result |= static_cast<uint64_t>(byte & 0x7F) << shift;
-
-    // Check the continuation bit (MSB). If it's 0, this is the last byte.
-    if ((byte & 0x80) == 0) {
-      return result;
-    }
-
-    // Increment shift for the next 7-bit chunk.
-    shift += 7;
-  }
-}
-
+// Adapts a BinaryReader to the Serializer interface, for classes that aren't
+// StaticSerializables.
 class BinaryDeserializer : public Serializer {
  public:
-  BinaryDeserializer(ReadStream* read_stream)
-      : read_stream_(read_stream),
-        current_field_index_(0),
-        next_field_index_in_stream_(ReadVariableLengthInteger()) {}
+  BinaryDeserializer(BinaryReader& reader) : reader_(reader) {}
 
   virtual bool HasThisField(std::string_view name = "") override {
-    return next_field_index_in_stream_ == current_field_index_;
+    return reader_.HasThisField(name);
   }
 
   virtual bool IsDeserializing() override {
@@ -75,209 +42,124 @@ class BinaryDeserializer : public Serializer {
     return true;
   }
 
-  virtual void Integer() override {
-    if (HasThisField()) {
-      (void)ReadVariableLengthInteger();
-      next_field_index_in_stream_ = ReadVariableLengthInteger();
-    }
-    current_field_index_++;
-  }
+  virtual void Integer() override { reader_.Integer(); }
 
   virtual void UnsignedInteger(std::string_view name, uint64& value) override {
-    if (HasThisField()) {
-      value = ReadVariableLengthInteger();
-      next_field_index_in_stream_ = ReadVariableLengthInteger();
-    } else {
-      value = 0;
-    }
-    current_field_index_++;
+    reader_.UnsignedInteger(name, value);
   }
 
   virtual void SignedInteger(std::string_view name, int64& value) override {
-    if (HasThisField()) {
-      value = ReadVariableLengthSignedInteger();
-      next_field_index_in_stream_ = ReadVariableLengthInteger();
-    } else {
-      value = 0;
-    }
-    current_field_index_++;
+    reader_.SignedInteger(name, value);
   }
 
-  virtual void Float() override {
-    if (HasThisField()) {
-      read_stream_->SkipForward(sizeof(float));
-      next_field_index_in_stream_ = ReadVariableLengthInteger();
-    }
-    current_field_index_++;
-  }
+  virtual void Float() override { reader_.Float(); }
 
   virtual void Float(std::string_view name, float& value) override {
-    if (HasThisField()) {
-      read_stream_->CopyDataOutOfStream(&value, sizeof(float));
-      next_field_index_in_stream_ = ReadVariableLengthInteger();
-    } else {
-      value = 0;
-    }
-    current_field_index_++;
+    reader_.Float(name, value);
   }
 
-  virtual void Double() override {
-    if (HasThisField()) {
-      read_stream_->SkipForward(sizeof(double));
-      next_field_index_in_stream_ = ReadVariableLengthInteger();
-    }
-    current_field_index_++;
-  }
+  virtual void Double() override { reader_.Double(); }
 
   virtual void Double(std::string_view name, double& value) override {
-    if (HasThisField()) {
-      read_stream_->CopyDataOutOfStream(&value, sizeof(double));
-      next_field_index_in_stream_ = ReadVariableLengthInteger();
-    } else {
-      value = 0;
-    }
-    current_field_index_++;
+    reader_.Double(name, value);
   }
 
-  virtual void String() override {
-    if (HasThisField()) {
-      uint64 string_length = ReadVariableLengthInteger();
-      read_stream_->SkipForward(string_length);
-      next_field_index_in_stream_ = ReadVariableLengthInteger();
-    }
-    current_field_index_++;
-  }
+  virtual void String() override { reader_.String(); }
 
   virtual void String(std::string_view name, std::string& str) override {
-    if (HasThisField()) {
-      uint64 string_length = ReadVariableLengthInteger();
-      str.resize(string_length);
-      read_stream_->CopyDataOutOfStream(&str[0], string_length);
-      next_field_index_in_stream_ = ReadVariableLengthInteger();
-    } else {
-      str.clear();
-    }
-
-    current_field_index_++;
+    reader_.String(name, str);
   }
 
-  virtual void Serializable() override {
-    if (HasThisField()) {
-      uint32 size;
-      read_stream_->CopyDataOutOfStream(&size, 4);
-      read_stream_->SkipForward(size);
-      next_field_index_in_stream_ = ReadVariableLengthInteger();
-    }
-    current_field_index_++;
-  }
+  virtual void Serializable() override { reader_.Serializable(); }
 
   virtual void Serializable(std::string_view name,
                             class Serializable& obj) override {
-    if (HasThisField()) {
-      uint32 size;
-      read_stream_->CopyDataOutOfStream(&size, 4);
-      read_stream_->ReadSubStream(size, [&obj](ReadStream& sub_stream) {
-        BinaryDeserializer sub_serializer(&sub_stream);
-        obj.Serialize(sub_serializer);
-      });
-      next_field_index_in_stream_ = ReadVariableLengthInteger();
-    } else {
-      read_stream_->ReadSubStream(0, [&obj](ReadStream& sub_stream) {
-        BinaryDeserializer sub_serializer(&sub_stream);
-        obj.Serialize(sub_serializer);
-      });
-    }
-    current_field_index_++;
+    reader_.Serializable(name, obj);
   }
 
   virtual void ArrayOfSerializables() override {
-    // The first thing encoded is the byte size of the entire array, an array
-    // can be skipped over in the same way as a serializable.
-    Serializable();
+    reader_.ArrayOfSerializables();
   }
 
-  virtual void ArrayOfSerializables(
-      std::string_view name, int current_size,
-      const std::function<
-          void(const std::function<void(class Serializable& serializable)>&
-                   serialize_entry)>& serialization_function,
-      const std::function<
-          void(int elements,
-               const std::function<void(class Serializable& serializable)>&
-                   deserialize_entry)>& deserialization_function) override {
-    if (HasThisField()) {
-      uint32 size;
-      read_stream_->CopyDataOutOfStream(&size, 4);
-      // Read through the array in a self-contained sub stream incase something
-      // is malformed and while reading the array, either not all bytes are read
-      // or it attemps to read past the end of the array.
-      read_stream_->ReadSubStream(size, [&deserialization_function](
-                                            ReadStream& sub_stream) {
-        uint64 elements = ReadVariableLengthIntegerFromStream(sub_stream);
-
-        deserialization_function(
-            elements, [&sub_stream](class Serializable& serializable) {
-              uint32 element_size;
-              sub_stream.CopyDataOutOfStream(&element_size, 4);
-              sub_stream.ReadSubStream(
-                  element_size, [&serializable](ReadStream& sub_sub_stream) {
-                    BinaryDeserializer sub_serializer(&sub_sub_stream);
-                    serializable.Serialize(sub_serializer);
-                  });
-            });
-      });
-      next_field_index_in_stream_ = ReadVariableLengthInteger();
-    } else {
-      deserialization_function(0, [](class Serializable& serializable) {});
-    }
-    current_field_index_++;
+  virtual void ArrayOfSerializables(std::string_view name,
+                                    SerializableArray& arr) override {
+    reader_.ArrayOfSerializables(name, arr);
   }
 
-  virtual void ArrayOfStrings() override { Serializable(); }
+  virtual void ArrayOfStrings() override { reader_.ArrayOfStrings(); }
 
   virtual void ArrayOfStrings(std::string_view name,
                               std::vector<std::string>& arr) override {
-    if (HasThisField()) {
-      uint32 size;
-      read_stream_->CopyDataOutOfStream(&size, 4);
-      read_stream_->ReadSubStream(size, [&arr](ReadStream& sub_stream) {
-        uint64 elements = ReadVariableLengthIntegerFromStream(sub_stream);
-        arr.resize(elements);
-        for (uint64 i = 0; i < elements; i++) {
-          uint64 string_length =
-              ReadVariableLengthIntegerFromStream(sub_stream);
-          arr[i].resize(string_length);
-          sub_stream.CopyDataOutOfStream(&arr[i][0], string_length);
-        }
-      });
-      next_field_index_in_stream_ = ReadVariableLengthInteger();
-    } else {
-      arr.clear();
-    }
-    current_field_index_++;
+    reader_.ArrayOfStrings(name, arr);
   }
 
  private:
-  uint64 ReadVariableLengthInteger() {
-    return ReadVariableLengthIntegerFromStream(*read_stream_);
-  }
+  BinaryReader& reader_;
+};
+
+}  // namespace
 
-  int64 ReadVariableLengthSignedInteger() {
-    uint64_t zigzag_encoded = ReadVariableLengthInteger();
-    return (zigzag_encoded >> 1) ^ -static_cast<int64_t>(zigzag_encoded & 1);
+void BinaryInput::ReadPastEnd(void* data, size_t size) {
+  if (offset_ >= size_) {
+    // Beyond the end of the input.
+    std::memset(data, 0, size);
+    return;
   }
 
-  ReadStream* read_stream_;
-  int current_field_index_;
-  int next_field_index_in_stream_;
-};
+  // Partial read.
+  size_t remaining_size = size_ - offset_;
+  std::memcpy(data, data_ + offset_, remaining_size);
+  offset_ = size_;
+  std::memset(static_cast<char*>(data) + remaining_size, 0,
+              size - remaining_size);
+}
 
-}  // namespace
+void BinaryReader::ArrayOfSerializables(std::string_view name,
+                                        SerializableArray& arr) {
+  if (HasThisField()) {
+    BinaryInput array_input = input_.SubInput(ReadSize());
+    arr.Resize(ReadVariableLengthIntegerFromInput(array_input));
+    for (size_t i = 0; i < arr.Size(); i++)
+      ReadObjectFromInput(array_input, arr.At(i));
+    ReadNextFieldIndex();
+  } else {
+    arr.Resize(0);
+  }
+  current_field_index_++;
+}
+
+void BinaryReader::ArrayOfStrings(std::string_view name,
+                                  std::vector<std::string>& arr) {
+  if (HasThisField()) {
+    BinaryInput array_input = input_.SubInput(ReadSize());
+    arr.resize(ReadVariableLengthIntegerFromInput(array_input));
+    for (auto& str : arr) {
+      uint64 string_length = ReadVariableLengthIntegerFromInput(array_input);
+      str.resize(string_length);
+      array_input.Read(&str[0], string_length);
+    }
+    ReadNextFieldIndex();
+  } else {
+    arr.clear();
+  }
+  current_field_index_++;
+}
+
+void Serializable::DeserializeFromBinary(BinaryReader& reader) {
+  BinaryDeserializer serializer(reader);
+  Serialize(serializer);
+}
 
 void DeserializeFromStream(Serializable& object, ReadStream& stream) {
-  BinaryDeserializer serializer(&stream);
-  object.Serialize(serializer);
+  // Copy the stream into contiguous memory for the reader.
+  std::vector<std::byte> data;
+  while (stream.ContainsAtLeast(1)) {
+    data.emplace_back();
+    stream.CopyDataOutOfStream(&data.back(), 1);
+  }
+  BinaryInput input(data.data(), data.size());
+  BinaryReader::ReadFields(input, object);
 }
 
 }  // namespace serialization
-}  // namespace perception
\ No newline at end of file
+}  // namespace perception
@@ -27,10 +27,11 @@ namespace perception {
 namespace serialization {
 
 namespace {
+// Adapts a BinaryWriter to the Serializer interface, for classes that aren't
+// StaticSerializables.
 class BinarySerializer : public Serializer {
  public:
-  BinarySerializer(WriteStream* write_stream)
-      : write_stream_(write_stream), current_field_index_(0) {}
+  BinarySerializer(BinaryWriter& writer) : writer_(writer) {}
 
   virtual bool HasThisField(std::string_view name = "") override {
     // Not needed for serializing.
@@ -42,173 +43,128 @@ class BinarySerializer : public Serializer {
     return false;
   }
 
-  virtual void Integer() override { current_field_index_++; }
+  virtual void Integer() override { writer_.Integer(); }
 
   virtual void UnsignedInteger(std::string_view name, uint64& value) override {
-    if (value > 0) {
-      WriteVariableLengthInteger(current_field_index_);
-      WriteVariableLengthInteger(value);
-    }
-    current_field_index_++;
+    writer_.UnsignedInteger(name, value);
   }
 
   virtual void SignedInteger(std::string_view name, int64& value) override {
-    if (value != 0) {
-      WriteVariableLengthInteger(current_field_index_);
-      WriteVariableLengthSignedInteger(value);
-    }
-    current_field_index_++;
+    writer_.SignedInteger(name, value);
   }
 
-  virtual void Float() override { current_field_index_++; }
+  virtual void Float() override { writer_.Float(); }
 
   virtual void Float(std::string_view name, float& value) override {
-    if (value != 0) {
-      WriteVariableLengthInteger(current_field_index_);
-      write_stream_->CopyDataIntoStream(&value, sizeof(float));
-    }
-    current_field_index_++;
+    writer_.Float(name, value);
   }
 
-  virtual void Double() override { current_field_index_++; }
+  virtual void Double() override { writer_.Double(); }
 
   virtual void Double(std::string_view name, double& value) override {
-    if (value != 0) {
-      WriteVariableLengthInteger(current_field_index_);
-      write_stream_->CopyDataIntoStream(&value, sizeof(double));
-    }
-    current_field_index_++;
+    writer_.Double(name, value);
   }
 
-  virtual void String() override { current_field_index_++; }
+  virtual void String() override { writer_.String(); }
 
   virtual void String(std::string_view name, std::string& str) override {
-    if (!str.empty()) {
-      WriteVariableLengthInteger(current_field_index_);
-      WriteVariableLengthInteger(str.length());
-      write_stream_->CopyDataIntoStream(str.data(), str.length());
-    }
-    current_field_index_++;
+    writer_.String(name, str);
   }
 
-  virtual void Serializable() override { current_field_index_++; }
+  virtual void Serializable() override { writer_.Serializable(); }
 
   virtual void Serializable(std::string_view name,
                             class Serializable& obj) override {
-    WriteVariableLengthInteger(current_field_index_);
-    SerializeObject(obj);
+    writer_.Serializable(name, obj);
+  }
 
-    current_field_index_++;
+  virtual void ArrayOfSerializables() override {
+    writer_.ArrayOfSerializables();
   }
 
-  virtual void ArrayOfSerializables() override { current_field_index_++; }
-
-  virtual void ArrayOfSerializables(
-      std::string_view name, int current_size,
-      const std::function<
-          void(const std::function<void(class Serializable& serializable)>&
-                   serialize_entry)>& serialization_function,
-      const std::function<
-          void(int elements,
-               const std::function<void(class Serializable& serializable)>&
-                   deserialize_entry)>& deserialization_function) override {
-    if (current_size > 0) {
-      WriteVariableLengthInteger(current_field_index_);
-
-      // Reserve space for the size.
-      size_t size_position = write_stream_->CurrentOffset();
-      write_stream_->SkipForward(4);
-      size_t start_position = size_position + 4;
-
-      // Write length of the array.
-      WriteVariableLengthInteger(current_size);
-
-      // Serialize each sub object.
-      WriteStream* write_stream = write_stream_;
-      serialization_function([this](class Serializable& serializable) {
-        this->SerializeObject(serializable);
-      });
-
-      // Write the size.
-      uint32 size =
-          static_cast<uint32>(write_stream->CurrentOffset() - start_position);
-      write_stream->CopyDataIntoStream(&size, 4, size_position);
-    }
-    current_field_index_++;
+  virtual void ArrayOfSerializables(std::string_view name,
+                                    SerializableArray& arr) override {
+    writer_.ArrayOfSerializables(name, arr);
   }
 
-  virtual void ArrayOfStrings() override { current_field_index_++; }
+  virtual void ArrayOfStrings() override { writer_.ArrayOfStrings(); }
 
   virtual void ArrayOfStrings(std::string_view name,
                               std::vector<std::string>& arr) override {
-    if (!arr.empty()) {
-      WriteVariableLengthInteger(current_field_index_);
-
-      // Reserve space for the size.
-      size_t size_position = write_stream_->CurrentOffset();
-      write_stream_->SkipForward(4);
-      size_t start_position = size_position + 4;
-
-      // Write the length of the array.
-      WriteVariableLengthInteger(arr.size());
-
-      // Serialize each string.
-      for (const auto& str : arr) {
-        WriteVariableLengthInteger(str.length());
-        write_stream_->CopyDataIntoStream(str.data(), str.length());
-      }
-
-      // Write the size.
-      uint32 size =
-          static_cast<uint32>(write_stream_->CurrentOffset() - start_position);
-      write_stream_->CopyDataIntoStream(&size, 4, size_position);
-    }
-    current_field_index_++;
+    writer_.ArrayOfStrings(name, arr);
   }
 
  private:
-  void WriteVariableLengthInteger(uint64 value) {
-    while (value >= 0x80) {
-      auto byte = static_cast<uint8_t>(value & 0x7F) | 0x80;
-      write_stream_->CopyDataIntoStream(&byte, 1);
-      value >>= 7;
-    }
-    auto byte = static_cast<uint8_t>(value);
-    write_stream_->CopyDataIntoStream(&byte, 1);
-  }
+  BinaryWriter& writer_;
+};
 
-  void WriteVariableLengthSignedInteger(int64 value) {
-    uint64_t zigzag_encoded =
-        (static_cast<uint64_t>(value) << 1) ^ (value >> 63);
-    WriteVariableLengthInteger(zigzag_encoded);
-  }
+}  // namespace
 
-  void SerializeObject(class Serializable& obj) {
-    // Reserve space for the size of the sub object.
-    size_t size_position = write_stream_->CurrentOffset();
-    write_stream_->SkipForward(4);
-    size_t start_position = size_position + 4;
+BinaryOutput::BinaryOutput(std::vector<std::byte>* vector)
+    : data_(vector->data()),
+      capacity_(vector->size()),
+      offset_(0),
+      vector_(vector) {}
 
-    // Serialize the sub object.
-    BinarySerializer serializer(write_stream_);
-    obj.Serialize(serializer);
+BinaryOutput::BinaryOutput(void* data, size_t size)
+    : data_((std::byte*)data),
+      capacity_(data == nullptr ? 0 : size),
+      offset_(0),
+      vector_(nullptr) {}
 
-    // Write the size of the sub object.
-    uint32 size =
-        static_cast<uint32>(write_stream_->CurrentOffset() - start_position);
-    write_stream_->CopyDataIntoStream(&size, 4, size_position);
+void BinaryOutput::Finish() {
+  if (vector_ != nullptr) vector_->resize(offset_);
+}
+
+void BinaryOutput::GrowVector(size_t size) {
+  // Double the size, so writing is linear overall.
+  vector_->resize(std::max(size, vector_->size() * 2));
+  data_ = vector_->data();
+  capacity_ = vector_->size();
+}
+
+void BinaryWriter::ArrayOfSerializables(std::string_view name,
+                                        SerializableArray& arr) {
+  size_t elements = arr.Size();
+  if (elements > 0) {
+    WriteVariableLengthInteger(current_field_index_);
+    size_t size_position = BeginSizedBlock();
+    WriteVariableLengthInteger(elements);
+    for (size_t i = 0; i < elements; i++) WriteObject(arr.At(i));
+    EndSizedBlock(size_position);
   }
+  current_field_index_++;
+}
 
-  WriteStream* write_stream_;
-  int current_field_index_;
-};
+void BinaryWriter::ArrayOfStrings(std::string_view name,
+                                  std::vector<std::string>& arr) {
+  if (!arr.empty()) {
+    WriteVariableLengthInteger(current_field_index_);
+    size_t size_position = BeginSizedBlock();
+    WriteVariableLengthInteger(arr.size());
+    for (const auto& str : arr) {
+      WriteVariableLengthInteger(str.length());
+      output_.Write(str.data(), str.length());
+    }
+    EndSizedBlock(size_position);
+  }
+  current_field_index_++;
+}
 
-}  // namespace
+void Serializable::SerializeToBinary(BinaryWriter& writer) {
+  BinarySerializer serializer(writer);
+  Serialize(serializer);
+}
 
 void SerializeIntoStream(const Serializable& object, WriteStream& stream) {
-  BinarySerializer serializer(&stream);
-  const_cast<Serializable&>(object).Serialize(serializer);
+  // Serialize into contiguous memory, then copy it into the stream at once,
+  // rather than calling into the stream for each field.
+  std::vector<std::byte> data;
+  BinaryOutput output(&data);
+  BinaryWriter::WriteFields(output, const_cast<Serializable&>(object));
+  output.Finish();
+  stream.CopyDataIntoStream(data.data(), data.size());
 }
 
 }  // namespace serialization
-}  // namespace perception
\ No newline at end of file
+}  // namespace perception
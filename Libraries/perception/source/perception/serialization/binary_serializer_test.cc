@@ -14,10 +14,14 @@
 
 #include "perception/serialization/binary_serializer.h"
 
+#include <chrono>
+#include <iostream>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "perception/serialization/binary_deserializer.h"
+#include "perception/serialization/flat_buffer.h"
 #include "perception/serialization/memory_read_stream.h"
 #include "perception/serialization/serializable.h"
 #include "perception/serialization/serializer.h"
@@ -60,6 +64,50 @@ class TestObject : public ::perception::serialization::Serializable {
   }
 };
 
+class DirectoryEntry : public ::perception::serialization::Serializable {
+ public:
+  std::string name;
+  uint64 size = 0;
+  bool is_directory = false;
+
+  virtual void Serialize(
+      ::perception::serialization::Serializer& serializer) override {
+    serializer.String("name", name);
+    serializer.Integer("size", size);
+    serializer.Integer("is_directory", is_directory);
+  }
+};
+
+class DirectoryListing : public ::perception::serialization::Serializable {
+ public:
+  std::vector<DirectoryEntry> entries;
+
+  virtual void Serialize(
+      ::perception::serialization::Serializer& serializer) override {
+    serializer.ArrayOfSerializables("entries", entries);
+  }
+};
+
+struct FlatDirectoryEntry {
+  ::perception::serialization::FlatString name;
+  uint64 size;
+  bool is_directory;
+};
+
+struct FlatDirectoryListing {
+  ::perception::serialization::FlatArray<FlatDirectoryEntry> entries;
+};
+
+// Returns the average number of nanoseconds each run of a function took.
+template <class Function>
+double MeasureNanoseconds(int runs, Function function) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < runs; i++) function();
+  std::chrono::duration<double, std::nano> duration =
+      std::chrono::steady_clock::now() - start;
+  return duration.count() / runs;
+}
+
 }  // namespace
 
 TEST(BinarySerializationRoundtrip) {
@@ -124,3 +172,73 @@ TEST(BinarySerializationRoundtrip) {
            obj2.string_array_val[3]);
   }
 }
+
+TEST(BinaryAndFlatBenchmark) {
+  using ::perception::serialization::FlatBuilder;
+  using ::perception::serialization::FlatView;
+
+  constexpr int kEntries = 1000;
+  constexpr int kRuns = 200;
+
+  DirectoryListing listing;
+  for (int i = 0; i < kEntries; i++) {
+    DirectoryEntry entry;
+    entry.name = "File number " + std::to_string(i) + ".txt";
+    entry.size = i * 100;
+    entry.is_directory = i % 10 == 0;
+    listing.entries.push_back(entry);
+  }
+
+  // Both formats are checked by adding up what's read, so the reads can't be
+  // optimized away.
+  uint64 expected_total = 0;
+  for (const auto& entry : listing.entries)
+    expected_total += entry.size + entry.name.length() + entry.is_directory;
+
+  std::vector<std::byte> binary;
+  double binary_write = MeasureNanoseconds(kRuns, [&]() {
+    binary = ::perception::serialization::SerializeToByteVector(listing);
+  });
+
+  uint64 binary_total = 0;
+  double binary_read = MeasureNanoseconds(kRuns, [&]() {
+    DirectoryListing received;
+    ::perception::serialization::DeserializeFromByteVector(received, binary);
+    binary_total = 0;
+    for (const auto& entry : received.entries)
+      binary_total += entry.size + entry.name.length() + entry.is_directory;
+  });
+
+  FlatBuilder builder;
+  std::vector<FlatDirectoryEntry> flat_entries;
+  double flat_write = MeasureNanoseconds(kRuns, [&]() {
+    builder.Clear();
+    flat_entries.clear();
+    for (const auto& entry : listing.entries) {
+      flat_entries.push_back(
+          {builder.String(entry.name), entry.size, entry.is_directory});
+    }
+    builder.Finish(FlatDirectoryListing{builder.Array(flat_entries)});
+  });
+
+  uint64 flat_total = 0;
+  double flat_read = MeasureNanoseconds(kRuns, [&]() {
+    FlatView<FlatDirectoryListing> received(builder.Data());
+    flat_total = 0;
+    for (const auto& entry : received.Array(received->entries)) {
+      flat_total +=
+          entry.size + received.String(entry.name).length() + entry.is_directory;
+    }
+  });
+
+  EXPECT(expected_total, binary_total);
+  EXPECT(expected_total, flat_total);
+
+  std::cout << "ns per " << kEntries << " directory entries:" << std::endl;
+  std::cout << "  Binary write: " << binary_write << " (" << binary.size()
+            << " bytes)" << std::endl;
+  std::cout << "  Binary read: " << binary_read << std::endl;
+  std::cout << "  Flat write: " << flat_write << " (" << builder.Data().size()
+            << " bytes)" << std::endl;
+  std::cout << "  Flat read: " << flat_read << std::endl;
+}
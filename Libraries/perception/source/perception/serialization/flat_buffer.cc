@@ -0,0 +1,116 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "perception/serialization/flat_buffer.h"
+
+#include <cstring>
+
+#if defined(PERCEPTION)
+#include "perception/shared_memory.h"
+#endif
+
+namespace perception {
+namespace serialization {
+namespace {
+
+// Returns whether data is aligned. Sizes and alignments come from the sender,
+// so unaligned data is treated like data outside of the buffer.
+bool IsAligned(const void* data, size_t alignment) {
+  return ((size_t)data & (alignment - 1)) == 0;
+}
+
+}  // namespace
+
+FlatBuilder::FlatBuilder() { Clear(); }
+
+FlatString FlatBuilder::String(std::string_view str) {
+  FlatString flat_string;
+  flat_string.offset = (uint32)Append(str.data(), str.length(), 1);
+  flat_string.length = (uint32)str.length();
+  return flat_string;
+}
+
+const std::vector<std::byte>& FlatBuilder::Data() const { return data_; }
+
+void FlatBuilder::Clear() {
+  data_.clear();
+  data_.resize(sizeof(FlatBufferHeader));
+}
+
+#if defined(PERCEPTION)
+std::shared_ptr<SharedMemory> FlatBuilder::ToSharedMemory() const {
+  auto shared_memory = SharedMemory::FromSize(data_.size(), 0);
+  if (!shared_memory || !shared_memory->Join()) return nullptr;
+  std::memcpy(**shared_memory, data_.data(), data_.size());
+  return shared_memory;
+}
+#endif
+
+size_t FlatBuilder::Append(const void* data, size_t size, size_t alignment) {
+  size_t offset = (data_.size() + alignment - 1) & ~(alignment - 1);
+  data_.resize(offset + size);
+  if (size > 0) std::memcpy(&data_[offset], data, size);
+  return offset;
+}
+
+const std::vector<std::byte>& FlatBuilder::FinishWithRoot(const void* root,
+                                                          size_t size,
+                                                          size_t alignment) {
+  FlatBufferHeader header;
+  header.magic = kFlatBufferMagic;
+  header.root_offset = (uint32)Append(root, size, alignment);
+  header.root_size = (uint32)size;
+  header.reserved = 0;
+  std::memcpy(data_.data(), &header, sizeof(header));
+  return data_;
+}
+
+FlatReader::FlatReader(const void* data, size_t size)
+    : span_((void*)data, size) {}
+
+#if defined(PERCEPTION)
+FlatReader::FlatReader(SharedMemory& shared_memory)
+    : span_(shared_memory.ToSpan()) {}
+#endif
+
+std::string_view FlatReader::String(const FlatString& str) const {
+  uint32 offset = ReadOnce(str.offset);
+  uint32 length = ReadOnce(str.length);
+  if (length == 0) return std::string_view();
+  const MemorySpan sub_span = span_.SubSpan(offset, length);
+  if (!sub_span) return std::string_view();
+  return std::string_view((const char*)*sub_span, length);
+}
+
+const void* FlatReader::Root(size_t size, size_t alignment) const {
+  const FlatBufferHeader* header = span_.ToType<FlatBufferHeader>();
+  if (header == nullptr) return nullptr;
+
+  uint32 root_offset = ReadOnce(header->root_offset);
+  uint32 root_size = ReadOnce(header->root_size);
+  if (ReadOnce(header->magic) != kFlatBufferMagic || root_size < size)
+    return nullptr;
+  const void* root = *span_.SubSpan(root_offset, root_size);
+  return IsAligned(root, alignment) ? root : nullptr;
+}
+
+const void* FlatReader::ArrayData(uint32 offset, uint32 length,
+                                  size_t element_size, size_t alignment) const {
+  if (length == 0) return nullptr;
+  const void* data = *span_.SubSpan(offset, (size_t)length * element_size);
+  return IsAligned(data, alignment) ? data : nullptr;
+}
+
+}  // namespace serialization
+}  // namespace perception
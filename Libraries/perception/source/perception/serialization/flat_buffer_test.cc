@@ -0,0 +1,161 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "perception/serialization/flat_buffer.h"
+
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "testing.h"
+
+namespace {
+
+using ::perception::serialization::FlatArray;
+using ::perception::serialization::FlatBufferHeader;
+using ::perception::serialization::FlatBuilder;
+using ::perception::serialization::FlatString;
+using ::perception::serialization::FlatView;
+
+struct Entry {
+  FlatString name;
+  uint64 size;
+  bool is_directory;
+};
+
+struct Listing {
+  FlatString path;
+  FlatArray<Entry> entries;
+  FlatArray<uint16> numbers;
+};
+
+// A newer version of Listing, with a field added to the end.
+struct ListingWithCount {
+  FlatString path;
+  FlatArray<Entry> entries;
+  FlatArray<uint16> numbers;
+  uint32 count;
+};
+
+}  // namespace
+
+TEST(FlatBufferRoundtrip) {
+  FlatBuilder builder;
+  std::vector<Entry> entries;
+  entries.push_back({builder.String("a.txt"), 12, false});
+  entries.push_back({builder.String("Documents"), 0, true});
+  entries.push_back({builder.String(""), 7, false});
+  std::vector<uint16> numbers = {1, 2, 3};
+
+  Listing listing;
+  listing.path = builder.String("/Home/");
+  listing.entries = builder.Array(entries);
+  listing.numbers = builder.Array(numbers);
+  const std::vector<std::byte>& data = builder.Finish(listing);
+
+  FlatView<Listing> view(data);
+  ASSERT(true, (bool)view);
+  EXPECT(std::string_view("/Home/"), view.String(view->path));
+
+  auto read_entries = view.Array(view->entries);
+  ASSERT((size_t)3, read_entries.size());
+  EXPECT(std::string_view("a.txt"), view.String(read_entries[0].name));
+  EXPECT((uint64)12, read_entries[0].size);
+  EXPECT(false, read_entries[0].is_directory);
+  EXPECT(std::string_view("Documents"), view.String(read_entries[1].name));
+  EXPECT(true, read_entries[1].is_directory);
+  EXPECT(std::string_view(""), view.String(read_entries[2].name));
+
+  auto read_numbers = view.Array(view->numbers);
+  ASSERT((size_t)3, read_numbers.size());
+  EXPECT((uint16)3, read_numbers[2]);
+}
+
+TEST(FlatBufferRejectsOutOfBounds) {
+  FlatBuilder builder;
+  Listing listing;
+  listing.path = builder.String("path");
+  std::vector<std::byte> data = builder.Finish(listing);
+
+  // Too small to hold a header.
+  EXPECT(false, (bool)FlatView<Listing>(data.data(), 4));
+
+  // The root is cut off.
+  EXPECT(false, (bool)FlatView<Listing>(data.data(), data.size() - 1));
+
+  // An older root is smaller than expected.
+  EXPECT(false, (bool)FlatView<ListingWithCount>(data));
+
+  // A string and arrays that point outside of the buffer.
+  Listing bad_listing;
+  bad_listing.path = {1000, 4};
+  bad_listing.entries = {0xFFFFFFF0, 0xFFFFFFFF};
+  bad_listing.numbers = {1, 1};
+  FlatBuilder bad_builder;
+  FlatView<Listing> view(bad_builder.Finish(bad_listing));
+  ASSERT(true, (bool)view);
+  EXPECT(std::string_view(), view.String(view->path));
+  EXPECT((size_t)0, view.Array(view->entries).size());
+  // Unaligned.
+  EXPECT((size_t)0, view.Array(view->numbers).size());
+}
+
+TEST(FlatBufferReadsNewerRoot) {
+  FlatBuilder builder;
+  ListingWithCount listing;
+  listing.path = builder.String("/");
+  listing.count = 5;
+  FlatView<Listing> view(builder.Finish(listing));
+  ASSERT(true, (bool)view);
+  EXPECT(std::string_view("/"), view.String(view->path));
+}
+
+TEST(FlatBufferReadsLengthsOnce) {
+  FlatBuilder builder;
+  std::vector<Entry> entries(3);
+  Listing listing;
+  listing.path = builder.String("/Home/");
+  listing.entries = builder.Array(entries);
+  std::vector<std::byte> data = builder.Finish(listing);
+
+  FlatView<Listing> view(data);
+  ASSERT(true, (bool)view);
+
+  // Like a sender that keeps writing to shared memory, flip the lengths
+  // between valid values and values that run past the end of the buffer while
+  // they're being read. Every read must see one or the other, never a length
+  // that was checked and then grew.
+  Listing* root = (Listing*)view.Root();
+  std::atomic<bool> done = false;
+  std::thread sender([&]() {
+    for (uint32 i = 0; !done.load(std::memory_order_relaxed); i++) {
+      bool valid = (i & 1) == 0;
+      __atomic_store_n(&root->path.length, valid ? 6 : 0x7FFFFFFF,
+                       __ATOMIC_RELAXED);
+      __atomic_store_n(&root->entries.length, valid ? 3 : 0x7FFFFFFF,
+                       __ATOMIC_RELAXED);
+    }
+  });
+
+  for (int i = 0; i < 1000000; i++) {
+    size_t path_length = view.String(view->path).size();
+    if (path_length != 0) EXPECT((size_t)6, path_length);
+    size_t entry_count = view.Array(view->entries).size();
+    if (entry_count != 0) EXPECT((size_t)3, entry_count);
+  }
+  done = true;
+  sender.join();
+}
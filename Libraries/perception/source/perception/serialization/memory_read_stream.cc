@@ -82,8 +82,8 @@ const void* MemoryReadStream::CurrentDataPointer() {
 
 void DeserializeFromMemory(Serializable& object, const void* data,
                            size_t size) {
-  MemoryReadStream read_stream(data, size);
-  DeserializeFromStream(object, read_stream);
+  BinaryInput input(data, size);
+  BinaryReader::ReadFields(input, object);
 }
 
 void DeserializeFromByteVector(Serializable& object,
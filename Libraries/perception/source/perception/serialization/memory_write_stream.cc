@@ -0,0 +1,50 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "perception/serialization/memory_write_stream.h"
+
+#include <cstring>
+
+#include "perception/serialization/binary_serializer.h"
+
+namespace perception {
+namespace serialization {
+
+MemoryWriteStream::MemoryWriteStream(void* data, size_t size)
+    : data_(data), size_(size), current_offset_(0) {}
+
+void MemoryWriteStream::CopyDataIntoStream(const void* data, size_t size) {
+  CopyDataIntoStream(data, size, current_offset_);
+  current_offset_ += size;
+}
+
+void MemoryWriteStream::CopyDataIntoStream(const void* data, size_t size,
+                                           size_t offset) {
+  if (data_ == nullptr || offset > size_ || size > size_ - offset) return;
+  std::memcpy((void*)((size_t)data_ + offset), data, size);
+}
+
+void MemoryWriteStream::SkipForward(size_t size) { current_offset_ += size; }
+
+size_t MemoryWriteStream::CurrentOffset() { return current_offset_; }
+
+size_t SerializeToMemory(const Serializable& object, void* data, size_t size) {
+  BinaryOutput output(data, size);
+  BinaryWriter::WriteFields(output, const_cast<Serializable&>(object));
+  return output.Offset();
+}
+
+}  // namespace serialization
+}  // namespace perception
@@ -0,0 +1,236 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "perception/serialization/static_serializable.h"
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "perception/serialization/memory_read_stream.h"
+#include "perception/serialization/memory_write_stream.h"
+#include "perception/serialization/serializable.h"
+#include "perception/serialization/serializer.h"
+#include "perception/serialization/vector_write_stream.h"
+#include "testing.h"
+
+namespace {
+
+using ::perception::serialization::DeserializeFromByteVector;
+using ::perception::serialization::Serializable;
+using ::perception::serialization::SerializeToByteVector;
+using ::perception::serialization::SerializeToMemory;
+using ::perception::serialization::Serializer;
+using ::perception::serialization::StaticSerializable;
+
+enum class Kind : uint8 { FILE = 1, DIRECTORY = 2 };
+
+// The same fields are serialized by a virtual and a static class, which
+// should be interchangeable.
+#define INNER_FIELDS(serializer)                                               \
+  serializer.Integer("number", number);                                        \
+  serializer.String("text", text);                                             \
+  serializer.Float();                                                          \
+  serializer.Double("fraction", fraction)
+
+#define OUTER_FIELDS(serializer)                                               \
+  serializer.Integer("flag", flag);                                            \
+  serializer.Integer("negative", negative);                                    \
+  serializer.Enum("kind", kind);                                               \
+  serializer.String("name", name);                                             \
+  serializer.Serializable("inner", inner);                                     \
+  serializer.Serializable("shared_inner", shared_inner);                       \
+  serializer.Serializable("optional_inner", optional_inner);                   \
+  serializer.Serializable();                                                   \
+  serializer.ArrayOfSerializables("inners", inners);                           \
+  serializer.ArrayOfSerializables("shared_inners", shared_inners);             \
+  serializer.ArrayOfStrings("strings", strings)
+
+template <class Inner>
+class OuterFields {
+ public:
+  bool flag = false;
+  int64 negative = 0;
+  Kind kind = Kind::FILE;
+  std::string name;
+  Inner inner;
+  std::shared_ptr<Inner> shared_inner;
+  std::optional<Inner> optional_inner;
+  std::vector<Inner> inners;
+  std::vector<std::shared_ptr<Inner>> shared_inners;
+  std::vector<std::string> strings;
+};
+
+class VirtualInner : public Serializable {
+ public:
+  int32 number = 0;
+  std::string text;
+  double fraction = 0.0;
+
+  virtual void Serialize(Serializer& serializer) override {
+    INNER_FIELDS(serializer);
+  }
+};
+
+class VirtualOuter : public Serializable, public OuterFields<VirtualInner> {
+ public:
+  virtual void Serialize(Serializer& serializer) override {
+    OUTER_FIELDS(serializer);
+  }
+};
+
+class StaticInner : public StaticSerializable<StaticInner> {
+ public:
+  int32 number = 0;
+  std::string text;
+  double fraction = 0.0;
+
+  template <class S>
+  void Serialize(S& serializer) {
+    INNER_FIELDS(serializer);
+  }
+};
+
+class StaticOuter : public StaticSerializable<StaticOuter>,
+                    public OuterFields<StaticInner> {
+ public:
+  template <class S>
+  void Serialize(S& serializer) {
+    OUTER_FIELDS(serializer);
+  }
+};
+
+template <class Inner>
+void FillInner(Inner& inner, int i) {
+  inner.number = i - 5;
+  inner.text = std::string(i % 7, 'a' + i % 26);
+  inner.fraction = i * 0.25;
+}
+
+template <class Outer>
+void FillOuter(Outer& outer, int entries) {
+  using Inner = decltype(outer.inner);
+  outer.flag = true;
+  outer.negative = -1234567;
+  outer.kind = Kind::DIRECTORY;
+  outer.name = "Outer";
+  FillInner(outer.inner, 3);
+  outer.shared_inner = std::make_shared<Inner>();
+  FillInner(*outer.shared_inner, 4);
+  outer.optional_inner = Inner();
+  for (int i = 0; i < entries; i++) {
+    outer.inners.emplace_back();
+    FillInner(outer.inners.back(), i);
+    outer.shared_inners.push_back(i % 3 == 0 ? nullptr
+                                             : std::make_shared<Inner>());
+    if (outer.shared_inners.back())
+      FillInner(*outer.shared_inners.back(), i * 2);
+    outer.strings.push_back(std::to_string(i));
+  }
+}
+
+// Returns the average number of nanoseconds each run of a function took.
+template <class Function>
+double MeasureNanoseconds(int runs, Function function) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < runs; i++) function();
+  std::chrono::duration<double, std::nano> duration =
+      std::chrono::steady_clock::now() - start;
+  return duration.count() / runs;
+}
+
+}  // namespace
+
+TEST(StaticSerializationMatchesVirtual) {
+  VirtualOuter virtual_outer;
+  StaticOuter static_outer;
+  FillOuter(virtual_outer, 10);
+  FillOuter(static_outer, 10);
+
+  std::vector<std::byte> virtual_bytes = SerializeToByteVector(virtual_outer);
+  std::vector<std::byte> static_bytes = SerializeToByteVector(static_outer);
+  EXPECT(true, virtual_bytes == static_bytes);
+  EXPECT(virtual_bytes.size(), SerializeToMemory(static_outer, nullptr, 0));
+  EXPECT(virtual_outer.ToString(), static_outer.ToString());
+
+  // Each can read what the other wrote.
+  StaticOuter static_read;
+  DeserializeFromByteVector(static_read, virtual_bytes);
+  EXPECT(virtual_outer.ToString(), static_read.ToString());
+  EXPECT((int64)-1234567, static_read.negative);
+  EXPECT(true, static_read.shared_inners[0] != nullptr);
+  EXPECT((size_t)10, static_read.strings.size());
+
+  VirtualOuter virtual_read;
+  DeserializeFromByteVector(virtual_read, static_bytes);
+  EXPECT(virtual_outer.ToString(), virtual_read.ToString());
+
+  // Missing fields are reset.
+  DeserializeFromByteVector(static_read, SerializeToByteVector(StaticOuter()));
+  EXPECT(StaticOuter().ToString(), static_read.ToString());
+}
+
+TEST(StaticSerializationHandlesTruncatedData) {
+  VirtualOuter virtual_outer;
+  FillOuter(virtual_outer, 10);
+  std::vector<std::byte> bytes = SerializeToByteVector(virtual_outer);
+
+  for (size_t length = 0; length < bytes.size(); length += 7) {
+    std::vector<std::byte> truncated(bytes.begin(), bytes.begin() + length);
+    VirtualOuter virtual_read;
+    StaticOuter static_read;
+    DeserializeFromByteVector(virtual_read, truncated);
+    DeserializeFromByteVector(static_read, truncated);
+    EXPECT(virtual_read.ToString(), static_read.ToString());
+  }
+}
+
+TEST(StaticSerializationBenchmark) {
+  constexpr int kRuns = 2000;
+  VirtualOuter virtual_outer;
+  StaticOuter static_outer;
+  FillOuter(virtual_outer, 100);
+  FillOuter(static_outer, 100);
+  std::vector<std::byte> bytes = SerializeToByteVector(virtual_outer);
+
+  std::vector<std::byte> output;
+  double virtual_write = MeasureNanoseconds(
+      kRuns, [&]() { output = SerializeToByteVector(virtual_outer); });
+  double static_write = MeasureNanoseconds(
+      kRuns, [&]() { output = SerializeToByteVector(static_outer); });
+
+  VirtualOuter virtual_read;
+  StaticOuter static_read;
+  double virtual_read_time = MeasureNanoseconds(
+      kRuns, [&]() { DeserializeFromByteVector(virtual_read, bytes); });
+  double static_read_time = MeasureNanoseconds(
+      kRuns, [&]() { DeserializeFromByteVector(static_read, bytes); });
+
+  EXPECT(virtual_outer.ToString(), static_read.ToString());
+
+  // Megabytes per second.
+  auto throughput = [&](double nanoseconds) {
+    return bytes.size() * 1000.0 / nanoseconds;
+  };
+  std::cout << "MB/s for a " << bytes.size() << " byte nested message:"
+            << std::endl;
+  std::cout << "  Virtual write: " << throughput(virtual_write) << std::endl;
+  std::cout << "  Static write: " << throughput(static_write) << std::endl;
+  std::cout << "  Virtual read: " << throughput(virtual_read_time)
+            << std::endl;
+  std::cout << "  Static read: " << throughput(static_read_time) << std::endl;
+}
@@ -309,33 +309,20 @@ class TextDeserializer : public Serializer {
 
   virtual void ArrayOfSerializables() override { current_field_index_++; }
 
-  virtual void ArrayOfSerializables(
-      std::string_view name, int current_size,
-      const std::function<
-          void(const std::function<void(class Serializable& serializable)>&
-                   serialize_entry)>& serialization_function,
-      const std::function<
-          void(int elements,
-               const std::function<void(class Serializable& serializable)>&
-                   deserialize_entry)>& deserialization_function) override {
+  virtual void ArrayOfSerializables(std::string_view name,
+                                    SerializableArray& arr) override {
     if (auto child = GetField(name)) {
       if (child->type == TextNode::ARRAY) {
-        int elements = child->array_value.size();
-        int current_index = 0;
-        deserialization_function(
-            elements,
-            [child, &current_index](class Serializable& serializable) {
-              if (current_index < child->array_value.size()) {
-                auto item_node = child->array_value[current_index++];
-                TextDeserializer child_serializer(item_node);
-                serializable.Serialize(child_serializer);
-              }
-            });
+        arr.Resize(child->array_value.size());
+        for (size_t i = 0; i < arr.Size(); i++) {
+          TextDeserializer child_serializer(child->array_value[i]);
+          arr.At(i).Serialize(child_serializer);
+        }
         current_field_index_++;
         return;
       }
     }
-    deserialization_function(0, [](class Serializable& serializable) {});
+    arr.Resize(0);
     current_field_index_++;
   }
 
@@ -128,35 +128,24 @@ class TextSerializer : public Serializer {
 
   virtual void ArrayOfSerializables() override {}
 
-  virtual void ArrayOfSerializables(
-      std::string_view name, int current_size,
-      const std::function<
-          void(const std::function<void(class Serializable& serializable)>&
-                   serialize_entry)>& serialization_function,
-      const std::function<
-          void(int elements,
-               const std::function<void(class Serializable& serializable)>&
-                   deserialize_entry)>& deserialization_function) override {
-    if (current_size == 0) return;
+  virtual void ArrayOfSerializables(std::string_view name,
+                                    SerializableArray& arr) override {
+    if (arr.Size() == 0) return;
     AppendIndentation();
     output_string_->append(name);
     output_string_->append(": [\n");
 
-    std::string* output_string = output_string_;
     int child_indentation = indentation_ + 2;
 
-    serialization_function(
-        [output_string, child_indentation](class Serializable& serializable) {
-          for (int i = 0; i < child_indentation; ++i)
-            output_string->append(" ");
+    for (size_t index = 0; index < arr.Size(); index++) {
+      for (int i = 0; i < child_indentation; ++i) output_string_->append(" ");
 
-          TextSerializer child_serializer(child_indentation + 2, output_string);
-          serializable.Serialize(child_serializer);
+      TextSerializer child_serializer(child_indentation + 2, output_string_);
+      arr.At(index).Serialize(child_serializer);
 
-          for (int i = 0; i < child_indentation; ++i)
-            output_string->append(" ");
-          output_string->append("}\n");
-        });
+      for (int i = 0; i < child_indentation; ++i) output_string_->append(" ");
+      output_string_->append("}\n");
+    }
 
     AppendIndentation();
     output_string_->append("]\n");
@@ -58,9 +58,9 @@ size_t VectorWriteStream::CurrentOffset() { return data_->size(); }
 
 std::vector<std::byte> SerializeToByteVector(const Serializable& object) {
   std::vector<std::byte> vector;
-  VectorWriteStream write_stream(&vector);
-  SerializeIntoStream(object, write_stream);
-
+  BinaryOutput output(&vector);
+  BinaryWriter::WriteFields(output, const_cast<Serializable&>(object));
+  output.Finish();
   return vector;
 }
 
@@ -52,13 +52,12 @@ void ServiceClient::StopNotifyingOnDisappearance(MessageId message_id) {
 
 void ServiceClient::MaybeHandleUnexpectedMemoryInResponse(
     ProcessId process_id, const MessageData& message) {
-  if (message.param2 == SIZE_MAX) return;
+  if (HasInlineParameters(message.metadata) || message.param2 == SIZE_MAX)
+    return;
 
-  // If there is a message attached, but it's not needed, so clear the
-  // status bit.
-  auto shared_memory =
-      GetMemoryBufferForReceivingFromProcess(process_id, message.param2);
-  SetMemoryBufferAsReadyForSendingNextMessageToProcess(*shared_memory);
+  // If there is a message attached, but it's not needed, so free it.
+  ReleaseRpcParametersFromProcess(process_id,
+                                  GetRpcResponseParameters(message));
 }
 
 void ServiceClient::PrepareRequestMessage(size_t method_id,
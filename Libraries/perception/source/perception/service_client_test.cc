@@ -0,0 +1,169 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "perception/service_client.h"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "perception/scheduler.h"
+#include "perception/serialization/memory_write_stream.h"
+#include "perception/serialization/serializer.h"
+#include "perception/service_macros.h"
+#include "testing.h"
+
+namespace perception {
+namespace {
+
+using ::perception::serialization::Serializable;
+using ::perception::serialization::SerializeToMemory;
+using ::perception::serialization::Serializer;
+
+class SmallValue : public Serializable {
+ public:
+  int64 a = 0;
+  int64 b = 0;
+
+  virtual void Serialize(Serializer& serializer) override {
+    serializer.Integer("A", a);
+    serializer.Integer("B", b);
+  }
+};
+
+class TextValue : public Serializable {
+ public:
+  std::string text;
+
+  virtual void Serialize(Serializer& serializer) override {
+    serializer.String("Text", text);
+  }
+};
+
+#define TEST_RPC_METHOD_LIST(X)           \
+  X(1, Swap, SmallValue, SmallValue)      \
+  X(2, Echo, TextValue, TextValue)        \
+  X(3, Count, SmallValue, void)
+
+DEFINE_PERCEPTION_SERVICE(TestRpc, "perception.test.Rpc", TEST_RPC_METHOD_LIST)
+
+class TestRpcServer : public TestRpc::Server {
+ public:
+  int count = 0;
+
+  virtual StatusOr<SmallValue> Swap(const SmallValue& request) override {
+    SmallValue response;
+    response.a = request.b;
+    response.b = request.a;
+    return response;
+  }
+
+  virtual StatusOr<TextValue> Echo(const TextValue& request) override {
+    TextValue response;
+    response.text = request.text;
+    return response;
+  }
+
+  virtual StatusOr<SmallValue> Count() override {
+    SmallValue response;
+    response.a = ++count;
+    return response;
+  }
+};
+
+TEST(SerializeToMemoryReportsOverflow) {
+  SmallValue value;
+  value.a = 1;
+  value.b = -2;
+  uint8 data[24];
+  size_t size = SerializeToMemory(value, data, sizeof(data));
+  EXPECT(true, size > 0 && size <= sizeof(data));
+
+  TextValue text;
+  text.text = std::string(100, 'x');
+  EXPECT(true, SerializeToMemory(text, data, sizeof(data)) > sizeof(data));
+}
+
+TEST(RpcsWithSmallAndLargeParameters) {
+  TestRpcServer server;
+  TestRpc::Client client(server);
+
+  SmallValue small;
+  small.a = 12;
+  small.b = -34;
+  auto swapped = client.Swap(small);
+  ASSERT(true, swapped.Ok());
+  EXPECT((int64)-34, swapped->a);
+  EXPECT((int64)12, swapped->b);
+
+  for (size_t length : {0, 5, 100, 5000}) {
+    TextValue text;
+    text.text = std::string(length, 'a');
+    auto echoed = client.Echo(text);
+    ASSERT(true, echoed.Ok());
+    EXPECT(text.text, echoed->text);
+  }
+
+  EXPECT((int64)1, client.Count()->a);
+
+  int64 async_result = 0;
+  client.Swap(small, [&](StatusOr<SmallValue> response) {
+    if (response.Ok()) async_result = response->a;
+  });
+  FinishAnyPendingWork();
+  EXPECT((int64)-34, async_result);
+}
+
+TEST(RpcBenchmark) {
+  constexpr int kCalls = 10000;
+  TestRpcServer server;
+  TestRpc::Client client(server);
+
+  SmallValue small;
+  small.a = 1;
+  small.b = 2;
+  TextValue large;
+  large.text = std::string(1000, 'a');
+
+  // Returns the average number of nanoseconds each call took. Responses are
+  // handled after every few calls, as there's a limit to how many RPC buffers
+  // can be in flight to a process.
+  auto measure = [&](auto call) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kCalls; i++) {
+      call();
+      if (i % 8 == 7) FinishAnyPendingWork();
+    }
+    FinishAnyPendingWork();
+    std::chrono::duration<double, std::nano> duration =
+        std::chrono::steady_clock::now() - start;
+    return duration.count() / kCalls;
+  };
+
+  std::cout << "ns per RPC:" << std::endl;
+  std::cout << "  Sync small: " << measure([&]() { (void)client.Swap(small); })
+            << std::endl;
+  std::cout << "  Sync large: " << measure([&]() { (void)client.Echo(large); })
+            << std::endl;
+  std::cout << "  Async small: " << measure([&]() {
+    client.Swap(small, [](StatusOr<SmallValue>) {});
+  }) << std::endl;
+  std::cout << "  Async large: " << measure([&]() {
+    client.Echo(large, [](StatusOr<TextValue>) {});
+  }) << std::endl;
+}
+
+}  // namespace
+}  // namespace perception
@@ -29,18 +29,25 @@ namespace perception {
 //    param 1: message ID to use for response, or MAX if caller doesn't want a
 //    response
 //    param 2: method ID
-//    param 3: shared buffer ID, or MAX for no attached messag
-//    param 4: length of message, in bytes (page aligned)
-//    param 5:
+//    param 3: RPC buffer pool ID, or MAX for no attached messag
+//    param 4: size of the pool's data, in bytes (page aligned)
+//    param 5: length of message, in bytes
 //
 // Response:
 //    metadata:
 //    param 1: status
-//    param 2: shared buffer ID of response, or MAX for no attached method
-//    param 3: length of message, in bytes (page aligned)
-//    param 4:
+//    param 2: RPC buffer pool ID of response, or MAX for no attached method
+//    param 3: size of the pool's data, in bytes (page aligned)
+//    param 4: length of message, in bytes
 //    param 5:
 //
+// The page of the pool's data that a message starts at is kept in the
+// metadata, from bit 16 up.
+//
+// If the metadata has kMessageHasInlineParameters set, the serialized request
+// is in params 3 to 5, or the serialized response is in params 2 to 5, instead
+// of in a shared buffer.
+//
 
 ServiceServer::ServiceServer(ServiceServerOptions options,
                              std::string_view service_name)
@@ -102,10 +109,9 @@ bool ServiceServer::operator<(const ServiceServer& rhs) const {
 
 void ServiceServer::HandleUnexpectedMessageInRequest(
     ProcessId sender, const MessageData& message) {
-  if (message.param3 == SIZE_MAX) return;
-  auto shared_memory =
-      GetMemoryBufferForReceivingFromProcess(sender, message.param3);
-  SetMemoryBufferAsReadyForSendingNextMessageToProcess(*shared_memory);
+  if (HasInlineParameters(message.metadata) || message.param3 == SIZE_MAX)
+    return;
+  ReleaseRpcParametersFromProcess(sender, GetRpcRequestParameters(message));
 }
 
 }  // namespace perception
\ No newline at end of file
@@ -14,7 +14,9 @@
 
 #include <chrono>
 #include <cstdlib>
+#include <deque>
 #include <functional>
+#include <map>
 #include <string_view>
 
 #include "perception/fibers.h"
@@ -24,6 +26,8 @@
 #include "perception/permissions.h"
 #include "perception/processes.h"
 #include "perception/registry.h"
+#include "perception/rpc_buffer_pool.h"
+#include "perception/rpc_memory.h"
 #include "perception/scheduler.h"
 #include "perception/service_client.h"
 #include "perception/service_server.h"
@@ -31,6 +35,41 @@
 #include "perception/shared_memory.h"
 
 namespace perception {
+namespace {
+
+// A message sent by this process to itself.
+struct QueuedMessage {
+  ProcessId sender;
+  MessageData message_data;
+};
+
+// Messages this process sent to itself, in the order they were sent.
+std::deque<QueuedMessage> queued_messages;
+
+// Handlers for messages this process sends to itself.
+std::map<MessageId, std::function<void(ProcessId, const MessageData&)>>
+    message_handlers;
+
+// The pool for RPCs this process makes to itself.
+std::shared_ptr<RpcBufferPool> rpc_buffer_pool;
+
+// Returns the pool for RPCs this process makes to itself.
+RpcBufferPool* GetRpcBufferPool(size_t pool_id) {
+  if (rpc_buffer_pool && rpc_buffer_pool->GetId() == pool_id)
+    return rpc_buffer_pool.get();
+  return nullptr;
+}
+
+// Passes a queued message to its handler, if it has one.
+void HandleQueuedMessage(const QueuedMessage& message) {
+  auto itr = message_handlers.find(message.message_data.message_id);
+  if (itr == message_handlers.end()) return;
+  // Copy the handler, because it may unregister itself.
+  auto handler = itr->second;
+  handler(message.sender, message.message_data);
+}
+
+}  // namespace
 
 bool WaitOnFutex(void* address, int value) {
   return false;
@@ -38,25 +77,66 @@ bool WaitOnFutex(void* address, int value) {
 
 void WakeFutex(void* address, int value) {}
 
+FutexWaitResult FutexWait(volatile int* address, int expected,
+                          std::optional<std::chrono::microseconds> timeout) {
+  return *address == expected ? FutexWaitResult::TIMED_OUT
+                              : FutexWaitResult::VALUE_CHANGED;
+}
+
+size_t FutexWake(volatile int* address, size_t count) { return 0; }
+
+std::optional<size_t> FutexRequeue(volatile int* address, size_t wake_count,
+                                   volatile int* requeue_address,
+                                   size_t requeue_count,
+                                   std::optional<int> expected) {
+  if (expected && *address != *expected) return std::nullopt;
+  return 0;
+}
+
 // Message stubs
 MessageId GenerateUniqueMessageId() {
   static MessageId next_id = 1;
   return next_id++;
 }
 
+// Messages are only delivered within this process, which lets tests run the
+// client and server sides of RPCs against each other.
 void RegisterMessageHandler(
     MessageId message_id,
-    std::function<void(ProcessId, const MessageData&)> handler) {}
+    std::function<void(ProcessId, const MessageData&)> handler) {
+  message_handlers[message_id] = std::move(handler);
+}
 
-void UnregisterMessageHandler(MessageId message_id) {}
+void RegisterRawMessageHandler(
+    MessageId message_id,
+    std::function<void(ProcessId, const MessageData&)> handler) {
+  message_handlers[message_id] = std::move(handler);
+}
+
+void UnregisterMessageHandler(MessageId message_id) {
+  message_handlers.erase(message_id);
+}
 
 void RegisterWakeUpHandler(MessageId message_id) {}
 
 void SleepAndGetRawMessage(MessageId message_id, ProcessId& sender,
-                           MessageData& message_data) {}
+                           MessageData& message_data) {
+  while (!queued_messages.empty()) {
+    QueuedMessage message = queued_messages.front();
+    queued_messages.pop_front();
+    if (message.message_data.message_id == message_id) {
+      sender = message.sender;
+      message_data = message.message_data;
+      return;
+    }
+    HandleQueuedMessage(message);
+  }
+}
 
 Status SendMessage(ProcessId pid, const MessageData& message_data) {
-  return Status::UNIMPLEMENTED;
+  if (pid != GetProcessId()) return Status::UNIMPLEMENTED;
+  queued_messages.push_back({pid, message_data});
+  return Status::OK;
 }
 
 void DealWithUnhandledMessage(ProcessId sender,
@@ -77,6 +157,14 @@ void DeferAfterEvents(std::function<void()>&& function) {
 
 void Sleep() {}
 
+void FinishAnyPendingWork() {
+  while (!queued_messages.empty()) {
+    QueuedMessage message = queued_messages.front();
+    queued_messages.pop_front();
+    HandleQueuedMessage(message);
+  }
+}
+
 Fiber::Fiber(bool custom_stack) {}
 Fiber::Fiber(ThreadId thread_id) {}
 Fiber::~Fiber() {}
@@ -145,39 +233,71 @@ bool ServiceClient::operator<(const ServiceClient& rhs) const { return message_i
 bool ServiceClient::IsValid() const { return true; }
 MessageId ServiceClient::NotifyOnDisappearance(const std::function<void()>& on_disappearance) { return 0; }
 void ServiceClient::StopNotifyingOnDisappearance(MessageId message_id) {}
-void ServiceClient::MaybeHandleUnexpectedMemoryInResponse(ProcessId process_id, const MessageData& message) {}
-void ServiceClient::PrepareRequestMessage(size_t method_id, MessageData& message) {}
-void ServiceClient::PrepareRequestMessageWithoutParameters(size_t method_id, MessageData& message) {}
+void ServiceClient::MaybeHandleUnexpectedMemoryInResponse(ProcessId process_id, const MessageData& message) {
+  if (HasInlineParameters(message.metadata) || message.param2 == SIZE_MAX)
+    return;
+  ReleaseRpcParametersFromProcess(process_id,
+                                  GetRpcResponseParameters(message));
+}
+void ServiceClient::PrepareRequestMessage(size_t method_id, MessageData& message) {
+  message.message_id = message_id_;
+  message.metadata = 0;
+  message.param2 = method_id;
+}
+void ServiceClient::PrepareRequestMessageWithoutParameters(size_t method_id, MessageData& message) {
+  PrepareRequestMessage(method_id, message);
+  message.param3 = SIZE_MAX;
+}
 
 // ServiceServer stubs
 ServiceServer::ServiceServer(ServiceServerOptions options, std::string_view service_name)
-    : options_(options), message_id_(0), service_name_(service_name) {}
-ServiceServer::~ServiceServer() {}
-ProcessId ServiceServer::ServerProcessId() const { return 0; }
+    : options_(options), message_id_(GenerateUniqueMessageId()), service_name_(service_name) {
+  RegisterRawMessageHandler(message_id_,
+                            [this](ProcessId sender, const MessageData& message_data) {
+                              HandleRequest(sender, message_data);
+                            });
+}
+ServiceServer::~ServiceServer() { UnregisterMessageHandler(message_id_); }
+ProcessId ServiceServer::ServerProcessId() const { return GetProcessId(); }
 MessageId ServiceServer::ServiceId() const { return message_id_; }
 void ServiceServer::StartServing() {}
 bool ServiceServer::operator<(const ServiceServer& rhs) const { return message_id_ < rhs.message_id_; }
 void ServiceServer::HandleUnknownRequest(ProcessId sender, const MessageData& params) {}
-void ServiceServer::HandleUnexpectedMessageInRequest(ProcessId sender, const MessageData& message) {}
+void ServiceServer::HandleUnexpectedMessageInRequest(ProcessId sender, const MessageData& message) {
+  if (HasInlineParameters(message.metadata) || message.param3 == SIZE_MAX)
+    return;
+  ReleaseRpcParametersFromProcess(sender, GetRpcRequestParameters(message));
+}
 
-// Shared memory helper
-std::shared_ptr<SharedMemory> GetMemoryBufferForSendingToProcess(
-    ProcessId process_id) {
-  return nullptr;
+// RPC memory stubs
+std::optional<RpcParameters> SerializeRpcParametersToProcess(
+    ProcessId process_id, const serialization::Serializable& object) {
+  if (process_id != GetProcessId()) return std::nullopt;
+  if (!rpc_buffer_pool) rpc_buffer_pool = RpcBufferPool::Create();
+  return rpc_buffer_pool->Serialize(object);
 }
 
-std::shared_ptr<SharedMemory> GetMemoryBufferForSendingToProcessRegardlessOfIfInUse(
-    ProcessId process_id, size_t shared_memory_id) {
-  return nullptr;
+void ReleaseRpcParametersToProcess(ProcessId process_id,
+                                   const RpcParameters& parameters) {
+  if (auto* pool = GetRpcBufferPool(parameters.pool_id))
+    pool->Free(parameters);
 }
 
-std::shared_ptr<SharedMemory> GetMemoryBufferForReceivingFromProcess(
-    ProcessId process_id, size_t shared_memory_id) {
-  return nullptr;
+void DeserializeRpcParametersFromProcess(ProcessId process_id,
+                                         const RpcParameters& parameters,
+                                         serialization::Serializable& object) {
+  if (auto* pool = GetRpcBufferPool(parameters.pool_id)) {
+    pool->Deserialize(parameters, object);
+  } else {
+    serialization::DeserializeToEmpty(object);
+  }
 }
 
-void SetMemoryBufferAsReadyForSendingNextMessageToProcess(
-    SharedMemory& shared_memory) {}
+void ReleaseRpcParametersFromProcess(ProcessId process_id,
+                                     const RpcParameters& parameters) {
+  if (auto* pool = GetRpcBufferPool(parameters.pool_id))
+    pool->Free(parameters);
+}
 
 MessageId NotifyOnEachNewServiceInstance(
     std::string_view name,
@@ -18,6 +18,8 @@
 
 #include <vector>
 
+#include "perception/debug.h"
+
 #if !defined(PERCEPTION) || defined(TEST)
 #include <sched.h>
 #include <stdlib.h>
@@ -99,6 +101,9 @@ ThreadId GetThreadId() {
 
 void TerminateThread() {
 #if defined(PERCEPTION) && !defined(TEST)
+  // Print any partial line this thread has buffered.
+  DebugPrinterSingleton.Flush();
+
   register size_t syscall_num asm("rdi") = 4;
   __asm__("syscall\n" ::"r"(syscall_num) : "rcx", "r11");
 #else
@@ -29,6 +29,11 @@
 
 namespace {
 
+// The longest string that can be registered. Longer strings are truncated, so
+// that a REGISTER_STRING packet fits in the 80 characters the kernel prints in
+// one system call and can't be split up by another thread's packets.
+constexpr size_t kMaxTraceStringLength = 76;
+
 // Next available string ID counter.
 uint16 next_string_id = 1;
 
@@ -70,8 +75,7 @@ void SetCurrentTraceContext(const TraceContext& context) {
 }
 
 void EmitTraceBytes(const char* data, size_t size) {
-  DebugPrinter printer(2);
-  for (size_t i = 0; i < size; i++) printer << data[i];
+  DebugPrinter(2).WritePacket(data, size);
 }
 
 uint16 RegisterTraceString(const char* str) {
@@ -85,18 +89,18 @@ uint16 RegisterTraceString(const char* str) {
   string_id_map[key] = str_id;
 
   size_t str_len = key.length();
-  if (str_len > 255) str_len = 255;
+  if (str_len > kMaxTraceStringLength) str_len = kMaxTraceStringLength;
 
   // REGISTER_STRING (opcode 0x01) layout:
   // [0x01: u8][string_id: u16][len: u8][str: N]
-  char packet[4];
+  char packet[4 + kMaxTraceStringLength];
   packet[0] = 0x01;
   packet[1] = static_cast<char>(str_id & 0xFF);
   packet[2] = static_cast<char>((str_id >> 8) & 0xFF);
   packet[3] = static_cast<char>(str_len);
+  std::memcpy(&packet[4], key.data(), str_len);
 
-  EmitTraceBytes(packet, 4);
-  EmitTraceBytes(key.data(), str_len);
+  EmitTraceBytes(packet, 4 + str_len);
   return str_id;
 }
 
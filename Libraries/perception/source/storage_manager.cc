@@ -85,5 +85,14 @@ void GetMountedFileSystemsResponse::Serialize(
   serializer.ArrayOfStrings("mount_points", mount_points);
 }
 
+void PageCacheStatistics::Serialize(serialization::Serializer& serializer) {
+  serializer.Integer("Cached files", cached_files);
+  serializer.Integer("Mapped files", mapped_files);
+  serializer.Integer("Resident pages", resident_pages);
+  serializer.Integer("Hits", hits);
+  serializer.Integer("Misses", misses);
+  serializer.Integer("Evictions", evictions);
+}
+
 }  // namespace perception
 // force rebuild
\ No newline at end of file
@@ -0,0 +1,132 @@
+; The code that application processors start executing when they are woken up.
+; The processors start in 16-bit real mode, so this code is copied into low
+; memory (AP_TRAMPOLINE_ADDRESS in smp.cc) before the processors are started.
+; It switches straight into long mode and jumps into the kernel.
+
+; Where this code gets copied to in physical memory.
+%define AP_TRAMPOLINE_ADDRESS 0x8000
+
+; Converts the address of a label to where it will be once copied.
+%define RELOCATE(label) (label - ApTrampolineStart + AP_TRAMPOLINE_ADDRESS)
+
+; The number of processor entries in the parameters. Must match MAX_CORES in
+; cpu.h.
+%define AP_TRAMPOLINE_MAX_PROCESSORS 8
+
+; The size of each processor entry, and the offsets of its fields.
+%define AP_TRAMPOLINE_PROCESSOR_SIZE 24
+%define AP_TRAMPOLINE_PROCESSOR_LOCAL_APIC_ID 0
+%define AP_TRAMPOLINE_PROCESSOR_STACK 8
+%define AP_TRAMPOLINE_PROCESSOR_CPU 16
+
+[GLOBAL ApTrampolineStart]
+[GLOBAL ApTrampolineEnd]
+[GLOBAL ApTrampolineParameters]
+
+[BITS 16]
+ApTrampolineStart:
+	cli
+	cld
+
+	; Our code segment is AP_TRAMPOLINE_ADDRESS >> 4, but everything below
+	; uses absolute addresses.
+	xor ax, ax
+	mov ds, ax
+
+	; Load our temporary Global Descriptor Table.
+	lgdt [RELOCATE(TrampolineGdtr)]
+
+	; Enable PAE (5) and OSFXSR (9) and OSXMMEXCPT (10) for FPU.
+	mov eax, cr4
+	or eax, (1 << 5) | (1 << 9) | (1 << 10)
+	mov cr4, eax
+
+	; Load the page tables set up by the bootstrap processor.
+	mov eax, [RELOCATE(ApTrampolineParameters.pml4)]
+	mov cr3, eax
+
+	; Enable Load Mode (8), System Call Extensions (0), and No-Execute Enable (11) in the MSR.
+	mov ecx, 0xC0000080
+	rdmsr
+	or eax, (1 << 11) | (1 << 8) | (1)
+	wrmsr
+
+	; Enable paging (31), MP (1) for FPU, and protected mode (0) all at once.
+	mov eax, cr0
+	or eax, (1 << 31) | (1 << 1) | 1
+
+	; Clear EM (2) for FPU.
+	and eax, ~(1 << 2)
+	mov cr0, eax
+
+	; Jump into our 64-bit executable segment.
+	jmp dword 0x08:RELOCATE(ApTrampoline64)
+
+[BITS 64]
+ApTrampoline64:
+	; Point our data segments to the data segment.
+	mov ax, 0x10
+	mov ds, ax
+	mov es, ax
+	mov ss, ax
+	xor ax, ax
+	mov fs, ax
+	mov gs, ax
+
+	; Each processor has its own entry, found by its Local APIC ID (CPUID leaf
+	; 1, EBX bits 24-31), so a processor that wakes up late never picks up
+	; another processor's stack.
+	mov eax, 1
+	cpuid
+	shr ebx, 24
+	mov rsi, RELOCATE(ApTrampolineParameters.processors)
+	mov rcx, AP_TRAMPOLINE_MAX_PROCESSORS
+.FindProcessor:
+	cmp [rsi + AP_TRAMPOLINE_PROCESSOR_LOCAL_APIC_ID], rbx
+	je .FoundProcessor
+	add rsi, AP_TRAMPOLINE_PROCESSOR_SIZE
+	loop .FindProcessor
+
+	; We weren't asked to start.
+.Halt:
+	hlt
+	jmp .Halt
+
+.FoundProcessor:
+	; Move onto the CPU's stack and jump into the kernel, passing the Cpu
+	; structure as the first argument.
+	mov rsp, [rsi + AP_TRAMPOLINE_PROCESSOR_STACK]
+	mov rdi, [rsi + AP_TRAMPOLINE_PROCESSOR_CPU]
+	mov rax, [RELOCATE(ApTrampolineParameters.entry_point)]
+	jmp rax
+
+; Temporary 64-bit Global Descriptor Table. The kernel loads the real one once
+; we're in upper memory.
+align 8
+TrampolineGdt:
+	; Invalid segment
+	DQ 0x0000000000000000 ; 0x0
+	; Kernel code: RW, executable, code/data segment, present, 64-bit, ring 0
+	DQ 0x00209A0000000000 ; 0x8
+	; Kernel data: RW, data, code/data segment, present, ring 0
+	DQ 0x0000920000000000 ; 0x10
+
+; Reference to the temporary Global Descriptor Table.
+TrampolineGdtr:
+	DW 23 ; 24 bytes long
+	DD RELOCATE(TrampolineGdt)
+
+; Filled in by the bootstrap processor. Each processor's entry is written
+; before it is started and never reused. Must match ApTrampolineParameterBlock
+; in ap_trampoline.asm.h.
+align 8
+ApTrampolineParameters:
+.pml4:
+	DQ 0 ; Physical address of the PML4 to start with.
+.entry_point:
+	DQ 0 ; Address of ApplicationProcessorMain.
+.processors:
+	; Local APIC ID, top of the stack to use, and pointer to the Cpu structure.
+	times AP_TRAMPOLINE_MAX_PROCESSORS * AP_TRAMPOLINE_PROCESSOR_SIZE DB 0
+
+ApTrampolineEnd:
@@ -0,0 +1,54 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "cpu.h"
+#include "types.h"
+
+// What ap_trampoline.asm needs to start one processor.
+struct ApTrampolineProcessor {
+  // The Local APIC ID of the processor. Unused entries hold an ID that no
+  // processor has.
+  size_t local_apic_id;
+
+  // Top of the stack to use.
+  size_t stack;
+
+  // Pointer to the CPU's Cpu structure.
+  size_t cpu;
+};
+
+// The values ap_trampoline.asm reads once it is copied into low memory.
+struct ApTrampolineParameterBlock {
+  // Physical address of the PML4 to start with. Must be in the lower 4 GB.
+  size_t pml4;
+
+  // Address of the function to jump to.
+  size_t entry_point;
+
+  // One entry per processor, so a processor that starts late can't pick up
+  // another processor's parameters.
+  ApTrampolineProcessor processors[MAX_CORES];
+};
+
+extern "C" {
+
+// The start and end of the code to copy into low memory. WARNING: These point
+// into the kernel's copy of the code.
+extern char ApTrampolineStart;
+extern char ApTrampolineEnd;
+
+// Where in the kernel's copy of the code the parameters live.
+extern ApTrampolineParameterBlock ApTrampolineParameters;
+
+}  // extern "C"
@@ -0,0 +1,135 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "buddy_allocator.h"
+
+void BuddyAllocator::Initialize(PhysicalPageInfo* pages, size_t page_count) {
+  pages_ = pages;
+  page_count_ = page_count;
+  free_pages_ = 0;
+  for (size_t page = 0; page < page_count; page++) {
+    pages[page].next_free = kNoPhysicalPage;
+    pages[page].previous_free = kNoPhysicalPage;
+    pages[page].order = 0;
+    pages[page].is_free_block = false;
+  }
+  for (int zone = 0; zone < PHYSICAL_MEMORY_ZONES; zone++) {
+    for (int order = 0; order <= MAX_PAGE_ORDER; order++) {
+      free_lists_[zone][order] = kNoPhysicalPage;
+      free_blocks_[zone][order] = 0;
+    }
+  }
+}
+
+size_t BuddyAllocator::Allocate(size_t order, size_t max_page) {
+  if (order > MAX_PAGE_ORDER) return kNoPhysicalPage;
+
+  size_t page = AllocateFromZone((int)PhysicalMemoryZone::NORMAL, order,
+                                 max_page);
+  if (page == kNoPhysicalPage)
+    page = AllocateFromZone((int)PhysicalMemoryZone::DMA32, order, max_page);
+  return page;
+}
+
+void BuddyAllocator::Free(size_t page, size_t order) {
+  free_pages_ += (size_t)1 << order;
+
+  // Keep merging with the buddy while it's free and whole.
+  while (order < MAX_PAGE_ORDER) {
+    size_t buddy = page ^ ((size_t)1 << order);
+    if (buddy >= page_count_) break;
+    PhysicalPageInfo& buddy_info = pages_[buddy];
+    if (!buddy_info.is_free_block || buddy_info.order != order) break;
+    RemoveFreeBlock(buddy);
+    if (buddy < page) page = buddy;
+    order++;
+  }
+  AddFreeBlock(page, order);
+}
+
+void BuddyAllocator::FreeRange(size_t first_page, size_t page_count) {
+  while (page_count > 0) {
+    // Free the largest block that is aligned at this page and fits.
+    size_t order = 0;
+    while (order < MAX_PAGE_ORDER &&
+           (first_page & (((size_t)1 << (order + 1)) - 1)) == 0 &&
+           ((size_t)1 << (order + 1)) <= page_count)
+      order++;
+
+    Free(first_page, order);
+    first_page += (size_t)1 << order;
+    page_count -= (size_t)1 << order;
+  }
+}
+
+int BuddyAllocator::LargestFreeOrder() const {
+  for (int order = MAX_PAGE_ORDER; order >= 0; order--) {
+    for (int zone = 0; zone < PHYSICAL_MEMORY_ZONES; zone++) {
+      if (free_blocks_[zone][order] > 0) return order;
+    }
+  }
+  return -1;
+}
+
+void BuddyAllocator::AddFreeBlock(size_t page, size_t order) {
+  int zone = ZoneOfPage(page);
+  PhysicalPageInfo& info = pages_[page];
+  info.order = order;
+  info.is_free_block = true;
+  info.previous_free = kNoPhysicalPage;
+  info.next_free = free_lists_[zone][order];
+  if (info.next_free != kNoPhysicalPage)
+    pages_[info.next_free].previous_free = page;
+  free_lists_[zone][order] = page;
+  free_blocks_[zone][order]++;
+}
+
+void BuddyAllocator::RemoveFreeBlock(size_t page) {
+  PhysicalPageInfo& info = pages_[page];
+  int zone = ZoneOfPage(page);
+  if (info.previous_free == kNoPhysicalPage)
+    free_lists_[zone][info.order] = info.next_free;
+  else
+    pages_[info.previous_free].next_free = info.next_free;
+  if (info.next_free != kNoPhysicalPage)
+    pages_[info.next_free].previous_free = info.previous_free;
+  free_blocks_[zone][info.order]--;
+  info.is_free_block = false;
+  info.next_free = kNoPhysicalPage;
+  info.previous_free = kNoPhysicalPage;
+}
+
+size_t BuddyAllocator::AllocateFromZone(int zone, size_t order,
+                                        size_t max_page) {
+  size_t last_page_offset = ((size_t)1 << order) - 1;
+  for (size_t block_order = order; block_order <= MAX_PAGE_ORDER;
+       block_order++) {
+    // Blocks are split by keeping the lower half, so the block only has to
+    // start low enough for the requested order to fit below max_page.
+    for (size_t page = free_lists_[zone][block_order]; page != kNoPhysicalPage;
+         page = pages_[page].next_free) {
+      if (page + last_page_offset > max_page) continue;
+
+      RemoveFreeBlock(page);
+      // Split the block, returning the upper halves to the free lists.
+      while (block_order > order) {
+        block_order--;
+        AddFreeBlock(page + ((size_t)1 << block_order), block_order);
+      }
+      free_pages_ -= (size_t)1 << order;
+      return page;
+    }
+  }
+  return kNoPhysicalPage;
+}
@@ -0,0 +1,125 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "types.h"
+
+// The largest order of block the buddy allocator tracks. Blocks of order N
+// are 2^N pages long, so the largest block is 4 MB.
+#define MAX_PAGE_ORDER 10
+
+// The number of pages below 4 GB. Pages under this are in the DMA32 zone, and
+// they're kept apart from the rest of memory so that they're only handed out to
+// callers that need them after the normal zone runs out.
+#define DMA32_ZONE_PAGES (1ULL << 20)
+
+// The zones that physical memory is divided into.
+enum class PhysicalMemoryZone {
+  // Memory below 4 GB, which 32-bit DMA devices can address.
+  DMA32 = 0,
+  // Memory at or above 4 GB.
+  NORMAL = 1
+};
+
+// The number of zones in PhysicalMemoryZone.
+#define PHYSICAL_MEMORY_ZONES 2
+
+// Value for when there is no page.
+constexpr size_t kNoPhysicalPage = 0xFFFFFFFF;
+
+// Metadata kept for each page of physical memory.
+struct PhysicalPageInfo {
+  // If this page is the first page of a free block, the next and previous
+  // free blocks of the same order and zone. kNoPhysicalPage terminates the
+  // list.
+  uint32 next_free;
+  uint32 previous_free;
+
+  // If this is the first page of a free block, the order of the block.
+  uint8 order;
+
+  // Is this the first page of a free block?
+  bool is_free_block;
+};
+
+// A buddy allocator that hands out blocks of 2^order physical pages. It only
+// deals in page numbers (physical address / PAGE_SIZE) and keeps all of its
+// state in a PhysicalPageInfo array, so it never has to map the pages it
+// manages.
+class BuddyAllocator {
+ public:
+  // Sets up the allocator to manage `page_count` pages, using `pages` (which
+  // must be `page_count` entries long) as metadata. All pages start off as
+  // allocated.
+  void Initialize(PhysicalPageInfo* pages, size_t page_count);
+
+  // Allocates a block of 2^order pages that ends at or below `max_page`.
+  // The normal zone is preferred over the DMA32 zone. Returns the first page
+  // of the block, or kNoPhysicalPage if there is no free block that fits.
+  size_t Allocate(size_t order, size_t max_page);
+
+  // Frees a block of 2^order pages that was returned from Allocate(), merging
+  // it with its buddies.
+  void Free(size_t page, size_t order);
+
+  // Frees a range of pages that don't need to be aligned to a block, such as
+  // the free memory reported at boot or the unused tail of a block.
+  void FreeRange(size_t first_page, size_t page_count);
+
+  // Returns the number of free pages.
+  size_t FreePages() const { return free_pages_; }
+
+  // Returns the number of free blocks of the order in the zone.
+  size_t FreeBlocks(PhysicalMemoryZone zone, size_t order) const {
+    return free_blocks_[(int)zone][order];
+  }
+
+  // Returns the largest order that has a free block, or -1 if there is no
+  // free memory.
+  int LargestFreeOrder() const;
+
+ private:
+  // Returns the zone that a page belongs to. Buddies of MAX_PAGE_ORDER or
+  // lower never straddle the 4 GB boundary, so a block's zone is the zone of
+  // its first page.
+  static int ZoneOfPage(size_t page) {
+    return page < DMA32_ZONE_PAGES ? (int)PhysicalMemoryZone::DMA32
+                                   : (int)PhysicalMemoryZone::NORMAL;
+  }
+
+  // Adds a free block to the front of its free list.
+  void AddFreeBlock(size_t page, size_t order);
+
+  // Removes a free block from its free list.
+  void RemoveFreeBlock(size_t page);
+
+  // Allocates a block from a zone, or returns kNoPhysicalPage.
+  size_t AllocateFromZone(int zone, size_t order, size_t max_page);
+
+  // Metadata for each page.
+  PhysicalPageInfo* pages_;
+
+  // The number of pages being managed.
+  size_t page_count_;
+
+  // The first free block of each zone and order.
+  uint32 free_lists_[PHYSICAL_MEMORY_ZONES][MAX_PAGE_ORDER + 1];
+
+  // The number of free blocks of each zone and order.
+  size_t free_blocks_[PHYSICAL_MEMORY_ZONES][MAX_PAGE_ORDER + 1];
+
+  // The total number of free pages.
+  size_t free_pages_;
+};
@@ -0,0 +1,215 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "buddy_allocator.h"
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include "testing.h"
+
+namespace {
+
+// A buddy allocator along with the metadata it manages.
+struct TestBuddyAllocator {
+  explicit TestBuddyAllocator(size_t page_count) : pages(page_count) {
+    allocator.Initialize(pages.data(), page_count);
+  }
+
+  std::vector<PhysicalPageInfo> pages;
+  BuddyAllocator allocator;
+};
+
+// Returns the number of free blocks of an order across both zones.
+size_t FreeBlocksOfOrder(const BuddyAllocator& allocator, size_t order) {
+  return allocator.FreeBlocks(PhysicalMemoryZone::DMA32, order) +
+         allocator.FreeBlocks(PhysicalMemoryZone::NORMAL, order);
+}
+
+// Returns the number of nanoseconds since `start`.
+double NanosecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+}  // namespace
+
+TEST(BuddyAllocatorSplitAndMergeTest) {
+  TestBuddyAllocator buddy(1024);
+  buddy.allocator.FreeRange(0, 1024);
+  ASSERT(buddy.allocator.FreePages(), (size_t)1024);
+  ASSERT(FreeBlocksOfOrder(buddy.allocator, MAX_PAGE_ORDER), (size_t)1);
+
+  // Taking a single page splits the block all the way down.
+  ASSERT(buddy.allocator.Allocate(0, 1023), (size_t)0);
+  ASSERT(buddy.allocator.FreePages(), (size_t)1023);
+  ASSERT(FreeBlocksOfOrder(buddy.allocator, MAX_PAGE_ORDER), (size_t)0);
+  for (size_t order = 0; order < MAX_PAGE_ORDER; order++)
+    ASSERT(FreeBlocksOfOrder(buddy.allocator, order), (size_t)1);
+
+  // The next pages come from the smallest blocks.
+  ASSERT(buddy.allocator.Allocate(0, 1023), (size_t)1);
+  ASSERT(buddy.allocator.Allocate(1, 1023), (size_t)2);
+
+  // Freeing everything merges back into a single block.
+  buddy.allocator.Free(1, 0);
+  buddy.allocator.Free(0, 0);
+  ASSERT(FreeBlocksOfOrder(buddy.allocator, MAX_PAGE_ORDER), (size_t)0);
+  buddy.allocator.Free(2, 1);
+  ASSERT(FreeBlocksOfOrder(buddy.allocator, MAX_PAGE_ORDER), (size_t)1);
+  ASSERT(buddy.allocator.LargestFreeOrder(), MAX_PAGE_ORDER);
+}
+
+TEST(BuddyAllocatorFreeRangeTest) {
+  TestBuddyAllocator buddy(64);
+  // 3, 4-7, 8-11, 12.
+  buddy.allocator.FreeRange(3, 10);
+  ASSERT(buddy.allocator.FreePages(), (size_t)10);
+  ASSERT(FreeBlocksOfOrder(buddy.allocator, 0), (size_t)2);
+  ASSERT(FreeBlocksOfOrder(buddy.allocator, 1), (size_t)0);
+  ASSERT(FreeBlocksOfOrder(buddy.allocator, 2), (size_t)2);
+  ASSERT(buddy.allocator.LargestFreeOrder(), 2);
+
+  // There's no run of 8 free pages.
+  ASSERT(buddy.allocator.Allocate(3, 63), kNoPhysicalPage);
+
+  // Freeing the pages around the range joins it into larger blocks.
+  buddy.allocator.FreeRange(0, 3);
+  buddy.allocator.FreeRange(13, 51);
+  ASSERT(buddy.allocator.FreePages(), (size_t)64);
+  ASSERT(FreeBlocksOfOrder(buddy.allocator, 6), (size_t)1);
+}
+
+TEST(BuddyAllocatorMaxPageTest) {
+  TestBuddyAllocator buddy(2048);
+  buddy.allocator.FreeRange(0, 2048);
+
+  size_t page = buddy.allocator.Allocate(3, 15);
+  ASSERT(page != kNoPhysicalPage, true);
+  ASSERT(page + 7 <= 15, true);
+
+  page = buddy.allocator.Allocate(2, 15);
+  ASSERT(page != kNoPhysicalPage, true);
+  ASSERT(page + 3 <= 15, true);
+
+  // Only 4 pages below page 16 are left, so 8 can't fit.
+  ASSERT(buddy.allocator.Allocate(3, 15), kNoPhysicalPage);
+
+  // Orders that are too large are rejected.
+  ASSERT(buddy.allocator.Allocate(MAX_PAGE_ORDER + 1, 2047), kNoPhysicalPage);
+}
+
+TEST(BuddyAllocatorZonesTest) {
+  TestBuddyAllocator buddy(DMA32_ZONE_PAGES + 1024);
+  buddy.allocator.FreeRange(DMA32_ZONE_PAGES - 1024, 2048);
+  ASSERT(buddy.allocator.FreeBlocks(PhysicalMemoryZone::DMA32, MAX_PAGE_ORDER),
+         (size_t)1);
+  ASSERT(buddy.allocator.FreeBlocks(PhysicalMemoryZone::NORMAL, MAX_PAGE_ORDER),
+         (size_t)1);
+
+  // The normal zone is used first.
+  size_t page = buddy.allocator.Allocate(0, DMA32_ZONE_PAGES + 1023);
+  ASSERT(page >= DMA32_ZONE_PAGES, true);
+
+  // Unless only DMA32 memory will do.
+  page = buddy.allocator.Allocate(0, DMA32_ZONE_PAGES - 1);
+  ASSERT(page < DMA32_ZONE_PAGES, true);
+
+  // Once the normal zone is empty, the DMA32 zone is used.
+  for (size_t i = 0; i < 1023; i++)
+    ASSERT(buddy.allocator.Allocate(0, DMA32_ZONE_PAGES + 1023) >=
+               DMA32_ZONE_PAGES,
+           true);
+  page = buddy.allocator.Allocate(0, DMA32_ZONE_PAGES + 1023);
+  ASSERT(page < DMA32_ZONE_PAGES, true);
+}
+
+// Measures allocation and free throughput, and how fragmented memory is after
+// a random workload. This prints its results rather than asserting on them.
+TEST(BuddyAllocatorBenchmark) {
+  constexpr size_t kPageCount = 1 << 18;  // 1 GB of memory.
+  TestBuddyAllocator buddy(kPageCount);
+  buddy.allocator.FreeRange(0, kPageCount);
+
+  // Single page allocations, which are what the hot page caches refill with.
+  constexpr int kRounds = 8;
+  std::vector<size_t> pages(kPageCount);
+  auto start = std::chrono::steady_clock::now();
+  for (int round = 0; round < kRounds; round++) {
+    for (size_t i = 0; i < kPageCount; i++)
+      pages[i] = buddy.allocator.Allocate(0, kPageCount - 1);
+    for (size_t i = 0; i < kPageCount; i++) buddy.allocator.Free(pages[i], 0);
+  }
+  double nanoseconds = NanosecondsSince(start);
+  std::cout << "Single pages: "
+            << nanoseconds / (2.0 * kRounds * kPageCount)
+            << " ns per allocation or free" << std::endl;
+  ASSERT(buddy.allocator.FreePages(), kPageCount);
+  ASSERT(FreeBlocksOfOrder(buddy.allocator, MAX_PAGE_ORDER),
+         kPageCount >> MAX_PAGE_ORDER);
+
+  // A random mix of orders 0 to 4, keeping around half of memory allocated.
+  struct Allocation {
+    size_t page;
+    size_t order;
+  };
+  std::vector<Allocation> allocations;
+  uint64 random = 0x2545F4914F6CDD1D;
+  auto next_random = [&random]() {
+    random ^= random << 13;
+    random ^= random >> 7;
+    random ^= random << 17;
+    return random;
+  };
+  constexpr size_t kOperations = 1 << 20;
+  size_t failed_allocations = 0;
+  start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < kOperations; i++) {
+    if (!allocations.empty() &&
+        (buddy.allocator.FreePages() < kPageCount / 2 ||
+         next_random() % 3 == 0)) {
+      size_t index = next_random() % allocations.size();
+      buddy.allocator.Free(allocations[index].page, allocations[index].order);
+      allocations[index] = allocations.back();
+      allocations.pop_back();
+    } else {
+      size_t order = next_random() % 5;
+      size_t page = buddy.allocator.Allocate(order, kPageCount - 1);
+      if (page == kNoPhysicalPage)
+        failed_allocations++;
+      else
+        allocations.push_back({page, order});
+    }
+  }
+  nanoseconds = NanosecondsSince(start);
+  std::cout << "Mixed orders: " << nanoseconds / kOperations
+            << " ns per operation, " << failed_allocations
+            << " failed allocations" << std::endl;
+
+  std::cout << "Fragmentation with " << buddy.allocator.FreePages()
+            << " free pages: largest free order "
+            << buddy.allocator.LargestFreeOrder() << ", free blocks by order:";
+  for (size_t order = 0; order <= MAX_PAGE_ORDER; order++)
+    std::cout << " " << FreeBlocksOfOrder(buddy.allocator, order);
+  std::cout << std::endl;
+
+  // Everything merges back once it's all freed.
+  for (const Allocation& allocation : allocations)
+    buddy.allocator.Free(allocation.page, allocation.order);
+  ASSERT(buddy.allocator.FreePages(), kPageCount);
+  ASSERT(FreeBlocksOfOrder(buddy.allocator, MAX_PAGE_ORDER),
+         kPageCount >> MAX_PAGE_ORDER);
+}
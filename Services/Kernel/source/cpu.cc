@@ -0,0 +1,177 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "cpu.h"
+
+#include "io.h"
+#include "local_apic.h"
+#include "scheduler.h"
+#include "timer.h"
+#include "virtual_address_space.h"
+#include "virtual_allocator.h"
+
+// All of the CPUs. Indexed by Cpu::id.
+Cpu cpus[MAX_CORES];
+
+// The number of slots in `cpus` that have been used. This includes CPUs that
+// didn't start in time, because their slots are never reused.
+size_t online_cpu_count;
+
+namespace {
+
+// The model specific register that stores the GS segment's base address.
+#define GSBASE_MSR 0xC0000101
+
+// The kernel isn't reentrant, so only one CPU may be in the kernel at a time.
+// This is the CPU holding the kernel, or nullptr if no CPU is.
+Cpu* volatile kernel_lock_holder;
+
+// Incremented each time a page table entry is removed or downgraded. CPUs
+// compare this against Cpu::tlb_generation when they enter the kernel to know
+// if they need to flush their TLB.
+volatile size_t tlb_generation;
+
+// Spins until this CPU holds the kernel lock. Returns false if this CPU
+// already held the lock, which happens if the kernel itself faults.
+bool AcquireKernelLock(Cpu* cpu) {
+  if (kernel_lock_holder == cpu) return false;
+  Cpu* expected = nullptr;
+  while (!__atomic_compare_exchange_n(&kernel_lock_holder, &expected, cpu,
+                                      /*weak=*/false, __ATOMIC_ACQUIRE,
+                                      __ATOMIC_RELAXED)) {
+    expected = nullptr;
+    while (kernel_lock_holder != nullptr) {
+#ifndef TEST
+      asm volatile("pause");
+#endif
+    }
+  }
+  return true;
+}
+
+// Releases the kernel lock.
+void ReleaseKernelLock() {
+  __atomic_store_n(&kernel_lock_holder, nullptr, __ATOMIC_RELEASE);
+}
+
+}  // namespace
+
+void InitializeBootCpu() {
+  Cpu* cpu = &cpus[0];
+  cpu->self = cpu;
+  cpu->id = 0;
+  cpu->current_thread = nullptr;
+  cpu->current_registers = &cpu->idle_registers;
+  cpu->current_address_space = nullptr;
+  cpu->startup_state = CpuStartupState::Started;
+  cpu->is_online = true;
+  online_cpu_count = 1;
+  LoadCpuSegment(cpu);
+
+  // The bootstrap processor runs kmain() inside of the kernel.
+  cpu->is_in_kernel = true;
+  AcquireKernelLock(cpu);
+}
+
+void LoadCpuSegment(Cpu* cpu) {
+  WriteModelSpecificRegister(GSBASE_MSR, (size_t)cpu);
+}
+
+extern "C" bool EnterKernel() {
+  Cpu* cpu = GetCurrentCpu();
+  cpu->is_in_kernel = true;
+  if (!AcquireKernelLock(cpu)) return false;
+
+  if (cpu->current_thread_was_evicted) {
+    // Our thread was destroyed while we were waiting. Switch out of its address
+    // space before flushing the TLB, because the address space might be gone.
+    cpu->current_thread_was_evicted = false;
+    ScheduleNextThread();
+    MaybeFlushStaleTlb(cpu);
+    return true;
+  }
+
+  MaybeFlushStaleTlb(cpu);
+  return false;
+}
+
+extern "C" void ExitKernel() {
+  Cpu* cpu = GetCurrentCpu();
+  cpu->is_in_kernel = false;
+  ReleaseKernelLock();
+}
+
+void WaitForCpuToEnterKernel(Cpu* cpu) {
+  if (cpu == GetCurrentCpu() || cpu->is_in_kernel) return;
+  SendInterprocessorInterruptToCpu(cpu);
+  while (!cpu->is_in_kernel) {
+#ifndef TEST
+    asm volatile("pause");
+#endif
+  }
+}
+
+void SendInterprocessorInterruptToCpu(Cpu* cpu) {
+  if (cpu == GetCurrentCpu()) return;
+#ifndef TEST
+  SendInterprocessorInterrupt(cpu->local_apic_id, INTERPROCESSOR_INTERRUPT);
+#endif
+}
+
+void RequestRescheduleOnCpu(Cpu* cpu) {
+  if (cpu == GetCurrentCpu()) {
+    ScheduleNextThread();
+    return;
+  }
+  cpu->reschedule_requested = true;
+  SendInterprocessorInterruptToCpu(cpu);
+}
+
+void HandleInterprocessorInterrupt() {
+  Cpu* cpu = GetCurrentCpu();
+  if (cpu->reschedule_requested) {
+    cpu->reschedule_requested = false;
+    ScheduleNextThread();
+  }
+  ReprogramTimerForNextDeadline();
+}
+
+void FlushTlbOnOtherCpus(VirtualAddressSpace* address_space) {
+  if (online_cpu_count <= 1) return;
+  // Every other CPU will flush its TLB before it next touches kernel memory.
+  __atomic_fetch_add(&tlb_generation, 1, __ATOMIC_RELEASE);
+
+  // Kernel memory is only touched from inside the kernel, but the user space
+  // memory could be in use right now by other CPUs, so make them enter the
+  // kernel.
+  if (address_space == nullptr) return;
+  Cpu* this_cpu = GetCurrentCpu();
+  ForEachOnlineCpu([&](Cpu* cpu) {
+    if (cpu != this_cpu && cpu->current_address_space == address_space)
+      WaitForCpuToEnterKernel(cpu);
+  });
+}
+
+void MaybeFlushStaleTlb(Cpu* cpu) {
+  if (cpu->tlb_generation == tlb_generation) return;
+#ifndef TEST
+  // Reloading CR3 flushes the TLB.
+  size_t cr3;
+  asm volatile("mov %%cr3, %0" : "=r"(cr3));
+  asm volatile("mov %0, %%cr3" ::"r"(cr3) : "memory");
+#endif
+  MarkTlbAsFlushed(cpu);
+}
+
+void MarkTlbAsFlushed(Cpu* cpu) { cpu->tlb_generation = tlb_generation; }
@@ -0,0 +1,186 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "registers.h"
+#include "types.h"
+
+// The maximum number of CPU cores the kernel will bring online.
+#define MAX_CORES 8
+
+// The number of slots that TemporarilyMapPhysicalPages can map into.
+#define TEMPORARY_MAPPING_SLOTS 512
+
+struct Thread;
+class VirtualAddressSpace;
+
+// How far an application processor has got in starting up.
+enum class CpuStartupState : uint8 {
+  // The CPU has been woken up but hasn't finished initializing itself.
+  Starting,
+  // The CPU is running kernel code.
+  Started,
+  // The bootstrap processor gave up waiting for this CPU. If it starts late,
+  // it halts forever.
+  Abandoned
+};
+
+// State that is private to each CPU core. While in the kernel, the GS segment
+// points to the CPU's structure. The first 5 fields are accessed from assembly
+// (syscall.asm, interrupts.asm, exceptions.asm) so their offsets must not
+// change.
+struct Cpu {
+  // Pointer to this structure, so the kernel can find it via GS:0.
+  Cpu* self;  // GS:0
+
+  // The registers of whatever is executing on this CPU. When a thread is
+  // interrupted, this is where its registers are saved to.
+  Registers* current_registers;  // GS:8
+
+  // The top of this CPU's interrupt stack.
+  size_t interrupt_stack_top;  // GS:16
+
+  // Temporary place for syscall_entry to put the user's stack pointer.
+  size_t user_stack_pointer;  // GS:24
+
+  // The thread currently executing on this CPU. This can be nullptr if the CPU
+  // is idle.
+  Thread* current_thread;  // GS:32
+
+  // The index of this CPU. The bootstrap processor is always 0.
+  size_t id;
+
+  // The ID of this CPU's Local APIC.
+  uint32 local_apic_id;
+
+  // Has this CPU finished starting up and is it able to run threads?
+  volatile bool is_online;
+
+  // Has the CPU started running kernel code after being woken up? Only
+  // changed with atomic operations, because the bootstrap processor and a late
+  // starting application processor can race to change it.
+  CpuStartupState startup_state;
+
+  // Is this CPU inside of the kernel (either holding the kernel lock or waiting
+  // to acquire it)?
+  volatile bool is_in_kernel;
+
+  // Set if another CPU took this CPU's thread away (because it was destroyed)
+  // while this CPU was waiting to enter the kernel.
+  volatile bool current_thread_was_evicted;
+
+  // Set if another CPU wants this CPU to schedule the next thread.
+  volatile bool reschedule_requested;
+
+  // The TLB generation this CPU has flushed up to.
+  size_t tlb_generation;
+
+  // The virtual address space that this CPU is currently in.
+  VirtualAddressSpace* current_address_space;
+
+  // The physical address of the PML4 loaded into CR3.
+  size_t loaded_pml4;
+
+  // The physical address of a PML4 to free once this CPU has switched away
+  // from it. This is set when an address space is destroyed while this CPU
+  // was still in it.
+  size_t pml4_to_free_after_switching;
+
+  // The registers to use when this CPU is idle.
+  Registers idle_registers;
+
+  // This CPU's task state segment.
+  uint32* tss;
+
+  // This CPU's global descriptor table.
+  uint64* gdt;
+
+  // The page table entries this CPU last mapped into each slot of the
+  // temporary page table. This lets TemporarilyMapPhysicalPages know if this
+  // CPU's TLB might be stale because another CPU reused a slot.
+  size_t temporary_mappings[TEMPORARY_MAPPING_SLOTS];
+};
+
+// All of the CPUs. Indexed by Cpu::id.
+extern Cpu cpus[MAX_CORES];
+
+// The number of slots in `cpus` that have been used. This includes CPUs that
+// didn't start in time, because their slots are never reused.
+extern size_t online_cpu_count;
+
+// Returns the CPU that is running this code.
+inline Cpu* GetCurrentCpu() {
+#ifdef TEST
+  return &cpus[0];
+#else
+  Cpu* cpu;
+  // Not volatile, because the kernel never moves between CPUs, so the compiler
+  // is free to reuse the result.
+  __asm__("mov %%gs:0, %0" : "=r"(cpu));
+  return cpu;
+#endif
+}
+
+// Initializes the bootstrap processor's Cpu structure and enters the kernel on
+// it. Must be called before anything uses GetCurrentCpu().
+void InitializeBootCpu();
+
+// Points GS at the Cpu structure. Must be called on the CPU itself.
+void LoadCpuSegment(Cpu* cpu);
+
+// Called by the assembly stubs after they have saved the registers of whatever
+// was interrupted, before they call into the rest of the kernel. Waits for
+// other CPUs to leave the kernel. Returns true if the thread that was running
+// on this CPU was taken away while waiting, in which case there is nothing to
+// return to and the caller should JumpIntoThread().
+extern "C" bool EnterKernel();
+
+// Called when leaving the kernel to let other CPUs into the kernel.
+extern "C" void ExitKernel();
+
+// Interrupts a CPU that isn't in the kernel and waits until it enters the
+// kernel. The CPU is then stuck waiting for us to exit the kernel, so it's
+// safe to modify what it's running.
+void WaitForCpuToEnterKernel(Cpu* cpu);
+
+// Interrupts a CPU without waiting for it. The CPU will reprogram its timer
+// and, if requested, schedule the next thread.
+void SendInterprocessorInterruptToCpu(Cpu* cpu);
+
+// Asks a CPU to schedule the next thread.
+void RequestRescheduleOnCpu(Cpu* cpu);
+
+// Handles the interrupt another CPU sends to get our attention.
+void HandleInterprocessorInterrupt();
+
+// Makes sure no CPU has a stale TLB entry after a page table entry was removed
+// or downgraded in `address_space`. Pass nullptr for kernel memory. The
+// current CPU's TLB must be flushed by the caller.
+void FlushTlbOnOtherCpus(VirtualAddressSpace* address_space);
+
+// Flushes this CPU's TLB if another CPU has changed the page tables since it
+// last flushed.
+void MaybeFlushStaleTlb(Cpu* cpu);
+
+// Records that this CPU's TLB was just flushed, such as by loading CR3.
+void MarkTlbAsFlushed(Cpu* cpu);
+
+// Calls `on_each_cpu` for each online CPU.
+template <class F>
+void ForEachOnlineCpu(const F& on_each_cpu) {
+  for (size_t i = 0; i < MAX_CORES; i++) {
+    if (cpus[i].is_online) on_each_cpu(&cpus[i]);
+  }
+}
@@ -21,6 +21,7 @@ namespace std {
 
 void terminate() {
   print << "std::terminate() called in kernel.\n";
+  FlushPrinter();
   asm volatile("hlt");
 }
 
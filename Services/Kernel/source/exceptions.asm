@@ -13,6 +13,12 @@
 ; limitations under the License.
 
 [BITS 64]
+
+; Offsets of fields in the Cpu structure (cpu.h). While in the kernel, GS points
+; to the Cpu structure of the CPU we are running on.
+%define CPU_CURRENT_REGISTERS 8
+%define CPU_INTERRUPT_STACK_TOP 16
+
 [GLOBAL isr0]
 [GLOBAL isr1]
 [GLOBAL isr2]
@@ -46,9 +52,8 @@
 [GLOBAL isr30]
 [GLOBAL isr31]
 
-[EXTERN currently_executing_thread_regs]
+[EXTERN EnterKernel]
 [EXTERN ExceptionHandler]
-[EXTERN interrupt_stack_top]
 [EXTERN JumpIntoThread]
 [EXTERN ProfileEnteringKernelSpaceForException]
 [EXTERN profiling_enabling_count]
@@ -272,13 +277,19 @@ isr31:
     jmp exception_common_stub
 
 exception_common_stub:
+    ; If the exception came from user space, point GS to this CPU's structure.
+    test qword [rsp + 24], 3 ; cs
+    jz .gs_is_kernel
+    swapgs
+.gs_is_kernel:
+
     ; Copy what's at the top of the thread's stack.
     push rbp
     push rdi ; Using to keep the interrupt number.
     push rdx ; Using to keep the error code.
 
     ; Move these values out of the interrupt handler
-    mov rbp, [currently_executing_thread_regs]
+    mov rbp, [gs:CPU_CURRENT_REGISTERS]
     test rbp, rbp
     jz .no_current_thread
 
@@ -294,7 +305,7 @@ exception_common_stub:
     pop qword [rbp + 19 * 8] ; ss
 
     ; Point our stack to the top of isr_regs, minus the registers already saved.
-    mov rsp, [currently_executing_thread_regs]
+    mov rsp, [gs:CPU_CURRENT_REGISTERS]
     add rsp, 13 * 8
 
     ; Push the rest of the registers.
@@ -313,13 +324,24 @@ exception_common_stub:
     push r15
 
     ; Move back to the interrupt's stack.
-    mov rsp, [interrupt_stack_top]
+    mov rsp, [gs:CPU_INTERRUPT_STACK_TOP]
 
     ; Move to kernel land data segment
     mov ax, 0x10
     mov ds, ax
     mov es, ax
 
+    ; Wait for any other CPU to leave the kernel. If our thread was destroyed
+    ; while waiting, there's nothing to handle the exception for.
+    push rdi
+    push rdx
+    mov rax, EnterKernel
+    call rax
+    pop rdx
+    pop rdi
+    test al, al
+    jnz JumpIntoThread
+
     ; Jump over profiling code if profiler isn't enabled.
     pushfq
     mov r8, [profiling_enabling_count]
@@ -354,7 +376,7 @@ exception_common_stub:
 .no_current_thread:
     mov rdi, [rsp + 24] ; exception number
     mov rdx, [rsp + 32] ; error code
-    mov rsp, [interrupt_stack_top]
+    mov rsp, [gs:CPU_INTERRUPT_STACK_TOP]
     mov rsi, cr2
     mov rax, ExceptionHandler
     call rax
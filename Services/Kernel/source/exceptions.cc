@@ -41,13 +41,12 @@ constexpr bool kCoreDumpOnException = true;
 
 void PrintException(bool in_kernel, int exception_no, size_t cr2,
                     size_t error_code) {
-  ScopedPrintSource source(in_kernel ? 0 : running_thread->process->pid,
-                           in_kernel ? "Kernel" : running_thread->process->name,
-                           1);
+  Thread* thread = GetRunningThread();
+  ScopedPrintSource source(in_kernel ? 0 : thread->process->pid,
+                           in_kernel ? "Kernel" : thread->process->name, 1);
 
   if (kCoreDumpOnException && !in_kernel) {
-    PrintCoreDump(running_thread->process, running_thread, exception_no, cr2,
-                  error_code);
+    PrintCoreDump(thread->process, thread, exception_no, cr2, error_code);
   }
   Exception exception = static_cast<Exception>(exception_no);
   // Output the exception that occured.
@@ -63,10 +62,10 @@ void PrintException(bool in_kernel, int exception_no, size_t cr2,
   if (in_kernel) {
     print << " in kernel";
   } else {
-    Process *process = running_thread->process;
+    Process *process = GetRunningThread()->process;
     print << " by PID " << process->pid << " (" << process->name << ") in TID "
-          << running_thread->id;
-    if (running_thread->in_syscall) print << " (during syscall)";
+          << GetRunningThread()->id;
+    if (GetRunningThread()->in_syscall) print << " (during syscall)";
   }
 
   if (exception == Exception::PageFault) {
@@ -78,7 +77,7 @@ void PrintException(bool in_kernel, int exception_no, size_t cr2,
     // Print the free address ranges to help debug what's happening.
     VirtualAddressSpace &address_space =
         in_kernel ? KernelAddressSpace()
-                  : running_thread->process->virtual_address_space;
+                  : GetRunningThread()->process->virtual_address_space;
     address_space.PrintFreeAddressRanges();
   }
 }
@@ -168,24 +167,35 @@ const char *GetExceptionName(Exception exception) {
 
 // Exits QEMU. Requires staring QEMU with:
 //   -device isa-debug-exit,iobase=0xf4,iosize=0x04.
-void ExitQemu() { WriteIOByte(0xf4, 0x10); }
+void ExitQemu() {
+  FlushPrinter();
+  WriteIOByte(0xf4, 0x10);
+}
 
 // The exception handler.
 extern "C" void ExceptionHandler(int exception_no, size_t cr2,
                                  size_t error_code) {
   Exception exception = static_cast<Exception>(exception_no);
-  if (exception == Exception::PageFault && running_thread != nullptr) {
-    if (MaybeHandleSharedMessagePageFault(cr2)) {
-      if (running_thread == nullptr) {
+  if (exception == Exception::PageFault && GetRunningThread() != nullptr) {
+    // Bit 0 of the error code is set if the page is present, and bit 1 is set
+    // when writing.
+    bool is_present_page = (error_code & 1) == 1;
+    bool is_write_to_present_page = (error_code & 3) == 3;
+    if ((!is_present_page &&
+         GetRunningThread()->process->virtual_address_space
+             .MaybeAllocateLazilyZeroedPage(cr2)) ||
+        (is_write_to_present_page && MaybeHandleCopyOnWritePageFault(cr2)) ||
+        MaybeHandleSharedMessagePageFault(cr2)) {
+      if (GetRunningThread() == nullptr) {
         ScheduleNextThread();
       }
       JumpIntoThread(); // Doesn't return.
     }
   }
 
-  bool in_kernel = currently_executing_thread_regs == nullptr ||
-                   running_thread == nullptr ||
-                   ((currently_executing_thread_regs->cs & 3) == 0);
+  bool in_kernel = GetCurrentThreadRegisters() == nullptr ||
+                   GetRunningThread() == nullptr ||
+                   ((GetCurrentThreadRegisters()->cs & 3) == 0);
   PrintException(in_kernel, exception_no, cr2, error_code);
 
 #ifdef QUIT_QEMU_ON_ANY_EXCEPTION
@@ -198,7 +208,7 @@ extern "C" void ExceptionHandler(int exception_no, size_t cr2,
     asm volatile("hlt");
   } else {
     // Terminate the process.
-    DestroyProcess(running_thread->process);
+    DestroyProcess(GetRunningThread()->process);
     if (!AreAnyProcessesRunning()) {
       print << "All processes terminated.\n";
       ExitQemu();
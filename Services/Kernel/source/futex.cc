@@ -0,0 +1,259 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "futex.h"
+
+#include "linked_list.h"
+#include "physical_allocator.h"
+#include "process.h"
+#include "scheduler.h"
+#include "shared_memory.h"
+#include "thread.h"
+#include "timer.h"
+#include "virtual_allocator.h"
+
+namespace {
+
+// The number of wait queues. Waiters are spread between them by hashing their
+// key, so that waking a busy word doesn't walk past everybody else's waiters.
+constexpr size_t kFutexBuckets = 256;
+
+// The temporary mapping slot used to read words.
+constexpr size_t kFutexTemporaryMappingIndex = 1;
+
+// Threads waiting on a futex, hashed by their key. Each bucket is in the order
+// the threads started waiting.
+LinkedList<Thread, &Thread::node_in_futex_queue> futex_buckets[kFutexBuckets];
+
+// Returns the bucket for a key.
+LinkedList<Thread, &Thread::node_in_futex_queue>& BucketForKey(
+    const FutexKey& key) {
+  size_t hash = key.owner * 0x9E3779B97F4A7C15 ^ (key.offset >> 2) ^
+                (key.is_shared ? 0x5555555555555555 : 0);
+  hash ^= hash >> 29;
+  return futex_buckets[hash % kFutexBuckets];
+}
+
+bool operator==(const FutexKey& a, const FutexKey& b) {
+  return a.owner == b.owner && a.offset == b.offset &&
+         a.is_shared == b.is_shared;
+}
+
+// Returns the shared memory mapped at `address` in a process, or nullptr if
+// the address isn't inside joined shared memory.
+SharedMemoryInProcess* FindSharedMemoryAtAddress(Process* process,
+                                                 size_t address) {
+  SharedMemoryInProcess* shared_memory_in_process =
+      process->joined_shared_memories.SearchForItemLessThanOrEqualToValue(
+          address);
+  if (shared_memory_in_process == nullptr ||
+      address >= shared_memory_in_process->virtual_address +
+                     shared_memory_in_process->mapped_pages * PAGE_SIZE)
+    return nullptr;
+  return shared_memory_in_process;
+}
+
+// Works out the key for the 32-bit word at `address` in a process. Returns
+// false if the address isn't aligned.
+bool GetFutexKey(Process* process, size_t address, FutexKey& key) {
+  if ((address & 3) != 0) return false;
+
+  // Copy-on-write shared memory (such as a program's .data, which every
+  // instance of the program joins) is private to each process as far as
+  // writers are concerned, so it's keyed like private memory.
+  SharedMemoryInProcess* shared_memory_in_process =
+      FindSharedMemoryAtAddress(process, address);
+  if (shared_memory_in_process != nullptr &&
+      (shared_memory_in_process->shared_memory->flags & SM_COPY_ON_WRITE) ==
+          0) {
+    key.owner = shared_memory_in_process->shared_memory->id;
+    key.offset = address - shared_memory_in_process->virtual_address;
+    key.is_shared = true;
+  } else {
+    key.owner = process->pid;
+    key.offset = address;
+    key.is_shared = false;
+  }
+  return true;
+}
+
+// Reads the 32-bit word at `address` in a process. Lazily zeroed pages are
+// allocated, since they're valid memory that hasn't been touched yet. Returns
+// false and sets `error` if the word can't be read: INVALID_ADDRESS if the
+// address isn't backed by memory, or VALUE_CHANGED if it's in a page of lazily
+// allocated shared memory that the creator hasn't provided yet, so that the
+// caller touches the word (which loads the page) and tries again.
+bool ReadFutexWord(Process* process, size_t address, uint32& value,
+                   FutexWaitResult& error) {
+  size_t offset_in_page = address & (PAGE_SIZE - 1);
+  size_t page = address - offset_in_page;
+  VirtualAddressSpace& address_space = process->virtual_address_space;
+  size_t physical_page =
+      address_space.GetPhysicalAddress(page, /*ignore_unowned_pages=*/false);
+  if (physical_page == OUT_OF_MEMORY &&
+      address_space.MaybeAllocateLazilyZeroedPage(page)) {
+    physical_page =
+        address_space.GetPhysicalAddress(page, /*ignore_unowned_pages=*/false);
+  }
+  if (physical_page == OUT_OF_MEMORY) {
+    SharedMemoryInProcess* shared_memory_in_process =
+        FindSharedMemoryAtAddress(process, address);
+    error = shared_memory_in_process != nullptr &&
+                    (shared_memory_in_process->shared_memory->flags &
+                     SM_LAZILY_ALLOCATED) != 0
+                ? FutexWaitResult::VALUE_CHANGED
+                : FutexWaitResult::INVALID_ADDRESS;
+    return false;
+  }
+
+  value = *(volatile uint32*)((size_t)TemporarilyMapPhysicalPages(
+                                  physical_page, kFutexTemporaryMappingIndex) +
+                              offset_in_page);
+  return true;
+}
+
+// Removes a waiting thread from its wait queue and cancels its timeout.
+void StopWaiting(Thread* thread) {
+  BucketForKey(thread->futex_key).Remove(thread);
+  thread->thread_is_waiting_on_futex = false;
+  if (thread->futex_timeout != nullptr) {
+    CancelTimerEvent(thread->futex_timeout);
+    thread->futex_timeout = nullptr;
+  }
+}
+
+// Wakes up a waiting thread.
+void WakeWaitingThread(Thread* thread, FutexWaitResult result) {
+  StopWaiting(thread);
+  thread->registers.rax = (size_t)result;
+  ScheduleThread(thread);
+}
+
+// Wakes up to `count` threads waiting on the key. Returns the number of threads
+// woken up.
+size_t WakeWaitersOnKey(const FutexKey& key, size_t count) {
+  auto& bucket = BucketForKey(key);
+  size_t woken = 0;
+  Thread* thread = bucket.FirstItem();
+  while (thread != nullptr && woken < count) {
+    Thread* next_thread = bucket.NextItem(thread);
+    if (thread->futex_key == key) {
+      WakeWaitingThread(thread, FutexWaitResult::WOKEN);
+      woken++;
+    }
+    thread = next_thread;
+  }
+  return woken;
+}
+
+}  // namespace
+
+void InitializeFutexes() {
+  for (size_t i = 0; i < kFutexBuckets; i++)
+    new (&futex_buckets[i]) LinkedList<Thread, &Thread::node_in_futex_queue>();
+}
+
+bool FutexWait(Thread* thread, size_t address, uint32 expected,
+               size_t timeout_microseconds) {
+  Process* process = thread->process;
+  FutexKey key;
+  if (!GetFutexKey(process, address, key)) {
+    thread->registers.rax = (size_t)FutexWaitResult::INVALID_ADDRESS;
+    return false;
+  }
+  uint32 value;
+  FutexWaitResult error;
+  if (!ReadFutexWord(process, address, value, error)) {
+    thread->registers.rax = (size_t)error;
+    return false;
+  }
+  if (value != expected) {
+    thread->registers.rax = (size_t)FutexWaitResult::VALUE_CHANGED;
+    return false;
+  }
+  if (timeout_microseconds == 0) {
+    thread->registers.rax = (size_t)FutexWaitResult::TIMED_OUT;
+    return false;
+  }
+
+  thread->futex_key = key;
+  thread->thread_is_waiting_on_futex = true;
+  BucketForKey(key).AddBack(thread);
+
+  thread->futex_timeout = nullptr;
+  if (timeout_microseconds != FUTEX_WAIT_FOREVER) {
+    size_t now = GetCurrentTimestampInMicroseconds();
+    size_t timestamp = now + timeout_microseconds;
+    // Wait forever rather than overflow on absurdly long timeouts.
+    if (timestamp > now)
+      thread->futex_timeout = TimeOutFutexWaitAtMicroseconds(thread, timestamp);
+  }
+
+  UnscheduleThread(thread);
+  return true;
+}
+
+size_t FutexWake(Process* process, size_t address, size_t count) {
+  FutexKey key;
+  if (count == 0 || !GetFutexKey(process, address, key)) return 0;
+  return WakeWaitersOnKey(key, count);
+}
+
+size_t FutexRequeue(Process* process, size_t address, size_t wake_count,
+                    size_t requeue_address, size_t requeue_count,
+                    bool compare, uint32 expected) {
+  FutexKey key, requeue_key;
+  if (!GetFutexKey(process, address, key) ||
+      !GetFutexKey(process, requeue_address, requeue_key))
+    return FUTEX_REQUEUE_FAILED;
+
+  if (compare) {
+    uint32 value;
+    FutexWaitResult error;
+    if (!ReadFutexWord(process, address, value, error) || value != expected)
+      return FUTEX_REQUEUE_FAILED;
+  }
+
+  size_t woken = WakeWaitersOnKey(key, wake_count);
+  if (requeue_count == 0 || key == requeue_key) return woken;
+
+  auto& bucket = BucketForKey(key);
+  auto& requeue_bucket = BucketForKey(requeue_key);
+  size_t requeued = 0;
+  Thread* thread = bucket.FirstItem();
+  while (thread != nullptr && requeued < requeue_count) {
+    Thread* next_thread = bucket.NextItem(thread);
+    if (thread->futex_key == key) {
+      // Requeued threads keep their place behind the requeue address's
+      // existing waiters, and keep their timeouts.
+      bucket.Remove(thread);
+      thread->futex_key = requeue_key;
+      requeue_bucket.AddBack(thread);
+      requeued++;
+    }
+    thread = next_thread;
+  }
+  return woken + requeued;
+}
+
+void TimeOutFutexWait(Thread* thread) {
+  if (!thread->thread_is_waiting_on_futex) return;
+  // The timer releases the event once this returns.
+  thread->futex_timeout = nullptr;
+  WakeWaitingThread(thread, FutexWaitResult::TIMED_OUT);
+}
+
+void RemoveThreadFromFutex(Thread* thread) {
+  if (thread->thread_is_waiting_on_futex) StopWaiting(thread);
+}
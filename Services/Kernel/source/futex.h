@@ -0,0 +1,90 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "types.h"
+
+struct Process;
+struct Thread;
+
+// Identifies the word a thread is waiting on. Words inside shared memory are
+// identified by the shared memory block and the offset into it, so that every
+// process that has joined the block agrees on the key no matter where the
+// block is mapped. Other words, including those in copy-on-write shared
+// memory, are identified by the process and the virtual address.
+struct FutexKey {
+  // The shared memory ID if `is_shared`, otherwise the process's PID.
+  size_t owner;
+
+  // The offset into the shared memory if `is_shared`, otherwise the virtual
+  // address.
+  size_t offset;
+
+  // Is this word inside of shared memory?
+  bool is_shared;
+};
+
+// The result of waiting on a futex, returned to the waiting thread in rax.
+enum class FutexWaitResult : size_t {
+  // Another thread woke this thread up.
+  WOKEN = 0,
+  // The word didn't contain the expected value, so the thread didn't sleep.
+  VALUE_CHANGED = 1,
+  // The timeout elapsed before anyone woke this thread up.
+  TIMED_OUT = 2,
+  // The address isn't aligned or isn't backed by memory.
+  INVALID_ADDRESS = 3
+};
+
+// Timeout to pass to FutexWait() to wait until woken.
+#define FUTEX_WAIT_FOREVER (~(size_t)0)
+
+// Returned from FutexRequeue() if the word didn't contain the expected value
+// or an address isn't valid.
+#define FUTEX_REQUEUE_FAILED (~(size_t)0)
+
+// Initializes the futex wait queues.
+void InitializeFutexes();
+
+// Puts the thread to sleep if the 32-bit word at `address` in its process
+// still contains `expected`. The check and going to sleep happen under the
+// kernel lock, so a wake that follows a change to the word can't be missed.
+// The thread wakes up after `timeout_microseconds`, unless it's
+// FUTEX_WAIT_FOREVER. Returns true if the thread is now asleep. The
+// FutexWaitResult is written into the thread's rax, once the thread wakes up
+// if it's asleep.
+bool FutexWait(Thread* thread, size_t address, uint32 expected,
+               size_t timeout_microseconds);
+
+// Wakes up to `count` threads waiting on the word at `address` in the
+// process, in the order they started waiting. Returns the number of threads
+// woken up.
+size_t FutexWake(Process* process, size_t address, size_t count);
+
+// Wakes up to `wake_count` threads waiting on the word at `address`, and moves
+// up to `requeue_count` of the remaining waiters to wait on `requeue_address`
+// instead. If `compare` is set, nothing happens unless the word at `address`
+// contains `expected`. Returns the number of threads woken up and requeued,
+// or FUTEX_REQUEUE_FAILED.
+size_t FutexRequeue(Process* process, size_t address, size_t wake_count,
+                    size_t requeue_address, size_t requeue_count,
+                    bool compare, uint32 expected);
+
+// Wakes up a thread whose wait on a futex has timed out. Called by the timer.
+void TimeOutFutexWait(Thread* thread);
+
+// Stops a thread from waiting on a futex, without waking it up. Called when
+// the thread is being destroyed.
+void RemoveThreadFromFutex(Thread* thread);
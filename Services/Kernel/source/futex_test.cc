@@ -0,0 +1,239 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "futex.h"
+
+#include "object_pools.h"
+#include "physical_allocator.h"
+#include "process.h"
+#include "shared_memory.h"
+#include "testing.h"
+#include "thread.h"
+#include "timer.h"
+#include "virtual_allocator.h"
+
+namespace {
+
+// Initializes everything futexes depend on.
+void InitializeFutexTest() {
+  InitializeObjectPools();
+  InitializeProcesses();
+  InitializeThreads();
+  InitializeVirtualAllocator();
+  InitializeSharedMemory();
+  InitializeTimer();
+  InitializeFutexes();
+}
+
+// Writes a 32-bit word into a process's memory.
+void WriteWord(Process* process, size_t address, uint32 value) {
+  size_t offset_in_page = address & (PAGE_SIZE - 1);
+  size_t physical_page = process->virtual_address_space.GetPhysicalAddress(
+      address - offset_in_page, /*ignore_unowned_pages=*/false);
+  *(volatile uint32*)((size_t)TemporarilyMapPhysicalPages(physical_page, 0) +
+                      offset_in_page) = value;
+}
+
+// Returns whether a thread is waiting on a futex. The scheduler is mocked out
+// in tests, so threads never actually sleep.
+bool IsWaiting(Thread* thread) { return thread->thread_is_waiting_on_futex; }
+
+}  // namespace
+
+TEST(FutexWaitAndWakeTest) {
+  InitializeFutexTest();
+
+  Process* p1 = CreateProcess(false, true);
+  size_t address = p1->virtual_address_space.AllocatePages(1) + 16;
+  WriteWord(p1, address, 1);
+  WriteWord(p1, address + 4, 0);
+  Thread* t1 = CreateThread(p1, 0x1000, 0);
+  Thread* t2 = CreateThread(p1, 0x1000, 0);
+  Thread* t3 = CreateThread(p1, 0x1000, 0);
+
+  // Nothing sleeps if the word has changed, or the address is misaligned.
+  ASSERT(FutexWait(t1, address, 0, FUTEX_WAIT_FOREVER), false);
+  ASSERT(t1->registers.rax, (size_t)FutexWaitResult::VALUE_CHANGED);
+  ASSERT(FutexWait(t1, address + 1, 1, FUTEX_WAIT_FOREVER), false);
+  ASSERT(t1->registers.rax, (size_t)FutexWaitResult::INVALID_ADDRESS);
+
+  ASSERT(FutexWait(t1, address, 1, FUTEX_WAIT_FOREVER), true);
+  ASSERT(FutexWait(t2, address, 1, FUTEX_WAIT_FOREVER), true);
+  ASSERT(FutexWait(t3, address + 4, 0, FUTEX_WAIT_FOREVER), true);
+  ASSERT(IsWaiting(t1), true);
+
+  // Waiters wake in the order they started waiting, and only on their word.
+  ASSERT(FutexWake(p1, address, 1), (size_t)1);
+  ASSERT(IsWaiting(t1), false);
+  ASSERT(t1->registers.rax, (size_t)FutexWaitResult::WOKEN);
+  ASSERT(IsWaiting(t2), true);
+  ASSERT(FutexWake(p1, address, 10), (size_t)1);
+  ASSERT(IsWaiting(t2), false);
+  ASSERT(IsWaiting(t3), true);
+  ASSERT(FutexWake(p1, address, 10), (size_t)0);
+
+  // Destroying a waiting thread removes it from the wait queue.
+  DestroyThread(t3, /*process_being_destroyed=*/false);
+  ASSERT(FutexWake(p1, address + 4, 10), (size_t)0);
+
+  DestroyProcess(p1);
+}
+
+TEST(FutexTimeoutTest) {
+  InitializeFutexTest();
+
+  Process* p1 = CreateProcess(false, true);
+  size_t address = p1->virtual_address_space.AllocatePages(1);
+  WriteWord(p1, address, 7);
+  Thread* t1 = CreateThread(p1, 0x1000, 0);
+
+  ASSERT(FutexWait(t1, address, 7, 0), false);
+  ASSERT(t1->registers.rax, (size_t)FutexWaitResult::TIMED_OUT);
+
+  // Each tick of the test timer is 10ms.
+  ASSERT(FutexWait(t1, address, 7, 15000), true);
+  TimerHandler();
+  ASSERT(IsWaiting(t1), true);
+  TimerHandler();
+  ASSERT(IsWaiting(t1), false);
+  ASSERT(t1->registers.rax, (size_t)FutexWaitResult::TIMED_OUT);
+  ASSERT(p1->timer_events.IsEmpty(), true);
+
+  // Waking the thread cancels the timeout.
+  ASSERT(FutexWait(t1, address, 7, 15000), true);
+  ASSERT(p1->timer_events.IsEmpty(), false);
+  ASSERT(FutexWake(p1, address, 1), (size_t)1);
+  ASSERT(t1->registers.rax, (size_t)FutexWaitResult::WOKEN);
+  ASSERT(p1->timer_events.IsEmpty(), true);
+
+  DestroyProcess(p1);
+}
+
+TEST(FutexRequeueTest) {
+  InitializeFutexTest();
+
+  Process* p1 = CreateProcess(false, true);
+  size_t condition = p1->virtual_address_space.AllocatePages(1);
+  size_t mutex = condition + 64;
+  WriteWord(p1, condition, 3);
+  Thread* t1 = CreateThread(p1, 0x1000, 0);
+  Thread* t2 = CreateThread(p1, 0x1000, 0);
+  Thread* t3 = CreateThread(p1, 0x1000, 0);
+  ASSERT(FutexWait(t1, condition, 3, FUTEX_WAIT_FOREVER), true);
+  ASSERT(FutexWait(t2, condition, 3, FUTEX_WAIT_FOREVER), true);
+  ASSERT(FutexWait(t3, condition, 3, FUTEX_WAIT_FOREVER), true);
+
+  // Nothing happens if the word has changed.
+  ASSERT(FutexRequeue(p1, condition, 1, mutex, 10, /*compare=*/true, 4),
+         FUTEX_REQUEUE_FAILED);
+  ASSERT(IsWaiting(t1), true);
+
+  // Wake one, and move the rest over to the mutex.
+  ASSERT(FutexRequeue(p1, condition, 1, mutex, 10, /*compare=*/true, 3),
+         (size_t)3);
+  ASSERT(IsWaiting(t1), false);
+  ASSERT(FutexWake(p1, condition, 10), (size_t)0);
+  ASSERT(FutexWake(p1, mutex, 1), (size_t)1);
+  ASSERT(IsWaiting(t2), false);
+  ASSERT(IsWaiting(t3), true);
+  ASSERT(FutexWake(p1, mutex, 1), (size_t)1);
+  ASSERT(IsWaiting(t3), false);
+
+  DestroyProcess(p1);
+}
+
+TEST(FutexSharedMemoryTest) {
+  InitializeFutexTest();
+
+  // Two processes map the same shared memory at different addresses.
+  Process* p1 = CreateProcess(false, true);
+  Process* p2 = CreateProcess(false, true);
+  p2->virtual_address_space.AllocatePages(3);
+  SharedMemoryInProcess* shm_p1 = CreateAndMapSharedMemoryBlockIntoProcess(
+      p1, 1, SM_JOINERS_CAN_WRITE, 0);
+  SharedMemoryInProcess* shm_p2 =
+      JoinSharedMemory(p2, shm_p1->shared_memory->id);
+  ASSERT(shm_p2 != nullptr, true);
+  ASSERT(shm_p1->virtual_address != shm_p2->virtual_address, true);
+  size_t offset = 128;
+  WriteWord(p1, shm_p1->virtual_address + offset, 42);
+
+  // A thread in one process is woken through the other's mapping.
+  Thread* t1 = CreateThread(p1, 0x1000, 0);
+  ASSERT(FutexWait(t1, shm_p1->virtual_address + offset, 42,
+                   FUTEX_WAIT_FOREVER),
+         true);
+  ASSERT(FutexWake(p2, shm_p1->virtual_address + offset, 1), (size_t)0);
+  ASSERT(FutexWake(p2, shm_p2->virtual_address + offset, 1), (size_t)1);
+  ASSERT(IsWaiting(t1), false);
+
+  DestroyProcess(p1);
+  DestroyProcess(p2);
+}
+
+TEST(FutexCopyOnWriteMemoryIsPrivateTest) {
+  InitializeFutexTest();
+
+  // Two instances of the same program join the copy-on-write shared memory
+  // holding its .data, at the same address.
+  Process* loader = CreateProcess(false, true);
+  SharedMemoryInProcess* data_in_loader =
+      CreateAndMapSharedMemoryBlockIntoProcess(
+          loader, 1, SM_COPY_ON_WRITE | SM_JOINERS_CAN_WRITE, 0);
+  size_t data_id = data_in_loader->shared_memory->id;
+  Process* p1 = CreateProcess(false, true);
+  Process* p2 = CreateProcess(false, true);
+  SharedMemoryInProcess* data_in_p1 = JoinSharedMemory(p1, data_id);
+  SharedMemoryInProcess* data_in_p2 = JoinSharedMemory(p2, data_id);
+  ASSERT(data_in_p1 != nullptr, true);
+  ASSERT(data_in_p2 != nullptr, true);
+  size_t mutex_in_p1 = data_in_p1->virtual_address + 64;
+  size_t mutex_in_p2 = data_in_p2->virtual_address + 64;
+
+  // Both wait on the same global mutex.
+  Thread* t1 = CreateThread(p1, 0x1000, 0);
+  Thread* t2 = CreateThread(p2, 0x1000, 0);
+  ASSERT(FutexWait(t1, mutex_in_p1, 0, FUTEX_WAIT_FOREVER), true);
+  ASSERT(FutexWait(t2, mutex_in_p2, 0, FUTEX_WAIT_FOREVER), true);
+
+  // Each process only wakes its own waiter.
+  ASSERT(FutexWake(p1, mutex_in_p1, 1), (size_t)1);
+  ASSERT(IsWaiting(t1), false);
+  ASSERT(IsWaiting(t2), true);
+  ASSERT(FutexWake(p1, mutex_in_p1, 1), (size_t)0);
+  ASSERT(FutexWake(p2, mutex_in_p2, 1), (size_t)1);
+  ASSERT(IsWaiting(t2), false);
+
+  DestroyProcess(p1);
+  DestroyProcess(p2);
+  DestroyProcess(loader);
+}
+
+TEST(FutexWaitOnUntouchedLazilyZeroedPageTest) {
+  InitializeFutexTest();
+
+  Process* p1 = CreateProcess(false, true);
+  size_t address = p1->virtual_address_space.AllocateLazilyZeroedPages(1);
+  ASSERT(p1->virtual_address_space.GetPhysicalAddress(address, false),
+         OUT_OF_MEMORY);
+
+  // The untouched word reads as 0.
+  Thread* t1 = CreateThread(p1, 0x1000, 0);
+  ASSERT(FutexWait(t1, address + 8, 1, FUTEX_WAIT_FOREVER), false);
+  ASSERT(t1->registers.rax, (size_t)FutexWaitResult::VALUE_CHANGED);
+  ASSERT(FutexWait(t1, address + 8, 0, FUTEX_WAIT_FOREVER), true);
+  ASSERT(FutexWake(p1, address + 8, 1), (size_t)1);
+
+  DestroyProcess(p1);
+}
@@ -55,6 +55,10 @@ void InitializeIdt() {
   // Clear the IDT.
   memset((char *)idt, 0, sizeof(idt_entry) * 256);
 
+  LoadIdt();
+}
+
+void LoadIdt() {
   // Load the new IDT pointer, which is in virtual address space.
   __asm__ __volatile__("lidt %0" : : "m"(idt_p));
 }
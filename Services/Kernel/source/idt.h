@@ -7,6 +7,10 @@
 // Initalizes the interrupt descriptor table.
 void InitializeIdt();
 
+// Loads the interrupt descriptor table on the current CPU. Used by application
+// processors, since InitializeIdt() loads it on the bootstrap processor.
+void LoadIdt();
+
 // Sets an IDT entry.
 void SetIdtEntry(unsigned char num, size_t handler, unsigned short sel,
                  unsigned char flags);
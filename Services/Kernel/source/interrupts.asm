@@ -14,6 +14,12 @@
 
 [BITS 64]
 
+; Offsets of fields in the Cpu structure (cpu.h). While in the kernel, GS points
+; to the Cpu structure of the CPU we are running on.
+%define CPU_CURRENT_REGISTERS 8
+%define CPU_INTERRUPT_STACK_TOP 16
+%define CPU_CURRENT_THREAD 32
+
 [GLOBAL irq0]
 [GLOBAL irq1]
 [GLOBAL irq2]
@@ -31,9 +37,10 @@
 [GLOBAL irq14]
 [GLOBAL irq15]
 [GLOBAL apic_timer_interrupt]
+[GLOBAL interprocessor_interrupt]
 [EXTERN CommonHardwareInterruptHandler]
-[EXTERN currently_executing_thread_regs]
-[EXTERN interrupt_stack_top]
+[EXTERN EnterKernel]
+[EXTERN ExitKernel]
 [EXTERN ProfileEnteringKernelSpaceForInterrupt]
 [EXTERN profiling_enabling_count]
 [EXTERN ProfileSwitchToUserSpace]
@@ -122,13 +129,23 @@ apic_timer_interrupt:
 	push 16
 	jmp irq_common_stub
 
+interprocessor_interrupt:
+	push 17
+	jmp irq_common_stub
+
 irq_common_stub:
+	; If we interrupted user space, point GS to this CPU's structure.
+	test qword [rsp + 16], 3 ; cs
+	jz .gs_is_kernel
+	swapgs
+.gs_is_kernel:
+
 	; Copy what's at the top of the thread's stack.
 	push rbp
 	push rdi ; Using to keep the interrupt number.
 
 	; Move these values out of the interrupt handler
-	mov rbp, [currently_executing_thread_regs]
+	mov rbp, [gs:CPU_CURRENT_REGISTERS]
 	pop qword [rbp + 13 * 8] ; rdi
 	pop qword [rbp + 14 * 8] ; rbp
 	pop qword rdi ; interrupt number
@@ -139,7 +156,7 @@ irq_common_stub:
 	pop qword [rbp + 19 * 8] ; ss
 
  	; Point our stack to the top of isr_regs, minus the registers already saved.
-	mov rsp, [currently_executing_thread_regs]
+	mov rsp, [gs:CPU_CURRENT_REGISTERS]
 	add rsp, 13 * 8
 
 	; Push the rest of the registers.
@@ -158,13 +175,19 @@ irq_common_stub:
 	push r15
 
 	; Move back to the interrupt's stack.
-	mov rsp, [interrupt_stack_top]
+	mov rsp, [gs:CPU_INTERRUPT_STACK_TOP]
 
 	; Move to kernel land data segment
 	mov ax, 0x10
 	mov ds, ax
 	mov es, ax
 
+	; Wait for any other CPU to leave the kernel.
+	push rdi
+	mov rax, EnterKernel
+	call rax
+	pop rdi
+
     ; Jump over profiling code if profiler isn't enabled.
     mov r8, [profiling_enabling_count]
     test r8, r8
@@ -187,14 +210,16 @@ irq_common_stub:
 	mov rax, CommonHardwareInterruptHandler
 	call rax
 
-[EXTERN running_thread]
-
 [GLOBAL JumpIntoThread]
 JumpIntoThread:
-    mov rax, [running_thread]
+    mov rax, [gs:CPU_CURRENT_THREAD]
     test rax, rax
     jnz .jump_to_thread
 
+    ; Let other CPUs into the kernel while we are idle.
+    mov rax, ExitKernel
+    call rax
+
     ; Idle loop!
     sti
 .idle_loop:
@@ -213,13 +238,23 @@ JumpIntoThread:
 
  .jump_over_post_handler_profiling:
 
+    ; Let other CPUs into the kernel.
+    mov rax, ExitKernel
+    call rax
+
 	; Move back to userland data segment.
 	mov ax, 0x18 | 3
 	mov ds, ax
 	mov es, ax
 
  	; Jump to the bottom of isr_regs, which contains 20 64-bit registers.
-	mov rsp, [currently_executing_thread_regs]
+	mov rsp, [gs:CPU_CURRENT_REGISTERS]
+
+	; If returning to user space, swap back to the thread's GS.
+	test qword [rsp + 16 * 8], 3 ; cs
+	jz .keep_kernel_gs
+	swapgs
+.keep_kernel_gs:
 
 	; Pop the registers into memory.
 	pop r15
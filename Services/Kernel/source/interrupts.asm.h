@@ -33,6 +33,7 @@ void irq13();
 void irq14();
 void irq15();
 void apic_timer_interrupt();
+void interprocessor_interrupt();
 
 void JumpIntoThread();
 
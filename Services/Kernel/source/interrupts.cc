@@ -15,11 +15,13 @@
 
 #include "interrupts.h"
 
+#include "cpu.h"
 #include "exceptions.h"
 #include "idt.h"
 #include "interrupts.asm.h"
 #include "io.h"
 #include "heap_allocator.h"
+#include "local_apic.h"
 #include "messages.h"
 #include "physical_allocator.h"
 #include "process.h"
@@ -72,15 +74,10 @@ void RegisterInterruptHandlers() {
   SetIdtEntry(45, (size_t)irq13, 0x08, 0x8E);
   SetIdtEntry(46, (size_t)irq14, 0x08, 0x8E);
   SetIdtEntry(47, (size_t)irq15, 0x08, 0x8E);
-  SetIdtEntry(48, (size_t)apic_timer_interrupt, 0x08, 0x8E);
-}
-
-// Allocates a stack to use for interrupts.
-void AllocateInterruptStack() {
-  size_t virtual_addr = KernelAddressSpace().AllocatePages(1);
-  interrupt_stack_top = virtual_addr + PAGE_SIZE;
-
-  SetInterruptStack(virtual_addr);
+  SetIdtEntry(LOCAL_APIC_TIMER_INTERRUPT, (size_t)apic_timer_interrupt, 0x08,
+              0x8E);
+  SetIdtEntry(INTERPROCESSOR_INTERRUPT, (size_t)interprocessor_interrupt, 0x08,
+              0x8E);
 }
 
 void HandleInterruptMessage(MessageToFireOnInterrupt& message_to_fire) {
@@ -164,13 +161,10 @@ void HandleInterruptMessage(MessageToFireOnInterrupt& message_to_fire) {
 
 }  // namespace
 
-// The top of the interrupt's stack.
-size_t interrupt_stack_top;
-
 // Initializes interrupts.
 void InitializeInterrupts() {
   InitializeIdt();
-  AllocateInterruptStack();
+  AllocateInterruptStack(GetCurrentCpu());
 
   for (int i = 0; i < 16; i++) {
     new (&messages_to_fire_on_interrupt[i])
@@ -184,6 +178,14 @@ void InitializeInterrupts() {
   RegisterInterruptHandlers();
 }
 
+// Allocates a stack for a CPU to use for interrupts.
+void AllocateInterruptStack(Cpu* cpu) {
+  size_t virtual_addr = KernelAddressSpace().AllocatePages(1);
+  cpu->interrupt_stack_top = virtual_addr + PAGE_SIZE;
+
+  SetInterruptStack(cpu, virtual_addr);
+}
+
 // Registers a message to send to a process upon receiving an interrupt.
 void RegisterMessageToSendOnInterrupt(size_t interrupt_number, Process* process,
                                       size_t message_id, size_t method,
@@ -264,15 +266,20 @@ extern "C" void CommonHardwareInterruptHandler(int interrupt_number) {
   if (interrupt_number == 16) {
     // The Local APIC Timer interrupt.
     TimerHandler();
-#ifndef TEST
-    extern void SendLapicEoi();
     SendLapicEoi();
-#endif
+  } else if (interrupt_number == 17) {
+    // Another CPU wants our attention.
+    SendLapicEoi();
+    HandleInterprocessorInterrupt();
   } else if (interrupt_number == 0) {
     // The legacy PIT periodic timer.
     TimerHandler();
     // Send an EOI to the master interrupt controller.
     WriteIOByte(0x20, 0x20);
+  } else if (interrupt_number == 4) {
+    // COM1, which the kernel prints to, is ready for more output.
+    HandleSerialInterrupt();
+    WriteIOByte(0x20, 0x20);
   } else {
     // Send messages to any processes listening for this interrupt.
     for (MessageToFireOnInterrupt* message :
@@ -20,6 +20,7 @@
 // The number of interrupts.
 #define NUMBER_OF_INTERRUPTS 16
 
+struct Cpu;
 struct Process;
 
 // Parameters for interrupt method 1.
@@ -58,12 +59,12 @@ struct MessageToFireOnInterrupt {
   LinkedListNode node_in_process;
 };
 
-// The top of the interrupt's stack.
-extern size_t interrupt_stack_top;
-
 // Initializes interrupts.
 void InitializeInterrupts();
 
+// Allocates a stack for a CPU to use for interrupts.
+void AllocateInterruptStack(Cpu* cpu);
+
 // Registers a message to send to a process upon receiving an interrupt.
 void RegisterMessageToSendOnInterrupt(size_t interrupt_number, Process* process,
                                       size_t message_id, size_t method,
@@ -28,15 +28,12 @@
 #include <iomanip>
 #include <unordered_map>
 
-// Mocks for Scheduler globals
-Thread *running_thread = nullptr;
-Registers *currently_executing_thread_regs = nullptr;
-
 // Mocks for Scheduler functions
 void ScheduleThread(Thread *thread) {}
 void UnscheduleThread(Thread *thread) {}
 void ScheduleThreadIfWeAreHalted() {}
 void ScheduleNextThread() {}
+void StopThreadFromRunning(Thread* thread) {}
 bool NeedsTimesliceInterrupt(Thread* thread) { return false; }
 void SetFocusedProcess(Process* process) {}
 Process* GetFocusedProcess() { return nullptr; }
@@ -80,6 +77,14 @@ size_t GetPhysicalPageAtOrBelowAddress(size_t max_base_address) {
   return GetPhysicalPage();
 }
 
+size_t GetContiguousPhysicalPages(size_t pages, size_t max_base_address) {
+  size_t first_addr = next_mock_physical_page;
+  for (size_t i = 0; i < pages; i++) GetPhysicalPage();
+  return first_addr;
+}
+
+void InitializePhysicalPageFreeLists() {}
+
 void FreePhysicalPage(size_t addr) {
   simulated_ram.erase(addr);
 }
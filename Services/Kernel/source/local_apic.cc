@@ -0,0 +1,96 @@
+#ifndef TEST
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "local_apic.h"
+
+#include "io.h"
+#include "virtual_address_space.h"
+#include "virtual_allocator.h"
+
+namespace {
+
+// The physical address of the Local APIC.
+constexpr size_t kLocalApicPhysicalAddress = 0xFEE00000;
+
+// The interrupt vector for spurious interrupts.
+constexpr uint32 kSpuriousInterruptVector = 0xFF;
+
+// Bits in the interrupt command register.
+constexpr uint32 kDeliveryModeInit = 0b101 << 8;
+constexpr uint32 kDeliveryModeStartup = 0b110 << 8;
+constexpr uint32 kDeliveryStatusPending = 1 << 12;
+constexpr uint32 kLevelAssert = 1 << 14;
+
+// The virtual address the Local APIC is mapped to. Every CPU sees its own
+// Local APIC at this address.
+volatile uint32* lapic_base = nullptr;
+
+// Sends an interrupt command and waits for it to be delivered.
+void SendInterruptCommand(uint32 local_apic_id, uint32 command) {
+  WriteLocalApicRegister(LOCAL_APIC_INTERRUPT_COMMAND_HIGH, local_apic_id << 24);
+  WriteLocalApicRegister(LOCAL_APIC_INTERRUPT_COMMAND_LOW, command);
+  while (ReadLocalApicRegister(LOCAL_APIC_INTERRUPT_COMMAND_LOW) &
+         kDeliveryStatusPending) {
+    asm volatile("pause");
+  }
+}
+
+}  // namespace
+
+void InitializeLocalApic() {
+  // Map the LAPIC base address
+  size_t virtual_addr =
+      KernelAddressSpace().MapPhysicalPages(kLocalApicPhysicalAddress, 1);
+  lapic_base = reinterpret_cast<volatile uint32*>(virtual_addr);
+
+  // Mask the PIT IRQ on the legacy PIC (IRQ 0)
+  uint8 pic1_mask = ReadIOByte(0x21);
+  WriteIOByte(0x21, pic1_mask | 0x01);
+
+  EnableLocalApic();
+}
+
+void EnableLocalApic() {
+  // Enable the Local APIC (SVR = 0xF0) with spurious vector 0xFF
+  WriteLocalApicRegister(LOCAL_APIC_SPURIOUS_INTERRUPT_VECTOR,
+                         kSpuriousInterruptVector | (1 << 8));
+}
+
+void WriteLocalApicRegister(uint32 offset, uint32 value) {
+  lapic_base[offset / 4] = value;
+}
+
+uint32 ReadLocalApicRegister(uint32 offset) { return lapic_base[offset / 4]; }
+
+uint32 GetLocalApicId() { return ReadLocalApicRegister(LOCAL_APIC_ID) >> 24; }
+
+extern "C" void SendLapicEoi() {
+  if (lapic_base != nullptr) WriteLocalApicRegister(LOCAL_APIC_EOI, 0);
+}
+
+void SendInterprocessorInterrupt(uint32 local_apic_id, uint8 vector) {
+  SendInterruptCommand(local_apic_id, kLevelAssert | vector);
+}
+
+void SendInitInterprocessorInterrupt(uint32 local_apic_id) {
+  SendInterruptCommand(local_apic_id, kLevelAssert | kDeliveryModeInit);
+}
+
+void SendStartupInterprocessorInterrupt(uint32 local_apic_id, uint8 page) {
+  SendInterruptCommand(local_apic_id,
+                       kLevelAssert | kDeliveryModeStartup | page);
+}
+
+#endif  // TEST
@@ -0,0 +1,67 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "types.h"
+
+// Each CPU has its own Local APIC, which is mapped at the same address on every
+// CPU. It provides each CPU with a timer, and lets CPUs interrupt each other.
+
+// The interrupt vector of the Local APIC timer.
+#define LOCAL_APIC_TIMER_INTERRUPT 48
+
+// The interrupt vector CPUs use to get each other's attention.
+#define INTERPROCESSOR_INTERRUPT 49
+
+// Local APIC register offsets.
+#define LOCAL_APIC_ID 0x20
+#define LOCAL_APIC_EOI 0xB0
+#define LOCAL_APIC_SPURIOUS_INTERRUPT_VECTOR 0xF0
+#define LOCAL_APIC_INTERRUPT_COMMAND_LOW 0x300
+#define LOCAL_APIC_INTERRUPT_COMMAND_HIGH 0x310
+#define LOCAL_APIC_TIMER 0x320
+#define LOCAL_APIC_TIMER_INITIAL_COUNT 0x380
+#define LOCAL_APIC_TIMER_CURRENT_COUNT 0x390
+#define LOCAL_APIC_TIMER_DIVIDE_CONFIGURATION 0x3E0
+
+// Maps the Local APIC into memory and enables it on the bootstrap processor.
+void InitializeLocalApic();
+
+// Enables the Local APIC on the current CPU. InitializeLocalApic() must have
+// been called first.
+void EnableLocalApic();
+
+// Writes to a register of the current CPU's Local APIC.
+void WriteLocalApicRegister(uint32 offset, uint32 value);
+
+// Reads a register of the current CPU's Local APIC.
+uint32 ReadLocalApicRegister(uint32 offset);
+
+// Returns the ID of the current CPU's Local APIC.
+uint32 GetLocalApicId();
+
+// Sends an end of interrupt to the current CPU's Local APIC.
+extern "C" void SendLapicEoi();
+
+// Sends an interrupt to the CPU with the given Local APIC ID.
+void SendInterprocessorInterrupt(uint32 local_apic_id, uint8 vector);
+
+// Sends an INIT interrupt, which resets a CPU and waits for a startup
+// interrupt.
+void SendInitInterprocessorInterrupt(uint32 local_apic_id);
+
+// Sends a startup interrupt, which starts a CPU in real mode at the physical
+// address `page` * 4096.
+void SendStartupInterprocessorInterrupt(uint32 local_apic_id, uint8 page);
@@ -0,0 +1,117 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "log_ring.h"
+
+#include "memory.h"
+#include "process.h"
+
+namespace {
+
+// The ring that the kernel's printer writes into.
+LogRing kernel_log_ring;
+
+// How many bytes of the log to copy into a process at once.
+constexpr size_t kReadChunkSize = 256;
+
+}  // namespace
+
+LogRing::LogRing() { Clear(); }
+
+size_t LogRing::Write(const char* data, size_t length) {
+  size_t free_space = FreeSpace();
+  if (length > free_space) length = free_space;
+
+  size_t written = 0;
+  while (written < length) {
+    size_t offset = write_position_ % kLogRingSize;
+    size_t bytes = kLogRingSize - offset;
+    if (bytes > length - written) bytes = length - written;
+    memcpy(&buffer_[offset], (char*)data + written, bytes);
+    write_position_ += bytes;
+    written += bytes;
+  }
+  return written;
+}
+
+size_t LogRing::FreeSpace() const { return kLogRingSize - UndrainedBytes(); }
+
+size_t LogRing::UndrainedBytes() const {
+  return write_position_ - drain_position_;
+}
+
+size_t LogRing::PeekUndrained(const char*& data) const {
+  size_t offset = drain_position_ % kLogRingSize;
+  data = &buffer_[offset];
+  size_t bytes = kLogRingSize - offset;
+  size_t undrained = UndrainedBytes();
+  return bytes < undrained ? bytes : undrained;
+}
+
+void LogRing::MarkDrained(size_t length) {
+  size_t undrained = UndrainedBytes();
+  drain_position_ += length < undrained ? length : undrained;
+}
+
+size_t LogRing::Read(size_t position, char* buffer, size_t size,
+                     size_t& first_position) const {
+  size_t oldest_position =
+      write_position_ > kLogRingSize ? write_position_ - kLogRingSize : 0;
+  if (position < oldest_position) position = oldest_position;
+  if (position > write_position_) position = write_position_;
+  first_position = position;
+
+  size_t read = 0;
+  while (read < size && position < write_position_) {
+    size_t offset = position % kLogRingSize;
+    size_t bytes = kLogRingSize - offset;
+    if (bytes > write_position_ - position) bytes = write_position_ - position;
+    if (bytes > size - read) bytes = size - read;
+    memcpy(buffer + read, (char*)&buffer_[offset], bytes);
+    position += bytes;
+    read += bytes;
+  }
+  return read;
+}
+
+void LogRing::Clear() {
+  write_position_ = 0;
+  drain_position_ = 0;
+}
+
+LogRing& KernelLogRing() { return kernel_log_ring; }
+
+size_t ReadKernelLog(Process* caller, size_t buffer_address, size_t size,
+                     size_t position, size_t& first_position) {
+  char chunk[kReadChunkSize];
+  size_t copied = 0;
+  first_position = position;
+  while (copied < size) {
+    size_t chunk_size = size - copied;
+    if (chunk_size > kReadChunkSize) chunk_size = kReadChunkSize;
+
+    size_t chunk_position;
+    size_t bytes = kernel_log_ring.Read(position, chunk, chunk_size,
+                                        chunk_position);
+    if (copied == 0) first_position = chunk_position;
+    if (bytes == 0 ||
+        !CopyIntoProcess(caller, buffer_address + copied, chunk, bytes))
+      break;
+
+    copied += bytes;
+    position = chunk_position + bytes;
+  }
+  return copied;
+}
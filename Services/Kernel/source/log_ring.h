@@ -0,0 +1,86 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include "types.h"
+
+struct Process;
+
+// The number of bytes the kernel log ring holds.
+constexpr size_t kLogRingSize = 64 * 1024;
+
+// A ring of bytes that the kernel's text output is written into, so that
+// printing doesn't have to wait on the serial port. Bytes are drained out of
+// the ring to serial in the background, and the most recent kLogRingSize bytes
+// stay readable after they've been drained.
+//
+// Every byte ever written has a position, which counts up from 0 and never
+// wraps, so readers can tell if bytes they wanted have been overwritten.
+class LogRing {
+ public:
+  LogRing();
+
+  // Writes as many bytes as fit without overwriting undrained bytes. Returns
+  // the number of bytes written.
+  size_t Write(const char* data, size_t length);
+
+  // The number of bytes that can be written without overwriting undrained
+  // bytes.
+  size_t FreeSpace() const;
+
+  // The number of bytes written but not yet drained.
+  size_t UndrainedBytes() const;
+
+  // Sets `data` to the oldest undrained bytes and returns how many there are
+  // before the end of the ring, which may be fewer than UndrainedBytes().
+  size_t PeekUndrained(const char*& data) const;
+
+  // Marks the oldest `length` undrained bytes as drained.
+  void MarkDrained(size_t length);
+
+  // Copies up to `size` bytes starting at `position` into `buffer`. If
+  // `position` has been overwritten, starts at the oldest byte still in the
+  // ring instead. `first_position` is set to the position of the first byte
+  // copied. Returns the number of bytes copied.
+  size_t Read(size_t position, char* buffer, size_t size,
+              size_t& first_position) const;
+
+  // The position the next byte will be written at.
+  size_t WritePosition() const { return write_position_; }
+
+  // Forgets everything in the ring.
+  void Clear();
+
+ private:
+  // The position of the next byte to write.
+  size_t write_position_;
+
+  // The position of the next byte to drain.
+  size_t drain_position_;
+
+  char buffer_[kLogRingSize];
+};
+
+// The ring that the kernel's printer writes into.
+LogRing& KernelLogRing();
+
+// Copies up to `size` bytes of the kernel log, starting at `position`, into a
+// buffer in `caller`'s memory. `first_position` is set to the position of the
+// first byte copied, which is later than `position` if those bytes have been
+// overwritten. Returns the number of bytes copied, which stops early if the
+// buffer isn't writable.
+size_t ReadKernelLog(Process* caller, size_t buffer_address, size_t size,
+                     size_t position, size_t& first_position);
@@ -0,0 +1,132 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "log_ring.h"
+
+#include "object_pools.h"
+#include "physical_allocator.h"
+#include "process.h"
+#include "testing.h"
+#include "virtual_allocator.h"
+
+namespace {
+
+// A ring for the tests that don't use the kernel's.
+LogRing ring;
+
+// Fills `data` with a pattern that's different for every position.
+void FillWithPattern(char* data, size_t length, size_t first_position) {
+  for (size_t i = 0; i < length; i++)
+    data[i] = (char)((first_position + i) % 251);
+}
+
+}  // namespace
+
+TEST(LogRingDrainsInOrder) {
+  ring.Clear();
+  ASSERT(ring.Write("hello", 5), (size_t)5);
+  ASSERT(ring.UndrainedBytes(), (size_t)5);
+  ASSERT(ring.FreeSpace(), kLogRingSize - 5);
+
+  const char* data;
+  ASSERT(ring.PeekUndrained(data), (size_t)5);
+  ASSERT(data[0], 'h');
+  ring.MarkDrained(2);
+  ASSERT(ring.PeekUndrained(data), (size_t)3);
+  ASSERT(data[0], 'l');
+  ring.MarkDrained(100);
+  ASSERT(ring.UndrainedBytes(), (size_t)0);
+  ASSERT(ring.WritePosition(), (size_t)5);
+}
+
+TEST(LogRingDoesntOverwriteUndrainedBytes) {
+  ring.Clear();
+  static char data[kLogRingSize + 10];
+  FillWithPattern(data, sizeof(data), 0);
+  ASSERT(ring.Write(data, sizeof(data)), kLogRingSize);
+  ASSERT(ring.FreeSpace(), (size_t)0);
+  ASSERT(ring.Write(data, 1), (size_t)0);
+
+  // Draining makes room, and the undrained bytes wrap around the end.
+  ring.MarkDrained(10);
+  ASSERT(ring.Write(data + kLogRingSize, 10), (size_t)10);
+  const char* undrained;
+  ASSERT(ring.PeekUndrained(undrained), kLogRingSize - 10);
+  ASSERT(undrained[0], data[10]);
+  ring.MarkDrained(kLogRingSize - 10);
+  ASSERT(ring.PeekUndrained(undrained), (size_t)10);
+  ASSERT(undrained[9], data[kLogRingSize + 9]);
+}
+
+TEST(LogRingReadsFromTheOldestKeptPosition) {
+  ring.Clear();
+  static char data[kLogRingSize];
+  FillWithPattern(data, kLogRingSize, 0);
+  ring.Write(data, kLogRingSize);
+  ring.MarkDrained(kLogRingSize);
+  FillWithPattern(data, 100, kLogRingSize);
+  ring.Write(data, 100);
+
+  // The first 100 bytes were overwritten.
+  char buffer[16];
+  size_t first_position;
+  ASSERT(ring.Read(0, buffer, sizeof(buffer), first_position), sizeof(buffer));
+  ASSERT(first_position, (size_t)100);
+  ASSERT(buffer[0], (char)(100 % 251));
+
+  // Reads stop at the newest byte, and wrap around the end of the ring.
+  ASSERT(ring.Read(kLogRingSize + 90, buffer, sizeof(buffer), first_position),
+         (size_t)10);
+  ASSERT(first_position, kLogRingSize + 90);
+  ASSERT(buffer[9], (char)((kLogRingSize + 99) % 251));
+  ASSERT(ring.Read(kLogRingSize - 4, buffer, 8, first_position), (size_t)8);
+  ASSERT(buffer[3], (char)((kLogRingSize - 1) % 251));
+  ASSERT(buffer[4], (char)(kLogRingSize % 251));
+
+  // Nothing has been written past the end yet.
+  ASSERT(ring.Read(kLogRingSize * 2, buffer, sizeof(buffer), first_position),
+         (size_t)0);
+  ASSERT(first_position, kLogRingSize + 100);
+}
+
+TEST(ReadKernelLogCopiesIntoProcess) {
+  InitializeObjectPools();
+  InitializeProcesses();
+  InitializeVirtualAllocator();
+  KernelLogRing().Clear();
+  static char data[1000];
+  FillWithPattern(data, sizeof(data), 0);
+  KernelLogRing().Write(data, sizeof(data));
+
+  Process* process = CreateProcess(false, false);
+  size_t buffer = process->virtual_address_space.AllocatePages(1);
+
+  size_t first_position;
+  ASSERT(ReadKernelLog(process, buffer, PAGE_SIZE, 10, first_position),
+         (size_t)990);
+  ASSERT(first_position, (size_t)10);
+  size_t physical_page =
+      process->virtual_address_space.GetPhysicalAddress(buffer, false);
+  char* copied = (char*)TemporarilyMapPhysicalPages(physical_page, 0);
+  ASSERT(copied[0], data[10]);
+  ASSERT(copied[989], data[999]);
+
+  // Memory the process doesn't own isn't written to.
+  ASSERT(ReadKernelLog(process, buffer + PAGE_SIZE * 16, 100, 0,
+                       first_position),
+         (size_t)0);
+
+  DestroyProcess(process);
+}
@@ -1,7 +1,9 @@
 #ifndef TEST
 #include "../../../third_party/multiboot2.h"
+#include "cpu.h"
 #include "framebuffer.h"
 #include "fpu.h"
+#include "futex.h"
 #include "interrupts.h"
 #include "io.h"
 #include "multiboot_modules.h"
@@ -12,6 +14,7 @@
 #include "scheduler.h"
 #include "service.h"
 #include "shared_memory.h"
+#include "smp.h"
 #include "syscall.h"
 #include "text_terminal.h"
 #include "thread.h"
@@ -20,12 +23,14 @@
 #include "virtual_allocator.h"
 
 extern "C" void kmain() {
+  InitializeBootCpu();
   InitializePrinter();
   // Make sure the system was booted with a multiboot2 bootloader - this is
   // needed because GRUB provides some initialization
   // information.
   if (MultibootInfo.magic != MULTIBOOT2_BOOTLOADER_MAGIC) {
     print << "Not booted with a multiboot2 bootloader!";
+    FlushPrinter();
     asm("hlt");
   }
 
@@ -45,13 +50,17 @@ extern "C" void kmain() {
 
   InitializeScheduler();
   InitializeTimer();
+  InitializeFutexes();
   InitializeProfiling();
+  StartApplicationProcessors();
 
   // Loads the multiboot modules, then frees the memory used by them.
   LoadMultibootModules();
   MaybeLoadFramebuffer();
   if (!HasRemainingUnloadedMultibootModules()) DoneWithMultibootMemory();
 
+  // Let the other CPUs into the kernel.
+  ExitKernel();
   asm("sti");
   for (;;) {
     // This needs to be in a loop because the scheduler returns here when there
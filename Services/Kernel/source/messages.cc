@@ -1,5 +1,6 @@
 #include "messages.h"
 
+#include "memory.h"
 #include "object_pool.h"
 #include "physical_allocator.h"
 #include "process.h"
@@ -18,47 +19,166 @@ namespace {
 // Magic number for when there are no messages queued.
 #define ID_FOR_NO_EVENTS 0xFFFFFFFFFFFFFFFF
 
+// The slot to use with TemporarilyMapPhysicalPages when accessing a mailbox.
+#define MAILBOX_TEMPORARY_MAPPING_INDEX 2
+
+// Where things live in a mailbox, in units of sizeof(MailboxMessage).
+#define MAILBOX_RECEIVE_RING_SLOT 1
+#define MAILBOX_SEND_SLOT \
+  (MAILBOX_RECEIVE_RING_SLOT + MESSAGE_MAILBOX_RECEIVE_SLOTS)
+
+#define MAILBOX_SLOTS_PER_PAGE (PAGE_SIZE / sizeof(MailboxMessage))
+
+static_assert(sizeof(MessageMailboxHeader) == sizeof(MailboxMessage));
+static_assert(MAILBOX_SEND_SLOT + MESSAGE_MAILBOX_SEND_SLOTS <=
+              MESSAGE_MAILBOX_PAGES * MAILBOX_SLOTS_PER_PAGE);
+
+// Maps a slot of the process's mailbox into kernel memory. Only one slot is
+// mapped at a time.
+MailboxMessage* MapMailboxSlot(Process* process, size_t slot) {
+  size_t page = process->message_mailbox_physical_pages[
+      slot / MAILBOX_SLOTS_PER_PAGE];
+  MailboxMessage* messages = (MailboxMessage*)TemporarilyMapPhysicalPages(
+      page, MAILBOX_TEMPORARY_MAPPING_INDEX);
+  return &messages[slot % MAILBOX_SLOTS_PER_PAGE];
+}
+
+// Maps the header of the process's mailbox into kernel memory.
+MessageMailboxHeader* MapMailboxHeader(Process* process) {
+  return (MessageMailboxHeader*)MapMailboxSlot(process, 0);
+}
+
+// Copies a message's contents.
+void CopyMessage(const Message& from, Message& to) {
+  to.message_id = from.message_id;
+  to.sender_pid = from.sender_pid;
+  to.metadata = from.metadata;
+  to.param1 = from.param1;
+  to.param2 = from.param2;
+  to.param3 = from.param3;
+  to.param4 = from.param4;
+  to.param5 = from.param5;
+}
+
 // Loads an message in to the thread.
-void LoadMessageIntoThread(Message* message, Thread* thread) {
+void LoadMessageIntoThread(const Message& message, Thread* thread) {
   // Set the thread's registers to contain this message.
   Registers& registers = thread->registers;
-  registers.rax = message->message_id;
-  registers.rbx = message->sender_pid;
-  registers.rdx = message->metadata;
-  registers.rsi = message->param1;
-  registers.r8 = message->param2;
-  registers.r9 = message->param3;
-  registers.r10 = message->param4;
-  registers.r12 = message->param5;
-
-  ObjectPool<Message>::Release(message);
+  registers.rax = message.message_id;
+  registers.rbx = message.sender_pid;
+  registers.rdx = message.metadata;
+  registers.rsi = message.param1;
+  registers.r8 = message.param2;
+  registers.r9 = message.param3;
+  registers.r10 = message.param4;
+  registers.r12 = message.param5;
 }
 
-// Sends an message to a process.
-void SendMessageToProcess(Message* message, Process* receiver) {
+// Writes a message into the process's receive ring. Returns false if the
+// process doesn't have a mailbox or the ring is full.
+bool WriteMessageIntoMailbox(const Message& message, Process* receiver) {
+  if (receiver->message_mailbox_address == 0) return false;
+  if (GetUnreadMessagesInMailbox(receiver) >= MESSAGE_MAILBOX_RECEIVE_SLOTS)
+    return false;
+
+  size_t write_index = receiver->message_mailbox_write_index;
+  MailboxMessage* slot = MapMailboxSlot(
+      receiver, MAILBOX_RECEIVE_RING_SLOT +
+                    (write_index & (MESSAGE_MAILBOX_RECEIVE_SLOTS - 1)));
+  slot->message_id = message.message_id;
+  slot->pid = message.sender_pid;
+  slot->metadata = message.metadata;
+  slot->param1 = message.param1;
+  slot->param2 = message.param2;
+  slot->param3 = message.param3;
+  slot->param4 = message.param4;
+  slot->param5 = message.param5;
+
+  // Publish the message after it has been written.
+  write_index++;
+  receiver->message_mailbox_write_index = write_index;
+  __atomic_store_n(&MapMailboxHeader(receiver)->receive_write_index,
+                   write_index, __ATOMIC_RELEASE);
+  return true;
+}
+
+// Reads the next unread message from the process's receive ring. Returns
+// false if there are no unread messages.
+bool ReadMessageFromMailbox(Process* receiver, Message& message) {
+  if (receiver->message_mailbox_address == 0) return false;
+
+  // The process advances the read index while draining the ring, possibly from
+  // another CPU, so the message is only ours if the compare-and-swap succeeds.
+  // The process could keep changing the index, so give up eventually.
+  for (size_t attempt = 0; attempt < MESSAGE_MAILBOX_RECEIVE_SLOTS; attempt++) {
+    size_t read_index = __atomic_load_n(
+        &MapMailboxHeader(receiver)->receive_read_index, __ATOMIC_ACQUIRE);
+    if (read_index == receiver->message_mailbox_write_index) return false;
+
+    MailboxMessage* slot = MapMailboxSlot(
+        receiver, MAILBOX_RECEIVE_RING_SLOT +
+                      (read_index & (MESSAGE_MAILBOX_RECEIVE_SLOTS - 1)));
+    message.message_id = slot->message_id;
+    message.sender_pid = slot->pid;
+    message.metadata = slot->metadata;
+    message.param1 = slot->param1;
+    message.param2 = slot->param2;
+    message.param3 = slot->param3;
+    message.param4 = slot->param4;
+    message.param5 = slot->param5;
+
+    if (__atomic_compare_exchange_n(
+            &MapMailboxHeader(receiver)->receive_read_index, &read_index,
+            read_index + 1, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+      return true;
+  }
+  return false;
+}
+
+// Sends an message to a process. Returns false if the message couldn't be
+// queued because we're out of memory.
+bool SendMessageToProcess(const Message& message, Process* receiver) {
   Thread* waiting_thread = receiver->threads_sleeping_for_message.PopFront();
   if (waiting_thread == nullptr) {
-    // There are no threads waiting for a message, so queue this message.
-    receiver->queued_messages.AddBack(message);
+    // There are no threads waiting for a message. Skip the kernel's queue if
+    // there's room in the process's mailbox. Messages only go into the
+    // mailbox while the queue is empty, so they stay in order.
+    if (receiver->queued_messages.IsEmpty() &&
+        WriteMessageIntoMailbox(message, receiver))
+      return true;
+
+    // Queue this message.
+    Message* queued_message = ObjectPool<Message>::Allocate();
+    if (queued_message == nullptr) return false;
+    CopyMessage(message, *queued_message);
+    receiver->queued_messages.AddBack(queued_message);
     receiver->messages_queued++;
-  } else {
-    // Sanity checks.
-    if (receiver->messages_queued != 0) {
-      print
-          << "A thread is sleeping for messages even though there are messages "
-             "queued.\n";
-    }
-    if (!waiting_thread->thread_is_waiting_for_message)
-      print << "thread_is_waiting_for_message == false\n";
-    if (waiting_thread->awake)
-      print << "Thread waiting for message isn't even asleep.\n";
+    return true;
+  }
 
+  // Sanity checks.
+  if (receiver->messages_queued != 0) {
+    print << "A thread is sleeping for messages even though there are messages "
+             "queued.\n";
+  }
+  if (!waiting_thread->thread_is_waiting_for_message)
+    print << "thread_is_waiting_for_message == false\n";
+  if (waiting_thread->awake)
+    print << "Thread waiting for message isn't even asleep.\n";
+
+  if (waiting_thread->thread_is_waiting_for_message_in_mailbox) {
+    // The mailbox was empty when the thread went to sleep, so there's room.
+    waiting_thread->registers.rax =
+        WriteMessageIntoMailbox(message, receiver) ? 1 : 0;
+  } else {
     LoadMessageIntoThread(message, waiting_thread);
-
-    // Wake up the thread.
-    waiting_thread->thread_is_waiting_for_message = false;
-    ScheduleThread(waiting_thread);
   }
+
+  // Wake up the thread.
+  waiting_thread->thread_is_waiting_for_message = false;
+  waiting_thread->thread_is_waiting_for_message_in_mailbox = false;
+  ScheduleThread(waiting_thread);
+  return true;
 }
 
 // Can this process receive an message?
@@ -66,65 +186,32 @@ bool CanProcessReceiveMessage(Process* receiver) {
   return receiver->messages_queued < MAX_EVENTS_QUEUED;
 }
 
-}  // namespace
-
-// Sends a message from the kernel to a process. The message will be ignored on
-// an error.
-void SendKernelMessageToProcess(Process* receiver_process, size_t event_id,
-                                size_t param1, size_t param2, size_t param3,
-                                size_t param4, size_t param5) {
-  // Check that the receiver's queue is not full.
-  if (!CanProcessReceiveMessage(receiver_process)) return;
-
-  Message* message = ObjectPool<Message>::Allocate();
-  if (message == nullptr) return;
-
-  // Creates the message from the parameters.
-  message->message_id = event_id;
-  message->sender_pid = 0;
-  message->metadata = 0;
-  message->param1 = param1;
-  message->param2 = param2;
-  message->param3 = param3;
-  message->param4 = param4;
-  message->param5 = param5;
-
-  // Send the message to the receiver.
-  SendMessageToProcess(message, receiver_process);
+// Undoes creating an RPC because the call couldn't be sent.
+void ReleaseUnsentRpc(RPC* rpc) {
+  rpc->caller->rpcs_this_process_is_waiting_on.Remove(rpc);
+  rpc->caller->rpc_count--;
+  rpc->callee->rpcs_waiting_on_this_process.Remove(rpc);
+  ObjectPool<RPC>::Release(rpc);
 }
 
-// Sends an RPC response from the kernel to a process.
-void SendKernelRpcResponse(Process* receiver_process,
-                           size_t response_message_id, size_t callee_pid,
-                           size_t status) {
-  Message* message = ObjectPool<Message>::Allocate();
-  if (message == nullptr) return;
-
-  message->message_id = response_message_id;
-  message->sender_pid = callee_pid;
-  message->metadata = 2;  // Message type RESPONSE (10)
-  message->param1 = status;
-  message->param2 = 0xFFFFFFFF;
-  message->param3 = 0;
-  message->param4 = 0;
-  message->param5 = 0;
+// Sends a message from a process.
+Status SendMessageFromProcess(Process* sender_process,
+                              const MailboxMessage& outgoing) {
+  size_t message_type = outgoing.metadata & 3;
 
-  SendMessageToProcess(message, receiver_process);
-}
-
-// Sends an message from a thread. This is intended to be called from within a
-// syscall.
-void SendMessageFromThreadSyscall(Thread* sender_thread) {
-  Process* sender_process = sender_thread->process;
-  Registers& registers = sender_thread->registers;
-
-  size_t message_type = registers.rdx & 3;
+  Message message;
+  message.sender_pid = sender_process->pid;
+  message.metadata = outgoing.metadata;
+  message.param2 = outgoing.param2;
+  message.param3 = outgoing.param3;
+  message.param4 = outgoing.param4;
+  message.param5 = outgoing.param5;
 
   if (message_type == 2) {
     // Response to a call. Look up the message ID in
     // rpcs_waiting_on_this_process.
-    size_t synthetic_response_message_id = registers.rax;
-    size_t caller_pid = registers.rbx;
+    size_t synthetic_response_message_id = outgoing.message_id;
+    size_t caller_pid = outgoing.pid;
 
     RPC* candidate =
         sender_process->rpcs_waiting_on_this_process.SearchForItemEqualToValue(
@@ -134,10 +221,7 @@ void SendMessageFromThreadSyscall(Thread* sender_thread) {
       matching_rpc = candidate;
     }
 
-    if (matching_rpc == nullptr) {
-      registers.rax = (size_t)Status::RESPONDING_TO_INVALID_RPC;
-      return;
-    }
+    if (matching_rpc == nullptr) return Status::RESPONDING_TO_INVALID_RPC;
 
     Process* receiver_process = matching_rpc->caller;
     size_t expected_message_id = matching_rpc->response_message_id;
@@ -146,72 +230,43 @@ void SendMessageFromThreadSyscall(Thread* sender_thread) {
     sender_process->rpcs_waiting_on_this_process.Remove(matching_rpc);
     ObjectPool<RPC>::Release(matching_rpc);
 
-    Message* message = ObjectPool<Message>::Allocate();
-    if (message == nullptr) {
-      registers.rax = (size_t)Status::OUT_OF_MEMORY;
-      return;
-    }
-
-    message->message_id = expected_message_id;
-    message->sender_pid = sender_process->pid;
-    message->metadata = registers.rdx;
-    message->param1 = registers.rsi;
-    message->param2 = registers.r8;
-    message->param3 = registers.r9;
-    message->param4 = registers.r10;
-    message->param5 = registers.r12;
-
-    registers.rax = (size_t)Status::OK;
-    SendMessageToProcess(message, receiver_process);
-    return;
+    message.message_id = expected_message_id;
+    message.param1 = outgoing.param1;
+    if (!SendMessageToProcess(message, receiver_process))
+      return Status::OUT_OF_MEMORY;
+    return Status::OK;
   }
 
   // Find the receiver process, which maybe ourselves.
-  Process* receiver_process = (registers.rbx == sender_process->pid)
+  Process* receiver_process = (outgoing.pid == sender_process->pid)
                                   ? sender_process
-                                  : GetProcessFromPid(registers.rbx);
+                                  : GetProcessFromPid(outgoing.pid);
 
   if (receiver_process == nullptr) {
     // Error, process doesn't exist.
-    registers.rax = (size_t)Status::PROCESS_DOESNT_EXIST;
-    return;
+    return Status::PROCESS_DOESNT_EXIST;
   }
 
   if (message_type == 1 && sender_process->rpc_count >= 1024) {
     // Call that will expect a response.
-    registers.rax = (size_t)Status::SENDERS_QUEUE_IS_FULL;
-    return;
+    return Status::SENDERS_QUEUE_IS_FULL;
   }
 
   if (!CanProcessReceiveMessage(receiver_process)) {
     // Error, the receiver's queue is full.
     print << sender_process->name << " can't send to " << receiver_process->name
           << " because the message queue is full.\n";
-    registers.rax = (size_t)Status::RECEIVERS_QUEUE_IS_FULL;
-    return;
+    return Status::RECEIVERS_QUEUE_IS_FULL;
   }
 
   RPC* rpc = nullptr;
   if (message_type == 1) {
     rpc = ObjectPool<RPC>::Allocate();
-    if (rpc == nullptr) {
-      registers.rax = (size_t)Status::OUT_OF_MEMORY;
-      return;
-    }
-  }
-
-  Message* message = ObjectPool<Message>::Allocate();
-  if (message == nullptr) {
-    if (rpc != nullptr) ObjectPool<RPC>::Release(rpc);
-    // Error, out of memory.
-    registers.rax = (size_t)Status::OUT_OF_MEMORY;
-    return;
-  }
+    if (rpc == nullptr) return Status::OUT_OF_MEMORY;
 
-  if (rpc != nullptr) {
     rpc->caller = sender_process;
     rpc->callee = receiver_process;
-    rpc->response_message_id = registers.rsi;
+    rpc->response_message_id = outgoing.param1;
     rpc->synthetic_response_message_id =
         receiver_process->next_synthetic_rpc_response_message_id++;
     sender_process->rpcs_this_process_is_waiting_on.AddBack(rpc);
@@ -219,22 +274,81 @@ void SendMessageFromThreadSyscall(Thread* sender_thread) {
     receiver_process->rpcs_waiting_on_this_process.Insert(rpc);
   }
 
-  // Reads the message from the registers.
-  message->message_id = registers.rax;
-  message->sender_pid = sender_process->pid;
-  message->metadata = registers.rdx;
-  message->param1 =
-      rpc != nullptr ? rpc->synthetic_response_message_id : registers.rsi;
-  message->param2 = registers.r8;
-  message->param3 = registers.r9;
-  message->param4 = registers.r10;
-  message->param5 = registers.r12;
+  message.message_id = outgoing.message_id;
+  message.param1 =
+      rpc != nullptr ? rpc->synthetic_response_message_id : outgoing.param1;
+
+  // Send the message to the receiver.
+  if (!SendMessageToProcess(message, receiver_process)) {
+    // Error, out of memory.
+    if (rpc != nullptr) ReleaseUnsentRpc(rpc);
+    return Status::OUT_OF_MEMORY;
+  }
+  return Status::OK;
+}
+
+}  // namespace
+
+// Sends a message from the kernel to a process. The message will be ignored on
+// an error.
+void SendKernelMessageToProcess(Process* receiver_process, size_t event_id,
+                                size_t param1, size_t param2, size_t param3,
+                                size_t param4, size_t param5) {
+  // Check that the receiver's queue is not full.
+  if (!CanProcessReceiveMessage(receiver_process)) return;
+
+  // Creates the message from the parameters.
+  Message message;
+  message.message_id = event_id;
+  message.sender_pid = 0;
+  message.metadata = 0;
+  message.param1 = param1;
+  message.param2 = param2;
+  message.param3 = param3;
+  message.param4 = param4;
+  message.param5 = param5;
 
   // Send the message to the receiver.
-  registers.rax = (size_t)Status::OK;
   SendMessageToProcess(message, receiver_process);
 }
 
+// Sends an RPC response from the kernel to a process.
+void SendKernelRpcResponse(Process* receiver_process,
+                           size_t response_message_id, size_t callee_pid,
+                           size_t status) {
+  Message message;
+  message.message_id = response_message_id;
+  message.sender_pid = callee_pid;
+  message.metadata = 2;  // Message type RESPONSE (10)
+  message.param1 = status;
+  message.param2 = 0xFFFFFFFF;
+  message.param3 = 0;
+  message.param4 = 0;
+  message.param5 = 0;
+
+  SendMessageToProcess(message, receiver_process);
+}
+
+// Sends an message from a thread. This is intended to be called from within a
+// syscall.
+void SendMessageFromThreadSyscall(Thread* sender_thread) {
+  Registers& registers = sender_thread->registers;
+
+  // Reads the message from the registers.
+  MailboxMessage outgoing;
+  outgoing.message_id = registers.rax;
+  outgoing.pid = registers.rbx;
+  outgoing.metadata = registers.rdx;
+  outgoing.param1 = registers.rsi;
+  outgoing.param2 = registers.r8;
+  outgoing.param3 = registers.r9;
+  outgoing.param4 = registers.r10;
+  outgoing.param5 = registers.r12;
+
+  registers.rax =
+      (size_t)SendMessageFromProcess(sender_thread->process, outgoing);
+}
+
 // Gets the next message queued for a process. Returns nullptr if there are no
 // messages queued.
 Message* GetNextQueuedMessage(Process* receiver) {
@@ -247,13 +361,21 @@ Message* GetNextQueuedMessage(Process* receiver) {
 
 // Loads the next queued message for the process into the thread.
 void LoadNextMessageIntoThread(Thread* thread) {
-  Message* message = GetNextQueuedMessage(thread->process);
-  if (message == nullptr) {
+  // Messages in the mailbox are older than those queued in the kernel.
+  Message message;
+  if (ReadMessageFromMailbox(thread->process, message)) {
+    LoadMessageIntoThread(message, thread);
+    return;
+  }
+
+  Message* queued_message = GetNextQueuedMessage(thread->process);
+  if (queued_message == nullptr) {
     // There is no message queued.
     thread->registers.rax = ID_FOR_NO_EVENTS;
   } else {
     // There is a message to load.
-    LoadMessageIntoThread(message, thread);
+    LoadMessageIntoThread(*queued_message, thread);
+    ObjectPool<Message>::Release(queued_message);
   }
 }
 
@@ -266,7 +388,8 @@ bool SleepThreadUntilMessage(Thread* thread) {
   }
 
   // Check if there is an message queued.
-  if (!thread->process->queued_messages.IsEmpty()) {
+  if (!thread->process->queued_messages.IsEmpty() ||
+      GetUnreadMessagesInMailbox(thread->process) > 0) {
     LoadNextMessageIntoThread(thread);
     return false;
   }
@@ -279,3 +402,133 @@ bool SleepThreadUntilMessage(Thread* thread) {
   UnscheduleThread(thread);
   return true;
 }
+
+// Returns the address of the process's mailbox, creating it if it doesn't
+// exist yet. Returns 0 if it couldn't be created.
+size_t GetOrCreateMessageMailbox(Process* process) {
+  if (process->message_mailbox_address != 0)
+    return process->message_mailbox_address;
+
+  for (size_t page = 0; page < MESSAGE_MAILBOX_PAGES; page++) {
+    size_t physical_page = GetPhysicalPage();
+    if (physical_page == OUT_OF_PHYSICAL_PAGES) {
+      for (size_t i = 0; i < page; i++)
+        FreePhysicalPage(process->message_mailbox_physical_pages[i]);
+      return 0;
+    }
+    memset((char*)TemporarilyMapPhysicalPages(physical_page,
+                                              MAILBOX_TEMPORARY_MAPPING_INDEX),
+           0, PAGE_SIZE);
+    process->message_mailbox_physical_pages[page] = physical_page;
+  }
+
+  size_t address = process->virtual_address_space.FindAndReserveFreePageRange(
+      MESSAGE_MAILBOX_PAGES);
+  if (address == OUT_OF_MEMORY) {
+    for (size_t page = 0; page < MESSAGE_MAILBOX_PAGES; page++)
+      FreePhysicalPage(process->message_mailbox_physical_pages[page]);
+    return 0;
+  }
+
+  // The kernel owns the pages, so they outlive the process's address space
+  // until ReleaseMessageMailbox().
+  for (size_t page = 0; page < MESSAGE_MAILBOX_PAGES; page++) {
+    process->virtual_address_space.MapPhysicalPageAt(
+        address + page * PAGE_SIZE,
+        process->message_mailbox_physical_pages[page], /*own=*/false,
+        /*can_write=*/true, /*throw_exception_on_access=*/false);
+  }
+
+  process->message_mailbox_address = address;
+  process->message_mailbox_write_index = 0;
+  return address;
+}
+
+// Frees the process's mailbox.
+void ReleaseMessageMailbox(Process* process) {
+  if (process->message_mailbox_address == 0) return;
+  for (size_t page = 0; page < MESSAGE_MAILBOX_PAGES; page++)
+    FreePhysicalPage(process->message_mailbox_physical_pages[page]);
+  process->message_mailbox_address = 0;
+}
+
+// Returns the number of messages in the process's receive ring that the
+// process hasn't read yet.
+size_t GetUnreadMessagesInMailbox(Process* process) {
+  if (process->message_mailbox_address == 0) return 0;
+  size_t read_index = __atomic_load_n(
+      &MapMailboxHeader(process)->receive_read_index, __ATOMIC_ACQUIRE);
+  size_t unread = process->message_mailbox_write_index - read_index;
+  // The process controls the read index, so don't trust it.
+  return unread > MESSAGE_MAILBOX_RECEIVE_SLOTS ? MESSAGE_MAILBOX_RECEIVE_SLOTS
+                                                : unread;
+}
+
+// Sends the messages in the thread's process's mailbox. This is intended to be
+// called from within a syscall.
+void SendMessagesFromThreadSyscall(Thread* sender_thread) {
+  Process* sender_process = sender_thread->process;
+  Registers& registers = sender_thread->registers;
+
+  if (sender_process->message_mailbox_address == 0) {
+    registers.rax = 0;
+    registers.rbx = (size_t)Status::INVALID_ARGUMENT;
+    return;
+  }
+
+  size_t count = registers.rax;
+  if (count > MESSAGE_MAILBOX_SEND_SLOTS) count = MESSAGE_MAILBOX_SEND_SLOTS;
+
+  // Stop at the first message that fails, so the process can retry from there.
+  size_t sent = 0;
+  Status status = Status::OK;
+  for (; sent < count; sent++) {
+    // Copy the message out of the mailbox, because sending could reuse the
+    // temporary mapping and the process could be modifying it.
+    MailboxMessage outgoing = *MapMailboxSlot(sender_process,
+                                              MAILBOX_SEND_SLOT + sent);
+    status = SendMessageFromProcess(sender_process, outgoing);
+    if (status != Status::OK) break;
+  }
+
+  registers.rax = sent;
+  registers.rbx = (size_t)status;
+}
+
+// Moves messages queued in the kernel into the mailbox. If there are no
+// messages and `sleep` is true, sleeps the thread until there are. Returns true
+// if the thread is now asleep.
+bool ReceiveMessagesIntoMailbox(Thread* thread, bool sleep) {
+  Process* process = thread->process;
+  if (process->message_mailbox_address == 0) {
+    thread->registers.rax = 0;
+    return false;
+  }
+
+  // Move as many queued messages as will fit into the mailbox.
+  while (Message* queued_message = process->queued_messages.FirstItem()) {
+    if (!WriteMessageIntoMailbox(*queued_message, process)) break;
+    process->queued_messages.PopFront();
+    process->messages_queued--;
+    ObjectPool<Message>::Release(queued_message);
+  }
+
+  size_t unread = GetUnreadMessagesInMailbox(process);
+  if (unread > 0 || !sleep) {
+    thread->registers.rax = unread;
+    return false;
+  }
+
+  if (!thread->awake || thread->thread_is_waiting_for_message) {
+    print << "Can't sleep a thread that is already asleep.\n";
+    thread->registers.rax = 0;
+    return false;
+  }
+
+  // Sleep until a message is written into the mailbox.
+  process->threads_sleeping_for_message.AddBack(thread);
+  thread->thread_is_waiting_for_message = true;
+  thread->thread_is_waiting_for_message_in_mailbox = true;
+  UnscheduleThread(thread);
+  return true;
+}
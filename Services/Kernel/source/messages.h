@@ -22,6 +22,49 @@ struct Message {
   LinkedListNode node;
 };
 
+// The number of pages in a process's message mailbox.
+#define MESSAGE_MAILBOX_PAGES 3
+
+// The number of messages the mailbox's receive ring holds. Must be a power of
+// 2.
+#define MESSAGE_MAILBOX_RECEIVE_SLOTS 128
+
+// The most messages that can be sent with one SendMessages syscall.
+#define MESSAGE_MAILBOX_SEND_SLOTS 63
+
+// A message in a process's mailbox. The mailbox is shared with user space, so
+// this layout must not change.
+struct MailboxMessage {
+  // ID of the message.
+  size_t message_id;
+  // The sender's PID when receiving, or the receiver's PID when sending.
+  size_t pid;
+  // Message metadata.
+  size_t metadata;
+  // Parameters:
+  size_t param1;
+  size_t param2;
+  size_t param3;
+  size_t param4;
+  size_t param5;
+};
+
+// The start of a process's mailbox. It is followed by the receive ring of
+// MESSAGE_MAILBOX_RECEIVE_SLOTS messages, and then the MESSAGE_MAILBOX_SEND_SLOTS
+// messages to send with SendMessages.
+struct MessageMailboxHeader {
+  // The total number of messages the kernel has written into the receive ring.
+  // Only written by the kernel.
+  volatile size_t receive_write_index;
+  // The total number of messages read from the receive ring. The process
+  // advances it while draining the ring, and so does the kernel when a message
+  // is received through the old syscalls, so both sides only advance it with a
+  // compare-and-swap.
+  volatile size_t receive_read_index;
+  // Pads the header to the size of a message.
+  size_t reserved[6];
+};
+
 struct Process;
 struct Thread;
 
@@ -50,3 +93,25 @@ bool SleepThreadUntilMessage(Thread* thread);
 // Gets the next message queued for a process. Returns nullptr if there are no
 // messages queued.
 Message* GetNextQueuedMessage(Process* receiver);
+
+// Returns the address of the process's mailbox, creating it if it doesn't
+// exist yet. Returns 0 if it couldn't be created. Once a process has a mailbox,
+// messages are written into its receive ring whenever there's room, rather
+// than being queued in the kernel.
+size_t GetOrCreateMessageMailbox(Process* process);
+
+// Frees the process's mailbox.
+void ReleaseMessageMailbox(Process* process);
+
+// Returns the number of messages in the process's receive ring that the
+// process hasn't read yet.
+size_t GetUnreadMessagesInMailbox(Process* process);
+
+// Sends the messages in the thread's process's mailbox. This is intended to be
+// called from within a syscall.
+void SendMessagesFromThreadSyscall(Thread* sender_thread);
+
+// Moves messages queued in the kernel into the mailbox. If there are no
+// messages and `sleep` is true, sleeps the thread until there are. Returns true
+// if the thread is now asleep.
+bool ReceiveMessagesIntoMailbox(Thread* thread, bool sleep);
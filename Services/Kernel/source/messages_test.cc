@@ -155,3 +155,86 @@ TEST(MessagesSyscallPagingTransferTest) {
   DestroyProcess(p1);
   DestroyProcess(p2);
 }
+
+TEST(MessagesMailboxTest) {
+  InitializeObjectPools();
+  InitializeProcesses();
+  InitializeThreads();
+  InitializeVirtualAllocator();
+
+  Process* p1 = CreateTestProcess("Process1");
+  Process* p2 = CreateTestProcess("Process2");
+  Thread* t1 = CreateThread(p1, 0x1000, 0);
+  Thread* t2 = CreateThread(p2, 0x2000, 0);
+
+  ASSERT(GetOrCreateMessageMailbox(p1) != 0, true);
+  size_t mailbox_address = GetOrCreateMessageMailbox(p2);
+  ASSERT(mailbox_address != 0, true);
+  ASSERT(GetOrCreateMessageMailbox(p2), mailbox_address);
+  ASSERT(p2->virtual_address_space.GetPhysicalAddress(mailbox_address, false),
+         p2->message_mailbox_physical_pages[0]);
+
+  MessageMailboxHeader* header =
+      (MessageMailboxHeader*)TemporarilyMapPhysicalPages(
+          p2->message_mailbox_physical_pages[0], 0);
+  MailboxMessage* receive_ring = (MailboxMessage*)header + 1;
+
+  // Messages skip the kernel's queue and go into the mailbox.
+  Registers& regs_t1 = t1->registers;
+  regs_t1.rbx = p2->pid;
+  regs_t1.rax = 777;
+  regs_t1.rdx = 0;
+  regs_t1.rsi = 111;
+  SendMessageFromThreadSyscall(t1);
+  ASSERT(regs_t1.rax, (size_t)0);
+  ASSERT(p2->messages_queued, (size_t)0);
+  ASSERT(header->receive_write_index, (size_t)1);
+  ASSERT(receive_ring[0].message_id, (size_t)777);
+  ASSERT(receive_ring[0].pid, p1->pid);
+  ASSERT(receive_ring[0].param1, (size_t)111);
+  ASSERT(GetUnreadMessagesInMailbox(p2), (size_t)1);
+
+  // Fill up the ring, then the next messages are queued in the kernel.
+  for (size_t i = 1; i < MESSAGE_MAILBOX_RECEIVE_SLOTS + 2; i++) {
+    SendKernelMessageToProcess(p2, 1000 + i, i, 0, 0, 0, 0);
+  }
+  ASSERT(GetUnreadMessagesInMailbox(p2), (size_t)MESSAGE_MAILBOX_RECEIVE_SLOTS);
+  ASSERT(p2->messages_queued, (size_t)2);
+
+  // The process reads some messages, then the queued messages are moved into
+  // the ring in order.
+  header->receive_read_index = 3;
+  ASSERT(ReceiveMessagesIntoMailbox(t2, /*sleep=*/true), false);
+  ASSERT(t2->registers.rax, (size_t)MESSAGE_MAILBOX_RECEIVE_SLOTS - 1);
+  ASSERT(p2->messages_queued, (size_t)0);
+  ASSERT(receive_ring[0].message_id,
+         (size_t)1000 + MESSAGE_MAILBOX_RECEIVE_SLOTS);
+  ASSERT(receive_ring[1].message_id,
+         (size_t)1000 + MESSAGE_MAILBOX_RECEIVE_SLOTS + 1);
+
+  // The old syscalls read from the mailbox first.
+  LoadNextMessageIntoThread(t2);
+  ASSERT(t2->registers.rax, (size_t)1003);
+  ASSERT(header->receive_read_index, (size_t)4);
+
+  // Send a batch of messages from p1's mailbox. The send slots come after the
+  // header and the receive ring, which is 1 message into the third page.
+  header->receive_read_index = header->receive_write_index;
+  MailboxMessage* send_slots =
+      (MailboxMessage*)TemporarilyMapPhysicalPages(
+          p1->message_mailbox_physical_pages[2], 0) +
+      1;
+  for (size_t i = 0; i < 3; i++) {
+    send_slots[i].message_id = 2000 + i;
+    send_slots[i].pid = i == 2 ? 12345 : p2->pid;
+    send_slots[i].metadata = 0;
+  }
+  regs_t1.rax = 3;
+  SendMessagesFromThreadSyscall(t1);
+  ASSERT(regs_t1.rax, (size_t)2);
+  ASSERT(regs_t1.rbx, (size_t)Status::PROCESS_DOESNT_EXIST);
+  ASSERT(GetUnreadMessagesInMailbox(p2), (size_t)2);
+
+  DestroyProcess(p1);
+  DestroyProcess(p2);
+}
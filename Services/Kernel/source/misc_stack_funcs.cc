@@ -23,6 +23,7 @@ uint64 __stack_chk_guard = STACK_CHK_GUARD;
 __attribute__((noreturn)) void __stack_chk_fail(void) {
   asm volatile("cli");
   print << "Stack smashing detected.";
+  FlushPrinter();
   for (;;) {
     asm volatile("hlt");
   }
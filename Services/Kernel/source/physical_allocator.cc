@@ -2,6 +2,8 @@
 #include "physical_allocator.h"
 
 #include "../../../third_party/multiboot2.h"
+#include "buddy_allocator.h"
+#include "cpu.h"
 #include "io.h"
 #include "object_pool.h"
 #include "object_pools.h"
@@ -14,11 +16,63 @@ extern size_t bssEnd;
 
 namespace {
 
-// Physical memory is divided into 4kb pages. A linked stack of them is kept,
-// allowing pages to be popped off and pushed onto it. This pointer points to
-// the top of the stack (next free page), and the first thing in that page will
-// be a pointer to the next page.
-size_t next_free_page_address;
+// A range of physical memory that the bootloader said is available.
+struct AvailableMemoryRegion {
+  // The first byte of the region.
+  size_t start;
+  // The byte after the end of the region.
+  size_t end;
+};
+
+// The maximum number of available memory regions that are tracked.
+constexpr int kMaxAvailableMemoryRegions = 32;
+
+// The available memory regions, after the memory used at boot. Pages are taken
+// from the front of these until the buddy allocator is initialized, then
+// whatever is left is given to the buddy allocator.
+AvailableMemoryRegion available_memory_regions[kMaxAvailableMemoryRegions];
+
+// The number of entries in available_memory_regions.
+int available_memory_region_count;
+
+// The region that pages are currently being taken from.
+int current_available_memory_region;
+
+// The number of pages in each CPU's hot page cache.
+constexpr size_t kHotPageCacheSize = 64;
+
+// The number of pages moved between a hot page cache and the buddy allocator at
+// a time.
+constexpr size_t kHotPageCacheBatch = 32;
+
+// A cache of recently freed pages that belongs to a CPU. Most allocations are
+// of single pages with no restriction on where they are, and these are served
+// from the cache without touching the buddy allocator's free lists.
+struct HotPageCache {
+  // The number of pages in the cache.
+  size_t count;
+  // The page numbers of the cached pages.
+  size_t pages[kHotPageCacheSize];
+};
+
+// Each CPU's hot page cache. Indexed by Cpu::id.
+HotPageCache hot_page_caches[MAX_CORES];
+
+// The allocator that owns all free pages that aren't in a hot page cache.
+BuddyAllocator buddy_allocator;
+
+// Has the buddy allocator been initialized? Until then, pages are taken from
+// the available memory regions.
+bool buddy_allocator_is_initialized;
+
+// The number of pages covered by the buddy allocator.
+size_t physical_page_count;
+
+// The physical address of the buddy allocator's PhysicalPageInfo array.
+size_t page_metadata_physical_address;
+
+// The number of pages the PhysicalPageInfo array takes up.
+size_t page_metadata_pages;
 // Before virtual memory is set up, the temporary paging system set up in
 // boot.asm only associates the maps the first 8MB of physical memory into
 // virtual memory. The multiboot structure can be quite huge (especially if
@@ -39,6 +93,86 @@ uint64 SafeReadUint64(uint64 *value) {
                                                                  0);
 }
 
+// Takes the next page from the available memory regions, returns
+// OUT_OF_PHYSICAL_PAGES if there are none left.
+size_t TakePageFromAvailableMemoryRegions() {
+  while (current_available_memory_region < available_memory_region_count) {
+    AvailableMemoryRegion &region =
+        available_memory_regions[current_available_memory_region];
+    if (region.start < region.end) {
+      size_t page_addr = region.start;
+      region.start += PAGE_SIZE;
+      return page_addr;
+    }
+    current_available_memory_region++;
+  }
+  return OUT_OF_PHYSICAL_PAGES;
+}
+
+// Takes `pages` contiguous pages from the end of an available memory region
+// large enough to hold them, returns OUT_OF_PHYSICAL_PAGES if there is no
+// region big enough.
+size_t TakeContiguousPagesFromAvailableMemoryRegions(size_t pages) {
+  // Search from the top of memory to leave the DMA32 zone for those who need
+  // it.
+  for (int i = available_memory_region_count - 1;
+       i >= current_available_memory_region; i--) {
+    AvailableMemoryRegion &region = available_memory_regions[i];
+    if ((region.end - region.start) / PAGE_SIZE >= pages) {
+      region.end -= pages * PAGE_SIZE;
+      return region.end;
+    }
+  }
+  return OUT_OF_PHYSICAL_PAGES;
+}
+
+// Moves up to `pages` pages from the hot page cache back to the buddy
+// allocator.
+void DrainHotPageCache(HotPageCache &cache, size_t pages) {
+  for (; pages > 0 && cache.count > 0; pages--)
+    buddy_allocator.Free(cache.pages[--cache.count], 0);
+}
+
+// Moves every CPU's hot page cache back to the buddy allocator, so the pages in
+// them can be merged into larger blocks.
+void DrainAllHotPageCaches() {
+  for (int i = 0; i < MAX_CORES; i++)
+    DrainHotPageCache(hot_page_caches[i], kHotPageCacheSize);
+}
+
+// Takes a free page at or below the max base address, without clearing it.
+// Returns OUT_OF_PHYSICAL_PAGES if there are no suitable free pages.
+size_t TakePhysicalPage(size_t max_base_address) {
+  if (!buddy_allocator_is_initialized) {
+    size_t page_addr = TakePageFromAvailableMemoryRegions();
+    return page_addr <= max_base_address ? page_addr : OUT_OF_PHYSICAL_PAGES;
+  }
+
+  size_t max_page = max_base_address / PAGE_SIZE;
+  if (max_page < physical_page_count) {
+    // Only some pages will do, so go straight to the buddy allocator.
+    size_t page = buddy_allocator.Allocate(0, max_page);
+    return page == kNoPhysicalPage ? OUT_OF_PHYSICAL_PAGES : page * PAGE_SIZE;
+  }
+
+  HotPageCache &cache = hot_page_caches[GetCurrentCpu()->id];
+  if (cache.count == 0) {
+    // Refill the cache in a batch.
+    for (; cache.count < kHotPageCacheBatch; cache.count++) {
+      size_t page = buddy_allocator.Allocate(0, physical_page_count - 1);
+      if (page == kNoPhysicalPage) break;
+      cache.pages[cache.count] = page;
+    }
+    if (cache.count == 0) return OUT_OF_PHYSICAL_PAGES;
+  }
+  return cache.pages[--cache.count] * PAGE_SIZE;
+}
+
+// Clears a physical page, so nothing is leaked from another process.
+void ClearPhysicalPage(size_t addr) {
+  memset((char *)TemporarilyMapPhysicalPages(addr, 5), 0, PAGE_SIZE);
+}
+
 // Calculates the start of the free memory at boot.
 void CalculateStartOfFreeMemoryAtBoot() {
   start_of_free_memory_at_boot = (size_t)&bssEnd;
@@ -101,15 +235,15 @@ size_t start_of_free_memory_at_boot;
 void InitializePhysicalAllocator() {
   total_system_memory = 0;
   free_pages = 0;
+  available_memory_region_count = 0;
+  current_available_memory_region = 0;
+  buddy_allocator_is_initialized = false;
   CalculateStartOfFreeMemoryAtBoot();
 
-  // Initialize the stack to OUT_OF_PHYSICAL_PAGES, then pages will be pushed
-  // onto the stack As
-  next_free_page_address = OUT_OF_PHYSICAL_PAGES;
-
   // The multiboot bootloader (GRUB) already did the hard work of asking the
   // BIOS what physical memory is available. The bootloader puts this
   // information into the multiboot header.
+  size_t end_of_memory = 0;
 
   // Loop through each of the tags in the multiboot.
   multiboot_tag *tag;
@@ -158,29 +292,69 @@ void InitializePhysicalAllocator() {
           start = (start + PAGE_SIZE - 1) &
                   ~(PAGE_SIZE - 1);  // Round up to page size.
 
-          // Now divide this memory up into pages and iterate through
-          // them.
-          size_t page_addr;
-          for (page_addr = start; page_addr < end; page_addr += PAGE_SIZE) {
-            // Push this page onto the linked stack.
-
-            // Map this physical memory, so can write the previous stack page to
-            // it.
-            size_t *bp = (size_t *)TemporarilyMapPhysicalMemoryPreVirtualMemory(
-                page_addr, 0);
+          if (start >= end) continue;
 
-            // Write the previous stack head to the start of this page.
-            *bp = next_free_page_address;
-            // Sets the stack head to this page.
-            next_free_page_address = page_addr;
-
-            free_pages++;
-            total_system_memory += PAGE_SIZE;
+          if (available_memory_region_count == kMaxAvailableMemoryRegions) {
+            print << "Too many memory regions, ignoring "
+                  << NumberFormat::Hexidecimal << start << " -> " << end
+                  << '\n';
+            continue;
           }
+
+          available_memory_regions[available_memory_region_count++] = {
+              .start = start, .end = end};
+          free_pages += (end - start) / PAGE_SIZE;
+          total_system_memory += end - start;
+          if (end > end_of_memory) end_of_memory = end;
         }
       }
     }
   }
+
+  // Reserve memory for the metadata of every page up to the end of memory.
+  physical_page_count = end_of_memory / PAGE_SIZE;
+  if (physical_page_count > kNoPhysicalPage) {
+    print << "Only the first 16 TB of physical memory will be used.\n";
+    physical_page_count = kNoPhysicalPage;
+  }
+  page_metadata_pages =
+      (physical_page_count * sizeof(PhysicalPageInfo) + PAGE_SIZE - 1) /
+      PAGE_SIZE;
+  page_metadata_physical_address =
+      TakeContiguousPagesFromAvailableMemoryRegions(page_metadata_pages);
+  if (page_metadata_physical_address == OUT_OF_PHYSICAL_PAGES) {
+    print << "Can't find " << page_metadata_pages
+          << " contiguous pages for the physical page metadata.\n";
+  } else {
+    free_pages -= page_metadata_pages;
+  }
+}
+
+void InitializePhysicalPageFreeLists() {
+  if (page_metadata_physical_address == OUT_OF_PHYSICAL_PAGES) return;
+
+  size_t page_metadata = KernelAddressSpace().MapPhysicalPages(
+      page_metadata_physical_address, page_metadata_pages);
+  if (page_metadata == OUT_OF_MEMORY) {
+    print << "Can't map the physical page metadata.\n";
+    return;
+  }
+
+  buddy_allocator.Initialize((PhysicalPageInfo *)page_metadata,
+                             physical_page_count);
+  buddy_allocator_is_initialized = true;
+  for (int i = 0; i < MAX_CORES; i++) hot_page_caches[i].count = 0;
+
+  // Hand over what is left of the available memory regions.
+  for (; current_available_memory_region < available_memory_region_count;
+       current_available_memory_region++) {
+    AvailableMemoryRegion &region =
+        available_memory_regions[current_available_memory_region];
+    if (region.start >= region.end) continue;
+    buddy_allocator.FreeRange(region.start / PAGE_SIZE,
+                              (region.end - region.start) / PAGE_SIZE);
+    region.start = region.end;
+  }
 }
 
 // Indicates that the multiboot memory is no longer needed and can be
@@ -207,19 +381,8 @@ void DoneWithMultibootMemory() {
 // allocator is initialized), returns OUT_OF_PHYSICAL_PAGES if there are no more
 // physical pages.
 size_t GetPhysicalPagePreVirtualMemory() {
-  if (next_free_page_address == OUT_OF_PHYSICAL_PAGES) {
-    // No more free pages.
-    return OUT_OF_PHYSICAL_PAGES;
-  }
-  // Take the top page from the stack.
-  size_t addr = next_free_page_address & 0x000FFFFFFFFFFFFFL & ~(PAGE_SIZE - 1);
-  // Pop it from the stack by mapping the page to physical memory so the
-  // pointer to the next free page can be grabbed.
-  size_t *bp = (size_t *)TemporarilyMapPhysicalMemoryPreVirtualMemory(addr, 0);
-  next_free_page_address = *bp;
-
-  free_pages--;
-
+  size_t addr = TakePageFromAvailableMemoryRegions();
+  if (addr != OUT_OF_PHYSICAL_PAGES) free_pages--;
   return addr;
 }
 
@@ -230,84 +393,68 @@ size_t GetPhysicalPage() {
 }
 
 size_t GetPhysicalPageAtOrBelowAddress(size_t max_base_address) {
-  bool cleaned_up = false;
-retry:
-  if (next_free_page_address == OUT_OF_PHYSICAL_PAGES) {
-    if (cleaned_up) return OUT_OF_PHYSICAL_PAGES;
+  size_t addr = TakePhysicalPage(max_base_address);
+  if (addr == OUT_OF_PHYSICAL_PAGES) {
+    // Try to free up some memory and try again.
     CleanUpObjectPools();
-    cleaned_up = true;
-    if (next_free_page_address == OUT_OF_PHYSICAL_PAGES) {
-      return OUT_OF_PHYSICAL_PAGES;
-    }
+    if (buddy_allocator_is_initialized) DrainAllHotPageCaches();
+    addr = TakePhysicalPage(max_base_address);
+    if (addr == OUT_OF_PHYSICAL_PAGES) return OUT_OF_PHYSICAL_PAGES;
   }
 
-  // Take the top page from the stack.
-  size_t addr = next_free_page_address & 0x000FFFFFFFFFFFFFL & ~(PAGE_SIZE - 1);
+  ClearPhysicalPage(addr);
+  free_pages--;
+  return addr;
+}
 
-  size_t *bp;
+size_t GetContiguousPhysicalPages(size_t pages, size_t max_base_address) {
+  if (pages == 0 || !buddy_allocator_is_initialized)
+    return OUT_OF_PHYSICAL_PAGES;
 
-  if (addr <= max_base_address) {
-    // The first address was sufficient. This should be the most common use case,
-    // except for drivers that need a low physical memory address for DMA.
+  size_t order = 0;
+  while (((size_t)1 << order) < pages) order++;
+  if (order > MAX_PAGE_ORDER) return OUT_OF_PHYSICAL_PAGES;
+  size_t block_pages = (size_t)1 << order;
 
-    // Pop it from the stack by mapping the page to physical memory so the
-    // pointer to the next free page can be grabbed.
-    bp = (size_t *)TemporarilyMapPhysicalPages(addr, 5);
-    next_free_page_address = *bp;
-  } else {
-    // Keep walking the stack of free pages until one is found that's below the
-    // max base address. The previous address needs to be remembered so the
-    // pointer in the stack can be updated to skip over the page taken out.
-    size_t previous_addr;
-    size_t *previous_bp = nullptr;
-    do {
-      // Walk to the next page.
-      previous_addr = addr;
-      previous_bp = (size_t *)TemporarilyMapPhysicalPages(addr, 5);
-      addr = *previous_bp & 0x000FFFFFFFFFFFFFL & ~(PAGE_SIZE - 1);
-
-      if (addr == OUT_OF_PHYSICAL_PAGES) {
-        if (!cleaned_up) {
-          CleanUpObjectPools();
-          cleaned_up = true;
-          goto retry;
-        }
-        return OUT_OF_PHYSICAL_PAGES;
-      }
-    } while (addr > max_base_address);
-    // Loop while current addr is too high.
+  // The unused tail of the block is given back, so only the pages that are kept
+  // need to be at or below the max base address.
+  size_t max_page = max_base_address / PAGE_SIZE + (block_pages - pages);
 
-    bp = (size_t *)TemporarilyMapPhysicalPages(addr, 6);
-
-    // Update the previous page to skip over this page.
-    *previous_bp = *bp;
+  size_t first_page = buddy_allocator.Allocate(order, max_page);
+  if (first_page == kNoPhysicalPage) {
+    // Pages sitting in the hot page caches might be holding buddies apart.
+    CleanUpObjectPools();
+    DrainAllHotPageCaches();
+    first_page = buddy_allocator.Allocate(order, max_page);
+    if (first_page == kNoPhysicalPage) return OUT_OF_PHYSICAL_PAGES;
   }
-
-  // Clear out the page, so nothing is leaked from another process.
-  memset((char *)bp, 0, PAGE_SIZE);
-
-  free_pages--;
-
-  return addr;
+  if (block_pages > pages)
+    buddy_allocator.FreeRange(first_page + pages, block_pages - pages);
+
+  size_t first_addr = first_page * PAGE_SIZE;
+  for (size_t i = 0; i < pages; i++)
+    ClearPhysicalPage(first_addr + i * PAGE_SIZE);
+  free_pages -= pages;
+  return first_addr;
 }
 
-
 // Frees a physical page.
 void FreePhysicalPage(size_t addr) {
   // Mask off flags, status bits (e.g. Bit 63), and alignment bits.
   addr &= 0x000FFFFFFFFFFFFFL & ~(PAGE_SIZE - 1);
   if (addr == 0) return;
 
-  // Push this page onto the linked stack.
-
-  // Map this physical memory, so the previous stack page can be written to it.
-  size_t *bp = (size_t *)TemporarilyMapPhysicalPages(addr, 5);
-  // Write the previous stack head to the start of this page.
-  *bp = next_free_page_address;
-
-  // Sets the stack head to this page.
-  next_free_page_address = addr;
+  size_t page = addr / PAGE_SIZE;
+  if (!buddy_allocator_is_initialized || page >= physical_page_count) {
+    print << "Can't free physical page " << NumberFormat::Hexidecimal << addr
+          << '\n';
+    return;
+  }
 
+  HotPageCache &cache = hot_page_caches[GetCurrentCpu()->id];
+  if (cache.count == kHotPageCacheSize)
+    DrainHotPageCache(cache, kHotPageCacheBatch);
+  cache.pages[cache.count++] = page;
   free_pages++;
 }
 
@@ -24,6 +24,12 @@ extern size_t start_of_free_memory_at_boot;
 // Initializes the physical allocator.
 void InitializePhysicalAllocator();
 
+// Builds the free lists that pages are allocated from. Until this is called,
+// pages are handed out in order from the memory that was free at boot. This
+// must be called once the kernel's address space is set up, and before any
+// physical pages are freed.
+void InitializePhysicalPageFreeLists();
+
 // Indicates that we are done with the multiboot memory and that it can be
 // released.
 void DoneWithMultibootMemory();
@@ -41,6 +47,12 @@ size_t GetPhysicalPage();
 // address, returns OUT_OF_PHYSICAL_PAGES if there are no more physical pages.
 size_t GetPhysicalPageAtOrBelowAddress(size_t max_base_address);
 
+// Grabs `pages` physically contiguous pages, all starting at or below the
+// provided physical address, and returns the address of the first page, or
+// OUT_OF_PHYSICAL_PAGES if there isn't a large enough run of free pages. The
+// pages are cleared and can be freed individually with FreePhysicalPage.
+size_t GetContiguousPhysicalPages(size_t pages, size_t max_base_address);
+
 // Frees a physical page.
 void FreePhysicalPage(size_t addr);
 
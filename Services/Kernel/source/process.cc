@@ -68,6 +68,10 @@ size_t last_assigned_pid;
 //  Tree of processes that are running.
 AATree<Process, &Process::node_in_all_processes, &Process::pid> all_processes;
 
+// The slot to use with TemporarilyMapPhysicalPages when copying into a
+// process. Page table walks use the slots below it.
+constexpr size_t kCopyIntoProcessTemporaryMappingIndex = 4;
+
 }  // namespace
 
 // Initializes the internal structures for tracking processes.
@@ -103,6 +107,8 @@ Process* CreateProcess(bool is_driver, bool can_create_processes) {
   proc->child_processes = nullptr;
   proc->next_child_process_in_parent = nullptr;
   proc->messages_queued = 0;
+  proc->message_mailbox_address = 0;
+  proc->message_mailbox_write_index = 0;
   proc->service_count = 0;
   proc->rpc_count = 0;
   proc->next_synthetic_rpc_response_message_id = 0;
@@ -248,6 +254,7 @@ void DestroyProcess(Process* process) {
 
   // Free the address space.
   process->virtual_address_space.~VirtualAddressSpace();
+  ReleaseMessageMailbox(process);
 
   // Free all notifications being waited on for processes to die.
   while (auto* notification =
@@ -388,7 +395,9 @@ void SetChildProcessMemoryPages(Process* parent, Process* child,
     size_t src = source_address + p * PAGE_SIZE;
     size_t dest = destination_address + p * PAGE_SIZE;
 
-    // Get the physical address from the parent.
+    // Get the physical address from the parent, giving it a page first if it
+    // was lazily zeroed and never touched.
+    parent->virtual_address_space.MaybeAllocateLazilyZeroedPage(src);
     size_t page_physical_address =
         parent->virtual_address_space.GetPhysicalAddress(
             src,
@@ -457,6 +466,73 @@ Process* GetNextProcess(Process* process) {
   return all_processes.NextItem(process);
 }
 
+bool CopyIntoProcess(Process* process, size_t address, const void* data,
+                     size_t length) {
+  if (address + length < address) return false;
+
+  VirtualAddressSpace& address_space = process->virtual_address_space;
+  const char* source = (const char*)data;
+  while (length > 0) {
+    size_t offset_in_page = address & (PAGE_SIZE - 1);
+    size_t page = address - offset_in_page;
+    size_t physical_page =
+        address_space.GetPhysicalAddress(page, /*ignore_unowned_pages=*/true);
+    if (physical_page == OUT_OF_MEMORY &&
+        address_space.MaybeAllocateLazilyZeroedPage(page)) {
+      physical_page =
+          address_space.GetPhysicalAddress(page, /*ignore_unowned_pages=*/true);
+    }
+    if (physical_page == OUT_OF_MEMORY) return false;
+
+    size_t bytes = PAGE_SIZE - offset_in_page;
+    if (bytes > length) bytes = length;
+    memcpy((char*)TemporarilyMapPhysicalPages(
+               physical_page, kCopyIntoProcessTemporaryMappingIndex) +
+               offset_in_page,
+           source, bytes);
+
+    address += bytes;
+    source += bytes;
+    length -= bytes;
+  }
+  return true;
+}
+
+size_t GetProcessSnapshots(Process* caller, size_t buffer_address,
+                           size_t max_snapshots, size_t first_pid,
+                           size_t& total_processes) {
+  size_t written = 0;
+  total_processes = 0;
+  bool can_write = true;
+  for (Process* process = GetProcessOrNextFromPid(first_pid);
+       process != nullptr; process = GetNextProcess(process)) {
+    total_processes++;
+    if (!can_write || written == max_snapshots) continue;
+
+    // Catch up the process's lazy CPU percentages for past epochs so they're
+    // accurate when reading them.
+    if (IsCpuTrackingActive()) CatchUpProcessCpuUsage(process);
+
+    ProcessSnapshot snapshot;
+    snapshot.pid = process->pid;
+    memcpy(snapshot.name, process->name, PROCESS_NAME_LENGTH);
+    snapshot.unique_memory =
+        process->virtual_address_space.GetUniquePages() * PAGE_SIZE;
+    snapshot.shared_memory =
+        process->virtual_address_space.GetSharedPages() * PAGE_SIZE;
+    snapshot.creation_timestamp = process->creation_timestamp;
+    snapshot.thread_count = process->thread_count;
+    snapshot.registered_services = process->service_count;
+    snapshot.cpu_usage = CalculateCompactCpuUsage(process);
+
+    can_write = CopyIntoProcess(
+        caller, buffer_address + written * sizeof(ProcessSnapshot), &snapshot,
+        sizeof(ProcessSnapshot));
+    if (can_write) written++;
+  }
+  return written;
+}
+
 void AwakeFutexInProcess(Process* process, size_t address) {
   if (!process->futex_wake_message_id) return;
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "aa_tree.h"
+#include "cpu.h"
 #include "interrupts.h"
 #include "linked_list.h"
 #include "messages.h"
@@ -15,7 +16,6 @@
 
 #define PROCESS_NAME_WORDS 10
 #define PROCESS_NAME_LENGTH (PROCESS_NAME_WORDS * 8)
-#define MAX_CORES 1
 
 struct MessageToFireOnInterrupt;
 struct Message;
@@ -77,6 +77,17 @@ struct Process {
   LinkedList<Thread, &Thread::node_sleeping_for_messages>
       threads_sleeping_for_message;
 
+  // The address of the process's message mailbox, or 0 if it doesn't have
+  // one.
+  size_t message_mailbox_address;
+
+  // The physical pages that make up the message mailbox.
+  size_t message_mailbox_physical_pages[MESSAGE_MAILBOX_PAGES];
+
+  // The kernel's copy of MessageMailboxHeader::receive_write_index, because the
+  // process could overwrite the one in the mailbox.
+  size_t message_mailbox_write_index;
+
   // Linked list of messages to fire on an interrupt.
   LinkedList<MessageToFireOnInterrupt,
              &MessageToFireOnInterrupt::node_in_process>
@@ -235,6 +246,38 @@ void DestroyChildProcess(Process* parent, Process* child);
 // processes.
 Process* GetNextProcess(Process* process);
 
+// A process's entry in the buffer filled by GetProcessSnapshots. The buffer is
+// in user space, so this layout must not change.
+struct ProcessSnapshot {
+  size_t pid;
+  // Not null terminated if the name is PROCESS_NAME_LENGTH characters long.
+  char name[PROCESS_NAME_LENGTH];
+  // Memory used, in bytes.
+  size_t unique_memory;
+  size_t shared_memory;
+  size_t creation_timestamp;
+  size_t thread_count;
+  size_t registered_services;
+  // The recent CPU usage of each core, packed a byte per core like
+  // CalculateCompactCpuUsage.
+  size_t cpu_usage;
+};
+
+// Copies data into memory that a process owns. Returns false if any of the
+// memory isn't owned by the process.
+bool CopyIntoProcess(Process* process, size_t address, const void* data,
+                     size_t length);
+
+// Writes snapshots of up to `max_snapshots` processes, starting with the first
+// process with a PID of at least `first_pid`, into a buffer in `caller`'s
+// memory. Nothing else runs while this does, so the snapshots are consistent
+// with each other. Returns the number of snapshots written, which stops early
+// if the buffer isn't writable, and sets `total_processes` to the number of
+// processes from `first_pid` on, so the caller knows how big a buffer to use.
+size_t GetProcessSnapshots(Process* caller, size_t buffer_address,
+                           size_t max_snapshots, size_t first_pid,
+                           size_t& total_processes);
+
 // Returns if a process is a child of a parent. Also returns false if the child
 // is nullptr.
 bool IsProcessAChildOfParent(Process* parent, Process* child);
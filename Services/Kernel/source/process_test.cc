@@ -12,6 +12,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include "physical_allocator.h"
 #include "process.h"
 #include "service.h"
 #include "virtual_allocator.h"
@@ -65,3 +66,43 @@ TEST(ProcessServicesCountTest) {
 
   DestroyProcess(p1);
 }
+
+TEST(ProcessSnapshotsTest) {
+  InitializeObjectPools();
+  InitializeProcesses();
+  InitializeVirtualAllocator();
+
+  Process* p1 = CreateProcess(false, false);
+  Process* p2 = CreateProcess(false, false);
+  Process* p3 = CreateProcess(false, false);
+  size_t buffer = p1->virtual_address_space.AllocatePages(1);
+
+  // Snapshot every process.
+  size_t total_processes;
+  ASSERT(GetProcessSnapshots(p1, buffer, 3, 0, total_processes), (size_t)3);
+  ASSERT(total_processes, (size_t)3);
+  size_t physical_page =
+      p1->virtual_address_space.GetPhysicalAddress(buffer, false);
+  ProcessSnapshot* snapshots =
+      (ProcessSnapshot*)TemporarilyMapPhysicalPages(physical_page, 0);
+  ASSERT(snapshots[0].pid, p1->pid);
+  ASSERT(snapshots[1].pid, p2->pid);
+  ASSERT(snapshots[2].pid, p3->pid);
+
+  // A smaller buffer still counts every process.
+  ASSERT(GetProcessSnapshots(p1, buffer, 1, p2->pid, total_processes),
+         (size_t)1);
+  ASSERT(total_processes, (size_t)2);
+  snapshots = (ProcessSnapshot*)TemporarilyMapPhysicalPages(physical_page, 0);
+  ASSERT(snapshots[0].pid, p2->pid);
+
+  // Memory the caller doesn't own isn't written to.
+  ASSERT(GetProcessSnapshots(p1, buffer + PAGE_SIZE * 16, 3, 0,
+                             total_processes),
+         (size_t)0);
+  ASSERT(total_processes, (size_t)3);
+
+  DestroyProcess(p3);
+  DestroyProcess(p2);
+  DestroyProcess(p1);
+}
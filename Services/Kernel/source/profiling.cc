@@ -125,11 +125,12 @@ void ProfileEnteringKernelSpaceForEvent(int event_index) {
 
   // The cycles since the CPU switched to user space.
   size_t cycles = GetAndUpdateCyclesSinceLastTransition();
-  if (running_thread == nullptr) {
+  Thread* thread = GetRunningThread();
+  if (thread == nullptr) {
     // There are no running threads, so the cycles are counted as "idle" time.
     idle_cycles_while_profiling_is_enabled += cycles;
   } else {
-    running_thread->process->cycles_spent_executing_while_profiled += cycles;
+    thread->process->cycles_spent_executing_while_profiled += cycles;
   }
 }
 
@@ -2,6 +2,7 @@
 #include "scheduler.h"
 
 #include "../../../Libraries/perception/public/perception/tracing.h"
+#include "cpu.h"
 #include "heap_allocator.h"
 #include "interrupts.h"
 #include "linked_list.h"
@@ -14,21 +15,23 @@
 #include "virtual_address_space.h"
 #include "virtual_allocator.h"
 
-// The currently executing thread. This can be nullptr if all threads are
-// asleep.
-Thread* running_thread;
+namespace {
 
-// Currently executing registers.
-Registers* currently_executing_thread_regs;
+// The threads that are ready to run on a CPU.
+struct RunQueue {
+  // Ready queues for each of the 6 priority levels.
+  LinkedList<Thread, &Thread::node_in_scheduler>
+      ready_queues[kThreadPriorityCount];
 
-namespace {
+  // Epoch credits remaining for proportional ready queues (Queues 2 to 4).
+  int queue_credits[kThreadPriorityCount];
 
-// Ready queues for each of the 6 priority levels.
-LinkedList<Thread, &Thread::node_in_scheduler>
-    ready_queues[kThreadPriorityCount];
+  // The number of awake threads in this run queue.
+  int awake_thread_count;
+};
 
-// Epoch credits remaining for proportional ready queues (Queues 2 to 4).
-int queue_credits[kThreadPriorityCount];
+// The run queue of each CPU, indexed by Cpu::id.
+RunQueue run_queues[MAX_CORES];
 
 // Base weights allocated to proportional ready queues (Queues 2 to 4).
 constexpr int kBaseCredits[kThreadPriorityCount] = {
@@ -43,15 +46,14 @@ constexpr int kBaseCredits[kThreadPriorityCount] = {
 // The currently focused process (elevated dynamically).
 Process* focused_process = nullptr;
 
-// The number of currently awake threads in the scheduler.
-int awake_thread_count = 0;
-
-// The idle registers to return to when no thread is awake. (This points to
-// the while(true) {hlt} in kmain.)
-Registers* idle_regs;
+// Returns the run queue for a CPU.
+RunQueue& RunQueueForCpu(Cpu* cpu) { return run_queues[cpu->id]; }
 
 // Returns the next thread to run. Returns nullptr if there is no thread.
-Thread* PickNextThread() {
+Thread* PickNextThread(RunQueue& run_queue) {
+  auto& ready_queues = run_queue.ready_queues;
+  auto& queue_credits = run_queue.queue_credits;
+
   // If there are any drivers then realtime services to run, pick the top most.
   for (int i = 0; i < 2; i++) {
     if (!ready_queues[i].IsEmpty()) return ready_queues[i].FirstItem();
@@ -98,21 +100,113 @@ Thread* PickNextThread() {
   return nullptr;
 }
 
+// Returns the number of threads queued on a CPU that are waiting to run.
+int CountWaitingThreads(Cpu* cpu) {
+  int waiting = RunQueueForCpu(cpu).awake_thread_count;
+  if (cpu->current_thread != nullptr && cpu->current_thread->awake) waiting--;
+  return waiting;
+}
+
+// Adds an awake thread to a CPU's run queue.
+void AddToRunQueue(Thread* thread, Cpu* cpu) {
+  thread->cpu = cpu;
+  RunQueue& run_queue = RunQueueForCpu(cpu);
+  run_queue.ready_queues[static_cast<int>(thread->priority)].AddBack(thread);
+  run_queue.awake_thread_count++;
+}
+
+// Removes an awake thread from its CPU's run queue.
+void RemoveFromRunQueue(Thread* thread) {
+  RunQueue& run_queue = RunQueueForCpu(thread->cpu);
+  run_queue.ready_queues[static_cast<int>(thread->priority)].Remove(thread);
+  run_queue.awake_thread_count--;
+}
+
+// Picks which CPU a thread that just woke up should run on. Threads stay on the
+// CPU they last ran on, since its caches are warm, unless another CPU has less
+// work queued. New threads go to the least loaded CPU.
+Cpu* ChooseCpuForThread(Thread* thread) {
+  Cpu* previous_cpu = thread->cpu;
+  if (previous_cpu != nullptr) {
+    // The thread might still be running on its CPU if it was put to sleep by
+    // another CPU and then woken up before its CPU rescheduled.
+    if (previous_cpu->current_thread == thread) return previous_cpu;
+    if (RunQueueForCpu(previous_cpu).awake_thread_count == 0)
+      return previous_cpu;
+  }
+
+  Cpu* least_loaded_cpu =
+      previous_cpu != nullptr ? previous_cpu : GetCurrentCpu();
+  int least_load = RunQueueForCpu(least_loaded_cpu).awake_thread_count;
+  ForEachOnlineCpu([&](Cpu* cpu) {
+    int load = RunQueueForCpu(cpu).awake_thread_count;
+    if (load < least_load) {
+      least_loaded_cpu = cpu;
+      least_load = load;
+    }
+  });
+  return least_loaded_cpu;
+}
+
+// Steals a waiting thread from the busiest CPU and moves it onto this CPU's
+// run queue. Returns nullptr if no other CPU has a thread waiting to run.
+Thread* StealThread(Cpu* this_cpu) {
+  Cpu* busiest_cpu = nullptr;
+  int busiest_waiting_threads = 0;
+  ForEachOnlineCpu([&](Cpu* cpu) {
+    if (cpu == this_cpu) return;
+    int waiting_threads = CountWaitingThreads(cpu);
+    if (waiting_threads > busiest_waiting_threads) {
+      busiest_cpu = cpu;
+      busiest_waiting_threads = waiting_threads;
+    }
+  });
+  if (busiest_cpu == nullptr) return nullptr;
+
+  // Take the highest priority thread that isn't running.
+  RunQueue& busiest_run_queue = RunQueueForCpu(busiest_cpu);
+  for (int p = 0; p < kThreadPriorityCount; p++) {
+    for (Thread* thread : busiest_run_queue.ready_queues[p]) {
+      if (thread == busiest_cpu->current_thread) continue;
+      RemoveFromRunQueue(thread);
+      AddToRunQueue(thread, this_cpu);
+      return thread;
+    }
+  }
+  return nullptr;
+}
+
+// Changes the priority of a thread, moving it between ready queues if it's
+// awake.
+void ChangeThreadPriority(Thread* thread, ThreadPriority priority) {
+  bool was_awake = thread->awake;
+  if (was_awake) {
+    RunQueueForCpu(thread->cpu)
+        .ready_queues[static_cast<int>(thread->priority)]
+        .Remove(thread);
+  }
+
+  thread->priority = priority;
+
+  if (was_awake) {
+    RunQueueForCpu(thread->cpu)
+        .ready_queues[static_cast<int>(thread->priority)]
+        .AddBack(thread);
+  }
+}
+
 }  // namespace
 
 void InitializeScheduler() {
-  for (int i = 0; i < kThreadPriorityCount; i++) {
-    new (&ready_queues[i]) LinkedList<Thread, &Thread::node_in_scheduler>();
-    queue_credits[i] = kBaseCredits[i];
-  }
-  awake_thread_count = 0;
-  currently_executing_thread_regs = (Registers*)malloc(sizeof(Registers));
-  if (!currently_executing_thread_regs) {
-    print << "Could not allocate object to store the kernel's registers.";
-    __asm__ __volatile__("cli");
-    __asm__ __volatile__("hlt");
+  for (int c = 0; c < MAX_CORES; c++) {
+    RunQueue& run_queue = run_queues[c];
+    for (int i = 0; i < kThreadPriorityCount; i++) {
+      new (&run_queue.ready_queues[i])
+          LinkedList<Thread, &Thread::node_in_scheduler>();
+      run_queue.queue_credits[i] = kBaseCredits[i];
+    }
+    run_queue.awake_thread_count = 0;
   }
-  idle_regs = currently_executing_thread_regs;
 }
 
 #ifdef ENABLE_TRACING
@@ -152,25 +246,29 @@ void EmitContextSwitchTrace(Thread* prev, Thread* next) {
 
 // Schedule the next thread.
 void ScheduleNextThread() {
+  Cpu* cpu = GetCurrentCpu();
+  RunQueue& run_queue = RunQueueForCpu(cpu);
   UpdateRunningThreadTimeslice();
 
 #ifdef ENABLE_TRACING
-  Thread* prev = running_thread;
+  Thread* prev = GetRunningThread();
 #endif
 
-  if (running_thread) {
-    if (running_thread->uses_fpu_registers)
-      SaveFpuState(running_thread->fpu_registers);
+  if (GetRunningThread()) {
+    if (GetRunningThread()->uses_fpu_registers)
+      SaveFpuState(GetRunningThread()->fpu_registers);
 
     // Rotate the ready queue so the current thread goes to the back.
-    if (running_thread->awake) {
-      int p = static_cast<int>(running_thread->priority);
-      ready_queues[p].Remove(running_thread);
-      ready_queues[p].AddBack(running_thread);
+    if (GetRunningThread()->awake) {
+      int p = static_cast<int>(GetRunningThread()->priority);
+      run_queue.ready_queues[p].Remove(GetRunningThread());
+      run_queue.ready_queues[p].AddBack(GetRunningThread());
     }
   }
 
-  Thread* next = PickNextThread();
+  Thread* next = PickNextThread(run_queue);
+  // Help out other CPUs if there is nothing to do on this one.
+  if (!next) next = StealThread(cpu);
   if (!next) {
 #ifdef ENABLE_TRACING
     if (prev != nullptr) {
@@ -178,8 +276,8 @@ void ScheduleNextThread() {
     }
 #endif
     // If there's no next thread, return to the kernel's idle thread.
-    running_thread = 0;
-    currently_executing_thread_regs = idle_regs;
+    SetRunningThread(0);
+    SetCurrentThreadRegisters(&cpu->idle_registers);
     KernelAddressSpace().SwitchToAddressSpace();
     return;
   }
@@ -191,38 +289,49 @@ void ScheduleNextThread() {
 #endif
 
   // Enter the next thread.
-  running_thread = next;
-  running_thread->time_slices++;
-  if (running_thread->remaining_timeslice_microseconds == 0) {
-    running_thread->remaining_timeslice_microseconds = 10000;
+  SetRunningThread(next);
+  GetRunningThread()->time_slices++;
+  if (GetRunningThread()->remaining_timeslice_microseconds == 0) {
+    GetRunningThread()->remaining_timeslice_microseconds = 10000;
   }
-  running_thread->current_run_start_timestamp =
+  GetRunningThread()->current_run_start_timestamp =
       GetCurrentTimestampInMicroseconds();
 
-  running_thread->process->virtual_address_space.SwitchToAddressSpace();
+  GetRunningThread()->process->virtual_address_space.SwitchToAddressSpace();
 
-  if (running_thread->uses_fpu_registers)
-    RestoreFpuState(running_thread->fpu_registers);
-  LoadThreadSegment(running_thread);
+  if (GetRunningThread()->uses_fpu_registers)
+    RestoreFpuState(GetRunningThread()->fpu_registers);
+  LoadThreadSegment(GetRunningThread());
 
-  currently_executing_thread_regs = &running_thread->registers;
+  SetCurrentThreadRegisters(&GetRunningThread()->registers);
 }
 
 void ScheduleThread(Thread* thread) {
   if (thread->awake) return;
   thread->awake = true;
-  awake_thread_count++;
 
-  int p = static_cast<int>(thread->priority);
-  ready_queues[p].AddBack(thread);
+  Cpu* cpu = ChooseCpuForThread(thread);
+  AddToRunQueue(thread, cpu);
 
-  // Check if the current thread should be preempted.
-  if (running_thread && (p < static_cast<int>(running_thread->priority))) {
+  // Check if the thread running on the CPU should be preempted.
+  int p = static_cast<int>(thread->priority);
+  Thread* running = cpu->current_thread;
+  bool should_preempt = false;
+  if (running && (p < static_cast<int>(running->priority))) {
     // Preempt if strict priority class or if queue has remaining credits.
-    if (p < 2 || queue_credits[p] > 0) ScheduleNextThread();
+    should_preempt = p < 2 || RunQueueForCpu(cpu).queue_credits[p] > 0;
   }
 
-  ReprogramTimerForNextDeadline();
+  if (cpu == GetCurrentCpu()) {
+    if (should_preempt) ScheduleNextThread();
+    ReprogramTimerForNextDeadline();
+  } else if (running == nullptr || should_preempt) {
+    // Wake up the CPU if it's halted.
+    RequestRescheduleOnCpu(cpu);
+  } else if (NeedsTimesliceInterrupt(running)) {
+    // The CPU may need to start timeslicing now that another thread is queued.
+    SendInterprocessorInterruptToCpu(cpu);
+  }
 }
 
 void UnscheduleThread(Thread* thread) {
@@ -230,12 +339,11 @@ void UnscheduleThread(Thread* thread) {
 
   UpdateRunningThreadTimeslice();
 
-  int p = static_cast<int>(thread->priority);
-  ready_queues[p].Remove(thread);
+  RemoveFromRunQueue(thread);
   thread->awake = false;
-  awake_thread_count--;
 
-  if (thread == running_thread) ScheduleNextThread();
+  Cpu* cpu = thread->cpu;
+  if (thread == cpu->current_thread) RequestRescheduleOnCpu(cpu);
 
   ReprogramTimerForNextDeadline();
 }
@@ -249,18 +357,7 @@ void SetThreadPriority(Thread* thread, ThreadPriority priority_input) {
 
   if (thread->priority == target_priority) return;
 
-  bool was_awake = thread->awake;
-  if (was_awake) {
-    int p = static_cast<int>(thread->priority);
-    ready_queues[p].Remove(thread);
-  }
-
-  thread->priority = target_priority;
-
-  if (was_awake) {
-    int p = static_cast<int>(thread->priority);
-    ready_queues[p].AddBack(thread);
-  }
+  ChangeThreadPriority(thread, target_priority);
 }
 
 void SetFocusedProcess(Process* process) {
@@ -269,16 +366,8 @@ void SetFocusedProcess(Process* process) {
   // Revert old focused threads back to Normal.
   if (focused_process != nullptr) {
     for (Thread* t : focused_process->threads) {
-      if (t->priority == ThreadPriority::InteractiveApp) {
-        bool was_awake = t->awake;
-        if (was_awake) {
-          ready_queues[static_cast<int>(t->priority)].Remove(t);
-        }
-        t->priority = ThreadPriority::Normal;
-        if (was_awake) {
-          ready_queues[static_cast<int>(t->priority)].AddBack(t);
-        }
-      }
+      if (t->priority == ThreadPriority::InteractiveApp)
+        ChangeThreadPriority(t, ThreadPriority::Normal);
     }
   }
 
@@ -287,16 +376,8 @@ void SetFocusedProcess(Process* process) {
   // Elevate new focused threads with Normal priority to InteractiveApp
   if (focused_process != nullptr) {
     for (Thread* t : focused_process->threads) {
-      if (t->priority == ThreadPriority::Normal) {
-        bool was_awake = t->awake;
-        if (was_awake) {
-          ready_queues[static_cast<int>(t->priority)].Remove(t);
-        }
-        t->priority = ThreadPriority::InteractiveApp;
-        if (was_awake) {
-          ready_queues[static_cast<int>(t->priority)].AddBack(t);
-        }
-      }
+      if (t->priority == ThreadPriority::Normal)
+        ChangeThreadPriority(t, ThreadPriority::InteractiveApp);
     }
   }
 
@@ -305,11 +386,14 @@ void SetFocusedProcess(Process* process) {
 
 Process* GetFocusedProcess() { return focused_process; }
 
-bool HasAwakeThreads() { return awake_thread_count > 0; }
+bool HasAwakeThreads() {
+  return RunQueueForCpu(GetCurrentCpu()).awake_thread_count > 0;
+}
 
 bool NeedsTimesliceInterrupt(Thread* thread) {
   if (thread == nullptr) return false;
 
+  auto& ready_queues = RunQueueForCpu(thread->cpu).ready_queues;
   int p = static_cast<int>(thread->priority);
   if (p == 0 || p == 1 || p == 5) {
     // Drivers, Realtime services, and Idle threads only need timeslices if
@@ -333,7 +417,29 @@ bool NeedsTimesliceInterrupt(Thread* thread) {
 // Schedules a thread if the CPU is currently halted - such as an interrupt
 // woke up a thread.
 void ScheduleThreadIfWeAreHalted() {
-  if (running_thread == nullptr) ScheduleNextThread();
+  if (GetRunningThread() == nullptr) ScheduleNextThread();
+}
+
+void StopThreadFromRunning(Thread* thread) {
+  Cpu* cpu = thread->cpu;
+  if (cpu == nullptr || cpu->current_thread != thread) return;
+
+  if (cpu == GetCurrentCpu()) {
+    // The caller will schedule the next thread.
+    SetRunningThread(nullptr);
+    SetCurrentThreadRegisters(&cpu->idle_registers);
+    return;
+  }
+
+  // Once the other CPU is waiting to enter the kernel, its thread's registers
+  // have been saved and it won't touch the thread again.
+  WaitForCpuToEnterKernel(cpu);
+  cpu->current_thread = nullptr;
+  cpu->current_registers = &cpu->idle_registers;
+  // The thread's address space might be about to be destroyed. This forces the
+  // CPU to reload CR3 when it next switches address spaces.
+  cpu->current_address_space = nullptr;
+  cpu->current_thread_was_evicted = true;
 }
 
 #endif  // TEST
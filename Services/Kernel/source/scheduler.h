@@ -1,4 +1,5 @@
 #pragma once
+#include "cpu.h"
 #include "types.h"
 
 struct Thread;
@@ -16,16 +17,29 @@ enum class ThreadPriority : uint8 {
 
 constexpr int kThreadPriorityCount = 6;
 
-// The currently running thread.
-extern Thread *running_thread;
+// Returns the thread running on this CPU, or nullptr if it's idle.
+inline Thread* GetRunningThread() { return GetCurrentCpu()->current_thread; }
 
-// Currently executing registers.
-extern Registers *currently_executing_thread_regs;
+// Sets the thread running on this CPU.
+inline void SetRunningThread(Thread* thread) {
+  GetCurrentCpu()->current_thread = thread;
+}
+
+// Returns the registers of what's executing on this CPU, which are the idle
+// registers if no thread is running.
+inline Registers* GetCurrentThreadRegisters() {
+  return GetCurrentCpu()->current_registers;
+}
+
+// Sets the registers of what's executing on this CPU.
+inline void SetCurrentThreadRegisters(Registers* registers) {
+  GetCurrentCpu()->current_registers = registers;
+}
 
 // Initializes the scheduler.
 void InitializeScheduler();
 
-// Schedule the next thread, called from the timer inerrupt.
+// Schedule the next thread on this CPU, called from the timer inerrupt.
 void ScheduleNextThread();
 
 void ScheduleThread(Thread *thread);
@@ -37,6 +51,8 @@ void SetThreadPriority(Thread* thread, ThreadPriority priority);
 // Focused process elevation interface for Window Manager.
 void SetFocusedProcess(Process* process);
 Process* GetFocusedProcess();
+
+// Returns whether there are awake threads queued on this CPU.
 bool HasAwakeThreads();
 
 // Returns whether the running thread needs a timeslice interrupt.
@@ -44,4 +60,8 @@ bool NeedsTimesliceInterrupt(Thread* thread);
 
 // Schedules a thread if we are currently halted - such as an interrupt
 // woke up a thread.
-void ScheduleThreadIfWeAreHalted();
\ No newline at end of file
+void ScheduleThreadIfWeAreHalted();
+
+// Makes sure that a thread that is about to be destroyed isn't running on any
+// CPU.
+void StopThreadFromRunning(Thread* thread);
\ No newline at end of file
@@ -17,6 +17,7 @@
 #include "aa_tree.h"
 #include "heap_allocator.h"
 #include "linked_list.h"
+#include "memory.h"
 #include "messages.h"
 #include "object_pool.h"
 #include "physical_allocator.h"
@@ -149,7 +150,7 @@ bool SleepThreadUntilSharedMemoryPageIsCreatedAndNotifyCreator(
   if (shared_memory->physical_pages[page] != OUT_OF_PHYSICAL_PAGES)
     return true;  // The memory is already allocated. Nothing to wait for.
 
-  Thread* thread = running_thread;
+  Thread* thread = GetRunningThread();
 
   auto waiting_thread =
       ObjectPool<ThreadWaitingForSharedMemoryPage>::Allocate();
@@ -188,7 +189,7 @@ void MapPhysicalPageInSharedMemory(SharedMemory* shared_memory, size_t page,
       Process* process = shared_memory_in_process->process;
       size_t virtual_address =
           shared_memory_in_process->virtual_address + offset_of_page_in_bytes;
-      process->virtual_address_space.ReleasePages(virtual_address, 1);
+      UnmapSharedMemoryPage(process, virtual_address);
     }
   } else {
     allocated_shared_pages++;
@@ -404,6 +405,8 @@ void MovePageIntoSharedMemory(Process* process, size_t shared_memory_id,
                               size_t offset_in_buffer, size_t page_address) {
   if (process == nullptr) return;
 
+  // A lazily zeroed page needs a physical page before it can be moved.
+  process->virtual_address_space.MaybeAllocateLazilyZeroedPage(page_address);
   size_t physical_address =
       process->virtual_address_space.GetPhysicalAddress(page_address, true);
   if (physical_address == OUT_OF_MEMORY)
@@ -439,7 +442,7 @@ void MovePageIntoSharedMemory(Process* process, size_t shared_memory_id,
 }
 
 bool MaybeHandleSharedMessagePageFault(size_t address) {
-  if (running_thread == nullptr) {
+  if (GetRunningThread() == nullptr) {
     // This exception occured in the kernel.
     return false;
   }
@@ -447,7 +450,7 @@ bool MaybeHandleSharedMessagePageFault(size_t address) {
   // Round address down to the page it's in.
   address &= ~(PAGE_SIZE - 1);
 
-  Process* process = running_thread->process;
+  Process* process = GetRunningThread()->process;
 
   // Search the tree for the closest virtual address mapped block.
   SharedMemoryInProcess* shared_memory_in_process =
@@ -475,6 +478,78 @@ bool MaybeHandleSharedMessagePageFault(size_t address) {
   return false;
 }
 
+bool MaybeHandleCopyOnWritePageFault(size_t address) {
+  if (GetRunningThread() == nullptr) {
+    // This exception occured in the kernel.
+    return false;
+  }
+
+  // Round address down to the page it's in.
+  address &= ~(PAGE_SIZE - 1);
+
+  Process* process = GetRunningThread()->process;
+  SharedMemoryInProcess* shared_memory_in_process =
+      process->joined_shared_memories.SearchForItemLessThanOrEqualToValue(
+          address);
+  if (shared_memory_in_process == nullptr) return false;
+
+  SharedMemory* shared_memory = shared_memory_in_process->shared_memory;
+  if ((shared_memory->flags & SM_COPY_ON_WRITE) == 0 ||
+      shared_memory->creator_pid == process->pid)
+    return false;
+
+  size_t page_in_shared_memory =
+      (address - shared_memory_in_process->virtual_address) / PAGE_SIZE;
+  if (page_in_shared_memory >= shared_memory_in_process->mapped_pages)
+    return false;
+
+  size_t shared_physical_address =
+      shared_memory->physical_pages[page_in_shared_memory];
+  if (shared_physical_address == OUT_OF_PHYSICAL_PAGES) return false;
+
+  VirtualAddressSpace& address_space = process->virtual_address_space;
+  if (address_space.GetPhysicalAddress(address,
+                                       /*ignore_unowned_pages=*/false) !=
+      shared_physical_address) {
+    // Another thread in this process may have already copied the page, in
+    // which case the faulting instruction can retry against the private copy.
+    return address_space.GetPhysicalAddress(address,
+                                            /*ignore_unowned_pages=*/true) !=
+           OUT_OF_MEMORY;
+  }
+
+  size_t private_physical_address = GetPhysicalPage();
+  if (private_physical_address == OUT_OF_PHYSICAL_PAGES)
+    return false;  // Out of memory.
+
+  memcpy((char*)TemporarilyMapPhysicalPages(private_physical_address, 5),
+         (const char*)TemporarilyMapPhysicalPages(shared_physical_address, 6),
+         PAGE_SIZE);
+
+  // Swap the shared page for the private copy.
+  address_space.ReleasePages(address, 1);
+  if (!address_space.ReserveAddressRange(address, 1) ||
+      !address_space.MapPhysicalPageAt(address, private_physical_address,
+                                       /*own=*/true, /*can_write=*/true,
+                                       /*throw_exception_on_access=*/false)) {
+    FreePhysicalPage(private_physical_address);
+    return false;
+  }
+  return true;
+}
+
+void UnmapSharedMemoryPage(Process* process, size_t virtual_address) {
+  VirtualAddressSpace& address_space = process->virtual_address_space;
+  if (address_space.GetPhysicalAddress(virtual_address,
+                                       /*ignore_unowned_pages=*/true) !=
+      OUT_OF_MEMORY) {
+    // The process has its own copy of this page.
+    address_space.FreePages(virtual_address, 1);
+  } else {
+    address_space.ReleasePages(virtual_address, 1);
+  }
+}
+
 bool IsAddressAllocatedInSharedMemory(size_t shared_memory_id,
                                       size_t offset_in_shared_memory) {
   return GetPhysicalAddressOfPageInSharedMemory(shared_memory_id,
@@ -510,9 +585,11 @@ void GrantPermissionToAllocateIntoSharedMemory(Process* grantor,
 bool CanProcessWriteToSharedMemory(Process* process,
                                    SharedMemory* shared_memory) {
   // Either the shared memory is writable by everyone, or this process is the
-  // creator of the shared memory.
-  return ((shared_memory->flags & SM_JOINERS_CAN_WRITE) != 0) ||
-         shared_memory->creator_pid == process->pid;
+  // creator of the shared memory. Joiners of copy-on-write shared memory only
+  // write to their own copies of pages.
+  if (shared_memory->creator_pid == process->pid) return true;
+  return (shared_memory->flags & SM_JOINERS_CAN_WRITE) != 0 &&
+         (shared_memory->flags & SM_COPY_ON_WRITE) == 0;
 }
 
 // Gets information about a shared memory buffer as it pertains to a processes.
@@ -650,9 +727,9 @@ void UnregisterSharedMemoryEvent(Process* process, size_t shared_memory_id,
 }
 
 void TriggerSharedMemoryEvent(size_t shared_memory_id, size_t offset) {
-  if (running_thread != nullptr &&
-      FindSharedMemoryInProcess(running_thread->process, shared_memory_id) ==
-          nullptr) {
+  Thread* thread = GetRunningThread();
+  if (thread != nullptr &&
+      FindSharedMemoryInProcess(thread->process, shared_memory_id) == nullptr) {
     return;  // Caller is not joined to this shared memory block.
   }
   SharedMemory* shared_memory = GetSharedMemoryFromId(shared_memory_id);
@@ -32,6 +32,10 @@ struct SharedMemoryInProcess;
 // Can joiners (not the creator of the shared memory) write to it?
 #define SM_JOINERS_CAN_WRITE (1 << 1)
 
+// Do joiners get their own private copy of a page the first time they write to
+// it? The shared pages themselves are read-only to joiners.
+#define SM_COPY_ON_WRITE (1 << 2)
+
 // Shared memory details bitwise flags:
 // Does the shared memory exist?
 #define SMD_EXISTS (1 << 0)
@@ -169,6 +173,16 @@ void MovePageIntoSharedMemory(Process* process, size_t shared_memory_id,
 // message. Returns if we were able to handle the exception.
 bool MaybeHandleSharedMessagePageFault(size_t address);
 
+// Tries to handle a write to a read-only page if it's in copy-on-write shared
+// memory, by giving the running process its own copy of the page. Returns if
+// we were able to handle the exception, which includes when the process
+// already has its own copy.
+bool MaybeHandleCopyOnWritePageFault(size_t address);
+
+// Unmaps a page of shared memory from a process, freeing it if it's the
+// process's private copy of a copy-on-write page.
+void UnmapSharedMemoryPage(Process* process, size_t virtual_address);
+
 // Does the address exist in the shared memory block and is it allocated? Sets
 // the physical address of the memory page, if it exists.
 bool IsAddressAllocatedInSharedMemory(size_t shared_memory_id,
@@ -16,9 +16,12 @@
 
 #include "messages.h"
 #include "object_pools.h"
+#include "physical_allocator.h"
 #include "process.h"
+#include "scheduler.h"
 #include "shared_memory_event.h"
 #include "testing.h"
+#include "thread.h"
 #include "virtual_allocator.h"
 
 namespace {
@@ -190,3 +193,60 @@ TEST(SharedMemoryManualUnallocationTest) {
   // Verify shared page count did NOT decrease (UnmapVirtualPage did nothing)
   ASSERT(proc->virtual_address_space.GetSharedPages(), (size_t)2);
 }
+
+TEST(SharedMemoryCopyOnWriteTest) {
+  InitializeObjectPools();
+  InitializeProcesses();
+  InitializeVirtualAllocator();
+  InitializeSharedMemory();
+
+  Process* creator = CreateTestProcess("Creator");
+  SharedMemoryInProcess* shm_creator =
+      CreateAndMapSharedMemoryBlockIntoProcess(
+          creator, 2, SM_COPY_ON_WRITE | SM_JOINERS_CAN_WRITE, 0);
+  ASSERT(shm_creator != nullptr, true);
+  SharedMemory* shared_memory = shm_creator->shared_memory;
+  size_t shared_page = shared_memory->physical_pages[0];
+  ((size_t*)TemporarilyMapPhysicalPages(shared_page, 0))[0] = 1234;
+
+  Process* joiner = CreateTestProcess("Joiner");
+  SharedMemoryInProcess* shm_joiner =
+      JoinSharedMemory(joiner, shared_memory->id);
+  ASSERT(shm_joiner != nullptr, true);
+  ASSERT(CanProcessWriteToSharedMemory(joiner, shared_memory), false);
+  size_t address = shm_joiner->virtual_address;
+  ASSERT(joiner->virtual_address_space.GetPhysicalAddress(address, false),
+         shared_page);
+
+  // The creator doesn't copy pages.
+  Thread thread;
+  thread.process = creator;
+  SetRunningThread(&thread);
+  ASSERT(MaybeHandleCopyOnWritePageFault(shm_creator->virtual_address + 8),
+         false);
+
+  // Writing in the joiner gives it its own copy of the page.
+  thread.process = joiner;
+  ASSERT(MaybeHandleCopyOnWritePageFault(address + 8), true);
+  size_t private_page =
+      joiner->virtual_address_space.GetPhysicalAddress(address, true);
+  ASSERT(private_page != OUT_OF_MEMORY, true);
+  ASSERT(private_page != shared_page, true);
+  ASSERT(((size_t*)TemporarilyMapPhysicalPages(private_page, 0))[0],
+         (size_t)1234);
+  ASSERT(joiner->virtual_address_space.GetUniquePages(), (size_t)1);
+
+  // The page is only copied once, but a fault that lost the race to copy it
+  // is still handled.
+  ASSERT(MaybeHandleCopyOnWritePageFault(address), true);
+  ASSERT(joiner->virtual_address_space.GetPhysicalAddress(address, true),
+         private_page);
+  ASSERT(joiner->virtual_address_space.GetUniquePages(), (size_t)1);
+  SetRunningThread(nullptr);
+
+  // Leaving frees the private copy but not the shared page.
+  LeaveSharedMemory(joiner, shared_memory->id);
+  ASSERT(joiner->virtual_address_space.GetUniquePages(), (size_t)0);
+  ASSERT(shared_memory->physical_pages[0], shared_page);
+  LeaveSharedMemory(creator, shared_memory->id);
+}
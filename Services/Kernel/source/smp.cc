@@ -0,0 +1,337 @@
+#ifndef TEST
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "smp.h"
+
+#include "../../../third_party/multiboot2.h"
+#include "ap_trampoline.asm.h"
+#include "cpu.h"
+#include "fpu.h"
+#include "heap_allocator.h"
+#include "idt.h"
+#include "interrupts.asm.h"
+#include "interrupts.h"
+#include "local_apic.h"
+#include "memory.h"
+#include "physical_allocator.h"
+#include "scheduler.h"
+#include "syscall.h"
+#include "text_terminal.h"
+#include "timer.h"
+#include "tss.h"
+#include "virtual_address_space.h"
+#include "virtual_allocator.h"
+
+namespace {
+
+// Where the trampoline is copied to in physical memory. Must match
+// ap_trampoline.asm. Memory below 1 MB isn't given to the physical allocator,
+// so it's free for us to use.
+#define AP_TRAMPOLINE_ADDRESS 0x8000
+
+// The temporary page tables the application processors start with, which
+// identity map the trampoline and share the kernel's upper memory. These follow
+// the trampoline in physical memory.
+#define AP_PML4_ADDRESS 0x9000
+#define AP_PDPT_ADDRESS 0xA000
+#define AP_PD_ADDRESS 0xB000
+#define AP_PT_ADDRESS 0xC000
+
+// The slot to use with TemporarilyMapPhysicalPages.
+#define TEMPORARY_MAPPING_INDEX 7
+
+// What the trampoline's unused processor entries hold as their Local APIC ID.
+// Local APIC IDs from the MADT are only 8 bits.
+#define AP_TRAMPOLINE_UNUSED_LOCAL_APIC_ID (~(size_t)0)
+
+// Page table entry flags.
+#define PAGE_PRESENT_AND_WRITABLE 3
+
+// How long to wait for each application processor to start.
+#define AP_STARTUP_TIMEOUT_MICROSECONDS 100000
+
+// Fields of the ACPI tables we care about.
+#define RSDP_REVISION_OFFSET 15
+#define RSDP_RSDT_ADDRESS_OFFSET 16
+#define RSDP_XSDT_ADDRESS_OFFSET 24
+#define SDT_LENGTH_OFFSET 4
+#define SDT_HEADER_SIZE 36
+#define MADT_ENTRIES_OFFSET 44
+#define MADT_ENTRY_PROCESSOR_LOCAL_APIC 0
+#define MADT_PROCESSOR_ENABLED 1
+
+// Copies `length` bytes starting at the physical address `address`.
+void CopyFromPhysicalMemory(void* destination, size_t address, size_t length) {
+  char* dest = (char*)destination;
+  while (length > 0) {
+    size_t page = address & ~(PAGE_SIZE - 1);
+    size_t offset = address - page;
+    size_t bytes_to_copy = PAGE_SIZE - offset;
+    if (bytes_to_copy > length) bytes_to_copy = length;
+
+    char* source =
+        (char*)TemporarilyMapPhysicalPages(page, TEMPORARY_MAPPING_INDEX);
+    memcpy(dest, source + offset, bytes_to_copy);
+
+    dest += bytes_to_copy;
+    address += bytes_to_copy;
+    length -= bytes_to_copy;
+  }
+}
+
+// Returns the length of the ACPI table at the physical address.
+uint32 GetAcpiTableLength(size_t address) {
+  uint32 length;
+  CopyFromPhysicalMemory(&length, address + SDT_LENGTH_OFFSET, sizeof(length));
+  return length;
+}
+
+// Returns whether the ACPI table at the physical address has the signature.
+bool AcpiTableHasSignature(size_t address, const char* signature) {
+  char table_signature[4];
+  CopyFromPhysicalMemory(table_signature, address, 4);
+  for (int i = 0; i < 4; i++) {
+    if (table_signature[i] != signature[i]) return false;
+  }
+  return true;
+}
+
+// Returns the physical address of the ACPI Multiple APIC Description Table, or
+// 0 if it can't be found.
+size_t FindMadt() {
+  // Now in higher half memory, so VIRTUAL_MEMORY_OFFSET must be added.
+  multiboot_info* higher_half_multiboot_info =
+      (multiboot_info*)((size_t)&MultibootInfo + VIRTUAL_MEMORY_OFFSET);
+
+  // Find the copy of the Root System Description Pointer in the multiboot tags.
+  uint8* rsdp = nullptr;
+  for (multiboot_tag* tag =
+           (multiboot_tag*)(size_t)(higher_half_multiboot_info->addr + 8 +
+                                    VIRTUAL_MEMORY_OFFSET);
+       tag->type != MULTIBOOT_TAG_TYPE_END;
+       tag = (multiboot_tag*)((size_t)tag + (size_t)((tag->size + 7) & ~7))) {
+    if (tag->type == MULTIBOOT_TAG_TYPE_ACPI_NEW) {
+      // Prefer the new RSDP, which might point to the XSDT.
+      rsdp = ((multiboot_tag_new_acpi*)tag)->rsdp;
+    } else if (tag->type == MULTIBOOT_TAG_TYPE_ACPI_OLD && rsdp == nullptr) {
+      rsdp = ((multiboot_tag_old_acpi*)tag)->rsdp;
+    }
+  }
+  if (rsdp == nullptr) return 0;
+
+  // The XSDT has 64-bit pointers to the other tables, the RSDT 32-bit pointers.
+  size_t root_table;
+  size_t pointer_size;
+  if (rsdp[RSDP_REVISION_OFFSET] >= 2) {
+    root_table = *(uint64*)&rsdp[RSDP_XSDT_ADDRESS_OFFSET];
+    pointer_size = 8;
+  } else {
+    root_table = *(uint32*)&rsdp[RSDP_RSDT_ADDRESS_OFFSET];
+    pointer_size = 4;
+  }
+
+  size_t root_table_length = GetAcpiTableLength(root_table);
+  for (size_t offset = SDT_HEADER_SIZE; offset + pointer_size <= root_table_length;
+       offset += pointer_size) {
+    size_t table = 0;
+    CopyFromPhysicalMemory(&table, root_table + offset, pointer_size);
+    if (AcpiTableHasSignature(table, "APIC")) return table;
+  }
+  return 0;
+}
+
+// Busy waits, because interrupts aren't enabled yet.
+void WaitMicroseconds(size_t microseconds) {
+  size_t end = GetCurrentTimestampInMicroseconds() + microseconds;
+  while (GetCurrentTimestampInMicroseconds() < end) asm volatile("pause");
+}
+
+// Returns the trampoline's parameters in low memory.
+ApTrampolineParameterBlock* GetTrampolineParameters() {
+  size_t parameters_offset =
+      (size_t)&ApTrampolineParameters - (size_t)&ApTrampolineStart;
+  return (ApTrampolineParameterBlock*)((size_t)TemporarilyMapPhysicalPages(
+                                           AP_TRAMPOLINE_ADDRESS,
+                                           TEMPORARY_MAPPING_INDEX) +
+                                       parameters_offset);
+}
+
+// Copies the trampoline into low memory and builds the page tables the
+// application processors start with.
+void PrepareTrampoline() {
+  size_t trampoline_size = (size_t)&ApTrampolineEnd - (size_t)&ApTrampolineStart;
+  char* trampoline = (char*)TemporarilyMapPhysicalPages(AP_TRAMPOLINE_ADDRESS,
+                                                        TEMPORARY_MAPPING_INDEX);
+  memcpy(trampoline, &ApTrampolineStart, trampoline_size);
+
+  ApTrampolineParameterBlock* parameters = GetTrampolineParameters();
+  parameters->pml4 = AP_PML4_ADDRESS;
+  parameters->entry_point = (size_t)ApplicationProcessorMain;
+  for (int i = 0; i < MAX_CORES; i++)
+    parameters->processors[i].local_apic_id = AP_TRAMPOLINE_UNUSED_LOCAL_APIC_ID;
+
+  size_t kernel_pml4_entry =
+      ((size_t*)TemporarilyMapPhysicalPages(KernelAddressSpace().GetPML4(),
+                                            TEMPORARY_MAPPING_INDEX))[511];
+
+  // Identity map the trampoline's page, and share the kernel's upper memory.
+  size_t* table = (size_t*)TemporarilyMapPhysicalPages(AP_PML4_ADDRESS,
+                                                       TEMPORARY_MAPPING_INDEX);
+  memset((char*)table, 0, PAGE_SIZE);
+  table[0] = AP_PDPT_ADDRESS | PAGE_PRESENT_AND_WRITABLE;
+  table[511] = kernel_pml4_entry;
+
+  table = (size_t*)TemporarilyMapPhysicalPages(AP_PDPT_ADDRESS,
+                                               TEMPORARY_MAPPING_INDEX);
+  memset((char*)table, 0, PAGE_SIZE);
+  table[0] = AP_PD_ADDRESS | PAGE_PRESENT_AND_WRITABLE;
+
+  table = (size_t*)TemporarilyMapPhysicalPages(AP_PD_ADDRESS,
+                                               TEMPORARY_MAPPING_INDEX);
+  memset((char*)table, 0, PAGE_SIZE);
+  table[0] = AP_PT_ADDRESS | PAGE_PRESENT_AND_WRITABLE;
+
+  table = (size_t*)TemporarilyMapPhysicalPages(AP_PT_ADDRESS,
+                                               TEMPORARY_MAPPING_INDEX);
+  memset((char*)table, 0, PAGE_SIZE);
+  table[AP_TRAMPOLINE_ADDRESS / PAGE_SIZE] =
+      AP_TRAMPOLINE_ADDRESS | PAGE_PRESENT_AND_WRITABLE;
+}
+
+// Returns whether an application processor has started running kernel code.
+bool HasCpuStarted(Cpu* cpu) {
+  return __atomic_load_n(&cpu->startup_state, __ATOMIC_ACQUIRE) ==
+         CpuStartupState::Started;
+}
+
+// Wakes up an application processor and waits for it to start.
+void StartApplicationProcessor(uint32 local_apic_id) {
+  Cpu* cpu = &cpus[online_cpu_count];
+  cpu->self = cpu;
+  cpu->id = online_cpu_count;
+  cpu->local_apic_id = local_apic_id;
+  cpu->current_thread = nullptr;
+  cpu->current_registers = &cpu->idle_registers;
+  cpu->current_address_space = nullptr;
+  cpu->startup_state = CpuStartupState::Starting;
+  InitializeTssForCpu(cpu);
+  AllocateInterruptStack(cpu);
+
+  // Tell the trampoline about this CPU. The entry is never reused, so if this
+  // CPU wakes up after we give up on it, it still finds its own slot.
+  ApTrampolineProcessor* processor =
+      &GetTrampolineParameters()->processors[cpu->id];
+  processor->stack = cpu->interrupt_stack_top;
+  processor->cpu = (size_t)cpu;
+  processor->local_apic_id = local_apic_id;
+
+  // The INIT-SIPI-SIPI sequence. The second startup interrupt is only needed
+  // by some older processors.
+  SendInitInterprocessorInterrupt(local_apic_id);
+  WaitMicroseconds(10000);
+  SendStartupInterprocessorInterrupt(local_apic_id,
+                                     AP_TRAMPOLINE_ADDRESS / PAGE_SIZE);
+  WaitMicroseconds(200);
+  if (!HasCpuStarted(cpu)) {
+    SendStartupInterprocessorInterrupt(local_apic_id,
+                                       AP_TRAMPOLINE_ADDRESS / PAGE_SIZE);
+  }
+
+  size_t timeout =
+      GetCurrentTimestampInMicroseconds() + AP_STARTUP_TIMEOUT_MICROSECONDS;
+  while (!HasCpuStarted(cpu) && GetCurrentTimestampInMicroseconds() < timeout)
+    asm volatile("pause");
+
+  // Give up on the CPU, unless it started just now.
+  CpuStartupState expected = CpuStartupState::Starting;
+  if (__atomic_compare_exchange_n(&cpu->startup_state, &expected,
+                                  CpuStartupState::Abandoned, false,
+                                  __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+    print << "CPU with Local APIC ID " << NumberFormat::Decimal
+          << (size_t)local_apic_id << " didn't start.\n";
+  }
+
+  // Reserve this CPU's slot. It goes online once it enters the kernel. The slot
+  // is kept even if the CPU didn't start, because it might still wake up late
+  // and run on this slot's stack before halting.
+  online_cpu_count++;
+}
+
+}  // namespace
+
+void StartApplicationProcessors() {
+  cpus[0].local_apic_id = GetLocalApicId();
+
+  size_t madt = FindMadt();
+  if (madt == 0) return;
+
+  // Copy the MADT so it's not affected by us reusing the temporary mapping.
+  size_t madt_length = GetAcpiTableLength(madt);
+  uint8* madt_copy = (uint8*)malloc(madt_length);
+  CopyFromPhysicalMemory(madt_copy, madt, madt_length);
+
+  PrepareTrampoline();
+
+  for (size_t offset = MADT_ENTRIES_OFFSET;
+       offset + 2 <= madt_length && online_cpu_count < MAX_CORES;
+       offset += madt_copy[offset + 1]) {
+    uint8 type = madt_copy[offset];
+    uint8 length = madt_copy[offset + 1];
+    if (length < 2) break;
+    if (type != MADT_ENTRY_PROCESSOR_LOCAL_APIC || length < 8) continue;
+
+    uint32 local_apic_id = madt_copy[offset + 3];
+    uint32 flags = *(uint32*)&madt_copy[offset + 4];
+    if ((flags & MADT_PROCESSOR_ENABLED) == 0 ||
+        local_apic_id == cpus[0].local_apic_id)
+      continue;
+
+    StartApplicationProcessor(local_apic_id);
+  }
+
+  free(madt_copy);
+}
+
+extern "C" void ApplicationProcessorMain(Cpu* cpu) {
+  // Claim our slot before doing anything else. If the bootstrap processor
+  // already gave up on us, halt without touching anything shared.
+  CpuStartupState expected = CpuStartupState::Starting;
+  if (!__atomic_compare_exchange_n(&cpu->startup_state, &expected,
+                                   CpuStartupState::Started, false,
+                                   __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+    asm volatile("cli");
+    while (true) asm volatile("hlt");
+  }
+
+  LoadCpuSegment(cpu);
+  LoadTss(cpu);
+  LoadIdt();
+  InitializeSystemCalls();
+  InitializeFpu();
+  EnableLocalApic();
+  InitializeTimerForCpu();
+
+  // Wait for the bootstrap processor to leave the kernel.
+  EnterKernel();
+
+  KernelAddressSpace().SwitchToAddressSpace();
+  cpu->is_online = true;
+
+  ScheduleNextThread();
+  ReprogramTimerForNextDeadline();
+  JumpIntoThread();
+}
+
+#endif  // TEST
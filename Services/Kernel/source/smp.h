@@ -0,0 +1,27 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "types.h"
+
+struct Cpu;
+
+// Finds the other CPU cores via the ACPI tables and starts them. They wait to
+// enter the kernel until the bootstrap processor leaves it. Must be called
+// after the timer is initialized.
+void StartApplicationProcessors();
+
+// Where application processors enter the kernel once they are in long mode.
+extern "C" void ApplicationProcessorMain(Cpu* cpu);
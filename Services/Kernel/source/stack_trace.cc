@@ -31,15 +31,16 @@ constexpr int kStackTraceDepth = 100;
 
 // Prints a stack trace for the currently running process.
 void PrintStackTrace() {
-  if (currently_executing_thread_regs == nullptr) {
+  if (GetCurrentThreadRegisters() == nullptr) {
     print << "Can't print stack trace because no thread is executing.\n";
     return;
   }
+  Thread* thread = GetRunningThread();
   VirtualAddressSpace& address_space =
-      (running_thread == nullptr) ? KernelAddressSpace()
-                                  : running_thread->process->virtual_address_space;
-  size_t rbp = currently_executing_thread_regs->rbp;
-  size_t rip = currently_executing_thread_regs->rip;
+      (thread == nullptr) ? KernelAddressSpace()
+                          : thread->process->virtual_address_space;
+  size_t rbp = GetCurrentThreadRegisters()->rbp;
+  size_t rip = GetCurrentThreadRegisters()->rip;
 
   print << "Stack trace:\n " << NumberFormat::Hexidecimal << rip << '\n';
 
@@ -82,8 +83,8 @@ void PrintStackTrace() {
 }  // namespace
 
 void PrintRegistersAndStackTrace() {
-  if (currently_executing_thread_regs != nullptr) {
-    PrintRegisters(currently_executing_thread_regs);
+  if (GetCurrentThreadRegisters() != nullptr) {
+    PrintRegisters(GetCurrentThreadRegisters());
     PrintStackTrace();
   } else {
     print << "No currently executing thread to print registers and stack "
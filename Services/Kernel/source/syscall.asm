@@ -1,8 +1,14 @@
 [BITS 64]
 
+; Offsets of fields in the Cpu structure (cpu.h). While in the kernel, GS points
+; to the Cpu structure of the CPU we are running on.
+%define CPU_CURRENT_REGISTERS 8
+%define CPU_INTERRUPT_STACK_TOP 16
+%define CPU_USER_STACK_POINTER 24
+
 [GLOBAL syscall_entry]
-[EXTERN currently_executing_thread_regs]
-[EXTERN interrupt_stack_top]
+[EXTERN EnterKernel]
+[EXTERN ExitKernel]
 [EXTERN ProfileEnteringKernelSpaceForSyscall]
 [EXTERN profiling_enabling_count]
 [EXTERN ProfileSwitchToUserSpace]
@@ -10,20 +16,19 @@
 [EXTERN RescheduleWithIretq]
 [EXTERN JumpIntoThread]
 
-; temp location to put the stack pointer while we manipulate the code
-sys_call_stack_pointer:
-    DQ 0x0000000000000000 
-
 syscall_entry:
+    ; Point GS to this CPU's structure.
+    swapgs
+
     ; Temporarily save userland rsp
-    mov [sys_call_stack_pointer], rsp
+    mov [gs:CPU_USER_STACK_POINTER], rsp
 
     ; Store the current registers
-    mov rsp, [currently_executing_thread_regs]
+    mov rsp, [gs:CPU_CURRENT_REGISTERS]
     add rsp, 19 * 8 ; point to usersp, skipping ss
 
     ; Push the registers
-    push qword [sys_call_stack_pointer] ; usersp
+    push qword [gs:CPU_USER_STACK_POINTER] ; usersp
     push r11 ; syscall puts rflags are in r11
     sub rsp, 8 ; skip cs
     push rcx ; syscall puts rip in rcx
@@ -51,7 +56,16 @@ syscall_entry:
     ;mov gs, ax
 
     ; Move to the interrupt's stack.
-    mov rsp, [interrupt_stack_top]
+    mov rsp, [gs:CPU_INTERRUPT_STACK_TOP]
+
+    ; Wait for any other CPU to leave the kernel. If our thread was destroyed
+    ; while waiting, there's no syscall to handle.
+    push rdi
+    mov rax, EnterKernel
+    call rax
+    pop rdi
+    test al, al
+    jnz .return_via_iretq
 
     ; Jump over profiling code if profiler isn't enabled.
     pushfq
@@ -93,6 +107,10 @@ syscall_entry:
 .jump_over_post_handler_profiling:
     popfq
 
+    ; Let other CPUs into the kernel.
+    mov rax, ExitKernel
+    call rax
+
     ; Restore the registers of the caller - maybe not needed?
     mov ax, 0x18 | 3
     mov ds, ax
@@ -100,7 +118,7 @@ syscall_entry:
     ;mov fs, ax
     ;mov gs, ax
 
-    mov rsp, [currently_executing_thread_regs]
+    mov rsp, [gs:CPU_CURRENT_REGISTERS]
     pop r15
     pop r14
     pop r13
@@ -125,6 +143,8 @@ syscall_entry:
     add rsp, 8 ; skip cs
     pop r11 ; pop rflags into r11
     pop rsp
+    ; Swap back to the thread's GS.
+    swapgs
     o64 sysret
 
 .return_to_kernel:
@@ -2,10 +2,12 @@
 #include "syscall.h"
 
 #include "framebuffer.h"
+#include "futex.h"
 #include "interrupts.asm.h"
 #include "interrupts.h"
 #include "io.h"
 #include "kernel_string.h"
+#include "log_ring.h"
 #include "messages.h"
 #include "multiboot_modules.h"
 #include "physical_allocator.h"
@@ -16,6 +18,7 @@
 #include "service.h"
 #include "shared_memory.h"
 #include "stack_trace.h"
+#include "string_view.h"
 #include "syscall.asm.h"
 #include "syscalls.h"
 #include "text_terminal.h"
@@ -51,64 +54,102 @@ void InitializeSystemCalls() {
 }
 
 extern "C" void SyscallHandler(int syscall_number) {
-  if (running_thread) running_thread->in_syscall = true;
+  if (GetRunningThread()) GetRunningThread()->in_syscall = true;
 
   switch (static_cast<Syscall>(syscall_number)) {
     default:
       print << "Syscall " << GetSystemCallName(syscall_number) << " ("
             << NumberFormat::Decimal << syscall_number;
-      if (running_thread) {
-        print << ") from " << running_thread->process->name << " ("
-              << running_thread->process->pid;
+      if (GetRunningThread()) {
+        print << ") from " << GetRunningThread()->process->name << " ("
+              << GetRunningThread()->process->pid;
       }
       print << ") is unimplemented.\n";
       PrintRegistersAndStackTrace();
       break;
     case Syscall::PrintDebugCharacter: {
-      char c = (char)currently_executing_thread_regs->rax;
-      int channel = (int)currently_executing_thread_regs->rbx;
-      ScopedPrintSource source(running_thread->process->pid,
-                               running_thread->process->name, channel);
+      char c = (char)GetCurrentThreadRegisters()->rax;
+      int channel = (int)GetCurrentThreadRegisters()->rbx;
+      ScopedPrintSource source(GetRunningThread()->process->pid,
+                               GetRunningThread()->process->name, channel);
       print << c;
       break;
     }
+    case Syscall::PrintDebugString: {
+      // The string is packed into 10 registers. The low byte of r15 is its
+      // length, and the rest of r15 is the channel.
+      size_t words[10];
+      words[0] = GetCurrentThreadRegisters()->rax;
+      words[1] = GetCurrentThreadRegisters()->rbx;
+      words[2] = GetCurrentThreadRegisters()->rdx;
+      words[3] = GetCurrentThreadRegisters()->rsi;
+      words[4] = GetCurrentThreadRegisters()->r8;
+      words[5] = GetCurrentThreadRegisters()->r9;
+      words[6] = GetCurrentThreadRegisters()->r10;
+      words[7] = GetCurrentThreadRegisters()->r12;
+      words[8] = GetCurrentThreadRegisters()->r13;
+      words[9] = GetCurrentThreadRegisters()->r14;
+      size_t length = GetCurrentThreadRegisters()->r15 & 0xFF;
+      if (length > sizeof(words)) length = sizeof(words);
+      int channel = (int)(GetCurrentThreadRegisters()->r15 >> 8);
+      ScopedPrintSource source(GetRunningThread()->process->pid,
+                               GetRunningThread()->process->name, channel);
+      print << StringView((const char*)words, length);
+      break;
+    }
     case Syscall::PrintRegistersAndStack: {
-      ScopedPrintSource source(running_thread->process->pid,
-                               running_thread->process->name, 0);
+      ScopedPrintSource source(GetRunningThread()->process->pid,
+                               GetRunningThread()->process->name, 0);
       print << "Dump requested by PID " << NumberFormat::Decimal
-            << running_thread->process->pid << " ("
-            << running_thread->process->name << ") in TID "
-            << running_thread->id << '\n';
+            << GetRunningThread()->process->pid << " ("
+            << GetRunningThread()->process->name << ") in TID "
+            << GetRunningThread()->id << '\n';
       PrintRegistersAndStackTrace();
       break;
     }
+    case Syscall::ReadKernelLog: {
+      // The log has every process's output, so only drivers can read it.
+      if (GetRunningThread()->process->is_driver) {
+        size_t first_position;
+        GetCurrentThreadRegisters()->rax = ReadKernelLog(
+            GetRunningThread()->process, GetCurrentThreadRegisters()->rax,
+            GetCurrentThreadRegisters()->rbx,
+            GetCurrentThreadRegisters()->rdx, first_position);
+        GetCurrentThreadRegisters()->rbx = first_position;
+        GetCurrentThreadRegisters()->rdx = KernelLogRing().WritePosition();
+      } else {
+        GetCurrentThreadRegisters()->rax = 0;
+        GetCurrentThreadRegisters()->rbx = GetCurrentThreadRegisters()->rdx;
+      }
+      break;
+    }
     case Syscall::CreateThread: {
-      Thread* new_thread = CreateThread(running_thread->process,
-                                        currently_executing_thread_regs->rax,
-                                        currently_executing_thread_regs->rbx,
-                                        currently_executing_thread_regs->rdx,
-                                        currently_executing_thread_regs->rsi);
+      Thread* new_thread = CreateThread(GetRunningThread()->process,
+                                        GetCurrentThreadRegisters()->rax,
+                                        GetCurrentThreadRegisters()->rbx,
+                                        GetCurrentThreadRegisters()->rdx,
+                                        GetCurrentThreadRegisters()->rsi);
       if (new_thread == 0) {
-        currently_executing_thread_regs->rax = 0;
+        GetCurrentThreadRegisters()->rax = 0;
       } else {
-        currently_executing_thread_regs->rax = new_thread->id;
+        GetCurrentThreadRegisters()->rax = new_thread->id;
       }
       ScheduleThread(new_thread);
       break;
     }
     case Syscall::GetThisThreadId:
-      currently_executing_thread_regs->rax = running_thread->id;
+      GetCurrentThreadRegisters()->rax = GetRunningThread()->id;
       break;
     case Syscall::SleepThisThread:
-      if (running_thread->wake_signal_pending) {
-        running_thread->wake_signal_pending = false;
+      if (GetRunningThread()->wake_signal_pending) {
+        GetRunningThread()->wake_signal_pending = false;
       } else {
-        UnscheduleThread(running_thread);
+        UnscheduleThread(GetRunningThread());
       }
       break;
     case Syscall::WakeThread: {
-      Thread* thread = GetThreadFromTid(running_thread->process,
-                                        currently_executing_thread_regs->rax);
+      Thread* thread = GetThreadFromTid(GetRunningThread()->process,
+                                        GetCurrentThreadRegisters()->rax);
       if (thread == nullptr) break;
 
       if (thread->awake) {
@@ -119,15 +160,15 @@ extern "C" void SyscallHandler(int syscall_number) {
       break;
     }
     case Syscall::TerminateThisThread:
-      DestroyThread(running_thread, false);
+      DestroyThread(GetRunningThread(), false);
       ScheduleNextThread();
       JumpIntoThread();  // Doesn't return.
       break;
     case Syscall::TerminateThread: {
-      Thread* thread = GetThreadFromTid(running_thread->process,
-                                        currently_executing_thread_regs->rax);
-      if (thread == running_thread) {
-        DestroyThread(running_thread, false);
+      Thread* thread = GetThreadFromTid(GetRunningThread()->process,
+                                        GetCurrentThreadRegisters()->rax);
+      if (thread == GetRunningThread()) {
+        DestroyThread(GetRunningThread(), false);
         ScheduleNextThread();
         JumpIntoThread();  // Doesn't return.
       } else if (thread != 0) {
@@ -135,103 +176,155 @@ extern "C" void SyscallHandler(int syscall_number) {
       }
       break;
     }
+    case Syscall::FutexWait:
+      if (FutexWait(GetRunningThread(), GetCurrentThreadRegisters()->rax,
+                    (uint32)GetCurrentThreadRegisters()->rbx,
+                    GetCurrentThreadRegisters()->rdx)) {
+        // The thread is now asleep. A new thread needs to be scheduled.
+        ScheduleNextThread();
+        JumpIntoThread();  // Doesn't return.
+      }
+      break;
+    case Syscall::FutexWake:
+      GetCurrentThreadRegisters()->rax =
+          FutexWake(GetRunningThread()->process,
+                    GetCurrentThreadRegisters()->rax,
+                    GetCurrentThreadRegisters()->rbx);
+      break;
+    case Syscall::FutexRequeue:
+      GetCurrentThreadRegisters()->rax = FutexRequeue(
+          GetRunningThread()->process, GetCurrentThreadRegisters()->rax,
+          GetCurrentThreadRegisters()->rbx,
+          GetCurrentThreadRegisters()->rdx,
+          GetCurrentThreadRegisters()->rsi,
+          GetCurrentThreadRegisters()->r9 != 0,
+          (uint32)GetCurrentThreadRegisters()->r8);
+      break;
     case Syscall::SetThreadSegment:
-      SetThreadSegment(running_thread, currently_executing_thread_regs->rax);
+      SetThreadSegment(GetRunningThread(), GetCurrentThreadRegisters()->rax);
       break;
     case Syscall::SetThreadSegmentExtended: {
-      size_t mask = currently_executing_thread_regs->rdx;
-      SetThreadSegments(running_thread, currently_executing_thread_regs->rax,
-                        (mask & 1) != 0, currently_executing_thread_regs->rbx,
+      size_t mask = GetCurrentThreadRegisters()->rdx;
+      SetThreadSegments(GetRunningThread(), GetCurrentThreadRegisters()->rax,
+                        (mask & 1) != 0, GetCurrentThreadRegisters()->rbx,
                         (mask & 2) != 0);
       break;
     }
     case Syscall::SetSystemMessageHandlers:
-      running_thread->process->futex_wake_message_id =
-          currently_executing_thread_regs->rax;
+      GetRunningThread()->process->futex_wake_message_id =
+          GetCurrentThreadRegisters()->rax;
       break;
     case Syscall::SetAddressToClearOnThreadTermination: {
-      size_t addr = currently_executing_thread_regs->rax;
-      if (addr != 0 && !running_thread->process->virtual_address_space
+      size_t addr = GetCurrentThreadRegisters()->rax;
+      if (addr != 0 && !GetRunningThread()->process->virtual_address_space
                             .IsAddressInCorrectSpace(addr)) {
-        running_thread->address_to_clear_on_termination = 0;
+        GetRunningThread()->address_to_clear_on_termination = 0;
         break;
       }
       // Align the address to 8 bytes to avoid crossing page boundaries.
-      running_thread->address_to_clear_on_termination = addr & (~7L);
+      GetRunningThread()->address_to_clear_on_termination = addr & (~7L);
       break;
     }
     case Syscall::AllocateMemoryPages: {
-      size_t pages_requested = currently_executing_thread_regs->rax;
-      size_t result =
-          running_thread->process->virtual_address_space.AllocatePages(
-              pages_requested);
-      currently_executing_thread_regs->rax = result;
+      size_t pages_requested = GetCurrentThreadRegisters()->rax;
+      // Bit 0 of rdx asks for the pages to be zeroed when first touched
+      // rather than backed up front.
+      bool lazily_zeroed = (GetCurrentThreadRegisters()->rdx & 1) != 0;
+      VirtualAddressSpace& address_space =
+          GetRunningThread()->process->virtual_address_space;
+      size_t result = lazily_zeroed
+                          ? address_space.AllocateLazilyZeroedPages(
+                                pages_requested)
+                          : address_space.AllocatePages(pages_requested);
+      GetCurrentThreadRegisters()->rax = result;
       break;
     }
     case Syscall::AllocateMemoryPagesBelowPhysicalBase: {
-      if (running_thread->process->is_driver) {
-        size_t pages_requested = currently_executing_thread_regs->rax;
-        size_t max_base = currently_executing_thread_regs->rbx;
+      if (GetRunningThread()->process->is_driver) {
+        size_t pages_requested = GetCurrentThreadRegisters()->rax;
+        size_t max_base = GetCurrentThreadRegisters()->rbx;
         size_t result =
-            running_thread->process->virtual_address_space
+            GetRunningThread()->process->virtual_address_space
                 .AllocatePagesBelowMaxBaseAddress(pages_requested, max_base);
-        currently_executing_thread_regs->rax = result;
-        currently_executing_thread_regs->rbx =
-            running_thread->process->virtual_address_space.GetPhysicalAddress(
-                result,
-                /*ignore_unowned_pages=*/false);
+        GetCurrentThreadRegisters()->rax = result;
+        GetCurrentThreadRegisters()->rbx =
+            GetRunningThread()
+                ->process->virtual_address_space.GetPhysicalAddress(
+                    result,
+                    /*ignore_unowned_pages=*/false);
+      } else {
+        GetCurrentThreadRegisters()->rax = OUT_OF_MEMORY;
+        GetCurrentThreadRegisters()->rbx = 0;
+      }
+      break;
+    }
+    case Syscall::AllocateContiguousPhysicalPages: {
+      if (GetRunningThread()->process->is_driver) {
+        size_t pages_requested = GetCurrentThreadRegisters()->rax;
+        size_t max_base = GetCurrentThreadRegisters()->rbx;
+        VirtualAddressSpace& address_space =
+            GetRunningThread()->process->virtual_address_space;
+        size_t result = address_space.AllocateContiguousPagesBelowMaxBaseAddress(
+            pages_requested, max_base);
+        GetCurrentThreadRegisters()->rax = result;
+        GetCurrentThreadRegisters()->rbx =
+            result == OUT_OF_MEMORY
+                ? 0
+                : address_space.GetPhysicalAddress(
+                      result, /*ignore_unowned_pages=*/false);
       } else {
-        currently_executing_thread_regs->rax = OUT_OF_MEMORY;
-        currently_executing_thread_regs->rbx = 0;
+        GetCurrentThreadRegisters()->rax = OUT_OF_MEMORY;
+        GetCurrentThreadRegisters()->rbx = 0;
       }
       break;
     }
     case Syscall::ReleaseMemoryPages: {
-      size_t pages_to_free = currently_executing_thread_regs->rbx;
-      running_thread->process->virtual_address_space.FreePages(
-          currently_executing_thread_regs->rax, pages_to_free);
+      size_t pages_to_free = GetCurrentThreadRegisters()->rbx;
+      GetRunningThread()->process->virtual_address_space.FreePages(
+          GetCurrentThreadRegisters()->rax, pages_to_free);
       break;
     }
     case Syscall::MapPhysicalMemory:
       // Only drivers can map physical memory.
-      if (running_thread->process->is_driver) {
-        currently_executing_thread_regs->rax =
-            running_thread->process->virtual_address_space.MapPhysicalPages(
-                currently_executing_thread_regs->rax,
-                currently_executing_thread_regs->rbx);
+      if (GetRunningThread()->process->is_driver) {
+        GetCurrentThreadRegisters()->rax =
+            GetRunningThread()->process->virtual_address_space.MapPhysicalPages(
+                GetCurrentThreadRegisters()->rax,
+                GetCurrentThreadRegisters()->rbx);
       } else {
-        currently_executing_thread_regs->rax = OUT_OF_MEMORY;
+        GetCurrentThreadRegisters()->rax = OUT_OF_MEMORY;
       }
       break;
     case Syscall::GetPhysicalAddressOfVirtualAddress:
-      if (running_thread->process->is_driver) {
-        currently_executing_thread_regs->rax =
-            running_thread->process->virtual_address_space.GetPhysicalAddress(
-                currently_executing_thread_regs->rax,
-                /*ignore_unowned_pages=*/false);
+      if (GetRunningThread()->process->is_driver) {
+        GetCurrentThreadRegisters()->rax =
+            GetRunningThread()
+                ->process->virtual_address_space.GetPhysicalAddress(
+                    GetCurrentThreadRegisters()->rax,
+                    /*ignore_unowned_pages=*/false);
       } else {
-        currently_executing_thread_regs->rax = 0;
+        GetCurrentThreadRegisters()->rax = 0;
       }
       break;
     case Syscall::GetSystemMemoryMetrics:
-      currently_executing_thread_regs->rax = total_system_memory;
-      currently_executing_thread_regs->rbx = GetAllocatedSharedMemoryInBytes();
-      currently_executing_thread_regs->rdx = free_pages * PAGE_SIZE;
+      GetCurrentThreadRegisters()->rax = total_system_memory;
+      GetCurrentThreadRegisters()->rbx = GetAllocatedSharedMemoryInBytes();
+      GetCurrentThreadRegisters()->rdx = free_pages * PAGE_SIZE;
       break;
     case Syscall::GetProcessHealthMetrics: {
       Process* process = nullptr;
-      if (currently_executing_thread_regs->rax == 0) {
-        process = running_thread->process;
+      if (GetCurrentThreadRegisters()->rax == 0) {
+        process = GetRunningThread()->process;
       } else {
-        process = GetProcessFromPid(currently_executing_thread_regs->rax);
+        process = GetProcessFromPid(GetCurrentThreadRegisters()->rax);
       }
 
       if (process == nullptr) {
-        currently_executing_thread_regs->rax = 0;
-        currently_executing_thread_regs->rbx = 0;
-        currently_executing_thread_regs->rdx = 0;
-        currently_executing_thread_regs->rsi = 0;
-        currently_executing_thread_regs->rdi = 0;
+        GetCurrentThreadRegisters()->rax = 0;
+        GetCurrentThreadRegisters()->rbx = 0;
+        GetCurrentThreadRegisters()->rdx = 0;
+        GetCurrentThreadRegisters()->rsi = 0;
+        GetCurrentThreadRegisters()->rdi = 0;
         break;
       }
 
@@ -239,145 +332,146 @@ extern "C" void SyscallHandler(int syscall_number) {
       // so it's accurate when reading them.
       if (IsCpuTrackingActive()) CatchUpProcessCpuUsage(process);
 
-      currently_executing_thread_regs->rax =
+      GetCurrentThreadRegisters()->rax =
           process->virtual_address_space.GetUniquePages() * PAGE_SIZE;
-      currently_executing_thread_regs->rbx = process->creation_timestamp;
-      currently_executing_thread_regs->rdx = CalculateCompactCpuUsage(process);
+      GetCurrentThreadRegisters()->rbx = process->creation_timestamp;
+      GetCurrentThreadRegisters()->rdx = CalculateCompactCpuUsage(process);
 
-      currently_executing_thread_regs->rsi = process->service_count;
-      currently_executing_thread_regs->rdi =
+      GetCurrentThreadRegisters()->rsi = process->service_count;
+      GetCurrentThreadRegisters()->rdi =
           process->virtual_address_space.GetSharedPages() * PAGE_SIZE;
       break;
     }
     case Syscall::CreateSharedMemory: {
       SharedMemoryInProcess* shared_memory =
           CreateAndMapSharedMemoryBlockIntoProcess(
-              running_thread->process, currently_executing_thread_regs->rax,
-              currently_executing_thread_regs->rbx,
-              currently_executing_thread_regs->rdx);
+              GetRunningThread()->process, GetCurrentThreadRegisters()->rax,
+              GetCurrentThreadRegisters()->rbx,
+              GetCurrentThreadRegisters()->rdx);
       if (shared_memory == nullptr) {
         // Could not create the shared memory block.
-        currently_executing_thread_regs->rax = 0;
-        currently_executing_thread_regs->rbx = 0;
+        GetCurrentThreadRegisters()->rax = 0;
+        GetCurrentThreadRegisters()->rbx = 0;
       } else {
         // Created the shared memory block.
-        currently_executing_thread_regs->rax = shared_memory->shared_memory->id;
-        currently_executing_thread_regs->rbx = shared_memory->virtual_address;
+        GetCurrentThreadRegisters()->rax = shared_memory->shared_memory->id;
+        GetCurrentThreadRegisters()->rbx = shared_memory->virtual_address;
       }
       break;
     }
     case Syscall::JoinSharedMemory: {
       SharedMemoryInProcess* shared_memory = JoinSharedMemory(
-          running_thread->process, currently_executing_thread_regs->rax);
+          GetRunningThread()->process, GetCurrentThreadRegisters()->rax);
 
       if (shared_memory == nullptr) {
         // Could not join the shared memory block.
-        currently_executing_thread_regs->rax = 0;
-        currently_executing_thread_regs->rbx = 0;
-        currently_executing_thread_regs->rdx = 0;
+        GetCurrentThreadRegisters()->rax = 0;
+        GetCurrentThreadRegisters()->rbx = 0;
+        GetCurrentThreadRegisters()->rdx = 0;
       } else {
         // Joined the shared memory block.
-        currently_executing_thread_regs->rax =
+        GetCurrentThreadRegisters()->rax =
             shared_memory->shared_memory->size_in_pages;
-        currently_executing_thread_regs->rbx = shared_memory->virtual_address;
-        currently_executing_thread_regs->rdx =
+        GetCurrentThreadRegisters()->rbx = shared_memory->virtual_address;
+        GetCurrentThreadRegisters()->rdx =
             shared_memory->shared_memory->flags;
       }
       break;
     }
     case Syscall::JoinChildProcessInSharedMemory: {
       Process* child_process =
-          GetProcessFromPid(currently_executing_thread_regs->rax);
-      currently_executing_thread_regs->rax =
+          GetProcessFromPid(GetCurrentThreadRegisters()->rax);
+      GetCurrentThreadRegisters()->rax =
           (bool)JoinChildProcessInSharedMemory(
-              running_thread->process, child_process,
-              currently_executing_thread_regs->rbx,
-              currently_executing_thread_regs->rdx);
+              GetRunningThread()->process, child_process,
+              GetCurrentThreadRegisters()->rbx,
+              GetCurrentThreadRegisters()->rdx);
       break;
     }
     case Syscall::LeaveSharedMemory:
-      LeaveSharedMemory(running_thread->process,
-                        currently_executing_thread_regs->rax);
+      LeaveSharedMemory(GetRunningThread()->process,
+                        GetCurrentThreadRegisters()->rax);
       break;
     case Syscall::GetSharedMemoryDetails:
       GetSharedMemoryDetailsPertainingToProcess(
-          running_thread->process, currently_executing_thread_regs->rax,
-          currently_executing_thread_regs->rax,
-          currently_executing_thread_regs->rbx);
+          GetRunningThread()->process, GetCurrentThreadRegisters()->rax,
+          GetCurrentThreadRegisters()->rax,
+          GetCurrentThreadRegisters()->rbx);
 
       break;
     case Syscall::MovePageIntoSharedMemory:
-      MovePageIntoSharedMemory(running_thread->process,
-                               currently_executing_thread_regs->rax,
-                               currently_executing_thread_regs->rbx,
-                               currently_executing_thread_regs->rdx);
+      MovePageIntoSharedMemory(GetRunningThread()->process,
+                               GetCurrentThreadRegisters()->rax,
+                               GetCurrentThreadRegisters()->rbx,
+                               GetCurrentThreadRegisters()->rdx);
       break;
     case Syscall::GrantPermissionToAllocateIntoSharedMemory:
       GrantPermissionToAllocateIntoSharedMemory(
-          running_thread->process, currently_executing_thread_regs->rax,
-          currently_executing_thread_regs->rbx);
+          GetRunningThread()->process, GetCurrentThreadRegisters()->rax,
+          GetCurrentThreadRegisters()->rbx);
       break;
     case Syscall::IsSharedMemoryPageAllocated:
-      currently_executing_thread_regs->rax =
-          IsAddressAllocatedInSharedMemory(currently_executing_thread_regs->rax,
-                                           currently_executing_thread_regs->rbx)
+      GetCurrentThreadRegisters()->rax =
+          IsAddressAllocatedInSharedMemory(GetCurrentThreadRegisters()->rax,
+                                           GetCurrentThreadRegisters()->rbx)
               ? 1
               : 0;
       break;
     case Syscall::GetSharedMemoryPagePhysicalAddress:
-      if (running_thread->process->is_driver) {
-        currently_executing_thread_regs->rax =
+      if (GetRunningThread()->process->is_driver) {
+        GetCurrentThreadRegisters()->rax =
             GetPhysicalAddressOfPageInSharedMemory(
-                currently_executing_thread_regs->rax,
-                currently_executing_thread_regs->rbx);
+                GetCurrentThreadRegisters()->rax,
+                GetCurrentThreadRegisters()->rbx);
       } else {
-        currently_executing_thread_regs->rax = OUT_OF_MEMORY;
+        GetCurrentThreadRegisters()->rax = OUT_OF_MEMORY;
       }
       break;
     case Syscall::GrowSharedMemory: {
       SharedMemoryInProcess* shared_memory = GrowSharedMemory(
-          running_thread->process, currently_executing_thread_regs->rax,
-          currently_executing_thread_regs->rbx);
+          GetRunningThread()->process, GetCurrentThreadRegisters()->rax,
+          GetCurrentThreadRegisters()->rbx);
 
       if (shared_memory == nullptr) {
         // Could not grow the shared memory block.
-        currently_executing_thread_regs->rax = 0;
-        currently_executing_thread_regs->rbx = 0;
+        GetCurrentThreadRegisters()->rax = 0;
+        GetCurrentThreadRegisters()->rbx = 0;
       } else {
         // Grew the shared memory block.
-        currently_executing_thread_regs->rax =
+        GetCurrentThreadRegisters()->rax =
             shared_memory->shared_memory->size_in_pages;
-        currently_executing_thread_regs->rbx = shared_memory->virtual_address;
+        GetCurrentThreadRegisters()->rbx = shared_memory->virtual_address;
       }
       break;
     }
     case Syscall::SetMemoryAccessRights: {
-      size_t address = currently_executing_thread_regs->rax;
-      size_t num_pages = currently_executing_thread_regs->rbx;
+      size_t address = GetCurrentThreadRegisters()->rax;
+      size_t num_pages = GetCurrentThreadRegisters()->rbx;
       size_t max_address = address + num_pages * PAGE_SIZE;
-      size_t rights = currently_executing_thread_regs->rdx;
+      size_t rights = GetCurrentThreadRegisters()->rdx;
 
       for (; address < max_address; address += PAGE_SIZE) {
-        running_thread->process->virtual_address_space.SetMemoryAccessRights(
-            address, rights);
+        GetRunningThread()
+            ->process->virtual_address_space.SetMemoryAccessRights(address,
+                                                                   rights);
       }
       break;
     }
     case Syscall::GetThisProcessId:
-      currently_executing_thread_regs->rax = running_thread->process->pid;
+      GetCurrentThreadRegisters()->rax = GetRunningThread()->process->pid;
       break;
     case Syscall::TerminateThisProcess:
-      DestroyProcess(running_thread->process);
+      DestroyProcess(GetRunningThread()->process);
       ScheduleNextThread();
       JumpIntoThread();  // Doesn't return.
       break;
     case Syscall::TerminateProcess: {
       Process* process =
-          GetProcessFromPid(currently_executing_thread_regs->rax);
+          GetProcessFromPid(GetCurrentThreadRegisters()->rax);
       if (process == nullptr) {
         break;
       }
-      bool currently_running_process = process == running_thread->process;
+      bool currently_running_process = process == GetRunningThread()->process;
       DestroyProcess(process);
       if (currently_running_process) {
         ScheduleNextThread();
@@ -388,16 +482,16 @@ extern "C" void SyscallHandler(int syscall_number) {
     case Syscall::GetProcesses: {
       // Extract the name from the input registers.
       size_t process_name[PROCESS_NAME_WORDS];
-      process_name[0] = currently_executing_thread_regs->rax;
-      process_name[1] = currently_executing_thread_regs->rbx;
-      process_name[2] = currently_executing_thread_regs->rdx;
-      process_name[3] = currently_executing_thread_regs->rsi;
-      process_name[4] = currently_executing_thread_regs->r8;
-      process_name[5] = currently_executing_thread_regs->r9;
-      process_name[6] = currently_executing_thread_regs->r10;
-      process_name[7] = currently_executing_thread_regs->r12;
-      process_name[8] = currently_executing_thread_regs->r13;
-      process_name[9] = currently_executing_thread_regs->r14;
+      process_name[0] = GetCurrentThreadRegisters()->rax;
+      process_name[1] = GetCurrentThreadRegisters()->rbx;
+      process_name[2] = GetCurrentThreadRegisters()->rdx;
+      process_name[3] = GetCurrentThreadRegisters()->rsi;
+      process_name[4] = GetCurrentThreadRegisters()->r8;
+      process_name[5] = GetCurrentThreadRegisters()->r9;
+      process_name[6] = GetCurrentThreadRegisters()->r10;
+      process_name[7] = GetCurrentThreadRegisters()->r12;
+      process_name[8] = GetCurrentThreadRegisters()->r13;
+      process_name[9] = GetCurrentThreadRegisters()->r14;
 
       // Loop over all processes starting from the provided PID
       // until processes run out. Keep track of the pids of the
@@ -405,7 +499,7 @@ extern "C" void SyscallHandler(int syscall_number) {
       size_t pids[11] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
       size_t processes_found = 0;
       Process* process =
-          GetProcessOrNextFromPid(currently_executing_thread_regs->r15);
+          GetProcessOrNextFromPid(GetCurrentThreadRegisters()->r15);
       while (process != nullptr) {
         process = FindNextProcessWithName((char*)process_name, process);
         if (process != nullptr) {
@@ -416,161 +510,170 @@ extern "C" void SyscallHandler(int syscall_number) {
         }
       }
 
-      currently_executing_thread_regs->rdi = processes_found;
-      currently_executing_thread_regs->r15 = pids[0];
-      currently_executing_thread_regs->rax = pids[1];
-      currently_executing_thread_regs->rbx = pids[2];
-      currently_executing_thread_regs->rdx = pids[3];
-      currently_executing_thread_regs->rsi = pids[4];
-      currently_executing_thread_regs->r8 = pids[5];
-      currently_executing_thread_regs->r9 = pids[6];
-      currently_executing_thread_regs->r10 = pids[7];
-      currently_executing_thread_regs->r12 = pids[8];
-      currently_executing_thread_regs->r13 = pids[9];
-      currently_executing_thread_regs->r14 = pids[10];
+      GetCurrentThreadRegisters()->rdi = processes_found;
+      GetCurrentThreadRegisters()->r15 = pids[0];
+      GetCurrentThreadRegisters()->rax = pids[1];
+      GetCurrentThreadRegisters()->rbx = pids[2];
+      GetCurrentThreadRegisters()->rdx = pids[3];
+      GetCurrentThreadRegisters()->rsi = pids[4];
+      GetCurrentThreadRegisters()->r8 = pids[5];
+      GetCurrentThreadRegisters()->r9 = pids[6];
+      GetCurrentThreadRegisters()->r10 = pids[7];
+      GetCurrentThreadRegisters()->r12 = pids[8];
+      GetCurrentThreadRegisters()->r13 = pids[9];
+      GetCurrentThreadRegisters()->r14 = pids[10];
       break;
     }
     case Syscall::GetNameOfProcess: {
       Process* process =
-          GetProcessFromPid(currently_executing_thread_regs->rax);
+          GetProcessFromPid(GetCurrentThreadRegisters()->rax);
       if (process == nullptr) {
-        currently_executing_thread_regs->rdi = 0;
+        GetCurrentThreadRegisters()->rdi = 0;
       } else {
-        currently_executing_thread_regs->rdi = 1;
-        currently_executing_thread_regs->rax = ((size_t*)process->name)[0];
-        currently_executing_thread_regs->rbx = ((size_t*)process->name)[1];
-        currently_executing_thread_regs->rdx = ((size_t*)process->name)[2];
-        currently_executing_thread_regs->rsi = ((size_t*)process->name)[3];
-        currently_executing_thread_regs->r8 = ((size_t*)process->name)[4];
-        currently_executing_thread_regs->r9 = ((size_t*)process->name)[5];
-        currently_executing_thread_regs->r10 = ((size_t*)process->name)[6];
-        currently_executing_thread_regs->r12 = ((size_t*)process->name)[7];
-        currently_executing_thread_regs->r13 = ((size_t*)process->name)[8];
-        currently_executing_thread_regs->r14 = ((size_t*)process->name)[9];
-        currently_executing_thread_regs->r15 = ((size_t*)process->name)[10];
+        GetCurrentThreadRegisters()->rdi = 1;
+        GetCurrentThreadRegisters()->rax = ((size_t*)process->name)[0];
+        GetCurrentThreadRegisters()->rbx = ((size_t*)process->name)[1];
+        GetCurrentThreadRegisters()->rdx = ((size_t*)process->name)[2];
+        GetCurrentThreadRegisters()->rsi = ((size_t*)process->name)[3];
+        GetCurrentThreadRegisters()->r8 = ((size_t*)process->name)[4];
+        GetCurrentThreadRegisters()->r9 = ((size_t*)process->name)[5];
+        GetCurrentThreadRegisters()->r10 = ((size_t*)process->name)[6];
+        GetCurrentThreadRegisters()->r12 = ((size_t*)process->name)[7];
+        GetCurrentThreadRegisters()->r13 = ((size_t*)process->name)[8];
+        GetCurrentThreadRegisters()->r14 = ((size_t*)process->name)[9];
+        GetCurrentThreadRegisters()->r15 = ((size_t*)process->name)[10];
       }
       break;
     }
+    case Syscall::GetProcessSnapshots: {
+      size_t total_processes;
+      GetCurrentThreadRegisters()->rax = GetProcessSnapshots(
+          GetRunningThread()->process, GetCurrentThreadRegisters()->rax,
+          GetCurrentThreadRegisters()->rbx,
+          GetCurrentThreadRegisters()->rdx, total_processes);
+      GetCurrentThreadRegisters()->rbx = total_processes;
+      break;
+    }
     case Syscall::NotifyWhenProcessDisappears: {
-      size_t target_pid = currently_executing_thread_regs->rax;
-      size_t event_id = currently_executing_thread_regs->rbx;
+      size_t target_pid = GetCurrentThreadRegisters()->rax;
+      size_t event_id = GetCurrentThreadRegisters()->rbx;
 
-      Process* target = GetProcessFromPid(currently_executing_thread_regs->rax);
+      Process* target = GetProcessFromPid(GetCurrentThreadRegisters()->rax);
       if (target == nullptr) {
         // The target process to be notified of when it dies doesn't
         // exist. It's possible that it just died, so whatever the
         // case, the safest thing to do here is to immediately send an
         // event.
-        SendKernelMessageToProcess(running_thread->process, event_id,
+        SendKernelMessageToProcess(GetRunningThread()->process, event_id,
                                    target_pid, 0, 0, 0, 0);
       } else {
-        NotifyProcessOnDeath(target, running_thread->process, event_id);
+        NotifyProcessOnDeath(target, GetRunningThread()->process, event_id);
       }
       break;
     }
     case Syscall::StopNotifyingWhenProcessDisappears:
-      StopNotifyingProcessOnDeath(running_thread->process,
-                                  currently_executing_thread_regs->rax);
+      StopNotifyingProcessOnDeath(GetRunningThread()->process,
+                                  GetCurrentThreadRegisters()->rax);
       break;
     case Syscall::CreateProcess: {
       // Extract the name from the input registers.
       size_t process_name[PROCESS_NAME_WORDS];
-      process_name[0] = currently_executing_thread_regs->rbx;
-      process_name[1] = currently_executing_thread_regs->rdx;
-      process_name[2] = currently_executing_thread_regs->rsi;
-      process_name[3] = currently_executing_thread_regs->r8;
-      process_name[4] = currently_executing_thread_regs->r9;
-      process_name[5] = currently_executing_thread_regs->r10;
-      process_name[6] = currently_executing_thread_regs->r12;
-      process_name[7] = currently_executing_thread_regs->r13;
-      process_name[8] = currently_executing_thread_regs->r14;
-      process_name[9] = currently_executing_thread_regs->r15;
+      process_name[0] = GetCurrentThreadRegisters()->rbx;
+      process_name[1] = GetCurrentThreadRegisters()->rdx;
+      process_name[2] = GetCurrentThreadRegisters()->rsi;
+      process_name[3] = GetCurrentThreadRegisters()->r8;
+      process_name[4] = GetCurrentThreadRegisters()->r9;
+      process_name[5] = GetCurrentThreadRegisters()->r10;
+      process_name[6] = GetCurrentThreadRegisters()->r12;
+      process_name[7] = GetCurrentThreadRegisters()->r13;
+      process_name[8] = GetCurrentThreadRegisters()->r14;
+      process_name[9] = GetCurrentThreadRegisters()->r15;
 
       Process* child_process =
-          CreateChildProcess(running_thread->process, (char*)process_name,
-                             currently_executing_thread_regs->rax);
-      currently_executing_thread_regs->rax =
+          CreateChildProcess(GetRunningThread()->process, (char*)process_name,
+                             GetCurrentThreadRegisters()->rax);
+      GetCurrentThreadRegisters()->rax =
           ((size_t)child_process == ERROR) ? 0 : child_process->pid;
       break;
     }
     case Syscall::SetChildProcessMemoryPages: {
       Process* child_process =
-          GetProcessFromPid(currently_executing_thread_regs->rax);
-      SetChildProcessMemoryPages(running_thread->process, child_process,
-                                 currently_executing_thread_regs->rbx,
-                                 currently_executing_thread_regs->rdx,
-                                 currently_executing_thread_regs->rsi);
+          GetProcessFromPid(GetCurrentThreadRegisters()->rax);
+      SetChildProcessMemoryPages(GetRunningThread()->process, child_process,
+                                 GetCurrentThreadRegisters()->rbx,
+                                 GetCurrentThreadRegisters()->rdx,
+                                 GetCurrentThreadRegisters()->rsi);
       break;
     }
     case Syscall::StartExecutionProcess: {
       Process* child_process =
-          GetProcessFromPid(currently_executing_thread_regs->rax);
-      StartExecutingChildProcess(running_thread->process, child_process,
-                                 currently_executing_thread_regs->rbx,
-                                 currently_executing_thread_regs->rdx);
+          GetProcessFromPid(GetCurrentThreadRegisters()->rax);
+      StartExecutingChildProcess(GetRunningThread()->process, child_process,
+                                 GetCurrentThreadRegisters()->rbx,
+                                 GetCurrentThreadRegisters()->rdx);
       break;
     }
     case Syscall::DestroyChildProcess: {
       Process* child_process =
-          GetProcessFromPid(currently_executing_thread_regs->rax);
-      DestroyChildProcess(running_thread->process, child_process);
+          GetProcessFromPid(GetCurrentThreadRegisters()->rax);
+      DestroyChildProcess(GetRunningThread()->process, child_process);
       break;
     }
     case Syscall::GetMultibootModule: {
       size_t module_name[MODULE_NAME_WORDS];
 
       LoadNextMultibootModuleIntoProcess(
-          running_thread->process,
-          /*address_and_flags=*/currently_executing_thread_regs->rdi,
-          /*size=*/currently_executing_thread_regs->r15, (char*)module_name);
-      currently_executing_thread_regs->rax = ((size_t*)module_name)[0];
-      currently_executing_thread_regs->rbx = ((size_t*)module_name)[1];
-      currently_executing_thread_regs->rdx = ((size_t*)module_name)[2];
-      currently_executing_thread_regs->rsi = ((size_t*)module_name)[3];
-      currently_executing_thread_regs->r8 = ((size_t*)module_name)[4];
-      currently_executing_thread_regs->r9 = ((size_t*)module_name)[5];
-      currently_executing_thread_regs->r10 = ((size_t*)module_name)[6];
-      currently_executing_thread_regs->r12 = ((size_t*)module_name)[7];
-      currently_executing_thread_regs->r13 = ((size_t*)module_name)[8];
-      currently_executing_thread_regs->r14 = ((size_t*)module_name)[9];
+          GetRunningThread()->process,
+          /*address_and_flags=*/GetCurrentThreadRegisters()->rdi,
+          /*size=*/GetCurrentThreadRegisters()->r15, (char*)module_name);
+      GetCurrentThreadRegisters()->rax = ((size_t*)module_name)[0];
+      GetCurrentThreadRegisters()->rbx = ((size_t*)module_name)[1];
+      GetCurrentThreadRegisters()->rdx = ((size_t*)module_name)[2];
+      GetCurrentThreadRegisters()->rsi = ((size_t*)module_name)[3];
+      GetCurrentThreadRegisters()->r8 = ((size_t*)module_name)[4];
+      GetCurrentThreadRegisters()->r9 = ((size_t*)module_name)[5];
+      GetCurrentThreadRegisters()->r10 = ((size_t*)module_name)[6];
+      GetCurrentThreadRegisters()->r12 = ((size_t*)module_name)[7];
+      GetCurrentThreadRegisters()->r13 = ((size_t*)module_name)[8];
+      GetCurrentThreadRegisters()->r14 = ((size_t*)module_name)[9];
       break;
     }
     case Syscall::RegisterService: {
       // Extract the name from the input registers.
       size_t service_name[SERVICE_NAME_WORDS];
-      service_name[0] = currently_executing_thread_regs->rax;
-      service_name[1] = currently_executing_thread_regs->rbx;
-      service_name[2] = currently_executing_thread_regs->rdx;
-      service_name[3] = currently_executing_thread_regs->rsi;
-      service_name[4] = currently_executing_thread_regs->r8;
-      service_name[5] = currently_executing_thread_regs->r9;
-      service_name[6] = currently_executing_thread_regs->r10;
-      service_name[7] = currently_executing_thread_regs->r12;
-      service_name[8] = currently_executing_thread_regs->r13;
-
-      RegisterService((char*)service_name, running_thread->process,
-                      currently_executing_thread_regs->r15);
+      service_name[0] = GetCurrentThreadRegisters()->rax;
+      service_name[1] = GetCurrentThreadRegisters()->rbx;
+      service_name[2] = GetCurrentThreadRegisters()->rdx;
+      service_name[3] = GetCurrentThreadRegisters()->rsi;
+      service_name[4] = GetCurrentThreadRegisters()->r8;
+      service_name[5] = GetCurrentThreadRegisters()->r9;
+      service_name[6] = GetCurrentThreadRegisters()->r10;
+      service_name[7] = GetCurrentThreadRegisters()->r12;
+      service_name[8] = GetCurrentThreadRegisters()->r13;
+
+      RegisterService((char*)service_name, GetRunningThread()->process,
+                      GetCurrentThreadRegisters()->r15);
       break;
     }
     case Syscall::UnregisterService:
-      UnregisterServiceByMessageId(running_thread->process,
-                                   currently_executing_thread_regs->rax);
+      UnregisterServiceByMessageId(GetRunningThread()->process,
+                                   GetCurrentThreadRegisters()->rax);
       break;
     case Syscall::GetServices: {
       // Extract the name from the input registers.
       size_t service_name[SERVICE_NAME_WORDS];
-      service_name[0] = currently_executing_thread_regs->rdx;
-      service_name[1] = currently_executing_thread_regs->rsi;
-      service_name[2] = currently_executing_thread_regs->r8;
-      service_name[3] = currently_executing_thread_regs->r9;
-      service_name[4] = currently_executing_thread_regs->r10;
-      service_name[5] = currently_executing_thread_regs->r12;
-      service_name[6] = currently_executing_thread_regs->r13;
-      service_name[7] = currently_executing_thread_regs->r14;
-      service_name[8] = currently_executing_thread_regs->r15;
-
-      size_t min_pid = currently_executing_thread_regs->rax;
-      size_t min_sid = currently_executing_thread_regs->rbx;
+      service_name[0] = GetCurrentThreadRegisters()->rdx;
+      service_name[1] = GetCurrentThreadRegisters()->rsi;
+      service_name[2] = GetCurrentThreadRegisters()->r8;
+      service_name[3] = GetCurrentThreadRegisters()->r9;
+      service_name[4] = GetCurrentThreadRegisters()->r10;
+      service_name[5] = GetCurrentThreadRegisters()->r12;
+      service_name[6] = GetCurrentThreadRegisters()->r13;
+      service_name[7] = GetCurrentThreadRegisters()->r14;
+      service_name[8] = GetCurrentThreadRegisters()->r15;
+
+      size_t min_pid = GetCurrentThreadRegisters()->rax;
+      size_t min_sid = GetCurrentThreadRegisters()->rbx;
 
       // Loop over all processes starting from the provided PID
       // and services starting from the provided SID until processes
@@ -589,82 +692,98 @@ extern "C" void SyscallHandler(int syscall_number) {
         services_found++;
       }
       // Write out the list of found PIDs.
-      currently_executing_thread_regs->rdi = services_found;
-      currently_executing_thread_regs->rax = pids[0];
-      currently_executing_thread_regs->rbx = sids[0];
-      currently_executing_thread_regs->rdx = pids[1];
-      currently_executing_thread_regs->rsi = sids[1];
-      currently_executing_thread_regs->r8 = pids[2];
-      currently_executing_thread_regs->r9 = sids[2];
-      currently_executing_thread_regs->r10 = pids[3];
-      currently_executing_thread_regs->r12 = sids[3];
-      currently_executing_thread_regs->r13 = pids[4];
-      currently_executing_thread_regs->r14 = sids[4];
+      GetCurrentThreadRegisters()->rdi = services_found;
+      GetCurrentThreadRegisters()->rax = pids[0];
+      GetCurrentThreadRegisters()->rbx = sids[0];
+      GetCurrentThreadRegisters()->rdx = pids[1];
+      GetCurrentThreadRegisters()->rsi = sids[1];
+      GetCurrentThreadRegisters()->r8 = pids[2];
+      GetCurrentThreadRegisters()->r9 = sids[2];
+      GetCurrentThreadRegisters()->r10 = pids[3];
+      GetCurrentThreadRegisters()->r12 = sids[3];
+      GetCurrentThreadRegisters()->r13 = pids[4];
+      GetCurrentThreadRegisters()->r14 = sids[4];
       break;
     }
     case Syscall::GetNameOfService: {
-      size_t pid = currently_executing_thread_regs->rax;
-      size_t sid = currently_executing_thread_regs->rbx;
+      size_t pid = GetCurrentThreadRegisters()->rax;
+      size_t sid = GetCurrentThreadRegisters()->rbx;
       Service* service = FindServiceByProcessAndMid(pid, sid);
       if (service == nullptr) {
-        currently_executing_thread_regs->rdi = 0;
+        GetCurrentThreadRegisters()->rdi = 0;
       } else {
-        currently_executing_thread_regs->rdi = 1;
-        currently_executing_thread_regs->rax = ((size_t*)service->name)[0];
-        currently_executing_thread_regs->rbx = ((size_t*)service->name)[1];
-        currently_executing_thread_regs->rdx = ((size_t*)service->name)[2];
-        currently_executing_thread_regs->rsi = ((size_t*)service->name)[3];
-        currently_executing_thread_regs->r8 = ((size_t*)service->name)[4];
-        currently_executing_thread_regs->r9 = ((size_t*)service->name)[5];
-        currently_executing_thread_regs->r10 = ((size_t*)service->name)[6];
-        currently_executing_thread_regs->r12 = ((size_t*)service->name)[7];
-        currently_executing_thread_regs->r13 = ((size_t*)service->name)[8];
-        currently_executing_thread_regs->r14 = ((size_t*)service->name)[9];
+        GetCurrentThreadRegisters()->rdi = 1;
+        GetCurrentThreadRegisters()->rax = ((size_t*)service->name)[0];
+        GetCurrentThreadRegisters()->rbx = ((size_t*)service->name)[1];
+        GetCurrentThreadRegisters()->rdx = ((size_t*)service->name)[2];
+        GetCurrentThreadRegisters()->rsi = ((size_t*)service->name)[3];
+        GetCurrentThreadRegisters()->r8 = ((size_t*)service->name)[4];
+        GetCurrentThreadRegisters()->r9 = ((size_t*)service->name)[5];
+        GetCurrentThreadRegisters()->r10 = ((size_t*)service->name)[6];
+        GetCurrentThreadRegisters()->r12 = ((size_t*)service->name)[7];
+        GetCurrentThreadRegisters()->r13 = ((size_t*)service->name)[8];
+        GetCurrentThreadRegisters()->r14 = ((size_t*)service->name)[9];
       }
       break;
     }
     case Syscall::NotifyWhenServiceAppears: {
       // Extract the name from the input registers.
       size_t service_name[SERVICE_NAME_WORDS];
-      service_name[0] = currently_executing_thread_regs->rax;
-      service_name[1] = currently_executing_thread_regs->rbx;
-      service_name[2] = currently_executing_thread_regs->rdx;
-      service_name[3] = currently_executing_thread_regs->rsi;
-      service_name[4] = currently_executing_thread_regs->r8;
-      service_name[5] = currently_executing_thread_regs->r9;
-      service_name[6] = currently_executing_thread_regs->r10;
-      service_name[7] = currently_executing_thread_regs->r12;
-      service_name[8] = currently_executing_thread_regs->r13;
+      service_name[0] = GetCurrentThreadRegisters()->rax;
+      service_name[1] = GetCurrentThreadRegisters()->rbx;
+      service_name[2] = GetCurrentThreadRegisters()->rdx;
+      service_name[3] = GetCurrentThreadRegisters()->rsi;
+      service_name[4] = GetCurrentThreadRegisters()->r8;
+      service_name[5] = GetCurrentThreadRegisters()->r9;
+      service_name[6] = GetCurrentThreadRegisters()->r10;
+      service_name[7] = GetCurrentThreadRegisters()->r12;
+      service_name[8] = GetCurrentThreadRegisters()->r13;
 
       NotifyProcessWhenServiceAppears((char*)service_name,
-                                      running_thread->process,
-                                      currently_executing_thread_regs->r15);
+                                      GetRunningThread()->process,
+                                      GetCurrentThreadRegisters()->r15);
       break;
     }
     case Syscall::StopNotifyingWhenServiceAppears:
       StopNotifyingProcessWhenServiceAppearsByMessageId(
-          running_thread->process, currently_executing_thread_regs->rax);
+          GetRunningThread()->process, GetCurrentThreadRegisters()->rax);
       break;
     case Syscall::NotifyWhenServiceDisappears:
       NotifyProcessWhenServiceDisappears(
-          running_thread->process,
-          /*service_process_id=*/currently_executing_thread_regs->rax,
-          /*service_message_id=*/currently_executing_thread_regs->rbx,
-          /*message_id=*/currently_executing_thread_regs->rdx);
+          GetRunningThread()->process,
+          /*service_process_id=*/GetCurrentThreadRegisters()->rax,
+          /*service_message_id=*/GetCurrentThreadRegisters()->rbx,
+          /*message_id=*/GetCurrentThreadRegisters()->rdx);
       break;
     case Syscall::StopNotifyingWhenServiceDisappears:
       StopNotifyingProcessWhenServiceDisappears(
-          running_thread->process,
-          /*message_id=*/currently_executing_thread_regs->rax);
+          GetRunningThread()->process,
+          /*message_id=*/GetCurrentThreadRegisters()->rax);
       break;
     case Syscall::SendMessage:
-      SendMessageFromThreadSyscall(running_thread);
+      SendMessageFromThreadSyscall(GetRunningThread());
       break;
     case Syscall::PollForMessage:
-      LoadNextMessageIntoThread(running_thread);
+      LoadNextMessageIntoThread(GetRunningThread());
       break;
     case Syscall::SleepForMessage:
-      if (SleepThreadUntilMessage(running_thread)) {
+      if (SleepThreadUntilMessage(GetRunningThread())) {
+        // The thread is now asleep. A new thread needs to be scheduled.
+        ScheduleNextThread();
+        JumpIntoThread();  // Doesn't return.
+      }
+      break;
+    case Syscall::GetMessageMailbox:
+      GetCurrentThreadRegisters()->rax =
+          GetOrCreateMessageMailbox(GetRunningThread()->process);
+      break;
+    case Syscall::SendMessages:
+      SendMessagesFromThreadSyscall(GetRunningThread());
+      break;
+    case Syscall::ReceiveMessages:
+      if (ReceiveMessagesIntoMailbox(
+              GetRunningThread(),
+              /*sleep=*/GetCurrentThreadRegisters()->rax != 0)) {
         // The thread is now asleep. A new thread needs to be scheduled.
         ScheduleNextThread();
         JumpIntoThread();  // Doesn't return.
@@ -672,125 +791,126 @@ extern "C" void SyscallHandler(int syscall_number) {
       break;
     case Syscall::RegisterMessageToSendOnInterrupt:
       RegisterMessageToSendOnInterrupt(
-          (int)currently_executing_thread_regs->rax, running_thread->process,
-          currently_executing_thread_regs->rbx,
-          currently_executing_thread_regs->rdx,
-          currently_executing_thread_regs->rsi);
+          (int)GetCurrentThreadRegisters()->rax, GetRunningThread()->process,
+          GetCurrentThreadRegisters()->rbx,
+          GetCurrentThreadRegisters()->rdx,
+          GetCurrentThreadRegisters()->rsi);
       break;
     case Syscall::UnregisterMessageToSendOnInterrupt:
       UnregisterMessageToSendOnInterrupt(
-          (int)currently_executing_thread_regs->rax, running_thread->process,
-          currently_executing_thread_regs->rbx);
+          (int)GetCurrentThreadRegisters()->rax, GetRunningThread()->process,
+          GetCurrentThreadRegisters()->rbx);
       break;
     case Syscall::GetMultibootFramebufferInformation:
-      PopulateRegistersWithFramebufferDetails(currently_executing_thread_regs);
+      PopulateRegistersWithFramebufferDetails(GetCurrentThreadRegisters());
       break;
     case Syscall::SendMessageAfterXMicroseconds:
       SendMessageToProcessAtMicroseconds(
-          running_thread->process,
-          currently_executing_thread_regs->rax +
+          GetRunningThread()->process,
+          GetCurrentThreadRegisters()->rax +
               GetCurrentTimestampInMicroseconds(),
-          (int)currently_executing_thread_regs->rbx);
+          (int)GetCurrentThreadRegisters()->rbx);
       break;
     case Syscall::SendMessageAtTimestamp:
       SendMessageToProcessAtMicroseconds(
-          running_thread->process, currently_executing_thread_regs->rax,
-          (int)currently_executing_thread_regs->rbx);
+          GetRunningThread()->process, GetCurrentThreadRegisters()->rax,
+          (int)GetCurrentThreadRegisters()->rbx);
       break;
     case Syscall::GetCurrentTimestamp:
-      currently_executing_thread_regs->rax =
+      GetCurrentThreadRegisters()->rax =
           GetCurrentTimestampInMicroseconds();
       break;
     case Syscall::EnableProfiling:
-      EnableProfiling(running_thread->process);
+      EnableProfiling(GetRunningThread()->process);
       break;
     case Syscall::DisableAndOutputProfiling:
-      DisableAndOutputProfiling(running_thread->process);
+      DisableAndOutputProfiling(GetRunningThread()->process);
       break;
     case Syscall::SetThatProcessCaresAboutCpuTracking:
       SetThatProcessCaresAboutCpuTracking(
-          running_thread->process, currently_executing_thread_regs->rax != 0);
+          GetRunningThread()->process, GetCurrentThreadRegisters()->rax != 0);
       break;
     case Syscall::SetThreadPriority: {
-      size_t target_thread_id = currently_executing_thread_regs->rax;
-      size_t priority_val = currently_executing_thread_regs->rbx;
+      size_t target_thread_id = GetCurrentThreadRegisters()->rax;
+      size_t priority_val = GetCurrentThreadRegisters()->rbx;
 
       Thread* target_thread = nullptr;
-      if (target_thread_id == 0 || target_thread_id == running_thread->id) {
-        target_thread = running_thread;
+      if (target_thread_id == 0 || target_thread_id == GetRunningThread()->id) {
+        target_thread = GetRunningThread();
       } else {
         target_thread =
-            GetThreadFromTid(running_thread->process, target_thread_id);
+            GetThreadFromTid(GetRunningThread()->process, target_thread_id);
       }
 
       if (target_thread == nullptr) {
         // Invalid thread ID or not part of the caller.
-        currently_executing_thread_regs->rax = 1;
+        GetCurrentThreadRegisters()->rax = 1;
         break;
       }
 
       if (priority_val > static_cast<size_t>(ThreadPriority::Idle)) {
         // Invalid priority level.
-        currently_executing_thread_regs->rax = 2;
+        GetCurrentThreadRegisters()->rax = 2;
         break;
       }
 
       ThreadPriority new_priority = static_cast<ThreadPriority>(priority_val);
       if (new_priority == ThreadPriority::InterruptDriver &&
-          !running_thread->process->is_driver) {
+          !GetRunningThread()->process->is_driver) {
         // Not a driver and trying to request InterruptDriver priority.
-        currently_executing_thread_regs->rax = 3;
+        GetCurrentThreadRegisters()->rax = 3;
         break;
       }
 
       SetThreadPriority(target_thread, new_priority);
-      currently_executing_thread_regs->rax = 0;
+      GetCurrentThreadRegisters()->rax = 0;
       break;
     }
     case Syscall::SetFocusedProcess: {
       // Only the Window Manager can change the focused process.
-      if (!strcmp(running_thread->process->name, (void*)"Window Manager", 14)) {
-        size_t target_pid = currently_executing_thread_regs->rax;
+      if (!strcmp(GetRunningThread()->process->name, (void*)"Window Manager",
+                  14)) {
+        size_t target_pid = GetCurrentThreadRegisters()->rax;
         Process* target = GetProcessFromPid(target_pid);
         if (target != nullptr) SetFocusedProcess(target);
       }
       break;
     }
     case Syscall::RegisterSharedMemoryEvent:
-      RegisterSharedMemoryEvent(running_thread->process,
-                                currently_executing_thread_regs->rax,
-                                currently_executing_thread_regs->rbx,
-                                currently_executing_thread_regs->rdx);
+      RegisterSharedMemoryEvent(GetRunningThread()->process,
+                                GetCurrentThreadRegisters()->rax,
+                                GetCurrentThreadRegisters()->rbx,
+                                GetCurrentThreadRegisters()->rdx);
       break;
     case Syscall::UnregisterSharedMemoryEvent:
-      UnregisterSharedMemoryEvent(running_thread->process,
-                                  currently_executing_thread_regs->rax,
-                                  currently_executing_thread_regs->rbx);
+      UnregisterSharedMemoryEvent(GetRunningThread()->process,
+                                  GetCurrentThreadRegisters()->rax,
+                                  GetCurrentThreadRegisters()->rbx);
       break;
     case Syscall::TriggerSharedMemoryEvent:
-      TriggerSharedMemoryEvent(currently_executing_thread_regs->rax,
-                               currently_executing_thread_regs->rbx);
+      TriggerSharedMemoryEvent(GetCurrentThreadRegisters()->rax,
+                               GetCurrentThreadRegisters()->rbx);
       break;
     case Syscall::GetTimeInfo:
-      GetTimeInfo(currently_executing_thread_regs->rax,
-                  currently_executing_thread_regs->rbx);
+      GetTimeInfo(GetCurrentThreadRegisters()->rax,
+                  GetCurrentThreadRegisters()->rbx);
       break;
     case Syscall::SetTimeInfo:
-      if (running_thread->process->is_driver) {
-        SetTimeInfo(currently_executing_thread_regs->rax);
+      if (GetRunningThread()->process->is_driver) {
+        SetTimeInfo(GetCurrentThreadRegisters()->rax);
       }
       break;
     case Syscall::RegisterMessageForWhenTimeInfoChanges:
       RegisterMessageForWhenTimeInfoChanges(
-          running_thread->process, currently_executing_thread_regs->rax);
+          GetRunningThread()->process, GetCurrentThreadRegisters()->rax);
       break;
   }
 
-  if (running_thread) running_thread->in_syscall = false;
+  if (GetRunningThread()) GetRunningThread()->in_syscall = false;
 }
 
 extern "C" bool RescheduleWithIretq() {
-  return running_thread == nullptr || !running_thread->in_syscall;
+  return GetRunningThread() == nullptr || !GetRunningThread()->in_syscall;
 }
 
 #endif  // TEST
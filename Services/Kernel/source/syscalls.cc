@@ -25,8 +25,12 @@ const char *GetSystemCallName(Syscall syscall) {
       return "Unknown";
     case Syscall::PrintDebugCharacter:
       return "PrintDebugCharacter";
+    case Syscall::PrintDebugString:
+      return "PrintDebugString";
     case Syscall::PrintRegistersAndStack:
       return "PrintRegistersAndStack";
+    case Syscall::ReadKernelLog:
+      return "ReadKernelLog";
     case Syscall::CreateThread:
       return "CreateThread";
     case Syscall::GetThisThreadId:
@@ -55,6 +59,8 @@ const char *GetSystemCallName(Syscall syscall) {
       return "AllocateMemoryPages";
     case Syscall::AllocateMemoryPagesBelowPhysicalBase:
       return "AllocateMemoryPagesBelowPhysicalBase";
+    case Syscall::AllocateContiguousPhysicalPages:
+      return "AllocateContiguousPhysicalPages";
     case Syscall::ReleaseMemoryPages:
       return "ReleaseMemoryPages";
     case Syscall::MapPhysicalMemory:
@@ -97,6 +103,8 @@ const char *GetSystemCallName(Syscall syscall) {
       return "GetProcesses";
     case Syscall::GetNameOfProcess:
       return "GetNameOfProcess";
+    case Syscall::GetProcessSnapshots:
+      return "GetProcessSnapshots";
     case Syscall::NotifyWhenProcessDisappears:
       return "NotifyWhenProcessDisappears";
     case Syscall::StopNotifyingWhenProcessDisappears:
@@ -133,6 +141,12 @@ const char *GetSystemCallName(Syscall syscall) {
       return "PollForMessage";
     case Syscall::SleepForMessage:
       return "SleepForMessage";
+    case Syscall::GetMessageMailbox:
+      return "GetMessageMailbox";
+    case Syscall::SendMessages:
+      return "SendMessages";
+    case Syscall::ReceiveMessages:
+      return "ReceiveMessages";
     case Syscall::RegisterMessageToSendOnInterrupt:
       return "RegisterMessageToSendOnInterrupt";
     case Syscall::UnregisterMessageToSendOnInterrupt:
@@ -163,6 +177,12 @@ const char *GetSystemCallName(Syscall syscall) {
       return "UnregisterSharedMemoryEvent";
     case Syscall::TriggerSharedMemoryEvent:
       return "TriggerSharedMemoryEvent";
+    case Syscall::FutexWait:
+      return "FutexWait";
+    case Syscall::FutexWake:
+      return "FutexWake";
+    case Syscall::FutexRequeue:
+      return "FutexRequeue";
   }
 }
 
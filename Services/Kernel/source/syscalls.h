@@ -15,13 +15,15 @@
 #pragma once
 
 // The total number of system calls.
-#define NUMBER_OF_SYSCALLS 73
+#define NUMBER_OF_SYSCALLS 82
 
 // The canonical list of system calls, mapped to the system call number.
 enum class Syscall {
   // Syscalls
   PrintDebugCharacter = 0,
+  PrintDebugString = 80,
   PrintRegistersAndStack = 26,
+  ReadKernelLog = 81,
   // Threading,
   CreateThread = 1,
   GetThisThreadId = 2,
@@ -35,15 +37,18 @@ enum class Syscall {
   SetThreadSegmentExtended = 63,
   SetAddressToClearOnThreadTermination = 28,
   SetThreadPriority = 65,
+  FutexWait = 76,
+  FutexWake = 77,
+  FutexRequeue = 78,
   // Memory management,
   AllocateMemoryPages = 12,
   AllocateMemoryPagesBelowPhysicalBase = 49,
+  AllocateContiguousPhysicalPages = 75,
   ReleaseMemoryPages = 13,
   MapPhysicalMemory = 41,
   GetPhysicalAddressOfVirtualAddress = 50,
   GetSystemMemoryMetrics = 14,
   GetProcessHealthMetrics = 15,
-  // 16 is Free / Unassigned
   CreateSharedMemory = 42,
   JoinSharedMemory = 43,
   JoinChildProcessInSharedMemory = 61,
@@ -61,6 +66,7 @@ enum class Syscall {
   TerminateProcess = 7,
   GetProcesses = 22,
   GetNameOfProcess = 29,
+  GetProcessSnapshots = 79,
   NotifyWhenProcessDisappears = 30,
   StopNotifyingWhenProcessDisappears = 31,
   CreateProcess = 51,
@@ -85,6 +91,9 @@ enum class Syscall {
   SendMessage = 17,
   PollForMessage = 18,
   SleepForMessage = 19,
+  GetMessageMailbox = 16,
+  SendMessages = 73,
+  ReceiveMessages = 74,
   SetSystemMessageHandlers = 8,
   // Interrupts,
   RegisterMessageToSendOnInterrupt = 20,
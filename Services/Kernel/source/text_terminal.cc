@@ -2,16 +2,26 @@
 #include "text_terminal.h"
 
 #include "io.h"
+#include "log_ring.h"
 #include "string_view.h"
 #include "virtual_allocator.h"
 
 
-// The text terminal is implemented by outputting over COM1.
+// The text terminal is implemented by writing into the kernel log ring, which
+// is drained over COM1 each time the serial port's transmit FIFO empties.
 namespace {
 
 // The IO port to use.
 constexpr unsigned short kPort = 0x3f8;  // COM1
 
+// How many bytes the serial port's transmit FIFO holds.
+constexpr size_t kTransmitFifoSize = 16;
+
+// Is the serial port done sending everything that was written to it? If so,
+// nothing will raise another transmit interrupt, so the next byte written into
+// the log has to start draining it.
+bool serial_is_idle = true;
+
 // Charset for hexadecimal digits.
 constexpr const char* kHexidecimalCharset = "0123456789ABCDEF";
 
@@ -38,31 +48,71 @@ void InitializeSerialOutput() {
   WriteIOByte(kPort + 2,
               0xC7);  // Enable FIFO, clear them, with 14-byte threshold
   WriteIOByte(kPort + 4, 0x0B);  // IRQs enabled, RTS/DSR set
+  WriteIOByte(kPort + 1, 0x02);  // Interrupt when the transmit FIFO is empty
+}
+
+// Is the serial port's transmit FIFO empty?
+bool IsTransmitFifoEmpty() { return (ReadIOByte(kPort + 5) & 0x20) != 0; }
+
+// Fills the serial port's transmit FIFO from the log ring. The FIFO must be
+// empty.
+void FillTransmitFifo() {
+  LogRing& ring = KernelLogRing();
+  size_t sent = 0;
+  while (sent < kTransmitFifoSize) {
+    const char* data;
+    size_t bytes = ring.PeekUndrained(data);
+    if (bytes == 0) break;
+    if (bytes > kTransmitFifoSize - sent) bytes = kTransmitFifoSize - sent;
+    for (size_t i = 0; i < bytes; i++) WriteIOByte(kPort, data[i]);
+    ring.MarkDrained(bytes);
+    sent += bytes;
+  }
+  serial_is_idle = sent == 0;
+}
+
+// Sends whatever the serial port can take right now without waiting.
+void DrainSerialOutputWithoutWaiting() {
+  if (IsTransmitFifoEmpty()) FillTransmitFifo();
+}
+
+// Waits for the serial port until there's room for `length` bytes in the log
+// ring. This only happens when printing faster than serial can keep up with
+// for long enough to fill the ring, in which case it's better to slow down the
+// printer than to lose output.
+void DrainSerialOutputUntilThereIsRoomFor(size_t length) {
+  LogRing& ring = KernelLogRing();
+  while (ring.FreeSpace() < length) {
+    while (!IsTransmitFifoEmpty());
+    FillTransmitFifo();
+  }
 }
 
-// Writes a single byte directly to serial COM1 without context checking.
-void WriteSerialByte(char c) {
-  while ((ReadIOByte(kPort + 5) & 0x20) == 0);
-  WriteIOByte(kPort, c);
+// Writes a single byte into the log without context checking.
+void WriteLogByte(char c) {
+  LogRing& ring = KernelLogRing();
+  if (ring.FreeSpace() == 0) DrainSerialOutputUntilThereIsRoomFor(1);
+  ring.Write(&c, 1);
+  if (serial_is_idle) DrainSerialOutputWithoutWaiting();
 }
 
-// Writes a null-terminated string directly to serial.
-void WriteSerialString(const char* str) {
+// Writes a null-terminated string into the log.
+void WriteLogString(const char* str) {
   if (str == nullptr) return;
   while (*str) {
-    WriteSerialByte(*str);
+    WriteLogByte(*str);
     str++;
   }
 }
 
-// Emits decimal integer directly to serial.
-void WriteSerialDecimal(int val) {
+// Writes a decimal integer into the log.
+void WriteLogDecimal(int val) {
   if (val < 0) {
-    WriteSerialByte('-');
+    WriteLogByte('-');
     val = -val;
   }
   if (val == 0) {
-    WriteSerialByte('0');
+    WriteLogByte('0');
     return;
   }
   char temp[12];
@@ -71,7 +121,7 @@ void WriteSerialDecimal(int val) {
     temp[idx++] = '0' + (val % 10);
     val /= 10;
   }
-  for (int i = idx - 1; i >= 0; i--) WriteSerialByte(temp[i]);
+  for (int i = idx - 1; i >= 0; i--) WriteLogByte(temp[i]);
 }
 
 // Checks string equality.
@@ -105,16 +155,16 @@ void EnsurePrintSourceEmitted() {
     return;
 
   // Emit escape sequence \033]P;<pid>;<channel_id>;<name>\007
-  WriteSerialByte('\033');
-  WriteSerialByte(']');
-  WriteSerialByte('P');
-  WriteSerialByte(';');
-  WriteSerialDecimal(target_pid);
-  WriteSerialByte(';');
-  WriteSerialDecimal(target_channel);
-  WriteSerialByte(';');
-  WriteSerialString(target_name ? target_name : kKernelName);
-  WriteSerialByte('\007');
+  WriteLogByte('\033');
+  WriteLogByte(']');
+  WriteLogByte('P');
+  WriteLogByte(';');
+  WriteLogDecimal(target_pid);
+  WriteLogByte(';');
+  WriteLogDecimal(target_channel);
+  WriteLogByte(';');
+  WriteLogString(target_name ? target_name : kKernelName);
+  WriteLogByte('\007');
 
   last_emitted_pid = target_pid;
   last_emitted_name = target_name;
@@ -138,7 +188,7 @@ Printer::Printer() : number_format_(NumberFormat::Decimal) {}
 // Prints a single character.
 Printer& Printer::operator<<(char c) {
   EnsurePrintSourceEmitted();
-  WriteSerialByte(c);
+  WriteLogByte(c);
   return *this;
 }
 
@@ -236,10 +286,28 @@ void Printer::PrintDecimal(size_t n, bool with_commas) {
 Printer print;
 
 void InitializePrinter() {
+  KernelLogRing().Clear();
+  serial_is_idle = true;
   InitializeSerialOutput();
   // The kernel isn't set up for global constructors, so the printer must be
   // initialized explicitly.
   print = Printer();
 }
 
+void HandleSerialInterrupt() {
+  // Reading the interrupt identification register acknowledges the transmit
+  // interrupt.
+  ReadIOByte(kPort + 2);
+  DrainSerialOutputWithoutWaiting();
+}
+
+void DrainSerialOutput() {
+  if (KernelLogRing().UndrainedBytes() > 0) DrainSerialOutputWithoutWaiting();
+}
+
+void FlushPrinter() {
+  DrainSerialOutputUntilThereIsRoomFor(kLogRingSize);
+  while (!IsTransmitFifoEmpty());
+}
+
 #endif // TEST
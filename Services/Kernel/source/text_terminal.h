@@ -70,3 +70,15 @@ extern Printer print;
 
 // Initializes the text printer.
 void InitializePrinter();
+
+// Handles the serial port's interrupt, which is raised when it's ready for
+// more output.
+void HandleSerialInterrupt();
+
+// Sends more of the printed output to the serial port if it's ready for it.
+// This is a fallback in case a serial interrupt was missed.
+void DrainSerialOutput();
+
+// Waits until everything printed has been sent over the serial port. Call this
+// before halting so the last words aren't lost.
+void FlushPrinter();
@@ -16,8 +16,10 @@ namespace {
 // The model specific register that stores the FS segment's base address.
 #define FSBASE_MSR 0xC0000100
 
-// The model specific register that stores the GS segment's base address.
-#define GSBASE_MSR 0xC0000101
+// The model specific register that stores the GS segment's base address while
+// in user space. The kernel swaps it with GS's base address (which points to
+// the Cpu structure) when entering and leaving the kernel.
+#define KERNEL_GSBASE_MSR 0xC0000102
 
 // The number of stack pages.
 #define STACK_PAGES 64
@@ -103,6 +105,7 @@ Thread* CreateThread(Process* process, size_t entry_point, size_t param,
 
   // The thread isn't initially awake until we schedule it.
   thread->awake = false;
+  thread->cpu = nullptr;
   thread->wake_signal_pending = false;
 
   // The thread hasn't ran for any time slices yet.
@@ -120,6 +123,11 @@ Thread* CreateThread(Process* process, size_t entry_point, size_t param,
 
   // The thread isn't sleeping waiting for messages.
   thread->thread_is_waiting_for_message = false;
+  thread->thread_is_waiting_for_message_in_mailbox = false;
+
+  // The thread isn't waiting on a futex.
+  thread->thread_is_waiting_on_futex = false;
+  thread->futex_timeout = nullptr;
 
   // Add this to the tree of threads in the process.
   process->threads.Insert(thread);
@@ -143,6 +151,7 @@ void DestroyThread(Thread* thread, bool process_being_destroyed) {
   if (thread->awake) {
     UnscheduleThread(thread);
   }
+  StopThreadFromRunning(thread);
 
   // Free the thread's stack.
   if (thread->stack_allocated_by_kernel) {
@@ -157,6 +166,9 @@ void DestroyThread(Thread* thread, bool process_being_destroyed) {
   if (thread->thread_is_waiting_for_message)
     process->threads_sleeping_for_message.Remove(thread);
 
+  // If this thread is waiting on a futex, remove it from the wait queue.
+  RemoveThreadFromFutex(thread);
+
   // Remove this thread from the process's tree of threads.
   process->threads.Remove(thread);
 
@@ -178,6 +190,7 @@ void DestroyThread(Thread* thread, bool process_being_destroyed) {
       *(uint64*)((size_t)TemporarilyMapPhysicalPages(physical_page, 1) +
                  offset_in_page) = 0;
 
+      FutexWake(process, address_cleared, 1);
       AwakeFutexInProcess(process, address_cleared);
     }
   }
@@ -214,7 +227,7 @@ Thread* GetThreadFromTid(Process* process, size_t tid) {
 void SetThreadSegment(Thread* thread, size_t address) {
   thread->thread_fs_segment_offset = address;
 
-  if (running_thread != nullptr && thread == running_thread) {
+  if (GetRunningThread() != nullptr && thread == GetRunningThread()) {
     LoadThreadSegment(thread);
   }
 }
@@ -225,7 +238,7 @@ void SetThreadSegments(Thread* thread, size_t fs_address, bool set_fs,
   if (set_fs) thread->thread_fs_segment_offset = fs_address;
   if (set_gs) thread->thread_gs_segment_offset = gs_address;
 
-  if (running_thread != nullptr && thread == running_thread) {
+  if (GetRunningThread() != nullptr && thread == GetRunningThread()) {
     LoadThreadSegment(thread);
   }
 }
@@ -233,7 +246,8 @@ void SetThreadSegments(Thread* thread, size_t fs_address, bool set_fs,
 // Load's a thread segment.
 void LoadThreadSegment(Thread* thread) {
   WriteModelSpecificRegister(FSBASE_MSR, thread->thread_fs_segment_offset);
-  WriteModelSpecificRegister(GSBASE_MSR, thread->thread_gs_segment_offset);
+  WriteModelSpecificRegister(KERNEL_GSBASE_MSR,
+                             thread->thread_gs_segment_offset);
 }
 
 #ifdef TEST
@@ -2,12 +2,15 @@
 
 #include "aa_tree.h"
 #include "fpu.h"
+#include "futex.h"
 #include "linked_list.h"
 #include "registers.h"
 #include "scheduler.h"
 #include "types.h"
 
+struct Cpu;
 struct Process;
+struct TimerEvent;
 struct ThreadSleepingForSharedMemoryPage;
 struct ThreadWaitingForSharedMemoryPage;
 
@@ -58,6 +61,10 @@ struct Thread {
   // The dynamic priority of the thread.
   ThreadPriority priority;
 
+  // The CPU this thread is queued on, or last ran on. nullptr if the thread
+  // has never been scheduled.
+  Cpu* cpu;
+
   // The number of time slices this thread has ran for. This might not be so
   // accurate as to how much processing time a thread has had because partial
   // slices (such as the previous thread 'yielding') is considered a full slice
@@ -73,10 +80,26 @@ struct Thread {
   // The linked queue of threads in the process that are waiting for messages.
   LinkedListNode node_sleeping_for_messages;
   bool thread_is_waiting_for_message : 1;
+  // Set if the message should be written into the process's mailbox rather
+  // than loaded into the thread's registers.
+  bool thread_is_waiting_for_message_in_mailbox : 1;
 
   // Set if this thread is waiting for shared memory.
   ThreadWaitingForSharedMemoryPage *thread_is_waiting_for_shared_memory;
 
+  // Set if this thread is waiting on a futex.
+  bool thread_is_waiting_on_futex : 1;
+
+  // The word this thread is waiting on, if it's waiting on a futex.
+  FutexKey futex_key;
+
+  // Linked list of threads waiting in the same futex bucket.
+  LinkedListNode node_in_futex_queue;
+
+  // The timer event that wakes this thread if it waits on a futex for too
+  // long, or nullptr if it waits until woken.
+  TimerEvent *futex_timeout;
+
   // If not 0, the virtual address in the process's space to clear on
   // termination of the thread. Must be 8-byte aligned.
   size_t address_to_clear_on_termination;
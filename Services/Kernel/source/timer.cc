@@ -1,9 +1,12 @@
 #include "timer.h"
 
 #include "interrupts.h"
+#include "cpu.h"
+#include "futex.h"
 #include "io.h"
 #include "heap_allocator.h"
 #include "linked_list.h"
+#include "local_apic.h"
 #include "memory.h"
 #include "messages.h"
 #include "object_pool.h"
@@ -125,39 +128,17 @@ void CalibrateTsc() {
 #endif
 
 #ifndef TEST
-volatile uint32* lapic_base = nullptr;
 uint64 lapic_ticks_per_microsecond = 1;
 
-inline void WriteLapicRegister(uint32 offset, uint32 value) {
-  lapic_base[offset / 4] = value;
-}
-
-inline uint32 ReadLapicRegister(uint32 offset) {
-  return lapic_base[offset / 4];
-}
-
-void InitializeLapic() {
-  // Map the LAPIC base address
-  size_t virtual_addr = KernelAddressSpace().MapPhysicalPages(0xFEE00000, 1);
-  lapic_base = reinterpret_cast<volatile uint32*>(virtual_addr);
-
-  // Mask the PIT IRQ on the legacy PIC (IRQ 0)
-  uint8 pic1_mask = ReadIOByte(0x21);
-  WriteIOByte(0x21, pic1_mask | 0x01);
-
-  // Enable the Local APIC (SVR = 0xF0) with spurious vector 0xFF
-  WriteLapicRegister(0xF0, 0xFF | (1 << 8));
-}
-
 void CalibrateLapicTimer() {
   // Set divisor to divide-by-16
-  WriteLapicRegister(0x3E0, 3);
+  WriteLocalApicRegister(LOCAL_APIC_TIMER_DIVIDE_CONFIGURATION, 3);
 
   // Mask the LAPIC timer register
-  WriteLapicRegister(0x320, 1 << 16);
+  WriteLocalApicRegister(LOCAL_APIC_TIMER, 1 << 16);
 
   // Set initial count to maximum (0xFFFFFFFF)
-  WriteLapicRegister(0x380, 0xFFFFFFFF);
+  WriteLocalApicRegister(LOCAL_APIC_TIMER_INITIAL_COUNT, 0xFFFFFFFF);
 
   // Measure a 10ms window using the TSC
   uint64 tsc_start = ReadTimestampCounter();
@@ -168,7 +149,7 @@ void CalibrateLapicTimer() {
   }
 
   // Read remaining count and calculate ticks elapsed
-  uint32 lapic_end = ReadLapicRegister(0x390);
+  uint32 lapic_end = ReadLocalApicRegister(LOCAL_APIC_TIMER_CURRENT_COUNT);
   uint32 elapsed_ticks = 0xFFFFFFFF - lapic_end;
 
   lapic_ticks_per_microsecond = elapsed_ticks / 10000;
@@ -177,7 +158,7 @@ void CalibrateLapicTimer() {
   }
 
   // Stop the timer for now
-  WriteLapicRegister(0x380, 0);
+  WriteLocalApicRegister(LOCAL_APIC_TIMER_INITIAL_COUNT, 0);
 
   print << "LAPIC Timer Calibrated: " << lapic_ticks_per_microsecond
         << " ticks/microsecond\n";
@@ -188,26 +169,53 @@ void SetLapicTimerOneShot(size_t microseconds) {
     microseconds = 1;
   }
   // Set timer to Vector 48, One-Shot Mode, Unmasked
-  WriteLapicRegister(0x320, 48);
+  WriteLocalApicRegister(LOCAL_APIC_TIMER, LOCAL_APIC_TIMER_INTERRUPT);
 
   uint64 ticks = microseconds * lapic_ticks_per_microsecond;
   if (ticks > 0xFFFFFFFF) {
     ticks = 0xFFFFFFFF;
   }
-  WriteLapicRegister(0x380, static_cast<uint32>(ticks));
+  WriteLocalApicRegister(LOCAL_APIC_TIMER_INITIAL_COUNT,
+                         static_cast<uint32>(ticks));
 }
 
 void DisableLapicTimer() {
-  WriteLapicRegister(0x320, 1 << 16);
-  WriteLapicRegister(0x380, 0);
+  WriteLocalApicRegister(LOCAL_APIC_TIMER, 1 << 16);
+  WriteLocalApicRegister(LOCAL_APIC_TIMER_INITIAL_COUNT, 0);
 }
 #endif
 
+// Adds a timer event to the tree of scheduled events and its process.
+void ScheduleTimerEvent(TimerEvent* timer_event) {
+  // Add to global tree of scheduled timer events.
+  scheduled_timer_events.Insert(timer_event);
+  // Add to process.
+  timer_event->process_to_send_message_to->timer_events.AddBack(timer_event);
+
+  if (GetCurrentCpu()->id == 0) {
+    ReprogramTimerForNextDeadline();
+  } else if (scheduled_timer_events.FirstItem() == timer_event) {
+    // Timer events are triggered by the bootstrap processor, so let it know
+    // that it might need to wake up sooner.
+    SendInterprocessorInterruptToCpu(&cpus[0]);
+  }
+}
+
 }  // namespace
 
 // The function that gets called each time to timer fires.
 void TimerHandler() {
+  if (GetCurrentCpu()->id != 0) {
+    // Only the bootstrap processor keeps track of timer events and epochs. The
+    // other CPUs' timers only fire to end timeslices.
+    ScheduleNextThread();
+    ReprogramTimerForNextDeadline();
+    return;
+  }
+
 #ifndef TEST
+  DrainSerialOutput();
+
   size_t now = GetCurrentTimestampInMicroseconds();
   size_t delta_time = now - microseconds_since_kernel_started;
   microseconds_since_kernel_started = now;
@@ -288,9 +296,14 @@ void TimerHandler() {
     // Remove from the process's timer list.
     timer_event->process_to_send_message_to->timer_events.Remove(timer_event);
 
-    // Send the message to the process.
-    SendKernelMessageToProcess(timer_event->process_to_send_message_to,
-                               timer_event->message_id_to_send, 0, 0, 0, 0, 0);
+    if (timer_event->thread_to_wake != nullptr) {
+      TimeOutFutexWait(timer_event->thread_to_wake);
+    } else {
+      // Send the message to the process.
+      SendKernelMessageToProcess(timer_event->process_to_send_message_to,
+                                 timer_event->message_id_to_send, 0, 0, 0, 0,
+                                 0);
+    }
 
     // Release the memory for the TimerEvent.
     ObjectPool<TimerEvent>::Release(timer_event);
@@ -316,7 +329,7 @@ void InitializeTimer() {
   utc_offset = 0;
 #ifndef TEST
   CalibrateTsc();
-  InitializeLapic();
+  InitializeLocalApic();
   CalibrateLapicTimer();
   SetLapicTimerOneShot(10000);
   tsc_multiplier = 1.0 / (double)tsc_ticks_per_microsecond;
@@ -332,6 +345,17 @@ void InitializeTimer() {
 #endif
 }
 
+// Initializes the current CPU's timer. Used by application processors, since
+// InitializeTimer() has already calibrated the timer on the bootstrap
+// processor.
+void InitializeTimerForCpu() {
+#ifndef TEST
+  // Use the same divisor as CalibrateLapicTimer().
+  WriteLocalApicRegister(LOCAL_APIC_TIMER_DIVIDE_CONFIGURATION, 3);
+  DisableLapicTimer();
+#endif
+}
+
 // Returns the current time, in microseconds, since the kernel has started.
 size_t GetCurrentTimestampInMicroseconds() {
 #ifdef TEST
@@ -346,7 +370,7 @@ size_t GetCurrentTimestampInMicroseconds() {
 }
 
 // Sends a message to the process at or after a specified number of microseconds
-// have ellapsed since the kernel started.
+// have elapsed since the kernel started.
 void SendMessageToProcessAtMicroseconds(Process* process, size_t timestamp,
                                         size_t message_id) {
   TimerEvent* timer_event = ObjectPool<TimerEvent>::Allocate();
@@ -355,13 +379,29 @@ void SendMessageToProcessAtMicroseconds(Process* process, size_t timestamp,
   timer_event->process_to_send_message_to = process;
   timer_event->timestamp_to_trigger_at = timestamp;
   timer_event->message_id_to_send = message_id;
+  timer_event->thread_to_wake = nullptr;
+  ScheduleTimerEvent(timer_event);
+}
 
-  // Add to global tree of scheduled timer events.
-  scheduled_timer_events.Insert(timer_event);
-  // Add to process.
-  process->timer_events.AddBack(timer_event);
+// Times out the thread's wait on a futex at or after a specified number of
+// microseconds have elapsed since the kernel started.
+TimerEvent* TimeOutFutexWaitAtMicroseconds(Thread* thread, size_t timestamp) {
+  TimerEvent* timer_event = ObjectPool<TimerEvent>::Allocate();
+  if (timer_event == nullptr) return nullptr;
 
-  ReprogramTimerForNextDeadline();
+  timer_event->process_to_send_message_to = thread->process;
+  timer_event->timestamp_to_trigger_at = timestamp;
+  timer_event->message_id_to_send = 0;
+  timer_event->thread_to_wake = thread;
+  ScheduleTimerEvent(timer_event);
+  return timer_event;
+}
+
+// Cancels a timer event that hasn't triggered yet.
+void CancelTimerEvent(TimerEvent* timer_event) {
+  scheduled_timer_events.Remove(timer_event);
+  timer_event->process_to_send_message_to->timer_events.Remove(timer_event);
+  ObjectPool<TimerEvent>::Release(timer_event);
 }
 
 // Cancel all timer events that could be scheduled for a process.
@@ -375,34 +415,26 @@ void CancelAllTimerEventsForProcess(Process* process) {
   if (changed) ReprogramTimerForNextDeadline();
 }
 
-extern "C" void SendLapicEoi() {
-#ifndef TEST
-  if (lapic_base != nullptr) {
-    lapic_base[0xB0 / 4] = 0;
-  }
-#endif
-}
-
 void UpdateRunningThreadTimeslice() {
 #ifndef TEST
-  if (running_thread == nullptr) return;
+  if (GetRunningThread() == nullptr) return;
   size_t now = GetCurrentTimestampInMicroseconds();
-  if (running_thread->current_run_start_timestamp == 0) {
-    running_thread->current_run_start_timestamp = now;
+  if (GetRunningThread()->current_run_start_timestamp == 0) {
+    GetRunningThread()->current_run_start_timestamp = now;
     return;
   }
-  if (now > running_thread->current_run_start_timestamp) {
-    size_t elapsed = now - running_thread->current_run_start_timestamp;
-    if (elapsed >= running_thread->remaining_timeslice_microseconds) {
-      running_thread->remaining_timeslice_microseconds = 0;
+  if (now > GetRunningThread()->current_run_start_timestamp) {
+    size_t elapsed = now - GetRunningThread()->current_run_start_timestamp;
+    if (elapsed >= GetRunningThread()->remaining_timeslice_microseconds) {
+      GetRunningThread()->remaining_timeslice_microseconds = 0;
     } else {
-      running_thread->remaining_timeslice_microseconds -= elapsed;
+      GetRunningThread()->remaining_timeslice_microseconds -= elapsed;
     }
 
     // Execute CPU tracking ONLY if tracking is active
     if (IsCpuTrackingActive()) {
-      size_t core_id = 0;  // Single-core currently
-      Process* proc = running_thread->process;
+      size_t core_id = GetCurrentCpu()->id;
+      Process* proc = GetRunningThread()->process;
 
       // Catch up the process if it was idle during previous epochs
       CatchUpProcessCpuUsage(proc);
@@ -416,7 +448,7 @@ void UpdateRunningThreadTimeslice() {
       }
     }
   }
-  running_thread->current_run_start_timestamp = now;
+  GetRunningThread()->current_run_start_timestamp = now;
 #endif
 }
 
@@ -425,14 +457,18 @@ void ReprogramTimerForNextDeadline() {
   size_t now = GetCurrentTimestampInMicroseconds();
   size_t next_deadline = 0;
 
-  if (running_thread != nullptr && NeedsTimesliceInterrupt(running_thread)) {
-    next_deadline = running_thread->current_run_start_timestamp +
-                    running_thread->remaining_timeslice_microseconds;
-  } else if (running_thread == nullptr && HasAwakeThreads()) {
+  Thread* thread = GetRunningThread();
+  if (thread != nullptr && NeedsTimesliceInterrupt(thread)) {
+    next_deadline = thread->current_run_start_timestamp +
+                    thread->remaining_timeslice_microseconds;
+  } else if (thread == nullptr && HasAwakeThreads()) {
     next_deadline = now;
   }
 
-  TimerEvent* first_event = scheduled_timer_events.FirstItem();
+  // Timer events are only triggered by the bootstrap processor.
+  TimerEvent* first_event = GetCurrentCpu()->id == 0
+                                ? scheduled_timer_events.FirstItem()
+                                : nullptr;
   if (first_event != nullptr) {
     size_t event_time = first_event->timestamp_to_trigger_at;
     if (next_deadline == 0 || event_time < next_deadline) {
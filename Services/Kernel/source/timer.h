@@ -5,6 +5,8 @@
 // the basis of preemptive multitasking.
 
 struct Process;
+struct Thread;
+struct TimerEvent;
 
 // The function that gets called each time to timer fires.
 void TimerHandler();
@@ -12,14 +14,25 @@ void TimerHandler();
 // Initializes the timer.
 void InitializeTimer();
 
+// Initializes the timer on an application processor.
+void InitializeTimerForCpu();
+
 // Returns the current time, in microseconds, since the kernel has started.
 size_t GetCurrentTimestampInMicroseconds();
 
 // Sends a message to the process at or after a specified number of microseconds
-// have ellapsed since the kernel started.
+// have elapsed since the kernel started.
 void SendMessageToProcessAtMicroseconds(Process* process, size_t timestamp,
                                         size_t message_id);
 
+// Times out the thread's wait on a futex at or after a specified number of
+// microseconds have elapsed since the kernel started. Returns nullptr if the
+// event couldn't be allocated.
+TimerEvent* TimeOutFutexWaitAtMicroseconds(Thread* thread, size_t timestamp);
+
+// Cancels a timer event that hasn't triggered yet.
+void CancelTimerEvent(TimerEvent* timer_event);
+
 // Cancel all timer events that could be scheduled for a process.
 void CancelAllTimerEventsForProcess(Process* process);
 
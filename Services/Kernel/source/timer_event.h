@@ -19,6 +19,7 @@
 #include "types.h"
 
 struct Process;
+struct Thread;
 
 // An event that occurs at a timestamp.
 struct TimerEvent {
@@ -32,6 +33,10 @@ struct TimerEvent {
   // The message ID of the timer to send.
   size_t message_id_to_send;
 
+  // If not nullptr, the thread whose futex wait times out, instead of sending
+  // a message.
+  Thread* thread_to_wake;
+
   // Node in tree of all scheduled TimerEvents.
   AATreeNode node_in_all_timer_events;
 
@@ -16,6 +16,7 @@
 #include "tss.h"
 
 #include "boot.asm.h"
+#include "cpu.h"
 #include "heap_allocator.h"
 #include "memory.h"
 #include "physical_allocator.h"
@@ -28,19 +29,25 @@ namespace {
 // Index of RSP0 in the TSS (stack pointer for ring 0).
 #define RSP0_LOW 1
 #define RSP0_HIGH 2
-// Pointer to the TSS.
-uint32* tss;
 
 // TSS offset in the GDT. The GDT is hardcoded in boot.asm.
 #define TSS_GDT_OFFSET 0x28
 
-}  // namespace
+// The number of entries in the GDT, including the 2 entries taken by the TSS.
+#define GDT_ENTRIES 7
 
-// Initializes the task segment structure.
-void InitializeTss() {
+// Reference to a global descriptor table.
+struct GdtPointer {
+  uint16 limit;
+  size_t base;
+} __attribute__((packed));
+
+// Allocates a TSS for the CPU and writes it into the CPU's GDT.
+void AllocateTss(Cpu* cpu) {
   // Allocate and clear the TSS.
-  tss = (uint32*)malloc(TSS_SIZE);
+  uint32* tss = (uint32*)malloc(TSS_SIZE);
   memset((char*)tss, 0, TSS_SIZE);
+  cpu->tss = tss;
 
   // Set the TSS entry in the GDT.
   uint64 tss_entry_low = 0;
@@ -65,27 +72,55 @@ void InitializeTss() {
 
   tss_entry_dwords[0] = (base >> 32) & 0xFFFFFFFF;
 
-  *(uint64*)(((size_t)&TSSEntry) + VIRTUAL_MEMORY_OFFSET) = tss_entry_low;
-  *(uint64*)(((size_t)&TSSEntry) + VIRTUAL_MEMORY_OFFSET + 8) = tss_entry_high;
+  cpu->gdt[TSS_GDT_OFFSET / 8] = tss_entry_low;
+  cpu->gdt[TSS_GDT_OFFSET / 8 + 1] = tss_entry_high;
 
   // Point the IOPB bitmap offset to the end of TSS structure, because it's
   // unused.
   ((uint16*)tss)[51] = TSS_SIZE;
 }
 
+}  // namespace
+
+// Initializes the task segment structure.
+void InitializeTss() {
+  // The bootstrap processor uses the GDT in boot.asm.
+  Cpu* cpu = GetCurrentCpu();
+  cpu->gdt = (uint64*)(((size_t)&TSSEntry) + VIRTUAL_MEMORY_OFFSET -
+                       TSS_GDT_OFFSET);
+  AllocateTss(cpu);
+
+  // Load the TSS.
+  __asm__ __volatile__("ltr %0" ::"r"((uint16)TSS_GDT_OFFSET));
+}
+
+// Initializes the GDT and task segment structure for an application processor.
+void InitializeTssForCpu(Cpu* cpu) {
+  // Copy the bootstrap processor's segments into a GDT for this CPU.
+  cpu->gdt = (uint64*)malloc(GDT_ENTRIES * 8);
+  for (int i = 0; i < GDT_ENTRIES; i++) cpu->gdt[i] = cpus[0].gdt[i];
+  AllocateTss(cpu);
+}
+
+// Loads the GDT and TSS on the current CPU.
+void LoadTss(Cpu* cpu) {
+  GdtPointer gdt_pointer;
+  gdt_pointer.limit = GDT_ENTRIES * 8 - 1;
+  gdt_pointer.base = (size_t)cpu->gdt;
+  __asm__ __volatile__("lgdt %0" : : "m"(gdt_pointer));
+  __asm__ __volatile__("ltr %0" ::"r"((uint16)TSS_GDT_OFFSET));
+}
+
 // Sets the stack to use for interrupts.
-void SetInterruptStack(size_t interrupt_stack_start_virtual_addr) {
+void SetInterruptStack(Cpu* cpu, size_t interrupt_stack_start_virtual_addr) {
   // Stacks grow downwards.
   size_t top_of_stack = interrupt_stack_start_virtual_addr + PAGE_SIZE;
 
   uint32 low = top_of_stack & 0xFFFFFFFF;
   uint32 high = top_of_stack >> 32;
 
-  tss[RSP0_LOW] = low;
-  tss[RSP0_HIGH] = high;
-
-  // Load the TSS.
-  __asm__ __volatile__("ltr %0" ::"r"((uint16)TSS_GDT_OFFSET));
+  cpu->tss[RSP0_LOW] = low;
+  cpu->tss[RSP0_HIGH] = high;
 }
 
 #endif // TEST
@@ -16,8 +16,16 @@
 
 #include "types.h"
 
+struct Cpu;
+
 // Initializes the task segment structure.
 void InitializeTss();
 
+// Initializes the GDT and task segment structure for an application processor.
+void InitializeTssForCpu(Cpu* cpu);
+
+// Loads the GDT and TSS on the current CPU.
+void LoadTss(Cpu* cpu);
+
 // Sets the stack to use for interrupts.
-void SetInterruptStack(size_t interrupt_stack_start_virtual_addr);
\ No newline at end of file
+void SetInterruptStack(Cpu* cpu, size_t interrupt_stack_start_virtual_addr);
\ No newline at end of file
@@ -13,6 +13,7 @@
 // limitations under the License.
 #include "virtual_address_space.h"
 
+#include "cpu.h"
 #include "object_pool.h"
 #include "physical_allocator.h"
 #include "process.h"
@@ -49,14 +50,15 @@ constexpr size_t kIsExecuteDisabled = (1L << 63L);
 // available.
 VirtualAddressSpace::FreeMemoryRange initial_kernel_memory_range;
 
-// The currently loaded virtual address space.
-VirtualAddressSpace* current_address_space = nullptr;
-
 // A dud page table entry with all but the ownership and present bit set.
 // A zeroed out entry indicates there's no page here, but this is
 // actually reserved, such as for lazily allocated shared buffer.
 constexpr size_t kDudPageEntry = (~(1 | (1 << 9)));
 
+// A page table entry for a page that is allocated and zeroed the first time it
+// is touched. It isn't present, but it is owned by the address space.
+constexpr size_t kLazilyZeroedPageEntry = (1 << 9);
+
 // The size of the page table, in bytes.
 constexpr size_t kPageTableSize = 4096;  // 4 KB
 
@@ -155,13 +157,28 @@ VirtualAddressSpace::~VirtualAddressSpace() {
     return;
   }
   // Switch to kernel space so the address space being freed isn't active.
-  if (current_address_space == this)
+  if (GetCurrentCpu()->current_address_space == this)
     KernelAddressSpace().SwitchToAddressSpace();
 
   // Free the memory pages owned by the address space and all of the tables.
   if (pml4_ == OUT_OF_MEMORY) return;
   ScanAndFreePagesInLevel(pml4_, 0);
-  FreePhysicalPage(pml4_);
+
+  // Other CPUs that were running this address space's threads might not have
+  // switched away yet. They only touch kernel memory until they do, so keep the
+  // PML4 around with just the kernel mapped, and let the last of them free it.
+  bool pml4_is_still_loaded = false;
+  ForEachOnlineCpu([&](Cpu* cpu) {
+    if (cpu->loaded_pml4 != pml4_) return;
+    cpu->pml4_to_free_after_switching = pml4_;
+    pml4_is_still_loaded = true;
+  });
+  if (pml4_is_still_loaded) {
+    size_t* ptr = (size_t*)TemporarilyMapPhysicalPages(pml4_, 0);
+    for (size_t i = 0; i < kPageTableEntries - 1; i++) ptr[i] = 0;
+  } else {
+    FreePhysicalPage(pml4_);
+  }
 
   // Walk through the link of FreeMemoryRange objects and release them.
   while (auto fmr = free_memory_ranges_.PopFront())
@@ -262,7 +279,7 @@ void VirtualAddressSpace::InitializeKernelSpace(
   }
 
   // Set the current address space to a dud entry so SwitchToAddressSpace works.
-  current_address_space = (VirtualAddressSpace*)nullptr;
+  GetCurrentCpu()->current_address_space = (VirtualAddressSpace*)nullptr;
 }
 
 size_t VirtualAddressSpace::FindAndReserveFreePageRange(size_t pages) {
@@ -410,6 +427,83 @@ size_t VirtualAddressSpace::AllocatePagesBelowMaxBaseAddress(
   return start;
 }
 
+size_t VirtualAddressSpace::AllocateContiguousPagesBelowMaxBaseAddress(
+    size_t pages, size_t max_base_address) {
+  size_t start = FindAndReserveFreePageRange(pages);
+  if (start == OUT_OF_MEMORY) return OUT_OF_MEMORY;
+
+  size_t phys = GetContiguousPhysicalPages(pages, max_base_address);
+  if (phys == OUT_OF_PHYSICAL_PAGES) {
+    print << "Out of contiguous physical pages.\n";
+    MarkAddressRangeAsFree(start, pages);
+    return OUT_OF_MEMORY;
+  }
+
+  // Map each page. The pages are owned, so they are freed individually.
+  for (size_t i = 0; i < pages; i++) {
+    size_t addr = start + i * PAGE_SIZE;
+    if (!MapPhysicalPageAt(addr, phys + i * PAGE_SIZE, true, true, false)) {
+      print << "Call to MapPhysicalPage failed.\n";
+      if (i > 0) FreePages(start, i);
+      MarkAddressRangeAsFree(addr, pages - i);
+      for (; i < pages; i++) FreePhysicalPage(phys + i * PAGE_SIZE);
+      return OUT_OF_MEMORY;
+    }
+  }
+
+  return start;
+}
+
+size_t VirtualAddressSpace::AllocateLazilyZeroedPages(size_t pages) {
+  size_t start = FindAndReserveFreePageRange(pages);
+  if (start == OUT_OF_MEMORY) return OUT_OF_MEMORY;
+
+  // Fill in the entries a page table at a time.
+  size_t address = start;
+  size_t end = start + pages * PAGE_SIZE;
+  while (address < end) {
+    size_t* entry = GetPageTableEntry(address, /*create_tables=*/true);
+    if (entry == nullptr) {
+      print << "Out of memory for page tables.\n";
+      ReleasePages(start, (address - start) / PAGE_SIZE);
+      MarkAddressRangeAsFree(address, (end - address) / PAGE_SIZE);
+      return OUT_OF_MEMORY;
+    }
+    for (size_t index = CalculateIndexForAddressInPageTable(
+             kDeepestPageTableLevel, address);
+         index < kPageTableEntries && address < end;
+         index++, entry++, address += PAGE_SIZE)
+      *entry = kLazilyZeroedPageEntry;
+  }
+  return start;
+}
+
+bool VirtualAddressSpace::MaybeAllocateLazilyZeroedPage(size_t virtualaddr) {
+  if (!IsAddressInCorrectSpace(virtualaddr)) return false;
+  virtualaddr = RoundDownToPageAlignedAddress(virtualaddr);
+
+  size_t* entry = GetPageTableEntry(virtualaddr, /*create_tables=*/false);
+  if (entry == nullptr || *entry != kLazilyZeroedPageEntry) return false;
+
+  size_t physical_address = GetPhysicalPage();
+  if (physical_address == OUT_OF_PHYSICAL_PAGES) return false;
+  memset((char*)TemporarilyMapPhysicalPages(physical_address, 5), 0,
+         PAGE_SIZE);
+
+  // Look up the entry again, in case getting a physical page reused the
+  // temporary mappings.
+  entry = GetPageTableEntry(virtualaddr, /*create_tables=*/false);
+  *entry = CreatePageTableEntry(physical_address, /*is_writable=*/true,
+                                !IsKernelAddress(virtualaddr),
+                                /*is_owned=*/true);
+  unique_pages_++;
+
+  if (this == GetCurrentCpu()->current_address_space ||
+      IsKernelAddress(virtualaddr))
+    FlushVirtualPage(virtualaddr);
+  return true;
+}
+
 void VirtualAddressSpace::ReleasePages(size_t addr, size_t pages) {
   if (!IsPageAlignedAddress(addr)) {
     print << "ReleaseMemory called with non page aligned address: "
@@ -551,6 +645,9 @@ size_t VirtualAddressSpace::GetPhysicalAddress(size_t virtualaddr,
 }
 
 size_t VirtualAddressSpace::GetOrCreateVirtualPage(size_t virtualaddr) {
+  if (MaybeAllocateLazilyZeroedPage(virtualaddr))
+    return GetPhysicalAddress(virtualaddr, /*ignore_unowned_pages=*/false);
+
   size_t physical_address = GetPhysicalAddress(virtualaddr,
                                                /*ignore_unowned_pages=*/false);
   if (physical_address != OUT_OF_MEMORY) return physical_address;
@@ -613,22 +710,37 @@ void VirtualAddressSpace::SetMemoryAccessRights(size_t address, size_t rights) {
 
   table[last_index] = last_entry;
   FlushVirtualPage(address);
+  FlushTlbOnOtherCpus(IsKernelAddress(address) ? nullptr : this);
 }
 
 void VirtualAddressSpace::SwitchToAddressSpace() {
-  if (this != current_address_space) {
-    current_address_space = this;
+  Cpu* cpu = GetCurrentCpu();
+  if (this != cpu->current_address_space) {
+    cpu->current_address_space = this;
+    cpu->loaded_pml4 = pml4_;
 #ifndef TEST
     __asm__ __volatile__("mov %0, %%cr3" ::"b"(pml4_));
 #else
     extern size_t mock_cr3;
     mock_cr3 = pml4_;
 #endif
+    MarkTlbAsFlushed(cpu);
+
+    if (size_t pml4_to_free = cpu->pml4_to_free_after_switching) {
+      // This CPU was left in a destroyed address space. Free its PML4 if no
+      // other CPU is still in it.
+      cpu->pml4_to_free_after_switching = 0;
+      bool pml4_is_still_loaded = false;
+      ForEachOnlineCpu([&](Cpu* other_cpu) {
+        if (other_cpu->loaded_pml4 == pml4_to_free) pml4_is_still_loaded = true;
+      });
+      if (!pml4_is_still_loaded) FreePhysicalPage(pml4_to_free);
+    }
   }
 }
 
 VirtualAddressSpace& VirtualAddressSpace::CurrentAddressSpace() {
-  return *current_address_space;
+  return *GetCurrentCpu()->current_address_space;
 }
 
 bool VirtualAddressSpace::IsKernelAddressSpace() {
@@ -664,6 +776,7 @@ void VirtualAddressSpace::MapKernelMemoryPreVirtualMemory(
                            assign_page_table)) {
     print << "Out of memory during kernel initialization.\n";
 #ifndef TEST
+    FlushPrinter();
     __asm__ __volatile__("hlt");
 #endif
   }
@@ -843,7 +956,7 @@ bool VirtualAddressSpace::MapPhysicalPageImpl(
     }
   }
 
-  if (this == current_address_space || is_kernel_address) {
+  if (this == GetCurrentCpu()->current_address_space || is_kernel_address) {
     // The TLB must be flushed because either this address space is active, or
     // it's kernel memory (which is always active).
     FlushVirtualPage(virtualaddr);
@@ -897,13 +1010,15 @@ void VirtualAddressSpace::UnmapVirtualPage(size_t virtualaddr, bool free) {
 
   // Free the page if requested and if it's owned. This is optional because
   // shared memory and memory mapped IO can be unmapped without freeing the
-  // physical pages.
-  if (free && (entry & PageTableEntryBits::kIsOwned) != 0)
+  // physical pages. Lazily zeroed pages that were never touched have no
+  // physical page.
+  if (free && (entry & PageTableEntryBits::kIsOwned) != 0 &&
+      entry != kLazilyZeroedPageEntry)
     FreePhysicalPage(entry & ~(PAGE_SIZE - 1));
 
   if (entry == kDudPageEntry) {
     shared_pages_--;
-  } else if (entry != 0) {
+  } else if (entry != kLazilyZeroedPageEntry) {
     if ((entry & PageTableEntryBits::kIsOwned) != 0) {
       unique_pages_--;
     } else {
@@ -915,10 +1030,12 @@ void VirtualAddressSpace::UnmapVirtualPage(size_t virtualaddr, bool free) {
   entry = 0;
   if (virtualaddr != 0) MarkAddressRangeAsFree(virtualaddr, 1);
 
-  if (this == current_address_space || IsKernelAddress(virtualaddr)) {
+  if (this == GetCurrentCpu()->current_address_space ||
+      IsKernelAddress(virtualaddr)) {
     // Flush the TLB if this address space is active or if it's a kernel page.
     FlushVirtualPage(virtualaddr);
   }
+  FlushTlbOnOtherCpus(IsKernelAddress(virtualaddr) ? nullptr : this);
 
   // Scan the page tables to see if they are completely empty so that the
   // physical pages can be released. Don't release the shallowest level (the
@@ -936,6 +1053,31 @@ void VirtualAddressSpace::UnmapVirtualPage(size_t virtualaddr, bool free) {
   }
 }
 
+size_t* VirtualAddressSpace::GetPageTableEntry(size_t virtualaddr,
+                                               bool create_tables) {
+  size_t* table = (size_t*)TemporarilyMapPhysicalPages(pml4_, 0);
+  for (int level = 0; level < kDeepestPageTableLevel; level++) {
+    size_t& entry =
+        table[CalculateIndexForAddressInPageTable(level, virtualaddr)];
+    if (entry == 0) {
+      if (!create_tables) return nullptr;
+      size_t new_table_physicaladdr = GetPhysicalPage();
+      if (new_table_physicaladdr == OUT_OF_PHYSICAL_PAGES) return nullptr;
+      entry = CreatePageTableEntry(new_table_physicaladdr, /*is_writable=*/true,
+                                   !IsKernelAddress(virtualaddr),
+                                   /*is_owned=*/false);
+      table = (size_t*)TemporarilyMapPhysicalPages(new_table_physicaladdr,
+                                                   level + 1);
+      for (int i = 0; i < kPageTableEntries; i++) table[i] = 0;
+    } else {
+      table = (size_t*)TemporarilyMapPhysicalPages(entry & ~(PAGE_SIZE - 1),
+                                                   level + 1);
+    }
+  }
+  return &table[CalculateIndexForAddressInPageTable(kDeepestPageTableLevel,
+                                                    virtualaddr)];
+}
+
 void VirtualAddressSpace::AddFreeMemoryRange(FreeMemoryRange* fmr) {
   if (!IsPageAlignedAddress(fmr->start_address)) {
     print << "AddFreeMemoryRange called with non page "
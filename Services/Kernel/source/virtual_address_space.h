@@ -56,6 +56,21 @@ class VirtualAddressSpace {
   size_t AllocatePagesBelowMaxBaseAddress(size_t pages,
                                           size_t max_base_address);
 
+  // Allocates pages that are backed by physically contiguous memory, all
+  // starting at or below the max base address. Returns the virtual address,
+  // or OUT_OF_MEMORY.
+  size_t AllocateContiguousPagesBelowMaxBaseAddress(size_t pages,
+                                                    size_t max_base_address);
+
+  // Reserves pages that aren't backed by physical memory until they are first
+  // touched, at which point each page is given a zeroed physical page. Returns
+  // the virtual address, or OUT_OF_MEMORY.
+  size_t AllocateLazilyZeroedPages(size_t pages);
+
+  // Backs a lazily zeroed page that hasn't been touched yet with a zeroed
+  // physical page. Returns false if the address isn't in such a page.
+  bool MaybeAllocateLazilyZeroedPage(size_t virtualaddr);
+
   size_t GetPML4() const { return pml4_; }
 
   // Releases virtual memory in the address space, but does not free the
@@ -154,6 +169,13 @@ class VirtualAddressSpace {
 
   void UnmapVirtualPage(size_t virtualaddr, bool free);
 
+  // Returns a pointer to the entry in the deepest page table (PML1) for a
+  // virtual address, or nullptr if there's no page table for it. Missing page
+  // tables are created if `create_tables` is set. The entries for the rest of
+  // the PML1 follow it, and stay mapped until the temporary mapping slots of
+  // the page table levels are reused.
+  size_t *GetPageTableEntry(size_t virtualaddr, bool create_tables);
+
   void AddFreeMemoryRange(FreeMemoryRange *fmr);
 
   void RemoveFreeMemoryRange(FreeMemoryRange *fmr);
@@ -16,6 +16,7 @@
 
 #include <unordered_map>
 
+#include "physical_allocator.h"
 #include "process.h"
 #include "testing.h"
 #include "virtual_allocator.h"
@@ -149,6 +150,56 @@ TEST(VirtualAddressSpaceTrackingTest) {
   ASSERT(proc->virtual_address_space.GetSharedPages(), (size_t)0);
 }
 
+TEST(VirtualAddressSpaceLazilyZeroedPagesTest) {
+  InitializeObjectPools();
+  InitializeProcesses();
+  InitializeVirtualAllocator();
+
+  Process* proc = CreateProcess(false, false);
+  ASSERT(proc != nullptr, true);
+  VirtualAddressSpace& address_space = proc->virtual_address_space;
+  address_space.SwitchToAddressSpace();
+
+  // Span more than one page table.
+  size_t address = address_space.AllocateLazilyZeroedPages(600);
+  ASSERT(address != OUT_OF_MEMORY, true);
+
+  // Nothing is backed until it's touched.
+  ASSERT(address_space.GetUniquePages(), (size_t)0);
+  ASSERT(address_space.GetSharedPages(), (size_t)0);
+  ASSERT(address_space.GetPhysicalAddress(address + 520 * PAGE_SIZE, false),
+         OUT_OF_MEMORY);
+
+  // Nothing else can be mapped over the reserved pages.
+  ASSERT(address_space.ReserveAddressRange(address, 1), false);
+
+  // Touching a page gives it a zeroed page.
+  ASSERT(address_space.MaybeAllocateLazilyZeroedPage(address + 520 * PAGE_SIZE +
+                                                     123),
+         true);
+  size_t physical_address =
+      address_space.GetPhysicalAddress(address + 520 * PAGE_SIZE, false);
+  ASSERT(physical_address != OUT_OF_MEMORY, true);
+  ASSERT(simulated_ram[physical_address].entries[7], (size_t)0);
+  ASSERT(address_space.GetUniquePages(), (size_t)1);
+
+  // It only happens once.
+  ASSERT(address_space.MaybeAllocateLazilyZeroedPage(address + 520 * PAGE_SIZE),
+         false);
+  ASSERT(address_space.GetOrCreateVirtualPage(address + 520 * PAGE_SIZE),
+         physical_address);
+
+  // Kernel writes to untouched pages back them too.
+  ASSERT(address_space.GetOrCreateVirtualPage(address) != OUT_OF_MEMORY, true);
+  ASSERT(address_space.GetUniquePages(), (size_t)2);
+
+  // Freeing the range only frees the pages that were touched.
+  address_space.FreePages(address, 600);
+  ASSERT(address_space.GetUniquePages(), (size_t)0);
+  ASSERT(address_space.MaybeAllocateLazilyZeroedPage(address), false);
+  ASSERT(address_space.ReserveAddressRange(address, 600), true);
+}
+
 TEST(StaticObjectPoolCleanupTest) {
   InitializeObjectPools();
 
@@ -1,5 +1,6 @@
 #include "virtual_allocator.h"
 
+#include "cpu.h"
 #include "object_pool.h"
 #include "physical_allocator.h"
 #include "process.h"
@@ -68,6 +69,10 @@ void InitializeVirtualAllocator() {
   // Flush and load the kernel's new and final PML4.
   kernel_address_space.SwitchToAddressSpace();
 
+  // The kernel's address space is usable, so the physical allocator can map
+  // its page metadata.
+  InitializePhysicalPageFreeLists();
+
 #ifndef TEST
   // Reclaim the PML4, PDPT, PD set up at boot time.
   kernel_address_space.FreePages((size_t)&Pml4 + VIRTUAL_MEMORY_OFFSET, 1);
@@ -121,11 +126,15 @@ void *TemporarilyMapPhysicalPages(size_t addr, size_t index) {
 
   size_t temp_addr = temp_memory_start + PAGE_SIZE * index;
 
-  // Check if it's not already mapped.
+  // Check if it's not already mapped. The table is shared between CPUs, so
+  // this CPU's TLB might also be stale if another CPU used this slot since this
+  // CPU last mapped it.
   volatile size_t *volatile_table = (volatile size_t *)temp_memory_page_table;
-  if (volatile_table[index] != entry) {
+  size_t &last_mapped_entry = GetCurrentCpu()->temporary_mappings[index];
+  if (volatile_table[index] != entry || last_mapped_entry != entry) {
     // Map this page into the temporary page table.
     volatile_table[index] = entry;
+    last_mapped_entry = entry;
     // Flush the page table cache.
     FlushVirtualPage(temp_addr);
   }
@@ -208,9 +217,18 @@ void UnmapSharedMemoryFromProcess(
   auto *shared_memory = shared_memory_in_process->shared_memory;
 
   // Unmap the virtual pages.
-  process->virtual_address_space.ReleasePages(
-      shared_memory_in_process->virtual_address,
-      shared_memory_in_process->mapped_pages);
+  if ((shared_memory->flags & SM_COPY_ON_WRITE) != 0) {
+    // Some pages might be the process's private copies.
+    for (size_t page = 0; page < shared_memory_in_process->mapped_pages;
+         page++) {
+      UnmapSharedMemoryPage(
+          process, shared_memory_in_process->virtual_address + page * PAGE_SIZE);
+    }
+  } else {
+    process->virtual_address_space.ReleasePages(
+        shared_memory_in_process->virtual_address,
+        shared_memory_in_process->mapped_pages);
+  }
 
   process->joined_shared_memories.Remove(shared_memory_in_process);
   shared_memory->joined_processes.Remove(shared_memory_in_process);
@@ -25,6 +25,7 @@
 #include "perception/memory.h"
 #include "perception/memory_span.h"
 
+using ::perception::AllocateMemoryPages;
 using ::perception::kPageSize;
 using ::perception::MemorySpan;
 
@@ -123,6 +124,7 @@ StatusOr<size_t> ElfFile::LoadIntoAddressSpaceAndReturnNextFreeAddress(
     std::map<size_t, void*>& child_memory_pages,
     SymbolMap& symbols_to_addresses, InitFiniFunctions& init_fini_functions) {
   bool has_prelinked_segments = !read_only_segments_.empty();
+  bool has_writable_template = !writable_segments_.empty();
   if (has_prelinked_segments) {
     for (const auto& address_and_shared_memory : read_only_segments_) {
       size_t address = address_and_shared_memory.first;
@@ -141,6 +143,8 @@ StatusOr<size_t> ElfFile::LoadIntoAddressSpaceAndReturnNextFreeAddress(
       continue;  // Segment doesn't get loaded.
     if (has_prelinked_segments && (segment_header.p_flags & PF_W) == 0)
       continue;  // Segment isn't writable.
+    if (has_writable_template && (segment_header.p_flags & PF_W) != 0)
+      continue;  // Segment is copied from the template when relocating.
 
     if (segment_header.p_filesz > 0) {
       // There is data from the file to copy into memory.
@@ -228,6 +232,11 @@ Status ElfFile::FixUpRelocations(
   auto relocation_section_headers = GetRelocationSectionHeaders();
   if (relocation_section_headers.empty()) return Status::OK;
 
+  // Relocations that land in the writable segment templates. These can't be
+  // written into the templates because they're shared with other processes.
+  std::vector<std::pair<size_t, size_t>> template_relocations;
+  bool template_relocations_match = true;
+
   auto symbols = memory_span_.ToTypedArrayAtOffset<Elf64_Sym>(
       (*dynsym_section_header_)->sh_offset,
       (*dynsym_section_header_)->sh_size / sizeof(Elf64_Sym));
@@ -380,6 +389,16 @@ Status ElfFile::FixUpRelocations(
 
       auto page_itr = child_memory_pages.find(page);
       if (page_itr == child_memory_pages.end()) {
+        size_t template_address;
+        auto writable_segment =
+            GetWritableSegmentContaining(address, template_address);
+        if (writable_segment) {
+          template_relocations.push_back({address, value});
+          if (*(size_t*)(*writable_segment)[address - template_address] !=
+              value)
+            template_relocations_match = false;
+          continue;
+        }
         if (!read_only_segments_.empty()) {
           // Read-only segment pages were already pre-relocated in
           // read_only_segments_.
@@ -395,29 +414,60 @@ Status ElfFile::FixUpRelocations(
     }
   }
 
-  if (!IsExecutable() && read_only_segments_.empty()) {
-    std::map<size_t, void*> read_only_pages;
-    for (const auto& segment_header : ProgramSegmentHeaders()) {
-      if (segment_header.p_type != PT_LOAD) continue;
-      if ((segment_header.p_flags & PF_W) != 0) continue;
-
-      size_t seg_start = (segment_header.p_vaddr + offset) & ~(kPageSize - 1);
-      size_t seg_end = (segment_header.p_vaddr + segment_header.p_memsz +
-                        offset + kPageSize - 1) &
-                       ~(kPageSize - 1);
-
-      for (size_t addr = seg_start; addr < seg_end; addr += kPageSize) {
-        auto it = child_memory_pages.find(addr);
-        if (it != child_memory_pages.end()) {
-          read_only_pages[addr] = it->second;
+  if (!writable_segments_.empty() && template_relocations_match) {
+    // This process relocates to the same values as the template, so it can
+    // share the template's pages until it writes to them.
+    for (const auto& address_and_shared_memory : writable_segments_) {
+      size_t address = address_and_shared_memory.first;
+      if (!address_and_shared_memory.second->JoinChildProcess(child_pid,
+                                                              address)) {
+        std::cout << "Unable to join a child process into shared memory at: "
+                  << std::hex << address << std::dec << std::endl;
+        return Status::INTERNAL_ERROR;
+      }
+    }
+  } else if (!writable_segments_.empty()) {
+    // Something this ELF file links against resolved differently in this
+    // process (such as a symbol overridden by the executable, or a different
+    // TLS module ID), so give it its own copy of the writable segments.
+    for (const auto& address_and_shared_memory : writable_segments_) {
+      size_t address = address_and_shared_memory.first;
+      auto& shared_memory = *address_and_shared_memory.second;
+      for (size_t offset_in_template = 0;
+           offset_in_template < shared_memory.GetSize();
+           offset_in_template += kPageSize) {
+        void* page = AllocateMemoryPages(/*pages=*/1);
+        if (page == nullptr) {
+          std::cout << "Couldn't allocate memory to child page." << std::endl;
+          return Status::INTERNAL_ERROR;
         }
+        memcpy(page, shared_memory[offset_in_template], kPageSize);
+        child_memory_pages[address + offset_in_template] = page;
       }
     }
+    for (const auto& [address, value] : template_relocations) {
+      void* page = child_memory_pages[address & ~(kPageSize - 1)];
+      ((size_t*)page)[(address & (kPageSize - 1)) / 8] = value;
+    }
+  }
 
+  if (read_only_segments_.empty()) {
+    auto read_only_pages =
+        GetSegmentPages(child_memory_pages, offset, /*writable=*/false);
     read_only_segments_ =
         ConvertMapOfPagesIntoReadOnlySharedMemoryBlocks(read_only_pages);
   }
 
+  if (writable_segments_.empty()) {
+    // This is the first process to load this ELF file. Its writable pages are
+    // now relocated, so keep a copy of them as the template for the next
+    // processes.
+    auto writable_pages =
+        GetSegmentPages(child_memory_pages, offset, /*writable=*/true);
+    writable_segments_ =
+        ConvertMapOfPagesIntoCopyOnWriteSharedMemoryBlocks(writable_pages);
+  }
+
   return Status::OK;
 }
 
@@ -632,6 +682,40 @@ std::vector<const Elf64_Shdr*> ElfFile::GetRelocationSectionHeaders() {
   return relocation_sections;
 }
 
+std::shared_ptr<perception::SharedMemory>
+ElfFile::GetWritableSegmentContaining(size_t address,
+                                      size_t& template_address) {
+  auto itr = writable_segments_.upper_bound(address);
+  if (itr == writable_segments_.begin()) return {};
+  itr--;
+  if (address >= itr->first + itr->second->GetSize()) return {};
+  template_address = itr->first;
+  return itr->second;
+}
+
+std::map<size_t, void*> ElfFile::GetSegmentPages(
+    const std::map<size_t, void*>& child_memory_pages, size_t offset,
+    bool writable) {
+  std::map<size_t, void*> pages;
+  for (const auto& segment_header : ProgramSegmentHeaders()) {
+    if (segment_header.p_type != PT_LOAD) continue;
+    if (((segment_header.p_flags & PF_W) != 0) != writable) continue;
+
+    size_t seg_start = (segment_header.p_vaddr + offset) & ~(kPageSize - 1);
+    size_t seg_end = (segment_header.p_vaddr + segment_header.p_memsz +
+                      offset + kPageSize - 1) &
+                     ~(kPageSize - 1);
+
+    for (size_t addr = seg_start; addr < seg_end; addr += kPageSize) {
+      auto it = child_memory_pages.find(addr);
+      if (it != child_memory_pages.end()) {
+        pages[addr] = it->second;
+      }
+    }
+  }
+  return pages;
+}
+
 std::optional<ElfFile::SymbolResult> ElfFile::GetSymbolAddress(std::string_view name) {
   if (!dynsym_section_header_) return std::nullopt;
 
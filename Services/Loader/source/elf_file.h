@@ -74,7 +74,8 @@ class ElfFile {
 
   // Loads this ELF file into a child process at the provided memory `offset`,
   // and if successful, returns the next free address. Any read-only shared
-  // memory segments will be mapped into the child process.
+  // memory segments will be mapped into the child process. If there is a
+  // template of the writable segments, they are left for FixUpRelocations.
   // `child_memory_pages` will be populated with unique writable memory.
   // `symbols_to_addresses` will be populated with exported symbols.
   // `init_fini_functions` will be populated with initializer and finalizer
@@ -154,6 +155,17 @@ class ElfFile {
   // fixed up whenever this ELF file is loaded into a child process.
   std::vector<const Elf64_Shdr*> GetRelocationSectionHeaders();
 
+  // Returns the writable segment template that contains `address`, or an
+  // empty shared_ptr if there is none.
+  std::shared_ptr<perception::SharedMemory> GetWritableSegmentContaining(
+      size_t address, size_t& template_address);
+
+  // Gathers the pages in `child_memory_pages` covering the segments at
+  // `offset` that are (or aren't, if `writable` is false) writable.
+  std::map<size_t, void*> GetSegmentPages(
+      const std::map<size_t, void*>& child_memory_pages, size_t offset,
+      bool writable);
+
   // The underlying file containing the ELF data.
   std::unique_ptr<class File> file_;
 
@@ -201,6 +213,14 @@ class ElfFile {
   std::map<size_t, std::shared_ptr<perception::SharedMemory>>
       read_only_segments_;
 
+  // Pre-relocated copies of the writable segments, taken from the first child
+  // process this ELF file was loaded into. Later child processes join these
+  // copy-on-write if their relocations match, so they only get private copies
+  // of the pages that they write to. Keyed by the virtual address to map them
+  // at.
+  std::map<size_t, std::shared_ptr<perception::SharedMemory>>
+      writable_segments_;
+
   // The highest known virtual address this ELF file references to. Exclusive.
   size_t highest_virtual_address_;
 
@@ -28,6 +28,7 @@
 #include "perception/memory.h"
 #include "perception/memory_span.h"
 #include "perception/processes.h"
+#include "perception/time.h"
 #include "process.h"
 #include "status.h"
 #include "symbol_map.h"
@@ -37,6 +38,7 @@ using ::perception::AllocateMemoryPages;
 using ::perception::CreateChildProcess;
 using ::perception::DestroyChildProcess;
 using ::perception::GetProcessName;
+using ::perception::GetTimeSinceKernelStarted;
 using ::perception::kPageSize;
 using ::perception::MemorySpan;
 using ::perception::ProcessId;
@@ -47,7 +49,8 @@ using ::perception::StartExecutingChildProcess;
 
 namespace {
 
-// Uncomment to be very verbose with where shared libraries are loaded.
+// Uncomment to be very verbose with where shared libraries are loaded, and
+// how long programs take to load.
 // #define VERBOSE 1
 
 // Loads all of the dependencies for an executable, returning an array
@@ -105,6 +108,9 @@ LoadDependencies(std::shared_ptr<ElfFile> executable_file) {
 StatusOr<::perception::ProcessId> LoadProgram(
     ::perception::ProcessId creator, std::string_view name,
     const std::vector<std::string>& arguments) {
+#ifdef VERBOSE
+  auto load_start_time = GetTimeSinceKernelStarted();
+#endif
   auto elf_file = LoadOrIncrementElfFile(std::string(name));
   if (!elf_file) {
     std::cout << "Cannot find ELF file for " << name << std::endl;
@@ -370,6 +376,14 @@ StatusOr<::perception::ProcessId> LoadProgram(
   // Send the memory pages to the child.
   SendMemoryPagesToChild(child_pid, child_memory_pages);
 
+#ifdef VERBOSE
+  // Everything else the child starts with is shared with other processes.
+  std::cout << "Loaded " << elf_file->File().Name() << " in "
+            << (GetTimeSinceKernelStarted() - load_start_time).count()
+            << "us with " << child_memory_pages.size() << " private pages."
+            << std::endl;
+#endif
+
   // Remember these dependencies so they stay in memory while the program runs.
   RecordChildPidAndDependencies(child_pid, dependencies,
                                 load_addresses_of_elf_files);
@@ -35,13 +35,13 @@ namespace {
 // Turns a set of pages into a shared memory block.
 std::shared_ptr<perception::SharedMemory> TurnPagesIntoSharedMemoryBlock(
     std::map<size_t, void*>& child_memory_pages, size_t first_page,
-    size_t last_page) {
+    size_t last_page, size_t flags) {
   size_t size = last_page - first_page + kPageSize;
 
   std::weak_ptr<SharedMemory> weak_shared_memory;
 
   std::shared_ptr<SharedMemory> shared_memory = SharedMemory::FromSize(
-      size, SharedMemory::kLazilyAllocated,
+      size, SharedMemory::kLazilyAllocated | flags,
       [&weak_shared_memory](size_t offset_of_page) {
         // Should never get called. Assign this a blank page.
         if (auto strong_shared_memory = weak_shared_memory.lock())
@@ -65,6 +65,44 @@ std::shared_ptr<perception::SharedMemory> TurnPagesIntoSharedMemoryBlock(
   return shared_memory;
 }
 
+// Converts a map of pages into blocks of shared memory created with `flags`.
+std::map<size_t, std::shared_ptr<SharedMemory>>
+ConvertMapOfPagesIntoSharedMemoryBlocks(
+    std::map<size_t, void*>& child_memory_pages, size_t flags) {
+  std::map<size_t, std::shared_ptr<SharedMemory>> shared_memory_blocks;
+
+  bool has_pages = false;
+  size_t first_page, last_page = 0;
+
+  for (std::pair<size_t, void*> addr_and_memory : child_memory_pages) {
+    size_t page_address = addr_and_memory.first;
+
+    if (has_pages) {
+      if (page_address == last_page + kPageSize) {
+        // A contiguous page that can be part of the same shared memory block.
+        last_page = page_address;
+      } else {
+        // A non-contiguous page. Turn the current first_page->last_page into a
+        // shared memory block.
+        shared_memory_blocks[first_page] = TurnPagesIntoSharedMemoryBlock(
+            child_memory_pages, first_page, last_page, flags);
+        // Start a new block at this address.
+        first_page = last_page = page_address;
+      }
+    } else {
+      has_pages = true;
+      first_page = last_page = page_address;
+    }
+  }
+
+  if (has_pages) {
+    shared_memory_blocks[first_page] = TurnPagesIntoSharedMemoryBlock(
+        child_memory_pages, first_page, last_page, flags);
+  }
+
+  return shared_memory_blocks;
+}
+
 }  // namespace
 
 // Returns a pointer into the child page (allocating it memory if it doesn't yet
@@ -186,36 +224,13 @@ void SendMemoryPagesToChild(ProcessId child_pid,
 std::map<size_t, std::shared_ptr<SharedMemory>>
 ConvertMapOfPagesIntoReadOnlySharedMemoryBlocks(
     std::map<size_t, void*>& child_memory_pages) {
-  std::map<size_t, std::shared_ptr<SharedMemory>> shared_memory_blocks;
-
-  bool has_pages = false;
-  size_t first_page, last_page = 0;
-
-  for (std::pair<size_t, void*> addr_and_memory : child_memory_pages) {
-    size_t page_address = addr_and_memory.first;
-
-    if (has_pages) {
-      if (page_address == last_page + kPageSize) {
-        // A contiguous page that can be part of the same shared memory block.
-        last_page = page_address;
-      } else {
-        // A non-contiguous page. Turn the current first_page->last_page into a
-        // shared memory block.
-        shared_memory_blocks[first_page] = TurnPagesIntoSharedMemoryBlock(
-            child_memory_pages, first_page, last_page);
-        // Start a new block at this address.
-        first_page = last_page = page_address;
-      }
-    } else {
-      has_pages = true;
-      first_page = last_page = page_address;
-    }
-  }
-
-  if (has_pages) {
-    shared_memory_blocks[first_page] = TurnPagesIntoSharedMemoryBlock(
-        child_memory_pages, first_page, last_page);
-  }
+  return ConvertMapOfPagesIntoSharedMemoryBlocks(child_memory_pages,
+                                                 /*flags=*/0);
+}
 
-  return shared_memory_blocks;
-}
\ No newline at end of file
+std::map<size_t, std::shared_ptr<SharedMemory>>
+ConvertMapOfPagesIntoCopyOnWriteSharedMemoryBlocks(
+    std::map<size_t, void*>& child_memory_pages) {
+  return ConvertMapOfPagesIntoSharedMemoryBlocks(child_memory_pages,
+                                                 SharedMemory::kCopyOnWrite);
+}
@@ -40,3 +40,9 @@ void SendMemoryPagesToChild(::perception::ProcessId child_pid,
 std::map<size_t, std::shared_ptr<perception::SharedMemory>>
 ConvertMapOfPagesIntoReadOnlySharedMemoryBlocks(
     std::map<size_t, void*>& child_memory_pages);
+
+// Converts a map of pages into blocks of copy-on-write shared memory. Processes
+// that join the blocks share the pages until they write to them.
+std::map<size_t, std::shared_ptr<perception::SharedMemory>>
+ConvertMapOfPagesIntoCopyOnWriteSharedMemoryBlocks(
+    std::map<size_t, void*>& child_memory_pages);
@@ -17,6 +17,7 @@
 #include <iostream>
 #include <string>
 
+#include "perception/scheduler.h"
 #include "protocols.h"
 
 namespace {
@@ -44,6 +45,40 @@ size_t AddNetworkInterface(NetworkInterface interface) {
   return idx;
 }
 
+void TransmitPacket(size_t iface_idx, std::string_view packet) {
+  NetworkInterface& iface = interfaces[iface_idx];
+  if (iface.packet_ring &&
+      packet.length() <= ::perception::devices::kMaxPacketRingPacketSize) {
+    if (!iface.packet_ring->QueuePacketToTransmit(packet)) {
+      // The ring is full. Have the driver take back the buffers of packets it
+      // has sent, and send the packet the slow way if that didn't help.
+      (void)iface.device.TransmitPackets();
+      if (!iface.packet_ring->QueuePacketToTransmit(packet)) {
+        ::perception::devices::Packet pkt;
+        pkt.data = packet;
+        iface.device.SendPacket(pkt);
+        return;
+      }
+    }
+
+    // Ring the driver's doorbell once for all the packets queued while
+    // handling the current events.
+    if (!iface.transmit_doorbell_pending) {
+      iface.transmit_doorbell_pending = true;
+      ::perception::DeferAfterEvents([iface_idx]() {
+        NetworkInterface& iface = interfaces[iface_idx];
+        iface.transmit_doorbell_pending = false;
+        iface.device.TransmitPackets([](Status) {});
+      });
+    }
+    return;
+  }
+
+  ::perception::devices::Packet pkt;
+  pkt.data = packet;
+  iface.device.SendPacket(pkt);
+}
+
 void WakeFibersWaitingForArp(size_t iface_idx) {
   auto it = fibers_waiting_for_arp.begin();
   while (it != fibers_waiting_for_arp.end()) {
@@ -85,9 +120,7 @@ void SendArpRequest(size_t iface_idx, uint32 target_ip) {
   arp->spa = interfaces[iface_idx].ip;
   arp->tpa = target_ip;
 
-  ::perception::devices::Packet pkt;
-  pkt.data = packet_data;
-  interfaces[iface_idx].device.SendPacket(pkt);
+  TransmitPacket(iface_idx, packet_data);
 }
 
 void SendArpReply(size_t iface_idx, const uint8* target_mac, uint32 target_ip) {
@@ -113,7 +146,5 @@ void SendArpReply(size_t iface_idx, const uint8* target_mac, uint32 target_ip) {
   arp->spa = interfaces[iface_idx].ip;
   arp->tpa = target_ip;
 
-  ::perception::devices::Packet pkt;
-  pkt.data = packet_data;
-  interfaces[iface_idx].device.SendPacket(pkt);
+  TransmitPacket(iface_idx, packet_data);
 }
@@ -16,6 +16,8 @@
 
 #include <types.h>
 
+#include <memory>
+#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -37,6 +39,12 @@ struct NetworkInterface {
   // Flag indicating whether the gateway's MAC address has been resolved via
   // ARP.
   bool gateway_mac_resolved;
+  // Packets shared with the driver, or null if the driver doesn't support
+  // packet rings.
+  std::unique_ptr<::perception::devices::PacketRing> packet_ring;
+  // Flag indicating whether the driver's doorbell will be rung for packets
+  // queued in the packet ring.
+  bool transmit_doorbell_pending = false;
 };
 
 // Retrieves all registered active network interfaces.
@@ -51,6 +59,11 @@ size_t GetNetworkInterfaceCount();
 // Adds a new network interface card and returns its assigned index.
 size_t AddNetworkInterface(NetworkInterface interface);
 
+// Sends a packet out of an interface. Packets go through the packet ring if
+// the driver supports it, and the driver is told about them in one batch
+// after the current events have been handled.
+void TransmitPacket(size_t iface_idx, std::string_view packet);
+
 // Wakes up any fibers currently suspended waiting for ARP resolution on a given
 // interface.
 void WakeFibersWaitingForArp(size_t iface_idx);
@@ -46,6 +46,14 @@ int main() {
         iface.gateway_ip = (10) | (0 << 8) | (2 << 16) | (2 << 24);  // 10.0.2.2
         iface.gateway_mac_resolved = false;
 
+        // Exchange packets through shared memory if the driver supports it.
+        auto status_or_packet_ring = device.CreatePacketRing();
+        if (status_or_packet_ring) {
+          iface.packet_ring =
+              ::perception::devices::PacketRing::FromSharedMemory(
+                  status_or_packet_ring->ring);
+        }
+
         size_t iface_idx = AddNetworkInterface(std::move(iface));
 
         // Create listener server for this device.
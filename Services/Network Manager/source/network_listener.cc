@@ -71,12 +71,10 @@ void SendIcmpEchoRequest(size_t iface_idx, uint32 dest_ip) {
   icmp->seq = Swap16BitEndian(1);
   icmp->checksum = CalculateChecksum((const uint16*)icmp, sizeof(IcmpHeader));
 
-  ::perception::devices::Packet pkt;
-  pkt.data = packet_data;
-  iface.device.SendPacket(pkt);
+  TransmitPacket(iface_idx, packet_data);
 }
 
-void ProcessArp(const std::string& data, size_t iface_idx) {
+void ProcessArp(std::string_view data, size_t iface_idx) {
   if (data.length() < sizeof(EthernetHeader) + sizeof(ArpHeader)) return;
 
   const ArpHeader* arp =
@@ -102,7 +100,7 @@ void ProcessArp(const std::string& data, size_t iface_idx) {
   }
 }
 
-void ProcessIcmp(const std::string& data, uint8 ihl, size_t iface_idx) {
+void ProcessIcmp(std::string_view data, uint8 ihl, size_t iface_idx) {
   if (data.length() < sizeof(EthernetHeader) + ihl + sizeof(IcmpHeader)) return;
 
   const IpHeader* ip = (const IpHeader*)(data.data() + sizeof(EthernetHeader));
@@ -110,7 +108,7 @@ void ProcessIcmp(const std::string& data, uint8 ihl, size_t iface_idx) {
       (const IcmpHeader*)(data.data() + sizeof(EthernetHeader) + ihl);
 
   if (icmp->type == 8) {
-    std::string reply_data = data;
+    std::string reply_data(data);
     auto& iface = GetNetworkInterface(iface_idx);
 
     EthernetHeader* eth = (EthernetHeader*)reply_data.data();
@@ -135,13 +133,11 @@ void ProcessIcmp(const std::string& data, uint8 ihl, size_t iface_idx) {
     reply_icmp->checksum =
         CalculateChecksum((const uint16*)reply_icmp, icmp_len);
 
-    ::perception::devices::Packet pkt;
-    pkt.data = reply_data;
-    iface.device.SendPacket(pkt);
+    TransmitPacket(iface_idx, reply_data);
   }
 }
 
-void ProcessUdp(const std::string& data, uint8 ihl, size_t iface_idx) {
+void ProcessUdp(std::string_view data, uint8 ihl, size_t iface_idx) {
   if (data.length() < sizeof(EthernetHeader) + ihl + sizeof(UdpHeader)) return;
 
   const IpHeader* ip = (const IpHeader*)(data.data() + sizeof(EthernetHeader));
@@ -170,7 +166,7 @@ void ProcessUdp(const std::string& data, uint8 ihl, size_t iface_idx) {
   DispatchUdpPacket(ip->src_ip, src_port, dest_port, payload, payload_len);
 }
 
-void ProcessTcp(const std::string& data, uint8 ihl, size_t iface_idx) {
+void ProcessTcp(std::string_view data, uint8 ihl, size_t iface_idx) {
   if (data.length() < sizeof(EthernetHeader) + ihl + sizeof(TcpHeader)) return;
 
   const IpHeader* ip = (const IpHeader*)(data.data() + sizeof(EthernetHeader));
@@ -325,7 +321,7 @@ void ProcessTcp(const std::string& data, uint8 ihl, size_t iface_idx) {
   }
 }
 
-void ProcessIp(const std::string& data, size_t iface_idx) {
+void ProcessIp(std::string_view data, size_t iface_idx) {
   if (data.length() < sizeof(EthernetHeader) + sizeof(IpHeader)) return;
 
   const IpHeader* ip = (const IpHeader*)(data.data() + sizeof(EthernetHeader));
@@ -345,6 +341,19 @@ void ProcessIp(const std::string& data, size_t iface_idx) {
   }
 }
 
+void ProcessPacket(std::string_view data, size_t iface_idx) {
+  if (data.length() < sizeof(EthernetHeader)) return;
+
+  const EthernetHeader* eth = (const EthernetHeader*)data.data();
+  uint16 eth_type = Swap16BitEndian(eth->type);
+
+  if (eth_type == 0x0806) {
+    ProcessArp(data, iface_idx);
+  } else if (eth_type == 0x0800) {
+    ProcessIp(data, iface_idx);
+  }
+}
+
 }  // namespace
 
 NetworkListener::NetworkListener(size_t interface_index)
@@ -353,16 +362,23 @@ NetworkListener::NetworkListener(size_t interface_index)
 
 Status NetworkListener::PacketReceived(
     const ::perception::devices::Packet& packet) {
-  if (packet.data.length() < sizeof(EthernetHeader)) return Status::OK;
-
-  const EthernetHeader* eth = (const EthernetHeader*)packet.data.data();
-  uint16 eth_type = Swap16BitEndian(eth->type);
+  ProcessPacket(packet.data, interface_index_);
+  return Status::OK;
+}
 
-  if (eth_type == 0x0806) {
-    ProcessArp(packet.data, interface_index_);
-  } else if (eth_type == 0x0800) {
-    ProcessIp(packet.data, interface_index_);
+Status NetworkListener::PacketsReceived() {
+  auto& iface = GetNetworkInterface(interface_index_);
+  ::perception::devices::PacketRing* packet_ring = iface.packet_ring.get();
+  ::perception::devices::NetworkDevice::Client device = iface.device;
+  if (packet_ring == nullptr) return Status::OK;
+
+  // Process the packets where the driver left them, then let it reuse their
+  // buffers.
+  while (auto packet = packet_ring->PeekReceivedPacket()) {
+    ProcessPacket(*packet, interface_index_);
+    packet_ring->PopReceivedPacket();
   }
+  device.ReceivedPacketsConsumed([](Status) {});
   return Status::OK;
 }
 
@@ -28,6 +28,8 @@ class NetworkListener : public ::perception::devices::NetworkListener::Server {
   virtual Status PacketReceived(
       const ::perception::devices::Packet& packet) override;
 
+  virtual Status PacketsReceived() override;
+
  private:
   size_t interface_index_;
 };
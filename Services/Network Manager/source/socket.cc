@@ -91,9 +91,7 @@ void SendTcpPacket(size_t iface_idx, std::shared_ptr<SocketImpl> sock,
   tcp->checksum = CalculateTcpChecksum(ip->src_ip, ip->dest_ip,
                                        (const uint8*)tcp, ip_payload_len);
 
-  ::perception::devices::Packet pkt;
-  pkt.data = packet_data;
-  iface.device.SendPacket(pkt);
+  TransmitPacket(iface_idx, packet_data);
 }
 
 void SendUdpPacket(size_t iface_idx, uint32 dest_ip, uint16 src_port,
@@ -158,9 +156,7 @@ void SendUdpPacket(size_t iface_idx, uint32 dest_ip, uint16 src_port,
                                        (const uint8*)udp, ip_payload_len);
   if (udp->checksum == 0) udp->checksum = 0xFFFF;
 
-  ::perception::devices::Packet pkt;
-  pkt.data = packet_data;
-  iface.device.SendPacket(pkt);
+  TransmitPacket(iface_idx, packet_data);
 }
 
 void DispatchUdpPacket(uint32 src_ip, uint16 src_port, uint16 dest_port,
@@ -0,0 +1,50 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dentry_cache.h"
+
+DentryCache::DentryCache(size_t max_entries) : max_entries_(max_entries) {}
+
+std::optional<Dentry> DentryCache::Find(std::string_view path) {
+  std::scoped_lock lock(mutex_);
+  auto itr = entries_.find(path);
+  if (itr == entries_.end()) return std::nullopt;
+
+  lru_list_.splice(lru_list_.begin(), lru_list_, itr->second);
+  return itr->second->dentry;
+}
+
+void DentryCache::Insert(std::string_view path, const Dentry& dentry) {
+  std::scoped_lock lock(mutex_);
+  auto itr = entries_.find(path);
+  if (itr != entries_.end()) {
+    itr->second->dentry = dentry;
+    lru_list_.splice(lru_list_.begin(), lru_list_, itr->second);
+    return;
+  }
+
+  if (lru_list_.size() >= max_entries_) {
+    entries_.erase(lru_list_.back().path);
+    lru_list_.pop_back();
+  }
+
+  // The map's keys point into the list entries, which never move.
+  lru_list_.push_front({std::string(path), dentry});
+  entries_[lru_list_.front().path] = lru_list_.begin();
+}
+
+size_t DentryCache::Size() {
+  std::scoped_lock lock(mutex_);
+  return lru_list_.size();
+}
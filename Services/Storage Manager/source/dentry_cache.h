@@ -0,0 +1,69 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "perception/storage_manager.h"
+
+// A cached lookup of a path on a file system.
+struct Dentry {
+  // Whether the path exists. Paths that don't exist are cached too, so that
+  // repeatedly probing for a missing file doesn't scan its directory.
+  bool exists;
+
+  ::perception::DirectoryEntry::Type type;
+
+  size_t size_in_bytes;
+
+  // Where the entry is stored, such as its first block. This is only
+  // meaningful to the file system that cached it.
+  size_t location;
+};
+
+// A least recently used cache of path lookups, so that resolving a path
+// doesn't need to walk and scan every directory above it. Entries are never
+// invalidated, so this is only for file systems that can't change, and the
+// cache goes away with the file system when it's unmounted.
+class DentryCache {
+ public:
+  DentryCache(size_t max_entries = 4096);
+
+  // Returns the cached lookup of the path, if there is one.
+  std::optional<Dentry> Find(std::string_view path);
+
+  // Caches the lookup of a path.
+  void Insert(std::string_view path, const Dentry& dentry);
+
+  // Returns the number of cached paths.
+  size_t Size();
+
+ private:
+  struct ListEntry {
+    std::string path;
+    Dentry dentry;
+  };
+
+  size_t max_entries_;
+  std::mutex mutex_;
+  std::list<ListEntry> lru_list_;
+  std::unordered_map<std::string_view, std::list<ListEntry>::iterator>
+      entries_;
+};
@@ -19,6 +19,7 @@
 
 #include "perception/scheduler.h"
 #include "perception/storage_manager.h"
+#include "readahead.h"
 #include "sector_cache.h"
 #include "shared_memory_pool.h"
 #include "virtual_file_system.h"
@@ -38,6 +39,20 @@ namespace file_systems {
 namespace {
 
 constexpr int kIso9660SectorSize = 2048;
+
+// The size of the buffer that sectors are prefetched into, which is also the
+// largest window read ahead of a file.
+constexpr size_t kPrefetchBufferSize = 256 * 1024;
+
+// The most sectors that can be prefetched with one read.
+constexpr size_t kMaxSectorsToPrefetch =
+    kPrefetchBufferSize / kIso9660SectorSize;
+
+// The number of sectors to read when a small read misses the sector cache.
+constexpr size_t kSectorsToPrefetchOnMiss = 16;
+
+// The smallest window to read ahead of a file that's being read sequentially.
+constexpr size_t kMinReadaheadWindow = 64 * 1024;
 std::string kIso9660Name = "ISO 9660";
 
 }  // namespace
@@ -51,7 +66,8 @@ class Iso9660File : public File {
       : parent_(parent),
         offset_on_device_(offset_on_device),
         length_of_file_(length_of_file),
-        allowed_process_(allowed_process) {};
+        allowed_process_(allowed_process),
+        readahead_(kMinReadaheadWindow, kPrefetchBufferSize) {};
 
   virtual Status Close(ProcessId sender) override {
     if (sender != allowed_process_) return Status::NOT_ALLOWED;
@@ -68,10 +84,25 @@ class Iso9660File : public File {
       return Status::OVERFLOW;
     }
 
-    return parent_->ReadCached(offset_on_device_ + request.offset_in_file,
-                               request.offset_in_destination_buffer,
-                               request.bytes_to_copy,
-                               request.buffer_to_copy_into);
+    Status status = parent_->ReadCached(
+        offset_on_device_ + request.offset_in_file,
+        request.offset_in_destination_buffer, request.bytes_to_copy,
+        request.buffer_to_copy_into);
+    if (status != Status::OK) return status;
+
+    // If the file is being read sequentially, prefetch the next window in
+    // the background so that the next read hits the sector cache. Reads into
+    // lazily allocated buffers bypass the sector cache, and the page cache
+    // reads ahead of those itself.
+    if (request.buffer_to_copy_into->IsLazilyAllocated()) return Status::OK;
+    ReadaheadRange readahead =
+        readahead_.OnRead(request.offset_in_file, request.bytes_to_copy);
+    if (readahead.length > 0 && readahead.offset < length_of_file_) {
+      parent_->DeferPrefetch(
+          offset_on_device_ + readahead.offset,
+          std::min(readahead.length, length_of_file_ - readahead.offset));
+    }
+    return Status::OK;
   }
 
   virtual Status GrantStorageDevicePermissionToAllocateSharedMemoryPages(
@@ -95,6 +126,7 @@ class Iso9660File : public File {
   size_t offset_on_device_;
   size_t length_of_file_;
   ProcessId allowed_process_;
+  Readahead readahead_;
 };
 
 void SplitPath(std::string_view path, std::string_view &directory,
@@ -134,14 +166,20 @@ Iso9660::Iso9660(uint32 size_in_blocks, uint16 logical_block_size,
       FileSystem(storage_device),
       cache_(std::make_unique<SectorCache>(logical_block_size)) {
   prefetch_buffer_ = ::perception::SharedMemory::FromSize(
-      32768,
-      ::perception::SharedMemory::kJoinersCanWrite);  // 32KB (16 sectors)
+      kPrefetchBufferSize, ::perception::SharedMemory::kJoinersCanWrite);
   prefetch_buffer_->GrantPermissionToLazilyAllocatePage(
       storage_device.ServerProcessId());
   prefetch_buffer_->Join();
+  prefetch_target_ = std::make_shared<PrefetchTarget>();
+  prefetch_target_->file_system = this;
 }
 
-Iso9660::~Iso9660() {}
+Iso9660::~Iso9660() {
+  // Wait for a deferred prefetch that's running, and stop the rest from
+  // touching this file system.
+  std::scoped_lock lock(prefetch_target_->mutex);
+  prefetch_target_->file_system = nullptr;
+}
 
 // Opens a file.
 StatusOr<std::unique_ptr<File>> Iso9660::OpenFile(
@@ -151,27 +189,15 @@ StatusOr<std::unique_ptr<File>> Iso9660::OpenFile(
   if (write_access || create_if_not_exists || truncate) {
     return Status::NOT_ALLOWED;
   }
-  std::string_view directory, file_name;
-  SplitPath(path, directory, file_name);
+  if (path.empty()) return Status::FILE_NOT_FOUND;
 
-  std::unique_ptr<File> file;
-  ForRawEachEntryInDirectory(
-      directory, [&](std::string_view name, DirectoryEntry::Type type,
-                     size_t start_lba, size_t size) {
-        if (EqualsIgnoreCase(name, file_name)) {
-          file = std::make_unique<Iso9660File>(
-              this, start_lba * logical_block_size_, size, sender);
-          size_in_bytes = size;
-          return true;
-        }
-        return false;
-      });
+  Dentry dentry = LookUp(path);
+  if (!dentry.exists) return Status::FILE_NOT_FOUND;
 
-  if (file) {
-    return file;
-  } else {
-    return Status::FILE_NOT_FOUND;
-  }
+  size_in_bytes = dentry.size_in_bytes;
+  return std::unique_ptr<File>(
+      std::make_unique<Iso9660File>(this, dentry.location * logical_block_size_,
+                                    dentry.size_in_bytes, sender));
 }
 
 Status Iso9660::CreateDirectory(std::string_view path,
@@ -231,19 +257,7 @@ void Iso9660::CheckFilePermissions(std::string_view path, bool &file_exists,
     return;
   }
 
-  std::string_view directory, file_name;
-  SplitPath(path, directory, file_name);
-
-  file_exists = false;
-  ForRawEachEntryInDirectory(
-      directory, [&](std::string_view name, DirectoryEntry::Type type,
-                     size_t start_lba, size_t size) {
-        if (EqualsIgnoreCase(name, file_name)) {
-          file_exists = true;
-          return true;
-        }
-        return false;
-      });
+  file_exists = LookUp(path).exists;
   can_read = file_exists;
   can_execute = file_exists;
 }
@@ -251,8 +265,14 @@ void Iso9660::CheckFilePermissions(std::string_view path, bool &file_exists,
 Status Iso9660::ReadCached(uint64 offset_on_device, uint64 offset_in_buffer,
                            uint64 bytes_to_copy,
                            std::shared_ptr<::perception::SharedMemory> buffer) {
-  // If the read is larger than 8 sectors (16KB), bypass the cache.
-  if (bytes_to_copy > 16384 || buffer->IsLazilyAllocated()) {
+  size_t start_sector = offset_on_device / kIso9660SectorSize;
+  size_t end_sector =
+      (offset_on_device + bytes_to_copy - 1) / kIso9660SectorSize;
+
+  // If the read is larger than 8 sectors (16KB), bypass the cache unless it
+  // has all been prefetched.
+  if (buffer->IsLazilyAllocated() ||
+      (bytes_to_copy > 16384 && !cache_->Contains(start_sector, end_sector))) {
     StorageDeviceReadRequest read_request;
     read_request.offset_on_device = offset_on_device;
     read_request.offset_in_buffer = offset_in_buffer;
@@ -261,10 +281,6 @@ Status Iso9660::ReadCached(uint64 offset_on_device, uint64 offset_in_buffer,
     return storage_device_.Read(read_request);
   }
 
-  size_t start_sector = offset_on_device / kIso9660SectorSize;
-  size_t end_sector =
-      (offset_on_device + bytes_to_copy - 1) / kIso9660SectorSize;
-
   char* dest_buffer = (char*)**buffer;
 
   std::scoped_lock lock(prefetch_mutex_);
@@ -286,9 +302,9 @@ Status Iso9660::ReadCached(uint64 offset_on_device, uint64 offset_in_buffer,
                      copy_size)) {
       // Hit!
     } else {
-      // Cache miss! Pre-fetch up to 16 sectors (32KB, size of prefetch_buffer_)
-      // or up to the end of the device.
-      size_t sectors_to_prefetch = 16;
+      // Cache miss! Pre-fetch up to 16 sectors (32KB) or up to the end of the
+      // device.
+      size_t sectors_to_prefetch = kSectorsToPrefetchOnMiss;
       if (sector + sectors_to_prefetch > size_in_blocks_) {
         sectors_to_prefetch = size_in_blocks_ - sector;
       }
@@ -318,165 +334,227 @@ Status Iso9660::ReadCached(uint64 offset_on_device, uint64 offset_in_buffer,
   return Status::OK;
 }
 
+void Iso9660::Prefetch(uint64 offset_on_device, uint64 bytes_to_prefetch) {
+  if (bytes_to_prefetch == 0) return;
+
+  // Prefetching is only a hint, so don't wait for a read that's using the
+  // buffer.
+  std::unique_lock lock(prefetch_mutex_, std::try_to_lock);
+  if (!lock.owns_lock()) return;
+
+  char* temp_buffer = (char*)**prefetch_buffer_;
+  size_t sector = offset_on_device / kIso9660SectorSize;
+  size_t end_sector = std::min(
+      (size_t)size_in_blocks_,
+      (size_t)((offset_on_device + bytes_to_prefetch + kIso9660SectorSize - 1) /
+               kIso9660SectorSize));
+
+  while (sector < end_sector) {
+    if (cache_->Contains(sector, sector)) {
+      sector++;
+      continue;
+    }
+
+    // Read the run of sectors that aren't cached.
+    size_t sectors_to_prefetch = 1;
+    while (sector + sectors_to_prefetch < end_sector &&
+           sectors_to_prefetch < kMaxSectorsToPrefetch &&
+           !cache_->Contains(sector + sectors_to_prefetch,
+                             sector + sectors_to_prefetch))
+      sectors_to_prefetch++;
+
+    StorageDeviceReadRequest read_request;
+    read_request.offset_on_device = sector * kIso9660SectorSize;
+    read_request.offset_in_buffer = 0;
+    read_request.bytes_to_copy = sectors_to_prefetch * kIso9660SectorSize;
+    read_request.buffer = prefetch_buffer_;
+    if (storage_device_.Read(read_request) != Status::OK) return;
+
+    for (size_t i = 0; i < sectors_to_prefetch; i++)
+      cache_->Write(sector + i, temp_buffer + (i * kIso9660SectorSize));
+    sector += sectors_to_prefetch;
+  }
+}
+
+void Iso9660::DeferPrefetch(uint64 offset_on_device,
+                            uint64 bytes_to_prefetch) {
+  Defer([target = prefetch_target_, offset_on_device, bytes_to_prefetch]() {
+    std::scoped_lock lock(target->mutex);
+    if (target->file_system)
+      target->file_system->Prefetch(offset_on_device, bytes_to_prefetch);
+  });
+}
+
 void Iso9660::ForRawEachEntryInDirectory(
     std::string_view path,
     const std::function<bool(std::string_view, DirectoryEntry::Type, size_t,
                              size_t)> &on_each_entry) {
-  auto pooled_shared_memory = kSharedMemoryPool.GetSharedMemory();
-  char *buffer = (char *)**pooled_shared_memory->shared_memory;
+  Dentry directory = LookUp(path);
+  if (!directory.exists || directory.type != DirectoryEntry::Type::DIRECTORY)
+    return;
+  (void)ScanDirectory(directory.location, directory.size_in_bytes,
+                      on_each_entry);
+}
 
-  uint32 root_lba_val;
-  std::memcpy(&root_lba_val, &root_directory_[2], 4);
-  size_t directory_lba = root_lba_val;
+Dentry Iso9660::LookUp(std::string_view path) {
+  while (!path.empty() && path.front() == '/') path = path.substr(1);
+  while (!path.empty() && path.back() == '/')
+    path = path.substr(0, path.length() - 1);
 
-  uint32 root_len_val;
-  std::memcpy(&root_len_val, &root_directory_[10], 4);
-  size_t directory_length = root_len_val;
+  if (path.empty()) {
+    // The root directory.
+    uint32 root_lba_val;
+    std::memcpy(&root_lba_val, &root_directory_[2], 4);
+    uint32 root_len_val;
+    std::memcpy(&root_len_val, &root_directory_[10], 4);
+    return {true, DirectoryEntry::Type::DIRECTORY, root_len_val,
+            root_lba_val};
+  }
 
-  size_t offset = 0;
+  if (std::optional<Dentry> dentry = dentries_.Find(path)) return *dentry;
 
-  // Keep scanning until the directory is entered.
-  while (true) {
-    // Scan for directory.
-    bool found_sub_directory = false;
-    int split_index = path.find_first_of('/');
-    std::string_view folder_to_find;
-    if (split_index == std::string_view::npos) {
-      folder_to_find = path;
-      path = "";
-    } else {
-      folder_to_find = path.substr(0, split_index);
-      path = path.substr(split_index + 1);
+  std::string_view directory_path, file_name;
+  SplitPath(path, directory_path, file_name);
 
-      // Strip out any remaining slashes.
-      while (!path.empty() && path[0] == '/') path = path.substr(1);
-    }
+  Dentry dentry = {false, DirectoryEntry::Type::FILE, 0, 0};
+  Dentry directory = LookUp(directory_path);
+  if (directory.exists && directory.type == DirectoryEntry::Type::DIRECTORY) {
+    bool scanned = ScanDirectory(
+        directory.location, directory.size_in_bytes,
+        [&](std::string_view name, DirectoryEntry::Type type, size_t start_lba,
+            size_t size) {
+          if (!EqualsIgnoreCase(name, file_name)) return false;
+          dentry = {true, type, size, start_lba};
+          return true;
+        });
+    // Don't remember that the file is missing if the directory couldn't be
+    // read.
+    if (!scanned) return dentry;
+  }
 
-    // Loop over items in this directory.
-    while (directory_length > 0 && !found_sub_directory) {
-      // Maybe read in the sector.
-      if (offset == 0 || offset + 32 > logical_block_size_) {
-        // Read in the sector. Note that directory entries aren't allowed to
-        // cross sector boundaries.
-        size_t directory_start = directory_lba * logical_block_size_;
-        if (ReadCached(directory_start, 0, kIso9660SectorSize,
-                       pooled_shared_memory->shared_memory) != Status::OK) {
-          // Error reading sector.
-          kSharedMemoryPool.ReleaseSharedMemory(
-              std::move(pooled_shared_memory));
-          return;
-        }
+  dentries_.Insert(path, dentry);
+  return dentry;
+}
 
-        // Increment it for the next read.
-        directory_lba++;
+bool Iso9660::ScanDirectory(
+    size_t directory_lba, size_t directory_length,
+    const std::function<bool(std::string_view, DirectoryEntry::Type, size_t,
+                             size_t)> &on_each_entry) {
+  auto pooled_shared_memory = kSharedMemoryPool.GetSharedMemory();
+  char *buffer = (char *)**pooled_shared_memory->shared_memory;
 
-        // Start reading from the beginning of this new sector.
-        offset = 0;
-      }
+  size_t offset = 0;
 
-      // Read this record's length.
-      size_t record_length = (size_t)*(uint8 *)&buffer[offset] +
-                             (size_t)*(uint8 *)&buffer[offset + 1];
-      if (record_length <= 0) {
-        // End of the sector. Read the next sector.
-        size_t remaining_in_sector = logical_block_size_ - offset;
-        if (remaining_in_sector >= directory_length)
-          directory_length = 0;
-        else
-          directory_length -= remaining_in_sector;
-
-        offset = logical_block_size_;
-        continue;
+  // Loop over items in this directory.
+  while (directory_length > 0) {
+    // Maybe read in the sector.
+    if (offset == 0 || offset + 32 > logical_block_size_) {
+      // Read in the sector. Note that directory entries aren't allowed to
+      // cross sector boundaries.
+      size_t directory_start = directory_lba * logical_block_size_;
+      if (ReadCached(directory_start, 0, kIso9660SectorSize,
+                     pooled_shared_memory->shared_memory) != Status::OK) {
+        // Error reading sector.
+        kSharedMemoryPool.ReleaseSharedMemory(std::move(pooled_shared_memory));
+        return false;
       }
 
-      // Read in the entry's name.
-      int entry_name_length = (int)*(uint8 *)&buffer[offset + 32];
-      std::string_view entry_name =
-          std::string_view(&buffer[offset + 33], entry_name_length);
-
-      bool alternative_name = false;
-
-      // See if there is a Rock Ridge name to use instead, which supports
-      // up to 255 characters, and is stored as an extension just after
-      // the entry name.
-      size_t susp_start = entry_name_length + 33;
-      if (susp_start % 2 == 1) susp_start++;  // Extensions are 2 byte aligned.
-
-      // Check the system user area (where extensions are).
-      while (susp_start + 3 < record_length) {
-        char signature_1 = buffer[offset + susp_start];
-        char signature_2 = buffer[offset + susp_start + 1];
-        size_t extension_length =
-            (size_t)*(uint8 *)&buffer[offset + susp_start + 2];
-        if (extension_length == 0) break;
-        // There is have enough space for Rock Ridge.
-        if (signature_1 == 'N' && signature_2 == 'M') {
-          // This is a Rock Ridge extension.
-          if (susp_start + extension_length <= record_length) {
-            // There is space for Rock Ridge extension.
-            entry_name = std::string_view(&buffer[offset + susp_start + 5],
-                                          extension_length - 5);
-            alternative_name = true;
-          }
-        }
-        // Iterate to the next extension.
-        susp_start += extension_length;
-      }
+      // Increment it for the next read.
+      directory_lba++;
 
-      if (!alternative_name) {
-        // For some reason, entry names are often padded with a non-printable
-        // character.
-        if (!entry_name.empty() && !std::isprint(entry_name[0]))
-          entry_name = entry_name.substr(1);
-
-        // IO 9660 file names have a ';' followed by a revision number.
-        // We'll trim this off the end of the file name.
-        int semi_colon = entry_name.find_last_of(';');
-        if (semi_colon != std::string_view::npos)
-          entry_name = entry_name.substr(0, semi_colon);
-      }
+      // Start reading from the beginning of this new sector.
+      offset = 0;
+    }
+
+    // Read this record's length.
+    size_t record_length = (size_t)*(uint8 *)&buffer[offset] +
+                           (size_t)*(uint8 *)&buffer[offset + 1];
+    if (record_length <= 0) {
+      // End of the sector. Read the next sector.
+      size_t remaining_in_sector = logical_block_size_ - offset;
+      if (remaining_in_sector >= directory_length)
+        directory_length = 0;
+      else
+        directory_length -= remaining_in_sector;
+
+      offset = logical_block_size_;
+      continue;
+    }
 
-      if (!entry_name.empty() && entry_name != "." && entry_name != ".." &&
-          entry_name != "\1") {
-        // Is this a directory?
-        bool is_directory = (buffer[offset + 25] & (1 << 1)) == 2;
-
-        size_t entry_start_lba = (size_t)*(uint32 *)&buffer[offset + 2];
-        size_t entry_size = (size_t)*(uint32 *)&buffer[offset + 10];
-
-        if (folder_to_find.empty()) {
-          if (on_each_entry(entry_name,
-                            is_directory ? DirectoryEntry::Type::DIRECTORY
-                                         : DirectoryEntry::Type::FILE,
-                            entry_start_lba, entry_size)) {
-            kSharedMemoryPool.ReleaseSharedMemory(
-                std::move(pooled_shared_memory));
-            return;
-          }
-        } else if (EqualsIgnoreCase(folder_to_find, entry_name)) {
-          found_sub_directory = true;
-          directory_lba = entry_start_lba;
-          directory_length = entry_size;
-          offset = 0;
+    // Read in the entry's name.
+    int entry_name_length = (int)*(uint8 *)&buffer[offset + 32];
+    std::string_view entry_name =
+        std::string_view(&buffer[offset + 33], entry_name_length);
+
+    bool alternative_name = false;
+
+    // See if there is a Rock Ridge name to use instead, which supports
+    // up to 255 characters, and is stored as an extension just after
+    // the entry name.
+    size_t susp_start = entry_name_length + 33;
+    if (susp_start % 2 == 1) susp_start++;  // Extensions are 2 byte aligned.
+
+    // Check the system user area (where extensions are).
+    while (susp_start + 3 < record_length) {
+      char signature_1 = buffer[offset + susp_start];
+      char signature_2 = buffer[offset + susp_start + 1];
+      size_t extension_length =
+          (size_t)*(uint8 *)&buffer[offset + susp_start + 2];
+      if (extension_length == 0) break;
+      // There is have enough space for Rock Ridge.
+      if (signature_1 == 'N' && signature_2 == 'M') {
+        // This is a Rock Ridge extension.
+        if (susp_start + extension_length <= record_length) {
+          // There is space for Rock Ridge extension.
+          entry_name = std::string_view(&buffer[offset + susp_start + 5],
+                                        extension_length - 5);
+          alternative_name = true;
         }
       }
+      // Iterate to the next extension.
+      susp_start += extension_length;
+    }
 
-      if (!found_sub_directory) {
-        // Jump to the next record.
-        if (record_length < directory_length)
-          directory_length -= record_length;
-        else
-          directory_length = 0;
-        offset += record_length;
-      }
+    if (!alternative_name) {
+      // For some reason, entry names are often padded with a non-printable
+      // character.
+      if (!entry_name.empty() && !std::isprint(entry_name[0]))
+        entry_name = entry_name.substr(1);
+
+      // IO 9660 file names have a ';' followed by a revision number.
+      // We'll trim this off the end of the file name.
+      int semi_colon = entry_name.find_last_of(';');
+      if (semi_colon != std::string_view::npos)
+        entry_name = entry_name.substr(0, semi_colon);
     }
 
-    if (!found_sub_directory) {
-      // There is no subdirectory to enter.
-      kSharedMemoryPool.ReleaseSharedMemory(std::move(pooled_shared_memory));
-      return;
+    if (!entry_name.empty() && entry_name != "." && entry_name != ".." &&
+        entry_name != "\1") {
+      // Is this a directory?
+      bool is_directory = (buffer[offset + 25] & (1 << 1)) == 2;
+
+      size_t entry_start_lba = (size_t)*(uint32 *)&buffer[offset + 2];
+      size_t entry_size = (size_t)*(uint32 *)&buffer[offset + 10];
+
+      if (on_each_entry(entry_name,
+                        is_directory ? DirectoryEntry::Type::DIRECTORY
+                                     : DirectoryEntry::Type::FILE,
+                        entry_start_lba, entry_size)) {
+        kSharedMemoryPool.ReleaseSharedMemory(std::move(pooled_shared_memory));
+        return true;
+      }
     }
+
+    // Jump to the next record.
+    if (record_length < directory_length)
+      directory_length -= record_length;
+    else
+      directory_length = 0;
+    offset += record_length;
   }
+
+  kSharedMemoryPool.ReleaseSharedMemory(std::move(pooled_shared_memory));
+  return true;
 }
 
 std::string_view Iso9660::GetFileSystemType() { return kIso9660Name; }
@@ -569,21 +647,12 @@ StatusOr<FileStatistics> Iso9660::GetFileStatistics(std::string_view path) {
     return response;
   }
 
-  std::string_view directory, file_name;
-  SplitPath(path, directory, file_name);
-
-  ForRawEachEntryInDirectory(
-      directory, [&](std::string_view name, DirectoryEntry::Type type,
-                     size_t start_lba, size_t size) {
-        if (name == file_name) {
-          response.exists = true;
-          response.type = type;
-          response.size_in_bytes = size;
-          return true;
-        }
-        return false;
-      });
-
+  Dentry dentry = LookUp(path);
+  if (dentry.exists) {
+    response.exists = true;
+    response.type = dentry.type;
+    response.size_in_bytes = dentry.size_in_bytes;
+  }
   return response;
 }
 
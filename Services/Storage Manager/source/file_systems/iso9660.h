@@ -17,6 +17,7 @@
 #include <memory>
 #include <mutex>
 
+#include "dentry_cache.h"
 #include "file_systems/file_system.h"
 
 class SectorCache;
@@ -70,6 +71,15 @@ class Iso9660 : public FileSystem {
                     uint64 bytes_to_copy,
                     std::shared_ptr<::perception::SharedMemory> buffer);
 
+  // Reads sectors that aren't already cached into the sector cache, so that
+  // later calls to ReadCached() don't wait on the device. This does nothing
+  // if the prefetch buffer is busy.
+  void Prefetch(uint64 offset_on_device, uint64 bytes_to_prefetch);
+
+  // Calls Prefetch() after the current events are handled. This does nothing
+  // if the file system is unmounted first.
+  void DeferPrefetch(uint64 offset_on_device, uint64 bytes_to_prefetch);
+
   ::perception::devices::StorageDevice::Client GetStorageDevice() const {
     return storage_device_;
   }
@@ -93,11 +103,38 @@ class Iso9660 : public FileSystem {
   // Mutex to protect the prefetch buffer.
   std::mutex prefetch_mutex_;
 
+  // The file system that deferred prefetches run on. This is shared with the
+  // deferred prefetches and cleared when the file system is destroyed.
+  struct PrefetchTarget {
+    std::mutex mutex;
+    Iso9660* file_system;
+  };
+  std::shared_ptr<PrefetchTarget> prefetch_target_;
+
+  // Cached lookups of paths, with each entry's location being its first
+  // logical block.
+  DentryCache dentries_;
+
+  // Calls `on_each_entry` with the name, type, first logical block, and size
+  // of each entry in the directory at `path`, until it returns true.
   void ForRawEachEntryInDirectory(
       std::string_view path,
       const std::function<bool(std::string_view,
                                ::perception::DirectoryEntry::Type, size_t,
                                size_t)>& on_each_entry);
+
+  // Looks up a path, scanning each directory above it that isn't cached.
+  // Names are matched case insensitively.
+  Dentry LookUp(std::string_view path);
+
+  // Like ForRawEachEntryInDirectory(), but for the directory starting at
+  // `directory_lba` that's `directory_length` bytes long. Returns false if
+  // the directory couldn't be read.
+  bool ScanDirectory(
+      size_t directory_lba, size_t directory_length,
+      const std::function<bool(std::string_view,
+                               ::perception::DirectoryEntry::Type, size_t,
+                               size_t)>& on_each_entry);
 };
 
 // Returns a FileSystem instance if this device is in the Iso 9660 format.
@@ -13,47 +13,30 @@
 // limitations under the License.
 
 #include <memory>
-#include <mutex>
 
-#include "file.h"
+#include "page_cache.h"
 #include "perception/shared_memory.h"
 #include "perception/storage_manager.h"
 
+// A process's handle to a memory mapped file. The file's contents live in the
+// page cache and are shared with every other process that maps the file.
 class MemoryMappedFile : public ::perception::MemoryMappedFile::Server {
  public:
-  MemoryMappedFile(std::unique_ptr<File> file, size_t length_of_file,
-                   size_t optimal_operation_size,
+  MemoryMappedFile(PageCache& page_cache,
+                   std::shared_ptr<CachedFile> cached_file,
                    ::perception::ProcessId allowed_process);
 
+  virtual ~MemoryMappedFile();
+
   virtual Status Close(::perception::ProcessId sender) override;
 
   std::shared_ptr<::perception::SharedMemory> GetBuffer();
 
  private:
-  std::unique_ptr<File> file_;
+  PageCache& page_cache_;
+  std::shared_ptr<CachedFile> cached_file_;
   ::perception::ProcessId allowed_process_;
-  size_t length_of_file_;
-  std::shared_ptr<::perception::SharedMemory> buffer_;
-  std::mutex mutex_;
-
-  // The optimal size of operations, in bytes.
-  size_t optimal_operation_size_;
-
-  // Should this file close after all operations?
-  bool close_after_all_operations_;
 
   // Is the file closed?
   bool is_closed_;
-
-  // How many operations are running?
-  int running_operations_;
-
-  // Reads in a page-sized chunk of the file into the buffer.
-  void ReadInPageChunk(size_t start_of_page);
-
-  // Maybe closes the file if there are no operations running.
-  void MaybeCloseIfUnlocked();
-
-  // Closes the file.
-  void CloseFile();
-};
\ No newline at end of file
+};
@@ -0,0 +1,294 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "page_cache.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "perception/memory.h"
+#include "perception/processes.h"
+#include "perception/scheduler.h"
+
+using ::file_systems::FileSystem;
+using ::perception::AllocateMemoryPages;
+using ::perception::Defer;
+using ::perception::GetProcessId;
+using ::perception::
+    GrantStorageDevicePermissionToAllocateSharedMemoryPagesRequest;
+using ::perception::kPageSize;
+using ::perception::PageCacheStatistics;
+using ::perception::ReadFileRequest;
+using ::perception::SharedMemory;
+
+namespace {
+
+// The smallest and largest windows to read ahead of sequential page faults.
+constexpr size_t kMinReadaheadWindow = 64 * 1024;
+constexpr size_t kMaxReadaheadWindow = 1024 * 1024;
+
+// Rounds a size down to the nearest page aligned size, but never below the size
+// of a single page.
+size_t RoundDownToPageAlignSize(size_t size) {
+  if (size < kPageSize) size = kPageSize;
+  return (size / kPageSize) * kPageSize;
+}
+
+}  // namespace
+
+std::shared_ptr<CachedFile> CachedFile::Create(std::unique_ptr<File> file,
+                                               size_t length_of_file,
+                                               size_t optimal_operation_size) {
+  auto cached_file = std::make_shared<CachedFile>(
+      std::move(file), length_of_file, optimal_operation_size);
+  if (length_of_file == 0) return cached_file;
+
+  // The buffer outlives the cached file if a process still has it mapped, so
+  // page requests only hold a weak reference. The strong reference taken
+  // while reading keeps the file from being destroyed if it's evicted
+  // mid-read.
+  std::weak_ptr<CachedFile> weak_cached_file = cached_file;
+  cached_file->buffer_ = SharedMemory::FromSize(
+      length_of_file, SharedMemory::kLazilyAllocated,
+      [weak_cached_file](size_t offset_of_page) {
+        if (auto cached_file = weak_cached_file.lock())
+          cached_file->ReadInPageChunk(offset_of_page);
+      });
+  cached_file->buffer_->GrantPermissionToLazilyAllocatePage(GetProcessId());
+
+  GrantStorageDevicePermissionToAllocateSharedMemoryPagesRequest grant_request;
+  grant_request.buffer = cached_file->buffer_;
+  File& open_file = *cached_file->file_;
+  (void)open_file.GrantStorageDevicePermissionToAllocateSharedMemoryPages(
+      grant_request, GetProcessId());
+
+  cached_file->buffer_->Join();
+  return cached_file;
+}
+
+CachedFile::CachedFile(std::unique_ptr<File> file, size_t length_of_file,
+                       size_t optimal_operation_size)
+    : file_(std::move(file)),
+      length_of_file_(length_of_file),
+      optimal_operation_size_(RoundDownToPageAlignSize(optimal_operation_size)),
+      readahead_(std::max(kMinReadaheadWindow, optimal_operation_size_),
+                 std::max(kMaxReadaheadWindow, optimal_operation_size_)),
+      resident_pages_(0),
+      mappers_(0),
+      is_cached_(false) {}
+
+void CachedFile::ReadInPageChunk(size_t offset_of_page) {
+  // Round the page offset down.
+  offset_of_page =
+      (offset_of_page / optimal_operation_size_) * optimal_operation_size_;
+  if (offset_of_page >= length_of_file_) return;
+
+  ReadaheadRange readahead =
+      readahead_.OnRead(offset_of_page, optimal_operation_size_);
+  if (readahead.length > 0 && readahead.offset < length_of_file_) {
+    // This runs once the read below is waiting on the device, so both are in
+    // flight at the same time.
+    std::weak_ptr<CachedFile> weak_cached_file = weak_from_this();
+    Defer([weak_cached_file, readahead]() {
+      if (auto cached_file = weak_cached_file.lock())
+        cached_file->ReadInChunks(readahead.offset,
+                                  readahead.offset + readahead.length);
+    });
+  }
+
+  ReadInChunks(offset_of_page, offset_of_page + optimal_operation_size_);
+}
+
+void CachedFile::ReadInChunks(size_t start, size_t end) {
+  start = (start / optimal_operation_size_) * optimal_operation_size_;
+  end = std::min(end, length_of_file_);
+
+  while (start < end) {
+    // Skip over chunks that are resident or being read.
+    if (buffer_->IsPageAllocated(start) ||
+        chunks_being_read_.count(start) > 0) {
+      start += optimal_operation_size_;
+      continue;
+    }
+
+    // Find the run of chunks that need reading.
+    size_t run_end = start;
+    while (run_end < end && !buffer_->IsPageAllocated(run_end) &&
+           chunks_being_read_.count(run_end) == 0) {
+      chunks_being_read_.insert(run_end);
+      run_end += optimal_operation_size_;
+    }
+    size_t bytes_to_copy = std::min(run_end, length_of_file_) - start;
+
+    // Read the run in from the file.
+    ReadFileRequest request;
+    request.buffer_to_copy_into = buffer_;
+    request.offset_in_file = start;
+    request.offset_in_destination_buffer = start;
+    request.bytes_to_copy = bytes_to_copy;
+
+    size_t first_page = start;
+    size_t last_page = first_page + (bytes_to_copy - 1) / kPageSize * kPageSize;
+    size_t unallocated_pages = CountUnallocatedPages(first_page, last_page);
+
+    auto read_status = file_->Read(request, GetProcessId());
+    if (read_status != Status::OK) {
+      for (size_t page = first_page; page <= last_page; page += kPageSize) {
+        if (buffer_->IsPageAllocated(page)) continue;
+        // Create a new page to copy this temporary page into.
+        void* new_page = AllocateMemoryPages(1);
+        memset(new_page, 0, kPageSize);
+        buffer_->AssignPage(new_page, page);
+      }
+    }
+    // Only count the pages this read filled in.
+    resident_pages_ +=
+        unallocated_pages - CountUnallocatedPages(first_page, last_page);
+
+    for (size_t chunk = start; chunk < run_end;
+         chunk += optimal_operation_size_)
+      chunks_being_read_.erase(chunk);
+    start = run_end;
+  }
+}
+
+size_t CachedFile::CountUnallocatedPages(size_t first_page,
+                                         size_t last_page) const {
+  size_t unallocated_pages = 0;
+  for (size_t page = first_page; page <= last_page; page += kPageSize) {
+    if (!buffer_->IsPageAllocated(page)) unallocated_pages++;
+  }
+  return unallocated_pages;
+}
+
+PageCache::PageCache(size_t max_unused_files,
+                     std::function<size_t()> unused_page_budget)
+    : max_unused_files_(max_unused_files),
+      unused_page_budget_(std::move(unused_page_budget)),
+      hits_(0),
+      misses_(0),
+      evictions_(0) {}
+
+StatusOr<std::shared_ptr<CachedFile>> PageCache::Acquire(
+    const FileSystem* file_system, std::string_view path,
+    const std::function<StatusOr<std::shared_ptr<CachedFile>>()>& open_file) {
+  std::pair<const FileSystem*, std::string> key(file_system, path);
+  auto itr = cached_files_.find(key);
+  if (itr != cached_files_.end()) {
+    hits_++;
+  } else {
+    misses_++;
+    ASSIGN_OR_RETURN(std::shared_ptr<CachedFile> opened_file, open_file());
+
+    // Files being written to get a private copy. This is checked after
+    // opening, because opening may have let another fiber open the file for
+    // writing.
+    if (writers_.count(key) > 0) {
+      opened_file->mappers_ = 1;
+      return opened_file;
+    }
+
+    // Opening the file may have let another fiber cache it first.
+    itr = cached_files_.find(key);
+    if (itr == cached_files_.end()) {
+      opened_file->key_ = key;
+      opened_file->is_cached_ = true;
+      opened_file->mappers_ = 1;
+      cached_files_[key] = opened_file;
+      EvictUnusedFiles();
+      return opened_file;
+    }
+  }
+
+  std::shared_ptr<CachedFile> cached_file = itr->second;
+  if (cached_file->mappers_ == 0)
+    unused_files_.erase(cached_file->unused_position_);
+  cached_file->mappers_++;
+  EvictUnusedFiles();
+  return cached_file;
+}
+
+void PageCache::Release(CachedFile& cached_file) {
+  cached_file.mappers_--;
+  if (cached_file.mappers_ > 0 || !cached_file.is_cached_) return;
+
+  unused_files_.push_front(&cached_file);
+  cached_file.unused_position_ = unused_files_.begin();
+  EvictUnusedFiles();
+}
+
+void PageCache::Invalidate(const FileSystem* file_system,
+                           std::string_view path) {
+  auto itr = cached_files_.find({file_system, std::string(path)});
+  if (itr != cached_files_.end()) RemoveFromCache(*itr->second);
+}
+
+void PageCache::InvalidateFileSystem(const FileSystem* file_system) {
+  auto itr = cached_files_.lower_bound({file_system, std::string()});
+  while (itr != cached_files_.end() && itr->first.first == file_system) {
+    CachedFile& cached_file = *itr->second;
+    itr++;
+    RemoveFromCache(cached_file);
+  }
+}
+
+void PageCache::BeginWriting(const FileSystem* file_system,
+                             std::string_view path) {
+  writers_[{file_system, std::string(path)}]++;
+  Invalidate(file_system, path);
+}
+
+void PageCache::EndWriting(const FileSystem* file_system,
+                           std::string_view path) {
+  auto itr = writers_.find({file_system, std::string(path)});
+  if (itr != writers_.end() && --itr->second == 0) writers_.erase(itr);
+}
+
+void PageCache::EvictUnusedFiles() {
+  size_t unused_pages = 0;
+  for (const CachedFile* cached_file : unused_files_)
+    unused_pages += cached_file->GetResidentPages();
+
+  size_t page_budget = unused_page_budget_();
+  while (!unused_files_.empty() && (unused_files_.size() > max_unused_files_ ||
+                                    unused_pages > page_budget)) {
+    CachedFile& cached_file = *unused_files_.back();
+    unused_pages -= cached_file.GetResidentPages();
+    evictions_++;
+    RemoveFromCache(cached_file);
+  }
+}
+
+PageCacheStatistics PageCache::GetStatistics() const {
+  PageCacheStatistics statistics;
+  statistics.cached_files = cached_files_.size();
+  for (const auto& [key, cached_file] : cached_files_) {
+    if (cached_file->mappers_ > 0) statistics.mapped_files++;
+    statistics.resident_pages += cached_file->GetResidentPages();
+  }
+  statistics.hits = hits_;
+  statistics.misses = misses_;
+  statistics.evictions = evictions_;
+  return statistics;
+}
+
+void PageCache::RemoveFromCache(CachedFile& cached_file) {
+  if (cached_file.mappers_ == 0)
+    unused_files_.erase(cached_file.unused_position_);
+  cached_file.is_cached_ = false;
+
+  // This may destroy the file, so don't erase using its own key.
+  auto key = cached_file.key_;
+  cached_files_.erase(key);
+}
@@ -0,0 +1,181 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "file.h"
+#include "perception/shared_memory.h"
+#include "perception/storage_manager.h"
+#include "readahead.h"
+
+namespace file_systems {
+class FileSystem;
+}
+
+// The contents of a file, held in a lazily allocated shared memory buffer
+// that every process mapping the file joins read-only. Pages are read in from
+// the file the first time anyone touches them, and stay resident for as long
+// as the file is cached. Faults that walk through the file sequentially grow
+// a readahead window, which is read in the background so that later faults
+// find their pages already resident.
+class CachedFile : public std::enable_shared_from_this<CachedFile> {
+ public:
+  // Creates a cached file around an open file. The file must have been opened
+  // on behalf of the Storage Manager itself.
+  static std::shared_ptr<CachedFile> Create(std::unique_ptr<File> file,
+                                            size_t length_of_file,
+                                            size_t optimal_operation_size);
+
+  CachedFile(std::unique_ptr<File> file, size_t length_of_file,
+             size_t optimal_operation_size);
+
+  // Returns the shared memory buffer with the file's contents. This is
+  // nullptr for empty files.
+  std::shared_ptr<::perception::SharedMemory> GetBuffer() { return buffer_; }
+
+  // Reads in the chunk of the file containing the offset, if it isn't already
+  // resident or being read, and reads ahead of it if the faults look
+  // sequential.
+  void ReadInPageChunk(size_t offset_of_page);
+
+  // Returns the number of pages that have been read in.
+  size_t GetResidentPages() const { return resident_pages_; }
+
+ private:
+  friend class PageCache;
+
+  // Reads in the chunks overlapping the range that aren't resident or already
+  // being read, with one read per run of consecutive chunks.
+  void ReadInChunks(size_t start, size_t end);
+
+  // Returns the number of pages from `first_page` to `last_page`, inclusive,
+  // that aren't allocated.
+  size_t CountUnallocatedPages(size_t first_page, size_t last_page) const;
+
+  std::unique_ptr<File> file_;
+  size_t length_of_file_;
+  std::shared_ptr<::perception::SharedMemory> buffer_;
+
+  // The optimal size of operations, in bytes. Pages are read in chunks of
+  // this size.
+  size_t optimal_operation_size_;
+
+  // The offsets of chunks that are being read. Faults on these return right
+  // away, because the page will be assigned once the read completes.
+  std::set<size_t> chunks_being_read_;
+
+  // Tracks whether faults are sequential.
+  Readahead readahead_;
+
+  // The number of pages that have been read in.
+  size_t resident_pages_;
+
+  // The file system and path the file is cached under.
+  std::pair<const file_systems::FileSystem*, std::string> key_;
+
+  // The number of open memory mapped files using this file.
+  int mappers_;
+
+  // Is this file still in the cache? Files that were written to or deleted
+  // are dropped from the cache, but live on until their last mapper closes.
+  bool is_cached_;
+
+  // If nobody has the file mapped, its position in PageCache::unused_files_.
+  std::list<CachedFile*>::iterator unused_position_;
+};
+
+// Caches the contents of memory mapped files, so that every process mapping
+// the same file shares the same physical pages. Files are reference counted
+// by the number of processes mapping them. Files that nobody has mapped are
+// kept around in case they're mapped again, until the memory they hold is
+// needed.
+class PageCache {
+ public:
+  // `max_unused_files` limits how many files nobody has mapped are kept
+  // open. `unused_page_budget` returns the number of pages those files may
+  // hold, and is checked each time a file is acquired or released so that it
+  // can follow memory pressure.
+  PageCache(size_t max_unused_files,
+            std::function<size_t()> unused_page_budget);
+
+  // Returns the cached copy of a file, calling `open_file` to open it if it
+  // isn't cached. Each successful call must be paired with Release().
+  StatusOr<std::shared_ptr<CachedFile>> Acquire(
+      const file_systems::FileSystem* file_system, std::string_view path,
+      const std::function<StatusOr<std::shared_ptr<CachedFile>>()>&
+          open_file);
+
+  // Releases a file returned from Acquire().
+  void Release(CachedFile& cached_file);
+
+  // Drops a file from the cache because it has changed. Processes that have
+  // it mapped keep the old contents.
+  void Invalidate(const file_systems::FileSystem* file_system,
+                  std::string_view path);
+
+  // Drops every file on a file system from the cache.
+  void InvalidateFileSystem(const file_systems::FileSystem* file_system);
+
+  // Called when a file is opened for writing. The file is dropped from the
+  // cache, and until the matching EndWriting() anyone who maps it gets their
+  // own copy that isn't cached, so that pages read before a write aren't
+  // handed out after it.
+  void BeginWriting(const file_systems::FileSystem* file_system,
+                    std::string_view path);
+
+  // Called when a file opened for writing is closed.
+  void EndWriting(const file_systems::FileSystem* file_system,
+                  std::string_view path);
+
+  // Evicts files that nobody has mapped, least recently used first, until
+  // they fit within the limits.
+  void EvictUnusedFiles();
+
+  // Returns statistics about the cache.
+  ::perception::PageCacheStatistics GetStatistics() const;
+
+ private:
+  // Removes a file from the cache.
+  void RemoveFromCache(CachedFile& cached_file);
+
+  size_t max_unused_files_;
+  std::function<size_t()> unused_page_budget_;
+
+  // The cached files, by file system and path.
+  std::map<std::pair<const file_systems::FileSystem*, std::string>,
+           std::shared_ptr<CachedFile>>
+      cached_files_;
+
+  // The number of open handles that can write to each file, by file system
+  // and path. These files aren't cached.
+  std::map<std::pair<const file_systems::FileSystem*, std::string>, int>
+      writers_;
+
+  // Cached files that nobody has mapped, most recently released first.
+  std::list<CachedFile*> unused_files_;
+
+  // Counters reported by GetStatistics().
+  size_t hits_;
+  size_t misses_;
+  size_t evictions_;
+};
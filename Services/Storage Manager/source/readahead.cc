@@ -0,0 +1,50 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "readahead.h"
+
+#include <algorithm>
+
+Readahead::Readahead(size_t min_window, size_t max_window)
+    : min_window_(min_window),
+      max_window_(std::max(min_window, max_window)),
+      window_(0),
+      next_offset_(0),
+      readahead_end_(0) {}
+
+ReadaheadRange Readahead::OnRead(size_t offset, size_t length) {
+  // A read is sequential if it carries on from the last read, or skips ahead
+  // into data that has already been read ahead (which is what page faults
+  // look like, since resident pages don't fault).
+  if (offset < next_offset_ || offset > readahead_end_) {
+    window_ = 0;
+    next_offset_ = offset + length;
+    readahead_end_ = next_offset_;
+    return {next_offset_, 0};
+  }
+
+  next_offset_ = offset + length;
+  readahead_end_ = std::max(readahead_end_, next_offset_);
+
+  // Wait until the reader is into the second half of the window before
+  // reading any further ahead.
+  if (window_ > 0 && readahead_end_ - next_offset_ > window_ / 2)
+    return {readahead_end_, 0};
+
+  window_ = window_ == 0 ? min_window_ : std::min(window_ * 2, max_window_);
+  ReadaheadRange range = {readahead_end_,
+                          next_offset_ + window_ - readahead_end_};
+  readahead_end_ = next_offset_ + window_;
+  return range;
+}
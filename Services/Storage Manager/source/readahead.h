@@ -0,0 +1,58 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stddef.h>
+
+// A range of a file to read ahead of the reader.
+struct ReadaheadRange {
+  size_t offset;
+
+  // The number of bytes to read ahead. This is 0 if nothing needs to be read.
+  size_t length;
+};
+
+// Detects when a file is being read sequentially, and decides how far ahead
+// of the reader to read. Each open file tracks its own state.
+//
+// While reads are sequential, the window of data kept ahead of the reader
+// doubles each time the reader catches up to the second half of it, up to
+// `max_window`. A read anywhere else collapses the window, and nothing is
+// read ahead until the reader is sequential again.
+class Readahead {
+ public:
+  Readahead(size_t min_window, size_t max_window);
+
+  // Records a read of `length` bytes at `offset`, and returns the range that
+  // should now be read ahead. The range only covers data that hasn't already
+  // been returned from an earlier call, and hasn't been clamped to the end of
+  // the file.
+  ReadaheadRange OnRead(size_t offset, size_t length);
+
+  // Returns the current window size, in bytes. This is 0 if the reads don't
+  // look sequential.
+  size_t Window() const { return window_; }
+
+ private:
+  size_t min_window_;
+  size_t max_window_;
+  size_t window_;
+
+  // Where the next read starts if the reader is sequential.
+  size_t next_offset_;
+
+  // The end of the data that has been read ahead.
+  size_t readahead_end_;
+};
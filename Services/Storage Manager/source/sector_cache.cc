@@ -32,6 +32,14 @@ bool SectorCache::Read(size_t sector, char* dest, size_t offset_in_sector,
   return false;
 }
 
+bool SectorCache::Contains(size_t first_sector, size_t last_sector) {
+  std::scoped_lock lock(mutex_);
+  for (size_t sector = first_sector; sector <= last_sector; sector++) {
+    if (cache_.find(sector) == cache_.end()) return false;
+  }
+  return true;
+}
+
 void SectorCache::Write(size_t sector, const char* src) {
   std::scoped_lock lock(mutex_);
   auto it = cache_.find(sector);
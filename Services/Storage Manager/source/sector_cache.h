@@ -27,6 +27,10 @@ class SectorCache {
   // Returns true if cache hit, false otherwise.
   bool Read(size_t sector, char* dest, size_t offset_in_sector, size_t size);
 
+  // Returns whether every sector from `first_sector` to `last_sector`
+  // (inclusive) is in the cache.
+  bool Contains(size_t first_sector, size_t last_sector);
+
   // Writes a sector's data into the cache.
   void Write(size_t sector, const char* src);
 
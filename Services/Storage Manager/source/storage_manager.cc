@@ -277,3 +277,8 @@ Status StorageManager::DeleteFileOrDirectory(const RequestWithFilePath& request,
 
   return ::DeleteFileOrDirectory(request.path, sender);
 }
+
+StatusOr<::perception::PageCacheStatistics>
+StorageManager::GetPageCacheStatistics() {
+  return ::GetPageCacheStatistics();
+}
@@ -60,6 +60,9 @@ class StorageManager : public ::perception::StorageManager::Server {
       const ::perception::RequestWithFilePath& request,
       ::perception::ProcessId sender) override;
 
+  virtual StatusOr<::perception::PageCacheStatistics> GetPageCacheStatistics()
+      override;
+
   static void BroadcastMount(std::string_view mount_point);
 
   struct MountListenerInfo {
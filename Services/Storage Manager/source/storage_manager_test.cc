@@ -12,10 +12,19 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cstring>
 #include <iostream>
+#include <vector>
+
 #include "testing.h"
+#include "dentry_cache.h"
+#include "file_systems/iso9660.h"
 #include "file_systems/ramdisk.h"
 #include "file_systems/overlay.h"
+#include "page_cache.h"
+#include "readahead.h"
+#include "perception/devices/storage_device.h"
+#include "perception/scheduler.h"
 #include "perception/shared_memory.h"
 
 using ::file_systems::RamdiskFileSystem;
@@ -26,6 +35,12 @@ using ::Status;
 using ::perception::SharedMemory;
 using ::perception::ReadFileRequest;
 using ::perception::WriteFileRequest;
+using ::perception::PageCacheStatistics;
+using ::perception::DirectoryEntry;
+using ::perception::FinishAnyPendingWork;
+using ::perception::devices::StorageDevice;
+using ::perception::devices::StorageDeviceReadRequest;
+using ::file_systems::Iso9660;
 
 TEST(RamdiskFileOperations) {
   RamdiskFileSystem fs;
@@ -208,3 +223,284 @@ TEST(OverlayCoWAndTombstones) {
   auto file_fail_or = overlay.OpenFile("base_file.txt", size, sender, true, false, false, false);
   EXPECT(Status::FILE_NOT_FOUND, file_fail_or.Status());
 }
+
+namespace {
+
+// Creates a file on a ramdisk containing `contents`.
+void CreateRamdiskFile(RamdiskFileSystem& fs, std::string_view path,
+                       std::string_view contents) {
+  ProcessId sender = 123;
+  size_t size;
+  auto file_or = fs.OpenFile(path, size, sender, true, true, true, false);
+  ASSERT(true, file_or.Ok());
+
+  auto write_sm = SharedMemory::FromSize(4096, 0);
+  std::memcpy(**write_sm, contents.data(), contents.length());
+  WriteFileRequest write_req;
+  write_req.offset_in_file = 0;
+  write_req.bytes_to_copy = contents.length();
+  write_req.buffer_to_copy_from = write_sm;
+  EXPECT(Status::OK, (*file_or)->Write(write_req, sender));
+  EXPECT(Status::OK, (*file_or)->Close(sender));
+}
+
+// Memory maps a ramdisk file through the page cache, counting how many times
+// the file had to be opened.
+StatusOr<std::shared_ptr<CachedFile>> AcquireRamdiskFile(
+    PageCache& cache, RamdiskFileSystem& fs, std::string_view path,
+    int& opens) {
+  return cache.Acquire(
+      &fs, path, [&]() -> StatusOr<std::shared_ptr<CachedFile>> {
+        opens++;
+        size_t size;
+        ASSIGN_OR_RETURN(
+            auto file, fs.OpenFile(path, size, 123, true, false, false, false));
+        return CachedFile::Create(std::move(file), size, 4096);
+      });
+}
+
+constexpr size_t kSectorSize = 2048;
+
+// An in-memory storage device that counts how many times it's read from.
+class CountingStorageDevice : public StorageDevice::Server {
+ public:
+  explicit CountingStorageDevice(size_t sectors)
+      : image(sectors * kSectorSize), reads(0) {}
+
+  Status Read(const StorageDeviceReadRequest& request) override {
+    reads++;
+    std::memcpy((char*)**request.buffer + request.offset_in_buffer,
+                &image[request.offset_on_device], request.bytes_to_copy);
+    return Status::OK;
+  }
+
+  std::vector<char> image;
+  int reads;
+};
+
+// Writes an ISO 9660 directory record for an entry starting at `lba`.
+void WriteDirectoryRecord(char* record, uint32 lba, uint32 size,
+                          std::string_view name) {
+  record[0] = (char)(33 + name.length() + (name.length() % 2 == 0 ? 1 : 0));
+  std::memcpy(&record[2], &lba, 4);
+  std::memcpy(&record[10], &size, 4);
+  record[32] = (char)name.length();
+  std::memcpy(&record[33], name.data(), name.length());
+}
+
+}  // namespace
+
+TEST(PageCacheSharesFilesBetweenMappers) {
+  RamdiskFileSystem fs;
+  CreateRamdiskFile(fs, "font.ttf", "Glyphs");
+  PageCache cache(/*max_unused_files=*/4, []() { return (size_t)1024; });
+
+  int opens = 0;
+  auto first = AcquireRamdiskFile(cache, fs, "font.ttf", opens);
+  auto second = AcquireRamdiskFile(cache, fs, "font.ttf", opens);
+  ASSERT(true, first.Ok());
+  ASSERT(true, second.Ok());
+
+  // Both mappers get the same buffer, and the file was only opened once.
+  EXPECT(1, opens);
+  EXPECT(true, (*first)->GetBuffer() == (*second)->GetBuffer());
+
+  PageCacheStatistics statistics = cache.GetStatistics();
+  EXPECT((uint64)1, statistics.cached_files);
+  EXPECT((uint64)1, statistics.mapped_files);
+  EXPECT((uint64)1, statistics.hits);
+  EXPECT((uint64)1, statistics.misses);
+
+  // The file stays cached after everyone closes it.
+  cache.Release(**first);
+  cache.Release(**second);
+  statistics = cache.GetStatistics();
+  EXPECT((uint64)1, statistics.cached_files);
+  EXPECT((uint64)0, statistics.mapped_files);
+
+  auto third = AcquireRamdiskFile(cache, fs, "font.ttf", opens);
+  ASSERT(true, third.Ok());
+  EXPECT(1, opens);
+  EXPECT(true, (*first)->GetBuffer() == (*third)->GetBuffer());
+  cache.Release(**third);
+}
+
+TEST(PageCacheEvictsAndInvalidates) {
+  RamdiskFileSystem fs;
+  CreateRamdiskFile(fs, "a.txt", "A");
+  CreateRamdiskFile(fs, "b.txt", "B");
+  PageCache cache(/*max_unused_files=*/1, []() { return (size_t)1024; });
+
+  int opens = 0;
+  auto a = AcquireRamdiskFile(cache, fs, "a.txt", opens);
+  auto b = AcquireRamdiskFile(cache, fs, "b.txt", opens);
+  ASSERT(true, a.Ok());
+  ASSERT(true, b.Ok());
+
+  // Mapped files are never evicted, but once both are unused only the most
+  // recently released one is kept.
+  cache.Release(**a);
+  EXPECT((uint64)0, cache.GetStatistics().evictions);
+  cache.Release(**b);
+  EXPECT((uint64)1, cache.GetStatistics().evictions);
+  EXPECT((uint64)1, cache.GetStatistics().cached_files);
+
+  auto b_again = AcquireRamdiskFile(cache, fs, "b.txt", opens);
+  ASSERT(true, b_again.Ok());
+  EXPECT(2, opens);
+
+  // Invalidating a mapped file drops it from the cache, but the mapper keeps
+  // its copy.
+  cache.Invalidate(&fs, "b.txt");
+  EXPECT((uint64)0, cache.GetStatistics().cached_files);
+  EXPECT(true, (bool)(*b_again)->GetBuffer());
+
+  auto b_new = AcquireRamdiskFile(cache, fs, "b.txt", opens);
+  ASSERT(true, b_new.Ok());
+  EXPECT(3, opens);
+  EXPECT(false, (*b_again)->GetBuffer() == (*b_new)->GetBuffer());
+
+  cache.Release(**b_again);
+  cache.Release(**b_new);
+  cache.InvalidateFileSystem(&fs);
+  EXPECT((uint64)0, cache.GetStatistics().cached_files);
+}
+
+TEST(PageCacheDoesNotCacheFilesBeingWritten) {
+  RamdiskFileSystem fs;
+  CreateRamdiskFile(fs, "log.txt", "Old");
+  PageCache cache(/*max_unused_files=*/4, []() { return (size_t)1024; });
+
+  int opens = 0;
+  auto before = AcquireRamdiskFile(cache, fs, "log.txt", opens);
+  ASSERT(true, before.Ok());
+  cache.Release(**before);
+  EXPECT((uint64)1, cache.GetStatistics().cached_files);
+
+  // Opening the file for writing drops it from the cache, and mapping it
+  // while it's open gives each mapper its own copy.
+  cache.BeginWriting(&fs, "log.txt");
+  EXPECT((uint64)0, cache.GetStatistics().cached_files);
+  auto first = AcquireRamdiskFile(cache, fs, "log.txt", opens);
+  auto second = AcquireRamdiskFile(cache, fs, "log.txt", opens);
+  ASSERT(true, first.Ok());
+  ASSERT(true, second.Ok());
+  EXPECT(3, opens);
+  EXPECT(false, (*first)->GetBuffer() == (*second)->GetBuffer());
+  cache.Release(**first);
+  cache.Release(**second);
+  EXPECT((uint64)0, cache.GetStatistics().cached_files);
+
+  // Once the writer closes, the file is cached again.
+  cache.EndWriting(&fs, "log.txt");
+  auto after = AcquireRamdiskFile(cache, fs, "log.txt", opens);
+  ASSERT(true, after.Ok());
+  EXPECT(4, opens);
+  EXPECT((uint64)1, cache.GetStatistics().cached_files);
+  cache.Release(**after);
+}
+
+TEST(Iso9660DoesNotPrefetchLazilyAllocatedReads) {
+  // The root directory is in sector 20 and holds a file in sectors 32 to 63.
+  constexpr uint32 kFileSize = 32 * kSectorSize;
+  CountingStorageDevice device(/*sectors=*/64);
+  WriteDirectoryRecord(&device.image[20 * kSectorSize], 32, kFileSize,
+                       "DATA.BIN;1");
+  auto root_directory = std::make_unique<char[]>(34);
+  WriteDirectoryRecord(root_directory.get(), 20, kSectorSize, "");
+  Iso9660 fs(/*size_in_blocks=*/64, kSectorSize, std::move(root_directory),
+             StorageDevice::Client(device));
+
+  size_t size;
+  auto file = fs.OpenFile("DATA.BIN", size, 123, true, false, false, false);
+  ASSERT(true, file.Ok());
+  EXPECT((size_t)kFileSize, size);
+
+  // Read the file sequentially into a lazily allocated buffer, like the page
+  // cache does. Each read goes straight to the device, and nothing else is
+  // read in behind it.
+  auto buffer =
+      SharedMemory::FromSize(kFileSize, SharedMemory::kLazilyAllocated);
+  int reads_before = device.reads;
+  constexpr size_t kChunkSize = 4 * kSectorSize;
+  for (size_t offset = 0; offset < kFileSize; offset += kChunkSize) {
+    ReadFileRequest request;
+    request.buffer_to_copy_into = buffer;
+    request.offset_in_file = offset;
+    request.offset_in_destination_buffer = offset;
+    request.bytes_to_copy = kChunkSize;
+    EXPECT(Status::OK, (*file)->Read(request, 123));
+    FinishAnyPendingWork();
+  }
+  EXPECT((int)(kFileSize / kChunkSize), device.reads - reads_before);
+}
+
+TEST(ReadaheadGrowsOnSequentialReads) {
+  Readahead readahead(/*min_window=*/4, /*max_window=*/16);
+
+  // The first read from the start of a file is sequential.
+  ReadaheadRange range = readahead.OnRead(0, 2);
+  EXPECT((size_t)2, range.offset);
+  EXPECT((size_t)4, range.length);
+  EXPECT((size_t)4, readahead.Window());
+
+  // Nothing more is read ahead until the reader is halfway into the window.
+  EXPECT((size_t)0, readahead.OnRead(2, 1).length);
+  range = readahead.OnRead(3, 1);
+  EXPECT((size_t)6, range.offset);
+  EXPECT((size_t)6, range.length);
+  EXPECT((size_t)8, readahead.Window());
+
+  // Skipping into data that was read ahead is still sequential, and the
+  // window stops growing at the maximum.
+  range = readahead.OnRead(10, 2);
+  EXPECT((size_t)12, range.offset);
+  EXPECT((size_t)16, range.length);
+  EXPECT((size_t)16, readahead.Window());
+  range = readahead.OnRead(20, 8);
+  EXPECT((size_t)28, range.offset);
+  EXPECT((size_t)16, range.length);
+  EXPECT((size_t)16, readahead.Window());
+}
+
+TEST(ReadaheadCollapsesOnRandomReads) {
+  Readahead readahead(/*min_window=*/4, /*max_window=*/16);
+  readahead.OnRead(0, 2);
+  readahead.OnRead(2, 2);
+  EXPECT((size_t)8, readahead.Window());
+
+  // Jumping backwards or past the readahead stops reading ahead.
+  EXPECT((size_t)0, readahead.OnRead(1, 1).length);
+  EXPECT((size_t)0, readahead.Window());
+  EXPECT((size_t)0, readahead.OnRead(100, 4).length);
+  EXPECT((size_t)0, readahead.Window());
+
+  // Carrying on from the random read starts again from the smallest window.
+  ReadaheadRange range = readahead.OnRead(104, 4);
+  EXPECT((size_t)108, range.offset);
+  EXPECT((size_t)4, range.length);
+}
+
+TEST(DentryCacheFindsAndEvicts) {
+  DentryCache cache(/*max_entries=*/2);
+  EXPECT(false, cache.Find("Fonts").has_value());
+
+  cache.Insert("Fonts", {true, DirectoryEntry::Type::DIRECTORY, 2048, 20});
+  cache.Insert("Fonts/missing.ttf", {false, DirectoryEntry::Type::FILE, 0, 0});
+
+  // Missing files are remembered too.
+  auto missing = cache.Find("Fonts/missing.ttf");
+  ASSERT(true, missing.has_value());
+  EXPECT(false, missing->exists);
+
+  // Finding "Fonts" makes the missing file the least recently used, so it's
+  // evicted first.
+  auto fonts = cache.Find("Fonts");
+  ASSERT(true, fonts.has_value());
+  EXPECT((size_t)20, fonts->location);
+  cache.Insert("Fonts/DejaVuSans.ttf",
+               {true, DirectoryEntry::Type::FILE, 10, 30});
+  EXPECT((size_t)2, cache.Size());
+  EXPECT(false, cache.Find("Fonts/missing.ttf").has_value());
+  EXPECT(true, cache.Find("Fonts/DejaVuSans.ttf").has_value());
+}
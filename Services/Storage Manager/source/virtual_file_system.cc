@@ -23,7 +23,10 @@
 
 #include "file_systems/overlay.h"
 #include "memory_mapped_file.h"
+#include "page_cache.h"
 #include "perception/fibers.h"
+#include "perception/memory.h"
+#include "perception/processes.h"
 #include "storage_manager.h"
 
 using ::file_systems::FileSystem;
@@ -31,6 +34,10 @@ using ::perception::DirectoryEntry;
 using ::perception::Fiber;
 using ::perception::FileStatistics;
 using ::perception::GetCurrentlyExecutingFiber;
+using ::perception::GetFreeSystemMemory;
+using ::perception::GetProcessId;
+using ::perception::kPageSize;
+using ::perception::PageCacheStatistics;
 using ::perception::ProcessId;
 using ::perception::Sleep;
 using ::perception::devices::StorageDeviceType;
@@ -44,9 +51,25 @@ std::mutex file_system_mutex;
 std::map<ProcessId, std::vector<std::unique_ptr<File>>>
     open_files_by_process_id;
 
+// The most files that nobody has memory mapped that the page cache keeps open.
+constexpr size_t kMaxUnusedCachedFiles = 256;
+
+// Files that nobody has memory mapped may hold up to a quarter of free memory.
+size_t GetUnusedPageCacheBudget() {
+  return GetFreeSystemMemory() / kPageSize / 4;
+}
+
+// Shares the contents of memory mapped files between processes. Declared
+// before the memory mapped files so that it outlives them.
+PageCache page_cache(kMaxUnusedCachedFiles, GetUnusedPageCacheBudget);
+
 std::map<ProcessId, std::vector<std::unique_ptr<MemoryMappedFile>>>
     open_memory_mapped_files_by_process_id;
 
+// The file system and path of each open file that can be written to, so the
+// page cache can be told when it's closed.
+std::map<File*, std::pair<const FileSystem*, std::string>> writable_files;
+
 // Save the first mounted file system, and shortcut /Applications,
 // /Libraries into it.
 std::string first_mounted_file_system = "";
@@ -86,6 +109,7 @@ static void UnmountFileSystem(const std::string mount_name) {
   std::cout << "Unmounting " << itr->second->GetFileSystemType() << " on "
             << itr->second->GetDeviceName() << " as /" << mount_name << "/"
             << std::endl;
+  page_cache.InvalidateFileSystem(itr->second.get());
   mounted_file_systems.erase(itr);
 }
 
@@ -156,8 +180,20 @@ StatusOr<std::unique_ptr<File>> OpenFileInternal(
   }
 
   optimal_operation_size = fs->GetOptionalOperationSize();
-  return fs->OpenFile(path_on_mount_point, size_in_bytes, sender, read_access,
-                      write_access, create_if_not_exists, truncate);
+  ASSIGN_OR_RETURN(
+      std::unique_ptr<File> file,
+      fs->OpenFile(path_on_mount_point, size_in_bytes, sender, read_access,
+                   write_access, create_if_not_exists, truncate));
+
+  // Memory mapped copies of the file are about to go stale. This is only done
+  // once the open succeeds, so a failed open doesn't throw away cached pages.
+  if (write_access) {
+    page_cache.BeginWriting(fs.get(), path_on_mount_point);
+    writable_files[file.get()] = {fs.get(), std::string(path_on_mount_point)};
+  } else if (truncate) {
+    page_cache.Invalidate(fs.get(), path_on_mount_point);
+  }
+  return file;
 }
 
 }  // namespace
@@ -226,14 +262,39 @@ StatusOr<File*> OpenFile(std::string_view path, size_t& size_in_bytes,
 
 StatusOr<MemoryMappedFile*> OpenMemoryMappedFile(
     std::string_view path, ::perception::ProcessId sender) {
-  size_t size_in_bytes;
-  size_t optimal_operation_size;
-  ASSIGN_OR_RETURN(auto file,
-                   OpenFileInternal(path, size_in_bytes, optimal_operation_size,
-                                    sender, true, false, false, false));
+  std::string_view mount_point, path_on_mount_point;
+  RETURN_ON_ERROR(
+      ExtractMountPointAndPath(path, mount_point, path_on_mount_point));
+
+  std::shared_ptr<FileSystem> fs;
+  {
+    std::lock_guard<std::mutex> lock(file_system_mutex);
+    auto mount_point_itr = mounted_file_systems.find(mount_point);
+    if (mount_point_itr == mounted_file_systems.end()) {
+      return Status::FILE_NOT_FOUND;  // No mount point.
+    }
+    fs = mount_point_itr->second;
+  }
+
+  // Every process mapping the file shares the same cached copy, which the
+  // Storage Manager opens on its own behalf. The caller's permission to read
+  // the path has already been checked.
+  ASSIGN_OR_RETURN(
+      std::shared_ptr<CachedFile> cached_file,
+      page_cache.Acquire(
+          fs.get(), path_on_mount_point,
+          [&]() -> StatusOr<std::shared_ptr<CachedFile>> {
+            size_t size_in_bytes;
+            ASSIGN_OR_RETURN(
+                auto file,
+                fs->OpenFile(path_on_mount_point, size_in_bytes, GetProcessId(),
+                             true, false, false, false));
+            return CachedFile::Create(std::move(file), size_in_bytes,
+                                      fs->GetOptionalOperationSize());
+          }));
 
   auto mmfile = std::make_unique<MemoryMappedFile>(
-      std::move(file), size_in_bytes, optimal_operation_size, sender);
+      page_cache, std::move(cached_file), sender);
   MemoryMappedFile* mmfile_ptr = mmfile.get();
 
   auto itr = open_memory_mapped_files_by_process_id.find(sender);
@@ -290,6 +351,13 @@ Status CheckFilePermissions(std::string_view path, bool& file_exists,
 }
 
 void CloseFile(::perception::ProcessId sender, File* file) {
+  auto writable_file = writable_files.find(file);
+  if (writable_file != writable_files.end()) {
+    page_cache.EndWriting(writable_file->second.first,
+                          writable_file->second.second);
+    writable_files.erase(writable_file);
+  }
+
   auto itr = open_files_by_process_id.find(sender);
   if (itr == open_files_by_process_id.end()) {
     std::cout << "CloseFile() called but something went wrong as " << sender
@@ -519,5 +587,11 @@ Status DeleteFileOrDirectory(std::string_view path,
     fs = mount_point_itr->second;
   }
 
-  return fs->DeleteFileOrDirectory(path_on_mount_point, sender);
+  RETURN_ON_ERROR(fs->DeleteFileOrDirectory(path_on_mount_point, sender));
+  page_cache.Invalidate(fs.get(), path_on_mount_point);
+  return Status::OK;
+}
+
+PageCacheStatistics GetPageCacheStatistics() {
+  return page_cache.GetStatistics();
 }
@@ -58,5 +58,7 @@ Status DeleteFileOrDirectory(std::string_view path,
 
 StatusOr<std::string> ReadLink(std::string_view path);
 
+::perception::PageCacheStatistics GetPageCacheStatistics();
+
 void ForEachMountedFileSystem(
     const std::function<void(std::string_view)>& on_each);
\ No newline at end of file
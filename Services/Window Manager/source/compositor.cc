@@ -18,6 +18,7 @@
 #include <iostream>
 
 #include "compositor_quad_tree.h"
+#include "damage_region.h"
 #include "highlighter.h"
 #include "mouse.h"
 #include "perception/devices/graphics_device.h"
@@ -44,13 +45,19 @@ uint32 background_color = 0xFF4E98FF;
 
 namespace {
 
-bool has_invalidated_area;
-Rectangle invalidated_area;
+// The areas of the screen to redraw on the next DrawScreen().
+DamageRegion damaged_areas;
 
 CompositorQuadTree quad_tree;
 
 int z_index;
 
+// Reused between frames, so that once they have grown to fit, composing a frame
+// doesn't allocate.
+std::vector<Rectangle> draw_areas;
+std::vector<QuadRectangle*> alpha_blended_quads;
+std::vector<graphics::Rectangle> frame_damaged_areas;
+
 }  // namespace
 
 namespace {
@@ -74,54 +81,43 @@ void AddAlphaBlendedRectangle(
 }
 
 void PopulateCommandsForRectangle(QuadRectangle& rectangle,
-                                  std::vector<graphics::Command>& commands,
                                   size_t& last_texture, bool alpha_blend) {
   if (rectangle.IsSolidColor()) {
     // Draw a solid color.
-    auto& command = commands.emplace_back();
+    auto& command = AddDrawCommand();
     command.type = graphics::Command::Type::FILL_RECTANGLE;
-
-    command.fill_rectangle_parameters =
-        std::make_shared<graphics::FillRectangleParameters>();
-    command.fill_rectangle_parameters->destination = {
-        static_cast<uint32>(rectangle.bounds.MinX()),
-        static_cast<uint32>(rectangle.bounds.MinY())};
-    command.fill_rectangle_parameters->size = {
-        static_cast<uint32>(rectangle.bounds.Width()),
-        static_cast<uint32>(rectangle.bounds.Height())};
-    command.fill_rectangle_parameters->color = rectangle.color;
+    command.destination_left = static_cast<uint32>(rectangle.bounds.MinX());
+    command.destination_top = static_cast<uint32>(rectangle.bounds.MinY());
+    command.width = static_cast<uint32>(rectangle.bounds.Width());
+    command.height = static_cast<uint32>(rectangle.bounds.Height());
+    command.color = rectangle.color;
   } else {
     // Copy the texture.
     if (rectangle.texture_id != last_texture) {
       // Swap over to this texture being the source texture.
-      auto& command = commands.emplace_back();
+      auto& command = AddDrawCommand();
       command.type = graphics::Command::Type::SET_SOURCE_TEXTURE;
-      command.texture_reference =
-          std::make_shared<graphics::TextureReference>(rectangle.texture_id);
+      command.texture_id = rectangle.texture_id;
       last_texture = rectangle.texture_id;
     }
 
     // Copy over this part of the texture.
     {
-      auto& command = commands.emplace_back();
+      auto& command = AddDrawCommand();
       command.type = alpha_blend
                          ? graphics::Command::Type::
                                COPY_PART_OF_A_TEXTURE_WITH_ALPHA_BLENDING
                          : graphics::Command::Type::COPY_PART_OF_A_TEXTURE;
-      command.copy_part_of_texture_parameters =
-          std::make_shared<graphics::CopyPartOfTextureParameters>();
       int32 src_x =
           std::max(0, static_cast<int>(std::round(rectangle.texture_offset.x)));
       int32 src_y =
           std::max(0, static_cast<int>(std::round(rectangle.texture_offset.y)));
-      command.copy_part_of_texture_parameters->source = {
-          static_cast<uint32>(src_x), static_cast<uint32>(src_y)};
-      command.copy_part_of_texture_parameters->destination = {
-          static_cast<uint32>(rectangle.bounds.MinX()),
-          static_cast<uint32>(rectangle.bounds.MinY())};
-      command.copy_part_of_texture_parameters->size = {
-          static_cast<uint32>(rectangle.bounds.Width()),
-          static_cast<uint32>(rectangle.bounds.Height())};
+      command.source_left = static_cast<uint32>(src_x);
+      command.source_top = static_cast<uint32>(src_y);
+      command.destination_left = static_cast<uint32>(rectangle.bounds.MinX());
+      command.destination_top = static_cast<uint32>(rectangle.bounds.MinY());
+      command.width = static_cast<uint32>(rectangle.bounds.Width());
+      command.height = static_cast<uint32>(rectangle.bounds.Height());
     }
   }
 }
@@ -149,94 +145,79 @@ void UpdateBackgroundColor() {
 }
 
 void InitializeCompositor() {
-  has_invalidated_area = false;
+  damaged_areas.Clear();
   z_index = 0;
 }
 
 void InvalidateScreen(const Rectangle& screen_area) {
-  Rectangle rounded_area = screen_area.RoundedToLargestWholeInteger();
-  if (has_invalidated_area) {
-    invalidated_area = invalidated_area.Union(rounded_area);
-  } else {
-    invalidated_area = rounded_area;
-    has_invalidated_area = true;
-  }
+  damaged_areas.Add(screen_area);
 }
 
 void DrawScreen() {
-  if (!has_invalidated_area) return;
+  if (damaged_areas.IsEmpty()) return;
 
   SleepUntilWeAreReadyToStartDrawing();
 
-  has_invalidated_area = false;
-
   Rectangle screen_rectangle{.origin = {0, 0}, .size = GetScreenSize()};
-  auto opt_draw_area = invalidated_area.Intersection(screen_rectangle);
-  if (!opt_draw_area) return;
-  Rectangle& draw_area = *opt_draw_area;
-
-  if (draw_area.Width() <= 0 || draw_area.Height() <= 0) return;
-  DrawBackground(draw_area);
-
-  (void)Window::ForEachBackToFrontWindow([&](Window& window) {
-    window.Draw(draw_area);
-    return false;
-  });
-  // Prep the overlays for drawing, which will mark which areas need to be
-  // drawn to the window manager's texture and not directly to the screen.
-  DrawHighlighter(draw_area);
-  DrawToasts(draw_area);
-  DrawMouse(draw_area);
+  damaged_areas.ClipTo(screen_rectangle);
+  draw_areas.assign(damaged_areas.Rectangles().begin(),
+                    damaged_areas.Rectangles().end());
+  damaged_areas.Clear();
+  if (draw_areas.empty()) return;
+
+  // The damaged areas are disjoint, so each one is composited into the same
+  // quad tree without anything being drawn twice.
+  for (const Rectangle& draw_area : draw_areas) {
+    DrawBackground(draw_area);
+
+    (void)Window::ForEachBackToFrontWindow([&](Window& window) {
+      window.Draw(draw_area);
+      return false;
+    });
+    // Prep the overlays for drawing, which will mark which areas need to be
+    // drawn to the window manager's texture and not directly to the screen.
+    DrawHighlighter(draw_area);
+    DrawToasts(draw_area);
+    DrawMouse(draw_area);
+  }
 
-  // There are 3 stages of commands to construct:
+  // There are 3 stages of commands to construct, which are written straight
+  // into the frame in order by walking the quad tree once per stage:
   // (1) Draw any rectangles into the WM Texture.
   //     First opaque rectangle, then z-index sorted alpha blended rectangles.
-  // (3) Draw WM textures into framebuffer.
-  // (4) Draw rectangles directly into framebuffer.
-
-  std::vector<graphics::Command> draw_into_wm_texture_commands;
-  std::vector<graphics::Command> draw_wm_into_framebuffer_commands;
-  std::vector<graphics::Command> draw_into_framebuffer_commands;
-
-  std::vector<QuadRectangle*> alpha_blended_quads;
+  // (2) Draw WM textures into framebuffer.
+  // (3) Draw rectangles directly into framebuffer.
+  BeginDrawCommands();
+  alpha_blended_quads.clear();
 
+  // (1) Draw into the window manager's texture.
+  bool drawing_into_window_manager = false;
   size_t texture_drawing_into_window_manager = 0;
-  size_t texture_drawing_into_framebuffer = 0;
+  auto draw_into_window_manager = [&](QuadRectangle* rectangle,
+                                      bool alpha_blend) {
+    if (!drawing_into_window_manager) {
+      // Set destination to be the wm texture.
+      auto& command = AddDrawCommand();
+      command.type = graphics::Command::Type::SET_DESTINATION_TEXTURE;
+      command.texture_id = GetWindowManagerTextureId();
+      drawing_into_window_manager = true;
+    }
+    PopulateCommandsForRectangle(*rectangle,
+                                 texture_drawing_into_window_manager,
+                                 alpha_blend);
+  };
 
   quad_tree.ForEachItem([&](QuadRectangle* rectangle) {
     switch (rectangle->stage) {
-      case QuadRectangleStage::OPAQUE_TO_SCREEN:
-        // Draw directly onto the screen.
-        PopulateCommandsForRectangle(*rectangle, draw_into_framebuffer_commands,
-                                     texture_drawing_into_framebuffer,
-                                     /*alpha_blend=*/false);
+      case QuadRectangleStage::OPAQUE_TO_WINDOW_MANAGER:
+        draw_into_window_manager(rectangle, /*alpha_blend=*/false);
         break;
-      case QuadRectangleStage::OPAQUE_TO_WINDOW_MANAGER: {
-        // Draw into the window manager.
-        PopulateCommandsForRectangle(*rectangle, draw_into_wm_texture_commands,
-                                     texture_drawing_into_window_manager,
-                                     /*alpha_blend=*/false);
-
-        // Copy this area into the frame buffer.
-        auto& command = draw_wm_into_framebuffer_commands.emplace_back();
-        command.type = graphics::Command::Type::COPY_PART_OF_A_TEXTURE;
-        command.copy_part_of_texture_parameters =
-            std::make_shared<graphics::CopyPartOfTextureParameters>();
-        command.copy_part_of_texture_parameters->source = {
-            static_cast<uint32>(rectangle->bounds.MinX()),
-            static_cast<uint32>(rectangle->bounds.MinY())};
-        command.copy_part_of_texture_parameters->destination = {
-            static_cast<uint32>(rectangle->bounds.MinX()),
-            static_cast<uint32>(rectangle->bounds.MinY())};
-        command.copy_part_of_texture_parameters->size = {
-            static_cast<uint32>(rectangle->bounds.Width()),
-            static_cast<uint32>(rectangle->bounds.Height())};
-        break;
-      }
       case QuadRectangleStage::ALPHA_TO_WINDOW_MANAGER:
         // Sort by z-index and draw later.
         alpha_blended_quads.push_back(rectangle);
-        return;
+        break;
+      default:
+        break;
     }
   });
 
@@ -249,51 +230,60 @@ void DrawScreen() {
     // Because the backmost content is always opaque (if there are no windows
     // open then it is the background color), the command has already been
     // populated to copy the window manager's texture into the command buffer.
-    PopulateCommandsForRectangle(*rectangle, draw_into_wm_texture_commands,
-                                 texture_drawing_into_window_manager,
-                                 /*alpha_blend=*/true);
-  }
-
-  // Merge all the draw commands together.
-  graphics::Commands commands;
-  commands.commands.reserve(draw_into_wm_texture_commands.size() +
-                            draw_wm_into_framebuffer_commands.size() +
-                            draw_into_framebuffer_commands.size());
-  if (!draw_into_wm_texture_commands.empty()) {
-    // There are things to draw into the window manager's texture.
-
-    // Set destination to be the wm texture.
-    auto& command = commands.commands.emplace_back();
-    command.type = graphics::Command::Type::SET_DESTINATION_TEXTURE;
-    command.texture_reference = std::make_shared<graphics::TextureReference>(
-        GetWindowManagerTextureId());
-
-    for (auto& c : draw_into_wm_texture_commands)
-      commands.commands.push_back(std::move(c));
+    draw_into_window_manager(rectangle, /*alpha_blend=*/true);
   }
 
   // Set destination to frame buffer.
   {
-    auto& command = commands.commands.emplace_back();
+    auto& command = AddDrawCommand();
     command.type = graphics::Command::Type::SET_DESTINATION_TEXTURE;
-    command.texture_reference =
-        std::make_shared<graphics::TextureReference>(0);  // The screen.
+    command.texture_id = 0;  // The screen.
   }
 
-  if (!draw_wm_into_framebuffer_commands.empty()) {
-    auto& command = commands.commands.emplace_back();
-    command.type = graphics::Command::Type::SET_SOURCE_TEXTURE;
-    command.texture_reference = std::make_shared<graphics::TextureReference>(
-        GetWindowManagerTextureId());
+  // (2) Copy the window manager's texture into the frame buffer.
+  bool copying_from_window_manager = false;
+  quad_tree.ForEachItem([&](QuadRectangle* rectangle) {
+    if (rectangle->stage != QuadRectangleStage::OPAQUE_TO_WINDOW_MANAGER)
+      return;
 
-    for (auto& c : draw_wm_into_framebuffer_commands)
-      commands.commands.push_back(std::move(c));
-  }
+    if (!copying_from_window_manager) {
+      auto& command = AddDrawCommand();
+      command.type = graphics::Command::Type::SET_SOURCE_TEXTURE;
+      command.texture_id = GetWindowManagerTextureId();
+      copying_from_window_manager = true;
+    }
+
+    // Copy this area into the frame buffer.
+    auto& command = AddDrawCommand();
+    command.type = graphics::Command::Type::COPY_PART_OF_A_TEXTURE;
+    command.source_left = static_cast<uint32>(rectangle->bounds.MinX());
+    command.source_top = static_cast<uint32>(rectangle->bounds.MinY());
+    command.destination_left = command.source_left;
+    command.destination_top = command.source_top;
+    command.width = static_cast<uint32>(rectangle->bounds.Width());
+    command.height = static_cast<uint32>(rectangle->bounds.Height());
+  });
 
-  for (auto& c : draw_into_framebuffer_commands)
-    commands.commands.push_back(std::move(c));
+  // (3) Draw directly onto the screen.
+  size_t texture_drawing_into_framebuffer = 0;
+  quad_tree.ForEachItem([&](QuadRectangle* rectangle) {
+    if (rectangle->stage == QuadRectangleStage::OPAQUE_TO_SCREEN) {
+      PopulateCommandsForRectangle(*rectangle, texture_drawing_into_framebuffer,
+                                   /*alpha_blend=*/false);
+    }
+  });
+
+  // Tell the driver which areas changed, so it only presents those.
+  frame_damaged_areas.clear();
+  for (const Rectangle& draw_area : draw_areas) {
+    auto& damaged_area = frame_damaged_areas.emplace_back();
+    damaged_area.origin = {static_cast<uint32>(draw_area.MinX()),
+                           static_cast<uint32>(draw_area.MinY())};
+    damaged_area.size = {static_cast<uint32>(draw_area.Width()),
+                         static_cast<uint32>(draw_area.Height())};
+  }
 
-  RunDrawCommands(std::move(commands));
+  RunDrawCommands(frame_damaged_areas);
 
   z_index = 0;
 
@@ -14,6 +14,9 @@
 
 #include "compositor.h"
 
+#include <iostream>
+#include <vector>
+
 #include "perception/devices/graphics_device.h"
 #include "perception/serialization/text_serializer.h"
 #include "perception/ui/point.h"
@@ -219,4 +222,53 @@ TEST(CompositorCopyAlphaBlendedTexture) {
   }
 }
 
+TEST(CompositorDamageBenchmark) {
+  Window::UnfocusAllWindows();
+  InitializeScreen();
+  InitializeCompositor();
+
+  // Typical frames, as the areas invalidated during them.
+  struct Scenario {
+    const char* name;
+    std::vector<Rectangle> invalidated_areas;
+  };
+  std::vector<Scenario> scenarios = {
+      {"Cursor blink and clock",
+       {Rectangle{Point{40.0f, 60.0f}, {2.0f, 16.0f}},
+        Rectangle{Point{1840.0f, 1056.0f}, {70.0f, 20.0f}}}},
+      {"Mouse move",
+       {Rectangle{Point{500.0f, 400.0f}, {11.0f, 17.0f}},
+        Rectangle{Point{506.0f, 403.0f}, {11.0f, 17.0f}}}},
+      {"Typing in two windows",
+       {Rectangle{Point{100.0f, 120.0f}, {8.0f, 16.0f}},
+        Rectangle{Point{1300.0f, 700.0f}, {8.0f, 16.0f}}}},
+      {"Window drag",
+       {Rectangle{Point{300.0f, 200.0f}, {640.0f, 480.0f}},
+        Rectangle{Point{340.0f, 230.0f}, {640.0f, 480.0f}}}},
+      {"Full screen", {Rectangle{Point{0.0f, 0.0f}, {1920.0f, 1080.0f}}}}};
+
+  std::cout << "Pixels touched per frame:" << std::endl;
+  for (const Scenario& scenario : scenarios) {
+    Rectangle bounding_area = scenario.invalidated_areas.front();
+    for (const Rectangle& area : scenario.invalidated_areas) {
+      bounding_area = bounding_area.Union(area);
+      InvalidateScreen(area);
+    }
+    DrawScreen();
+
+    size_t pixels_touched = 0;
+    for (const auto& damaged_area : GetLastRunDrawCommands().damaged_areas)
+      pixels_touched += static_cast<size_t>(damaged_area.size.width) *
+                        damaged_area.size.height;
+    size_t bounding_pixels = static_cast<size_t>(bounding_area.Width()) *
+                             static_cast<size_t>(bounding_area.Height());
+    std::cout << "  " << scenario.name << ": " << pixels_touched
+              << " (bounding rectangle: " << bounding_pixels << ")"
+              << std::endl;
+
+    EXPECT(true, pixels_touched > 0);
+    EXPECT(true, pixels_touched <= bounding_pixels);
+  }
+}
+
 }  // namespace
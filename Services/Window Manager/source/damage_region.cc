@@ -0,0 +1,159 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "damage_region.h"
+
+#include <algorithm>
+#include <limits>
+
+using ::perception::ui::Rectangle;
+
+namespace {
+
+// Returns the number of pixels in a rectangle.
+float AreaOf(const Rectangle& rectangle) {
+  return rectangle.Width() * rectangle.Height();
+}
+
+// Returns the number of pixels that drawing the bounding rectangle of two
+// rectangles draws that neither of them needed.
+float WastedPixels(const Rectangle& a, const Rectangle& b) {
+  float overlap = 0.0f;
+  if (auto intersection = a.Intersection(b)) overlap = AreaOf(*intersection);
+  return AreaOf(a.Union(b)) - (AreaOf(a) + AreaOf(b) - overlap);
+}
+
+// Appends the up to 4 parts of `area` that are outside of `hole` to `parts`.
+// The rectangles must overlap.
+void AddPartsOutside(const Rectangle& area, const Rectangle& hole,
+                     std::vector<Rectangle>& parts) {
+  // Above and below take the full width.
+  if (area.MinY() < hole.MinY()) {
+    parts.push_back(Rectangle::FromMinMaxPoints(
+        {.x = area.MinX(), .y = area.MinY()},
+        {.x = area.MaxX(), .y = hole.MinY()}));
+  }
+  if (area.MaxY() > hole.MaxY()) {
+    parts.push_back(Rectangle::FromMinMaxPoints(
+        {.x = area.MinX(), .y = hole.MaxY()},
+        {.x = area.MaxX(), .y = area.MaxY()}));
+  }
+
+  // Left and right take the height in between.
+  float min_y = std::max(area.MinY(), hole.MinY());
+  float max_y = std::min(area.MaxY(), hole.MaxY());
+  if (area.MinX() < hole.MinX()) {
+    parts.push_back(Rectangle::FromMinMaxPoints(
+        {.x = area.MinX(), .y = min_y}, {.x = hole.MinX(), .y = max_y}));
+  }
+  if (area.MaxX() > hole.MaxX()) {
+    parts.push_back(Rectangle::FromMinMaxPoints(
+        {.x = hole.MaxX(), .y = min_y}, {.x = area.MaxX(), .y = max_y}));
+  }
+}
+
+}  // namespace
+
+DamageRegion::DamageRegion(size_t max_rectangles)
+    : max_rectangles_(std::max<size_t>(1, max_rectangles)) {}
+
+void DamageRegion::Add(const Rectangle& area) {
+  Rectangle rounded = area.RoundedToLargestWholeInteger();
+  if (rounded.Width() <= 0 || rounded.Height() <= 0) return;
+
+  AddRounded(rounded);
+  while (rectangles_.size() > max_rectangles_) MergeCheapestPair();
+}
+
+void DamageRegion::ClipTo(const Rectangle& bounds) {
+  std::vector<Rectangle> clipped;
+  clipped.reserve(rectangles_.size());
+  for (const Rectangle& rectangle : rectangles_) {
+    auto intersection = rectangle.Intersection(bounds);
+    if (intersection && intersection->Width() > 0 &&
+        intersection->Height() > 0)
+      clipped.push_back(*intersection);
+  }
+  rectangles_ = std::move(clipped);
+}
+
+float DamageRegion::Area() const {
+  float area = 0.0f;
+  for (const Rectangle& rectangle : rectangles_) area += AreaOf(rectangle);
+  return area;
+}
+
+void DamageRegion::AddRounded(const Rectangle& area) {
+  std::vector<Rectangle> pending = {area};
+  while (!pending.empty()) {
+    Rectangle rectangle = pending.back();
+    pending.pop_back();
+
+    bool handled = false;
+    for (size_t i = 0; i < rectangles_.size() && !handled; i++) {
+      const Rectangle& existing = rectangles_[i];
+      if (existing.Contains(rectangle)) {
+        // Already damaged.
+        handled = true;
+      } else if (WastedPixels(existing, rectangle) <=
+                 kRectangleOverheadInPixels) {
+        // Cheaper as one rectangle. The merged rectangle might now overlap
+        // others, so it goes back through the list.
+        pending.push_back(existing.Union(rectangle));
+        rectangles_.erase(rectangles_.begin() + i);
+        handled = true;
+      } else if (existing.Intersects(rectangle)) {
+        // Cheaper apart, so only keep the parts that aren't already damaged.
+        AddPartsOutside(rectangle, existing, pending);
+        handled = true;
+      }
+    }
+    if (!handled) rectangles_.push_back(rectangle);
+  }
+}
+
+void DamageRegion::MergeCheapestPair() {
+  size_t best_a = 0, best_b = 1;
+  float best_waste = std::numeric_limits<float>::max();
+  for (size_t a = 0; a < rectangles_.size(); a++) {
+    for (size_t b = a + 1; b < rectangles_.size(); b++) {
+      float waste = WastedPixels(rectangles_[a], rectangles_[b]);
+      if (waste < best_waste) {
+        best_waste = waste;
+        best_a = a;
+        best_b = b;
+      }
+    }
+  }
+
+  Rectangle merged = rectangles_[best_a].Union(rectangles_[best_b]);
+  rectangles_.erase(rectangles_.begin() + best_b);
+  rectangles_.erase(rectangles_.begin() + best_a);
+
+  // Swallow anything the merged rectangle now overlaps, rather than splitting
+  // it, so that the list always gets shorter.
+  bool swallowed = true;
+  while (swallowed) {
+    swallowed = false;
+    for (size_t i = 0; i < rectangles_.size(); i++) {
+      if (merged.Intersects(rectangles_[i])) {
+        merged = merged.Union(rectangles_[i]);
+        rectangles_.erase(rectangles_.begin() + i);
+        swallowed = true;
+        break;
+      }
+    }
+  }
+  rectangles_.push_back(merged);
+}
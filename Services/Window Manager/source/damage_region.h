@@ -0,0 +1,66 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <vector>
+
+#include "perception/ui/rectangle.h"
+
+// The areas of the screen that need to be redrawn, as a short list of
+// disjoint rectangles.
+//
+// Each rectangle costs a fixed overhead to draw and present on top of its
+// pixels, so two areas are merged into their bounding rectangle only when that
+// draws fewer extra pixels than the overhead of keeping them apart. Areas that
+// overlap without merging are split so the list stays disjoint, and no pixel
+// is drawn twice. Once there are more than `max_rectangles`, the pair that
+// wastes the fewest pixels is merged.
+class DamageRegion {
+ public:
+  // The overhead of each rectangle, in pixels.
+  static constexpr float kRectangleOverheadInPixels = 64.0f * 64.0f;
+
+  explicit DamageRegion(size_t max_rectangles = 8);
+
+  // Adds an area to the region. The area is rounded out to whole pixels.
+  void Add(const ::perception::ui::Rectangle& area);
+
+  // Clips the region to the bounds, such as the screen.
+  void ClipTo(const ::perception::ui::Rectangle& bounds);
+
+  // Empties the region.
+  void Clear() { rectangles_.clear(); }
+
+  // Returns whether there is nothing to redraw.
+  bool IsEmpty() const { return rectangles_.empty(); }
+
+  // Returns the disjoint rectangles that make up the region.
+  const std::vector<::perception::ui::Rectangle>& Rectangles() const {
+    return rectangles_;
+  }
+
+  // Returns the number of pixels in the region.
+  float Area() const;
+
+ private:
+  // Adds a rectangle that has already been rounded.
+  void AddRounded(const ::perception::ui::Rectangle& area);
+
+  // Merges the pair of rectangles that wastes the fewest pixels.
+  void MergeCheapestPair();
+
+  size_t max_rectangles_;
+  std::vector<::perception::ui::Rectangle> rectangles_;
+};
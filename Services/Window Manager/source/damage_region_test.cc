@@ -0,0 +1,121 @@
+// Copyright 2026 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "damage_region.h"
+
+#include "perception/ui/point.h"
+#include "perception/ui/rectangle.h"
+#include "testing.h"
+
+namespace {
+
+using ::perception::ui::Point;
+using ::perception::ui::Rectangle;
+
+// Returns whether no two rectangles in the region overlap.
+bool IsDisjoint(const DamageRegion& region) {
+  const auto& rectangles = region.Rectangles();
+  for (size_t a = 0; a < rectangles.size(); a++) {
+    for (size_t b = a + 1; b < rectangles.size(); b++) {
+      if (rectangles[a].Intersects(rectangles[b])) return false;
+    }
+  }
+  return true;
+}
+
+TEST(DamageRegionRoundsOutToWholePixels) {
+  DamageRegion region;
+  EXPECT(true, region.IsEmpty());
+
+  region.Add(Rectangle{Point{0.5f, 0.5f}, {1.0f, 1.0f}});
+  ASSERT((size_t)1, region.Rectangles().size());
+  EXPECT(Rectangle(Rectangle{Point{0.0f, 0.0f}, {2.0f, 2.0f}}),
+         region.Rectangles()[0]);
+
+  // Empty areas are ignored.
+  region.Add(Rectangle{Point{50.0f, 50.0f}, {0.0f, 10.0f}});
+  EXPECT((size_t)1, region.Rectangles().size());
+
+  region.Clear();
+  EXPECT(true, region.IsEmpty());
+}
+
+TEST(DamageRegionMergesNearbyAreas) {
+  DamageRegion region;
+
+  // Side by side, so the bounding rectangle wastes nothing.
+  region.Add(Rectangle{Point{0.0f, 0.0f}, {10.0f, 10.0f}});
+  region.Add(Rectangle{Point{10.0f, 0.0f}, {10.0f, 10.0f}});
+  ASSERT((size_t)1, region.Rectangles().size());
+  EXPECT(Rectangle(Rectangle{Point{0.0f, 0.0f}, {20.0f, 10.0f}}),
+         region.Rectangles()[0]);
+
+  // Already covered.
+  region.Add(Rectangle{Point{5.0f, 2.0f}, {5.0f, 5.0f}});
+  EXPECT((size_t)1, region.Rectangles().size());
+  EXPECT(200.0f, region.Area());
+}
+
+TEST(DamageRegionKeepsDistantAreasApart) {
+  DamageRegion region;
+
+  // A blinking cursor and a clock in opposite corners of the screen.
+  region.Add(Rectangle{Point{10.0f, 10.0f}, {2.0f, 16.0f}});
+  region.Add(Rectangle{Point{1000.0f, 740.0f}, {60.0f, 20.0f}});
+  EXPECT((size_t)2, region.Rectangles().size());
+  EXPECT(32.0f + 1200.0f, region.Area());
+}
+
+TEST(DamageRegionSplitsOverlappingAreas) {
+  DamageRegion region;
+
+  // Merging would draw 20,000 pixels that don't need drawing.
+  region.Add(Rectangle{Point{0.0f, 0.0f}, {200.0f, 200.0f}});
+  region.Add(Rectangle{Point{100.0f, 100.0f}, {200.0f, 200.0f}});
+  EXPECT(true, region.Rectangles().size() > 1);
+  EXPECT(true, IsDisjoint(region));
+  EXPECT(70000.0f, region.Area());
+}
+
+TEST(DamageRegionIsBounded) {
+  DamageRegion region(/*max_rectangles=*/3);
+
+  for (int i = 0; i < 10; i++) {
+    region.Add(Rectangle{Point{i * 200.0f, (i % 2) * 300.0f}, {10.0f, 10.0f}});
+    EXPECT(true, region.Rectangles().size() <= 3);
+    EXPECT(true, IsDisjoint(region));
+  }
+
+  // Everything that was added is still covered.
+  for (int i = 0; i < 10; i++) {
+    Rectangle area{Point{i * 200.0f, (i % 2) * 300.0f}, {10.0f, 10.0f}};
+    bool covered = false;
+    for (const Rectangle& rectangle : region.Rectangles())
+      covered |= rectangle.Contains(area);
+    EXPECT(true, covered);
+  }
+}
+
+TEST(DamageRegionClipsToBounds) {
+  DamageRegion region;
+  region.Add(Rectangle{Point{-10.0f, -10.0f}, {20.0f, 20.0f}});
+  region.Add(Rectangle{Point{500.0f, 500.0f}, {10.0f, 10.0f}});
+
+  region.ClipTo(Rectangle{Point{0.0f, 0.0f}, {100.0f, 100.0f}});
+  ASSERT((size_t)1, region.Rectangles().size());
+  EXPECT(Rectangle(Rectangle{Point{0.0f, 0.0f}, {10.0f, 10.0f}}),
+         region.Rectangles()[0]);
+}
+
+}  // namespace
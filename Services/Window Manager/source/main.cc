@@ -75,6 +75,9 @@ int main(int argc, char *argv[]) {
     // Sleep until we have messages, then process them.
     WaitForMessagesThenReturn();
 
+    // Send the mouse motion that was coalesced while processing the messages.
+    FlushMouseMotion();
+
     // Redraw the screen once we are done processing all messages.
     DrawScreen();
   }
@@ -50,6 +50,21 @@ Point mouse_position;
 Rectangle last_mouse_bounds;
 std::weak_ptr<Window> pressed_window;
 
+// Movement for the captive window that will be sent at the end of the frame.
+// Its history is kept between frames so its memory is reused.
+bool has_pending_captive_motion = false;
+RelativeMousePositionEvent pending_captive_motion;
+
+// Sends the movement waiting to be sent to the captive window, if there is
+// any.
+void SendPendingCaptiveMotion() {
+  if (!has_pending_captive_motion) return;
+  has_pending_captive_motion = false;
+  if (auto captive_win = Window::GetCaptiveMouseWindow())
+    captive_win->GetMouseListener().MouseMove(pending_captive_motion, nullptr);
+  pending_captive_motion.history.clear();
+}
+
 const char* kPointerSprite =
     "BB.........\n"
     "BGB........\n"
@@ -270,7 +285,21 @@ class MyMouseListener : public MouseListener::Server {
   Status MouseMove(const RelativeMousePositionEvent& message) override {
     if (auto captive_win = Window::GetCaptiveMouseWindow()) {
       if (captive_win->IsVisible() && captive_win->IsFocused()) {
-        captive_win->GetMouseListener().MouseMove(message, nullptr);
+        if (!has_pending_captive_motion) {
+          has_pending_captive_motion = true;
+          pending_captive_motion.delta_x = 0.0f;
+          pending_captive_motion.delta_y = 0.0f;
+        }
+        pending_captive_motion.delta_x += message.delta_x;
+        pending_captive_motion.delta_y += message.delta_y;
+        if (captive_win->WantsMouseHistory()) {
+          RelativeMousePositionEvent& movement =
+              pending_captive_motion.history.emplace_back();
+          movement.delta_x = message.delta_x;
+          movement.delta_y = message.delta_y;
+          if (pending_captive_motion.history.size() >= kMaxMouseHistoryLength)
+            SendPendingCaptiveMotion();
+        }
         return Status::OK;
       }
     }
@@ -332,6 +361,7 @@ void ProcessMouseButtonEvent(
     const ::perception::devices::MouseButtonEvent& message) {
   if (auto captive_win = Window::GetCaptiveMouseWindow()) {
     if (captive_win->IsVisible() && captive_win->IsFocused()) {
+      FlushMouseMotion();
       captive_win->GetMouseListener().MouseButton(message, nullptr);
       return;
     }
@@ -365,6 +395,11 @@ void ProcessMouseButtonEvent(
   }
 }
 
+void FlushMouseMotion() {
+  SendPendingCaptiveMotion();
+  Window::SendPendingMouseHover();
+}
+
 void InitializeMouse() {
   mouse_position = GetScreenSize().ToPoint();
   for (int i = 0; i < 2; i++) mouse_position[i] /= 2.0f;
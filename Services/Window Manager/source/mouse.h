@@ -14,6 +14,8 @@
 
 #pragma once
 
+#include <cstddef>
+
 #include "perception/devices/graphics_device.h"
 #include "perception/devices/mouse_listener.h"
 #include "perception/ui/point.h"
@@ -35,6 +37,16 @@ void SetMousePosition(const ::perception::ui::Point& position);
 void ProcessMouseButtonEvent(
     const ::perception::devices::MouseButtonEvent& message);
 
+// Mouse motion is coalesced into at most one event per window per frame,
+// rather than sending a message for every report from the mouse. This sends
+// the motion that's waiting to be sent. It's called at the end of each frame,
+// and before other mouse events so that they stay in order.
+void FlushMouseMotion();
+
+// The most positions or movements a coalesced event's history holds. An event
+// whose history fills up is sent straight away, and a new one is started.
+constexpr size_t kMaxMouseHistoryLength = 64;
+
 // Preps the overlays for drawing, which will mark which areas need to be drawn
 // to the window manager's texture and not directly to the screen.
 void DrawMouse(const ::perception::ui::Rectangle& draw_area);
@@ -14,15 +14,65 @@
 
 #include "mouse.h"
 
+#include <string>
+#include <vector>
+
+#include "perception/devices/mouse_listener.h"
+#include "perception/scheduler.h"
 #include "perception/ui/point.h"
 #include "perception/ui/rectangle.h"
+#include "perception/window/window_manager.h"
 #include "screen.h"
+#include "status.h"
 #include "testing.h"
+#include "window.h"
 
 namespace {
 
+using ::perception::FinishAnyPendingWork;
+using ::perception::devices::MouseButton;
+using ::perception::devices::MouseClickEvent;
+using ::perception::devices::MouseListener;
+using ::perception::devices::MousePositionEvent;
 using ::perception::ui::Point;
 using ::perception::ui::Rectangle;
+using ::perception::window::CreateWindowRequest;
+
+// Records the mouse events a window is sent, in the order they arrive.
+class RecordingMouseListener : public MouseListener::Server {
+ public:
+  std::vector<std::string> events;
+  std::vector<MousePositionEvent> hovers;
+
+  Status MouseClick(const MouseClickEvent& message) override {
+    events.push_back("Click");
+    return Status::OK;
+  }
+
+  Status MouseEnter() override {
+    events.push_back("Enter");
+    return Status::OK;
+  }
+
+  Status MouseLeave() override {
+    events.push_back("Leave");
+    return Status::OK;
+  }
+
+  Status MouseHover(const MousePositionEvent& message) override {
+    events.push_back("Hover");
+    hovers.push_back(message);
+    return Status::OK;
+  }
+};
+
+// Presses or releases the left mouse button.
+void PressLeftButton(bool is_pressed_down) {
+  ::perception::devices::MouseButtonEvent message;
+  message.button = MouseButton::Left;
+  message.is_pressed_down = is_pressed_down;
+  ProcessMouseButtonEvent(message);
+}
 
 TEST(MouseInitializationAndPosition) {
   InitializeScreen();
@@ -52,4 +102,99 @@ TEST(MouseDrawingAndInvalidation) {
   DrawMouse(outside_area);
 }
 
+TEST(MouseMotionIsCoalescedAndSentBeforeOtherEvents) {
+  Window::UnfocusAllWindows();
+  InitializeScreen();
+  InitializeMouse();
+
+  RecordingMouseListener listener;
+  CreateWindowRequest request;
+  request.window = ::perception::window::BaseWindow::Client(1, 105);
+  request.title = "Coalescing Test";
+  request.mouse_listener = MouseListener::Client(listener);
+  request.add_title_bar = false;
+  request.wants_mouse_history = true;
+  auto window = *Window::CreateWindow(request);
+  window->SetTextureId(1);
+  Point origin = window->GetScreenArea().origin;
+  Point outside = origin + window->GetScreenArea().size.ToPoint() +
+                  Point{50.0f, 50.0f};
+
+  // Hovers are held until the end of the frame.
+  SetMousePosition(origin + Point{10.0f, 10.0f});
+  SetMousePosition(origin + Point{20.0f, 20.0f});
+  SetMousePosition(origin + Point{30.0f, 30.0f});
+  FinishAnyPendingWork();
+  ASSERT(1, (int)listener.events.size());
+  EXPECT("Enter", listener.events[0]);
+
+  // A click sends the hover first, carrying every position it stands for.
+  PressLeftButton(true);
+  FinishAnyPendingWork();
+  ASSERT(3, (int)listener.events.size());
+  EXPECT("Hover", listener.events[1]);
+  EXPECT("Click", listener.events[2]);
+  ASSERT(1, (int)listener.hovers.size());
+  EXPECT(30.0f, listener.hovers[0].x);
+  EXPECT(30.0f, listener.hovers[0].y);
+  ASSERT(3, (int)listener.hovers[0].history.size());
+  EXPECT(10.0f, listener.hovers[0].history[0].x);
+  EXPECT(30.0f, listener.hovers[0].history[2].x);
+  PressLeftButton(false);
+  FinishAnyPendingWork();
+
+  // Leaving sends the hover first.
+  listener.events.clear();
+  listener.hovers.clear();
+  SetMousePosition(origin + Point{40.0f, 40.0f});
+  SetMousePosition(outside);
+  FinishAnyPendingWork();
+  ASSERT(2, (int)listener.events.size());
+  EXPECT("Hover", listener.events[0]);
+  EXPECT("Leave", listener.events[1]);
+
+  // Nothing is left to send at the end of the frame.
+  FlushMouseMotion();
+  FinishAnyPendingWork();
+  EXPECT(2, (int)listener.events.size());
+
+  window->Close();
+}
+
+TEST(MouseHistoryIsCapped) {
+  Window::UnfocusAllWindows();
+  InitializeScreen();
+  InitializeMouse();
+
+  RecordingMouseListener listener;
+  CreateWindowRequest request;
+  request.window = ::perception::window::BaseWindow::Client(1, 106);
+  request.title = "History Test";
+  request.mouse_listener = MouseListener::Client(listener);
+  request.add_title_bar = false;
+  request.wants_mouse_history = true;
+  auto window = *Window::CreateWindow(request);
+  window->SetTextureId(1);
+  Point origin = window->GetScreenArea().origin;
+  Point outside = origin + window->GetScreenArea().size.ToPoint() +
+                  Point{50.0f, 50.0f};
+
+  // A full history is sent straight away, and the rest waits for the frame.
+  for (int i = 0; i <= (int)kMaxMouseHistoryLength; i++)
+    SetMousePosition(origin + Point{1.0f + i % 100, 1.0f + i / 100});
+  FinishAnyPendingWork();
+  ASSERT(1, (int)listener.hovers.size());
+  EXPECT((int)kMaxMouseHistoryLength,
+         (int)listener.hovers[0].history.size());
+
+  FlushMouseMotion();
+  FinishAnyPendingWork();
+  ASSERT(2, (int)listener.hovers.size());
+  EXPECT(1, (int)listener.hovers[1].history.size());
+
+  SetMousePosition(outside);
+  FlushMouseMotion();
+  window->Close();
+}
+
 }  // namespace
@@ -20,6 +20,7 @@
 #include "perception/fibers.h"
 #include "perception/processes.h"
 #include "perception/services.h"
+#include "perception/shared_memory.h"
 #include "perception/ui/size.h"
 
 using ::perception::Fiber;
@@ -41,6 +42,37 @@ std::shared_ptr<::perception::SharedMemory> window_manager_texture_buffer;
 bool screen_is_drawing;
 Fiber* fiber_waiting_on_screen_to_finish_drawing;
 
+#ifndef TEST
+// The size of the command ring shared with the graphics driver.
+constexpr size_t kCommandRingSizeInBytes = 256 * 1024;
+
+// Frames of commands are written into this ring and then the driver is told
+// to run them. Null if the driver doesn't support command buffers.
+std::shared_ptr<::perception::SharedMemory> command_ring;
+
+// The number of commands that fit in the ring.
+size_t command_ring_capacity;
+
+// Where the next frame starts in the ring.
+size_t command_ring_next_command;
+
+// Where the frame being built starts in the ring.
+size_t frame_first_command;
+
+// Reused between frames to tell the driver to run a frame.
+graphics::CommandBufferDoorbell command_ring_doorbell;
+#endif
+
+// The number of commands in the frame being built.
+size_t frame_command_count;
+
+// Whether the frame being built is in `unringed_frame_commands` rather than
+// the ring, because there's no ring or the frame didn't fit.
+bool frame_is_unringed;
+
+// The frame being built when it's not in the ring. Reused between frames.
+std::vector<graphics::PackedCommand> unringed_frame_commands;
+
 #ifndef TEST
 class GraphicsListenerServer
     : public ::perception::devices::GraphicsListener::Server {
@@ -105,12 +137,33 @@ void InitializeScreen() {
     window_manager_texture_buffer->Join();
   }
 
+  // Share a command ring with the driver, so frames don't need to be
+  // serialized.
+  graphics::CommandBufferParameters command_buffer_parameters;
+  command_buffer_parameters.buffer =
+      ::perception::SharedMemory::FromSize(kCommandRingSizeInBytes, 0);
+  if (command_buffer_parameters.buffer->Join() &&
+      graphics_device.SetCommandBuffer(command_buffer_parameters) ==
+          Status::OK) {
+    command_ring = command_buffer_parameters.buffer;
+    command_ring_capacity =
+        command_ring->GetSize() / sizeof(graphics::PackedCommand);
+  } else {
+    command_ring.reset();
+    command_ring_capacity = 0;
+  }
+  command_ring_next_command = 0;
+  frame_first_command = 0;
+
   screen_size = Size{.width = static_cast<float>(graphics_screen_size.width),
                      .height = static_cast<float>(graphics_screen_size.height)};
 #endif
 
   fiber_waiting_on_screen_to_finish_drawing = nullptr;
   screen_is_drawing = false;
+  frame_command_count = 0;
+  frame_is_unringed = false;
+  unringed_frame_commands.clear();
 }
 
 Size GetScreenSize() {
@@ -149,23 +202,94 @@ const graphics::Commands& GetLastRunDrawCommands() {
 }
 #endif
 
-void RunDrawCommands(
-    const ::perception::devices::graphics::Commands& commands) {
-  // Send the draw calls.
-  screen_is_drawing = true;
+namespace {
 
-#ifdef TEST
-  last_run_draw_commands = commands;
+// Wakes up whatever is waiting for the screen to finish drawing.
+void FinishedDrawing() {
   screen_is_drawing = false;
   Fiber* waiting_fiber = fiber_waiting_on_screen_to_finish_drawing;
   fiber_waiting_on_screen_to_finish_drawing = nullptr;
   if (waiting_fiber) waiting_fiber->WakeUp();
+}
+
+// Converts a frame into commands that can be serialized.
+graphics::Commands UnpackCommands(
+    const std::vector<graphics::PackedCommand>& commands,
+    const std::vector<graphics::Rectangle>& damaged_areas) {
+  graphics::Commands unpacked_commands;
+  unpacked_commands.commands.reserve(commands.size());
+  for (const auto& command : commands)
+    unpacked_commands.commands.push_back(graphics::UnpackCommand(command));
+  unpacked_commands.damaged_areas = damaged_areas;
+  return unpacked_commands;
+}
+
+}  // namespace
+
+void BeginDrawCommands() {
+  frame_command_count = 0;
+  unringed_frame_commands.clear();
+#ifdef TEST
+  frame_is_unringed = true;
 #else
-  graphics_device.RunCommands(commands, [](Status response) {
-    screen_is_drawing = false;
-    Fiber* waiting_fiber = fiber_waiting_on_screen_to_finish_drawing;
-    fiber_waiting_on_screen_to_finish_drawing = nullptr;
-    if (waiting_fiber) waiting_fiber->WakeUp();
-  });
+  // Only one frame is drawn at a time, so the driver is done with everything
+  // already in the ring.
+  frame_is_unringed = !command_ring;
+  frame_first_command = command_ring_next_command;
+#endif
+}
+
+graphics::PackedCommand& AddDrawCommand() {
+#ifndef TEST
+  if (!frame_is_unringed) {
+    auto* ring = static_cast<graphics::PackedCommand*>(**command_ring);
+    if (frame_command_count < command_ring_capacity) {
+      graphics::PackedCommand& command =
+          ring[(frame_first_command + frame_command_count) %
+               command_ring_capacity];
+      command = {};
+      frame_command_count++;
+      return command;
+    }
+
+    // The frame doesn't fit in the ring, so move what's been written so far
+    // out of it.
+    frame_is_unringed = true;
+    for (size_t i = 0; i < frame_command_count; i++) {
+      unringed_frame_commands.push_back(
+          ring[(frame_first_command + i) % command_ring_capacity]);
+    }
+  }
+#endif
+  frame_command_count++;
+  return unringed_frame_commands.emplace_back();
+}
+
+void RunDrawCommands(const std::vector<graphics::Rectangle>& damaged_areas) {
+  // Send the draw calls.
+  screen_is_drawing = true;
+
+#ifdef TEST
+  last_run_draw_commands =
+      UnpackCommands(unringed_frame_commands, damaged_areas);
+  FinishedDrawing();
+#else
+  if (frame_is_unringed) {
+    // Fall back to serializing the frame.
+    graphics_device.RunCommands(
+        UnpackCommands(unringed_frame_commands, damaged_areas),
+        [](Status response) { FinishedDrawing(); });
+    return;
+  }
+
+  command_ring_next_command =
+      (frame_first_command + frame_command_count) % command_ring_capacity;
+  command_ring_doorbell.first_command =
+      static_cast<uint32>(frame_first_command);
+  command_ring_doorbell.command_count =
+      static_cast<uint32>(frame_command_count);
+  command_ring_doorbell.damaged_areas = damaged_areas;
+  graphics_device.RunCommandBuffer(command_ring_doorbell,
+                                   [](Status response) { FinishedDrawing(); });
 #endif
 }
@@ -14,6 +14,8 @@
 
 #pragma once
 
+#include <vector>
+
 #include "perception/devices/graphics_device.h"
 #include "perception/ui/size.h"
 #include "types.h"
@@ -24,8 +26,21 @@ void InitializeScreen();
 size_t GetWindowManagerTextureId();
 uint32* GetWindowManagerTextureData();
 void SleepUntilWeAreReadyToStartDrawing();
+
+// Starts a new frame of draw commands. Must be called after
+// SleepUntilWeAreReadyToStartDrawing().
+void BeginDrawCommands();
+
+// Adds a zeroed command to the end of the frame, to be filled in before the
+// frame is run. When it fits, the command is written straight into the ring
+// shared with the graphics driver.
+::perception::devices::graphics::PackedCommand& AddDrawCommand();
+
+// Sends the frame of draw commands to the graphics driver, which only needs to
+// present the damaged areas.
 void RunDrawCommands(
-    const ::perception::devices::graphics::Commands& commands);
+    const std::vector<::perception::devices::graphics::Rectangle>&
+        damaged_areas);
 
 #ifdef TEST
 const ::perception::devices::graphics::Commands& GetLastRunDrawCommands();
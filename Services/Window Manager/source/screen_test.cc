@@ -14,6 +14,8 @@
 
 #include "screen.h"
 
+#include <vector>
+
 #include "perception/devices/graphics_device.h"
 #include "perception/ui/size.h"
 #include "testing.h"
@@ -43,11 +45,41 @@ TEST(ScreenDrawingCommandsAndSynchronization) {
   // Initially not drawing, sleep check should be non-blocking no-op
   SleepUntilWeAreReadyToStartDrawing();
 
-  graphics::Commands commands;
-  RunDrawCommands(commands);
+  BeginDrawCommands();
+  std::vector<graphics::Rectangle> damaged_areas;
+  RunDrawCommands(damaged_areas);
 
   // After completion, screen drawing should reset to false
   SleepUntilWeAreReadyToStartDrawing();
 }
 
+TEST(ScreenRunsTheCommandsAddedToTheFrame) {
+  InitializeScreen();
+
+  BeginDrawCommands();
+  graphics::PackedCommand& set_destination = AddDrawCommand();
+  set_destination.type = graphics::Command::Type::SET_DESTINATION_TEXTURE;
+  set_destination.texture_id = 0;
+  graphics::PackedCommand& fill = AddDrawCommand();
+  fill.type = graphics::Command::Type::FILL_RECTANGLE;
+  fill.width = 10;
+  fill.height = 20;
+  fill.color = 0xFF00FF00;
+  RunDrawCommands({});
+
+  const auto& commands = GetLastRunDrawCommands().commands;
+  EXPECT((size_t)2, commands.size());
+  if (commands.size() != 2) return;
+  EXPECT(graphics::Command::Type::SET_DESTINATION_TEXTURE, commands[0].type);
+  EXPECT(true, commands[0].texture_reference != nullptr);
+  EXPECT(graphics::Command::Type::FILL_RECTANGLE, commands[1].type);
+  EXPECT(true, commands[1].fill_rectangle_parameters != nullptr);
+  EXPECT(20, (int)commands[1].fill_rectangle_parameters->size.height);
+
+  // The next frame starts empty.
+  BeginDrawCommands();
+  RunDrawCommands({});
+  EXPECT((size_t)0, GetLastRunDrawCommands().commands.size());
+}
+
 }  // namespace
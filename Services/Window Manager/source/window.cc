@@ -111,6 +111,9 @@ Window* focused_window;
 // Window that the mouse is currently over the contents of.
 Window* hovering_window;
 
+// Window with a hover waiting to be sent at the end of the frame.
+Window* window_with_pending_mouse_hover;
+
 // The window being dragged.
 Window* dragging_window;
 
@@ -246,6 +249,7 @@ StatusOr<std::shared_ptr<Window>> Window::CreateWindow(
   window->window_listener_ = request.window;
   window->keyboard_listener_ = request.keyboard_listener;
   window->mouse_listener_ = request.mouse_listener;
+  window->wants_mouse_history_ = request.wants_mouse_history;
   window->add_title_bar_ = request.add_title_bar;
   window->minimum_size_ = request.minimum_size;
   window->maximum_size_ = request.maximum_size;
@@ -267,6 +271,8 @@ StatusOr<std::shared_ptr<Window>> Window::CreateWindow(
 }
 
 Window::~Window() {
+  if (window_with_pending_mouse_hover == this)
+    window_with_pending_mouse_hover = nullptr;
   Hide();
   if (title_bar_texture_id_ != 0) {
     ::perception::GetService<::perception::devices::GraphicsDevice>()
@@ -576,6 +582,7 @@ Window* Window::GetCaptiveMouseWindow() { return captive_mouse_window; }
 
 void Window::SetCaptureMouse(bool capture) {
   if (is_mouse_captive_ == capture) return;
+  FlushMouseMotion();
   is_mouse_captive_ = capture;
   if (capture) {
     captive_mouse_window = this;
@@ -801,6 +808,7 @@ bool Window::MouseEvent(const Point& point,
   if (!hit_area.Contains(point)) {
     // Not even in the hit area.
     if (IsHovering()) {
+      SendPendingMouseHover();
       if (mouse_listener_) mouse_listener_.MouseLeave(nullptr);
       hovering_window = nullptr;
       last_mouse_hover_position_ = std::nullopt;
@@ -854,6 +862,7 @@ bool Window::MouseEvent(const Point& point,
   if (screen_area.Contains(point)) {
     if (!IsHovering()) {
       hovering_window = this;
+      SendPendingMouseHover();
       if (mouse_listener_) mouse_listener_.MouseEnter(nullptr);
     }
 
@@ -904,21 +913,20 @@ bool Window::MouseEvent(const Point& point,
       message.position.y = local_point.y;
       message.button.button = button_event->button;
       message.button.is_pressed_down = button_event->is_pressed_down;
+      SendPendingMouseHover();
       if (mouse_listener_) mouse_listener_.MouseClick(message, nullptr);
     } else {
       // Hover event.
       if (!last_mouse_hover_position_.has_value() ||
           *last_mouse_hover_position_ != local_point) {
         last_mouse_hover_position_ = local_point;
-        MousePositionEvent message;
-        message.x = local_point.x;
-        message.y = local_point.y;
-        if (mouse_listener_) mouse_listener_.MouseHover(message, nullptr);
+        QueueMouseHover(local_point);
       }
     }
 
   } else {
     if (IsHovering()) {
+      SendPendingMouseHover();
       if (mouse_listener_) mouse_listener_.MouseLeave(nullptr);
       hovering_window = nullptr;
     }
@@ -931,6 +939,34 @@ bool Window::MouseEvent(const Point& point,
   return true;
 }
 
+void Window::SendPendingMouseHover() {
+  Window* window = window_with_pending_mouse_hover;
+  if (window == nullptr) return;
+  window_with_pending_mouse_hover = nullptr;
+
+  if (window->mouse_listener_)
+    window->mouse_listener_.MouseHover(window->pending_mouse_hover_, nullptr);
+  window->pending_mouse_hover_.history.clear();
+}
+
+void Window::QueueMouseHover(const Point& local_point) {
+  if (window_with_pending_mouse_hover != this) {
+    SendPendingMouseHover();
+    window_with_pending_mouse_hover = this;
+  }
+
+  pending_mouse_hover_.x = local_point.x;
+  pending_mouse_hover_.y = local_point.y;
+  if (wants_mouse_history_) {
+    MousePositionEvent& position =
+        pending_mouse_hover_.history.emplace_back();
+    position.x = local_point.x;
+    position.y = local_point.y;
+    if (pending_mouse_hover_.history.size() >= kMaxMouseHistoryLength)
+      SendPendingMouseHover();
+  }
+}
+
 void Window::Draw(const Rectangle& screen_area) {
   if (!IsVisible()) return;
   if (!screen_area.Intersects(GetScreenAreaWithFrame())) return;
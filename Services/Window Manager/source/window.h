@@ -19,6 +19,7 @@
 #include <optional>
 #include <string>
 #include <string_view>
+#include <vector>
 
 #include "mouse.h"
 #include "perception/devices/keyboard_listener.h"
@@ -71,6 +72,12 @@ class Window : public std::enable_shared_from_this<Window> {
       const ::perception::ui::Point& point);
   bool MouseEvent(const ::perception::ui::Point& point,
                   std::optional<MouseButtonEvent> button_event);
+  bool WantsMouseHistory() const { return wants_mouse_history_; }
+
+  // Hovers are coalesced into one event per frame. This sends the hover that's
+  // waiting to be sent, if there is one. It's called at the end of each frame,
+  // and before any other mouse event so that they stay in order.
+  static void SendPendingMouseHover();
 
   void Draw(const ::perception::ui::Rectangle& screen_area);
   void Invalidate();
@@ -174,6 +181,15 @@ class Window : public std::enable_shared_from_this<Window> {
   void InvalidateScreenArea();
 
   std::optional<::perception::ui::Point> last_mouse_hover_position_;
+
+  // Whether hover events should carry the positions coalesced into them.
+  bool wants_mouse_history_;
+
+  // The hover that will be sent at the end of the frame. Its history is kept
+  // between frames so its memory is reused.
+  ::perception::devices::MousePositionEvent pending_mouse_hover_;
+
+  void QueueMouseHover(const ::perception::ui::Point& local_point);
 };
 
 std::shared_ptr<Window> GetWindowWithListener(
@@ -20,6 +20,7 @@ qemu-system-x86_64 \
   -audiodev coreaudio,id=audio0 \
   -device hda-output,audiodev=audio0 \
   -m 2048 \
+  -smp 4 \
   -serial stdio \
   -device isa-debug-exit,iobase=0xf4,iosize=0x04 \
   -netdev user,id=net0 \